@@ -27,6 +27,7 @@
 #include "operations/layer-modes/gimp-layer-modes.h"
 
 #include "core/gimpchannel.h"
+#include "core/gimpgrouplayer.h"
 #include "core/gimpimage.h"
 #include "core/gimplayer.h"
 #include "core/gimplayer-floating-selection.h"
@@ -320,6 +321,15 @@ static const GimpToggleActionEntry layers_toggle_actions[] =
     layers_lock_alpha_cmd_callback,
     FALSE,
     GIMP_HELP_LAYER_LOCK_ALPHA },
+
+  { "layers-pin-group", NULL,
+    NC_("layers-action", "_Pin Layer Group"), NULL, { NULL },
+    NC_("layers-action",
+        "Keep the layer group rendered in full resolution, for groups "
+        "that rarely change"),
+    layers_pin_group_cmd_callback,
+    FALSE,
+    GIMP_HELP_LAYER_PIN_GROUP },
 };
 
 static const GimpRadioActionEntry layers_blend_space_actions[] =
@@ -791,6 +801,7 @@ layers_actions_update (GimpActionGroup *group,
   gboolean       have_no_masks      = FALSE; /* At least 1 selected layer has no mask.            */
   gboolean       have_groups        = FALSE; /* At least 1 selected layer is a group.             */
   gboolean       have_no_groups     = FALSE; /* At least 1 selected layer is not a group.         */
+  gboolean       all_pinned         = TRUE;  /* All selected groups are pinned.                   */
   gboolean       have_writable      = FALSE; /* At least 1 selected layer has no contents lock.   */
   gboolean       have_prev          = FALSE; /* At least 1 selected layer has a previous sibling. */
   gboolean       have_next          = FALSE; /* At least 1 selected layer has a next sibling.     */
@@ -848,9 +859,16 @@ layers_actions_update (GimpActionGroup *group,
             }
 
           if (gimp_viewable_get_children (GIMP_VIEWABLE (iter->data)))
-            have_groups = TRUE;
+            {
+              have_groups = TRUE;
+
+              if (! gimp_group_layer_get_pinned (iter->data))
+                all_pinned = FALSE;
+            }
           else
-            have_no_groups = TRUE;
+            {
+              have_no_groups = TRUE;
+            }
 
           if (! gimp_item_is_content_locked (GIMP_ITEM (iter->data), NULL))
             have_writable = TRUE;
@@ -1062,6 +1080,9 @@ layers_actions_update (GimpActionGroup *group,
   SET_SENSITIVE ("layers-merge-down-button", n_selected_layers > 0 && !fs && !ac);
   SET_VISIBLE   ("layers-merge-group",       have_groups);
   SET_SENSITIVE ("layers-merge-group",       n_selected_layers && !fs && !ac && have_groups);
+  SET_VISIBLE   ("layers-pin-group",         have_groups);
+  SET_SENSITIVE ("layers-pin-group",         have_groups && !ac);
+  SET_ACTIVE    ("layers-pin-group",         have_groups && all_pinned);
   SET_SENSITIVE ("layers-merge-layers",      n_selected_layers > 0 && !fs && !ac);
   SET_SENSITIVE ("layers-flatten-image",     !fs && !ac);
 
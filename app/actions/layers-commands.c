@@ -2341,6 +2341,37 @@ layers_lock_alpha_cmd_callback (GimpAction *action,
   gimp_image_flush (image);
 }
 
+void
+layers_pin_group_cmd_callback (GimpAction *action,
+                               GVariant   *value,
+                               gpointer    data)
+{
+  GimpImage *image;
+  GList     *layers;
+  GList     *iter;
+  gboolean   pinned;
+  return_if_no_layers (image, layers, data);
+
+  pinned = g_variant_get_boolean (value);
+
+  /*  same trick as in layers_lock_alpha_cmd_callback(), when unpinning,
+   *  all selected groups are expected to be pinned.  pinning is not
+   *  undoable, since it doesn't change the image.
+   */
+  for (iter = layers; iter; iter = iter->next)
+    {
+      if (GIMP_IS_GROUP_LAYER (iter->data) &&
+          ! pinned && ! gimp_group_layer_get_pinned (iter->data))
+        return;
+    }
+
+  for (iter = layers; iter; iter = iter->next)
+    {
+      if (GIMP_IS_GROUP_LAYER (iter->data))
+        gimp_group_layer_set_pinned (iter->data, pinned);
+    }
+}
+
 void
 layers_color_tag_cmd_callback (GimpAction *action,
                                GVariant   *value,
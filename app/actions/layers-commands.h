@@ -171,6 +171,9 @@ void   layers_lock_position_cmd_callback      (GimpAction *action,
 void   layers_lock_alpha_cmd_callback         (GimpAction *action,
                                                GVariant   *value,
                                                gpointer    data);
+void   layers_pin_group_cmd_callback          (GimpAction *action,
+                                               GVariant   *value,
+                                               gpointer    data);
 
 void   layers_color_tag_cmd_callback          (GimpAction *action,
                                                GVariant   *value,
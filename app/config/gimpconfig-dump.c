@@ -167,6 +167,12 @@ dump_gimprc_system (GimpConfig       *rc,
           gimp_config_writer_printf (writer, "1");
           gimp_config_writer_close (writer);
         }
+      else if (! strcmp (prop_spec->name, "num-async-threads"))
+        {
+          gimp_config_writer_open (writer, "num-async-threads");
+          gimp_config_writer_printf (writer, "1");
+          gimp_config_writer_close (writer);
+        }
       else if (! strcmp (prop_spec->name, "tile-cache-size"))
         {
           gimp_config_writer_open (writer, "tile-cache-size");
@@ -336,6 +342,14 @@ dump_gimprc_manpage (GimpConfig       *rc,
           gimp_config_writer_printf (writer, "1");
           gimp_config_writer_close (writer);
 
+          success = TRUE;
+        }
+      else if (! strcmp (prop_spec->name, "num-async-threads"))
+        {
+          gimp_config_writer_open (writer, "num-async-threads");
+          gimp_config_writer_printf (writer, "1");
+          gimp_config_writer_close (writer);
+
           success = TRUE;
         }
       else if (! strcmp (prop_spec->name, "tile-cache-size"))
@@ -97,6 +97,7 @@ struct _GimpCoreConfig
   gboolean                import_promote_dither;
   gboolean                import_add_alpha;
   gchar                  *import_raw_plug_in;
+  gboolean                xcf_lazy_loading;
   GimpExportFileType      export_file_type;
   gboolean                export_color_profile;
   gboolean                export_comment;
@@ -76,6 +76,7 @@ enum
   PROP_SPACE_BAR_ACTION,
   PROP_ZOOM_QUALITY,
   PROP_USE_EVENT_HISTORY,
+  PROP_COLOR_TRANSFORM_LUT,
 
   /* ignored, only for backward compatibility: */
   PROP_DEFAULT_SNAP_TO_GUIDES,
@@ -342,6 +343,13 @@ gimp_display_config_class_init (GimpDisplayConfigClass *klass)
                             DEFAULT_USE_EVENT_HISTORY,
                             GIMP_PARAM_STATIC_STRINGS);
 
+  GIMP_CONFIG_PROP_BOOLEAN (object_class, PROP_COLOR_TRANSFORM_LUT,
+                            "color-transform-lut",
+                            "Use a lookup table for display color management",
+                            COLOR_TRANSFORM_LUT_BLURB,
+                            FALSE,
+                            GIMP_PARAM_STATIC_STRINGS);
+
   /*  only for backward compatibility:  */
   GIMP_CONFIG_PROP_BOOLEAN (object_class, PROP_DEFAULT_SNAP_TO_GUIDES,
                             "default-snap-to-guides",
@@ -561,6 +569,9 @@ gimp_display_config_set_property (GObject      *object,
     case PROP_USE_EVENT_HISTORY:
       display_config->use_event_history = g_value_get_boolean (value);
       break;
+    case PROP_COLOR_TRANSFORM_LUT:
+      display_config->color_transform_lut = g_value_get_boolean (value);
+      break;
 
     case PROP_DEFAULT_SNAP_TO_GUIDES:
     case PROP_DEFAULT_SNAP_TO_GRID:
@@ -681,6 +692,9 @@ gimp_display_config_get_property (GObject    *object,
     case PROP_USE_EVENT_HISTORY:
       g_value_set_boolean (value, display_config->use_event_history);
       break;
+    case PROP_COLOR_TRANSFORM_LUT:
+      g_value_set_boolean (value, display_config->color_transform_lut);
+      break;
 
     case PROP_DEFAULT_SNAP_TO_GUIDES:
     case PROP_DEFAULT_SNAP_TO_GRID:
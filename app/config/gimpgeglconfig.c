@@ -42,6 +42,8 @@
 
 #define GIMP_MAX_MEM_PROCESS          (MIN (G_MAXSIZE, GIMP_MAX_MEMSIZE))
 
+#define GIMP_MAX_NUM_ASYNC_THREADS    16
+
 
 enum
 {
@@ -50,6 +52,8 @@ enum
   PROP_SWAP_PATH,
   PROP_SWAP_COMPRESSION,
   PROP_NUM_PROCESSORS,
+  PROP_NUM_ASYNC_THREADS,
+  PROP_THREADED_PROJECTION,
   PROP_TILE_CACHE_SIZE,
   PROP_USE_OPENCL,
 
@@ -130,6 +134,24 @@ gimp_gegl_config_class_init (GimpGeglConfigClass *klass)
                         1, max_n_threads, n_threads,
                         GIMP_PARAM_STATIC_STRINGS);
 
+  /* background jobs shouldn't compete with interactive work for all the
+   * cores, so only use a fraction of them by default.
+   */
+  GIMP_CONFIG_PROP_INT (object_class, PROP_NUM_ASYNC_THREADS,
+                        "num-async-threads",
+                        "Number of background threads to use",
+                        NUM_ASYNC_THREADS_BLURB,
+                        1, GIMP_MAX_NUM_ASYNC_THREADS,
+                        CLAMP (n_threads / 4, 1, 4),
+                        GIMP_PARAM_STATIC_STRINGS);
+
+  GIMP_CONFIG_PROP_BOOLEAN (object_class, PROP_THREADED_PROJECTION,
+                            "threaded-projection",
+                            "Render the image in a background thread",
+                            THREADED_PROJECTION_BLURB,
+                            FALSE,
+                            GIMP_PARAM_STATIC_STRINGS);
+
   memory_size = gimp_get_physical_memory_size ();
 
   /* limit to the amount one process can handle */
@@ -217,6 +239,14 @@ gimp_gegl_config_set_property (GObject      *object,
       gegl_config->num_processors = g_value_get_int (value);
       break;
 
+    case PROP_NUM_ASYNC_THREADS:
+      gegl_config->num_async_threads = g_value_get_int (value);
+      break;
+
+    case PROP_THREADED_PROJECTION:
+      gegl_config->threaded_projection = g_value_get_boolean (value);
+      break;
+
     case PROP_TILE_CACHE_SIZE:
       gegl_config->tile_cache_size = g_value_get_uint64 (value);
       break;
@@ -261,6 +291,14 @@ gimp_gegl_config_get_property (GObject    *object,
       g_value_set_int (value, gegl_config->num_processors);
       break;
 
+    case PROP_NUM_ASYNC_THREADS:
+      g_value_set_int (value, gegl_config->num_async_threads);
+      break;
+
+    case PROP_THREADED_PROJECTION:
+      g_value_set_boolean (value, gegl_config->threaded_projection);
+      break;
+
     case PROP_TILE_CACHE_SIZE:
       g_value_set_uint64 (value, gegl_config->tile_cache_size);
       break;
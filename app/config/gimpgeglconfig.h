@@ -38,6 +38,8 @@ struct _GimpGeglConfig
   gchar    *swap_path;
   gchar    *swap_compression;
   gint      num_processors;
+  gint      num_async_threads;
+  gboolean  threaded_projection;
   guint64   tile_cache_size;
   gboolean  use_opencl;
 };
@@ -62,6 +62,11 @@ _("What to do when opening a file with an embedded ICC color profile.")
 #define COLOR_PROFILE_PATH_BLURB \
 _("Sets the default folder path for all color profile file dialogs.")
 
+#define COLOR_TRANSFORM_LUT_BLURB \
+_("When enabled, the display color transform, including soft-proofing, " \
+  "is baked into a 3D lookup table, which is faster but less accurate " \
+  "in dark colors.")
+
 #define CURSOR_MODE_BLURB \
 _("Sets the type of mouse pointers to use.")
 
@@ -233,6 +238,12 @@ _("Add an alpha channel to all layers of imported images.")
 #define IMPORT_RAW_PLUG_IN_BLURB \
 _("Which plug-in to use for importing raw digital camera files.")
 
+#define XCF_LAZY_LOADING_BLURB \
+_("When enabled, the pixels of XCF files are read from the file on " \
+  "demand instead of all at once when the file is opened.  This makes " \
+  "opening large files faster.  The file must not be modified by other " \
+  "programs while it is open.")
+
 #define EXPORT_FILE_TYPE_BLURB \
 _("Export file type used by default.")
 
@@ -358,6 +369,10 @@ _("If enabled, the move tool sets the edited layer or path as active.  " \
 _("Sets the size of the navigation preview available in the lower right " \
   "corner of the image window.")
 
+#define NUM_ASYNC_THREADS_BLURB \
+_("Sets how many threads GIMP should use for background jobs, such as " \
+  "loading data files or preparing line art.")
+
 #define NUM_PROCESSORS_BLURB \
 _("Sets how many threads GIMP should use for operations that support it.")
 
@@ -729,6 +744,10 @@ _("Sets the size of the thumbnail shown in the Open dialog.")
 _("The thumbnail in the Open dialog will be automatically updated " \
   "if the file being previewed is smaller than the size set here.")
 
+#define THREADED_PROJECTION_BLURB \
+_("When enabled, the image is rendered by a background thread, which " \
+  "shows a low-resolution version of the visible area first.")
+
 #define TILE_CACHE_SIZE_BLURB \
 _("When the amount of pixel data exceeds this limit, GIMP will start to " \
   "swap tiles to disk.  This is a lot slower but it makes it possible to " \
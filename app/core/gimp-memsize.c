@@ -21,6 +21,7 @@
 
 #include <cairo.h>
 #include <gegl.h>
+#include <gegl-buffer-backend.h>
 #include <gdk-pixbuf/gdk-pixbuf.h>
 
 #include "libgimpbase/gimpbase.h"
@@ -339,6 +340,64 @@ gimp_gegl_pyramid_get_memsize (GeglBuffer *buffer)
   return 0;
 }
 
+/*  counts the stored tiles of all pyramid levels, in memory or in swap  */
+gint64
+gimp_gegl_pyramid_get_tile_memsize (GeglBuffer *buffer)
+{
+  if (buffer)
+    {
+      const GeglRectangle *extent = gegl_buffer_get_extent (buffer);
+      const Babl          *format = gegl_buffer_get_format (buffer);
+      gint                 tile_width;
+      gint                 tile_height;
+      gint64               n_tiles = 0;
+      gint                 z;
+
+      if (gegl_rectangle_is_empty (extent))
+        return gimp_g_object_get_memsize (G_OBJECT (buffer));
+
+      g_object_get (buffer,
+                    "tile-width",  &tile_width,
+                    "tile-height", &tile_height,
+                    NULL);
+
+      for (z = 0; ; z++)
+        {
+          gint64 width  = (gint64) tile_width  << z;
+          gint64 height = (gint64) tile_height << z;
+          gint   x1     = floor ((gdouble) extent->x / width);
+          gint   y1     = floor ((gdouble) extent->y / height);
+          gint   x2     = floor ((gdouble) (extent->x + extent->width  - 1) /
+                                 width);
+          gint   y2     = floor ((gdouble) (extent->y + extent->height - 1) /
+                                 height);
+          gint   x;
+          gint   y;
+
+          for (y = y1; y <= y2; y++)
+            for (x = x1; x <= x2; x++)
+              {
+                if (gegl_tile_source_command (GEGL_TILE_SOURCE (buffer),
+                                              GEGL_TILE_EXIST,
+                                              x, y, z, NULL))
+                  {
+                    n_tiles++;
+                  }
+              }
+
+          /*  the top level is the first one made of a single tile  */
+          if (x1 == x2 && y1 == y2)
+            break;
+        }
+
+      return (n_tiles * tile_width * tile_height *
+              babl_format_get_bytes_per_pixel (format) +
+              gimp_g_object_get_memsize (G_OBJECT (buffer)));
+    }
+
+  return 0;
+}
+
 gint64
 gimp_string_get_memsize (const gchar *string)
 {
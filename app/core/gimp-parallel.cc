@@ -45,41 +45,60 @@ extern "C"
 #include "gimpcancelable.h"
 
 
-#define GIMP_PARALLEL_MAX_THREADS           64
-#define GIMP_PARALLEL_RUN_ASYNC_MAX_THREADS  1
+#define GIMP_PARALLEL_MAX_THREADS 64
 
 
+typedef struct _GimpParallelRunAsyncLane GimpParallelRunAsyncLane;
+
 typedef struct
 {
-  GimpAsync        *async;
-  gint              priority;
-  GimpRunAsyncFunc  func;
-  gpointer          user_data;
-  GDestroyNotify    user_data_destroy_func;
+  GimpAsync                *async;
+  gint                      priority;
+  GimpRunAsyncFunc          func;
+  gpointer                  user_data;
+  GDestroyNotify            user_data_destroy_func;
+
+  GimpParallelRunAsyncLane *lane;
+  GList                    *link;
+  gint64                    enqueue_time;
 } GimpParallelRunAsyncTask;
 
-typedef struct
+struct _GimpParallelRunAsyncLane
 {
   GThread   *thread;
 
   gboolean   quit;
 
   GimpAsync *current_async;
-} GimpParallelRunAsyncThread;
+
+  /* tasks assigned to this lane, sorted by priority.  lanes whose queue
+   * is empty steal tasks from the other lanes.
+   */
+  GQueue     queue;
+
+  /* total time spent waiting by the tasks dequeued from this lane, and
+   * their number
+   */
+  gdouble    wait_time;
+  gint       n_dequeued;
+};
 
 
 /*  local function prototypes  */
 
-static void                       gimp_parallel_notify_num_processors   (GimpGeglConfig             *config);
+static void                       gimp_parallel_notify_num_threads      (GimpGeglConfig             *config);
 
 static void                       gimp_parallel_set_n_threads           (gint                        n_threads,
+                                                                         gint                        n_async_threads,
                                                                          gboolean                    finish_tasks);
 
 static void                       gimp_parallel_run_async_set_n_threads (gint                        n_threads,
                                                                          gboolean                    finish_tasks);
-static gpointer                   gimp_parallel_run_async_thread_func   (GimpParallelRunAsyncThread *thread);
-static void                       gimp_parallel_run_async_enqueue_task  (GimpParallelRunAsyncTask   *task);
-static GimpParallelRunAsyncTask * gimp_parallel_run_async_dequeue_task  (void);
+static gpointer                   gimp_parallel_run_async_thread_func   (GimpParallelRunAsyncLane   *lane);
+static void                       gimp_parallel_run_async_enqueue_task  (GimpParallelRunAsyncTask   *task,
+                                                                         GimpParallelRunAsyncLane   *lane);
+static GimpParallelRunAsyncTask * gimp_parallel_run_async_peek_task     (GimpParallelRunAsyncLane   *lane);
+static GimpParallelRunAsyncTask * gimp_parallel_run_async_dequeue_task  (GimpParallelRunAsyncLane   *lane);
 static gboolean                   gimp_parallel_run_async_execute_task  (GimpParallelRunAsyncTask   *task);
 static void                       gimp_parallel_run_async_abort_task    (GimpParallelRunAsyncTask   *task);
 static void                       gimp_parallel_run_async_cancel        (GimpAsync                  *async);
@@ -89,11 +108,10 @@ static void                       gimp_parallel_run_async_waiting       (GimpAsy
 /*  local variables  */
 
 static gint                       gimp_parallel_run_async_n_threads = 0;
-static GimpParallelRunAsyncThread gimp_parallel_run_async_threads[GIMP_PARALLEL_RUN_ASYNC_MAX_THREADS];
+static GimpParallelRunAsyncLane   gimp_parallel_run_async_lanes[GIMP_PARALLEL_RUN_ASYNC_MAX_THREADS];
 
 static GMutex                     gimp_parallel_run_async_mutex;
 static GCond                      gimp_parallel_run_async_cond;
-static GQueue                     gimp_parallel_run_async_queue = G_QUEUE_INIT;
 
 
 /*  public functions  */
@@ -109,10 +127,13 @@ gimp_parallel_init (Gimp *gimp)
   config = GIMP_GEGL_CONFIG (gimp->config);
 
   g_signal_connect (config, "notify::num-processors",
-                    G_CALLBACK (gimp_parallel_notify_num_processors),
+                    G_CALLBACK (gimp_parallel_notify_num_threads),
+                    NULL);
+  g_signal_connect (config, "notify::num-async-threads",
+                    G_CALLBACK (gimp_parallel_notify_num_threads),
                     NULL);
 
-  gimp_parallel_notify_num_processors (config);
+  gimp_parallel_notify_num_threads (config);
 }
 
 void
@@ -121,11 +142,11 @@ gimp_parallel_exit (Gimp *gimp)
   g_return_if_fail (GIMP_IS_GIMP (gimp));
 
   g_signal_handlers_disconnect_by_func (gimp->config,
-                                        (gpointer) gimp_parallel_notify_num_processors,
+                                        (gpointer) gimp_parallel_notify_num_threads,
                                         NULL);
 
   /* stop all threads */
-  gimp_parallel_set_n_threads (0, /* finish_tasks = */ FALSE);
+  gimp_parallel_set_n_threads (0, 0, /* finish_tasks = */ FALSE);
 }
 
 GimpAsync *
@@ -148,7 +169,7 @@ gimp_parallel_run_async_full (gint             priority,
 
   async = gimp_async_new ();
 
-  task = g_slice_new (GimpParallelRunAsyncTask);
+  task = g_slice_new0 (GimpParallelRunAsyncTask);
 
   task->async                  = GIMP_ASYNC (g_object_ref (async));
   task->priority               = priority;
@@ -167,9 +188,9 @@ gimp_parallel_run_async_full (gint             priority,
 
       g_mutex_lock (&gimp_parallel_run_async_mutex);
 
-      gimp_parallel_run_async_enqueue_task (task);
+      gimp_parallel_run_async_enqueue_task (task, NULL);
 
-      g_cond_signal (&gimp_parallel_run_async_cond);
+      g_cond_broadcast (&gimp_parallel_run_async_cond);
 
       g_mutex_unlock (&gimp_parallel_run_async_mutex);
     }
@@ -248,22 +269,105 @@ gimp_parallel_run_async_independent_full (gint             priority,
   return async;
 }
 
+gint
+gimp_parallel_run_async_get_n_lanes (void)
+{
+  return gimp_parallel_run_async_n_threads;
+}
+
+void
+gimp_parallel_run_async_get_lane_stats (gint     lane,
+                                        gint    *queue_depth,
+                                        gdouble *wait_time,
+                                        gint    *n_dequeued)
+{
+  g_return_if_fail (lane >= 0 && lane < GIMP_PARALLEL_RUN_ASYNC_MAX_THREADS);
+
+  g_mutex_lock (&gimp_parallel_run_async_mutex);
+
+  if (queue_depth)
+    *queue_depth = gimp_parallel_run_async_lanes[lane].queue.length;
+
+  if (wait_time)
+    *wait_time = gimp_parallel_run_async_lanes[lane].wait_time;
+
+  if (n_dequeued)
+    *n_dequeued = gimp_parallel_run_async_lanes[lane].n_dequeued;
+
+  g_mutex_unlock (&gimp_parallel_run_async_mutex);
+}
+
+gint
+gimp_parallel_run_async_get_n_queued (void)
+{
+  gint n_queued = 0;
+  gint i;
+
+  for (i = 0; i < gimp_parallel_run_async_n_threads; i++)
+    {
+      gint queue_depth;
+
+      gimp_parallel_run_async_get_lane_stats (i, &queue_depth, NULL, NULL);
+
+      n_queued += queue_depth;
+    }
+
+  return n_queued;
+}
+
+gdouble
+gimp_parallel_run_async_get_wait_time (void)
+{
+  static gdouble last_wait_time[GIMP_PARALLEL_RUN_ASYNC_MAX_THREADS];
+  static gint    last_n_dequeued[GIMP_PARALLEL_RUN_ASYNC_MAX_THREADS];
+  gdouble        max_wait_time = 0.0;
+  gint           i;
+
+  /*  the average wait of the tasks dequeued since the last call, in the
+   *  lane where it is longest
+   */
+  for (i = 0; i < gimp_parallel_run_async_n_threads; i++)
+    {
+      gdouble wait_time;
+      gint    n_dequeued;
+
+      gimp_parallel_run_async_get_lane_stats (i, NULL,
+                                              &wait_time, &n_dequeued);
+
+      wait_time  -= last_wait_time[i];
+      n_dequeued -= last_n_dequeued[i];
+
+      if (n_dequeued > 0)
+        {
+          max_wait_time = MAX (max_wait_time, wait_time / n_dequeued);
+
+          last_wait_time[i]  += wait_time;
+          last_n_dequeued[i] += n_dequeued;
+        }
+    }
+
+  return max_wait_time;
+}
+
 
 /*  private functions  */
 
 
 static void
-gimp_parallel_notify_num_processors (GimpGeglConfig *config)
+gimp_parallel_notify_num_threads (GimpGeglConfig *config)
 {
   gimp_parallel_set_n_threads (config->num_processors,
+                               config->num_async_threads,
                                /* finish_tasks = */ TRUE);
 }
 
 static void
 gimp_parallel_set_n_threads (gint     n_threads,
+                             gint     n_async_threads,
                              gboolean finish_tasks)
 {
-  gimp_parallel_run_async_set_n_threads (n_threads, finish_tasks);
+  gimp_parallel_run_async_set_n_threads (MIN (n_async_threads, n_threads),
+                                         finish_tasks);
 }
 
 static void
@@ -278,64 +382,96 @@ gimp_parallel_run_async_set_n_threads (gint     n_threads,
     {
       for (i = gimp_parallel_run_async_n_threads; i < n_threads; i++)
         {
-          GimpParallelRunAsyncThread *thread =
-            &gimp_parallel_run_async_threads[i];
+          GimpParallelRunAsyncLane *lane = &gimp_parallel_run_async_lanes[i];
 
-          thread->quit = FALSE;
+          lane->quit = FALSE;
 
-          thread->thread = g_thread_new (
+          lane->thread = g_thread_new (
             "async",
             (GThreadFunc) gimp_parallel_run_async_thread_func,
-            thread);
+            lane);
         }
+
+      g_mutex_lock (&gimp_parallel_run_async_mutex);
+
+      gimp_parallel_run_async_n_threads = n_threads;
+
+      /* let the new lanes steal queued work */
+      g_cond_broadcast (&gimp_parallel_run_async_cond);
+
+      g_mutex_unlock (&gimp_parallel_run_async_mutex);
     }
   else if (n_threads < gimp_parallel_run_async_n_threads) /* need less threads */
     {
+      gint old_n_threads = gimp_parallel_run_async_n_threads;
+
       g_mutex_lock (&gimp_parallel_run_async_mutex);
 
-      for (i = n_threads; i < gimp_parallel_run_async_n_threads; i++)
+      gimp_parallel_run_async_n_threads = n_threads;
+
+      for (i = n_threads; i < old_n_threads; i++)
         {
-          GimpParallelRunAsyncThread *thread =
-            &gimp_parallel_run_async_threads[i];
+          GimpParallelRunAsyncLane *lane = &gimp_parallel_run_async_lanes[i];
 
-          thread->quit = TRUE;
+          lane->quit = TRUE;
 
-          if (thread->current_async && ! finish_tasks)
-            gimp_cancelable_cancel (GIMP_CANCELABLE (thread->current_async));
+          if (lane->current_async && ! finish_tasks)
+            gimp_cancelable_cancel (GIMP_CANCELABLE (lane->current_async));
         }
 
       g_cond_broadcast (&gimp_parallel_run_async_cond);
 
       g_mutex_unlock (&gimp_parallel_run_async_mutex);
 
-      for (i = n_threads; i < gimp_parallel_run_async_n_threads; i++)
+      for (i = n_threads; i < old_n_threads; i++)
         {
-          GimpParallelRunAsyncThread *thread =
-            &gimp_parallel_run_async_threads[i];
+          GimpParallelRunAsyncLane *lane = &gimp_parallel_run_async_lanes[i];
 
-          g_thread_join (thread->thread);
+          g_thread_join (lane->thread);
         }
-    }
 
-  gimp_parallel_run_async_n_threads = n_threads;
+      if (n_threads > 0)
+        {
+          /* move the remaining tasks of the removed lanes to the
+           * remaining ones
+           */
+          g_mutex_lock (&gimp_parallel_run_async_mutex);
 
-  if (n_threads == 0)
-    {
-      GimpParallelRunAsyncTask *task;
+          for (i = n_threads; i < old_n_threads; i++)
+            {
+              GimpParallelRunAsyncLane *lane = &gimp_parallel_run_async_lanes[i];
+              GimpParallelRunAsyncTask *task;
+
+              while ((task = gimp_parallel_run_async_dequeue_task (lane)))
+                gimp_parallel_run_async_enqueue_task (task, NULL);
+            }
 
-      /* finish remaining tasks */
-      while ((task = gimp_parallel_run_async_dequeue_task ()))
+          g_cond_broadcast (&gimp_parallel_run_async_cond);
+
+          g_mutex_unlock (&gimp_parallel_run_async_mutex);
+        }
+      else
         {
-          if (finish_tasks)
-            while (gimp_parallel_run_async_execute_task (task));
-          else
-            gimp_parallel_run_async_abort_task (task);
+          /* finish remaining tasks */
+          for (i = 0; i < old_n_threads; i++)
+            {
+              GimpParallelRunAsyncLane *lane = &gimp_parallel_run_async_lanes[i];
+              GimpParallelRunAsyncTask *task;
+
+              while ((task = gimp_parallel_run_async_dequeue_task (lane)))
+                {
+                  if (finish_tasks)
+                    while (gimp_parallel_run_async_execute_task (task));
+                  else
+                    gimp_parallel_run_async_abort_task (task);
+                }
+            }
         }
     }
 }
 
 static gpointer
-gimp_parallel_run_async_thread_func (GimpParallelRunAsyncThread *thread)
+gimp_parallel_run_async_thread_func (GimpParallelRunAsyncLane *lane)
 {
   g_mutex_lock (&gimp_parallel_run_async_mutex);
 
@@ -343,12 +479,13 @@ gimp_parallel_run_async_thread_func (GimpParallelRunAsyncThread *thread)
     {
       GimpParallelRunAsyncTask *task;
 
-      while (! thread->quit &&
-             (task = gimp_parallel_run_async_dequeue_task ()))
+      while (! lane->quit &&
+             (task = gimp_parallel_run_async_dequeue_task (lane)))
         {
-          gboolean resume;
+          GimpParallelRunAsyncTask *next_task;
+          gboolean                  resume;
 
-          thread->current_async = GIMP_ASYNC (g_object_ref (task->async));
+          lane->current_async = GIMP_ASYNC (g_object_ref (task->async));
 
           do
             {
@@ -357,21 +494,23 @@ gimp_parallel_run_async_thread_func (GimpParallelRunAsyncThread *thread)
               resume = gimp_parallel_run_async_execute_task (task);
 
               g_mutex_lock (&gimp_parallel_run_async_mutex);
+
+              /* yield to a more urgent task waiting in any lane, not
+               * only in our own, so that it doesn't wait behind a
+               * long-running resumable task.
+               */
+              next_task = gimp_parallel_run_async_peek_task (lane);
             }
           while (resume &&
-                 (g_queue_is_empty (&gimp_parallel_run_async_queue) ||
-                  task->priority <
-                  ((GimpParallelRunAsyncTask *)
-                     g_queue_peek_head (
-                       &gimp_parallel_run_async_queue))->priority));
+                 (! next_task || task->priority < next_task->priority));
 
-          g_clear_object (&thread->current_async);
+          g_clear_object (&lane->current_async);
 
           if (resume)
-            gimp_parallel_run_async_enqueue_task (task);
+            gimp_parallel_run_async_enqueue_task (task, lane);
         }
 
-      if (thread->quit)
+      if (lane->quit)
         break;
 
       g_cond_wait (&gimp_parallel_run_async_cond,
@@ -384,7 +523,8 @@ gimp_parallel_run_async_thread_func (GimpParallelRunAsyncThread *thread)
 }
 
 static void
-gimp_parallel_run_async_enqueue_task (GimpParallelRunAsyncTask *task)
+gimp_parallel_run_async_enqueue_task (GimpParallelRunAsyncTask *task,
+                                      GimpParallelRunAsyncLane *lane)
 {
   GList *link;
   GList *iter;
@@ -396,13 +536,36 @@ gimp_parallel_run_async_enqueue_task (GimpParallelRunAsyncTask *task)
       return;
     }
 
+  if (! lane)
+    {
+      gint i;
+
+      /* assign new tasks to the least-loaded lane */
+      for (i = 0; i < gimp_parallel_run_async_n_threads; i++)
+        {
+          GimpParallelRunAsyncLane *other_lane =
+            &gimp_parallel_run_async_lanes[i];
+
+          if (! lane ||
+              other_lane->queue.length + (other_lane->current_async ? 1 : 0) <
+              lane->queue.length       + (lane->current_async       ? 1 : 0))
+            {
+              lane = other_lane;
+            }
+        }
+    }
+
   link       = g_list_alloc ();
   link->data = task;
 
+  task->lane         = lane;
+  task->link         = link;
+  task->enqueue_time = g_get_monotonic_time ();
+
   g_object_set_data (G_OBJECT (task->async),
-                     "gimp-parallel-run-async-link", link);
+                     "gimp-parallel-run-async-task", task);
 
-  for (iter = g_queue_peek_tail_link (&gimp_parallel_run_async_queue);
+  for (iter = g_queue_peek_tail_link (&lane->queue);
        iter;
        iter = g_list_previous (iter))
     {
@@ -423,28 +586,81 @@ gimp_parallel_run_async_enqueue_task (GimpParallelRunAsyncTask *task)
       if (link->next)
         link->next->prev = link;
       else
-        gimp_parallel_run_async_queue.tail = link;
+        lane->queue.tail = link;
 
-      gimp_parallel_run_async_queue.length++;
+      lane->queue.length++;
     }
   else
     {
-      g_queue_push_head_link (&gimp_parallel_run_async_queue, link);
+      g_queue_push_head_link (&lane->queue, link);
+    }
+}
+
+/* returns the task 'lane' should run next:  the head of its own queue,
+ * unless a more urgent task is waiting in another lane whose thread is
+ * busy, in which case it is stolen.  if 'lane''s queue is empty, the
+ * highest-priority task waiting in any other lane is stolen.
+ */
+static GimpParallelRunAsyncTask *
+gimp_parallel_run_async_peek_task (GimpParallelRunAsyncLane *lane)
+{
+  GimpParallelRunAsyncTask *own_task;
+  GimpParallelRunAsyncTask *task;
+  gint                      i;
+
+  own_task = (GimpParallelRunAsyncTask *) g_queue_peek_head (&lane->queue);
+  task     = own_task;
+
+  for (i = 0; i < GIMP_PARALLEL_RUN_ASYNC_MAX_THREADS; i++)
+    {
+      GimpParallelRunAsyncLane *other_lane = &gimp_parallel_run_async_lanes[i];
+      GimpParallelRunAsyncTask *other_task;
+
+      if (other_lane == lane)
+        continue;
+
+      /* an idle lane runs the head of its own queue by itself */
+      if (own_task && ! other_lane->current_async)
+        continue;
+
+      other_task =
+        (GimpParallelRunAsyncTask *) g_queue_peek_head (&other_lane->queue);
+
+      if (other_task && (! task || other_task->priority < task->priority))
+        task = other_task;
     }
+
+  return task;
 }
 
 static GimpParallelRunAsyncTask *
-gimp_parallel_run_async_dequeue_task (void)
+gimp_parallel_run_async_dequeue_task (GimpParallelRunAsyncLane *lane)
 {
   GimpParallelRunAsyncTask *task;
 
-  task = (GimpParallelRunAsyncTask *) g_queue_pop_head (
-                                        &gimp_parallel_run_async_queue);
+  if (lane->quit)
+    task = (GimpParallelRunAsyncTask *) g_queue_peek_head (&lane->queue);
+  else
+    task = gimp_parallel_run_async_peek_task (lane);
 
   if (task)
     {
+      GimpParallelRunAsyncLane *task_lane = task->lane;
+      gdouble                   wait_time;
+
+      g_queue_delete_link (&task_lane->queue, task->link);
+
+      task->lane = NULL;
+      task->link = NULL;
+
       g_object_set_data (G_OBJECT (task->async),
-                         "gimp-parallel-run-async-link", NULL);
+                         "gimp-parallel-run-async-task", NULL);
+
+      wait_time = (g_get_monotonic_time () - task->enqueue_time) /
+                  (gdouble) G_TIME_SPAN_SECOND;
+
+      task_lane->wait_time += wait_time;
+      task_lane->n_dequeued++;
     }
 
   return task;
@@ -490,28 +706,28 @@ gimp_parallel_run_async_abort_task (GimpParallelRunAsyncTask *task)
 static void
 gimp_parallel_run_async_cancel (GimpAsync *async)
 {
-  GList                    *link;
-  GimpParallelRunAsyncTask *task = NULL;
+  GimpParallelRunAsyncTask *task;
 
-  link = (GList *) g_object_get_data (G_OBJECT (async),
-                                      "gimp-parallel-run-async-link");
+  task = (GimpParallelRunAsyncTask *) g_object_get_data (
+    G_OBJECT (async), "gimp-parallel-run-async-task");
 
-  if (! link)
+  if (! task)
     return;
 
   g_mutex_lock (&gimp_parallel_run_async_mutex);
 
-  link = (GList *) g_object_get_data (G_OBJECT (async),
-                                      "gimp-parallel-run-async-link");
+  task = (GimpParallelRunAsyncTask *) g_object_get_data (
+    G_OBJECT (async), "gimp-parallel-run-async-task");
 
-  if (link)
+  if (task)
     {
       g_object_set_data (G_OBJECT (async),
-                         "gimp-parallel-run-async-link", NULL);
+                         "gimp-parallel-run-async-task", NULL);
 
-      task = (GimpParallelRunAsyncTask *) link->data;
+      g_queue_delete_link (&task->lane->queue, task->link);
 
-      g_queue_delete_link (&gimp_parallel_run_async_queue, link);
+      task->lane = NULL;
+      task->link = NULL;
     }
 
   g_mutex_unlock (&gimp_parallel_run_async_mutex);
@@ -523,27 +739,30 @@ gimp_parallel_run_async_cancel (GimpAsync *async)
 static void
 gimp_parallel_run_async_waiting (GimpAsync *async)
 {
-  GList *link;
+  GimpParallelRunAsyncTask *task;
 
-  link = (GList *) g_object_get_data (G_OBJECT (async),
-                                      "gimp-parallel-run-async-link");
+  task = (GimpParallelRunAsyncTask *) g_object_get_data (
+    G_OBJECT (async), "gimp-parallel-run-async-task");
 
-  if (! link)
+  if (! task)
     return;
 
   g_mutex_lock (&gimp_parallel_run_async_mutex);
 
-  link = (GList *) g_object_get_data (G_OBJECT (async),
-                                      "gimp-parallel-run-async-link");
+  task = (GimpParallelRunAsyncTask *) g_object_get_data (
+    G_OBJECT (async), "gimp-parallel-run-async-task");
 
-  if (link)
+  if (task)
     {
-      GimpParallelRunAsyncTask *task = (GimpParallelRunAsyncTask *) link->data;
-
+      /* the task is now the most urgent one; any idle lane will pick it
+       * up, by stealing it if necessary.
+       */
       task->priority = G_MININT;
 
-      g_queue_unlink         (&gimp_parallel_run_async_queue, link);
-      g_queue_push_head_link (&gimp_parallel_run_async_queue, link);
+      g_queue_unlink         (&task->lane->queue, task->link);
+      g_queue_push_head_link (&task->lane->queue, task->link);
+
+      g_cond_broadcast (&gimp_parallel_run_async_cond);
     }
 
   g_mutex_unlock (&gimp_parallel_run_async_mutex);
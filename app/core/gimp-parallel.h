@@ -21,6 +21,9 @@
 #pragma once
 
 
+#define GIMP_PARALLEL_RUN_ASYNC_MAX_THREADS 16
+
+
 void        gimp_parallel_init                       (Gimp             *gimp);
 void        gimp_parallel_exit                       (Gimp             *gimp);
 
@@ -36,6 +39,14 @@ GimpAsync * gimp_parallel_run_async_independent_full (gint              priority
                                                       GimpRunAsyncFunc  func,
                                                       gpointer          user_data);
 
+gint        gimp_parallel_run_async_get_n_lanes      (void);
+void        gimp_parallel_run_async_get_lane_stats   (gint              lane,
+                                                      gint             *queue_depth,
+                                                      gdouble          *wait_time,
+                                                      gint             *n_dequeued);
+gint        gimp_parallel_run_async_get_n_queued     (void);
+gdouble     gimp_parallel_run_async_get_wait_time    (void);
+
 
 #ifdef __cplusplus
 
@@ -24,51 +24,99 @@
 #include <gegl.h>
 
 #include "libgimpbase/gimpbase.h"
+#include "libgimpmath/gimpmath.h"
 
 #include "core-types.h"
 
+#include "gimp-memsize.h"
 #include "gimpbrushcache.h"
 
 #include "gimp-log.h"
 #include "gimp-intl.h"
 
 
-#define MAX_CACHED_DATA 20
+/*  the cache is bounded by the memory its data takes, and, since the
+ *  data can be tiny, by its number of units
+ */
+#define MAX_CACHED_MEMSIZE (32 * 1024 * 1024)
+#define MAX_CACHED_DATA    1024
+
+/*  the most recently used units are never evicted, since their data may
+ *  still be in use by the caller
+ */
+#define MIN_CACHED_DATA    2
+
+/*  the transform parameters are quantized, so that transforms which move
+ *  the brush outline by at most this many pixels share a unit
+ */
+#define KEY_PRECISION      0.25
+#define KEY_HARDNESS_STEPS 256
 
 
 enum
 {
   PROP_0,
-  PROP_DATA_DESTROY
+  PROP_DATA_DESTROY,
+  PROP_DATA_MEMSIZE
 };
 
 
+typedef struct _GimpBrushCacheKey  GimpBrushCacheKey;
 typedef struct _GimpBrushCacheUnit GimpBrushCacheUnit;
 
-struct _GimpBrushCacheUnit
+struct _GimpBrushCacheKey
 {
-  gpointer data;
-
   gint     width;
   gint     height;
-  gdouble  scale;
-  gdouble  aspect_ratio;
-  gdouble  angle;
+  gint64   scale;
+  gint64   aspect_ratio;
+  gint64   angle;
   gboolean reflect;
-  gdouble  hardness;
+  gint     hardness;
+};
+
+struct _GimpBrushCacheUnit
+{
+  /*  the hash table is a set of keys; being the first member, a unit's
+   *  key doubles as a pointer to the unit
+   */
+  GimpBrushCacheKey  key;
+
+  gpointer           data;
+  gsize              memsize;
+
+  GList              link;
 };
 
 
-static void   gimp_brush_cache_constructed  (GObject      *object);
-static void   gimp_brush_cache_finalize     (GObject      *object);
-static void   gimp_brush_cache_set_property (GObject      *object,
-                                             guint         property_id,
-                                             const GValue *value,
-                                             GParamSpec   *pspec);
-static void   gimp_brush_cache_get_property (GObject      *object,
-                                             guint         property_id,
-                                             GValue       *value,
-                                             GParamSpec   *pspec);
+static void     gimp_brush_cache_constructed  (GObject                 *object);
+static void     gimp_brush_cache_finalize     (GObject                 *object);
+static void     gimp_brush_cache_set_property (GObject                 *object,
+                                               guint                    property_id,
+                                               const GValue            *value,
+                                               GParamSpec              *pspec);
+static void     gimp_brush_cache_get_property (GObject                 *object,
+                                               guint                    property_id,
+                                               GValue                  *value,
+                                               GParamSpec              *pspec);
+
+static gint64   gimp_brush_cache_get_memsize  (GimpObject              *object,
+                                               gint64                  *gui_size);
+
+static void     gimp_brush_cache_key_init     (GimpBrushCacheKey       *key,
+                                               gint                     width,
+                                               gint                     height,
+                                               gdouble                  scale,
+                                               gdouble                  aspect_ratio,
+                                               gdouble                  angle,
+                                               gboolean                 reflect,
+                                               gdouble                  hardness);
+static guint    gimp_brush_cache_key_hash     (const GimpBrushCacheKey *key);
+static gboolean gimp_brush_cache_key_equal    (const GimpBrushCacheKey *key1,
+                                               const GimpBrushCacheKey *key2);
+
+static void     gimp_brush_cache_remove_unit  (GimpBrushCache          *cache,
+                                               GimpBrushCacheUnit      *unit);
 
 
 G_DEFINE_TYPE (GimpBrushCache, gimp_brush_cache, GIMP_TYPE_OBJECT)
@@ -76,26 +124,44 @@ G_DEFINE_TYPE (GimpBrushCache, gimp_brush_cache, GIMP_TYPE_OBJECT)
 #define parent_class gimp_brush_cache_parent_class
 
 
+static guintptr gimp_brush_cache_total_memsize = 0;
+static gint     gimp_brush_cache_n_hits        = 0;
+static gint     gimp_brush_cache_n_misses      = 0;
+
+
 static void
 gimp_brush_cache_class_init (GimpBrushCacheClass *klass)
 {
-  GObjectClass  *object_class = G_OBJECT_CLASS (klass);
+  GObjectClass    *object_class      = G_OBJECT_CLASS (klass);
+  GimpObjectClass *gimp_object_class = GIMP_OBJECT_CLASS (klass);
+
+  object_class->constructed      = gimp_brush_cache_constructed;
+  object_class->finalize         = gimp_brush_cache_finalize;
+  object_class->set_property     = gimp_brush_cache_set_property;
+  object_class->get_property     = gimp_brush_cache_get_property;
 
-  object_class->constructed  = gimp_brush_cache_constructed;
-  object_class->finalize     = gimp_brush_cache_finalize;
-  object_class->set_property = gimp_brush_cache_set_property;
-  object_class->get_property = gimp_brush_cache_get_property;
+  gimp_object_class->get_memsize = gimp_brush_cache_get_memsize;
 
   g_object_class_install_property (object_class, PROP_DATA_DESTROY,
                                    g_param_spec_pointer ("data-destroy",
                                                          NULL, NULL,
                                                          GIMP_PARAM_READWRITE |
                                                          G_PARAM_CONSTRUCT_ONLY));
+
+  g_object_class_install_property (object_class, PROP_DATA_MEMSIZE,
+                                   g_param_spec_pointer ("data-memsize",
+                                                         NULL, NULL,
+                                                         GIMP_PARAM_READWRITE |
+                                                         G_PARAM_CONSTRUCT_ONLY));
 }
 
 static void
-gimp_brush_cache_init (GimpBrushCache *brush)
+gimp_brush_cache_init (GimpBrushCache *cache)
 {
+  cache->units = g_hash_table_new ((GHashFunc) gimp_brush_cache_key_hash,
+                                   (GEqualFunc) gimp_brush_cache_key_equal);
+
+  g_queue_init (&cache->lru);
 }
 
 static void
@@ -106,6 +172,7 @@ gimp_brush_cache_constructed (GObject *object)
   G_OBJECT_CLASS (parent_class)->constructed (object);
 
   gimp_assert (cache->data_destroy != NULL);
+  gimp_assert (cache->data_memsize != NULL);
 }
 
 static void
@@ -115,6 +182,8 @@ gimp_brush_cache_finalize (GObject *object)
 
   gimp_brush_cache_clear (cache);
 
+  g_clear_pointer (&cache->units, g_hash_table_unref);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -132,6 +201,10 @@ gimp_brush_cache_set_property (GObject      *object,
       cache->data_destroy = g_value_get_pointer (value);
       break;
 
+    case PROP_DATA_MEMSIZE:
+      cache->data_memsize = g_value_get_pointer (value);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -152,26 +225,48 @@ gimp_brush_cache_get_property (GObject    *object,
       g_value_set_pointer (value, cache->data_destroy);
       break;
 
+    case PROP_DATA_MEMSIZE:
+      g_value_set_pointer (value, cache->data_memsize);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
     }
 }
 
+static gint64
+gimp_brush_cache_get_memsize (GimpObject *object,
+                              gint64     *gui_size)
+{
+  GimpBrushCache *cache   = GIMP_BRUSH_CACHE (object);
+  gint64          memsize = 0;
+
+  memsize += gimp_g_hash_table_get_memsize (cache->units,
+                                            sizeof (GimpBrushCacheUnit));
+  memsize += cache->memsize;
+
+  return memsize + GIMP_OBJECT_CLASS (parent_class)->get_memsize (object,
+                                                                  gui_size);
+}
+
 
 /*  public functions  */
 
 GimpBrushCache *
-gimp_brush_cache_new (GDestroyNotify  data_destroy,
-                      gchar           debug_hit,
-                      gchar           debug_miss)
+gimp_brush_cache_new (GDestroyNotify            data_destroy,
+                      GimpBrushCacheMemsizeFunc data_memsize,
+                      gchar                     debug_hit,
+                      gchar                     debug_miss)
 {
   GimpBrushCache *cache;
 
   g_return_val_if_fail (data_destroy != NULL, NULL);
+  g_return_val_if_fail (data_memsize != NULL, NULL);
 
   cache =  g_object_new (GIMP_TYPE_BRUSH_CACHE,
                          "data-destroy", data_destroy,
+                         "data-memsize", data_memsize,
                          NULL);
 
   cache->debug_hit  = debug_hit;
@@ -185,20 +280,8 @@ gimp_brush_cache_clear (GimpBrushCache *cache)
 {
   g_return_if_fail (GIMP_IS_BRUSH_CACHE (cache));
 
-  if (cache->cached_units)
-    {
-      GList *iter;
-
-      for (iter = cache->cached_units; iter; iter = g_list_next (iter))
-        {
-          GimpBrushCacheUnit *unit = iter->data;
-
-          cache->data_destroy (unit->data);
-        }
-
-      g_list_free_full (cache->cached_units, g_free);
-      cache->cached_units = NULL;
-    }
+  while (! g_queue_is_empty (&cache->lru))
+    gimp_brush_cache_remove_unit (cache, cache->lru.tail->data);
 }
 
 gconstpointer
@@ -211,37 +294,33 @@ gimp_brush_cache_get (GimpBrushCache *cache,
                       gboolean        reflect,
                       gdouble         hardness)
 {
-  GList *iter;
+  GimpBrushCacheKey   key;
+  GimpBrushCacheUnit *unit;
 
   g_return_val_if_fail (GIMP_IS_BRUSH_CACHE (cache), NULL);
 
-  for (iter = cache->cached_units; iter; iter = g_list_next (iter))
+  gimp_brush_cache_key_init (&key,
+                             width, height,
+                             scale, aspect_ratio, angle, reflect, hardness);
+
+  unit = g_hash_table_lookup (cache->units, &key);
+
+  if (unit)
     {
-      GimpBrushCacheUnit *unit = iter->data;
-
-      if (unit->data                         &&
-          unit->width        == width        &&
-          unit->height       == height       &&
-          unit->scale        == scale        &&
-          unit->aspect_ratio == aspect_ratio &&
-          unit->angle        == angle        &&
-          unit->reflect      == reflect      &&
-          unit->hardness     == hardness)
-        {
-          if (gimp_log_flags & GIMP_LOG_BRUSH_CACHE)
-            g_printerr ("%c", cache->debug_hit);
+      g_atomic_int_inc (&gimp_brush_cache_n_hits);
 
-          /* Make the returned cached brush first in the list. */
-          cache->cached_units = g_list_remove_link (cache->cached_units, iter);
-          iter->next = cache->cached_units;
-          if (cache->cached_units)
-            cache->cached_units->prev = iter;
-          cache->cached_units = iter;
+      if (gimp_log_flags & GIMP_LOG_BRUSH_CACHE)
+        g_printerr ("%c", cache->debug_hit);
 
-          return (gconstpointer) unit->data;
-        }
+      /* Make the returned cached brush the most recently used one. */
+      g_queue_unlink (&cache->lru, &unit->link);
+      g_queue_push_head_link (&cache->lru, &unit->link);
+
+      return (gconstpointer) unit->data;
     }
 
+  g_atomic_int_inc (&gimp_brush_cache_n_misses);
+
   if (gimp_log_flags & GIMP_LOG_BRUSH_CACHE)
     g_printerr ("%c", cache->debug_miss);
 
@@ -259,44 +338,164 @@ gimp_brush_cache_add (GimpBrushCache *cache,
                       gboolean        reflect,
                       gdouble         hardness)
 {
-  GList              *iter;
   GimpBrushCacheUnit *unit;
-  GList              *last   = NULL;
-  gint                length = 0;
+  GimpBrushCacheUnit *old_unit;
 
   g_return_if_fail (GIMP_IS_BRUSH_CACHE (cache));
   g_return_if_fail (data != NULL);
 
-  for (iter = cache->cached_units; iter; iter = g_list_next (iter))
+  unit = g_slice_new0 (GimpBrushCacheUnit);
+
+  gimp_brush_cache_key_init (&unit->key,
+                             width, height,
+                             scale, aspect_ratio, angle, reflect, hardness);
+
+  old_unit = g_hash_table_lookup (cache->units, &unit->key);
+
+  if (old_unit)
     {
-      unit = iter->data;
+      if (old_unit->data == data)
+        {
+          g_slice_free (GimpBrushCacheUnit, unit);
 
-      if (data == unit->data)
-        return;
+          return;
+        }
 
-      length++;
-      last = iter;
+      /* The caller keeps using the data it passed, so replace the
+       * existing entry, rather than dropping the new data.
+       */
+      gimp_brush_cache_remove_unit (cache, old_unit);
     }
 
-  if (length > MAX_CACHED_DATA)
+  unit->data      = data;
+  unit->memsize   = cache->data_memsize (data);
+  unit->link.data = unit;
+
+  g_hash_table_add (cache->units, &unit->key);
+  g_queue_push_head_link (&cache->lru, &unit->link);
+
+  cache->memsize += unit->memsize;
+
+  g_atomic_pointer_add (&gimp_brush_cache_total_memsize, unit->memsize);
+
+  while (cache->lru.length > MIN_CACHED_DATA              &&
+         (cache->lru.length > MAX_CACHED_DATA ||
+          cache->memsize    > MAX_CACHED_MEMSIZE))
     {
-      unit = last->data;
+      gimp_brush_cache_remove_unit (cache, cache->lru.tail->data);
+    }
+}
+
 
-      cache->data_destroy (unit->data);
-      cache->cached_units = g_list_delete_link (cache->cached_units, last);
-      g_free (unit);
+/*  public functions (stats)  */
+
+guint64
+gimp_brush_cache_get_total_memsize (void)
+{
+  return gimp_brush_cache_total_memsize;
+}
+
+gdouble
+gimp_brush_cache_get_hit_ratio (void)
+{
+  static guint   last_n_hits   = 0;
+  static guint   last_n_misses = 0;
+  static gdouble hit_ratio     = 0.0;
+  guint          n_hits;
+  guint          n_misses;
+
+  /*  the ratio of the lookups since the last call  */
+  n_hits   = g_atomic_int_get (&gimp_brush_cache_n_hits)   - last_n_hits;
+  n_misses = g_atomic_int_get (&gimp_brush_cache_n_misses) - last_n_misses;
+
+  if (n_hits + n_misses > 0)
+    {
+      hit_ratio = (gdouble) n_hits / (n_hits + n_misses);
+
+      last_n_hits   += n_hits;
+      last_n_misses += n_misses;
     }
 
-  unit = g_new0 (GimpBrushCacheUnit, 1);
+  return hit_ratio;
+}
+
+
+/*  private functions  */
+
+static void
+gimp_brush_cache_key_init (GimpBrushCacheKey *key,
+                           gint               width,
+                           gint               height,
+                           gdouble            scale,
+                           gdouble            aspect_ratio,
+                           gdouble            angle,
+                           gboolean           reflect,
+                           gdouble            hardness)
+{
+  gdouble radius = MAX (MAX (width, height) / 2.0, 1.0);
+  gdouble step   = KEY_PRECISION / radius;
+  gint64  n_angles;
+
+  key->width  = width;
+  key->height = height;
+
+  /*  the outline moves proportionally to the scale, and to the aspect
+   *  ratio's effect on it, see gimp_brush_transform_get_scale()
+   */
+  key->scale        = floor (log (scale) / step + 0.5);
+  key->aspect_ratio = floor (aspect_ratio / (20.0 * step) + 0.5);
+
+  /*  the angle is in turns, and wraps around  */
+  n_angles   = ceil (2.0 * G_PI / step);
+  key->angle = (gint64) floor ((angle - floor (angle)) * n_angles + 0.5) %
+               n_angles;
+
+  key->reflect  = reflect ? TRUE : FALSE;
+  key->hardness = floor (hardness * KEY_HARDNESS_STEPS + 0.5);
+}
+
+static guint
+gimp_brush_cache_key_hash (const GimpBrushCacheKey *key)
+{
+  guint hash;
+
+  hash = key->width;
+  hash = 31 * hash + key->height;
+  hash = 31 * hash + (guint) (key->scale        ^ (key->scale        >> 32));
+  hash = 31 * hash + (guint) (key->aspect_ratio ^ (key->aspect_ratio >> 32));
+  hash = 31 * hash + (guint) (key->angle        ^ (key->angle        >> 32));
+  hash = 31 * hash + key->reflect;
+  hash = 31 * hash + key->hardness;
+
+  return hash;
+}
+
+static gboolean
+gimp_brush_cache_key_equal (const GimpBrushCacheKey *key1,
+                            const GimpBrushCacheKey *key2)
+{
+  return key1->width        == key2->width        &&
+         key1->height       == key2->height       &&
+         key1->scale        == key2->scale        &&
+         key1->aspect_ratio == key2->aspect_ratio &&
+         key1->angle        == key2->angle        &&
+         key1->reflect      == key2->reflect      &&
+         key1->hardness     == key2->hardness;
+}
+
+static void
+gimp_brush_cache_remove_unit (GimpBrushCache     *cache,
+                              GimpBrushCacheUnit *unit)
+{
+  g_hash_table_remove (cache->units, &unit->key);
+  g_queue_unlink (&cache->lru, &unit->link);
+
+  cache->memsize -= unit->memsize;
+
+  g_atomic_pointer_add (&gimp_brush_cache_total_memsize,
+                        -(gssize) unit->memsize);
 
-  unit->data         = data;
-  unit->width        = width;
-  unit->height       = height;
-  unit->scale        = scale;
-  unit->aspect_ratio = aspect_ratio;
-  unit->angle        = angle;
-  unit->reflect      = reflect;
-  unit->hardness     = hardness;
+  cache->data_destroy (unit->data);
 
-  cache->cached_units = g_list_prepend (cache->cached_units, unit);
+  g_slice_free (GimpBrushCacheUnit, unit);
 }
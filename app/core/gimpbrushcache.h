@@ -31,18 +31,24 @@
 #define GIMP_BRUSH_CACHE_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), GIMP_TYPE_BRUSH_CACHE, GimpBrushCacheClass))
 
 
+typedef gsize (* GimpBrushCacheMemsizeFunc) (gconstpointer data);
+
+
 typedef struct _GimpBrushCacheClass GimpBrushCacheClass;
 
 struct _GimpBrushCache
 {
-  GimpObject      parent_instance;
+  GimpObject                 parent_instance;
 
-  GDestroyNotify  data_destroy;
+  GDestroyNotify             data_destroy;
+  GimpBrushCacheMemsizeFunc  data_memsize;
 
-  GList          *cached_units;
+  GHashTable                *units;
+  GQueue                     lru;
+  gsize                      memsize;
 
-  gchar           debug_hit;
-  gchar           debug_miss;
+  gchar                      debug_hit;
+  gchar                      debug_miss;
 };
 
 struct _GimpBrushCacheClass
@@ -53,9 +59,10 @@ struct _GimpBrushCacheClass
 
 GType            gimp_brush_cache_get_type (void);
 
-GimpBrushCache * gimp_brush_cache_new      (GDestroyNotify  data_destory,
-                                            gchar           debug_hit,
-                                            gchar           debug_miss);
+GimpBrushCache * gimp_brush_cache_new      (GDestroyNotify             data_destroy,
+                                            GimpBrushCacheMemsizeFunc  data_memsize,
+                                            gchar                      debug_hit,
+                                            gchar                      debug_miss);
 
 void             gimp_brush_cache_clear    (GimpBrushCache *cache);
 
@@ -76,3 +83,9 @@ void             gimp_brush_cache_add      (GimpBrushCache *cache,
                                             gdouble         angle,
                                             gboolean        reflect,
                                             gdouble         hardness);
+
+
+/*  stats  */
+
+guint64          gimp_brush_cache_get_total_memsize (void);
+gdouble          gimp_brush_cache_get_hit_ratio     (void);
@@ -38,6 +38,25 @@
 
 #define OVERSAMPLING 4
 
+#define PIXELS_PER_THREAD \
+  (/* each thread costs as much as */ 64.0 * 64.0 /* pixels */)
+
+
+typedef struct
+{
+  GimpBrushGeneratedShape  shape;
+  gfloat                   radius;
+  gint                     spikes;
+  gfloat                   aspect_ratio;
+  gdouble                  c, s;
+  gdouble                  cs, ss;
+  gint                     width;
+  gint                     half_width;
+  gint                     first_row;
+  const gfloat            *lookup;
+  gfloat                  *centerp;
+} CalcData;
+
 
 enum
 {
@@ -81,6 +100,9 @@ static GimpTempBuf * gimp_brush_generated_transform_mask(GimpBrush    *gbrush,
                                                          gboolean      reflect,
                                                          gdouble       hardness);
 
+static void          gimp_brush_generated_calc_rows     (gsize                    offset,
+                                                         gsize                    size,
+                                                         CalcData                *data);
 static GimpTempBuf * gimp_brush_generated_calc          (GimpBrushGenerated      *brush,
                                                          GimpBrushGeneratedShape  shape,
                                                          gfloat                   radius,
@@ -462,6 +484,70 @@ gimp_brush_generated_calc_lut (gdouble radius,
   return lookup;
 }
 
+static void
+gimp_brush_generated_calc_rows (gsize     offset,
+                                gsize     size,
+                                CalcData *data)
+{
+  const gint  spikes  = data->spikes;
+  const gint  width   = data->width;
+  gfloat     *centerp = data->centerp;
+  gint        x, y;
+
+  for (y = data->first_row + (gint) offset;
+       y < data->first_row + (gint) (offset + size);
+       y++)
+    {
+      for (x = -data->half_width; x <= data->half_width; x++)
+        {
+          gdouble d  = 0;
+          gdouble tx = data->c * x - data->s * y;
+          gdouble ty = fabs (data->s * x + data->c * y);
+          gfloat  a;
+
+          if (spikes > 2)
+            {
+              gdouble angle = atan2 (ty, tx);
+
+              while (angle > G_PI / spikes)
+                {
+                  gdouble sx = tx;
+                  gdouble sy = ty;
+
+                  tx = data->cs * sx - data->ss * sy;
+                  ty = data->ss * sx + data->cs * sy;
+
+                  angle -= 2 * G_PI / spikes;
+                }
+            }
+          ty *= data->aspect_ratio;
+
+          switch (data->shape)
+            {
+            case GIMP_BRUSH_GENERATED_CIRCLE:
+              d = sqrt (SQR (tx) + SQR (ty));
+              break;
+            case GIMP_BRUSH_GENERATED_SQUARE:
+              d = MAX (fabs (tx), fabs (ty));
+              break;
+            case GIMP_BRUSH_GENERATED_DIAMOND:
+              d = fabs (tx) + fabs (ty);
+              break;
+            }
+
+          if (d < data->radius + 1)
+            a = data->lookup[(gint) RINT (d * OVERSAMPLING)];
+          else
+            a = 0.0f;
+
+          centerp[y * width + x] = a;
+
+          if (spikes % 2 == 0)
+            centerp[-1 * y * width - x] = a;
+        }
+    }
+}
+
 static GimpTempBuf *
 gimp_brush_generated_calc (GimpBrushGenerated      *brush,
                            GimpBrushGeneratedShape  shape,
@@ -474,11 +560,10 @@ gimp_brush_generated_calc (GimpBrushGenerated      *brush,
                            GimpVector2             *xaxis,
                            GimpVector2             *yaxis)
 {
+  CalcData     data;
   gfloat      *centerp;
   gfloat      *lookup;
-  gfloat       a;
-  gint         x, y;
-  gdouble      c, s, cs, ss;
+  gdouble      c, s;
   GimpVector2  x_axis;
   GimpVector2  y_axis;
   GimpTempBuf *mask;
@@ -509,60 +594,27 @@ gimp_brush_generated_calc (GimpBrushGenerated      *brush,
 
   lookup = gimp_brush_generated_calc_lut (radius, hardness);
 
-  cs = cos (- 2 * G_PI / spikes);
-  ss = sin (- 2 * G_PI / spikes);
+  data.shape        = shape;
+  data.radius       = radius;
+  data.spikes       = spikes;
+  data.aspect_ratio = aspect_ratio;
+  data.c            = c;
+  data.s            = s;
+  data.cs           = cos (- 2 * G_PI / spikes);
+  data.ss           = sin (- 2 * G_PI / spikes);
+  data.width        = width;
+  data.half_width   = half_width;
+  data.lookup       = lookup;
+  data.centerp      = centerp;
 
   /* for an even number of spikes compute one half and mirror it */
-  for (y = ((spikes % 2) ? -half_height : 0); y <= half_height; y++)
-    {
-      for (x = -half_width; x <= half_width; x++)
-        {
-          gdouble d  = 0;
-          gdouble tx = c * x - s * y;
-          gdouble ty = fabs (s * x + c * y);
-
-          if (spikes > 2)
-            {
-              gdouble angle = atan2 (ty, tx);
-
-              while (angle > G_PI / spikes)
-                {
-                  gdouble sx = tx;
-                  gdouble sy = ty;
-
-                  tx = cs * sx - ss * sy;
-                  ty = ss * sx + cs * sy;
-
-                  angle -= 2 * G_PI / spikes;
-                }
-            }
-
-          ty *= aspect_ratio;
+  data.first_row = (spikes % 2) ? -half_height : 0;
 
-          switch (shape)
-            {
-            case GIMP_BRUSH_GENERATED_CIRCLE:
-              d = sqrt (SQR (tx) + SQR (ty));
-              break;
-            case GIMP_BRUSH_GENERATED_SQUARE:
-              d = MAX (fabs (tx), fabs (ty));
-              break;
-            case GIMP_BRUSH_GENERATED_DIAMOND:
-              d = fabs (tx) + fabs (ty);
-              break;
-            }
-
-          if (d < radius + 1)
-            a = lookup[(gint) RINT (d * OVERSAMPLING)];
-          else
-            a = 0.0f;
-
-          centerp[y * width + x] = a;
-
-          if (spikes % 2 == 0)
-            centerp[-1 * y * width - x] = a;
-        }
-    }
+  gegl_parallel_distribute_range (
+    half_height - data.first_row + 1,
+    PIXELS_PER_THREAD / width,
+    (GeglParallelDistributeRangeFunc) gimp_brush_generated_calc_rows,
+    &data);
 
   gegl_scratch_free (lookup);
 
@@ -164,6 +164,12 @@ gimp_drawable_remove_filter (GimpDrawable *drawable,
   g_return_if_fail (GIMP_IS_FILTER (filter));
   g_return_if_fail (gimp_drawable_has_filter (drawable, filter) == TRUE);
 
+  if (GIMP_IS_DRAWABLE_FILTER (filter))
+    {
+      gimp_drawable_filter_set_chain   (GIMP_DRAWABLE_FILTER (filter), NULL);
+      gimp_drawable_filter_set_chained (GIMP_DRAWABLE_FILTER (filter), FALSE);
+    }
+
   gimp_container_remove (drawable->private->filter_stack,
                          GIMP_OBJECT (filter));
 
@@ -173,8 +179,21 @@ gimp_drawable_remove_filter (GimpDrawable *drawable,
 void
 gimp_drawable_clear_filters (GimpDrawable *drawable)
 {
+  GList *list;
+
   g_return_if_fail (GIMP_IS_DRAWABLE (drawable));
 
+  for (list = GIMP_LIST (drawable->private->filter_stack)->queue->head;
+       list;
+       list = g_list_next (list))
+    {
+      if (GIMP_IS_DRAWABLE_FILTER (list->data))
+        {
+          gimp_drawable_filter_set_chain   (list->data, NULL);
+          gimp_drawable_filter_set_chained (list->data, FALSE);
+        }
+    }
+
   gimp_container_clear (drawable->private->filter_stack);
 
   gimp_drawable_filters_changed (drawable);
@@ -270,6 +289,90 @@ gimp_drawable_lower_filter (GimpDrawable *drawable,
   return FALSE;
 }
 
+/*  combines each run of adjacent filters which can be chained (see
+ *  gimp_drawable_filter_can_chain()) into the first filter of the run,
+ *  which then applies the whole run in a single pass, and bypasses the
+ *  other filters of the run.
+ */
+void
+gimp_drawable_chain_filters (GimpDrawable *drawable)
+{
+  GHashTable         *chains;
+  GHashTable         *chained;
+  GimpDrawableFilter *head  = NULL;
+  GList              *chain = NULL;
+  GList              *list;
+
+  g_return_if_fail (GIMP_IS_DRAWABLE (drawable));
+
+  chains  = g_hash_table_new_full (NULL, NULL,
+                                   NULL, (GDestroyNotify) g_list_free);
+  chained = g_hash_table_new (NULL, NULL);
+
+  /*  filters are applied from the bottom of the stack up  */
+  for (list = GIMP_LIST (drawable->private->filter_stack)->queue->tail;
+       list;
+       list = g_list_previous (list))
+    {
+      GimpFilter *filter = list->data;
+
+      /*  inactive filters are not part of the graph, and filters whose
+       *  preview is disabled pass their input through
+       */
+      if (! gimp_filter_get_active (filter) ||
+          (GIMP_IS_DRAWABLE_FILTER (filter) &&
+           ! gimp_drawable_filter_get_preview (GIMP_DRAWABLE_FILTER (filter))))
+        {
+          continue;
+        }
+
+      if (head &&
+          GIMP_IS_DRAWABLE_FILTER (filter) &&
+          gimp_drawable_filter_can_chain (GIMP_DRAWABLE_FILTER (filter), head))
+        {
+          chain = g_list_prepend (chain, filter);
+
+          g_hash_table_add (chained, filter);
+        }
+      else
+        {
+          if (chain)
+            g_hash_table_insert (chains, head, g_list_reverse (chain));
+
+          head  = NULL;
+          chain = NULL;
+
+          if (GIMP_IS_DRAWABLE_FILTER (filter) &&
+              gimp_drawable_filter_can_chain (GIMP_DRAWABLE_FILTER (filter),
+                                              NULL))
+            {
+              head = GIMP_DRAWABLE_FILTER (filter);
+            }
+        }
+    }
+
+  if (chain)
+    g_hash_table_insert (chains, head, g_list_reverse (chain));
+
+  for (list = GIMP_LIST (drawable->private->filter_stack)->queue->head;
+       list;
+       list = g_list_next (list))
+    {
+      if (GIMP_IS_DRAWABLE_FILTER (list->data))
+        {
+          GimpDrawableFilter *filter = list->data;
+
+          gimp_drawable_filter_set_chain   (filter,
+                                            g_hash_table_lookup (chains, filter));
+          gimp_drawable_filter_set_chained (filter,
+                                            g_hash_table_contains (chained, filter));
+        }
+    }
+
+  g_hash_table_unref (chains);
+  g_hash_table_unref (chained);
+}
+
 void
 gimp_drawable_merge_filters (GimpDrawable *drawable)
 {
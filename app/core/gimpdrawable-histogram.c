@@ -32,6 +32,7 @@
 #include "gimpchannel.h"
 #include "gimpdrawable-filters.h"
 #include "gimpdrawable-histogram.h"
+#include "gimpdrawable-private.h"
 #include "gimphistogram.h"
 #include "gimpimage.h"
 #include "gimpprojectable.h"
@@ -44,6 +45,16 @@ static GimpAsync * gimp_drawable_calculate_histogram_internal (GimpDrawable  *dr
                                                                gboolean       with_filters,
                                                                gboolean       run_async);
 
+static GimpHistogramCache *
+                   gimp_drawable_get_histogram_cache          (GimpDrawable  *drawable,
+                                                               GimpChannel   *mask);
+static void        gimp_drawable_histogram_mask_update        (GimpDrawable  *mask,
+                                                               gint           x,
+                                                               gint           y,
+                                                               gint           width,
+                                                               gint           height,
+                                                               GimpDrawable  *drawable);
+
 
 /*  private functions  */
 
@@ -119,8 +130,9 @@ gimp_drawable_calculate_histogram_internal (GimpDrawable  *drawable,
     }
   else
     {
-      GeglBuffer      *buffer      = gimp_drawable_get_buffer (drawable);
-      GimpProjectable *projectable = NULL;
+      GeglBuffer         *buffer      = gimp_drawable_get_buffer (drawable);
+      GimpProjectable    *projectable = NULL;
+      GimpHistogramCache *cache       = NULL;
 
       if (with_filters && gimp_drawable_has_visible_filters (drawable))
         {
@@ -158,6 +170,12 @@ gimp_drawable_calculate_histogram_internal (GimpDrawable  *drawable,
       else
         {
           g_object_ref (buffer);
+
+          /*  only the parts of the buffer which changed since the last
+           *  calculation need to be calculated again
+           */
+          cache = gimp_drawable_get_histogram_cache (
+            drawable, gimp_channel_is_empty (mask) ? NULL : mask);
         }
 
       if (projectable)
@@ -172,7 +190,7 @@ gimp_drawable_calculate_histogram_internal (GimpDrawable  *drawable,
           if (run_async)
             {
               async = gimp_histogram_calculate_async (
-                histogram, buffer,
+                histogram, cache, buffer,
                 GEGL_RECTANGLE (x, y, width, height),
                 gimp_drawable_get_buffer (GIMP_DRAWABLE (mask)),
                 GEGL_RECTANGLE (x + off_x, y + off_y,
@@ -181,7 +199,7 @@ gimp_drawable_calculate_histogram_internal (GimpDrawable  *drawable,
           else
             {
               gimp_histogram_calculate (
-                histogram, buffer,
+                histogram, cache, buffer,
                 GEGL_RECTANGLE (x, y, width, height),
                 gimp_drawable_get_buffer (GIMP_DRAWABLE (mask)),
                 GEGL_RECTANGLE (x + off_x, y + off_y,
@@ -193,14 +211,14 @@ gimp_drawable_calculate_histogram_internal (GimpDrawable  *drawable,
           if (run_async)
             {
               async = gimp_histogram_calculate_async (
-                histogram, buffer,
+                histogram, cache, buffer,
                 GEGL_RECTANGLE (x, y, width, height),
                 NULL, NULL);
             }
           else
             {
               gimp_histogram_calculate (
-                histogram, buffer,
+                histogram, cache, buffer,
                 GEGL_RECTANGLE (x, y, width, height),
                 NULL, NULL);
             }
@@ -223,6 +241,55 @@ end:
   return async;
 }
 
+static GimpHistogramCache *
+gimp_drawable_get_histogram_cache (GimpDrawable *drawable,
+                                   GimpChannel  *mask)
+{
+  GimpDrawablePrivate *private = drawable->private;
+
+  if (! private->histogram_cache)
+    private->histogram_cache = gimp_histogram_cache_new ();
+
+  /*  the drawable's own changes invalidate the cache from
+   *  gimp_drawable_invalidate_histogram(), while the mask's changes
+   *  are tracked here
+   */
+  if (mask && mask != private->histogram_mask)
+    {
+      if (private->histogram_mask)
+        {
+          g_signal_handlers_disconnect_by_func (private->histogram_mask,
+                                                gimp_drawable_histogram_mask_update,
+                                                drawable);
+        }
+
+      g_set_weak_pointer (&private->histogram_mask, mask);
+
+      g_signal_connect_object (mask, "update",
+                               G_CALLBACK (gimp_drawable_histogram_mask_update),
+                               drawable, 0);
+
+      gimp_histogram_cache_invalidate_mask (private->histogram_cache, NULL);
+    }
+
+  return private->histogram_cache;
+}
+
+static void
+gimp_drawable_histogram_mask_update (GimpDrawable *mask,
+                                     gint          x,
+                                     gint          y,
+                                     gint          width,
+                                     gint          height,
+                                     GimpDrawable *drawable)
+{
+  if (drawable->private->histogram_cache)
+    {
+      gimp_histogram_cache_invalidate_mask (drawable->private->histogram_cache,
+                                            GEGL_RECTANGLE (x, y, width, height));
+    }
+}
+
 
 /*  public functions  */
 
@@ -254,3 +321,30 @@ gimp_drawable_calculate_histogram_async (GimpDrawable  *drawable,
                                                      histogram, with_filters,
                                                      TRUE);
 }
+
+void
+gimp_drawable_invalidate_histogram (GimpDrawable        *drawable,
+                                    const GeglRectangle *rect)
+{
+  g_return_if_fail (GIMP_IS_DRAWABLE (drawable));
+
+  if (drawable->private->histogram_cache)
+    gimp_histogram_cache_invalidate (drawable->private->histogram_cache, rect);
+}
+
+void
+_gimp_drawable_histogram_finalize (GimpDrawable *drawable)
+{
+  GimpDrawablePrivate *private = drawable->private;
+
+  if (private->histogram_mask)
+    {
+      g_signal_handlers_disconnect_by_func (private->histogram_mask,
+                                            gimp_drawable_histogram_mask_update,
+                                            drawable);
+
+      g_clear_weak_pointer (&private->histogram_mask);
+    }
+
+  g_clear_pointer (&private->histogram_cache, gimp_histogram_cache_unref);
+}
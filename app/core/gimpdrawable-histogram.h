@@ -20,9 +20,14 @@
 #pragma once
 
 
-void        gimp_drawable_calculate_histogram       (GimpDrawable  *drawable,
-                                                     GimpHistogram *histogram,
-                                                     gboolean       with_filters);
-GimpAsync * gimp_drawable_calculate_histogram_async (GimpDrawable  *drawable,
-                                                     GimpHistogram *histogram,
-                                                     gboolean       with_filters);
+void        gimp_drawable_calculate_histogram       (GimpDrawable        *drawable,
+                                                     GimpHistogram       *histogram,
+                                                     gboolean             with_filters);
+GimpAsync * gimp_drawable_calculate_histogram_async (GimpDrawable        *drawable,
+                                                     GimpHistogram       *histogram,
+                                                     gboolean             with_filters);
+
+void        gimp_drawable_invalidate_histogram      (GimpDrawable        *drawable,
+                                                     const GeglRectangle *rect);
+
+void        _gimp_drawable_histogram_finalize       (GimpDrawable        *drawable);
@@ -46,4 +46,7 @@ struct _GimpDrawablePrivate
   cairo_region_t   *paint_update_region;
 
   gboolean          push_resize_undo;
+
+  GimpHistogramCache *histogram_cache;
+  GimpChannel        *histogram_mask;
 };
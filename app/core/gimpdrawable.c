@@ -43,6 +43,7 @@
 #include "gimpdrawable-fill.h"
 #include "gimpdrawable-filters.h"
 #include "gimpdrawable-floating-selection.h"
+#include "gimpdrawable-histogram.h"
 #include "gimpdrawable-preview.h"
 #include "gimpdrawable-private.h"
 #include "gimpdrawable-shadow.h"
@@ -51,6 +52,7 @@
 #include "gimpdrawablefiltermask.h"
 #include "gimpfilterstack.h"
 #include "gimpgrouplayer.h"
+#include "gimphistogram.h"
 #include "gimpidtable.h"
 #include "gimpimage.h"
 #include "gimpimage-colormap.h"
@@ -449,6 +451,7 @@ gimp_drawable_finalize (GObject *object)
   g_clear_object (&drawable->private->buffer_source_node);
 
   _gimp_drawable_filters_finalize (drawable);
+  _gimp_drawable_histogram_finalize (drawable);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -498,6 +501,8 @@ gimp_drawable_get_memsize (GimpObject *object,
   memsize += gimp_gegl_buffer_get_memsize (gimp_drawable_get_buffer (drawable));
   memsize += gimp_gegl_buffer_get_memsize (drawable->private->shadow);
 
+  memsize += gimp_histogram_cache_get_memsize (drawable->private->histogram_cache);
+
   return memsize + GIMP_OBJECT_CLASS (parent_class)->get_memsize (object,
                                                                   gui_size);
 }
@@ -1019,7 +1024,22 @@ gimp_drawable_save (GimpSavable   *savable,
     {
       gchar *path;
 
-      if ((path = gimp_drawable_get_cache_path (drawable)))
+      path = gimp_drawable_get_cache_path (drawable);
+
+      /*  buffers which are not backed by a cache file, such as the lazily
+       *  loaded buffers of XCF layers, are copied to one now, so that
+       *  their pixels are saved too.
+       */
+      if (! path)
+        {
+          gimp_drawable_set_buffer_full (drawable, FALSE, NULL,
+                                         gimp_drawable_get_buffer (drawable),
+                                         NULL, FALSE);
+
+          path = gimp_drawable_get_cache_path (drawable);
+        }
+
+      if (path)
         {
           gchar *filename;
 
@@ -1253,6 +1273,9 @@ gimp_drawable_real_update (GimpDrawable *drawable,
                            gint          width,
                            gint          height)
 {
+  gimp_drawable_invalidate_histogram (drawable,
+                                      GEGL_RECTANGLE (x, y, width, height));
+
   gimp_viewable_invalidate_preview (GIMP_VIEWABLE (drawable));
   gimp_drawable_flush_cache (drawable);
 }
@@ -1392,6 +1415,8 @@ gimp_drawable_real_set_buffer (GimpDrawable        *drawable,
 
   g_set_object (&drawable->private->buffer, buffer);
 
+  gimp_drawable_invalidate_histogram (drawable, NULL);
+
   if (gimp_drawable_is_painting (drawable))
     g_set_object (&drawable->private->paint_buffer, buffer);
 
@@ -1440,6 +1465,11 @@ gimp_drawable_buffer_changed (GeglBuffer          *buffer,
                               const GeglRectangle *rect,
                               GimpDrawable        *drawable)
 {
+  /*  the buffer may be changed from other threads, and before the
+   *  drawable is updated, while painting
+   */
+  gimp_drawable_invalidate_histogram (drawable, rect);
+
   gimp_drawable_flush_cache (drawable);
 }
 
@@ -1759,6 +1789,8 @@ gimp_drawable_filters_changed (GimpDrawable *drawable)
 {
   g_return_if_fail (GIMP_IS_DRAWABLE (drawable));
 
+  gimp_drawable_chain_filters (drawable);
+
   g_signal_emit (drawable, gimp_drawable_signals[FILTERS_CHANGED], 0);
 }
 
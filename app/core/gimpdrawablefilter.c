@@ -40,6 +40,7 @@
 #include "core-types.h"
 
 #include "operations/gimp-operation-config.h"
+#include "operations/gimpoperationpointfilter.h"
 
 #include "gegl/gimp-babl.h"
 #include "gegl/gimpapplicator.h"
@@ -123,6 +124,9 @@ struct _GimpDrawableFilter
   GeglNode               *crop_after;
   GimpApplicator         *applicator;
 
+  GList                  *chain;
+  gboolean                chained;
+
   gboolean                temporary;
   /* This is mirroring merge_filter option of GimpFilterOptions. */
   gboolean                to_be_merged;
@@ -410,6 +414,9 @@ gimp_drawable_filter_dispose (GObject *object)
   if (drawable_filter->drawable)
     gimp_drawable_filter_remove_filter (drawable_filter);
 
+  g_list_free_full (drawable_filter->chain, g_object_unref);
+  drawable_filter->chain = NULL;
+
   G_OBJECT_CLASS (parent_class)->dispose (object);
 }
 
@@ -1123,6 +1130,14 @@ gimp_drawable_filter_set_preview (GimpDrawableFilter *filter,
     }
 }
 
+gboolean
+gimp_drawable_filter_get_preview (GimpDrawableFilter *filter)
+{
+  g_return_val_if_fail (GIMP_IS_DRAWABLE_FILTER (filter), FALSE);
+
+  return filter->preview_enabled;
+}
+
 void
 gimp_drawable_filter_set_preview_split (GimpDrawableFilter  *filter,
                                         gboolean             enabled,
@@ -1503,6 +1518,126 @@ gimp_drawable_filter_get_format (GimpDrawableFilter *filter)
   return format;
 }
 
+/*  returns whether @filter can be applied as part of the chain of @head,
+ *  or start a chain itself if @head is NULL.  only separable point
+ *  filters, which completely replace their input, can be chained.
+ */
+gboolean
+gimp_drawable_filter_can_chain (GimpDrawableFilter *filter,
+                                GimpDrawableFilter *head)
+{
+  GimpImage     *image;
+  GimpChannel   *mask;
+  GeglOperation *operation;
+
+  g_return_val_if_fail (GIMP_IS_DRAWABLE_FILTER (filter), FALSE);
+  g_return_val_if_fail (head == NULL || GIMP_IS_DRAWABLE_FILTER (head), FALSE);
+
+  if (filter->temporary             ||
+      filter->to_be_merged          ||
+      ! filter->has_input           ||
+      filter->crop_enabled          ||
+      filter->preview_split_enabled ||
+      filter->opacity    != GIMP_OPACITY_OPAQUE ||
+      filter->paint_mode != GIMP_LAYER_MODE_REPLACE)
+    {
+      return FALSE;
+    }
+
+  if (! filter->override_constraints &&
+      gimp_drawable_get_active_mask (filter->drawable) != GIMP_COMPONENT_MASK_ALL)
+    {
+      return FALSE;
+    }
+
+  image = gimp_item_get_image (GIMP_ITEM (filter->drawable));
+
+  if (filter->mask)
+    mask = GIMP_CHANNEL (filter->mask);
+  else
+    mask = gimp_image_get_mask (image);
+
+  if (mask && ! gimp_channel_is_empty (mask))
+    return FALSE;
+
+  operation = gegl_node_get_gegl_operation (filter->operation);
+
+  if (! GIMP_IS_OPERATION_POINT_FILTER (operation) ||
+      ! gimp_operation_point_filter_is_separable (GIMP_OPERATION_POINT_FILTER (operation)))
+    {
+      return FALSE;
+    }
+
+  if (head &&
+      (filter->drawable    != head->drawable ||
+       filter->region      != head->region   ||
+       filter->filter_clip != head->filter_clip))
+    {
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+/*  makes @filter apply the filters of @chain, which must be drawable
+ *  filters that can be chained to it, after its own operation.  the
+ *  filters of @chain should be bypassed using
+ *  gimp_drawable_filter_set_chained().
+ */
+void
+gimp_drawable_filter_set_chain (GimpDrawableFilter *filter,
+                                GList              *chain)
+{
+  GeglOperation *operation;
+  GList         *operations = NULL;
+  GList         *list;
+  GList         *iter;
+
+  g_return_if_fail (GIMP_IS_DRAWABLE_FILTER (filter));
+
+  for (list = chain, iter = filter->chain;
+       list && iter && list->data == iter->data;
+       list = g_list_next (list), iter = g_list_next (iter));
+
+  if (! list && ! iter)
+    return;
+
+  g_list_free_full (filter->chain, g_object_unref);
+  filter->chain = g_list_copy_deep (chain, (GCopyFunc) g_object_ref, NULL);
+
+  for (list = g_list_last (filter->chain); list; list = g_list_previous (list))
+    {
+      GimpDrawableFilter *link = list->data;
+
+      operations = g_list_prepend (operations,
+                                   gegl_node_get_gegl_operation (link->operation));
+    }
+
+  operation = gegl_node_get_gegl_operation (filter->operation);
+
+  if (GIMP_IS_OPERATION_POINT_FILTER (operation))
+    gimp_operation_point_filter_set_chain (GIMP_OPERATION_POINT_FILTER (operation),
+                                           operations);
+
+  g_list_free (operations);
+}
+
+void
+gimp_drawable_filter_set_chained (GimpDrawableFilter *filter,
+                                  gboolean            chained)
+{
+  g_return_if_fail (GIMP_IS_DRAWABLE_FILTER (filter));
+
+  chained = chained ? TRUE : FALSE;
+
+  if (chained != filter->chained)
+    {
+      filter->chained = chained;
+
+      gimp_drawable_filter_sync_active (filter);
+    }
+}
+
 void
 gimp_drawable_filter_apply (GimpDrawableFilter  *filter,
                             const GeglRectangle *area)
@@ -1810,7 +1945,8 @@ gimp_drawable_filter_set_operation (GimpDrawableFilter *filter,
 static void
 gimp_drawable_filter_sync_active (GimpDrawableFilter *filter)
 {
-  gimp_applicator_set_active (filter->applicator, filter->preview_enabled);
+  gimp_applicator_set_active (filter->applicator,
+                              filter->preview_enabled && ! filter->chained);
 }
 
 static void
@@ -2337,6 +2473,9 @@ gimp_drawable_filter_update_drawable (GimpDrawableFilter  *filter,
   GeglRectangle bounding_box;
   GeglRectangle update_area;
 
+  /*  whatever changed may have made the filter join or leave a chain  */
+  gimp_drawable_chain_filters (filter->drawable);
+
   bounding_box = gimp_drawable_get_bounding_box (filter->drawable);
 
   if (area)
@@ -2464,6 +2603,8 @@ gimp_drawable_filter_reorder (GimpFilterStack    *stack,
         {
           gimp_drawable_filter_sync_format (GIMP_LIST (stack)->queue->head->data);
         }
+
+      gimp_drawable_chain_filters (filter->drawable);
     }
 }
 
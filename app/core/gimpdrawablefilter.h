@@ -107,6 +107,7 @@ void       gimp_drawable_filter_set_crop       (GimpDrawableFilter      *filter,
 
 void       gimp_drawable_filter_set_preview    (GimpDrawableFilter      *filter,
                                                 gboolean                 enabled);
+gboolean   gimp_drawable_filter_get_preview    (GimpDrawableFilter      *filter);
 void       gimp_drawable_filter_set_preview_split
                                                (GimpDrawableFilter      *filter,
                                                 gboolean                 enabled,
@@ -135,6 +136,13 @@ void       gimp_drawable_filter_set_override_constraints
 const Babl *
            gimp_drawable_filter_get_format     (GimpDrawableFilter      *filter);
 
+gboolean   gimp_drawable_filter_can_chain      (GimpDrawableFilter      *filter,
+                                                GimpDrawableFilter      *head);
+void       gimp_drawable_filter_set_chain      (GimpDrawableFilter      *filter,
+                                                GList                   *chain);
+void       gimp_drawable_filter_set_chained    (GimpDrawableFilter      *filter,
+                                                gboolean                 chained);
+
 void       gimp_drawable_filter_apply          (GimpDrawableFilter      *filter,
                                                 const GeglRectangle     *area);
 
@@ -57,6 +57,13 @@
 #include "gimp-intl.h"
 
 
+enum
+{
+  PROP_0,
+  PROP_PINNED
+};
+
+
 typedef struct _GimpGroupLayerPrivate GimpGroupLayerPrivate;
 
 struct _GimpGroupLayerPrivate
@@ -76,6 +83,9 @@ struct _GimpGroupLayerPrivate
   gint            transforming;
   gboolean        expanded;
   gboolean        pass_through;
+  gboolean        pinned;
+  gint64          cache_memsize;
+  guint           cache_memsize_idle_id;
 
   /*  hackish temp states to make the projection/tiles stuff work  */
   const Babl     *convert_format;
@@ -104,6 +114,8 @@ static gint64          gimp_group_layer_get_memsize  (GimpObject      *object,
                                                       gint64          *gui_size);
 
 static void        gimp_group_layer_ancestry_changed (GimpViewable    *viewable);
+static gchar     * gimp_group_layer_get_description  (GimpViewable    *viewable,
+                                                      gchar          **tooltip);
 static gboolean        gimp_group_layer_get_size     (GimpViewable    *viewable,
                                                       gint            *width,
                                                       gint            *height);
@@ -241,6 +253,8 @@ static void gimp_group_layer_child_filters_changed   (GimpLayer       *child,
                                                       GimpGroupLayer  *group);
 
 static void            gimp_group_layer_flush        (GimpGroupLayer  *group);
+static void  gimp_group_layer_update_cache_memsize   (GimpGroupLayer  *group);
+static gboolean gimp_group_layer_cache_memsize_idle  (GimpGroupLayer  *group);
 static void            gimp_group_layer_update       (GimpGroupLayer  *group);
 static void            gimp_group_layer_update_size  (GimpGroupLayer  *group);
 static void        gimp_group_layer_update_mask_size (GimpGroupLayer  *group);
@@ -288,6 +302,13 @@ static GimpSavableInterface *parent_savable_iface = NULL;
  */
 static gboolean no_pass_through_strength_reduction = FALSE;
 
+/*  the memory used by the projections of all group layers, and by those
+ *  of pinned group layers.  these are read by the dashboard, in its own
+ *  thread.
+ */
+static guintptr gimp_group_layer_cache_total_memsize        = 0;
+static guintptr gimp_group_layer_pinned_cache_total_memsize = 0;
+
 
 static void
 gimp_group_layer_class_init (GimpGroupLayerClass *klass)
@@ -309,6 +330,7 @@ gimp_group_layer_class_init (GimpGroupLayerClass *klass)
   viewable_class->default_name           = _("Layer Group");
   viewable_class->ancestry_changed       = gimp_group_layer_ancestry_changed;
   viewable_class->get_size               = gimp_group_layer_get_size;
+  viewable_class->get_description        = gimp_group_layer_get_description;
   viewable_class->get_children           = gimp_group_layer_get_children;
   viewable_class->set_expanded           = gimp_group_layer_set_expanded;
   viewable_class->get_expanded           = gimp_group_layer_get_expanded;
@@ -347,6 +369,12 @@ gimp_group_layer_class_init (GimpGroupLayerClass *klass)
   layer_class->get_effective_mode        = gimp_group_layer_get_effective_mode;
   layer_class->get_excludes_backdrop     = gimp_group_layer_get_excludes_backdrop;
 
+  g_object_class_install_property (object_class, PROP_PINNED,
+                                   g_param_spec_boolean ("pinned",
+                                                         NULL, NULL,
+                                                         FALSE,
+                                                         GIMP_PARAM_READWRITE));
+
   if (g_getenv ("GIMP_NO_PASS_THROUGH_STRENGTH_REDUCTION"))
     no_pass_through_strength_reduction = TRUE;
 }
@@ -429,6 +457,12 @@ gimp_group_layer_init (GimpGroupLayer *group)
   private->projection = gimp_projection_new (GIMP_PROJECTABLE (group));
   gimp_projection_set_priority (private->projection, 1);
 
+  /*  unless the group is pinned, its projection is rendered lazily, and
+   *  parents reading it at a lower zoom level, or rendering coarsely,
+   *  don't need it in full resolution.
+   */
+  gimp_projection_set_render_levels (private->projection, TRUE);
+
   g_signal_connect (private->projection, "update",
                     G_CALLBACK (gimp_group_layer_proj_update),
                     group);
@@ -460,6 +494,21 @@ gimp_group_layer_finalize (GObject *object)
       g_clear_object (&private->children);
     }
 
+  if (private->cache_memsize_idle_id)
+    {
+      g_source_remove (private->cache_memsize_idle_id);
+      private->cache_memsize_idle_id = 0;
+    }
+
+  g_atomic_pointer_add (&gimp_group_layer_cache_total_memsize,
+                        -private->cache_memsize);
+
+  if (private->pinned)
+    {
+      g_atomic_pointer_add (&gimp_group_layer_pinned_cache_total_memsize,
+                            -private->cache_memsize);
+    }
+
   g_clear_object (&private->projection);
   g_clear_object (&private->source_node);
   g_clear_object (&private->graph);
@@ -473,8 +522,14 @@ gimp_group_layer_set_property (GObject      *object,
                                const GValue *value,
                                GParamSpec   *pspec)
 {
+  GimpGroupLayer *group = GIMP_GROUP_LAYER (object);
+
   switch (property_id)
     {
+    case PROP_PINNED:
+      gimp_group_layer_set_pinned (group, g_value_get_boolean (value));
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -487,8 +542,14 @@ gimp_group_layer_get_property (GObject    *object,
                                GValue     *value,
                                GParamSpec *pspec)
 {
+  GimpGroupLayerPrivate *private = GET_PRIVATE (object);
+
   switch (property_id)
     {
+    case PROP_PINNED:
+      g_value_set_boolean (value, private->pinned);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -520,6 +581,34 @@ gimp_group_layer_ancestry_changed (GimpViewable *viewable)
   GIMP_VIEWABLE_CLASS (parent_class)->ancestry_changed (viewable);
 }
 
+static gchar *
+gimp_group_layer_get_description (GimpViewable  *viewable,
+                                  gchar        **tooltip)
+{
+  gchar *description;
+
+  description = GIMP_VIEWABLE_CLASS (parent_class)->get_description (viewable,
+                                                                     tooltip);
+
+  if (tooltip && ! *tooltip)
+    {
+      gchar *size;
+
+      size = g_format_size (gimp_group_layer_get_cache_memsize (
+                              GIMP_GROUP_LAYER (viewable)));
+
+      /* TRANSLATORS: the second %s is the size of the group's rendered
+       * projection, e.g. "12.3 MB".
+       */
+      *tooltip = g_strdup_printf (_("%s\nCached projection: %s"),
+                                  description, size);
+
+      g_free (size);
+    }
+
+  return description;
+}
+
 static gboolean
 gimp_group_layer_get_size (GimpViewable *viewable,
                            gint         *width,
@@ -667,6 +756,8 @@ gimp_group_layer_duplicate (GimpItem *item,
       GET_PRIVATE (new_group)->reallocate_projection = TRUE;
 
       gimp_group_layer_resume_resize (new_group, FALSE);
+
+      gimp_group_layer_set_pinned (new_group, private->pinned);
     }
 
   return new_item;
@@ -1714,6 +1805,78 @@ gimp_group_layer_get_projection (GimpGroupLayer *group)
   return GET_PRIVATE (group)->projection;
 }
 
+/**
+ * gimp_group_layer_set_pinned:
+ * @group:
+ * @pinned:
+ *
+ * Sets the caching policy of the group's projection.  The projection
+ * of a pinned group is kept rendered in full resolution, and is
+ * re-rendered in the background after its children change, which suits
+ * groups that rarely change.  The projection of other groups is only
+ * rendered when read, at the zoom level it's read at first.
+ *
+ * This is a performance setting, and is neither undoable nor saved.
+ */
+void
+gimp_group_layer_set_pinned (GimpGroupLayer *group,
+                             gboolean        pinned)
+{
+  GimpGroupLayerPrivate *private;
+
+  g_return_if_fail (GIMP_IS_GROUP_LAYER (group));
+
+  private = GET_PRIVATE (group);
+
+  pinned = pinned ? TRUE : FALSE;
+
+  if (pinned != private->pinned)
+    {
+      private->pinned = pinned;
+
+      g_atomic_pointer_add (&gimp_group_layer_pinned_cache_total_memsize,
+                            pinned ?  private->cache_memsize :
+                                     -private->cache_memsize);
+
+      gimp_projection_set_render_levels (private->projection, ! pinned);
+
+      if (pinned)
+        gimp_projection_validate_idle (private->projection);
+
+      g_object_notify (G_OBJECT (group), "pinned");
+    }
+}
+
+gboolean
+gimp_group_layer_get_pinned (GimpGroupLayer *group)
+{
+  g_return_val_if_fail (GIMP_IS_GROUP_LAYER (group), FALSE);
+
+  return GET_PRIVATE (group)->pinned;
+}
+
+gint64
+gimp_group_layer_get_cache_memsize (GimpGroupLayer *group)
+{
+  g_return_val_if_fail (GIMP_IS_GROUP_LAYER (group), 0);
+
+  gimp_group_layer_update_cache_memsize (group);
+
+  return GET_PRIVATE (group)->cache_memsize;
+}
+
+guint64
+gimp_group_layer_get_total_cache_memsize (void)
+{
+  return gimp_group_layer_cache_total_memsize;
+}
+
+guint64
+gimp_group_layer_get_pinned_cache_memsize (void)
+{
+  return gimp_group_layer_pinned_cache_total_memsize;
+}
+
 void
 gimp_group_layer_suspend_resize (GimpGroupLayer *group,
                                  gboolean        push_undo)
@@ -2120,9 +2283,60 @@ gimp_group_layer_flush (GimpGroupLayer *group)
        *  problem)
        */
       gimp_pickable_flush (GIMP_PICKABLE (private->projection));
+
+      /*  the flush above only invalidates the projection, which is then
+       *  rendered when read, coarsely first if read at a lower zoom level.
+       *  pinned groups are kept rendered in full resolution instead.
+       */
+      if (private->pinned)
+        gimp_projection_validate_idle (private->projection);
+    }
+
+  /*  counting the projection's tiles is not free, so don't do it on
+   *  every flush while painting
+   */
+  if (! private->cache_memsize_idle_id)
+    {
+      private->cache_memsize_idle_id =
+        g_idle_add_full (G_PRIORITY_LOW,
+                         (GSourceFunc) gimp_group_layer_cache_memsize_idle,
+                         group, NULL);
+    }
+}
+
+static void
+gimp_group_layer_update_cache_memsize (GimpGroupLayer *group)
+{
+  GimpGroupLayerPrivate *private = GET_PRIVATE (group);
+  gint64                 memsize;
+
+  memsize = gimp_projection_get_tile_memsize (private->projection);
+
+  if (memsize != private->cache_memsize)
+    {
+      g_atomic_pointer_add (&gimp_group_layer_cache_total_memsize,
+                            memsize - private->cache_memsize);
+
+      if (private->pinned)
+        {
+          g_atomic_pointer_add (&gimp_group_layer_pinned_cache_total_memsize,
+                                memsize - private->cache_memsize);
+        }
+
+      private->cache_memsize = memsize;
     }
 }
 
+static gboolean
+gimp_group_layer_cache_memsize_idle (GimpGroupLayer *group)
+{
+  GET_PRIVATE (group)->cache_memsize_idle_id = 0;
+
+  gimp_group_layer_update_cache_memsize (group);
+
+  return G_SOURCE_REMOVE;
+}
+
 static void
 gimp_group_layer_update (GimpGroupLayer *group)
 {
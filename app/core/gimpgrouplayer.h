@@ -40,6 +40,15 @@ GimpLayer      * gimp_group_layer_new                 (GimpImage           *imag
 
 GimpProjection * gimp_group_layer_get_projection      (GimpGroupLayer      *group);
 
+void             gimp_group_layer_set_pinned          (GimpGroupLayer      *group,
+                                                       gboolean             pinned);
+gboolean         gimp_group_layer_get_pinned          (GimpGroupLayer      *group);
+
+gint64           gimp_group_layer_get_cache_memsize   (GimpGroupLayer      *group);
+
+guint64          gimp_group_layer_get_total_cache_memsize  (void);
+guint64          gimp_group_layer_get_pinned_cache_memsize (void);
+
 void             gimp_group_layer_suspend_resize      (GimpGroupLayer      *group,
                                                        gboolean             push_undo);
 void             gimp_group_layer_resume_resize       (GimpGroupLayer      *group,
@@ -49,6 +49,9 @@
 #define PIXELS_PER_THREAD \
   (/* each thread costs as much as */ 64.0 * 64.0 /* pixels */)
 
+#define CACHE_CELL_SIZE 512
+#define CACHE_N_TRCS    (GIMP_TRC_PERCEPTUAL + 1)
+
 
 enum
 {
@@ -67,19 +70,71 @@ struct _GimpHistogramPrivate
   GimpAsync   *calculate_async;
 };
 
+/*  a cache holds the partial histograms of the cells of a buffer, for
+ *  each histogram TRC, with and without a mask.  the cells are
+ *  CACHE_CELL_SIZE pixels square, and aligned to the buffer's extent.
+ *
+ *  the values of a cell are an atomic rc box, so that a calculation can
+ *  hold on to them while the cell is invalidated.  each invalidation of
+ *  a cell increments its serial, and the values calculated for a cell
+ *  are only stored if its serial is still the same as when the
+ *  calculation started.
+ */
+typedef struct
+{
+  gint           serial;
+  gdouble       *values;
+} CacheCell;
+
+typedef struct
+{
+  gint           generation;
+
+  const Babl    *format;
+  GeglRectangle  extent;
+  gint           mask_offset_x;
+  gint           mask_offset_y;
+  gint           n_values;
+
+  gint           n_columns;
+  gint           n_rows;
+  CacheCell     *cells;
+} CacheGrid;
+
+struct _GimpHistogramCache
+{
+  gint           ref_count;
+
+  GMutex         mutex;
+  CacheGrid      grids[CACHE_N_TRCS][2];
+};
+
+typedef struct
+{
+  GeglRectangle  rect;
+  gint           index;  /* -1 if the cell is not cached */
+  gint           serial;
+  gdouble       *values; /* an atomic rc box */
+} CalculateCell;
+
 typedef struct
 {
   /*  input  */
-  GimpHistogram *histogram;
-  GeglBuffer    *buffer;
-  GeglRectangle  buffer_rect;
-  GeglBuffer    *mask;
-  GeglRectangle  mask_rect;
+  GimpHistogram      *histogram;
+  GimpHistogramCache *cache;
+  GeglBuffer         *buffer;
+  GeglRectangle       buffer_rect;
+  GeglBuffer         *mask;
+  GeglRectangle       mask_rect;
+
+  gint                generation;
+  CalculateCell      *cells;
+  gint                n_cells;
 
   /*  output  */
-  gint           n_components;
-  gint           n_bins;
-  gdouble       *values;
+  gint                n_components;
+  gint                n_bins;
+  gdouble            *values;
 } CalculateContext;
 
 typedef struct
@@ -117,10 +172,27 @@ static void       gimp_histogram_set_values               (GimpHistogram
 
 static void       gimp_histogram_calculate_internal       (GimpAsync            *async,
                                                            CalculateContext     *context);
+static gdouble  * gimp_histogram_calculate_rect           (GimpAsync            *async,
+                                                           CalculateContext     *context,
+                                                           const Babl           *format,
+                                                           const GeglRectangle  *rect);
 static void       gimp_histogram_calculate_area           (const GeglRectangle  *area,
                                                            CalculateData        *data);
 static void       gimp_histogram_calculate_async_callback (GimpAsync            *async,
                                                            CalculateContext     *context);
+static void       gimp_histogram_calculate_free_cells     (CalculateContext     *context);
+
+static CacheGrid *gimp_histogram_cache_get_grid           (GimpHistogramCache   *cache,
+                                                           CalculateContext     *context);
+static void       gimp_histogram_cache_prepare            (GimpHistogramCache   *cache,
+                                                           CalculateContext     *context,
+                                                           GeglRectangle        *dirty_rect);
+static void       gimp_histogram_cache_store              (GimpHistogramCache   *cache,
+                                                           CalculateContext     *context);
+static void       gimp_histogram_cache_grid_invalidate    (CacheGrid            *grid,
+                                                           const GeglRectangle  *rect);
+static void       gimp_histogram_cache_grid_clear         (CacheGrid            *grid);
+
 static guint      hash_color_bytes                        (gpointer             *key);
 static gboolean   color_bytes_equal                       (gpointer             *key1,
                                                            gpointer             *key2);
@@ -322,6 +394,7 @@ gimp_histogram_duplicate (GimpHistogram *histogram)
 
 void
 gimp_histogram_calculate (GimpHistogram       *histogram,
+                          GimpHistogramCache  *cache,
                           GeglBuffer          *buffer,
                           const GeglRectangle *buffer_rect,
                           GeglBuffer          *mask,
@@ -350,8 +423,24 @@ gimp_histogram_calculate (GimpHistogram       *histogram,
         context.mask_rect = *gegl_buffer_get_extent (mask);
     }
 
+  if (cache)
+    {
+      GeglRectangle dirty_rect;
+
+      context.cache = cache;
+
+      gimp_histogram_cache_prepare (cache, &context, &dirty_rect);
+    }
+
   gimp_histogram_calculate_internal (NULL, &context);
 
+  if (cache)
+    {
+      gimp_histogram_cache_store (cache, &context);
+
+      gimp_histogram_calculate_free_cells (&context);
+    }
+
   gimp_histogram_set_values (histogram,
                              context.n_components, context.n_bins,
                              context.values);
@@ -359,12 +448,14 @@ gimp_histogram_calculate (GimpHistogram       *histogram,
 
 GimpAsync *
 gimp_histogram_calculate_async (GimpHistogram       *histogram,
+                                GimpHistogramCache  *cache,
                                 GeglBuffer          *buffer,
                                 const GeglRectangle *buffer_rect,
                                 GeglBuffer          *mask,
                                 const GeglRectangle *mask_rect)
 {
   CalculateContext *context;
+  GeglRectangle     dirty_rect;
   GeglRectangle     rect;
 
   g_return_val_if_fail (GIMP_IS_HISTOGRAM (histogram), NULL);
@@ -374,33 +465,60 @@ gimp_histogram_calculate_async (GimpHistogram       *histogram,
   if (histogram->priv->calculate_async)
     gimp_async_cancel_and_wait (histogram->priv->calculate_async);
 
-  gegl_rectangle_align_to_buffer (&rect, buffer_rect, buffer,
-                                  GEGL_RECTANGLE_ALIGNMENT_SUPERSET);
-
   context = g_slice_new0 (CalculateContext);
 
   context->histogram   = histogram;
-  context->buffer      = gegl_buffer_new (&rect,
-                                          gegl_buffer_get_format (buffer));
+  context->buffer      = buffer;
   context->buffer_rect = *buffer_rect;
 
-  gimp_gegl_buffer_copy (buffer, &rect, GEGL_ABYSS_NONE,
-                         context->buffer, NULL);
-
   if (mask)
     {
+      context->mask = mask;
+
       if (mask_rect)
         context->mask_rect = *mask_rect;
       else
         context->mask_rect = *gegl_buffer_get_extent (mask);
+    }
+
+  /*  only the cells which aren't cached need to be copied  */
+  if (cache)
+    {
+      context->cache = gimp_histogram_cache_ref (cache);
+
+      gimp_histogram_cache_prepare (cache, context, &dirty_rect);
+    }
+  else
+    {
+      dirty_rect = *buffer_rect;
+    }
 
-      gegl_rectangle_align_to_buffer (&rect, &context->mask_rect, mask,
+  gegl_rectangle_align_to_buffer (&rect, &dirty_rect, buffer,
+                                  GEGL_RECTANGLE_ALIGNMENT_SUPERSET);
+
+  context->buffer = gegl_buffer_new (&rect, gegl_buffer_get_format (buffer));
+
+  if (! gegl_rectangle_is_empty (&rect))
+    {
+      gimp_gegl_buffer_copy (buffer, &rect, GEGL_ABYSS_NONE,
+                             context->buffer, NULL);
+    }
+
+  if (mask)
+    {
+      dirty_rect.x += context->mask_rect.x - context->buffer_rect.x;
+      dirty_rect.y += context->mask_rect.y - context->buffer_rect.y;
+
+      gegl_rectangle_align_to_buffer (&rect, &dirty_rect, mask,
                                       GEGL_RECTANGLE_ALIGNMENT_SUPERSET);
 
       context->mask = gegl_buffer_new (&rect, gegl_buffer_get_format (mask));
 
-      gimp_gegl_buffer_copy (mask, &rect, GEGL_ABYSS_NONE,
-                             context->mask, NULL);
+      if (! gegl_rectangle_is_empty (&rect))
+        {
+          gimp_gegl_buffer_copy (mask, &rect, GEGL_ABYSS_NONE,
+                                 context->mask, NULL);
+        }
     }
 
   histogram->priv->calculate_async = gimp_parallel_run_async (
@@ -427,6 +545,172 @@ gimp_histogram_clear_values (GimpHistogram *histogram,
   gimp_histogram_set_values (histogram, n_components, 0, NULL);
 }
 
+/**
+ * gimp_histogram_cache_new:
+ *
+ * Creates a cache for the partial histograms of the cells of a buffer,
+ * which gimp_histogram_calculate() and gimp_histogram_calculate_async()
+ * use to only calculate the parts of the buffer which changed since
+ * the last calculation.
+ *
+ * The cache has to be invalidated by the caller, using
+ * gimp_histogram_cache_invalidate() when the buffer changes, and
+ * gimp_histogram_cache_invalidate_mask() when the mask changes.  A
+ * cache should only be used with a single buffer and a single mask.
+ *
+ * When calculating a histogram with a mask, the cells are calculated
+ * in full, and the buffer rectangle must cover the entire non-zero
+ * area of the mask within the buffer.
+ *
+ * Returns: a new %GimpHistogramCache
+ **/
+GimpHistogramCache *
+gimp_histogram_cache_new (void)
+{
+  GimpHistogramCache *cache = g_slice_new0 (GimpHistogramCache);
+
+  cache->ref_count = 1;
+
+  g_mutex_init (&cache->mutex);
+
+  return cache;
+}
+
+GimpHistogramCache *
+gimp_histogram_cache_ref (GimpHistogramCache *cache)
+{
+  g_return_val_if_fail (cache != NULL, NULL);
+
+  g_atomic_int_inc (&cache->ref_count);
+
+  return cache;
+}
+
+void
+gimp_histogram_cache_unref (GimpHistogramCache *cache)
+{
+  g_return_if_fail (cache != NULL);
+  g_return_if_fail (cache->ref_count > 0);
+
+  if (g_atomic_int_dec_and_test (&cache->ref_count))
+    {
+      gint trc;
+      gint masked;
+
+      for (trc = 0; trc < CACHE_N_TRCS; trc++)
+        {
+          for (masked = 0; masked < 2; masked++)
+            gimp_histogram_cache_grid_clear (&cache->grids[trc][masked]);
+        }
+
+      g_mutex_clear (&cache->mutex);
+
+      g_slice_free (GimpHistogramCache, cache);
+    }
+}
+
+/**
+ * gimp_histogram_cache_invalidate:
+ * @cache: a %GimpHistogramCache
+ * @rect:  the changed area of the buffer, or %NULL
+ *
+ * Invalidates the cells of @cache which intersect @rect, or all cells
+ * if @rect is %NULL.  This function may be called from any thread.
+ **/
+void
+gimp_histogram_cache_invalidate (GimpHistogramCache  *cache,
+                                 const GeglRectangle *rect)
+{
+  gint trc;
+  gint masked;
+
+  g_return_if_fail (cache != NULL);
+
+  g_mutex_lock (&cache->mutex);
+
+  for (trc = 0; trc < CACHE_N_TRCS; trc++)
+    {
+      for (masked = 0; masked < 2; masked++)
+        gimp_histogram_cache_grid_invalidate (&cache->grids[trc][masked], rect);
+    }
+
+  g_mutex_unlock (&cache->mutex);
+}
+
+/**
+ * gimp_histogram_cache_invalidate_mask:
+ * @cache: a %GimpHistogramCache
+ * @rect:  the changed area of the mask, or %NULL
+ *
+ * Invalidates the masked cells of @cache which intersect @rect, in
+ * mask coordinates, or all masked cells if @rect is %NULL.
+ **/
+void
+gimp_histogram_cache_invalidate_mask (GimpHistogramCache  *cache,
+                                      const GeglRectangle *rect)
+{
+  gint trc;
+
+  g_return_if_fail (cache != NULL);
+
+  g_mutex_lock (&cache->mutex);
+
+  for (trc = 0; trc < CACHE_N_TRCS; trc++)
+    {
+      CacheGrid *grid = &cache->grids[trc][TRUE];
+
+      if (rect)
+        {
+          GeglRectangle buffer_rect = *rect;
+
+          buffer_rect.x -= grid->mask_offset_x;
+          buffer_rect.y -= grid->mask_offset_y;
+
+          gimp_histogram_cache_grid_invalidate (grid, &buffer_rect);
+        }
+      else
+        {
+          gimp_histogram_cache_grid_invalidate (grid, NULL);
+        }
+    }
+
+  g_mutex_unlock (&cache->mutex);
+}
+
+gint64
+gimp_histogram_cache_get_memsize (GimpHistogramCache *cache)
+{
+  gint64 memsize = 0;
+  gint   trc;
+  gint   masked;
+
+  if (! cache)
+    return 0;
+
+  g_mutex_lock (&cache->mutex);
+
+  for (trc = 0; trc < CACHE_N_TRCS; trc++)
+    {
+      for (masked = 0; masked < 2; masked++)
+        {
+          CacheGrid *grid = &cache->grids[trc][masked];
+          gint       i;
+
+          memsize += grid->n_columns * grid->n_rows * sizeof (CacheCell);
+
+          for (i = 0; i < grid->n_columns * grid->n_rows; i++)
+            {
+              if (grid->cells[i].values)
+                memsize += grid->n_values * sizeof (gdouble);
+            }
+        }
+    }
+
+  g_mutex_unlock (&cache->mutex);
+
+  return sizeof (GimpHistogramCache) + memsize;
+}
+
 
 #define HISTOGRAM_VALUE(c,i) (priv->values[(c) * priv->n_bins + (i)])
 
@@ -930,7 +1214,6 @@ static void
 gimp_histogram_calculate_internal (GimpAsync        *async,
                                    CalculateContext *context)
 {
-  CalculateData         data;
   GimpHistogramPrivate *priv;
   const Babl           *format;
   const Babl           *space;
@@ -973,58 +1256,117 @@ gimp_histogram_calculate_internal (GimpAsync        *async,
 
   context->n_components = babl_format_get_n_components (format);
 
-  data.async       = async;
-  data.context     = context;
-  data.format      = format;
-  data.values_list = NULL;
-
-  gegl_parallel_distribute_area (
-    &context->buffer_rect, PIXELS_PER_THREAD, GEGL_SPLIT_STRATEGY_AUTO,
-    (GeglParallelDistributeAreaFunc) gimp_histogram_calculate_area,
-    &data);
-
-  if (! async || ! gimp_async_is_canceled (async))
+  if (context->cells)
     {
-      gdouble *total_values = NULL;
-      gint     n_values     = (context->n_components + N_DERIVED_CHANNELS) *
-                              context->n_bins;
-      GSList  *iter;
+      gint  n_values = (context->n_components + N_DERIVED_CHANNELS) *
+                       context->n_bins;
+      gint  i;
 
-      for (iter = data.values_list; iter; iter = g_slist_next (iter))
+      context->values = g_new0 (gdouble, n_values);
+
+      for (i = 0; i < context->n_cells; i++)
         {
-          gdouble *values = iter->data;
+          CalculateCell *cell = &context->cells[i];
+          gint           j;
 
-          if (! total_values)
+          if (! cell->values)
             {
-              total_values = values;
-            }
-          else
-            {
-              gint i;
+              gdouble *values;
+
+              values = gimp_histogram_calculate_rect (async, context, format,
+                                                      &cell->rect);
 
-              for (i = 0; i < n_values; i++)
-                total_values[i] += values[i];
+              if (async && gimp_async_is_canceled (async))
+                break;
+
+              cell->values = g_atomic_rc_box_alloc0 (n_values * sizeof (gdouble));
+
+              if (values)
+                memcpy (cell->values, values, n_values * sizeof (gdouble));
 
               g_free (values);
             }
-        }
 
-      g_slist_free (data.values_list);
-
-      context->values = total_values;
+          for (j = 0; j < n_values; j++)
+            context->values[j] += cell->values[j];
+        }
+    }
+  else
+    {
+      context->values = gimp_histogram_calculate_rect (async, context, format,
+                                                       &context->buffer_rect);
+    }
 
+  if (! async || ! gimp_async_is_canceled (async))
+    {
       if (async)
         gimp_async_finish (async, NULL);
     }
   else
     {
-      g_slist_free_full (data.values_list, g_free);
+      g_clear_pointer (&context->values, g_free);
 
       if (async)
         gimp_async_abort (async);
     }
 }
 
+/*  returns the sum of the histograms of the areas @rect is split into,
+ *  or NULL if @rect is empty, or if @async is canceled
+ */
+static gdouble *
+gimp_histogram_calculate_rect (GimpAsync           *async,
+                               CalculateContext    *context,
+                               const Babl          *format,
+                               const GeglRectangle *rect)
+{
+  CalculateData  data;
+  gdouble       *total_values = NULL;
+  gint           n_values     = (context->n_components + N_DERIVED_CHANNELS) *
+                                context->n_bins;
+  GSList        *iter;
+
+  data.async       = async;
+  data.context     = context;
+  data.format      = format;
+  data.values_list = NULL;
+
+  gegl_parallel_distribute_area (
+    rect, PIXELS_PER_THREAD, GEGL_SPLIT_STRATEGY_AUTO,
+    (GeglParallelDistributeAreaFunc) gimp_histogram_calculate_area,
+    &data);
+
+  if (async && gimp_async_is_canceled (async))
+    {
+      g_slist_free_full (data.values_list, g_free);
+
+      return NULL;
+    }
+
+  for (iter = data.values_list; iter; iter = g_slist_next (iter))
+    {
+      gdouble *values = iter->data;
+
+      if (! total_values)
+        {
+          total_values = values;
+        }
+      else
+        {
+          gint i;
+
+          for (i = 0; i < n_values; i++)
+            total_values[i] += values[i];
+
+          g_free (values);
+        }
+    }
+
+  g_slist_free (data.values_list);
+
+  return total_values;
+}
+
 static void
 gimp_histogram_calculate_area (const GeglRectangle *area,
                                CalculateData       *data)
@@ -1267,11 +1609,21 @@ gimp_histogram_calculate_async_callback (GimpAsync        *async,
 
   if (gimp_async_is_finished (async))
     {
+      if (context->cache)
+        gimp_histogram_cache_store (context->cache, context);
+
       gimp_histogram_set_values (context->histogram,
                                  context->n_components, context->n_bins,
                                  context->values);
     }
 
+  if (context->cache)
+    {
+      gimp_histogram_calculate_free_cells (context);
+
+      gimp_histogram_cache_unref (context->cache);
+    }
+
   g_object_unref (context->buffer);
   if (context->mask)
     g_object_unref (context->mask);
@@ -1279,6 +1631,238 @@ gimp_histogram_calculate_async_callback (GimpAsync        *async,
   g_slice_free (CalculateContext, context);
 }
 
+static void
+gimp_histogram_calculate_free_cells (CalculateContext *context)
+{
+  gint i;
+
+  for (i = 0; i < context->n_cells; i++)
+    {
+      if (context->cells[i].values)
+        g_atomic_rc_box_release (context->cells[i].values);
+    }
+
+  g_clear_pointer (&context->cells, g_free);
+  context->n_cells = 0;
+}
+
+static CacheGrid *
+gimp_histogram_cache_get_grid (GimpHistogramCache *cache,
+                               CalculateContext   *context)
+{
+  return &cache->grids[context->histogram->priv->trc][context->mask != NULL];
+}
+
+/*  fills the cells of @context with the cells of @cache which intersect
+ *  the buffer rectangle, taking the values of the cached ones, and
+ *  returns the bounding box of those which need to be calculated
+ */
+static void
+gimp_histogram_cache_prepare (GimpHistogramCache *cache,
+                              CalculateContext   *context,
+                              GeglRectangle      *dirty_rect)
+{
+  CacheGrid           *grid;
+  const Babl          *format;
+  const GeglRectangle *extent;
+  gint                 mask_offset_x = 0;
+  gint                 mask_offset_y = 0;
+  GeglRectangle        rect;
+  gint                 column1, column2;
+  gint                 row1, row2;
+  gint                 column;
+  gint                 row;
+
+  format = gegl_buffer_get_format (context->buffer);
+  extent = gegl_buffer_get_extent (context->buffer);
+
+  if (context->mask)
+    {
+      mask_offset_x = context->mask_rect.x - context->buffer_rect.x;
+      mask_offset_y = context->mask_rect.y - context->buffer_rect.y;
+    }
+
+  *dirty_rect = *GEGL_RECTANGLE (0, 0, 0, 0);
+
+  g_mutex_lock (&cache->mutex);
+
+  grid = gimp_histogram_cache_get_grid (cache, context);
+
+  if (grid->format        != format                   ||
+      grid->mask_offset_x != mask_offset_x            ||
+      grid->mask_offset_y != mask_offset_y            ||
+      ! gegl_rectangle_equal (&grid->extent, extent))
+    {
+      gimp_histogram_cache_grid_clear (grid);
+
+      grid->generation++;
+
+      grid->format        = format;
+      grid->extent        = *extent;
+      grid->mask_offset_x = mask_offset_x;
+      grid->mask_offset_y = mask_offset_y;
+
+      grid->n_columns = (extent->width  + CACHE_CELL_SIZE - 1) / CACHE_CELL_SIZE;
+      grid->n_rows    = (extent->height + CACHE_CELL_SIZE - 1) / CACHE_CELL_SIZE;
+      grid->cells     = g_new0 (CacheCell, grid->n_columns * grid->n_rows);
+    }
+
+  context->generation = grid->generation;
+  context->cells      = g_new0 (CalculateCell, grid->n_columns * grid->n_rows);
+  context->n_cells    = 0;
+
+  if (! gegl_rectangle_intersect (&rect, &context->buffer_rect, extent))
+    {
+      g_mutex_unlock (&cache->mutex);
+
+      return;
+    }
+
+  column1 = (rect.x                  - extent->x) / CACHE_CELL_SIZE;
+  column2 = (rect.x + rect.width  - 1 - extent->x) / CACHE_CELL_SIZE;
+  row1    = (rect.y                  - extent->y) / CACHE_CELL_SIZE;
+  row2    = (rect.y + rect.height - 1 - extent->y) / CACHE_CELL_SIZE;
+
+  for (row = row1; row <= row2; row++)
+    {
+      for (column = column1; column <= column2; column++)
+        {
+          CalculateCell *cell  = &context->cells[context->n_cells++];
+          gint           index = row * grid->n_columns + column;
+
+          gegl_rectangle_intersect (&cell->rect,
+                                    GEGL_RECTANGLE (extent->x +
+                                                    column * CACHE_CELL_SIZE,
+                                                    extent->y +
+                                                    row    * CACHE_CELL_SIZE,
+                                                    CACHE_CELL_SIZE,
+                                                    CACHE_CELL_SIZE),
+                                    extent);
+
+          /*  without a mask, cells which are only partly covered by the
+           *  buffer rectangle are calculated on their own.  with a mask,
+           *  which is zero outside of the buffer rectangle, they are
+           *  calculated in full.
+           */
+          if (! context->mask &&
+              ! gegl_rectangle_contains (&context->buffer_rect, &cell->rect))
+            {
+              gegl_rectangle_intersect (&cell->rect,
+                                        &cell->rect, &context->buffer_rect);
+
+              cell->index = -1;
+            }
+          else
+            {
+              cell->index  = index;
+              cell->serial = grid->cells[index].serial;
+
+              if (grid->cells[index].values)
+                {
+                  cell->values =
+                    g_atomic_rc_box_acquire (grid->cells[index].values);
+                }
+            }
+
+          if (! cell->values)
+            gegl_rectangle_bounding_box (dirty_rect, dirty_rect, &cell->rect);
+        }
+    }
+
+  g_mutex_unlock (&cache->mutex);
+}
+
+/*  stores the values of the cells calculated by @context in @cache,
+ *  unless they were invalidated in the meantime
+ */
+static void
+gimp_histogram_cache_store (GimpHistogramCache *cache,
+                            CalculateContext   *context)
+{
+  CacheGrid *grid;
+  gint       i;
+
+  g_mutex_lock (&cache->mutex);
+
+  grid = gimp_histogram_cache_get_grid (cache, context);
+
+  if (grid->generation == context->generation)
+    {
+      grid->n_values = (context->n_components + N_DERIVED_CHANNELS) *
+                       context->n_bins;
+
+      for (i = 0; i < context->n_cells; i++)
+        {
+          CalculateCell *cell = &context->cells[i];
+          CacheCell     *cache_cell;
+
+          if (cell->index < 0 || ! cell->values)
+            continue;
+
+          cache_cell = &grid->cells[cell->index];
+
+          if (cache_cell->serial == cell->serial && ! cache_cell->values)
+            cache_cell->values = g_atomic_rc_box_acquire (cell->values);
+        }
+    }
+
+  g_mutex_unlock (&cache->mutex);
+}
+
+static void
+gimp_histogram_cache_grid_invalidate (CacheGrid           *grid,
+                                      const GeglRectangle *rect)
+{
+  GeglRectangle area;
+  gint          column1, column2;
+  gint          row1, row2;
+  gint          column;
+  gint          row;
+
+  if (! grid->cells)
+    return;
+
+  if (! rect)
+    rect = &grid->extent;
+
+  if (! gegl_rectangle_intersect (&area, rect, &grid->extent))
+    return;
+
+  column1 = (area.x                  - grid->extent.x) / CACHE_CELL_SIZE;
+  column2 = (area.x + area.width  - 1 - grid->extent.x) / CACHE_CELL_SIZE;
+  row1    = (area.y                  - grid->extent.y) / CACHE_CELL_SIZE;
+  row2    = (area.y + area.height - 1 - grid->extent.y) / CACHE_CELL_SIZE;
+
+  for (row = row1; row <= row2; row++)
+    {
+      for (column = column1; column <= column2; column++)
+        {
+          CacheCell *cell = &grid->cells[row * grid->n_columns + column];
+
+          cell->serial++;
+
+          g_clear_pointer (&cell->values, g_atomic_rc_box_release);
+        }
+    }
+}
+
+static void
+gimp_histogram_cache_grid_clear (CacheGrid *grid)
+{
+  gint i;
+
+  for (i = 0; i < grid->n_columns * grid->n_rows; i++)
+    {
+      if (grid->cells[i].values)
+        g_atomic_rc_box_release (grid->cells[i].values);
+    }
+
+  g_clear_pointer (&grid->cells, g_free);
+
+  grid->n_columns = 0;
+  grid->n_rows    = 0;
+}
+
 guint
 gimp_histogram_unique_colors (GimpDrawable *drawable)
 {
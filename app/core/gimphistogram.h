@@ -53,11 +53,13 @@ GimpHistogram * gimp_histogram_new             (GimpTRCType           trc);
 GimpHistogram * gimp_histogram_duplicate       (GimpHistogram        *histogram);
 
 void            gimp_histogram_calculate       (GimpHistogram        *histogram,
+                                                GimpHistogramCache   *cache,
                                                 GeglBuffer           *buffer,
                                                 const GeglRectangle  *buffer_rect,
                                                 GeglBuffer           *mask,
                                                 const GeglRectangle  *mask_rect);
 GimpAsync     * gimp_histogram_calculate_async (GimpHistogram        *histogram,
+                                                GimpHistogramCache   *cache,
                                                 GeglBuffer           *buffer,
                                                 const GeglRectangle  *buffer_rect,
                                                 GeglBuffer           *mask,
@@ -99,3 +101,15 @@ gint            gimp_histogram_n_bins          (GimpHistogram        *histogram)
 gboolean        gimp_histogram_has_channel     (GimpHistogram        *histogram,
                                                 GimpHistogramChannel  channel);
 guint           gimp_histogram_unique_colors   (GimpDrawable         *drawable);
+
+
+GimpHistogramCache * gimp_histogram_cache_new             (void);
+GimpHistogramCache * gimp_histogram_cache_ref             (GimpHistogramCache  *cache);
+void                 gimp_histogram_cache_unref           (GimpHistogramCache  *cache);
+
+void                 gimp_histogram_cache_invalidate      (GimpHistogramCache  *cache,
+                                                           const GeglRectangle *rect);
+void                 gimp_histogram_cache_invalidate_mask (GimpHistogramCache  *cache,
+                                                           const GeglRectangle *rect);
+
+gint64               gimp_histogram_cache_get_memsize     (GimpHistogramCache  *cache);
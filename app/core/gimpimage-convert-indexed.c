@@ -157,6 +157,8 @@
 #include "gegl/gimp-gegl-utils.h"
 
 #include "gimp.h"
+#include "gimp-parallel.h"
+#include "gimpasync.h"
 #include "gimpcontainer.h"
 #include "gimpdrawable.h"
 #include "gimperror.h"
@@ -169,6 +171,7 @@
 #include "gimpobjectqueue.h"
 #include "gimppalette.h"
 #include "gimpprogress.h"
+#include "gimpwaitable.h"
 
 #include "text/gimptextlayer.h"
 
@@ -293,6 +296,13 @@ typedef double etype;
 
 #define REF_FUNC(r,g,b) (((r)<<(PRECISION_G+PRECISION_B)) | ((g)<<(PRECISION_B)) | (b))
 
+#define REF_R(ref) ((ref) >> (PRECISION_G+PRECISION_B))
+#define REF_G(ref) (((ref) >> (PRECISION_B)) & (HIST_G_ELEMS-1))
+#define REF_B(ref) ((ref) & (HIST_B_ELEMS-1))
+
+/* An index which doesn't refer to any histogram cell */
+#define REF_NONE G_MAXUINT32
+
 
 /* You even get to choose whether you want the accessor function
    implemented as a macro or an inline function.  Don't say I never
@@ -333,20 +343,12 @@ static const Babl *linear_to_gray_float_fish = NULL;
 static const Babl *lab_to_rgb_fish = NULL;
 
 static inline void
-rgb_to_unshifted_lin (const guchar  r,
-                      const guchar  g,
-                      const guchar  b,
+lab_to_unshifted_lin (const gfloat *lab,
                       gint         *hr,
                       gint         *hg,
                       gint         *hb)
 {
-  gint   or, og, ob;
-  gfloat rgb[3] = { r / 255.0, g / 255.0, b / 255.0 };
-  gfloat lab[3];
-
-  babl_process (rgb_to_lab_fish, rgb, lab, 1);
-
-  /* fprintf(stderr, " %d-%d-%d -> %0.3f,%0.3f,%0.3f ", r, g, b, sL, sa, sb);*/
+  gint or, og, ob;
 
   or = RINT(lab[0] * LRAT);
   og = RINT((lab[1] - LOWA) * ARAT);
@@ -359,6 +361,24 @@ rgb_to_unshifted_lin (const guchar  r,
   /*  fprintf(stderr, " %d:%d:%d ", *hr, *hg, *hb); */
 }
 
+static inline void
+rgb_to_unshifted_lin (const guchar  r,
+                      const guchar  g,
+                      const guchar  b,
+                      gint         *hr,
+                      gint         *hg,
+                      gint         *hb)
+{
+  gfloat rgb[3] = { r / 255.0, g / 255.0, b / 255.0 };
+  gfloat lab[3];
+
+  babl_process (rgb_to_lab_fish, rgb, lab, 1);
+
+  /* fprintf(stderr, " %d-%d-%d -> %0.3f,%0.3f,%0.3f ", r, g, b, sL, sa, sb);*/
+
+  lab_to_unshifted_lin (lab, hr, hg, hb);
+}
+
 static inline int
 gray_to_linear (const guchar i)
 {
@@ -484,6 +504,53 @@ HIST_RGB (ColorFreq  *hist_ptr,
 }
 
 
+/* Like rgb_to_lin(), but for a run of pixels, converted with a single
+ * babl call.  The histogram indexes of the pixels are stored in refs,
+ * and, if linear is not NULL, their linear RGB values (as returned by
+ * rgb_to_linear()) in linear.
+ */
+static void
+rgb_to_lin_run (const guchar *src,
+                gint          bpp,
+                gint          red_pix,
+                gint          green_pix,
+                gint          blue_pix,
+                gint          n_pixels,
+                guint32      *refs,
+                guint16      *linear)
+{
+  gfloat *rgb = g_new (gfloat, 3 * n_pixels);
+  gfloat *lab = g_new (gfloat, 3 * n_pixels);
+  gint    i;
+
+  for (i = 0; i < n_pixels; i++)
+    {
+      rgb[3 * i + 0] = src[red_pix]   / 255.0f;
+      rgb[3 * i + 1] = src[green_pix] / 255.0f;
+      rgb[3 * i + 2] = src[blue_pix]  / 255.0f;
+
+      src += bpp;
+    }
+
+  babl_process (rgb_to_lab_fish, rgb, lab, n_pixels);
+
+  if (linear)
+    babl_process (rgb_to_linear_fish, rgb, linear, n_pixels);
+
+  for (i = 0; i < n_pixels; i++)
+    {
+      gint hr, hg, hb;
+
+      lab_to_unshifted_lin (lab + 3 * i, &hr, &hg, &hb);
+
+      refs[i] = REF_FUNC (RSDF (hr), GSDF (hg), BSDF (hb));
+    }
+
+  g_free (rgb);
+  g_free (lab);
+}
+
+
 static inline void
 lin_to_rgb (const gdouble  hr,
             const gdouble  hg,
@@ -1248,210 +1315,362 @@ check_white_or_black (const guchar *data)
     had_black = TRUE;
 }
 
+/*  The RGB histogram is built in parallel.  The layer is divided into
+ *  chunks, each a run of tiles within a single row of tiles, and each
+ *  chunk collects the distinct colors it contains, in the order of their
+ *  first appearance, along with their counts.  The chunks are then
+ *  merged into the histogram in the order in which a single
+ *  GeglBufferIterator would visit their pixels, so that the found colors,
+ *  and hence the generated palette, are exactly the same as when the
+ *  layer is scanned on a single thread.
+ */
+#define HISTOGRAM_CHUNK_AREA (256 * 256)
+#define HISTOGRAM_BATCH_AREA (64 * HISTOGRAM_CHUNK_AREA)
+
+typedef struct
+{
+  guint32 rgb;   /* packed R'G'B' value                           */
+  guint32 ref;   /* index of its histogram cell                   */
+  guint64 count; /* number of opaque pixels of this color         */
+  gint    step;  /* iterator step in which it first appears       */
+} HistogramColor;
+
+typedef struct
+{
+  GeglRectangle  rect;
+  GArray        *colors;     /* HistogramColor, in order of appearance */
+  gint           white_step; /* last iterator step with white, or -1   */
+  gint           black_step; /* last iterator step with black, or -1   */
+} HistogramChunk;
+
+typedef struct
+{
+  GeglBuffer     *buffer;
+  const Babl     *format;
+  gint            offsetx;
+  gint            offsety;
+  gboolean        dither_alpha;
+  HistogramChunk *chunks;
+} HistogramData;
+
+
+static inline gint
+floor_mod (gint a,
+           gint b)
+{
+  return ((a % b) + b) % b;
+}
+
+static HistogramChunk *
+histogram_chunks_new (GeglBuffer *buffer,
+                      gint       *n_chunks)
+{
+  const GeglRectangle *extent = gegl_buffer_get_extent (buffer);
+  GArray              *chunks;
+  gint                 tile_width, tile_height;
+  gint                 shift_x, shift_y;
+  gint                 run_width;
+  gint                 x, y;
+
+  g_object_get (buffer,
+                "shift-x",     &shift_x,
+                "shift-y",     &shift_y,
+                "tile-width",  &tile_width,
+                "tile-height", &tile_height,
+                NULL);
+
+  run_width = MAX (HISTOGRAM_CHUNK_AREA / (tile_width * tile_height), 1) *
+              tile_width;
+
+  chunks = g_array_new (FALSE, FALSE, sizeof (HistogramChunk));
+
+  for (y = extent->y; y < extent->y + extent->height; )
+    {
+      gint y2 = y - floor_mod (y + shift_y, tile_height) + tile_height;
+
+      y2 = MIN (y2, extent->y + extent->height);
+
+      for (x = extent->x; x < extent->x + extent->width; )
+        {
+          HistogramChunk chunk = { 0, };
+          gint           x2;
+
+          x2 = x - floor_mod (x + shift_x, tile_width) + run_width;
+          x2 = MIN (x2, extent->x + extent->width);
+
+          chunk.rect       = *GEGL_RECTANGLE (x, y, x2 - x, y2 - y);
+          chunk.white_step = -1;
+          chunk.black_step = -1;
+
+          g_array_append_val (chunks, chunk);
+
+          x = x2;
+        }
+
+      y = y2;
+    }
+
+  *n_chunks = chunks->len;
+
+  return (HistogramChunk *) g_array_free (chunks, FALSE);
+}
+
 static void
-generate_histogram_rgb (CFHistogram   histogram,
-                        GimpLayer    *layer,
-                        gint          col_limit,
-                        gboolean      dither_alpha,
-                        GimpProgress *progress)
+histogram_chunk_scan (HistogramChunk *chunk,
+                      HistogramData  *data)
 {
   GeglBufferIterator *iter;
-  const Babl         *format;
   GeglRectangle      *roi;
-  ColorFreq          *colfreq;
-  gint                nfc_iter;
-  gint                row, col, coledge;
-  gint                offsetx, offsety;
-  gint64              layer_size;
-  gint64              total_size = 0;
-  gint                count      = 0;
+  GHashTable         *indices;
   gint                bpp;
   gboolean            has_alpha;
+  guint32             last_rgb = G_MAXUINT32;
+  gint                last_i   = -1;
+  gint                step;
 
-  format = gimp_drawable_get_format (GIMP_DRAWABLE (layer));
-
-  g_return_if_fail (format == babl_format_with_space ("R'G'B' u8", format) ||
-                    format == babl_format_with_space ("R'G'B'A u8", format));
-
-  bpp       = babl_format_get_bytes_per_pixel (format);
-  has_alpha = babl_format_has_alpha (format);
-
-  gimp_item_get_offset (GIMP_ITEM (layer), &offsetx, &offsety);
+  bpp       = babl_format_get_bytes_per_pixel (data->format);
+  has_alpha = babl_format_has_alpha (data->format);
 
-  layer_size = (gimp_item_get_width  (GIMP_ITEM (layer)) *
-                gimp_item_get_height (GIMP_ITEM (layer)));
+  chunk->colors = g_array_new (FALSE, FALSE, sizeof (HistogramColor));
 
-  /*  g_printerr ("col_limit = %d, nfc = %d\n", col_limit, num_found_cols); */
+  /* maps packed colors to their index in chunk->colors, plus one */
+  indices = g_hash_table_new (NULL, NULL);
 
-  iter = gegl_buffer_iterator_new (gimp_drawable_get_buffer (GIMP_DRAWABLE (layer)),
-                                   NULL, 0, format,
+  iter = gegl_buffer_iterator_new (data->buffer, &chunk->rect, 0,
+                                   data->format,
                                    GEGL_ACCESS_READ, GEGL_ABYSS_NONE, 1);
   roi = &iter->items[0].roi;
 
-  if (progress)
-    gimp_progress_set_value (progress, 0.0);
-
-  while (gegl_buffer_iterator_next (iter))
+  for (step = 0; gegl_buffer_iterator_next (iter); step++)
     {
-      const guchar *data   = iter->items[0].data;
-      gint          length = iter->length;
+      const guchar *src     = iter->items[0].data;
+      gint          length  = iter->length;
+      gint          col     = roi->x + data->offsetx;
+      gint          coledge = col + roi->width;
+      gint          row     = roi->y + data->offsety;
 
-      total_size += length;
-
-      /* g_printerr (" [%d,%d - %d,%d]", srcPR.x, src_roi->y, offsetx, offsety); */
-
-      if (needs_quantize)
+      while (length--)
         {
-          if (dither_alpha)
+          gboolean transparent = FALSE;
+
+          if (has_alpha)
             {
               /* if alpha-dithering,
                  we need to be deterministic w.r.t. offsets */
-
-              col = roi->x + offsetx;
-              coledge = col + roi->width;
-              row = roi->y + offsety;
-
-              while (length--)
+              if (data->dither_alpha)
                 {
-                  gboolean transparent = FALSE;
-
-                  if (has_alpha &&
-                      data[ALPHA] <
+                  if (src[ALPHA] <
                       DM[col & DM_WIDTHMASK][row & DM_HEIGHTMASK])
                     transparent = TRUE;
-
-                  if (! transparent)
-                    {
-                      colfreq = HIST_RGB (histogram,
-                                          data[RED],
-                                          data[GREEN],
-                                          data[BLUE]);
-                      check_white_or_black (data);
-                      (*colfreq)++;
-                    }
-
-                  col++;
-                  if (col == coledge)
-                    {
-                      col = roi->x + offsetx;
-                      row++;
-                    }
-
-                  data += bpp;
+                }
+              else
+                {
+                  if (src[ALPHA] <= 127)
+                    transparent = TRUE;
                 }
             }
-          else
+
+          if (! transparent)
             {
-              while (length--)
+              guint32 rgb = (src[RED] << 16) | (src[GREEN] << 8) | src[BLUE];
+
+              if (rgb != last_rgb)
                 {
-                  if ((has_alpha && ((data[ALPHA] > 127)))
-                      || (!has_alpha))
+                  last_i = GPOINTER_TO_INT (
+                    g_hash_table_lookup (indices,
+                                         GUINT_TO_POINTER (rgb))) - 1;
+
+                  if (last_i < 0)
                     {
-                      colfreq = HIST_RGB (histogram,
-                                          data[RED],
-                                          data[GREEN],
-                                          data[BLUE]);
-                      check_white_or_black (data);
-                      (*colfreq)++;
+                      HistogramColor color;
+                      gint           hr, hg, hb;
+
+                      rgb_to_lin (src[RED], src[GREEN], src[BLUE],
+                                  &hr, &hg, &hb);
+
+                      color.rgb   = rgb;
+                      color.ref   = REF_FUNC (hr, hg, hb);
+                      color.count = 0;
+                      color.step  = step;
+
+                      last_i = chunk->colors->len;
+
+                      g_array_append_val (chunk->colors, color);
+                      g_hash_table_insert (indices,
+                                           GUINT_TO_POINTER (rgb),
+                                           GINT_TO_POINTER (last_i + 1));
                     }
 
-                  data += bpp;
+                  last_rgb = rgb;
                 }
+
+              g_array_index (chunk->colors, HistogramColor, last_i).count++;
+
+              if (rgb == 0xffffff)
+                chunk->white_step = step;
+              else if (rgb == 0x000000)
+                chunk->black_step = step;
             }
+
+          col++;
+          if (col == coledge)
+            {
+              col = roi->x + data->offsetx;
+              row++;
+            }
+
+          src += bpp;
+        }
+    }
+
+  g_hash_table_unref (indices);
+}
+
+static void
+histogram_chunks_scan (gsize          offset,
+                       gsize          size,
+                       HistogramData *data)
+{
+  gsize i;
+
+  for (i = offset; i < offset + size; i++)
+    histogram_chunk_scan (&data->chunks[i], data);
+}
+
+static void
+histogram_chunk_merge (HistogramChunk *chunk,
+                       CFHistogram     histogram,
+                       gint            col_limit)
+{
+  gint  overflow_step = -1;
+  guint i;
+
+  for (i = 0; i < chunk->colors->len; i++)
+    {
+      HistogramColor *color = &g_array_index (chunk->colors,
+                                              HistogramColor, i);
+      guchar          rgb[3];
+      gint            nfc_iter;
+
+      histogram[color->ref] += color->count;
+
+      if (needs_quantize)
+        continue;
+
+      rgb[RED]   = color->rgb >> 16;
+      rgb[GREEN] = color->rgb >> 8;
+      rgb[BLUE]  = color->rgb;
+
+      for (nfc_iter = 0; nfc_iter < num_found_cols; nfc_iter++)
+        {
+          if ((rgb[RED]   == found_cols[nfc_iter][0]) &&
+              (rgb[GREEN] == found_cols[nfc_iter][1]) &&
+              (rgb[BLUE]  == found_cols[nfc_iter][2]))
+            break;
+        }
+
+      if (nfc_iter < num_found_cols)
+        continue;
+
+      /* Color was not in the table of existing colors */
+
+      num_found_cols++;
+
+      if (num_found_cols > col_limit)
+        {
+          /* There are more colors in the image than were allowed.
+           * We switch to plain histogram calculation with a view to
+           * quantizing at a later stage.
+           */
+          needs_quantize = TRUE;
+          overflow_step  = color->step;
         }
       else
         {
-          /* if alpha-dithering, we need to be deterministic w.r.t. offsets */
-          col = roi->x + offsetx;
-          coledge = col + roi->width;
-          row = roi->y + offsety;
+          /* Remember the new color we just found. */
+          found_cols[num_found_cols-1][0] = rgb[RED];
+          found_cols[num_found_cols-1][1] = rgb[GREEN];
+          found_cols[num_found_cols-1][2] = rgb[BLUE];
 
-          while (length--)
-            {
-              gboolean transparent = FALSE;
+          check_white_or_black (rgb);
+        }
+    }
 
-              if (has_alpha)
-                {
-                  if (dither_alpha)
-                    {
-                      if (data[ALPHA] <
-                          DM[col & DM_WIDTHMASK][row & DM_HEIGHTMASK])
-                        transparent = TRUE;
-                    }
-                  else
-                    {
-                      if (data[ALPHA] <= 127)
-                        transparent = TRUE;
-                    }
-                }
+  /* Once quantizing, every pixel of the following iterator steps is
+   * checked for being white or black.
+   */
+  if (needs_quantize)
+    {
+      if (chunk->white_step > overflow_step)
+        had_white = TRUE;
+      if (chunk->black_step > overflow_step)
+        had_black = TRUE;
+    }
 
-              if (! transparent)
-                {
-                  colfreq = HIST_RGB (histogram,
-                                      data[RED],
-                                      data[GREEN],
-                                      data[BLUE]);
-                  (*colfreq)++;
+  g_array_free (chunk->colors, TRUE);
+  chunk->colors = NULL;
+}
 
-                  if (!needs_quantize)
-                    {
-                      for (nfc_iter = 0;
-                           nfc_iter < num_found_cols;
-                           nfc_iter++)
-                        {
-                          if ((data[RED]   == found_cols[nfc_iter][0]) &&
-                              (data[GREEN] == found_cols[nfc_iter][1]) &&
-                              (data[BLUE]  == found_cols[nfc_iter][2]))
-                            goto already_found;
-                        }
+static void
+generate_histogram_rgb (CFHistogram   histogram,
+                        GimpLayer    *layer,
+                        gint          col_limit,
+                        gboolean      dither_alpha,
+                        GimpProgress *progress)
+{
+  HistogramData   data;
+  HistogramChunk *chunks;
+  gint            n_chunks;
+  gint            i, j;
+  gint64          layer_size;
+  gint64          total_size = 0;
 
-                      /* Color was not in the table of
-                       * existing colors
-                       */
+  data.buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (layer));
+  data.format = gimp_drawable_get_format (GIMP_DRAWABLE (layer));
 
-                      num_found_cols++;
+  g_return_if_fail (data.format == babl_format_with_space ("R'G'B' u8", data.format) ||
+                    data.format == babl_format_with_space ("R'G'B'A u8", data.format));
 
-                      if (num_found_cols > col_limit)
-                        {
-                          /* There are more colors in the image than
-                           *  were allowed.  We switch to plain
-                           *  histogram calculation with a view to
-                           *  quantizing at a later stage.
-                           */
-                          needs_quantize = TRUE;
-                          /* g_print ("\nmax colors exceeded - needs quantize.\n");*/
-                          goto already_found;
-                        }
-                      else
-                        {
-                          /* Remember the new color we just found.
-                           */
-                          found_cols[num_found_cols-1][0] = data[RED];
-                          found_cols[num_found_cols-1][1] = data[GREEN];
-                          found_cols[num_found_cols-1][2] = data[BLUE];
+  data.dither_alpha = dither_alpha;
 
-                          check_white_or_black (data);
-                        }
-                    }
-                }
-            already_found:
+  gimp_item_get_offset (GIMP_ITEM (layer), &data.offsetx, &data.offsety);
 
-              col++;
-              if (col == coledge)
-                {
-                  col = roi->x + offsetx;
-                  row++;
-                }
+  layer_size = (gimp_item_get_width  (GIMP_ITEM (layer)) *
+                gimp_item_get_height (GIMP_ITEM (layer)));
 
-              data += bpp;
-            }
+  chunks = histogram_chunks_new (data.buffer, &n_chunks);
+
+  if (progress)
+    gimp_progress_set_value (progress, 0.0);
+
+  for (i = 0; i < n_chunks; i = j)
+    {
+      gint64 batch_size = 0;
+
+      for (j = i; j < n_chunks && batch_size < HISTOGRAM_BATCH_AREA; j++)
+        batch_size += (gint64) chunks[j].rect.width * chunks[j].rect.height;
+
+      data.chunks = chunks + i;
+
+      gegl_parallel_distribute_range (
+        j - i, 1,
+        (GeglParallelDistributeRangeFunc) histogram_chunks_scan,
+        &data);
+
+      for (; i < j; i++)
+        {
+          total_size += (gint64) chunks[i].rect.width * chunks[i].rect.height;
+
+          histogram_chunk_merge (&chunks[i], histogram, col_limit);
         }
 
-      if (progress && (count % 16 == 0))
+      if (progress)
         gimp_progress_set_value (progress,
                                  (gdouble) total_size / (gdouble) layer_size);
     }
 
+  g_free (chunks);
+
 /*  g_print ("O: col_limit = %d, nfc = %d\n", col_limit, num_found_cols);*/
 }
 
@@ -2844,6 +3063,75 @@ fill_inverse_cmap_rgb (QuantizeObj *quantobj,
 }
 
 
+/* Fill the inverse-colormap entries of the given histogram cells, in
+ * parallel.  Cells which are already filled, or listed more than once,
+ * are only filled once; REF_NONE entries are ignored.  Since each update
+ * box is a single cell, the threads never write to the same entry.
+ */
+#define INVERSE_CMAP_MIN_CELLS 64
+
+typedef struct
+{
+  QuantizeObj *quantobj;
+  CFHistogram  histogram;
+  guint32     *cells;
+} InverseCmapData;
+
+static void
+fill_inverse_cmap_rgb_range (gsize            offset,
+                             gsize            size,
+                             InverseCmapData *data)
+{
+  gsize i;
+
+  for (i = offset; i < offset + size; i++)
+    {
+      guint32 ref = data->cells[i];
+
+      fill_inverse_cmap_rgb (data->quantobj, data->histogram,
+                             REF_R (ref), REF_G (ref), REF_B (ref));
+    }
+}
+
+static void
+fill_inverse_cmap_rgb_cells (QuantizeObj   *quantobj,
+                             CFHistogram    histogram,
+                             const guint32 *cells,
+                             gint           n_cells)
+{
+  InverseCmapData data;
+  gint            n_missing = 0;
+  gint            i;
+
+  data.quantobj  = quantobj;
+  data.histogram = histogram;
+  data.cells     = g_new (guint32, n_cells);
+
+  for (i = 0; i < n_cells; i++)
+    {
+      if (cells[i] != REF_NONE && histogram[cells[i]] == 0)
+        {
+          /* mark the cell, so that it's only listed once; it is
+           * overwritten with the actual entry below.
+           */
+          histogram[cells[i]] = G_MAXUINT64;
+
+          data.cells[n_missing++] = cells[i];
+        }
+    }
+
+  if (n_missing > 0)
+    {
+      gegl_parallel_distribute_range (
+        n_missing, INVERSE_CMAP_MIN_CELLS,
+        (GeglParallelDistributeRangeFunc) fill_inverse_cmap_rgb_range,
+        &data);
+    }
+
+  g_free (data.cells);
+}
+
+
 /*  This is pass 1  */
 
 static void
@@ -3252,14 +3540,13 @@ median_cut_pass2_no_dither_rgb (QuantizeObj *quantobj,
 {
   GeglBufferIterator *iter;
   CFHistogram         histogram = quantobj->histogram;
-  ColorFreq          *cachep;
   const Babl         *src_format;
   const Babl         *dest_format;
   GeglRectangle      *src_roi;
+  guint32            *refs;
   gint                src_bpp;
   gint                dest_bpp;
   gint                has_alpha;
-  gint                R, G, B;
   gint                red_pix          = RED;
   gint                green_pix        = GREEN;
   gint                blue_pix         = BLUE;
@@ -3306,17 +3593,28 @@ median_cut_pass2_no_dither_rgb (QuantizeObj *quantobj,
     {
       const guchar *src  = iter->items[0].data;
       guchar       *dest = iter->items[1].data;
+      guint32      *ref;
       gint          row;
 
       total_size += src_roi->height * src_roi->width;
 
-      for (row = 0; row < src_roi->height; row++)
+      /* get the pixel values' indexes into the cache, and fill the
+       * colormap entries of the colors we have not seen before
+       */
+      refs = g_new (guint32, iter->length);
+
+      rgb_to_lin_run (src, src_bpp, red_pix, green_pix, blue_pix,
+                      iter->length, refs, NULL);
+
+      if (has_alpha)
         {
-          gint col;
+          ref = refs;
 
-          for (col = 0; col < src_roi->width; col++)
+          for (row = 0; row < src_roi->height; row++)
             {
-              if (has_alpha)
+              gint col;
+
+              for (col = 0; col < src_roi->width; col++)
                 {
                   gboolean transparent = FALSE;
 
@@ -3337,35 +3635,35 @@ median_cut_pass2_no_dither_rgb (QuantizeObj *quantobj,
                   if (transparent)
                     {
                       dest[ALPHA_I] = 0;
-                      goto next_pixel;
+                      *ref = REF_NONE;
                     }
                   else
                     {
                       dest[ALPHA_I] = 255;
                     }
-                }
 
-              /* get pixel value and index into the cache */
-              rgb_to_lin (src[red_pix], src[green_pix], src[blue_pix],
-                          &R, &G, &B);
+                  src  += src_bpp;
+                  dest += dest_bpp;
+                  ref++;
+                }
+            }
 
-              cachep = HIST_LIN (histogram, R, G, B);
-              /* If we have not seen this color before, find nearest
-               * colormap entry and update the cache
-               */
-              if (*cachep == 0)
-                fill_inverse_cmap_rgb (quantobj, histogram, R, G, B);
+          dest = iter->items[1].data;
+        }
 
-              /* Now emit the colormap index for this cell, barfbarf */
-              index_used_count[dest[INDEXED] = *cachep - 1]++;
+      fill_inverse_cmap_rgb_cells (quantobj, histogram, refs, iter->length);
 
-            next_pixel:
+      for (ref = refs; ref < refs + iter->length; ref++)
+        {
+          /* Now emit the colormap index for this cell, barfbarf */
+          if (*ref != REF_NONE)
+            index_used_count[dest[INDEXED] = histogram[*ref] - 1]++;
 
-              src  += src_bpp;
-              dest += dest_bpp;
-            }
+          dest += dest_bpp;
         }
 
+      g_free (refs);
+
       if (quantobj->progress && (count % 16 == 0))
          gimp_progress_set_value (quantobj->progress,
                                   (gdouble) total_size / (gdouble) layer_size);
@@ -4033,12 +4331,99 @@ median_cut_pass2_gray_init (QuantizeObj *quantobj)
 }
 
 
+/*  Floyd-Steinberg dithering is inherently sequential, but much of the
+ *  per-pixel work isn't.  The layer is dithered in batches of rows, and
+ *  while one batch is being dithered, the next one is read and converted
+ *  to linear RGB in the background.  Before a batch is dithered, the
+ *  colormap entries of its undithered colors, which are the ones most
+ *  likely to be looked up, are filled in parallel.
+ */
+#define FS_DITHER_BATCH_ROWS 32
+
+typedef struct
+{
+  GeglBuffer *buffer;
+  gint        width;
+  gint        y;
+  gint        height;
+  gint        bpp;
+  gint        red_pix;
+  gint        green_pix;
+  gint        blue_pix;
+  gboolean    has_alpha;
+  guchar     *src;    /* the source pixels                       */
+  guint16    *linear; /* their linear RGB values                 */
+  guint32    *refs;   /* their histogram cells, or REF_NONE      */
+} DitherBatch;
+
+static void
+fs_dither_batch_convert_rows (gsize        offset,
+                              gsize        size,
+                              DitherBatch *batch)
+{
+  gsize row;
+
+  for (row = offset; row < offset + size; row++)
+    {
+      const guchar *src  = batch->src  + row * batch->width * batch->bpp;
+      guint32      *refs = batch->refs + row * batch->width;
+      gint          col;
+
+      rgb_to_lin_run (src, batch->bpp,
+                      batch->red_pix, batch->green_pix, batch->blue_pix,
+                      batch->width, refs,
+                      batch->linear + row * batch->width * 3);
+
+      if (batch->has_alpha)
+        {
+          for (col = 0; col < batch->width; col++)
+            {
+              /* alpha is the last component, for gray layers too */
+              if (src[(col + 1) * batch->bpp - 1] == 0)
+                refs[col] = REF_NONE;
+            }
+        }
+    }
+}
+
+static void
+fs_dither_batch_prepare (GimpAsync   *async,
+                         DitherBatch *batch)
+{
+  gegl_buffer_get (batch->buffer,
+                   GEGL_RECTANGLE (0, batch->y, batch->width, batch->height),
+                   1.0, NULL, batch->src,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  gegl_parallel_distribute_range (
+    batch->height, 1,
+    (GeglParallelDistributeRangeFunc) fs_dither_batch_convert_rows,
+    batch);
+
+  gimp_async_finish (async, NULL);
+}
+
+static GimpAsync *
+fs_dither_batch_start (DitherBatch *batch,
+                       gint         y,
+                       gint         height)
+{
+  batch->y      = y;
+  batch->height = MIN (FS_DITHER_BATCH_ROWS, height - y);
+
+  return gimp_parallel_run_async ((GimpRunAsyncFunc) fs_dither_batch_prepare,
+                                  batch);
+}
+
 static void
 median_cut_pass2_fs_dither_rgb (QuantizeObj *quantobj,
                                 GimpLayer   *layer,
                                 GeglBuffer  *new_buffer)
 {
   GeglBuffer   *src_buffer;
+  GimpAsync    *async;
+  DitherBatch   batches[2];
+  DitherBatch  *batch;
   CFHistogram   histogram = quantobj->histogram;
   ColorFreq    *cachep;
   Color        *linearcolor;
@@ -4046,7 +4431,7 @@ median_cut_pass2_fs_dither_rgb (QuantizeObj *quantobj,
   const Babl   *dest_format;
   gint          src_bpp;
   gint          dest_bpp;
-  guchar       *src_buf, *dest_buf;
+  guchar       *dest_buf;
   gint         *red_n_row, *red_p_row;
   gint         *grn_n_row, *grn_p_row;
   gint         *blu_n_row, *blu_p_row;
@@ -4056,6 +4441,7 @@ median_cut_pass2_fs_dither_rgb (QuantizeObj *quantobj,
   gint         *tmp;
   gint          re, ge, be;
   gint          row, col;
+  gint          batch_row;
   gint          index;
   gint          step_dest, step_src;
   gint          odd_row;
@@ -4107,8 +4493,23 @@ median_cut_pass2_fs_dither_rgb (QuantizeObj *quantobj,
       global_bmin = MIN(global_bmin, quantobj->clin[index].blue);
     }
 
-  src_buf  = g_malloc (width * src_bpp);
-  dest_buf = g_malloc (width * dest_bpp);
+  for (index = 0; index < G_N_ELEMENTS (batches); index++)
+    {
+      batch = &batches[index];
+
+      batch->buffer    = src_buffer;
+      batch->width     = width;
+      batch->bpp       = src_bpp;
+      batch->red_pix   = red_pix;
+      batch->green_pix = green_pix;
+      batch->blue_pix  = blue_pix;
+      batch->has_alpha = has_alpha;
+      batch->src       = g_new (guchar,  width * FS_DITHER_BATCH_ROWS * src_bpp);
+      batch->linear    = g_new (guint16, width * FS_DITHER_BATCH_ROWS * 3);
+      batch->refs      = g_new (guint32, width * FS_DITHER_BATCH_ROWS);
+    }
+
+  dest_buf = g_malloc (width * FS_DITHER_BATCH_ROWS * dest_bpp);
 
   red_n_row = g_new (gint, width + 2);
   red_p_row = g_new0 (gint, width + 2);
@@ -4119,17 +4520,53 @@ median_cut_pass2_fs_dither_rgb (QuantizeObj *quantobj,
 
   odd_row = 0;
 
+  batch = &batches[0];
+  async = height > 0 ? fs_dither_batch_start (batch, 0, height) : NULL;
+
   for (row = 0; row < height; row++)
     {
-      const guchar *src;
-      guchar       *dest;
+      const guchar  *src;
+      const guint16 *lin;
+      guchar        *dest;
+      gint           step_lin;
 
-      gegl_buffer_get (src_buffer, GEGL_RECTANGLE (0, row, width, 1),
-                       1.0, NULL, src_buf,
-                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+      batch_row = row % FS_DITHER_BATCH_ROWS;
 
-      src  = src_buf;
-      dest = dest_buf;
+      if (batch_row == 0)
+        {
+          gimp_waitable_wait (GIMP_WAITABLE (async));
+          g_object_unref (async);
+
+          batch = &batches[(row / FS_DITHER_BATCH_ROWS) % 2];
+
+          /* read the next batch while dithering this one */
+          if (row + FS_DITHER_BATCH_ROWS < height)
+            {
+              async = fs_dither_batch_start (&batches[(row / FS_DITHER_BATCH_ROWS + 1) % 2],
+                                             row + FS_DITHER_BATCH_ROWS,
+                                             height);
+            }
+          else
+            {
+              async = NULL;
+            }
+
+          fill_inverse_cmap_rgb_cells (quantobj, histogram,
+                                       batch->refs,
+                                       width * batch->height);
+        }
+
+      src  = batch->src    + batch_row * width * src_bpp;
+      lin  = batch->linear + batch_row * width * 3;
+      dest = dest_buf      + batch_row * width * dest_bpp;
+
+      /* transparent pixels keep the indexes of the previous row */
+      if (row > 0)
+        {
+          memcpy (dest,
+                  dest_buf + ((row - 1) % FS_DITHER_BATCH_ROWS) * width * dest_bpp,
+                  width * dest_bpp);
+        }
 
       rnr = red_n_row;
       gnr = grn_n_row;
@@ -4142,9 +4579,11 @@ median_cut_pass2_fs_dither_rgb (QuantizeObj *quantobj,
         {
           step_dest = -dest_bpp;
           step_src  = -src_bpp;
+          step_lin  = -3;
 
           src += (width * src_bpp) - src_bpp;
           dest += (width * dest_bpp) - dest_bpp;
+          lin += (width * 3) - 3;
 
           rnr += width + 1;
           gnr += width + 1;
@@ -4159,6 +4598,7 @@ median_cut_pass2_fs_dither_rgb (QuantizeObj *quantobj,
         {
           step_dest = dest_bpp;
           step_src  = src_bpp;
+          step_lin  = 3;
 
           *(rnr + 1) = *(gnr + 1) = *(bnr + 1) = 0;
         }
@@ -4231,8 +4671,9 @@ median_cut_pass2_fs_dither_rgb (QuantizeObj *quantobj,
                 }
             }
 
-          rgb_to_linear (src[red_pix], src[green_pix], src[blue_pix],
-                         &re, &ge, &be);
+          re = lin[0];
+          ge = lin[1];
+          be = lin[2];
 
           *rpr = error_limit_16 (quantobj->error_freedom, *rpr);
           *gpr = error_limit_16 (quantobj->error_freedom, *gpr);
@@ -4320,6 +4761,7 @@ median_cut_pass2_fs_dither_rgb (QuantizeObj *quantobj,
 
           dest += step_dest;
           src += step_src;
+          lin += step_lin;
         }
 
       tmp = red_n_row;
@@ -4336,13 +4778,17 @@ median_cut_pass2_fs_dither_rgb (QuantizeObj *quantobj,
 
       odd_row = !odd_row;
 
-      gegl_buffer_set (new_buffer, GEGL_RECTANGLE (0, row, width, 1),
-                       0, NULL, dest_buf,
-                       GEGL_AUTO_ROWSTRIDE);
-
-      if (quantobj->progress && (row % 16 == 0))
-        gimp_progress_set_value (quantobj->progress,
-                                 (gdouble) row / (gdouble) height);
+      if (batch_row == batch->height - 1)
+        {
+          gegl_buffer_set (new_buffer,
+                           GEGL_RECTANGLE (0, batch->y, width, batch->height),
+                           0, NULL, dest_buf,
+                           GEGL_AUTO_ROWSTRIDE);
+
+          if (quantobj->progress)
+            gimp_progress_set_value (quantobj->progress,
+                                     (gdouble) row / (gdouble) height);
+        }
     }
 
   g_free (red_n_row);
@@ -4351,7 +4797,13 @@ median_cut_pass2_fs_dither_rgb (QuantizeObj *quantobj,
   g_free (grn_p_row);
   g_free (blu_n_row);
   g_free (blu_p_row);
-  g_free (src_buf);
+  for (index = 0; index < G_N_ELEMENTS (batches); index++)
+    {
+      g_free (batches[index].src);
+      g_free (batches[index].linear);
+      g_free (batches[index].refs);
+    }
+
   g_free (dest_buf);
 }
 
@@ -20,6 +20,8 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <gegl.h>
 
@@ -46,6 +48,19 @@
 
 #include "gimp-intl.h"
 
+
+#define PIXELS_PER_THREAD            (/* each thread costs as much as */ 64.0 * 64.0 /* pixels */)
+
+/* minimal height of the bands of rows denoised in parallel */
+#define DENOISE_MIN_BAND_HEIGHT      64
+
+/* number of key points per chunk of the spline candidates search */
+#define SPLINE_CANDIDATES_CHUNK_SIZE 64
+
+/* number of edgels processed between checks for cancellation */
+#define EDGELS_PER_CANCEL_CHECK      4096
+
+
 enum
 {
   COMPUTING_START,
@@ -147,6 +162,90 @@ typedef struct _Edgel
   guint     next, previous;
 } Edgel;
 
+/* The edgels of pixel i are the ones from edgels[pixel_edgels[i]] to
+ * edgels[pixel_edgels[i + 1] - 1].
+ */
+typedef struct _EdgelSet
+{
+  Edgel *edgels;
+  guint  n_edgels;
+  guint *pixel_edgels;
+} EdgelSet;
+
+/* A binary (or marked) line art, 1 byte per pixel. */
+typedef struct _LineArtMask
+{
+  guchar *data;
+  gint    width;
+  gint    height;
+} LineArtMask;
+
+/* A horizontal run of stroke pixels, in [start, end). */
+typedef struct _LineArtRun
+{
+  gint start;
+  gint end;
+} LineArtRun;
+
+/* Data of the parallel stages of the closing algorithm. */
+
+typedef struct
+{
+  LineArtMask *mask;
+  gboolean     select_transparent;
+  guchar       threshold;
+  guchar      *row_max;
+  guchar       max_value;
+} LineArtBinarize;
+
+typedef struct
+{
+  LineArtMask *mask;
+  gint         minimum_area;
+  gint         band_height;
+  gint        *row_offsets;
+  LineArtRun  *runs;
+  gint        *parents;
+  gint        *areas;
+} LineArtDenoise;
+
+typedef struct
+{
+  const LineArtMask *mask;
+  EdgelSet          *set;
+  guint             *row_edgels;
+  const gfloat      *weights;
+  gint               mask_size;
+  gfloat            *curvatures;
+  GimpAsync         *async;
+} EdgelSetPass;
+
+typedef struct
+{
+  const LineArtMask *mask;
+  const EdgelSet    *set;
+  gfloat            *edgel_curvatures;
+  gfloat            *normals;
+  gfloat            *curvatures;
+  gfloat            *smoothed_curvatures;
+  const gfloat      *dist;
+  gfloat            *radii;
+  gfloat             threshold;
+  GimpAsync         *async;
+} LineArtPixelPass;
+
+typedef struct
+{
+  GArray      *max_positions;
+  gfloat      *normals;
+  gint         width;
+  gint         distance_threshold;
+  gfloat       cos_min;
+  gint         n_chunks;
+  GArray     **chunks;
+  GimpAsync   *async;
+} SplineCandidatesPass;
+
 
 static void            gimp_line_art_finalize                  (GObject               *object);
 static void            gimp_line_art_set_property              (GObject                *object,
@@ -201,16 +300,19 @@ static GeglBuffer    * gimp_line_art_close                     (GeglBuffer
                                                                 gfloat                **lineart_distmap,
                                                                 GimpAsync              *async);
 
-static void            gimp_lineart_denoise                    (GeglBuffer             *buffer,
+static void            gimp_lineart_binarize                   (LineArtMask            *mask,
+                                                                gboolean                select_transparent,
+                                                                gdouble                 stroke_threshold);
+static void            gimp_lineart_denoise                    (LineArtMask            *mask,
                                                                 int                     size,
                                                                 GimpAsync              *async);
-static void            gimp_lineart_compute_normals_curvatures (GeglBuffer             *mask,
+static void            gimp_lineart_compute_normals_curvatures (const LineArtMask      *mask,
                                                                 gfloat                 *normals,
                                                                 gfloat                 *curvatures,
                                                                 gfloat                 *smoothed_curvatures,
                                                                 int                     normal_estimate_mask_size,
                                                                 GimpAsync              *async);
-static gfloat        * gimp_lineart_get_smooth_curvatures      (GArray                 *edgelset,
+static gfloat        * gimp_lineart_get_smooth_curvatures      (EdgelSet               *edgelset,
                                                                 GimpAsync              *async);
 static GArray        * gimp_lineart_curvature_extremums        (gfloat                 *curvatures,
                                                                 gfloat                 *smoothed_curvatures,
@@ -220,7 +322,7 @@ static GArray        * gimp_lineart_curvature_extremums        (gfloat
 static gint            gimp_spline_candidate_cmp               (const SplineCandidate  *a,
                                                                 const SplineCandidate  *b,
                                                                 gpointer                user_data);
-static GList         * gimp_lineart_find_spline_candidates     (GArray                 *max_positions,
+static GArray        * gimp_lineart_find_spline_candidates     (GArray                 *max_positions,
                                                                 gfloat                 *normals,
                                                                 gint                    width,
                                                                 gint                    distance_threshold,
@@ -233,30 +335,32 @@ static GArray        * gimp_lineart_discrete_spline            (Pixel
                                                                 GimpVector2             n1);
 
 static gint            gimp_number_of_transitions               (GArray                 *pixels,
-                                                                 GeglBuffer             *buffer);
-static gboolean        gimp_line_art_allow_closure              (GeglBuffer             *mask,
+                                                                 const LineArtMask      *mask);
+static gboolean        gimp_line_art_allow_closure              (LineArtMask            *mask,
                                                                  GArray                 *pixels,
-                                                                 GList                 **fill_pixels,
+                                                                 GArray                 *fill_pixels,
                                                                  int                     significant_size,
                                                                  int                     minimum_size);
-static GArray        * gimp_lineart_line_segment_until_hit      (const GeglBuffer       *buffer,
+static GArray        * gimp_lineart_line_segment_until_hit      (const LineArtMask      *mask,
                                                                  Pixel                   start,
                                                                  GimpVector2             direction,
                                                                  int                     size);
-static gfloat        * gimp_lineart_estimate_strokes_radii      (GeglBuffer             *mask,
+static gfloat        * gimp_lineart_estimate_strokes_radii      (const LineArtMask      *mask,
                                                                  GimpAsync              *async);
-static void            gimp_line_art_simple_fill                (GeglBuffer             *buffer,
+static void            gimp_lineart_threshold_curvatures        (const LineArtMask      *mask,
+                                                                 gfloat                 *curvatures,
+                                                                 gfloat                 *smoothed_curvatures,
+                                                                 const gfloat           *radii,
+                                                                 gfloat                  threshold);
+static gfloat        * gimp_lineart_distance_map                (GeglBuffer             *mask);
+static void            gimp_line_art_simple_fill                (LineArtMask            *mask,
                                                                  gint                    x,
                                                                  gint                    y,
                                                                  gint                   *counter);
 
 /* Some callback-type functions. */
 
-static guint           visited_hash_fun                         (Pixel                  *key);
-static gboolean        visited_equal_fun                        (Pixel                  *e1,
-                                                                 Pixel                  *e2);
-
-static inline gboolean border_in_direction                      (GeglBuffer             *mask,
+static inline gboolean border_in_direction                      (const LineArtMask      *mask,
                                                                  Pixel                   p,
                                                                  int                     direction);
 static inline GimpVector2 pair2normal                           (Pixel                   p,
@@ -265,46 +369,38 @@ static inline GimpVector2 pair2normal                           (Pixel
 
 /* Edgel */
 
-static Edgel    * gimp_edgel_new                  (int                x,
-                                                   int                y,
-                                                   Direction          direction);
 static void       gimp_edgel_init                 (Edgel             *edgel);
-static void       gimp_edgel_clear                (Edgel            **edgel);
 static int        gimp_edgel_cmp                  (const Edgel       *e1,
                                                    const Edgel       *e2);
-static guint      edgel2index_hash_fun            (Edgel              *key);
-static gboolean   edgel2index_equal_fun           (Edgel              *e1,
-                                                   Edgel              *e2);
 
-static glong      gimp_edgel_track_mark           (GeglBuffer         *mask,
+static glong      gimp_edgel_track_mark           (LineArtMask        *mask,
                                                    Edgel               edgel,
                                                    long                size_limit);
-static glong      gimp_edgel_region_area          (const GeglBuffer   *mask,
+static glong      gimp_edgel_region_area          (const LineArtMask  *mask,
                                                    Edgel               start_edgel);
 
 /* Edgel set */
 
-static GArray   * gimp_edgelset_new               (GeglBuffer         *buffer,
+static EdgelSet * gimp_edgelset_new               (const LineArtMask  *mask,
                                                    GimpAsync          *async);
-static void       gimp_edgelset_add               (GArray             *set,
+static void       gimp_edgelset_free              (EdgelSet           *set);
+static inline void gimp_edgelset_add              (EdgelSet           *set,
+                                                   guint               position,
                                                    int                 x,
                                                    int                 y,
-                                                   Direction           direction,
-                                                   GHashTable         *edgel2index);
-static void       gimp_edgelset_init_normals      (GArray             *set);
-static void       gimp_edgelset_smooth_normals    (GArray             *set,
+                                                   Direction           direction);
+static void       gimp_edgelset_smooth_normals    (EdgelSet           *set,
                                                    int                 mask_size,
                                                    GimpAsync          *async);
-static void       gimp_edgelset_compute_curvature (GArray             *set,
+static void       gimp_edgelset_compute_curvature (EdgelSet           *set,
                                                    GimpAsync          *async);
 
-static void       gimp_edgelset_build_graph       (GArray            *set,
-                                                   GeglBuffer        *buffer,
-                                                   GHashTable        *edgel2index,
-                                                   GimpAsync         *async);
-static void       gimp_edgelset_next8             (const GeglBuffer  *buffer,
-                                                   Edgel             *it,
-                                                   Edgel             *n);
+static void       gimp_edgelset_build_graph       (EdgelSet           *set,
+                                                   const LineArtMask  *mask,
+                                                   GimpAsync          *async);
+static void       gimp_edgelset_next8             (const LineArtMask  *mask,
+                                                   Edgel              *it,
+                                                   Edgel              *n);
 
 G_DEFINE_TYPE_WITH_CODE (GimpLineArt, gimp_line_art, GIMP_TYPE_OBJECT,
                          G_ADD_PRIVATE (GimpLineArt))
@@ -968,14 +1064,13 @@ gimp_line_art_close (GeglBuffer  *buffer,
                      gfloat     **closed_distmap,
                      GimpAsync   *async)
 {
-  const Babl         *gray_format;
-  GeglBufferIterator *gi;
-  GeglBuffer         *closed  = NULL;
-  GeglBuffer         *strokes = NULL;
-  guchar              max_value = 0;
-  gint                width  = gegl_buffer_get_width (buffer);
-  gint                height = gegl_buffer_get_height (buffer);
-  gint                i;
+  const Babl  *gray_format;
+  LineArtMask  strokes;
+  LineArtMask  closed;
+  GeglBuffer  *closed_buffer = NULL;
+  gint         width         = gegl_buffer_get_width (buffer);
+  gint         height        = gegl_buffer_get_height (buffer);
+  gint         i;
 
   if (select_transparent)
     /* Keep alpha channel as gray levels */
@@ -984,190 +1079,150 @@ gimp_line_art_close (GeglBuffer  *buffer,
     /* Keep luminance */
     gray_format = babl_format ("Y' u8");
 
-  /* Transform the line art from any format to gray. */
-  strokes = gegl_buffer_new (gegl_buffer_get_extent (buffer),
-                             gray_format);
-  gimp_gegl_buffer_copy (buffer, NULL, GEGL_ABYSS_NONE, strokes, NULL);
-  gegl_buffer_set_format (strokes, babl_format ("Y' u8"));
+  strokes.width  = width;
+  strokes.height = height;
+  strokes.data   = g_new (guchar, (gsize) width * height);
 
-  if (! select_transparent)
-    {
-      /* Compute the biggest value */
-      gi = gegl_buffer_iterator_new (strokes, NULL, 0, NULL,
-                                     GEGL_ACCESS_READ, GEGL_ABYSS_NONE, 1);
-      while (gegl_buffer_iterator_next (gi))
-        {
-          guchar *data = (guchar*) gi->items[0].data;
-          gint    k;
+  closed = strokes;
 
-          if (gimp_async_is_canceled (async))
-            {
-              gegl_buffer_iterator_stop (gi);
+  GIMP_TIMER_START();
 
-              gimp_async_abort (async);
+  /* Transform the line art from any format to gray. */
+  gegl_buffer_get (buffer, gegl_buffer_get_extent (buffer), 1.0,
+                   gray_format, strokes.data,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
 
-              goto end1;
-            }
+  /* Make the image binary: 1 is stroke, 0 background */
+  gimp_lineart_binarize (&strokes, select_transparent, stroke_threshold);
 
-          for (k = 0; k < gi->length; k++)
-            {
-              if (*data > max_value)
-                max_value = *data;
-              data++;
-            }
-        }
-    }
+  GIMP_TIMER_END("binarize");
 
-  /* Make the image binary: 1 is stroke, 0 background */
-  gi = gegl_buffer_iterator_new (strokes, NULL, 0, NULL,
-                                 GEGL_ACCESS_READWRITE, GEGL_ABYSS_NONE, 1);
-  while (gegl_buffer_iterator_next (gi))
+  if (gimp_async_is_canceled (async))
     {
-      guchar *data = (guchar*) gi->items[0].data;
-      gint    k;
+      gimp_async_abort (async);
 
-      if (gimp_async_is_canceled (async))
-        {
-          gegl_buffer_iterator_stop (gi);
+      goto end1;
+    }
 
-          gimp_async_abort (async);
+  GIMP_TIMER_START();
 
-          goto end1;
-        }
+  /* Denoise (remove small connected components) */
+  gimp_lineart_denoise (&strokes, minimal_lineart_area, async);
 
-      for (k = 0; k < gi->length; k++)
-        {
-          if (! select_transparent)
-            /* Negate the value. */
-            *data = max_value - *data;
-          /* Apply a threshold. */
-          if (*data > (guchar) (255.0f * (1.0f - stroke_threshold)))
-            *data = 1;
-          else
-            *data = 0;
-          data++;
-        }
-    }
+  GIMP_TIMER_END("denoise");
 
-  /* Denoise (remove small connected components) */
-  gimp_lineart_denoise (strokes, minimal_lineart_area, async);
   if (gimp_async_is_stopped (async))
     goto end1;
 
-  closed = g_object_ref (strokes);
-
   if (automatic_closure &&
       (spline_max_length > 0 || segment_max_length > 0))
     {
-      GArray     *keypoints           = NULL;
-      GHashTable *visited             = NULL;
-      gfloat     *radii               = NULL;
-      gfloat     *normals             = NULL;
-      gfloat     *curvatures          = NULL;
-      gfloat     *smoothed_curvatures = NULL;
-      gfloat      threshold;
-      gfloat      clamped_threshold;
-      GList      *fill_pixels         = NULL;
-      GList      *iter;
-
-      normals             = g_new0 (gfloat, width * height * 2);
-      curvatures          = g_new0 (gfloat, width * height);
-      smoothed_curvatures = g_new0 (gfloat, width * height);
+      GArray  *keypoints           = NULL;
+      guint8  *visited             = NULL;
+      gfloat  *radii               = NULL;
+      gfloat  *normals             = NULL;
+      gfloat  *curvatures          = NULL;
+      gfloat  *smoothed_curvatures = NULL;
+      GArray  *fill_pixels         = NULL;
+
+      normals             = g_new0 (gfloat, (gsize) width * height * 2);
+      curvatures          = g_new0 (gfloat, (gsize) width * height);
+      smoothed_curvatures = g_new0 (gfloat, (gsize) width * height);
+
+      GIMP_TIMER_START();
 
       /* Estimate normals & curvature */
-      gimp_lineart_compute_normals_curvatures (strokes, normals, curvatures,
+      gimp_lineart_compute_normals_curvatures (&strokes, normals, curvatures,
                                                smoothed_curvatures,
                                                normal_estimate_mask_size,
                                                async);
-      if (gimp_async_is_stopped (async))
-        goto end2;
 
-      radii = gimp_lineart_estimate_strokes_radii (strokes, async);
+      GIMP_TIMER_END("normals & curvatures");
+
       if (gimp_async_is_stopped (async))
         goto end2;
-      threshold = 1.0f - end_point_rate;
-      clamped_threshold = MAX (0.25f, threshold);
-      for (i = 0; i < width; i++)
-        {
-          gint j;
 
-          if (gimp_async_is_canceled (async))
-            {
-              gimp_async_abort (async);
+      GIMP_TIMER_START();
 
-              goto end2;
-            }
+      radii = gimp_lineart_estimate_strokes_radii (&strokes, async);
 
-          for (j = 0; j < height; j++)
-            {
-              if (smoothed_curvatures[i + j * width] >= (threshold / MAX (1.0f, radii[i + j * width])) ||
-                  curvatures[i + j * width] >= clamped_threshold)
-                curvatures[i + j * width] = 1.0;
-              else
-                curvatures[i + j * width] = 0.0;
-            }
+      if (radii)
+        {
+          gimp_lineart_threshold_curvatures (&strokes, curvatures,
+                                             smoothed_curvatures, radii,
+                                             1.0f - end_point_rate);
+          g_clear_pointer (&radii, g_free);
         }
-      g_clear_pointer (&radii, g_free);
+
+      GIMP_TIMER_END("stroke radii");
+
+      if (gimp_async_is_stopped (async))
+        goto end2;
+
+      GIMP_TIMER_START();
 
       keypoints = gimp_lineart_curvature_extremums (curvatures, smoothed_curvatures,
                                                     width, height, async);
+
+      GIMP_TIMER_END("curvature extremums");
+
       if (gimp_async_is_stopped (async))
         goto end2;
 
-      visited = g_hash_table_new_full ((GHashFunc) visited_hash_fun,
-                                       (GEqualFunc) visited_equal_fun,
-                                       (GDestroyNotify) g_free, NULL);
+      /* How many closures start from each key point. */
+      visited = g_new0 (guint8, (gsize) width * height);
+
+      fill_pixels = g_array_new (FALSE, FALSE, sizeof (Pixel));
 
       if (spline_max_length > 0)
         {
-          GList           *candidates;
-          SplineCandidate *candidate;
+          GArray *candidates;
+
+          GIMP_TIMER_START();
 
           candidates = gimp_lineart_find_spline_candidates (keypoints, normals, width,
                                                             spline_max_length,
                                                             spline_max_angle,
                                                             async);
+
+          GIMP_TIMER_END("spline candidates");
+
           if (gimp_async_is_stopped (async))
-            goto end3;
+            goto end2;
 
-          g_object_unref (closed);
-          closed = gimp_gegl_buffer_dup (strokes, NULL);
+          closed.data = g_memdup2 (strokes.data, (gsize) width * height);
+
+          GIMP_TIMER_START();
 
           /* Draw splines */
-          while (candidates)
+          for (i = 0; i < candidates->len; i++)
             {
-              Pixel    *p1;
-              Pixel    *p2;
-              gboolean  inserted = FALSE;
+              SplineCandidate *candidate;
+              Pixel            p1;
+              Pixel            p2;
+              guint8          *visited1;
+              guint8          *visited2;
 
               if (gimp_async_is_canceled (async))
                 {
                   gimp_async_abort (async);
 
-                  goto end3;
+                  break;
                 }
 
-              p1 = g_new (Pixel, 1);
-              p2 = g_new (Pixel, 1);
-
-              candidate = (SplineCandidate *) candidates->data;
-              p1->x = candidate->p1.x;
-              p1->y = candidate->p1.y;
-              p2->x = candidate->p2.x;
-              p2->y = candidate->p2.y;
-
-              g_free (candidate);
-              candidates = g_list_delete_link (candidates, candidates);
+              candidate = &g_array_index (candidates, SplineCandidate, i);
+              p1        = candidate->p1;
+              p2        = candidate->p2;
+              visited1  = &visited[(gint) p1.x + (gint) p1.y * width];
+              visited2  = &visited[(gint) p2.x + (gint) p2.y * width];
 
-              if ((! g_hash_table_contains (visited, p1) ||
-                   GPOINTER_TO_INT (g_hash_table_lookup (visited, p1)) < end_point_connectivity) &&
-                  (! g_hash_table_contains (visited, p2) ||
-                   GPOINTER_TO_INT (g_hash_table_lookup (visited, p2)) < end_point_connectivity))
+              if ((! *visited1 || *visited1 < end_point_connectivity) &&
+                  (! *visited2 || *visited2 < end_point_connectivity))
                 {
                   GArray      *discrete_curve;
-                  GimpVector2  vect1 = pair2normal (*p1, normals, width);
-                  GimpVector2  vect2 = pair2normal (*p2, normals, width);
-                  gfloat       distance = gimp_vector2_length_val (gimp_vector2_sub_val (*p1, *p2));
+                  GimpVector2  vect1 = pair2normal (p1, normals, width);
+                  GimpVector2  vect2 = pair2normal (p2, normals, width);
+                  gfloat       distance = gimp_vector2_length_val (gimp_vector2_sub_val (p1, p2));
                   gint         transitions;
 
                   gimp_vector2_mul (&vect1, distance);
@@ -1175,86 +1230,73 @@ gimp_line_art_close (GeglBuffer  *buffer,
                   gimp_vector2_mul (&vect2, distance);
                   gimp_vector2_mul (&vect2, spline_roundness);
 
-                  discrete_curve = gimp_lineart_discrete_spline (*p1, vect1, *p2, vect2);
+                  discrete_curve = gimp_lineart_discrete_spline (p1, vect1, p2, vect2);
 
                   transitions = allow_self_intersections ?
-                    gimp_number_of_transitions (discrete_curve, strokes) :
-                    gimp_number_of_transitions (discrete_curve, closed);
+                    gimp_number_of_transitions (discrete_curve, &strokes) :
+                    gimp_number_of_transitions (discrete_curve, &closed);
 
                   if (transitions == 2 &&
-                      gimp_line_art_allow_closure (closed, discrete_curve,
-                                                   &fill_pixels,
+                      gimp_line_art_allow_closure (&closed, discrete_curve,
+                                                   fill_pixels,
                                                    created_regions_significant_area,
                                                    created_regions_minimum_area))
                     {
-                      for (i = 0; i < discrete_curve->len; i++)
+                      gint j;
+
+                      for (j = 0; j < discrete_curve->len; j++)
                         {
-                          Pixel p = g_array_index (discrete_curve, Pixel, i);
+                          Pixel p = g_array_index (discrete_curve, Pixel, j);
 
-                          if (p.x >= 0 && p.x < gegl_buffer_get_width (closed) &&
-                              p.y >= 0 && p.y < gegl_buffer_get_height (closed))
+                          if (p.x >= 0 && p.x < width &&
+                              p.y >= 0 && p.y < height)
                             {
-                              guchar val = 2;
-
-                              gegl_buffer_set (closed, GEGL_RECTANGLE ((gint) p.x, (gint) p.y, 1, 1), 0,
-                                               NULL, &val, GEGL_AUTO_ROWSTRIDE);
+                              closed.data[(gint) p.x + (gint) p.y * width] = 2;
                             }
                         }
-                      g_hash_table_replace (visited, p1,
-                                            GINT_TO_POINTER (GPOINTER_TO_INT (g_hash_table_lookup (visited, p1)) + 1));
-                      g_hash_table_replace (visited, p2,
-                                            GINT_TO_POINTER (GPOINTER_TO_INT (g_hash_table_lookup (visited, p2)) + 1));
-                      inserted = TRUE;
+
+                      *visited1 = MIN (*visited1 + 1, G_MAXUINT8);
+                      *visited2 = MIN (*visited2 + 1, G_MAXUINT8);
                     }
                   g_array_free (discrete_curve, TRUE);
                 }
-              if (! inserted)
-                {
-                  g_free (p1);
-                  g_free (p2);
-                }
             }
 
- end3:
-          g_list_free_full (candidates, g_free);
+          GIMP_TIMER_END("splines");
+
+          g_array_free (candidates, TRUE);
 
           if (gimp_async_is_stopped (async))
             goto end2;
         }
 
-      g_clear_object (&strokes);
-
       /* Draw straight line segments */
       if (segment_max_length > 0)
         {
-          Pixel *point;
+          GIMP_TIMER_START();
 
-          point = (Pixel *) keypoints->data;
           for (i = 0; i < keypoints->len; i++)
             {
-              Pixel    *p;
-              gboolean  inserted = FALSE;
+              Pixel   point = g_array_index (keypoints, Pixel, i);
+              guint8 *count = &visited[(gint) point.x + (gint) point.y * width];
 
               if (gimp_async_is_canceled (async))
                 {
                   gimp_async_abort (async);
 
-                  goto end2;
+                  break;
                 }
 
-              p  = g_new (Pixel, 1);
-              *p = *point;
-
-              if (! g_hash_table_contains (visited, p) ||
+              if (! *count ||
                   (small_segments_from_spline_sources &&
-                   GPOINTER_TO_INT (g_hash_table_lookup (visited, p)) < end_point_connectivity))
+                   *count < end_point_connectivity))
                 {
-                  GArray *segment = gimp_lineart_line_segment_until_hit (closed, *point,
-                                                                         pair2normal (*point, normals, width),
+                  GArray *segment = gimp_lineart_line_segment_until_hit (&closed, point,
+                                                                         pair2normal (point, normals, width),
                                                                          segment_max_length);
 
                   if (segment->len &&
-                      gimp_line_art_allow_closure (closed, segment, &fill_pixels,
+                      gimp_line_art_allow_closure (&closed, segment, fill_pixels,
                                                    created_regions_significant_area,
                                                    created_regions_minimum_area))
                     {
@@ -1262,28 +1304,27 @@ gimp_line_art_close (GeglBuffer  *buffer,
 
                       for (j = 0; j < segment->len; j++)
                         {
-                          Pixel  p2 = g_array_index (segment, Pixel, j);
-                          guchar val = 2;
+                          Pixel p2 = g_array_index (segment, Pixel, j);
 
-                          gegl_buffer_set (closed, GEGL_RECTANGLE ((gint) p2.x, (gint) p2.y, 1, 1), 0,
-                                           NULL, &val, GEGL_AUTO_ROWSTRIDE);
+                          closed.data[(gint) p2.x + (gint) p2.y * width] = 2;
                         }
-                      g_hash_table_replace (visited, p,
-                                            GINT_TO_POINTER (GPOINTER_TO_INT (g_hash_table_lookup (visited, p)) + 1));
-                      inserted = TRUE;
+
+                      *count = MIN (*count + 1, G_MAXUINT8);
                     }
                   g_array_free (segment, TRUE);
                 }
-              if (! inserted)
-                g_free (p);
-              point++;
             }
+
+          GIMP_TIMER_END("segments");
+
+          if (gimp_async_is_stopped (async))
+            goto end2;
         }
 
-      for (iter = fill_pixels; iter; iter = iter->next)
+      for (i = 0; i < fill_pixels->len; i++)
         {
-          Pixel *p        = iter->data;
-          gint   fill_max = created_regions_significant_area - 1;
+          Pixel p        = g_array_index (fill_pixels, Pixel, i);
+          gint  fill_max = created_regions_significant_area - 1;
 
           if (gimp_async_is_canceled (async))
             {
@@ -1299,613 +1340,654 @@ gimp_line_art_close (GeglBuffer  *buffer,
            * This is mostly a quick'n dirty first implementation which I
            * will improve later.
            */
-          gimp_line_art_simple_fill (closed, (gint) p->x, (gint) p->y, &fill_max);
+          gimp_line_art_simple_fill (&closed, (gint) p.x, (gint) p.y, &fill_max);
         }
 
  end2:
-      g_list_free_full (fill_pixels, g_free);
+      if (fill_pixels)
+        g_array_free (fill_pixels, TRUE);
       g_free (normals);
       g_free (curvatures);
       g_free (smoothed_curvatures);
-      g_clear_pointer (&radii, g_free);
+      g_free (radii);
+      g_free (visited);
       if (keypoints)
         g_array_free (keypoints, TRUE);
-      g_clear_pointer (&visited, g_hash_table_destroy);
 
       if (gimp_async_is_stopped (async))
         goto end1;
     }
-  else
-    {
-      g_clear_object (&strokes);
-    }
+
+  closed_buffer = gegl_buffer_new (gegl_buffer_get_extent (buffer),
+                                   babl_format ("Y' u8"));
+  gegl_buffer_set (closed_buffer, NULL, 0, NULL, closed.data,
+                   GEGL_AUTO_ROWSTRIDE);
 
   if (closed_distmap)
     {
-      GeglNode   *graph;
-      GeglNode   *input;
-      GeglNode   *op;
+      GIMP_TIMER_START();
 
       /* Flooding needs a distance map for closed line art. */
-      *closed_distmap = g_new (gfloat, width * height);
-
-      graph = gegl_node_new ();
-      input = gegl_node_new_child (graph,
-                                   "operation", "gegl:buffer-source",
-                                   "buffer", closed,
-                                   NULL);
-      op  = gegl_node_new_child (graph,
-                                 "operation", "gegl:distance-transform",
-                                 "metric",    GEGL_DISTANCE_METRIC_EUCLIDEAN,
-                                 "normalize", FALSE,
-                                 NULL);
-      gegl_node_link (input, op);
-      gegl_node_blit (op, 1.0, gegl_buffer_get_extent (closed),
-                      NULL, *closed_distmap,
-                      GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
-      g_object_unref (graph);
+      *closed_distmap = gimp_lineart_distance_map (closed_buffer);
+
+      GIMP_TIMER_END("distance map");
     }
 
  end1:
-  g_clear_object (&strokes);
+  if (closed.data != strokes.data)
+    g_free (closed.data);
+  g_free (strokes.data);
 
-  if (gimp_async_is_stopped (async))
-    g_clear_object (&closed);
-
-  return closed;
+  return closed_buffer;
 }
 
-static void
-gimp_lineart_denoise (GeglBuffer *buffer,
-                      int         minimum_area,
-                      GimpAsync  *async)
-{
-  /* Keep connected regions with significant area. */
-  GArray   *region;
-  GQueue   *q       = g_queue_new ();
-  gint      width   = gegl_buffer_get_width (buffer);
-  gint      height  = gegl_buffer_get_height (buffer);
-  gboolean *visited = g_new0 (gboolean, width * height);
-  gint      x, y;
-
-  region = g_array_sized_new (TRUE, TRUE, sizeof (Pixel *), minimum_area);
-
-  for (y = 0; y < height; ++y)
-    for (x = 0; x < width; ++x)
-      {
-        guchar has_stroke;
-
-        if (gimp_async_is_canceled (async))
-          {
-            gimp_async_abort (async);
-
-            goto end;
-          }
-
-        gegl_buffer_sample (buffer, x, y, NULL, &has_stroke, NULL,
-                            GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-        if (has_stroke && ! visited[x + y * width])
-          {
-            Pixel *p = g_new (Pixel, 1);
-            gint   regionSize = 0;
-
-            p->x = x;
-            p->y = y;
-
-            g_queue_push_tail (q, p);
-            visited[x + y * width] = TRUE;
-
-            while (! g_queue_is_empty (q))
-              {
-                Pixel *p;
-                gint   p2x;
-                gint   p2y;
-
-                if (gimp_async_is_canceled (async))
-                  {
-                    gimp_async_abort (async);
-
-                    goto end;
-                  }
-
-                p = (Pixel *) g_queue_pop_head (q);
-
-                p2x = p->x + 1;
-                p2y = p->y;
-                if (p2x >= 0 && p2x < width && p2y >= 0 && p2y < height)
-                  {
-                    gegl_buffer_sample (buffer, p2x, p2y, NULL, &has_stroke, NULL,
-                                        GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-                    if (has_stroke && ! visited[p2x + p2y * width])
-                      {
-                        Pixel *p2 = g_new (Pixel, 1);
-
-                        p2->x = p2x;
-                        p2->y = p2y;
-                        g_queue_push_tail (q, p2);
-                        visited[p2x +p2y * width] = TRUE;
-                      }
-                  }
-                p2x = p->x - 1;
-                p2y = p->y;
-                if (p2x >= 0 && p2x < width && p2y >= 0 && p2y < height)
-                  {
-                    gegl_buffer_sample (buffer, p2x, p2y, NULL, &has_stroke, NULL,
-                                        GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-                    if (has_stroke && ! visited[p2x + p2y * width])
-                      {
-                        Pixel *p2 = g_new (Pixel, 1);
-
-                        p2->x = p2x;
-                        p2->y = p2y;
-                        g_queue_push_tail (q, p2);
-                        visited[p2x + p2y * width] = TRUE;
-                      }
-                  }
-                p2x = p->x;
-                p2y = p->y - 1;
-                if (p2x >= 0 && p2x < width && p2y >= 0 && p2y < height)
-                  {
-                    gegl_buffer_sample (buffer, p2x, p2y, NULL, &has_stroke, NULL,
-                                        GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-                    if (has_stroke && ! visited[p2x + p2y * width])
-                      {
-                        Pixel *p2 = g_new (Pixel, 1);
-
-                        p2->x = p2x;
-                        p2->y = p2y;
-                        g_queue_push_tail (q, p2);
-                        visited[p2x + p2y * width] = TRUE;
-                      }
-                  }
-                p2x = p->x;
-                p2y = p->y + 1;
-                if (p2x >= 0 && p2x < width && p2y >= 0 && p2y < height)
-                  {
-                    gegl_buffer_sample (buffer, p2x, p2y, NULL, &has_stroke, NULL,
-                                        GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-                    if (has_stroke && ! visited[p2x + p2y * width])
-                      {
-                        Pixel *p2 = g_new (Pixel, 1);
-
-                        p2->x = p2x;
-                        p2->y = p2y;
-                        g_queue_push_tail (q, p2);
-                        visited[p2x + p2y * width] = TRUE;
-                      }
-                  }
-                p2x = p->x + 1;
-                p2y = p->y + 1;
-                if (p2x >= 0 && p2x < width && p2y >= 0 && p2y < height)
-                  {
-                    gegl_buffer_sample (buffer, p2x, p2y, NULL, &has_stroke, NULL,
-                                        GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-                    if (has_stroke && ! visited[p2x + p2y * width])
-                      {
-                        Pixel *p2 = g_new (Pixel, 1);
-
-                        p2->x = p2x;
-                        p2->y = p2y;
-                        g_queue_push_tail (q, p2);
-                        visited[p2x + p2y * width] = TRUE;
-                      }
-                  }
-                p2x = p->x - 1;
-                p2y = p->y - 1;
-                if (p2x >= 0 && p2x < width && p2y >= 0 && p2y < height)
-                  {
-                    gegl_buffer_sample (buffer, p2x, p2y, NULL, &has_stroke, NULL,
-                                        GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-                    if (has_stroke && ! visited[p2x + p2y * width])
-                      {
-                        Pixel *p2 = g_new (Pixel, 1);
-
-                        p2->x = p2x;
-                        p2->y = p2y;
-                        g_queue_push_tail (q, p2);
-                        visited[p2x + p2y * width] = TRUE;
-                      }
-                  }
-                p2x = p->x - 1;
-                p2y = p->y + 1;
-                if (p2x >= 0 && p2x < width && p2y >= 0 && p2y < height)
-                  {
-                    gegl_buffer_sample (buffer, p2x, p2y, NULL, &has_stroke, NULL,
-                                        GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-                    if (has_stroke && ! visited[p2x + p2y * width])
-                      {
-                        Pixel *p2 = g_new (Pixel, 1);
-
-                        p2->x = p2x;
-                        p2->y = p2y;
-                        g_queue_push_tail (q, p2);
-                        visited[p2x + p2y * width] = TRUE;
-                      }
-                  }
-                p2x = p->x + 1;
-                p2y = p->y - 1;
-                if (p2x >= 0 && p2x < width && p2y >= 0 && p2y < height)
-                  {
-                    gegl_buffer_sample (buffer, p2x, p2y, NULL, &has_stroke, NULL,
-                                        GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-                    if (has_stroke && ! visited[p2x + p2y * width])
-                      {
-                        Pixel *p2 = g_new (Pixel, 1);
-
-                        p2->x = p2x;
-                        p2->y = p2y;
-                        g_queue_push_tail (q, p2);
-                        visited[p2x + p2y * width] = TRUE;
-                      }
-                  }
-
-                ++regionSize;
-                if (regionSize < minimum_area)
-                  g_array_append_val (region, *p);
-                g_free (p);
-              }
-            if (regionSize < minimum_area)
-              {
-                Pixel *pixel = (Pixel *) region->data;
-                gint   i = 0;
-
-                for (; i < region->len; i++)
-                  {
-                    guchar val = 0;
-                    gegl_buffer_set (buffer, GEGL_RECTANGLE (pixel->x, pixel->y, 1, 1), 0,
-                                     NULL, &val, GEGL_AUTO_ROWSTRIDE);
-                    pixel++;
-                  }
-              }
-            g_array_remove_range (region, 0, region->len);
-          }
-      }
+static inline guchar
+gimp_lineart_mask_get (const LineArtMask *mask,
+                       gint               x,
+                       gint               y)
+{
+  if (x < 0 || x >= mask->width || y < 0 || y >= mask->height)
+    return 0;
 
- end:
-  g_array_free (region, TRUE);
-  g_queue_free_full (q, g_free);
-  g_free (visited);
+  return mask->data[x + y * mask->width];
 }
 
 static void
-gimp_lineart_compute_normals_curvatures (GeglBuffer *mask,
-                                         gfloat     *normals,
-                                         gfloat     *curvatures,
-                                         gfloat     *smoothed_curvatures,
-                                         int         normal_estimate_mask_size,
-                                         GimpAsync  *async)
-{
-  gfloat  *edgels_curvatures  = NULL;
-  gfloat  *smoothed_curvature;
-  GArray  *es                 = NULL;
-  Edgel  **e;
-  gint     width              = gegl_buffer_get_width (mask);
-
-  es = gimp_edgelset_new (mask, async);
-  if (gimp_async_is_stopped (async))
-    goto end;
-
-  e = (Edgel **) es->data;
-
-  gimp_edgelset_smooth_normals (es, normal_estimate_mask_size, async);
-  if (gimp_async_is_stopped (async))
-    goto end;
-
-  gimp_edgelset_compute_curvature (es, async);
-  if (gimp_async_is_stopped (async))
-    goto end;
+gimp_lineart_binarize_max_rows (gsize            offset,
+                                gsize            size,
+                                LineArtBinarize *bin)
+{
+  gint y;
 
-  while (*e)
+  for (y = offset; y < offset + size; y++)
     {
-      const float curvature = ((*e)->curvature > 0.0f) ? (*e)->curvature : 0.0f;
-      const float w         = MAX (1e-8f, curvature * curvature);
-
-      if (gimp_async_is_canceled (async))
-        {
-          gimp_async_abort (async);
+      const guchar *row       = bin->mask->data + (gsize) y * bin->mask->width;
+      guchar        max_value = 0;
+      gint          x;
 
-          goto end;
-        }
+      for (x = 0; x < bin->mask->width; x++)
+        max_value = MAX (max_value, row[x]);
 
-      normals[((*e)->x + (*e)->y * width) * 2] += w * (*e)->x_normal;
-      normals[((*e)->x + (*e)->y * width) * 2 + 1] += w * (*e)->y_normal;
-      curvatures[(*e)->x + (*e)->y * width] = MAX (curvature,
-                                                   curvatures[(*e)->x + (*e)->y * width]);
-      e++;
+      bin->row_max[y] = max_value;
     }
-  for (int y = 0; y < gegl_buffer_get_height (mask); ++y)
+}
+
+static void
+gimp_lineart_binarize_rows (gsize            offset,
+                            gsize            size,
+                            LineArtBinarize *bin)
+{
+  gint y;
+
+  for (y = offset; y < offset + size; y++)
     {
-      if (gimp_async_is_canceled (async))
+      guchar *row = bin->mask->data + (gsize) y * bin->mask->width;
+      gint    x;
+
+      for (x = 0; x < bin->mask->width; x++)
         {
-          gimp_async_abort (async);
+          guchar value = row[x];
 
-          goto end;
-        }
+          if (! bin->select_transparent)
+            /* Negate the value. */
+            value = bin->max_value - value;
 
-      for (int x = 0; x < gegl_buffer_get_width (mask); ++x)
-        {
-          const float _angle = atan2f (normals[(x + y * width) * 2 + 1],
-                                       normals[(x + y * width) * 2]);
-          normals[(x + y * width) * 2] = cosf (_angle);
-          normals[(x + y * width) * 2 + 1] = sinf (_angle);
+          /* Apply a threshold. */
+          row[x] = value > bin->threshold ? 1 : 0;
         }
     }
+}
 
-  /* Smooth curvatures on edgels, then take maximum on each pixel. */
-  edgels_curvatures = gimp_lineart_get_smooth_curvatures (es, async);
-  if (gimp_async_is_stopped (async))
-    goto end;
+static void
+gimp_lineart_binarize (LineArtMask *mask,
+                       gboolean     select_transparent,
+                       gdouble      stroke_threshold)
+{
+  LineArtBinarize bin;
+  gsize           min_rows = MAX (PIXELS_PER_THREAD / mask->width, 1);
 
-  smoothed_curvature = edgels_curvatures;
+  bin.mask               = mask;
+  bin.select_transparent = select_transparent;
+  bin.threshold          = (guchar) (255.0f * (1.0f - stroke_threshold));
+  bin.row_max            = NULL;
+  bin.max_value          = 0;
 
-  e = (Edgel **) es->data;
-  while (*e)
+  if (! select_transparent)
     {
-      gfloat *pixel_curvature = &smoothed_curvatures[(*e)->x + (*e)->y * width];
+      gint y;
+
+      /* Compute the biggest value */
+      bin.row_max = g_new (guchar, mask->height);
+
+      gegl_parallel_distribute_range (mask->height, min_rows,
+                                      (GeglParallelDistributeRangeFunc)
+                                      gimp_lineart_binarize_max_rows,
+                                      &bin);
 
-      if (*pixel_curvature < *smoothed_curvature)
-        *pixel_curvature = *smoothed_curvature;
+      for (y = 0; y < mask->height; y++)
+        bin.max_value = MAX (bin.max_value, bin.row_max[y]);
 
-      ++smoothed_curvature;
-      e++;
+      g_free (bin.row_max);
     }
 
- end:
-  g_free (edgels_curvatures);
+  gegl_parallel_distribute_range (mask->height, min_rows,
+                                  (GeglParallelDistributeRangeFunc)
+                                  gimp_lineart_binarize_rows,
+                                  &bin);
+}
+
+static gint
+gimp_lineart_run_find (gint *parents,
+                       gint  i)
+{
+  while (parents[i] != i)
+    {
+      parents[i] = parents[parents[i]];
+      i          = parents[i];
+    }
 
-  if (es)
-    g_array_free (es, TRUE);
+  return i;
 }
 
-static gfloat *
-gimp_lineart_get_smooth_curvatures (GArray    *edgelset,
-                                    GimpAsync *async)
+static void
+gimp_lineart_run_union (gint *parents,
+                        gint  i,
+                        gint  j)
 {
-  Edgel  **e;
-  gfloat  *smoothed_curvatures = g_new0 (gfloat, edgelset->len);
-  gfloat   weights[9];
-  gfloat   smoothed_curvature;
-  gfloat   weights_sum;
-  gint     idx = 0;
+  i = gimp_lineart_run_find (parents, i);
+  j = gimp_lineart_run_find (parents, j);
 
-  weights[0] = 1.0f;
-  for (int i = 1; i <= 8; ++i)
-    weights[i] = expf (-(i * i) / 30.0f);
+  /* The root is always the lowest index, so that the forest can be
+   * flattened in a single forward pass.
+   */
+  if (i < j)
+    parents[j] = i;
+  else if (j < i)
+    parents[i] = j;
+}
+
+/* Join the 8-connected runs of two consecutive rows, whose runs are
+ * respectively in [@start1, @end1) and [@end1, @end2).
+ */
+static void
+gimp_lineart_runs_join_rows (gint             *parents,
+                             const LineArtRun *runs,
+                             gint              start1,
+                             gint              end1,
+                             gint              end2)
+{
+  gint i = start1;
+  gint j = end1;
 
-  e = (Edgel **) edgelset->data;
-  while (*e)
+  while (i < end1 && j < end2)
     {
-      Edgel *edgel_before = g_array_index (edgelset, Edgel*, (*e)->previous);
-      Edgel *edgel_after  = g_array_index (edgelset, Edgel*, (*e)->next);
-      int    n = 5;
-      int    i = 1;
+      if (runs[i].start <= runs[j].end && runs[j].start <= runs[i].end)
+        gimp_lineart_run_union (parents, i, j);
 
-      if (gimp_async_is_canceled (async))
-        {
-          gimp_async_abort (async);
+      if (runs[i].end < runs[j].end)
+        i++;
+      else
+        j++;
+    }
+}
 
-          g_free (smoothed_curvatures);
+static void
+gimp_lineart_denoise_count_rows (gsize           offset,
+                                 gsize           size,
+                                 LineArtDenoise *dn)
+{
+  gint y;
 
-          return NULL;
-        }
+  for (y = offset; y < offset + size; y++)
+    {
+      const guchar *row    = dn->mask->data + (gsize) y * dn->mask->width;
+      gint          n_runs = 0;
+      gint          x;
 
-      smoothed_curvature = (*e)->curvature;
-      weights_sum = weights[0];
-      while (n-- && (edgel_after != edgel_before))
+      for (x = 0; x < dn->mask->width; x++)
         {
-          smoothed_curvature += weights[i] * edgel_before->curvature;
-          smoothed_curvature += weights[i] * edgel_after->curvature;
-          edgel_before = g_array_index (edgelset, Edgel*, edgel_before->previous);
-          edgel_after  = g_array_index (edgelset, Edgel*, edgel_after->next);
-          weights_sum += 2 * weights[i];
-          i++;
+          if (row[x] && (x == 0 || ! row[x - 1]))
+            n_runs++;
         }
-      smoothed_curvature /= weights_sum;
-      smoothed_curvatures[idx++] = smoothed_curvature;
 
-      e++;
+      dn->row_offsets[y + 1] = n_runs;
     }
-
-  return smoothed_curvatures;
 }
 
-/**
- * Keep one pixel per connected component of curvature extremums.
- */
-static GArray *
-gimp_lineart_curvature_extremums (gfloat    *curvatures,
-                                  gfloat    *smoothed_curvatures,
-                                  gint       width,
-                                  gint       height,
-                                  GimpAsync *async)
+static void
+gimp_lineart_denoise_scan_rows (gsize           offset,
+                                gsize           size,
+                                LineArtDenoise *dn)
 {
-  gboolean *visited = g_new0 (gboolean, width * height);
-  GQueue   *q       = g_queue_new ();
-  GArray   *max_positions;
-
-  max_positions = g_array_new (FALSE, TRUE, sizeof (Pixel));
+  gint y;
 
-  for (int y = 0; y < height; ++y)
+  for (y = offset; y < offset + size; y++)
     {
-      if (gimp_async_is_canceled (async))
-        {
-          gimp_async_abort (async);
-
-          goto end;
-        }
+      const guchar *row = dn->mask->data + (gsize) y * dn->mask->width;
+      LineArtRun   *run = dn->runs + dn->row_offsets[y];
+      gint          x   = 0;
 
-      for (int x = 0; x < width; ++x)
+      while (x < dn->mask->width)
         {
-          if ((curvatures[x + y * width] > 0.0) && ! visited[x + y * width])
+          if (! row[x])
             {
-              Pixel  *p = g_new (Pixel, 1);
-              Pixel   max_smoothed_curvature_pixel;
-              Pixel   max_raw_curvature_pixel;
-              gfloat  max_smoothed_curvature;
-              gfloat  max_raw_curvature;
-
-              max_smoothed_curvature_pixel = gimp_vector2_new (-1.0, -1.0);
-              max_smoothed_curvature       = 0.0f;
+              x++;
+              continue;
+            }
 
-              max_raw_curvature_pixel = gimp_vector2_new (x, y);
-              max_raw_curvature       = curvatures[x + y * width];
+          run->start = x;
+          while (x < dn->mask->width && row[x])
+            x++;
+          run->end = x;
 
-              p->x = x;
-              p->y = y;
-              g_queue_push_tail (q, p);
-              visited[x + y * width] = TRUE;
+          run++;
+        }
+    }
+}
 
-              while (! g_queue_is_empty (q))
-                {
-                  gfloat sc;
-                  gfloat c;
-                  gint   p2x;
-                  gint   p2y;
+static void
+gimp_lineart_denoise_join_bands (gsize           offset,
+                                 gsize           size,
+                                 LineArtDenoise *dn)
+{
+  gint b;
 
-                  if (gimp_async_is_canceled (async))
-                    {
-                      gimp_async_abort (async);
+  for (b = offset; b < offset + size; b++)
+    {
+      gint y1 = b * dn->band_height;
+      gint y2 = MIN (y1 + dn->band_height, dn->mask->height);
+      gint i;
+      gint y;
 
-                      goto end;
-                    }
+      for (i = dn->row_offsets[y1]; i < dn->row_offsets[y2]; i++)
+        dn->parents[i] = i;
 
-                  p  = (Pixel *) g_queue_pop_head (q);
-                  sc = smoothed_curvatures[(gint) p->x + (gint) p->y * width];
-                  c  = curvatures[(gint) p->x + (gint) p->y * width];
+      for (y = y1 + 1; y < y2; y++)
+        {
+          gimp_lineart_runs_join_rows (dn->parents, dn->runs,
+                                       dn->row_offsets[y - 1],
+                                       dn->row_offsets[y],
+                                       dn->row_offsets[y + 1]);
+        }
+    }
+}
 
-                  curvatures[(gint) p->x + (gint) p->y * width] = 0.0f;
+static void
+gimp_lineart_denoise_clear_rows (gsize           offset,
+                                 gsize           size,
+                                 LineArtDenoise *dn)
+{
+  gint y;
 
-                  p2x = (gint) p->x + 1;
-                  p2y = (gint) p->y;
-                  if (p2x >= 0 && p2x < width    &&
-                      p2y >= 0 && p2y < height   &&
-                      curvatures[p2x + p2y * width] > 0.0 &&
-                      ! visited[p2x + p2y * width])
-                    {
-                      Pixel *p2 = g_new (Pixel, 1);
+  for (y = offset; y < offset + size; y++)
+    {
+      guchar *row = dn->mask->data + (gsize) y * dn->mask->width;
+      gint    i;
 
-                      p2->x = p2x;
-                      p2->y = p2y;
-                      g_queue_push_tail (q, p2);
-                      visited[p2x + p2y * width] = TRUE;
-                    }
+      for (i = dn->row_offsets[y]; i < dn->row_offsets[y + 1]; i++)
+        {
+          if (dn->areas[dn->parents[i]] < dn->minimum_area)
+            memset (row + dn->runs[i].start, 0,
+                    dn->runs[i].end - dn->runs[i].start);
+        }
+    }
+}
 
-                  p2x = p->x - 1;
-                  p2y = p->y;
-                  if (p2x >= 0 && p2x < width    &&
-                      p2y >= 0 && p2y < height   &&
-                      curvatures[p2x + p2y * width] > 0.0 &&
-                      ! visited[p2x + p2y * width])
-                    {
-                      Pixel *p2 = g_new (Pixel, 1);
+static void
+gimp_lineart_denoise (LineArtMask *mask,
+                      int          minimum_area,
+                      GimpAsync   *async)
+{
+  /* Keep 8-connected regions with significant area.  The strokes are
+   * split into horizontal runs, which are joined in parallel within
+   * bands of rows, and then across the bands.
+   */
+  LineArtDenoise dn;
+  gsize          min_rows = MAX (PIXELS_PER_THREAD / mask->width, 1);
+  gint           n_bands;
+  gint           n_runs;
+  gint           b;
+  gint           i;
+  gint           y;
+
+  dn.mask         = mask;
+  dn.minimum_area = minimum_area;
+  dn.band_height  = MAX (min_rows, DENOISE_MIN_BAND_HEIGHT);
+  dn.row_offsets  = g_new (gint, mask->height + 1);
+  dn.runs         = NULL;
+  dn.parents      = NULL;
+  dn.areas        = NULL;
+
+  dn.row_offsets[0] = 0;
+
+  gegl_parallel_distribute_range (mask->height, min_rows,
+                                  (GeglParallelDistributeRangeFunc)
+                                  gimp_lineart_denoise_count_rows,
+                                  &dn);
+
+  for (y = 0; y < mask->height; y++)
+    dn.row_offsets[y + 1] += dn.row_offsets[y];
+
+  n_runs = dn.row_offsets[mask->height];
 
-                      p2->x = p2x;
-                      p2->y = p2y;
-                      g_queue_push_tail (q, p2);
-                      visited[p2x + p2y * width] = TRUE;
-                    }
+  if (gimp_async_is_canceled (async))
+    {
+      gimp_async_abort (async);
 
-                  p2x = p->x;
-                  p2y = p->y - 1;
-                  if (p2x >= 0 && p2x < width    &&
-                      p2y >= 0 && p2y < height   &&
-                      curvatures[p2x + p2y * width] > 0.0 &&
-                      ! visited[p2x + p2y * width])
-                    {
-                      Pixel *p2 = g_new (Pixel, 1);
+      goto end;
+    }
 
-                      p2->x = p2x;
-                      p2->y = p2y;
-                      g_queue_push_tail (q, p2);
-                      visited[p2x + p2y * width] = TRUE;
-                    }
+  dn.runs    = g_new (LineArtRun, MAX (n_runs, 1));
+  dn.parents = g_new (gint, MAX (n_runs, 1));
+  dn.areas   = g_new0 (gint, MAX (n_runs, 1));
 
-                  p2x = p->x;
-                  p2y = p->y + 1;
-                  if (p2x >= 0 && p2x < width    &&
-                      p2y >= 0 && p2y < height   &&
-                      curvatures[p2x + p2y * width] > 0.0 &&
-                      ! visited[p2x + p2y * width])
-                    {
-                      Pixel *p2 = g_new (Pixel, 1);
+  gegl_parallel_distribute_range (mask->height, min_rows,
+                                  (GeglParallelDistributeRangeFunc)
+                                  gimp_lineart_denoise_scan_rows,
+                                  &dn);
 
-                      p2->x = p2x;
-                      p2->y = p2y;
-                      g_queue_push_tail (q, p2);
-                      visited[p2x + p2y * width] = TRUE;
-                    }
+  n_bands = (mask->height + dn.band_height - 1) / dn.band_height;
 
-                  p2x = p->x + 1;
-                  p2y = p->y + 1;
-                  if (p2x >= 0 && p2x < width    &&
-                      p2y >= 0 && p2y < height   &&
-                      curvatures[p2x + p2y * width] > 0.0 &&
-                      ! visited[p2x + p2y * width])
-                    {
-                      Pixel *p2 = g_new (Pixel, 1);
+  gegl_parallel_distribute_range (n_bands, 1,
+                                  (GeglParallelDistributeRangeFunc)
+                                  gimp_lineart_denoise_join_bands,
+                                  &dn);
 
-                      p2->x = p2x;
-                      p2->y = p2y;
-                      g_queue_push_tail (q, p2);
-                      visited[p2x + p2y * width] = TRUE;
-                    }
+  if (gimp_async_is_canceled (async))
+    {
+      gimp_async_abort (async);
 
-                  p2x = p->x - 1;
-                  p2y = p->y - 1;
-                  if (p2x >= 0 && p2x < width    &&
-                      p2y >= 0 && p2y < height   &&
-                      curvatures[p2x + p2y * width] > 0.0 &&
-                      ! visited[p2x + p2y * width])
-                    {
-                      Pixel *p2 = g_new (Pixel, 1);
+      goto end;
+    }
 
-                      p2->x = p2x;
-                      p2->y = p2y;
-                      g_queue_push_tail (q, p2);
-                      visited[p2x + p2y * width] = TRUE;
-                    }
+  for (b = 1; b < n_bands; b++)
+    {
+      y = b * dn.band_height;
 
-                  p2x = p->x - 1;
-                  p2y = p->y + 1;
-                  if (p2x >= 0 && p2x < width    &&
-                      p2y >= 0 && p2y < height   &&
-                      curvatures[p2x + p2y * width] > 0.0 &&
-                      ! visited[p2x + p2y * width])
-                    {
-                      Pixel *p2 = g_new (Pixel, 1);
+      gimp_lineart_runs_join_rows (dn.parents, dn.runs,
+                                   dn.row_offsets[y - 1],
+                                   dn.row_offsets[y],
+                                   dn.row_offsets[y + 1]);
+    }
 
-                      p2->x = p2x;
-                      p2->y = p2y;
-                      g_queue_push_tail (q, p2);
-                      visited[p2x + p2y * width] = TRUE;
-                    }
+  for (i = 0; i < n_runs; i++)
+    {
+      dn.parents[i] = dn.parents[dn.parents[i]];
+
+      dn.areas[dn.parents[i]] += dn.runs[i].end - dn.runs[i].start;
+    }
+
+  gegl_parallel_distribute_range (mask->height, min_rows,
+                                  (GeglParallelDistributeRangeFunc)
+                                  gimp_lineart_denoise_clear_rows,
+                                  &dn);
+
+ end:
+  g_free (dn.row_offsets);
+  g_free (dn.runs);
+  g_free (dn.parents);
+  g_free (dn.areas);
+}
+
+static void
+gimp_lineart_pixel_normals_curvatures_rows (gsize             offset,
+                                            gsize             size,
+                                            LineArtPixelPass *pass)
+{
+  const EdgelSet *set   = pass->set;
+  gint            width = pass->mask->width;
+  gint            y;
+
+  for (y = offset; y < offset + size; y++)
+    {
+      gint x;
+
+      if (gimp_async_is_canceled (pass->async))
+        return;
+
+      for (x = 0; x < width; x++)
+        {
+          gint   i        = x + y * width;
+          gfloat x_normal = 0.0f;
+          gfloat y_normal = 0.0f;
+          gfloat angle;
+          guint  k;
+
+          for (k = set->pixel_edgels[i]; k < set->pixel_edgels[i + 1]; k++)
+            {
+              const Edgel *e         = &set->edgels[k];
+              const float  curvature = (e->curvature > 0.0f) ? e->curvature : 0.0f;
+              const float  w         = MAX (1e-8f, curvature * curvature);
+
+              x_normal += w * e->x_normal;
+              y_normal += w * e->y_normal;
+
+              pass->curvatures[i] = MAX (curvature, pass->curvatures[i]);
+
+              /* Smooth curvatures on edgels, then take maximum on each
+               * pixel.
+               */
+              if (pass->smoothed_curvatures[i] < pass->edgel_curvatures[k])
+                pass->smoothed_curvatures[i] = pass->edgel_curvatures[k];
+            }
+
+          angle = atan2f (y_normal, x_normal);
+          pass->normals[i * 2]     = cosf (angle);
+          pass->normals[i * 2 + 1] = sinf (angle);
+        }
+    }
+}
+
+static void
+gimp_lineart_compute_normals_curvatures (const LineArtMask *mask,
+                                         gfloat            *normals,
+                                         gfloat            *curvatures,
+                                         gfloat            *smoothed_curvatures,
+                                         int                normal_estimate_mask_size,
+                                         GimpAsync         *async)
+{
+  EdgelSet         *set;
+  LineArtPixelPass  pass = { 0, };
+
+  set = gimp_edgelset_new (mask, async);
+  if (gimp_async_is_stopped (async))
+    return;
+
+  gimp_edgelset_smooth_normals (set, normal_estimate_mask_size, async);
+  if (gimp_async_is_stopped (async))
+    goto end;
+
+  gimp_edgelset_compute_curvature (set, async);
+  if (gimp_async_is_stopped (async))
+    goto end;
+
+  pass.edgel_curvatures = gimp_lineart_get_smooth_curvatures (set, async);
+  if (gimp_async_is_stopped (async))
+    goto end;
+
+  pass.mask                = mask;
+  pass.set                 = set;
+  pass.normals             = normals;
+  pass.curvatures          = curvatures;
+  pass.smoothed_curvatures = smoothed_curvatures;
+  pass.async               = async;
+
+  gegl_parallel_distribute_range (mask->height,
+                                  MAX (PIXELS_PER_THREAD / mask->width, 1),
+                                  (GeglParallelDistributeRangeFunc)
+                                  gimp_lineart_pixel_normals_curvatures_rows,
+                                  &pass);
+
+  if (gimp_async_is_canceled (async))
+    gimp_async_abort (async);
+
+ end:
+  g_free (pass.edgel_curvatures);
+  gimp_edgelset_free (set);
+}
+
+static void
+gimp_lineart_get_smooth_curvatures_range (gsize         offset,
+                                          gsize         size,
+                                          EdgelSetPass *pass)
+{
+  const Edgel *edgels = pass->set->edgels;
+  guint        idx;
+
+  for (idx = offset; idx < offset + size; idx++)
+    {
+      const Edgel *e            = &edgels[idx];
+      const Edgel *edgel_before = &edgels[e->previous];
+      const Edgel *edgel_after  = &edgels[e->next];
+      gfloat       smoothed_curvature;
+      gfloat       weights_sum;
+      int          n = 5;
+      int          i = 1;
+
+      if (idx % EDGELS_PER_CANCEL_CHECK == 0 &&
+          gimp_async_is_canceled (pass->async))
+        return;
+
+      smoothed_curvature = e->curvature;
+      weights_sum = pass->weights[0];
+      while (n-- && (edgel_after != edgel_before))
+        {
+          smoothed_curvature += pass->weights[i] * edgel_before->curvature;
+          smoothed_curvature += pass->weights[i] * edgel_after->curvature;
+          edgel_before = &edgels[edgel_before->previous];
+          edgel_after  = &edgels[edgel_after->next];
+          weights_sum += 2 * pass->weights[i];
+          i++;
+        }
+      smoothed_curvature /= weights_sum;
+      pass->curvatures[idx] = smoothed_curvature;
+    }
+}
+
+static gfloat *
+gimp_lineart_get_smooth_curvatures (EdgelSet  *set,
+                                    GimpAsync *async)
+{
+  EdgelSetPass pass = { 0, };
+  gfloat       weights[9];
+
+  weights[0] = 1.0f;
+  for (int i = 1; i <= 8; ++i)
+    weights[i] = expf (-(i * i) / 30.0f);
+
+  pass.set        = set;
+  pass.weights    = weights;
+  pass.curvatures = g_new0 (gfloat, MAX (set->n_edgels, 1));
+  pass.async      = async;
+
+  gegl_parallel_distribute_range (set->n_edgels, PIXELS_PER_THREAD,
+                                  (GeglParallelDistributeRangeFunc)
+                                  gimp_lineart_get_smooth_curvatures_range,
+                                  &pass);
+
+  if (gimp_async_is_canceled (async))
+    {
+      gimp_async_abort (async);
+
+      g_free (pass.curvatures);
+
+      return NULL;
+    }
+
+  return pass.curvatures;
+}
+
+/**
+ * Keep one pixel per connected component of curvature extremums.
+ */
+static GArray *
+gimp_lineart_curvature_extremums (gfloat    *curvatures,
+                                  gfloat    *smoothed_curvatures,
+                                  gint       width,
+                                  gint       height,
+                                  GimpAsync *async)
+{
+  static const gint  dx[8] = { +1, -1,  0,  0, +1, -1, -1, +1 };
+  static const gint  dy[8] = {  0,  0, -1, +1, +1, -1, +1, -1 };
+  guint8            *visited = g_new0 (guint8, (gsize) width * height);
+  GArray            *queue   = g_array_new (FALSE, FALSE, sizeof (gint));
+  GArray            *max_positions;
+
+  max_positions = g_array_new (FALSE, TRUE, sizeof (Pixel));
+
+  for (int y = 0; y < height; ++y)
+    {
+      if (gimp_async_is_canceled (async))
+        {
+          gimp_async_abort (async);
+
+          goto end;
+        }
+
+      for (int x = 0; x < width; ++x)
+        {
+          if ((curvatures[x + y * width] > 0.0) && ! visited[x + y * width])
+            {
+              Pixel   max_smoothed_curvature_pixel;
+              Pixel   max_raw_curvature_pixel;
+              gfloat  max_smoothed_curvature;
+              gfloat  max_raw_curvature;
+              gint    index = x + y * width;
+              guint   head  = 0;
+
+              max_smoothed_curvature_pixel = gimp_vector2_new (-1.0, -1.0);
+              max_smoothed_curvature       = 0.0f;
+
+              max_raw_curvature_pixel = gimp_vector2_new (x, y);
+              max_raw_curvature       = curvatures[x + y * width];
+
+              g_array_set_size (queue, 0);
+              g_array_append_val (queue, index);
+              visited[index] = TRUE;
 
-                  p2x = p->x + 1;
-                  p2y = p->y - 1;
-                  if (p2x >= 0 && p2x < width    &&
-                      p2y >= 0 && p2y < height   &&
-                      curvatures[p2x + p2y * width] > 0.0 &&
-                      ! visited[p2x + p2y * width])
+              while (head < queue->len)
+                {
+                  gfloat sc;
+                  gfloat c;
+                  gint   px;
+                  gint   py;
+                  gint   k;
+
+                  index = g_array_index (queue, gint, head++);
+                  px    = index % width;
+                  py    = index / width;
+                  sc    = smoothed_curvatures[index];
+                  c     = curvatures[index];
+
+                  curvatures[index] = 0.0f;
+
+                  for (k = 0; k < 8; k++)
                     {
-                      Pixel *p2 = g_new (Pixel, 1);
+                      gint p2x = px + dx[k];
+                      gint p2y = py + dy[k];
 
-                      p2->x = p2x;
-                      p2->y = p2y;
-                      g_queue_push_tail (q, p2);
-                      visited[p2x + p2y * width] = TRUE;
+                      if (p2x >= 0 && p2x < width    &&
+                          p2y >= 0 && p2y < height   &&
+                          curvatures[p2x + p2y * width] > 0.0 &&
+                          ! visited[p2x + p2y * width])
+                        {
+                          gint index2 = p2x + p2y * width;
+
+                          g_array_append_val (queue, index2);
+                          visited[index2] = TRUE;
+                        }
                     }
 
                   if (sc > max_smoothed_curvature)
                     {
-                      max_smoothed_curvature_pixel = *p;
+                      max_smoothed_curvature_pixel = gimp_vector2_new (px, py);
                       max_smoothed_curvature = sc;
                     }
                   if (c > max_raw_curvature)
                     {
-                      max_raw_curvature_pixel = *p;
+                      max_raw_curvature_pixel = gimp_vector2_new (px, py);
                       max_raw_curvature = c;
                     }
-                  g_free (p);
                 }
               if (max_smoothed_curvature > 0.0f)
                 {
@@ -1922,7 +2004,7 @@ gimp_lineart_curvature_extremums (gfloat    *curvatures,
     }
 
  end:
-  g_queue_free_full (q, g_free);
+  g_array_free (queue, TRUE);
   g_free (visited);
 
   if (gimp_async_is_stopped (async))
@@ -1951,7 +2033,87 @@ gimp_spline_candidate_cmp (const SplineCandidate *a,
     return 0;
 }
 
-static GList *
+static void
+gimp_lineart_find_spline_candidates_range (gsize                 offset,
+                                           gsize                 size,
+                                           SplineCandidatesPass *pass)
+{
+  GArray *max_positions = pass->max_positions;
+  gint    n_chunks      = pass->n_chunks;
+  gint    w;
+
+  for (w = offset; w < offset + size; w++)
+    {
+      /* Key points are compared with all the following ones, so the
+       * first chunks are the most expensive.  Interleave chunks from
+       * both ends, so that each thread gets a similar amount of work.
+       */
+      gint    chunk = (w % 2 == 0) ? w / 2 : n_chunks - 1 - w / 2;
+      gint    start = chunk * SPLINE_CANDIDATES_CHUNK_SIZE;
+      gint    end   = MIN (start + SPLINE_CANDIDATES_CHUNK_SIZE,
+                           max_positions->len);
+      GArray *candidates;
+      gint    i;
+
+      candidates = g_array_new (FALSE, FALSE, sizeof (SplineCandidate));
+      pass->chunks[chunk] = candidates;
+
+      for (i = start; i < end; i++)
+        {
+          Pixel p1 = g_array_index (max_positions, Pixel, i);
+          gint  j;
+
+          if (gimp_async_is_canceled (pass->async))
+            return;
+
+          for (j = i + 1; j < max_positions->len; j++)
+            {
+              Pixel       p2 = g_array_index (max_positions, Pixel, j);
+              const float distance = gimp_vector2_length_val (gimp_vector2_sub_val (p1, p2));
+
+              if (distance <= pass->distance_threshold)
+                {
+                  GimpVector2 normalP1;
+                  GimpVector2 normalP2;
+                  GimpVector2 p1f;
+                  GimpVector2 p2f;
+                  GimpVector2 p1p2;
+                  float       cosN;
+                  float       qualityA;
+                  float       qualityB;
+                  float       qualityC;
+                  float       quality;
+
+                  normalP1 = pair2normal (p1, pass->normals, pass->width);
+                  normalP2 = pair2normal (p2, pass->normals, pass->width);
+                  p1f = gimp_vector2_new (p1.x, p1.y);
+                  p2f = gimp_vector2_new (p2.x, p2.y);
+                  p1p2 = gimp_vector2_sub_val (p2f, p1f);
+
+                  cosN = gimp_vector2_inner_product_val (normalP1, (gimp_vector2_neg_val (normalP2)));
+                  qualityA = MAX (0.0f, 1 - distance / pass->distance_threshold);
+                  qualityB = MAX (0.0f,
+                                  (float) (gimp_vector2_inner_product_val (normalP1, p1p2) - gimp_vector2_inner_product_val (normalP2, p1p2)) /
+                                  distance);
+                  qualityC = MAX (0.0f, cosN - pass->cos_min);
+                  quality = qualityA * qualityB * qualityC;
+                  if (quality > 0)
+                    {
+                      SplineCandidate candidate;
+
+                      candidate.p1      = p1;
+                      candidate.p2      = p2;
+                      candidate.quality = quality;
+
+                      g_array_append_val (candidates, candidate);
+                    }
+                }
+            }
+        }
+    }
+}
+
+static GArray *
 gimp_lineart_find_spline_candidates (GArray    *max_positions,
                                      gfloat    *normals,
                                      gint       width,
@@ -1959,72 +2121,61 @@ gimp_lineart_find_spline_candidates (GArray    *max_positions,
                                      gfloat     max_angle_deg,
                                      GimpAsync *async)
 {
-  GList       *candidates = NULL;
-  const float  CosMin     = cosf (M_PI * (max_angle_deg / 180.0));
-  gint         i;
-
-  for (i = 0; i < max_positions->len; i++)
+  SplineCandidatesPass  pass;
+  GArray               *candidates;
+  gint                  c;
+
+  pass.max_positions      = max_positions;
+  pass.normals            = normals;
+  pass.width              = width;
+  pass.distance_threshold = distance_threshold;
+  pass.cos_min            = cosf (M_PI * (max_angle_deg / 180.0));
+  pass.n_chunks           = (max_positions->len +
+                             SPLINE_CANDIDATES_CHUNK_SIZE - 1) /
+                            SPLINE_CANDIDATES_CHUNK_SIZE;
+  pass.chunks             = g_new0 (GArray *, MAX (pass.n_chunks, 1));
+  pass.async              = async;
+
+  gegl_parallel_distribute_range (pass.n_chunks, 1,
+                                  (GeglParallelDistributeRangeFunc)
+                                  gimp_lineart_find_spline_candidates_range,
+                                  &pass);
+
+  candidates = g_array_new (FALSE, FALSE, sizeof (SplineCandidate));
+
+  /* Among candidates of equal quality, the most recently found come
+   * first.  Gather the candidates in reverse order before the (stable)
+   * sort.
+   */
+  for (c = pass.n_chunks - 1; c >= 0; c--)
     {
-      Pixel p1 = g_array_index (max_positions, Pixel, i);
-      gint  j;
+      GArray *chunk = pass.chunks[c];
+      gint    i;
 
-      if (gimp_async_is_canceled (async))
-        {
-          gimp_async_abort (async);
+      if (! chunk)
+        continue;
 
-          g_list_free_full (candidates, g_free);
+      for (i = (gint) chunk->len - 1; i >= 0; i--)
+        g_array_append_val (candidates, g_array_index (chunk, SplineCandidate, i));
 
-          return NULL;
-        }
+      g_array_free (chunk, TRUE);
+    }
 
-      for (j = i + 1; j < max_positions->len; j++)
-        {
-          Pixel       p2 = g_array_index (max_positions, Pixel, j);
-          const float distance = gimp_vector2_length_val (gimp_vector2_sub_val (p1, p2));
+  g_free (pass.chunks);
 
-          if (distance <= distance_threshold)
-            {
-              GimpVector2 normalP1;
-              GimpVector2 normalP2;
-              GimpVector2 p1f;
-              GimpVector2 p2f;
-              GimpVector2 p1p2;
-              float       cosN;
-              float       qualityA;
-              float       qualityB;
-              float       qualityC;
-              float       quality;
-
-              normalP1 = gimp_vector2_new (normals[((gint) p1.x + (gint) p1.y * width) * 2],
-                                           normals[((gint) p1.x + (gint) p1.y * width) * 2 + 1]);
-              normalP2 = gimp_vector2_new (normals[((gint) p2.x + (gint) p2.y * width) * 2],
-                                           normals[((gint) p2.x + (gint) p2.y * width) * 2 + 1]);
-              p1f = gimp_vector2_new (p1.x, p1.y);
-              p2f = gimp_vector2_new (p2.x, p2.y);
-              p1p2 = gimp_vector2_sub_val (p2f, p1f);
-
-              cosN = gimp_vector2_inner_product_val (normalP1, (gimp_vector2_neg_val (normalP2)));
-              qualityA = MAX (0.0f, 1 - distance / distance_threshold);
-              qualityB = MAX (0.0f,
-                              (float) (gimp_vector2_inner_product_val (normalP1, p1p2) - gimp_vector2_inner_product_val (normalP2, p1p2)) /
-                              distance);
-              qualityC = MAX (0.0f, cosN - CosMin);
-              quality = qualityA * qualityB * qualityC;
-              if (quality > 0)
-                {
-                  SplineCandidate *candidate = g_new (SplineCandidate, 1);
+  if (gimp_async_is_canceled (async))
+    {
+      gimp_async_abort (async);
 
-                  candidate->p1      = p1;
-                  candidate->p2      = p2;
-                  candidate->quality = quality;
+      g_array_free (candidates, TRUE);
 
-                  candidates = g_list_insert_sorted_with_data (candidates, candidate,
-                                                               (GCompareDataFunc) gimp_spline_candidate_cmp,
-                                                               NULL);
-                }
-            }
-        }
+      return NULL;
     }
+
+  g_array_sort_with_data (candidates,
+                          (GCompareDataFunc) gimp_spline_candidate_cmp,
+                          NULL);
+
   return candidates;
 }
 
@@ -2078,42 +2229,59 @@ gimp_lineart_discrete_spline (Pixel       p0,
 }
 
 static gint
-gimp_number_of_transitions (GArray     *pixels,
-                            GeglBuffer *buffer)
+gimp_number_of_transitions (GArray            *pixels,
+                            const LineArtMask *mask)
 {
   int result = 0;
 
   if (pixels->len > 0)
     {
       Pixel    it = g_array_index (pixels, Pixel, 0);
-      guchar   value;
       gboolean previous;
       gint     i;
 
-      gegl_buffer_sample (buffer, (gint) it.x, (gint) it.y, NULL, &value, NULL,
-                          GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-      previous = (gboolean) value;
+      previous = (gboolean) gimp_lineart_mask_get (mask, (gint) it.x, (gint) it.y);
 
       /* Starts at the second element. */
       for (i = 1; i < pixels->len; i++)
         {
-          it = g_array_index (pixels, Pixel, i);
+          gboolean value;
+
+          it    = g_array_index (pixels, Pixel, i);
+          value = (gboolean) gimp_lineart_mask_get (mask, (gint) it.x, (gint) it.y);
 
-          gegl_buffer_sample (buffer, (gint) it.x, (gint) it.y, NULL, &value, NULL,
-                              GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-          result += ((gboolean) value != previous);
-          previous = (gboolean) value;
+          result += (value != previous);
+          previous = value;
         }
     }
 
   return result;
 }
 
+/* Remove the marks left by gimp_line_art_allow_closure() on @pixels. */
+static void
+gimp_line_art_clear_marks (LineArtMask *mask,
+                           GArray      *pixels)
+{
+  gint i;
+
+  for (i = 0; i < pixels->len; i++)
+    {
+      Pixel p = g_array_index (pixels, Pixel, i);
+
+      if (p.x >= 0 && p.x < mask->width &&
+          p.y >= 0 && p.y < mask->height)
+        {
+          mask->data[(gint) p.x + (gint) p.y * mask->width] &= 1;
+        }
+    }
+}
+
 /**
  * gimp_line_art_allow_closure:
  * @mask: the current state of line art closure.
  * @pixels: the pixels of a candidate closure (spline or segment).
- * @fill_pixels: #GList of insignificant pixels to bucket fill.
+ * @fill_pixels: #GArray of insignificant pixels to bucket fill.
  * @significant_size: number of pixels for area to be considered
  *                    "significant".
  * @minimum_size: number of pixels for area to be allowed.
@@ -2132,11 +2300,11 @@ gimp_number_of_transitions (GArray     *pixels,
  * Returns: %TRUE if @pixels should be added to @mask, %FALSE otherwise.
  */
 static gboolean
-gimp_line_art_allow_closure (GeglBuffer *mask,
-                             GArray     *pixels,
-                             GList     **fill_pixels,
-                             int         significant_size,
-                             int         minimum_size)
+gimp_line_art_allow_closure (LineArtMask *mask,
+                             GArray      *pixels,
+                             GArray      *fill_pixels,
+                             int          significant_size,
+                             int          minimum_size)
 {
   /* A theorem from the paper is that a zone with more than
    * `2 * (@minimum_size - 1)` edgels (border pixels) will have more
@@ -2146,25 +2314,22 @@ gimp_line_art_allow_closure (GeglBuffer *mask,
    */
   const glong max_edgel_count = 2 * minimum_size;
 
-  Pixel      *p = (Pixel*) pixels->data;
-  GList      *fp = NULL;
+  guint       n_fill_pixels   = fill_pixels->len;
+  guint       j;
   gint        i;
 
   /* Mark pixels */
   for (i = 0; i < pixels->len; i++)
     {
-      if (p->x >= 0 && p->x < gegl_buffer_get_width (mask) &&
-          p->y >= 0 && p->y < gegl_buffer_get_height (mask))
+      Pixel p = g_array_index (pixels, Pixel, i);
+
+      if (p.x >= 0 && p.x < mask->width &&
+          p.y >= 0 && p.y < mask->height)
         {
-          guchar val;
+          guchar *val = &mask->data[(gint) p.x + (gint) p.y * mask->width];
 
-          gegl_buffer_sample (mask, (gint) p->x, (gint) p->y, NULL, &val,
-                              NULL, GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-          val = val ? 3 : 2;
-          gegl_buffer_set (mask, GEGL_RECTANGLE ((gint) p->x, (gint) p->y, 1, 1), 0,
-                           NULL, &val, GEGL_AUTO_ROWSTRIDE);
+          *val = *val ? 3 : 2;
         }
-      p++;
     }
 
   for (i = 0; i < pixels->len; i++)
@@ -2173,8 +2338,8 @@ gimp_line_art_allow_closure (GeglBuffer *mask,
 
       for (int direction = 0; direction < 4; ++direction)
         {
-          if (p.x >= 0 && p.x < gegl_buffer_get_width (mask) &&
-              p.y >= 0 && p.y < gegl_buffer_get_height (mask) &&
+          if (p.x >= 0 && p.x < mask->width &&
+              p.y >= 0 && p.y < mask->height &&
               border_in_direction (mask, p, direction))
             {
               Edgel  e;
@@ -2182,8 +2347,7 @@ gimp_line_art_allow_closure (GeglBuffer *mask,
               glong  count;
               glong  area;
 
-              gegl_buffer_sample (mask, (gint) p.x, (gint) p.y, NULL, &val,
-                                  NULL, GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
+              val = mask->data[(gint) p.x + (gint) p.y * mask->width];
               if ((gboolean) (val & (4 << direction)))
                 continue;
 
@@ -2199,75 +2363,53 @@ gimp_line_art_allow_closure (GeglBuffer *mask,
 
                   if (area >= significant_size && area < minimum_size)
                     {
-                      gint j;
-
-                      /* Remove marks */
-                      for (j = 0; j < pixels->len; j++)
-                        {
-                          Pixel p2 = g_array_index (pixels, Pixel, j);
-
-                          if (p2.x >= 0 && p2.x < gegl_buffer_get_width (mask) &&
-                              p2.y >= 0 && p2.y < gegl_buffer_get_height (mask))
-                            {
-                              guchar val;
-
-                              gegl_buffer_sample (mask, (gint) p2.x, (gint) p2.y, NULL, &val,
-                                                  NULL, GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-                              val &= 1;
-                              gegl_buffer_set (mask, GEGL_RECTANGLE ((gint) p2.x, (gint) p2.y, 1, 1), 0,
-                                               NULL, &val, GEGL_AUTO_ROWSTRIDE);
-                            }
-                        }
-                      g_list_free_full (fp, g_free);
+                      gimp_line_art_clear_marks (mask, pixels);
+                      g_array_set_size (fill_pixels, n_fill_pixels);
 
                       return FALSE;
                     }
                   else if (area > 0 && area < significant_size)
                     {
-                      Pixel *np = g_new (Pixel, 1);
+                      Pixel np;
 
-                      np->x = direction == XPlusDirection ? p.x + 1 : (direction == XMinusDirection ? p.x - 1 : p.x);
-                      np->y = direction == YPlusDirection ? p.y + 1 : (direction == YMinusDirection ? p.y - 1 : p.y);
+                      np.x = direction == XPlusDirection ? p.x + 1 : (direction == XMinusDirection ? p.x - 1 : p.x);
+                      np.y = direction == YPlusDirection ? p.y + 1 : (direction == YMinusDirection ? p.y - 1 : p.y);
 
-                      if (np->x >= 0 && np->x < gegl_buffer_get_width (mask) &&
-                          np->y >= 0 && np->y < gegl_buffer_get_height (mask))
-                        fp = g_list_prepend (fp, np);
-                      else
-                        g_free (np);
+                      if (np.x >= 0 && np.x < mask->width &&
+                          np.y >= 0 && np.y < mask->height)
+                        g_array_append_val (fill_pixels, np);
                     }
                 }
             }
         }
     }
 
-  *fill_pixels = g_list_concat (*fill_pixels, fp);
-  /* Remove marks */
-  for (i = 0; i < pixels->len; i++)
+  /* The micro-areas of a closure are filled in reverse order of
+   * discovery.
+   */
+  for (j = 0; j < (fill_pixels->len - n_fill_pixels) / 2; j++)
     {
-      Pixel p = g_array_index (pixels, Pixel, i);
+      Pixel *p1 = &g_array_index (fill_pixels, Pixel, n_fill_pixels + j);
+      Pixel *p2 = &g_array_index (fill_pixels, Pixel, fill_pixels->len - 1 - j);
+      Pixel  tmp;
 
-      if (p.x >= 0 && p.x < gegl_buffer_get_width (mask) &&
-          p.y >= 0 && p.y < gegl_buffer_get_height (mask))
-        {
-          guchar val;
-
-          gegl_buffer_sample (mask, (gint) p.x, (gint) p.y, NULL, &val,
-                              NULL, GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-          val &= 1;
-          gegl_buffer_set (mask, GEGL_RECTANGLE ((gint) p.x, (gint) p.y, 1, 1), 0,
-                           NULL, &val, GEGL_AUTO_ROWSTRIDE);
-        }
+      tmp = *p1;
+      *p1 = *p2;
+      *p2 = tmp;
     }
+
+  /* Remove marks */
+  gimp_line_art_clear_marks (mask, pixels);
+
   return TRUE;
 }
 
 static GArray *
-gimp_lineart_line_segment_until_hit (const GeglBuffer *mask,
-                                     Pixel             start,
-                                     GimpVector2       direction,
-                                     int               size)
+gimp_lineart_line_segment_until_hit (const LineArtMask *mask,
+                                     Pixel              start,
+                                     GimpVector2        direction,
+                                     int                size)
 {
-  GeglBuffer  *buffer = (GeglBuffer *) mask;
   gboolean     out = FALSE;
   GArray      *points = g_array_new (FALSE, TRUE, sizeof (Pixel));
   int          tmax;
@@ -2286,12 +2428,11 @@ gimp_lineart_line_segment_until_hit (const GeglBuffer *mask,
 
       p.x = (gint) round (v.x);
       p.y = (gint) round (v.y);
-      if (p.x >= 0 && p.x < gegl_buffer_get_width (buffer) &&
-          p.y >= 0 && p.y < gegl_buffer_get_height (buffer))
+      if (p.x >= 0 && p.x < mask->width &&
+          p.y >= 0 && p.y < mask->height)
         {
-          guchar val;
-          gegl_buffer_sample (buffer, p.x, p.y, NULL, &val,
-                              NULL, GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
+          guchar val = mask->data[(gint) p.x + (gint) p.y * mask->width];
+
           if (out && val)
             {
               return points;
@@ -2314,21 +2455,220 @@ gimp_lineart_line_segment_until_hit (const GeglBuffer *mask,
   return g_array_new (FALSE, TRUE, sizeof (Pixel));
 }
 
+static void
+gimp_lineart_estimate_strokes_radii_rows (gsize             offset,
+                                          gsize             size,
+                                          LineArtPixelPass *pass)
+{
+  const gfloat *dist   = pass->dist;
+  gint          width  = pass->mask->width;
+  gint          height = pass->mask->height;
+  gint          x;
+  gint          y;
+
+  for (y = offset; y < offset + size; y++)
+    {
+      const guchar *m = pass->mask->data + (gsize) y * width;
+
+      if (gimp_async_is_canceled (pass->async))
+        return;
+
+      for (x = 0; x < width; x++)
+        {
+          if (m[x] && dist[x + y * width] == 1.0)
+            {
+              gint     dx = x;
+              gint     dy = y;
+              gfloat   d  = 1.0;
+              gfloat   nd;
+              gboolean neighbour_thicker = TRUE;
+
+              while (neighbour_thicker)
+                {
+                  gint px = dx - 1;
+                  gint py = dy - 1;
+                  gint nx = dx + 1;
+                  gint ny = dy + 1;
+
+                  neighbour_thicker = FALSE;
+                  if (px >= 0)
+                    {
+                      if ((nd = dist[px + dy * width]) > d)
+                        {
+                          d = nd;
+                          dx = px;
+                          neighbour_thicker = TRUE;
+                          continue;
+                        }
+                      if (py >= 0 && (nd = dist[px + py * width]) > d)
+                        {
+                          d = nd;
+                          dx = px;
+                          dy = py;
+                          neighbour_thicker = TRUE;
+                          continue;
+                        }
+                      if (ny < height && (nd = dist[px + ny * width]) > d)
+                        {
+                          d = nd;
+                          dx = px;
+                          dy = ny;
+                          neighbour_thicker = TRUE;
+                          continue;
+                        }
+                    }
+                  if (nx < width)
+                    {
+                      if ((nd = dist[nx + dy * width]) > d)
+                        {
+                          d = nd;
+                          dx = nx;
+                          neighbour_thicker = TRUE;
+                          continue;
+                        }
+                      if (py >= 0 && (nd = dist[nx + py * width]) > d)
+                        {
+                          d = nd;
+                          dx = nx;
+                          dy = py;
+                          neighbour_thicker = TRUE;
+                          continue;
+                        }
+                      if (ny < height && (nd = dist[nx + ny * width]) > d)
+                        {
+                          d = nd;
+                          dx = nx;
+                          dy = ny;
+                          neighbour_thicker = TRUE;
+                          continue;
+                        }
+                    }
+                  if (py > 0 && (nd = dist[dx + py * width]) > d)
+                    {
+                      d = nd;
+                      dy = py;
+                      neighbour_thicker = TRUE;
+                      continue;
+                    }
+                  if (ny < height && (nd = dist[dx + ny * width]) > d)
+                    {
+                      d = nd;
+                      dy = ny;
+                      neighbour_thicker = TRUE;
+                      continue;
+                    }
+                }
+              pass->radii[x + y * width] = d;
+            }
+        }
+    }
+}
+
 static gfloat *
-gimp_lineart_estimate_strokes_radii (GeglBuffer *mask,
-                                     GimpAsync  *async)
-{
-  GeglBufferIterator *gi;
-  gfloat             *dist;
-  gfloat             *thickness;
-  GeglNode           *graph;
-  GeglNode           *input;
-  GeglNode           *op;
-  gint                width  = gegl_buffer_get_width (mask);
-  gint                height = gegl_buffer_get_height (mask);
+gimp_lineart_estimate_strokes_radii (const LineArtMask *mask,
+                                     GimpAsync         *async)
+{
+  LineArtPixelPass  pass = { 0, };
+  GeglBuffer       *buffer;
+  gfloat           *dist;
 
   /* Compute a distance map for the line art. */
-  dist = g_new (gfloat, width * height);
+  buffer = gegl_buffer_linear_new_from_data (mask->data,
+                                             babl_format ("Y' u8"),
+                                             GEGL_RECTANGLE (0, 0,
+                                                             mask->width,
+                                                             mask->height),
+                                             GEGL_AUTO_ROWSTRIDE,
+                                             NULL, NULL);
+  dist = gimp_lineart_distance_map (buffer);
+  g_object_unref (buffer);
+
+  pass.mask  = mask;
+  pass.dist  = dist;
+  pass.radii = g_new0 (gfloat, (gsize) mask->width * mask->height);
+  pass.async = async;
+
+  gegl_parallel_distribute_range (mask->height,
+                                  MAX (PIXELS_PER_THREAD / mask->width, 1),
+                                  (GeglParallelDistributeRangeFunc)
+                                  gimp_lineart_estimate_strokes_radii_rows,
+                                  &pass);
+
+  g_free (dist);
+
+  if (gimp_async_is_canceled (async))
+    {
+      gimp_async_abort (async);
+
+      g_clear_pointer (&pass.radii, g_free);
+    }
+
+  return pass.radii;
+}
+
+static void
+gimp_lineart_threshold_curvatures_rows (gsize             offset,
+                                        gsize             size,
+                                        LineArtPixelPass *pass)
+{
+  const gfloat threshold         = pass->threshold;
+  const gfloat clamped_threshold = MAX (0.25f, threshold);
+  gint         width             = pass->mask->width;
+  gint         y;
+
+  for (y = offset; y < offset + size; y++)
+    {
+      gint x;
+
+      for (x = 0; x < width; x++)
+        {
+          gint i = x + y * width;
+
+          if (pass->smoothed_curvatures[i] >= (threshold / MAX (1.0f, pass->radii[i])) ||
+              pass->curvatures[i] >= clamped_threshold)
+            pass->curvatures[i] = 1.0;
+          else
+            pass->curvatures[i] = 0.0;
+        }
+    }
+}
+
+/* Keep only the pixels whose curvature, relative to the stroke radius,
+ * is above @threshold: they are the candidate end points.
+ */
+static void
+gimp_lineart_threshold_curvatures (const LineArtMask *mask,
+                                   gfloat            *curvatures,
+                                   gfloat            *smoothed_curvatures,
+                                   const gfloat      *radii,
+                                   gfloat             threshold)
+{
+  LineArtPixelPass pass = { 0, };
+
+  pass.mask                = mask;
+  pass.curvatures          = curvatures;
+  pass.smoothed_curvatures = smoothed_curvatures;
+  pass.radii               = (gfloat *) radii;
+  pass.threshold           = threshold;
+
+  gegl_parallel_distribute_range (mask->height,
+                                  MAX (PIXELS_PER_THREAD / mask->width, 1),
+                                  (GeglParallelDistributeRangeFunc)
+                                  gimp_lineart_threshold_curvatures_rows,
+                                  &pass);
+}
+
+/* Returns a distance map of the background of @mask to its strokes. */
+static gfloat *
+gimp_lineart_distance_map (GeglBuffer *mask)
+{
+  GeglNode *graph;
+  GeglNode *input;
+  GeglNode *op;
+  gfloat   *dist;
+
+  dist = g_new (gfloat, (gsize) gegl_buffer_get_width  (mask) *
+                                gegl_buffer_get_height (mask));
 
   graph = gegl_node_new ();
   input = gegl_node_new_child (graph,
@@ -2345,190 +2685,45 @@ gimp_lineart_estimate_strokes_radii (GeglBuffer *mask,
                   NULL, dist, GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
   g_object_unref (graph);
 
-  thickness = g_new0 (gfloat, width * height);
-  gi = gegl_buffer_iterator_new (mask, NULL, 0, NULL,
-                                 GEGL_ACCESS_READ, GEGL_ABYSS_NONE, 1);
-  while (gegl_buffer_iterator_next (gi))
-    {
-      guint8 *m = (guint8*) gi->items[0].data;
-      gint    startx = gi->items[0].roi.x;
-      gint    starty = gi->items[0].roi.y;
-      gint    endy   = starty + gi->items[0].roi.height;
-      gint    endx   = startx + gi->items[0].roi.width;
-      gint    x;
-      gint    y;
-
-      if (gimp_async_is_canceled (async))
-        {
-          gegl_buffer_iterator_stop (gi);
-
-          gimp_async_abort (async);
-
-          goto end;
-        }
-
-      for (y = starty; y < endy; y++)
-        for (x = startx; x < endx; x++)
-          {
-            if (*m && dist[x + y * width] == 1.0)
-              {
-                gint     dx = x;
-                gint     dy = y;
-                gfloat   d  = 1.0;
-                gfloat   nd;
-                gboolean neighbour_thicker = TRUE;
-
-                while (neighbour_thicker)
-                  {
-                    gint px = dx - 1;
-                    gint py = dy - 1;
-                    gint nx = dx + 1;
-                    gint ny = dy + 1;
-
-                    neighbour_thicker = FALSE;
-                    if (px >= 0)
-                      {
-                        if ((nd = dist[px + dy * width]) > d)
-                          {
-                            d = nd;
-                            dx = px;
-                            neighbour_thicker = TRUE;
-                            continue;
-                          }
-                        if (py >= 0 && (nd = dist[px + py * width]) > d)
-                          {
-                            d = nd;
-                            dx = px;
-                            dy = py;
-                            neighbour_thicker = TRUE;
-                            continue;
-                          }
-                        if (ny < height && (nd = dist[px + ny * width]) > d)
-                          {
-                            d = nd;
-                            dx = px;
-                            dy = ny;
-                            neighbour_thicker = TRUE;
-                            continue;
-                          }
-                      }
-                    if (nx < width)
-                      {
-                        if ((nd = dist[nx + dy * width]) > d)
-                          {
-                            d = nd;
-                            dx = nx;
-                            neighbour_thicker = TRUE;
-                            continue;
-                          }
-                        if (py >= 0 && (nd = dist[nx + py * width]) > d)
-                          {
-                            d = nd;
-                            dx = nx;
-                            dy = py;
-                            neighbour_thicker = TRUE;
-                            continue;
-                          }
-                        if (ny < height && (nd = dist[nx + ny * width]) > d)
-                          {
-                            d = nd;
-                            dx = nx;
-                            dy = ny;
-                            neighbour_thicker = TRUE;
-                            continue;
-                          }
-                      }
-                    if (py > 0 && (nd = dist[dx + py * width]) > d)
-                      {
-                        d = nd;
-                        dy = py;
-                        neighbour_thicker = TRUE;
-                        continue;
-                      }
-                    if (ny < height && (nd = dist[dx + ny * width]) > d)
-                      {
-                        d = nd;
-                        dy = ny;
-                        neighbour_thicker = TRUE;
-                        continue;
-                      }
-                  }
-                thickness[(gint) x + (gint) y * width] = d;
-              }
-            m++;
-          }
-    }
-
- end:
-  g_free (dist);
-
-  if (gimp_async_is_stopped (async))
-    g_clear_pointer (&thickness, g_free);
-
-  return thickness;
+  return dist;
 }
 
 static void
-gimp_line_art_simple_fill (GeglBuffer *buffer,
-                           gint        x,
-                           gint        y,
-                           gint       *counter)
+gimp_line_art_simple_fill (LineArtMask *mask,
+                           gint         x,
+                           gint         y,
+                           gint        *counter)
 {
-  guchar val;
+  guchar *val;
 
-  if (x < 0 || x >= gegl_buffer_get_width (buffer)  ||
-      y < 0 || y >= gegl_buffer_get_height (buffer) ||
+  if (x < 0 || x >= mask->width  ||
+      y < 0 || y >= mask->height ||
       *counter <= 0)
     return;
 
-  gegl_buffer_sample (buffer, x, y, NULL, &val,
-                      NULL, GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
+  val = &mask->data[x + y * mask->width];
 
-  if (! val)
+  if (! *val)
     {
-      val = 1;
-      gegl_buffer_set (buffer, GEGL_RECTANGLE (x, y, 1, 1), 0,
-                       NULL, &val, GEGL_AUTO_ROWSTRIDE);
+      *val = 1;
       (*counter)--;
-      gimp_line_art_simple_fill (buffer, x + 1, y, counter);
-      gimp_line_art_simple_fill (buffer, x - 1, y, counter);
-      gimp_line_art_simple_fill (buffer, x, y + 1, counter);
-      gimp_line_art_simple_fill (buffer, x, y - 1, counter);
+      gimp_line_art_simple_fill (mask, x + 1, y, counter);
+      gimp_line_art_simple_fill (mask, x - 1, y, counter);
+      gimp_line_art_simple_fill (mask, x, y + 1, counter);
+      gimp_line_art_simple_fill (mask, x, y - 1, counter);
     }
 }
 
-static guint
-visited_hash_fun (Pixel *key)
-{
-  /* Cantor pairing function. */
-  return (key->x + key->y) * (key->x + key->y + 1) / 2 + key->y;
-}
-
-static gboolean
-visited_equal_fun (Pixel *e1,
-                   Pixel *e2)
-{
-  return (e1->x == e2->x && e1->y == e2->y);
-}
-
 static inline gboolean
-border_in_direction (GeglBuffer *mask,
-                     Pixel       p,
-                     int         direction)
+border_in_direction (const LineArtMask *mask,
+                     Pixel              p,
+                     int                direction)
 {
   gint px = (gint) p.x + DeltaX[direction];
   gint py = (gint) p.y + DeltaY[direction];
 
-  if (px >= 0 && px < gegl_buffer_get_width (mask) &&
-      py >= 0 && py < gegl_buffer_get_height (mask))
-    {
-      guchar val;
-
-      gegl_buffer_sample (mask, px, py, NULL, &val,
-                          NULL, GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-      return ! ((gboolean) val);
-    }
-  return TRUE;
+  /* Out of the mask is background. */
+  return ! gimp_lineart_mask_get (mask, px, py);
 }
 
 static inline GimpVector2
@@ -2541,22 +2736,6 @@ pair2normal (Pixel   p,
 }
 /* Edgel functions */
 
-static Edgel *
-gimp_edgel_new (int       x,
-                int       y,
-                Direction direction)
-{
-  Edgel *edgel = g_new (Edgel, 1);
-
-  edgel->x         = x;
-  edgel->y         = y;
-  edgel->direction = direction;
-
-  gimp_edgel_init (edgel);
-
-  return edgel;
-}
-
 static void
 gimp_edgel_init (Edgel *edgel)
 {
@@ -2566,12 +2745,6 @@ gimp_edgel_init (Edgel *edgel)
   edgel->next      = edgel->previous = G_MAXUINT;
 }
 
-static void
-gimp_edgel_clear (Edgel **edgel)
-{
-  g_clear_pointer (edgel, g_free);
-}
-
 static int
 gimp_edgel_cmp (const Edgel* e1,
                 const Edgel* e2)
@@ -2588,23 +2761,6 @@ gimp_edgel_cmp (const Edgel* e1,
     return 1;
 }
 
-static guint
-edgel2index_hash_fun (Edgel *key)
-{
-  /* Cantor pairing function.
-   * Was not sure how to use the direction though. :-/
-   */
-  return (key->x + key->y) * (key->x + key->y + 1) / 2 + key->y * key->direction;
-}
-
-static gboolean
-edgel2index_equal_fun (Edgel *e1,
-                       Edgel *e2)
-{
-  return (e1->x == e2->x && e1->y == e2->y &&
-          e1->direction == e2->direction);
-}
-
 /**
  * @mask;
  * @edgel:
@@ -2618,30 +2774,27 @@ edgel2index_equal_fun (Edgel *e1,
  *          has been encountered.
  */
 static glong
-gimp_edgel_track_mark (GeglBuffer *mask,
-                       Edgel       edgel,
-                       long        size_limit)
+gimp_edgel_track_mark (LineArtMask *mask,
+                       Edgel        edgel,
+                       long         size_limit)
 {
   Edgel start = edgel;
   long  count = 1;
 
   do
     {
-      guchar val;
+      guchar *val;
 
       gimp_edgelset_next8 (mask, &edgel, &edgel);
-      gegl_buffer_sample (mask, edgel.x, edgel.y, NULL, &val,
-                          NULL, GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-      if (val & 2)
+      val = &mask->data[edgel.x + edgel.y * mask->width];
+      if (*val & 2)
         {
           /* Only mark pixels of the spline/segment */
-          if (val & (4 << edgel.direction))
+          if (*val & (4 << edgel.direction))
             return -1;
 
           /* Mark edgel in pixel (1 == In Mask, 2 == Spline/Segment) */
-          val |= (4 << edgel.direction);
-          gegl_buffer_set (mask, GEGL_RECTANGLE (edgel.x, edgel.y, 1, 1), 0,
-                           NULL, &val, GEGL_AUTO_ROWSTRIDE);
+          *val |= (4 << edgel.direction);
         }
       if (gimp_edgel_cmp (&edgel, &start) != 0)
         ++count;
@@ -2653,7 +2806,7 @@ gimp_edgel_track_mark (GeglBuffer *mask,
 
 /**
  * gimp_edgel_region_area:
- * @mask: current state of closed line art buffer.
+ * @mask: current state of closed line art.
  * @start_edgel: edgel to follow.
  *
  * Follows a line border, starting from @start_edgel to compute the area
@@ -2666,8 +2819,8 @@ gimp_edgel_track_mark (GeglBuffer *mask,
  * if the zone is not closed (hence actual area unknown).
  */
 static glong
-gimp_edgel_region_area (const GeglBuffer *mask,
-                        Edgel             start_edgel)
+gimp_edgel_region_area (const LineArtMask *mask,
+                        Edgel              start_edgel)
 {
   Edgel edgel = start_edgel;
   glong area = 0;
@@ -2688,136 +2841,231 @@ gimp_edgel_region_area (const GeglBuffer *mask,
 
 /* Edgel sets */
 
-static GArray *
-gimp_edgelset_new (GeglBuffer *buffer,
-                   GimpAsync  *async)
+static void
+gimp_edgelset_count_rows (gsize         offset,
+                          gsize         size,
+                          EdgelSetPass *pass)
 {
-  GeglBufferIterator *gi;
-  GArray             *set;
-  GHashTable         *edgel2index;
-  gint                width  = gegl_buffer_get_width (buffer);
-  gint                height = gegl_buffer_get_height (buffer);
+  const LineArtMask *mask = pass->mask;
+  gint               y;
 
-  set = g_array_new (TRUE, TRUE, sizeof (Edgel *));
-  g_array_set_clear_func (set, (GDestroyNotify) gimp_edgel_clear);
+  for (y = offset; y < offset + size; y++)
+    {
+      const guchar *row     = mask->data + (gsize) y * mask->width;
+      guint         n_edgels = 0;
+      gint          x;
 
-  if (width <= 1 || height <= 1)
-    return set;
+      for (x = 0; x < mask->width; x++)
+        {
+          if (row[x])
+            {
+              n_edgels += ! gimp_lineart_mask_get (mask, x, y - 1);
+              n_edgels += ! gimp_lineart_mask_get (mask, x, y + 1);
+              n_edgels += ! gimp_lineart_mask_get (mask, x - 1, y);
+              n_edgels += ! gimp_lineart_mask_get (mask, x + 1, y);
+            }
+        }
+
+      pass->row_edgels[y + 1] = n_edgels;
+    }
+}
+
+static void
+gimp_edgelset_fill_rows (gsize         offset,
+                         gsize         size,
+                         EdgelSetPass *pass)
+{
+  const LineArtMask *mask = pass->mask;
+  EdgelSet          *set  = pass->set;
+  gint               y;
 
-  edgel2index = g_hash_table_new ((GHashFunc) edgel2index_hash_fun,
-                                  (GEqualFunc) edgel2index_equal_fun);
-
-  gi = gegl_buffer_iterator_new (buffer, GEGL_RECTANGLE (0, 0, width, height),
-                                 0, NULL, GEGL_ACCESS_READ, GEGL_ABYSS_NONE, 5);
-  gegl_buffer_iterator_add (gi, buffer, GEGL_RECTANGLE (0, -1, width, height),
-                            0, NULL, GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
-  gegl_buffer_iterator_add (gi, buffer, GEGL_RECTANGLE (0, 1, width, height),
-                            0, NULL, GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
-  gegl_buffer_iterator_add (gi, buffer, GEGL_RECTANGLE (-1, 0, width, height),
-                            0, NULL, GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
-  gegl_buffer_iterator_add (gi, buffer, GEGL_RECTANGLE (1, 0, width, height),
-                            0, NULL, GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
-  while (gegl_buffer_iterator_next (gi))
+  for (y = offset; y < offset + size; y++)
     {
-      guint8 *p      = (guint8*) gi->items[0].data;
-      guint8 *prevy  = (guint8*) gi->items[1].data;
-      guint8 *nexty  = (guint8*) gi->items[2].data;
-      guint8 *prevx  = (guint8*) gi->items[3].data;
-      guint8 *nextx  = (guint8*) gi->items[4].data;
-      gint    startx = gi->items[0].roi.x;
-      gint    starty = gi->items[0].roi.y;
-      gint    endy   = starty + gi->items[0].roi.height;
-      gint    endx   = startx + gi->items[0].roi.width;
-      gint    x;
-      gint    y;
+      const guchar *row      = mask->data + (gsize) y * mask->width;
+      guint        *pixel    = set->pixel_edgels + (gsize) y * mask->width;
+      guint         position = pass->row_edgels[y];
+      gint          x;
 
-      if (gimp_async_is_canceled (async))
+      for (x = 0; x < mask->width; x++)
         {
-          gegl_buffer_iterator_stop (gi);
-
-          gimp_async_abort (async);
+          pixel[x] = position;
 
-          goto end;
+          if (row[x])
+            {
+              if (! gimp_lineart_mask_get (mask, x, y - 1))
+                gimp_edgelset_add (set, position++, x, y, YMinusDirection);
+              if (! gimp_lineart_mask_get (mask, x, y + 1))
+                gimp_edgelset_add (set, position++, x, y, YPlusDirection);
+              if (! gimp_lineart_mask_get (mask, x - 1, y))
+                gimp_edgelset_add (set, position++, x, y, XMinusDirection);
+              if (! gimp_lineart_mask_get (mask, x + 1, y))
+                gimp_edgelset_add (set, position++, x, y, XPlusDirection);
+            }
         }
-
-      for (y = starty; y < endy; y++)
-        for (x = startx; x < endx; x++)
-          {
-            if (*(p++))
-              {
-                if (! *prevy)
-                  gimp_edgelset_add (set, x, y, YMinusDirection, edgel2index);
-                if (! *nexty)
-                  gimp_edgelset_add (set, x, y, YPlusDirection, edgel2index);
-                if (! *prevx)
-                  gimp_edgelset_add (set, x, y, XMinusDirection, edgel2index);
-                if (! *nextx)
-                  gimp_edgelset_add (set, x, y, XPlusDirection, edgel2index);
-              }
-            prevy++;
-            nexty++;
-            prevx++;
-            nextx++;
-          }
     }
+}
 
-  gimp_edgelset_build_graph (set, buffer, edgel2index, async);
-  if (gimp_async_is_stopped (async))
-    goto end;
+static EdgelSet *
+gimp_edgelset_new (const LineArtMask *mask,
+                   GimpAsync         *async)
+{
+  EdgelSetPass  pass     = { 0, };
+  EdgelSet     *set;
+  gsize         min_rows = MAX (PIXELS_PER_THREAD / mask->width, 1);
+  gint          y;
 
-  gimp_edgelset_init_normals (set);
+  set = g_new0 (EdgelSet, 1);
+  set->pixel_edgels = g_new0 (guint, (gsize) mask->width * mask->height + 1);
 
- end:
-  g_hash_table_destroy (edgel2index);
+  if (mask->width <= 1 || mask->height <= 1)
+    return set;
+
+  pass.mask       = mask;
+  pass.set        = set;
+  pass.row_edgels = g_new (guint, mask->height + 1);
+  pass.async      = async;
+
+  pass.row_edgels[0] = 0;
+
+  gegl_parallel_distribute_range (mask->height, min_rows,
+                                  (GeglParallelDistributeRangeFunc)
+                                  gimp_edgelset_count_rows,
+                                  &pass);
+
+  for (y = 0; y < mask->height; y++)
+    pass.row_edgels[y + 1] += pass.row_edgels[y];
+
+  set->n_edgels = pass.row_edgels[mask->height];
+  set->edgels   = g_new (Edgel, MAX (set->n_edgels, 1));
+
+  gegl_parallel_distribute_range (mask->height, min_rows,
+                                  (GeglParallelDistributeRangeFunc)
+                                  gimp_edgelset_fill_rows,
+                                  &pass);
+
+  set->pixel_edgels[(gsize) mask->width * mask->height] = set->n_edgels;
+
+  g_free (pass.row_edgels);
 
+  if (gimp_async_is_canceled (async))
+    {
+      gimp_async_abort (async);
+
+      gimp_edgelset_free (set);
+
+      return NULL;
+    }
+
+  gimp_edgelset_build_graph (set, mask, async);
   if (gimp_async_is_stopped (async))
     {
-      g_array_free (set, TRUE);
-      set = NULL;
+      gimp_edgelset_free (set);
+
+      return NULL;
     }
 
   return set;
 }
 
 static void
-gimp_edgelset_add (GArray     *set,
-                   int         x,
-                   int         y,
-                   Direction   direction,
-                   GHashTable *edgel2index)
+gimp_edgelset_free (EdgelSet *set)
 {
-  Edgel         *edgel    = gimp_edgel_new (x, y, direction);
-  unsigned long  position = set->len;
+  if (set)
+    {
+      g_free (set->edgels);
+      g_free (set->pixel_edgels);
+      g_free (set);
+    }
+}
+
+static inline void
+gimp_edgelset_add (EdgelSet  *set,
+                   guint      position,
+                   int        x,
+                   int        y,
+                   Direction  direction)
+{
+  Edgel       *edgel = &set->edgels[position];
+  GimpVector2  n     = Direction2Normal[direction];
 
-  g_array_append_val (set, edgel);
-  g_hash_table_insert (edgel2index, edgel, GUINT_TO_POINTER (position));
+  gimp_edgel_init (edgel);
+
+  edgel->x         = x;
+  edgel->y         = y;
+  edgel->direction = direction;
+  edgel->x_normal  = n.x;
+  edgel->y_normal  = n.y;
+}
+
+/* Returns the position in @set of the edgel equal to @edgel, which must
+ * exist.  A pixel has at most 4 edgels.
+ */
+static inline guint
+gimp_edgelset_find (const EdgelSet *set,
+                    gint            width,
+                    const Edgel    *edgel)
+{
+  gsize pixel = edgel->x + (gsize) edgel->y * width;
+  guint i;
+
+  for (i = set->pixel_edgels[pixel]; i < set->pixel_edgels[pixel + 1]; i++)
+    {
+      if (set->edgels[i].direction == edgel->direction)
+        return i;
+    }
+
+  gimp_assert_not_reached ();
+
+  return G_MAXUINT;
 }
 
 static void
-gimp_edgelset_init_normals (GArray *set)
+gimp_edgelset_smooth_normals_range (gsize         offset,
+                                    gsize         size,
+                                    EdgelSetPass *pass)
 {
-  Edgel **e = (Edgel**) set->data;
+  Edgel *edgels = pass->set->edgels;
+  guint  idx;
 
-  while (*e)
+  for (idx = offset; idx < offset + size; idx++)
     {
-      GimpVector2 n = Direction2Normal[(*e)->direction];
+      Edgel       *it           = &edgels[idx];
+      Edgel       *edgel_before = &edgels[it->previous];
+      Edgel       *edgel_after  = &edgels[it->next];
+      GimpVector2  smoothed_normal;
+      int          n = pass->mask_size;
+      int          i = 1;
 
-      (*e)->x_normal = n.x;
-      (*e)->y_normal = n.y;
-      e++;
+      if (idx % EDGELS_PER_CANCEL_CHECK == 0 &&
+          gimp_async_is_canceled (pass->async))
+        return;
+
+      smoothed_normal = Direction2Normal[it->direction];
+      while (n-- && (edgel_after != edgel_before))
+        {
+          smoothed_normal = gimp_vector2_add_val (smoothed_normal,
+                                                  gimp_vector2_mul_val (Direction2Normal[edgel_before->direction], pass->weights[i]));
+          smoothed_normal = gimp_vector2_add_val (smoothed_normal,
+                                                  gimp_vector2_mul_val (Direction2Normal[edgel_after->direction], pass->weights[i]));
+          edgel_before = &edgels[edgel_before->previous];
+          edgel_after  = &edgels[edgel_after->next];
+          ++i;
+        }
+      gimp_vector2_normalize (&smoothed_normal);
+      it->x_normal = smoothed_normal.x;
+      it->y_normal = smoothed_normal.y;
     }
 }
 
 static void
-gimp_edgelset_smooth_normals (GArray    *set,
+gimp_edgelset_smooth_normals (EdgelSet  *set,
                               int        mask_size,
                               GimpAsync *async)
 {
+  EdgelSetPass pass  = { 0, };
   const gfloat sigma = mask_size * 0.775;
   const gfloat den   = 2 * sigma * sigma;
   gfloat       weights[65];
-  GimpVector2  smoothed_normal;
-  gint         i;
 
   gimp_assert (mask_size <= 65);
 
@@ -2825,49 +3073,36 @@ gimp_edgelset_smooth_normals (GArray    *set,
   for (int i = 1; i <= mask_size; ++i)
     weights[i] = expf (-(i * i) / den);
 
-  for (i = 0; i < set->len; i++)
-    {
-      Edgel *it           = g_array_index (set, Edgel*, i);
-      Edgel *edgel_before = g_array_index (set, Edgel*, it->previous);
-      Edgel *edgel_after  = g_array_index (set, Edgel*, it->next);
-      int    n = mask_size;
-      int    i = 1;
+  pass.set       = set;
+  pass.weights   = weights;
+  pass.mask_size = mask_size;
+  pass.async     = async;
 
-      if (gimp_async_is_canceled (async))
-        {
-          gimp_async_abort (async);
-
-          return;
-        }
+  /* Each edgel only reads the direction of its neighbors, so that all
+   * the normals can be smoothed in place, concurrently.
+   */
+  gegl_parallel_distribute_range (set->n_edgels, PIXELS_PER_THREAD,
+                                  (GeglParallelDistributeRangeFunc)
+                                  gimp_edgelset_smooth_normals_range,
+                                  &pass);
 
-      smoothed_normal = Direction2Normal[it->direction];
-      while (n-- && (edgel_after != edgel_before))
-        {
-          smoothed_normal = gimp_vector2_add_val (smoothed_normal,
-                                                  gimp_vector2_mul_val (Direction2Normal[edgel_before->direction], weights[i]));
-          smoothed_normal = gimp_vector2_add_val (smoothed_normal,
-                                                  gimp_vector2_mul_val (Direction2Normal[edgel_after->direction], weights[i]));
-          edgel_before = g_array_index (set, Edgel *, edgel_before->previous);
-          edgel_after  = g_array_index (set, Edgel *, edgel_after->next);
-          ++i;
-        }
-      gimp_vector2_normalize (&smoothed_normal);
-      it->x_normal = smoothed_normal.x;
-      it->y_normal = smoothed_normal.y;
-    }
+  if (gimp_async_is_canceled (async))
+    gimp_async_abort (async);
 }
 
 static void
-gimp_edgelset_compute_curvature (GArray    *set,
-                                 GimpAsync *async)
+gimp_edgelset_compute_curvature_range (gsize         offset,
+                                       gsize         size,
+                                       EdgelSetPass *pass)
 {
-  gint i;
+  Edgel *edgels = pass->set->edgels;
+  guint  i;
 
-  for (i = 0; i < set->len; i++)
+  for (i = offset; i < offset + size; i++)
     {
-      Edgel       *it       = g_array_index (set, Edgel*, i);
-      Edgel       *previous = g_array_index (set, Edgel *, it->previous);
-      Edgel       *next     = g_array_index (set, Edgel *, it->next);
+      Edgel       *it       = &edgels[i];
+      Edgel       *previous = &edgels[it->previous];
+      Edgel       *next     = &edgels[it->next];
       GimpVector2  n_prev   = gimp_vector2_new (previous->x_normal, previous->y_normal);
       GimpVector2  n_next   = gimp_vector2_new (next->x_normal, next->y_normal);
       GimpVector2  diff     = gimp_vector2_mul_val (gimp_vector2_sub_val (n_next, n_prev),
@@ -2877,72 +3112,100 @@ gimp_edgelset_compute_curvature (GArray    *set,
 
       it->curvature = (crossp > 0.0f) ? c : -c;
 
-      if (gimp_async_is_canceled (async))
-        {
-          gimp_async_abort (async);
-
-          return;
-        }
+      if (i % EDGELS_PER_CANCEL_CHECK == 0 &&
+          gimp_async_is_canceled (pass->async))
+        return;
     }
 }
 
 static void
-gimp_edgelset_build_graph (GArray     *set,
-                           GeglBuffer *buffer,
-                           GHashTable *edgel2index,
-                           GimpAsync  *async)
+gimp_edgelset_compute_curvature (EdgelSet  *set,
+                                 GimpAsync *async)
 {
-  Edgel edgel;
-  gint  i;
+  EdgelSetPass pass = { 0, };
 
-  for (i = 0; i < set->len; i++)
-    {
-      Edgel *neighbor;
-      Edgel *it = g_array_index (set, Edgel *, i);
-      guint  neighbor_pos;
+  pass.set   = set;
+  pass.async = async;
 
-      if (gimp_async_is_canceled (async))
-        {
-          gimp_async_abort (async);
+  gegl_parallel_distribute_range (set->n_edgels, PIXELS_PER_THREAD,
+                                  (GeglParallelDistributeRangeFunc)
+                                  gimp_edgelset_compute_curvature_range,
+                                  &pass);
 
-          return;
-        }
+  if (gimp_async_is_canceled (async))
+    gimp_async_abort (async);
+}
 
-      gimp_edgelset_next8 (buffer, it, &edgel);
+static void
+gimp_edgelset_build_graph_range (gsize         offset,
+                                 gsize         size,
+                                 EdgelSetPass *pass)
+{
+  EdgelSet *set = pass->set;
+  guint     i;
+
+  for (i = offset; i < offset + size; i++)
+    {
+      Edgel edgel;
+      guint neighbor_pos;
+
+      if (i % EDGELS_PER_CANCEL_CHECK == 0 &&
+          gimp_async_is_canceled (pass->async))
+        return;
 
-      gimp_assert (g_hash_table_contains (edgel2index, &edgel));
-      neighbor_pos = GPOINTER_TO_UINT (g_hash_table_lookup (edgel2index, &edgel));
-      it->next = neighbor_pos;
-      neighbor = g_array_index (set, Edgel *, neighbor_pos);
-      neighbor->previous = i;
+      gimp_edgelset_next8 (pass->mask, &set->edgels[i], &edgel);
+
+      neighbor_pos = gimp_edgelset_find (set, pass->mask->width, &edgel);
+      set->edgels[i].next = neighbor_pos;
+      set->edgels[neighbor_pos].previous = i;
     }
 }
 
 static void
-gimp_edgelset_next8 (const GeglBuffer *buffer,
-                     Edgel            *it,
-                     Edgel            *n)
+gimp_edgelset_build_graph (EdgelSet          *set,
+                           const LineArtMask *mask,
+                           GimpAsync         *async)
+{
+  EdgelSetPass pass = { 0, };
+
+  pass.mask  = mask;
+  pass.set   = set;
+  pass.async = async;
+
+  /* Each edgel is the next one of exactly one other edgel, hence all
+   * the links can be set concurrently.
+   */
+  gegl_parallel_distribute_range (set->n_edgels, PIXELS_PER_THREAD,
+                                  (GeglParallelDistributeRangeFunc)
+                                  gimp_edgelset_build_graph_range,
+                                  &pass);
+
+  if (gimp_async_is_canceled (async))
+    gimp_async_abort (async);
+}
+
+static void
+gimp_edgelset_next8 (const LineArtMask *mask,
+                     Edgel             *it,
+                     Edgel             *n)
 {
-  guint8 pixels[9];
+  gint x = it->x;
+  gint y = it->y;
 
-  n->x         = it->x;
-  n->y         = it->y;
+  n->x         = x;
+  n->y         = y;
   n->direction = it->direction;
 
-  gegl_buffer_get ((GeglBuffer *) buffer,
-                   GEGL_RECTANGLE (n->x - 1, n->y - 1, 3, 3),
-                   1.0, NULL, pixels, GEGL_AUTO_ROWSTRIDE,
-                   GEGL_ABYSS_NONE);
   switch (n->direction)
     {
     case XPlusDirection:
-      if (pixels[8])
+      if (gimp_lineart_mask_get (mask, x + 1, y + 1))
         {
           ++(n->y);
           ++(n->x);
           n->direction = YMinusDirection;
         }
-      else if (pixels[7])
+      else if (gimp_lineart_mask_get (mask, x, y + 1))
         {
           ++(n->y);
         }
@@ -2952,13 +3215,13 @@ gimp_edgelset_next8 (const GeglBuffer *buffer,
         }
       break;
     case YMinusDirection:
-      if (pixels[2])
+      if (gimp_lineart_mask_get (mask, x + 1, y - 1))
         {
           ++(n->x);
           --(n->y);
           n->direction = XMinusDirection;
         }
-      else if (pixels[5])
+      else if (gimp_lineart_mask_get (mask, x + 1, y))
         {
           ++(n->x);
         }
@@ -2968,13 +3231,13 @@ gimp_edgelset_next8 (const GeglBuffer *buffer,
         }
       break;
     case XMinusDirection:
-      if (pixels[0])
+      if (gimp_lineart_mask_get (mask, x - 1, y - 1))
         {
           --(n->x);
           --(n->y);
           n->direction = YPlusDirection;
         }
-      else if (pixels[1])
+      else if (gimp_lineart_mask_get (mask, x, y - 1))
         {
           --(n->y);
         }
@@ -2984,13 +3247,13 @@ gimp_edgelset_next8 (const GeglBuffer *buffer,
         }
       break;
     case YPlusDirection:
-      if (pixels[6])
+      if (gimp_lineart_mask_get (mask, x - 1, y + 1))
         {
           --(n->x);
           ++(n->y);
           n->direction = XPlusDirection;
         }
-      else if (pixels[3])
+      else if (gimp_lineart_mask_get (mask, x - 1, y))
         {
           --(n->x);
         }
@@ -47,6 +47,8 @@ extern "C"
 #define PIXELS_PER_THREAD \
   (/* each thread costs as much as */ 64.0 * 64.0 /* pixels */)
 
+#define PARALLEL_FILL_MIN_AREA (2048 * 2048)
+
 
 static gfloat *mask_row_buf      = NULL;
 static gsize   mask_row_buf_size = 0;
@@ -58,6 +60,21 @@ typedef struct
   gint   level;
 } BorderPixel;
 
+typedef struct
+{
+  gint   start;
+  gint   end;
+} ContiguousRun;
+
+typedef struct
+{
+  GeglRectangle  rect;
+  GArray        *runs;
+  gint          *row_offsets;
+  gint          *parents;
+  gint           base;
+} ContiguousBand;
+
 
 /*  local function prototypes  */
 
@@ -104,7 +121,22 @@ static gboolean find_contiguous_segment   (const gfloat        *col,
                                            gint                *start,
                                            gint                *end,
                                            gfloat              *row);
-static void     find_contiguous_region    (GeglBuffer          *src_buffer,
+static gboolean find_contiguous_region    (GeglBuffer          *src_buffer,
+                                           GeglBuffer          *mask_buffer,
+                                           const Babl          *format,
+                                           gint                 n_components,
+                                           gboolean             has_alpha,
+                                           gboolean             select_transparent,
+                                           GimpSelectCriterion  select_criterion,
+                                           gboolean             antialias,
+                                           gfloat               threshold,
+                                           gboolean             diagonal_neighbors,
+                                           gint                 x,
+                                           gint                 y,
+                                           const gfloat        *col,
+                                           gint64               max_pixels);
+static void     find_contiguous_region_parallel
+                                          (GeglBuffer          *src_buffer,
                                            GeglBuffer          *mask_buffer,
                                            const Babl          *format,
                                            gint                 n_components,
@@ -180,13 +212,39 @@ gimp_pickable_contiguous_region_by_seed (GimpPickable        *pickable,
   if (x >= extent.x && x < (extent.x + extent.width) &&
       y >= extent.y && y < (extent.y + extent.height))
     {
+      gint64 max_pixels = 0;
+      gint   n_threads;
+
       GIMP_TIMER_START();
 
-      find_contiguous_region (src_buffer, mask_buffer,
-                              format, n_components, has_alpha,
-                              select_transparent, select_criterion,
-                              antialias, threshold, diagonal_neighbors,
-                              x, y, start_col);
+      g_object_get (gegl_config (),
+                    "threads", &n_threads,
+                    NULL);
+
+      /* on big images, start with the scanline fill, which only touches
+       * the region itself, but switch to the parallel engine, which scans
+       * the whole image, once the region turns out to be large.
+       */
+      if (n_threads > 1 &&
+          (gint64) extent.width * extent.height >= PARALLEL_FILL_MIN_AREA)
+        {
+          max_pixels = (gint64) extent.width * extent.height / n_threads;
+        }
+
+      if (! find_contiguous_region (src_buffer, mask_buffer,
+                                    format, n_components, has_alpha,
+                                    select_transparent, select_criterion,
+                                    antialias, threshold, diagonal_neighbors,
+                                    x, y, start_col, max_pixels))
+        {
+          find_contiguous_region_parallel (src_buffer, mask_buffer,
+                                           format, n_components, has_alpha,
+                                           select_transparent,
+                                           select_criterion,
+                                           antialias, threshold,
+                                           diagonal_neighbors,
+                                           x, y, start_col);
+        }
 
       GIMP_TIMER_END("foo");
     }
@@ -1105,7 +1163,10 @@ find_contiguous_segment (const gfloat        *col,
   return TRUE;
 }
 
-static void
+/* Returns FALSE, leaving the region partially filled, if it grows beyond
+ * max_pixels pixels.  A max_pixels of 0 means no limit.
+ */
+static gboolean
 find_contiguous_region (GeglBuffer          *src_buffer,
                         GeglBuffer          *mask_buffer,
                         const Babl          *format,
@@ -1118,7 +1179,8 @@ find_contiguous_region (GeglBuffer          *src_buffer,
                         gboolean             diagonal_neighbors,
                         gint                 x,
                         gint                 y,
-                        const gfloat        *col)
+                        const gfloat        *col,
+                        gint64               max_pixels)
 {
   const Babl          *mask_format = babl_format ("Y float");
   GeglSampler         *src_sampler;
@@ -1127,7 +1189,8 @@ find_contiguous_region (GeglBuffer          *src_buffer,
   gint                 start, end;
   gint                 new_start, new_end;
   GQueue              *segment_queue;
-  gfloat              *row = NULL;
+  gfloat              *row      = NULL;
+  gint64               n_pixels = 0;
 
   src_extent = gegl_buffer_get_extent (src_buffer);
 
@@ -1179,6 +1242,14 @@ find_contiguous_region (GeglBuffer          *src_buffer,
                                          row))
             continue;
 
+          n_pixels += new_end - new_start - 1;
+
+          if (max_pixels && n_pixels > max_pixels)
+            {
+              g_queue_clear (segment_queue);
+              break;
+            }
+
           /* We can skip directly to `new_end + 1` on the next iteration, since
            * we've just selected all pixels in the range `[x, new_end)`, and
            * the pixel at `new_end` is above threshold.  (Note that we assume
@@ -1221,6 +1292,347 @@ find_contiguous_region (GeglBuffer          *src_buffer,
 #ifdef FETCH_ROW
   g_free (row);
 #endif
+
+  return ! max_pixels || n_pixels <= max_pixels;
+}
+
+/* The parallel engine splits the extent into bands of rows.  Each band
+ * is scanned independently, recording the runs of selectable pixels in
+ * each row, and joining the runs of consecutive rows with a union-find
+ * forest.  The bands are then joined along their borders, and the runs
+ * connected to the seed are written to the mask.
+ *
+ * Union always makes the lower run index the root, so that a run's
+ * parent never follows it, and the forest can be flattened in a single
+ * forward pass.
+ */
+
+static gint
+contiguous_run_find (gint *parents,
+                     gint  i)
+{
+  while (parents[i] != i)
+    {
+      parents[i] = parents[parents[i]];
+      i          = parents[i];
+    }
+
+  return i;
+}
+
+static void
+contiguous_run_union (gint *parents,
+                      gint  i,
+                      gint  j)
+{
+  i = contiguous_run_find (parents, i);
+  j = contiguous_run_find (parents, j);
+
+  if (i < j)
+    parents[j] = i;
+  else if (j < i)
+    parents[i] = j;
+}
+
+/* Join the overlapping (or, with diagonal neighbors, touching) runs of
+ * two consecutive rows.  The runs of each row are sorted, and their
+ * indices in parents are offset by the corresponding base.
+ */
+static void
+contiguous_runs_join_rows (gint                *parents,
+                           const ContiguousRun *runs1,
+                           gint                 n_runs1,
+                           gint                 base1,
+                           const ContiguousRun *runs2,
+                           gint                 n_runs2,
+                           gint                 base2,
+                           gboolean             diagonal_neighbors)
+{
+  gint diagonal = diagonal_neighbors ? 1 : 0;
+  gint i        = 0;
+  gint j;
+
+  for (j = 0; j < n_runs2; j++)
+    {
+      gint k;
+
+      while (i < n_runs1 && runs1[i].end + diagonal <= runs2[j].start)
+        i++;
+
+      for (k = i; k < n_runs1 && runs1[k].start < runs2[j].end + diagonal; k++)
+        contiguous_run_union (parents, base1 + k, base2 + j);
+    }
+}
+
+static void
+find_contiguous_region_parallel (GeglBuffer          *src_buffer,
+                                 GeglBuffer          *mask_buffer,
+                                 const Babl          *format,
+                                 gint                 n_components,
+                                 gboolean             has_alpha,
+                                 gboolean             select_transparent,
+                                 GimpSelectCriterion  select_criterion,
+                                 gboolean             antialias,
+                                 gfloat               threshold,
+                                 gboolean             diagonal_neighbors,
+                                 gint                 x,
+                                 gint                 y,
+                                 const gfloat        *col)
+{
+  const Babl          *mask_format = babl_format ("Y float");
+  const GeglRectangle *extent      = gegl_buffer_get_extent (src_buffer);
+  ContiguousBand      *bands;
+  gint                 band_height;
+  gint                 n_bands;
+  gint                *parents;
+  gint                 n_runs;
+  gint                 seed_root = -1;
+  gint                 b;
+  gint                 i;
+
+  /* make the bands as tall as the mask tiles, so that threads rarely
+   * write to the same tile.
+   */
+  g_object_get (mask_buffer,
+                "tile-height", &band_height,
+                NULL);
+
+  n_bands = (extent->height + band_height - 1) / band_height;
+  bands   = g_new0 (ContiguousBand, n_bands);
+
+  /* scan the bands, and join the runs within each band */
+  gegl_parallel_distribute_range (
+    n_bands, 1,
+    [=] (gint offset, gint size)
+    {
+      gfloat *src = g_new (gfloat,
+                           (gsize) extent->width * band_height * n_components);
+      gint    b;
+
+      for (b = offset; b < offset + size; b++)
+        {
+          ContiguousBand *band = &bands[b];
+          const gfloat   *s    = src;
+          gint            row;
+          gint            i;
+
+          band->rect.x      = extent->x;
+          band->rect.y      = extent->y + b * band_height;
+          band->rect.width  = extent->width;
+          band->rect.height = MIN (band_height,
+                                   extent->y + extent->height - band->rect.y);
+
+          band->runs        = g_array_new (FALSE, FALSE, sizeof (ContiguousRun));
+          band->row_offsets = g_new (gint, band->rect.height + 1);
+
+          gegl_buffer_get (src_buffer, &band->rect, 1.0, format, src,
+                           GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+          for (row = 0; row < band->rect.height; row++)
+            {
+              ContiguousRun run = { -1, -1 };
+
+              band->row_offsets[row] = band->runs->len;
+
+              for (i = 0; i < band->rect.width; i++, s += n_components)
+                {
+                  gfloat diff = pixel_difference (col, s, antialias, threshold,
+                                                  n_components, has_alpha,
+                                                  select_transparent,
+                                                  select_criterion);
+
+                  if (diff != 0.0)
+                    {
+                      if (run.start < 0)
+                        run.start = band->rect.x + i;
+                    }
+                  else if (run.start >= 0)
+                    {
+                      run.end = band->rect.x + i;
+                      g_array_append_val (band->runs, run);
+                      run.start = -1;
+                    }
+                }
+
+              if (run.start >= 0)
+                {
+                  run.end = band->rect.x + band->rect.width;
+                  g_array_append_val (band->runs, run);
+                }
+            }
+
+          band->row_offsets[row] = band->runs->len;
+
+          band->parents = g_new (gint, band->runs->len);
+
+          for (i = 0; i < (gint) band->runs->len; i++)
+            band->parents[i] = i;
+
+          for (row = 1; row < band->rect.height; row++)
+            {
+              const ContiguousRun *runs = (const ContiguousRun *)
+                                          band->runs->data;
+              gint                 o1   = band->row_offsets[row - 1];
+              gint                 o2   = band->row_offsets[row];
+              gint                 o3   = band->row_offsets[row + 1];
+
+              contiguous_runs_join_rows (band->parents,
+                                         runs + o1, o2 - o1, o1,
+                                         runs + o2, o3 - o2, o2,
+                                         diagonal_neighbors);
+            }
+        }
+
+      g_free (src);
+    });
+
+  /* gather the per-band forests into a single one */
+  n_runs = 0;
+
+  for (b = 0; b < n_bands; b++)
+    {
+      bands[b].base  = n_runs;
+      n_runs        += bands[b].runs->len;
+    }
+
+  parents = g_new (gint, MAX (n_runs, 1));
+
+  for (b = 0; b < n_bands; b++)
+    {
+      ContiguousBand *band = &bands[b];
+
+      for (i = 0; i < (gint) band->runs->len; i++)
+        parents[band->base + i] = band->base + band->parents[i];
+
+      g_clear_pointer (&band->parents, g_free);
+    }
+
+  /* join the bands along their borders */
+  for (b = 1; b < n_bands; b++)
+    {
+      const ContiguousBand *band1 = &bands[b - 1];
+      const ContiguousBand *band2 = &bands[b];
+      gint                  o1    = band1->row_offsets[band1->rect.height - 1];
+      gint                  o2    = band1->row_offsets[band1->rect.height];
+      gint                  o3    = band2->row_offsets[1];
+
+      contiguous_runs_join_rows (parents,
+                                 (const ContiguousRun *) band1->runs->data + o1,
+                                 o2 - o1, band1->base + o1,
+                                 (const ContiguousRun *) band2->runs->data,
+                                 o3, band2->base,
+                                 diagonal_neighbors);
+    }
+
+  for (i = 0; i < n_runs; i++)
+    parents[i] = parents[parents[i]];
+
+  /* find the run containing the seed */
+  {
+    const ContiguousBand *band = &bands[(y - extent->y) / band_height];
+    const ContiguousRun  *runs = (const ContiguousRun *) band->runs->data;
+    gint                  row  = y - band->rect.y;
+
+    for (i = band->row_offsets[row]; i < band->row_offsets[row + 1]; i++)
+      {
+        if (x >= runs[i].start && x < runs[i].end)
+          {
+            seed_root = parents[band->base + i];
+
+            break;
+          }
+      }
+  }
+
+  /* write the runs connected to the seed to the mask.  any pixels
+   * already selected by an abandoned serial fill belong to the same
+   * region, and are simply overwritten with the same values.
+   */
+  if (seed_root >= 0)
+    {
+      gegl_parallel_distribute_range (
+        n_bands, 1,
+        [=] (gint offset, gint size)
+        {
+          gint b;
+
+          for (b = offset; b < offset + size; b++)
+            {
+              const ContiguousBand *band  = &bands[b];
+              const ContiguousRun  *runs  = (const ContiguousRun *)
+                                            band->runs->data;
+              GeglRectangle         rect  = band->rect;
+              gint                  x1    = G_MAXINT;
+              gint                  x2    = G_MININT;
+              gfloat               *src;
+              gfloat               *mask;
+              gint                  row;
+              gint                  i;
+
+              for (i = 0; i < (gint) band->runs->len; i++)
+                {
+                  if (parents[band->base + i] == seed_root)
+                    {
+                      x1 = MIN (x1, runs[i].start);
+                      x2 = MAX (x2, runs[i].end);
+                    }
+                }
+
+              if (x1 >= x2)
+                continue;
+
+              rect.x     = x1;
+              rect.width = x2 - x1;
+
+              src  = g_new  (gfloat, (gsize) rect.width * rect.height *
+                                     n_components);
+              mask = g_new0 (gfloat, (gsize) rect.width * rect.height);
+
+              gegl_buffer_get (src_buffer, &rect, 1.0, format, src,
+                               GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+              for (row = 0; row < rect.height; row++)
+                {
+                  for (i = band->row_offsets[row];
+                       i < band->row_offsets[row + 1];
+                       i++)
+                    {
+                      gint j;
+
+                      if (parents[band->base + i] != seed_root)
+                        continue;
+
+                      for (j = runs[i].start - x1; j < runs[i].end - x1; j++)
+                        {
+                          gint o = row * rect.width + j;
+
+                          mask[o] = pixel_difference (col,
+                                                      src + o * n_components,
+                                                      antialias, threshold,
+                                                      n_components, has_alpha,
+                                                      select_transparent,
+                                                      select_criterion);
+                        }
+                    }
+                }
+
+              gegl_buffer_set (mask_buffer, &rect, 0, mask_format, mask,
+                               GEGL_AUTO_ROWSTRIDE);
+
+              g_free (src);
+              g_free (mask);
+            }
+        });
+    }
+
+  for (b = 0; b < n_bands; b++)
+    {
+      g_array_free (bands[b].runs, TRUE);
+      g_free (bands[b].row_offsets);
+    }
+
+  g_free (bands);
+  g_free (parents);
 }
 
 static void
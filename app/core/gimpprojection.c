@@ -29,12 +29,17 @@
 
 #include "core-types.h"
 
+#include "config/gimpgeglconfig.h"
+
 #include "gegl/gimp-babl.h"
 #include "gegl/gimp-gegl-loops.h"
+#include "gegl/gimp-gegl-nodes.h"
 #include "gegl/gimp-gegl-utils.h"
 
 #include "gimp.h"
 #include "gimp-memsize.h"
+#include "gimp-parallel.h"
+#include "gimpasync.h"
 #include "gimpchunkiterator.h"
 #include "gimpimage.h"
 #include "gimpmarshal.h"
@@ -51,6 +56,22 @@
 #define GIMP_PROJECTION_UPDATE_CHUNK_WIDTH  32
 #define GIMP_PROJECTION_UPDATE_CHUNK_HEIGHT 32
 
+/*  when rendering in a background thread, the visible area is first
+ *  rendered at this pyramid level, and upscaled, before being refined
+ */
+#define GIMP_PROJECTION_COARSE_LEVEL        2
+#define GIMP_PROJECTION_COARSE_MIN_AREA     (256 * 256)
+
+/*  smaller updates, like brush strokes, are rendered in the main thread,
+ *  since they aren't worth snapshotting the graph
+ */
+#define GIMP_PROJECTION_THREADED_MIN_AREA   (256 * 256)
+
+/*  how often the render thread hands the rendered chunks over to the
+ *  main thread
+ */
+#define GIMP_PROJECTION_RENDER_INTERVAL     (1.0 / 60.0) /* seconds */
+
 
 enum
 {
@@ -65,6 +86,41 @@ enum
 };
 
 
+typedef struct _GimpProjectionRender GimpProjectionRender;
+
+/*  a threaded rendering pass.  the render thread renders a snapshot of
+ *  the projectable's graph into a buffer of its own, so it never touches
+ *  anything the main thread modifies, and the main thread copies the
+ *  rendered chunks to the projection's buffer, unless they were
+ *  invalidated in the meantime, and emits the updates.
+ */
+struct _GimpProjectionRender
+{
+  gint               ref_count;
+
+  GimpProjection    *proj;
+  GeglNode          *graph;
+  GeglBuffer        *buffer;
+  gint               priority;
+
+  /*  only accessed by the main thread  */
+  cairo_region_t    *stale_region;
+
+  /*  protected by the mutex  */
+  GMutex             mutex;
+  gboolean           canceled;
+  gboolean           finished;
+  guint              idle_id;
+  GimpChunkIterator *iter;
+  gboolean           iter_active;
+  GimpChunkIterator *coarse_iter;
+  gboolean           coarse_active;
+  cairo_region_t    *region;             /* not rendered at full res yet  */
+  cairo_region_t    *pending_region;     /* rendering, or not copied yet  */
+  cairo_region_t    *rendered_region;    /* rendered, not copied yet      */
+  cairo_region_t    *coarse_done_region; /* rendered at the coarse level  */
+};
+
 struct _GimpProjectionPrivate
 {
   GimpProjectable           *projectable;
@@ -73,6 +129,7 @@ struct _GimpProjectionPrivate
   GimpTileHandlerValidate   *validate_handler;
 
   gint                       priority;
+  gboolean                   render_levels;
 
   cairo_region_t            *update_region;
   GeglRectangle              priority_rect;
@@ -80,6 +137,11 @@ struct _GimpProjectionPrivate
   guint                      idle_id;
 
   gboolean                   invalidate_preview;
+
+  GimpChunkIterator         *validate_iter;
+  guint                      validate_idle_id;
+
+  GimpProjectionRender      *render;
 };
 
 
@@ -130,6 +192,8 @@ static void        gimp_projection_chunk_render_stop     (GimpProjection  *proj,
                                                           gboolean         merge);
 static gboolean    gimp_projection_chunk_render_callback (GimpProjection  *proj);
 static gboolean    gimp_projection_chunk_render_iteration(GimpProjection  *proj);
+static gboolean    gimp_projection_validate_callback     (GimpProjection  *proj);
+static void        gimp_projection_validate_stop         (GimpProjection  *proj);
 static void        gimp_projection_paint_area            (GimpProjection  *proj,
                                                           gboolean         now,
                                                           gint             x,
@@ -137,6 +201,34 @@ static void        gimp_projection_paint_area            (GimpProjection  *proj,
                                                           gint             w,
                                                           gint             h);
 
+static void        gimp_projection_merge_update_region   (GimpProjection  *proj,
+                                                          cairo_region_t  *region);
+static gint64      gimp_projection_get_region_area       (const cairo_region_t *region);
+static void        gimp_projection_paint_coarse_area     (GimpProjection  *proj,
+                                                          const GeglRectangle *rect,
+                                                          gint             level);
+
+static gboolean    gimp_projection_get_threaded          (GimpProjection  *proj);
+static void        gimp_projection_render_start          (GimpProjection  *proj,
+                                                          cairo_region_t  *region);
+static cairo_region_t * gimp_projection_render_cancel    (GimpProjection  *proj);
+static void        gimp_projection_render_unref          (GimpProjectionRender *render);
+static void        gimp_projection_render_thread         (GimpAsync       *async,
+                                                          GimpProjectionRender *render);
+static gboolean    gimp_projection_render_next           (GimpProjectionRender *render,
+                                                          GeglRectangle   *rect,
+                                                          gboolean        *coarse);
+static void        gimp_projection_render_schedule_idle  (GimpProjectionRender *render);
+static gboolean    gimp_projection_render_idle           (GimpProjectionRender *render);
+static void        gimp_projection_render_commit         (GimpProjectionRender *render,
+                                                          cairo_region_t  *region);
+static void        gimp_projection_render_update_coarse  (GimpProjectionRender *render,
+                                                          const GeglRectangle *view);
+static void        gimp_projection_render_coarse_area    (GeglNode        *graph,
+                                                          GeglBuffer      *buffer,
+                                                          const GeglRectangle *rect,
+                                                          gint             level);
+
 static void        gimp_projection_projectable_invalidate(GimpProjectable *projectable,
                                                           gint             x,
                                                           gint             y,
@@ -304,6 +396,25 @@ gimp_projection_estimate_memsize (GimpImageBaseType type,
   return bytes * (gint64) width * (gint64) height * 1.33;
 }
 
+/**
+ * gimp_projection_get_tile_memsize:
+ * @proj: a #GimpProjection
+ *
+ * Unlike gimp_object_get_memsize(), which estimates the size of the
+ * projection's buffer from its extent, this only counts the tiles that
+ * were actually rendered.  It has to look up every tile of the buffer's
+ * pyramid, so it should not be called too often.
+ *
+ * Returns: the size of the projection's rendered tiles.
+ **/
+gint64
+gimp_projection_get_tile_memsize (GimpProjection *proj)
+{
+  g_return_val_if_fail (GIMP_IS_PROJECTION (proj), 0);
+
+  return gimp_gegl_pyramid_get_tile_memsize (proj->priv->buffer);
+}
+
 gboolean
 gimp_projection_has_alpha (GimpProjection *proj)
 {
@@ -493,6 +604,44 @@ gimp_projection_set_priority_rect (GimpProjection *proj,
   gimp_projection_update_priority_rect (proj);
 }
 
+/**
+ * gimp_projection_set_render_levels:
+ * @proj:
+ * @render_levels:
+ *
+ * Sets whether reading the invalidated area of the projection's buffer
+ * at a lower pyramid level renders the projectable's graph at that
+ * level directly.  Otherwise, the area is validated in full resolution
+ * first, regardless of the level it's read at.
+ *
+ * This lets the projections of layer groups be used at the display's
+ * zoom level, or as the source of a coarse rendering, without rendering
+ * their whole subtree in full resolution.
+ */
+void
+gimp_projection_set_render_levels (GimpProjection *proj,
+                                   gboolean        render_levels)
+{
+  g_return_if_fail (GIMP_IS_PROJECTION (proj));
+
+  proj->priv->render_levels = render_levels;
+
+  if (proj->priv->validate_handler)
+    {
+      g_object_set (proj->priv->validate_handler,
+                    "render-levels", render_levels,
+                    NULL);
+    }
+}
+
+gboolean
+gimp_projection_get_render_levels (GimpProjection *proj)
+{
+  g_return_val_if_fail (GIMP_IS_PROJECTION (proj), FALSE);
+
+  return proj->priv->render_levels;
+}
+
 void
 gimp_projection_stop_rendering (GimpProjection *proj)
 {
@@ -508,7 +657,8 @@ gimp_projection_stop_rendering (GimpProjection *proj)
  * This requests to render the projection. This function is thread-safe
  * and can be called in any thread.
  *
- * The actual projection painting will happen in the main thread.
+ * The actual projection painting will happen in the main thread, or,
+ * when "threaded-projection" is enabled, in a background thread.
  */
 void
 gimp_projection_flush (GimpProjection *proj)
@@ -567,11 +717,124 @@ gimp_projection_flush_now (GimpProjection *proj,
     }
 }
 
+/**
+ * gimp_projection_flush_preview:
+ * @proj:
+ * @level: the pyramid level to render the preview at
+ *
+ * This renders the part of the pending update area that intersects the
+ * priority rect immediately, at 1 / 2^@level of the full resolution,
+ * and upscaled, and then requests the full-resolution rendering of the
+ * whole area, like gimp_projection_flush(). At level 0, the visible
+ * part is rendered at full resolution right away instead.
+ *
+ * This is meant for tools that need quick feedback at the display's
+ * zoom level. You can only call this from the main thread.
+ */
+void
+gimp_projection_flush_preview (GimpProjection *proj,
+                               gint            level)
+{
+  g_return_if_fail (GIMP_IS_PROJECTION (proj));
+  g_return_if_fail (level >= 0);
+
+  if (proj->priv->update_region)
+    {
+      cairo_region_t *region;
+      GeglRectangle   view;
+      gint            off_x, off_y;
+      gint            n_rects;
+      gint            i;
+
+      /* Make sure we have a buffer */
+      gimp_projection_allocate_buffer (proj);
+
+      gimp_projectable_get_offset (proj->priv->projectable, &off_x, &off_y);
+
+      /*  the update region is in tile-pyramid coordinates, while the
+       *  priority rect is in image coordinates
+       */
+      view    = proj->priv->priority_rect;
+      view.x -= off_x;
+      view.y -= off_y;
+
+      region = cairo_region_copy (proj->priv->update_region);
+
+      cairo_region_intersect_rectangle (region,
+                                        (const cairo_rectangle_int_t *) &view);
+
+      n_rects = cairo_region_num_rectangles (region);
+
+      for (i = 0; i < n_rects; i++)
+        {
+          cairo_rectangle_int_t rect;
+
+          cairo_region_get_rectangle (region, i, &rect);
+
+          if (level > 0)
+            {
+              /*  the area stays in the update region, and gets refined
+               *  by the regular rendering
+               */
+              gimp_projection_paint_coarse_area (proj,
+                                                 (GeglRectangle *) &rect,
+                                                 level);
+
+              g_signal_emit (proj, projection_signals[UPDATE], 0,
+                             TRUE,
+                             rect.x + off_x,
+                             rect.y + off_y,
+                             rect.width,
+                             rect.height);
+            }
+          else
+            {
+              gimp_projection_paint_area (proj, TRUE,
+                                          rect.x, rect.y,
+                                          rect.width, rect.height);
+            }
+        }
+
+      if (level == 0)
+        {
+          cairo_region_subtract (proj->priv->update_region, region);
+
+          if (cairo_region_is_empty (proj->priv->update_region))
+            g_clear_pointer (&proj->priv->update_region, cairo_region_destroy);
+        }
+
+      cairo_region_destroy (region);
+    }
+
+  gimp_projection_flush (proj);
+}
+
 void
 gimp_projection_finish_draw (GimpProjection *proj)
 {
+  cairo_region_t *region;
+
   g_return_if_fail (GIMP_IS_PROJECTION (proj));
 
+  /*  take over what's left of the render thread's pass  */
+  region = gimp_projection_render_cancel (proj);
+
+  if (region)
+    {
+      if (proj->priv->iter)
+        {
+          cairo_region_t *iter_region;
+
+          iter_region = gimp_chunk_iterator_stop (proj->priv->iter, FALSE);
+
+          cairo_region_union (region, iter_region);
+
+          cairo_region_destroy (iter_region);
+        }
+
+      proj->priv->iter = gimp_chunk_iterator_new (region);
+    }
+
   if (proj->priv->iter)
     {
       gimp_chunk_iterator_set_priority_rect (proj->priv->iter, NULL);
@@ -586,6 +849,63 @@ gimp_projection_finish_draw (GimpProjection *proj)
     }
 }
 
+/**
+ * gimp_projection_is_rendering:
+ * @proj:
+ *
+ * Returns: %TRUE if part of the projection is still waiting to be
+ *          rendered, or is being rendered, either in the main thread
+ *          or in the render thread.
+ */
+gboolean
+gimp_projection_is_rendering (GimpProjection *proj)
+{
+  g_return_val_if_fail (GIMP_IS_PROJECTION (proj), FALSE);
+
+  return (proj->priv->update_region ||
+          proj->priv->iter          ||
+          proj->priv->render);
+}
+
+
+/**
+ * gimp_projection_validate_idle:
+ * @proj:
+ *
+ * This validates the invalidated area of the projection's buffer in
+ * full resolution, in chunks, in the main thread's idle time.  Unlike
+ * gimp_projection_flush(), it doesn't emit any updates, since these
+ * were already emitted when the area was invalidated, and is meant for
+ * keeping the projection of an otherwise lazily rendered projectable
+ * ready for use.
+ *
+ * You can only call this from the main thread.
+ */
+void
+gimp_projection_validate_idle (GimpProjection *proj)
+{
+  cairo_region_t *region;
+
+  g_return_if_fail (GIMP_IS_PROJECTION (proj));
+
+  gimp_projection_validate_stop (proj);
+
+  if (! proj->priv->buffer ||
+      cairo_region_is_empty (proj->priv->validate_handler->dirty_region))
+    {
+      return;
+    }
+
+  region = cairo_region_copy (proj->priv->validate_handler->dirty_region);
+
+  proj->priv->validate_iter = gimp_chunk_iterator_new (region);
+
+  proj->priv->validate_idle_id =
+    g_idle_add_full (GIMP_PRIORITY_PROJECTION_IDLE + proj->priv->priority,
+                     (GSourceFunc) gimp_projection_validate_callback,
+                     proj, NULL);
+}
+
 
 /*  private functions  */
 
@@ -608,6 +928,10 @@ gimp_projection_allocate_buffer (GimpProjection *proj)
     GIMP_TILE_HANDLER_VALIDATE (
       gimp_tile_handler_projectable_new (proj->priv->projectable));
 
+  g_object_set (proj->priv->validate_handler,
+                "render-levels", proj->priv->render_levels,
+                NULL);
+
   gimp_tile_handler_validate_assign (proj->priv->validate_handler,
                                      proj->priv->buffer);
 
@@ -618,6 +942,7 @@ static void
 gimp_projection_free_buffer (GimpProjection  *proj)
 {
   gimp_projection_chunk_render_stop (proj, FALSE);
+  gimp_projection_validate_stop (proj);
 
   g_clear_pointer (&proj->priv->update_region, cairo_region_destroy);
 
@@ -669,7 +994,7 @@ gimp_projection_add_update_area (GimpProjection *proj,
 static void
 gimp_projection_update_priority_rect (GimpProjection *proj)
 {
-  if (proj->priv->iter)
+  if (proj->priv->iter || proj->priv->render)
     {
       GeglRectangle rect;
       GeglRectangle bounding_box;
@@ -689,7 +1014,25 @@ gimp_projection_update_priority_rect (GimpProjection *proj)
 
       gegl_rectangle_intersect (&rect, &rect, &bounding_box);
 
-      gimp_chunk_iterator_set_priority_rect (proj->priv->iter, &rect);
+      if (proj->priv->iter)
+        gimp_chunk_iterator_set_priority_rect (proj->priv->iter, &rect);
+
+      if (proj->priv->render)
+        {
+          GimpProjectionRender *render = proj->priv->render;
+
+          g_mutex_lock (&render->mutex);
+
+          if (render->iter)
+            gimp_chunk_iterator_set_priority_rect (render->iter, &rect);
+
+          /*  drop the coarse rendering of the previous view, if it's
+           *  still pending, and start over with the current one
+           */
+          gimp_projection_render_update_coarse (render, &rect);
+
+          g_mutex_unlock (&render->mutex);
+        }
     }
 }
 
@@ -708,11 +1051,17 @@ gimp_projection_chunk_render_start (GWeakRef *proj_ref)
   if (proj->priv->update_region)
     {
       cairo_region_t *region             = proj->priv->update_region;
+      cairo_region_t *render_region;
       gboolean        invalidate_preview = FALSE;
 
       /* Make sure we have a buffer */
       gimp_projection_allocate_buffer (proj);
 
+      /* The render thread's pass is superseded by a new one, which picks
+       * up the areas it didn't hand over yet
+       */
+      render_region = gimp_projection_render_cancel (proj);
+
       if (proj->priv->iter)
         {
           region = gimp_chunk_iterator_stop (proj->priv->iter, FALSE);
@@ -732,14 +1081,33 @@ gimp_projection_chunk_render_start (GWeakRef *proj_ref)
 
       proj->priv->update_region = NULL;
 
-      if (region && ! cairo_region_is_empty (region))
+      if (render_region)
         {
-          proj->priv->iter = gimp_chunk_iterator_new (region);
+          cairo_region_union (region, render_region);
+
+          cairo_region_destroy (render_region);
+        }
 
-          gimp_projection_update_priority_rect (proj);
+      if (region && ! cairo_region_is_empty (region))
+        {
+          if (proj->priv->idle_id)
+            {
+              g_source_remove (proj->priv->idle_id);
+              proj->priv->idle_id = 0;
+            }
 
-          if (! proj->priv->idle_id)
+          if (gimp_projection_get_threaded (proj) &&
+              gimp_projection_get_region_area (region) >=
+              GIMP_PROJECTION_THREADED_MIN_AREA)
+            {
+              gimp_projection_render_start (proj, region);
+            }
+          else
             {
+              proj->priv->iter = gimp_chunk_iterator_new (region);
+
+              gimp_projection_update_priority_rect (proj);
+
               proj->priv->idle_id = g_idle_add_full (GIMP_PRIORITY_PROJECTION_IDLE + proj->priv->priority,
                                                      (GSourceFunc) gimp_projection_chunk_render_callback,
                                                      proj, NULL);
@@ -767,7 +1135,8 @@ gimp_projection_chunk_render_start (GWeakRef *proj_ref)
             }
         }
     }
-  else if (! proj->priv->iter && proj->priv->invalidate_preview)
+  else if (! proj->priv->iter && ! proj->priv->render &&
+           proj->priv->invalidate_preview)
     {
       /* invalidate the preview here since it is constructed from
        * the projection
@@ -786,6 +1155,18 @@ static void
 gimp_projection_chunk_render_stop (GimpProjection *proj,
                                    gboolean        merge)
 {
+  cairo_region_t *region;
+
+  region = gimp_projection_render_cancel (proj);
+
+  if (region)
+    {
+      if (merge)
+        gimp_projection_merge_update_region (proj, region);
+      else
+        cairo_region_destroy (region);
+    }
+
   if (proj->priv->idle_id)
     {
       g_source_remove (proj->priv->idle_id);
@@ -796,20 +1177,9 @@ gimp_projection_chunk_render_stop (GimpProjection *proj,
     {
       if (merge)
         {
-          cairo_region_t *region;
-
           region = gimp_chunk_iterator_stop (proj->priv->iter, FALSE);
 
-          if (proj->priv->update_region)
-            {
-              cairo_region_union (proj->priv->update_region, region);
-
-              cairo_region_destroy (region);
-            }
-          else
-            {
-              proj->priv->update_region = region;
-            }
+          gimp_projection_merge_update_region (proj, region);
         }
       else
         {
@@ -874,6 +1244,52 @@ gimp_projection_chunk_render_iteration (GimpProjection *proj)
     }
 }
 
+static gboolean
+gimp_projection_validate_callback (GimpProjection *proj)
+{
+  if (gimp_chunk_iterator_next (proj->priv->validate_iter))
+    {
+      GeglRectangle rect;
+
+      gimp_tile_handler_validate_begin_validate (proj->priv->validate_handler);
+
+      while (gimp_chunk_iterator_get_rect (proj->priv->validate_iter, &rect))
+        {
+          gimp_tile_handler_validate_validate (proj->priv->validate_handler,
+                                               proj->priv->buffer,
+                                               &rect,
+                                               TRUE, FALSE);
+        }
+
+      gimp_tile_handler_validate_end_validate (proj->priv->validate_handler);
+
+      return G_SOURCE_CONTINUE;
+    }
+  else
+    {
+      proj->priv->validate_iter    = NULL;
+      proj->priv->validate_idle_id = 0;
+
+      return G_SOURCE_REMOVE;
+    }
+}
+
+static void
+gimp_projection_validate_stop (GimpProjection *proj)
+{
+  if (proj->priv->validate_idle_id)
+    {
+      g_source_remove (proj->priv->validate_idle_id);
+      proj->priv->validate_idle_id = 0;
+    }
+
+  if (proj->priv->validate_iter)
+    {
+      gimp_chunk_iterator_stop (proj->priv->validate_iter, TRUE);
+      proj->priv->validate_iter = NULL;
+    }
+}
+
 static void
 gimp_projection_paint_area (GimpProjection *proj,
                             gboolean        now,
@@ -921,6 +1337,532 @@ gimp_projection_paint_area (GimpProjection *proj,
 }
 
 
+static void
+gimp_projection_merge_update_region (GimpProjection *proj,
+                                     cairo_region_t *region)
+{
+  if (proj->priv->update_region)
+    {
+      cairo_region_union (proj->priv->update_region, region);
+
+      cairo_region_destroy (region);
+    }
+  else
+    {
+      proj->priv->update_region = region;
+    }
+}
+
+static gint64
+gimp_projection_get_region_area (const cairo_region_t *region)
+{
+  gint64 area = 0;
+  gint   n_rects;
+  gint   i;
+
+  n_rects = cairo_region_num_rectangles (region);
+
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_rectangle_int_t rect;
+
+      cairo_region_get_rectangle (region, i, &rect);
+
+      area += (gint64) rect.width * rect.height;
+    }
+
+  return area;
+}
+
+static void
+gimp_projection_paint_coarse_area (GimpProjection      *proj,
+                                   const GeglRectangle *rect,
+                                   gint                 level)
+{
+  GimpTileHandlerValidate *validate = proj->priv->validate_handler;
+
+  gimp_tile_handler_validate_begin_validate (validate);
+
+  /*  make sure writing the upscaled pixels, or reading them back, doesn't
+   *  validate the area in full resolution.  it's still part of the update
+   *  region, so it gets refined later on.
+   */
+  gimp_tile_handler_validate_undo_invalidate (validate, rect);
+
+  gimp_projection_render_coarse_area (validate->graph, proj->priv->buffer,
+                                      rect, level);
+
+  gimp_tile_handler_validate_end_validate (validate);
+}
+
+
+/*  render thread  */
+
+static gboolean
+gimp_projection_get_threaded (GimpProjection *proj)
+{
+  GimpImage *image = gimp_projectable_get_image (proj->priv->projectable);
+
+  return image &&
+         GIMP_GEGL_CONFIG (image->gimp->config)->threaded_projection;
+}
+
+static void
+gimp_projection_render_start (GimpProjection *proj,
+                              cairo_region_t *region)
+{
+  GimpProjectionRender *render;
+  GimpAsync            *async;
+
+  render = g_slice_new0 (GimpProjectionRender);
+
+  /*  one reference for the projection, and one for the render thread  */
+  render->ref_count = 2;
+
+  render->proj      = proj;
+  render->priority  = proj->priv->priority;
+  render->buffer    = gegl_buffer_new (gegl_buffer_get_extent (proj->priv->buffer),
+                                       gegl_buffer_get_format (proj->priv->buffer));
+
+  /*  the snapshot is taken while the projectable is set up for
+   *  rendering, like when validating the projection's buffer
+   */
+  gimp_tile_handler_validate_begin_validate (proj->priv->validate_handler);
+
+  render->graph = gimp_gegl_node_snapshot (proj->priv->validate_handler->graph);
+
+  gimp_tile_handler_validate_end_validate (proj->priv->validate_handler);
+
+  g_mutex_init (&render->mutex);
+
+  render->stale_region       = cairo_region_create ();
+  render->region             = region;
+  render->pending_region     = cairo_region_create ();
+  render->coarse_done_region = cairo_region_create ();
+
+  render->iter = gimp_chunk_iterator_new (cairo_region_copy (region));
+
+  gimp_chunk_iterator_set_interval (render->iter,
+                                    GIMP_PROJECTION_RENDER_INTERVAL);
+
+  proj->priv->render = render;
+
+  gimp_projection_update_priority_rect (proj);
+
+  async = gimp_parallel_run_async_independent (
+    (GimpRunAsyncFunc) gimp_projection_render_thread,
+    render);
+
+  g_object_unref (async);
+}
+
+static cairo_region_t *
+gimp_projection_render_cancel (GimpProjection *proj)
+{
+  GimpProjectionRender *render = proj->priv->render;
+  cairo_region_t       *region;
+
+  if (! render)
+    return NULL;
+
+  proj->priv->render = NULL;
+
+  /*  the render thread stops after its current chunk, which is never
+   *  handed over, so that we don't have to wait for it
+   */
+  g_mutex_lock (&render->mutex);
+
+  render->canceled = TRUE;
+
+  if (render->idle_id)
+    {
+      g_source_remove (render->idle_id);
+      render->idle_id = 0;
+    }
+
+  region = render->region;
+  render->region = NULL;
+
+  cairo_region_union (region, render->pending_region);
+
+  g_mutex_unlock (&render->mutex);
+
+  gimp_projection_render_unref (render);
+
+  return region;
+}
+
+static void
+gimp_projection_render_unref (GimpProjectionRender *render)
+{
+  if (! g_atomic_int_dec_and_test (&render->ref_count))
+    return;
+
+  if (render->iter)
+    gimp_chunk_iterator_stop (render->iter, TRUE);
+
+  if (render->coarse_iter)
+    gimp_chunk_iterator_stop (render->coarse_iter, TRUE);
+
+  g_clear_pointer (&render->stale_region,       cairo_region_destroy);
+  g_clear_pointer (&render->region,             cairo_region_destroy);
+  g_clear_pointer (&render->pending_region,     cairo_region_destroy);
+  g_clear_pointer (&render->rendered_region,    cairo_region_destroy);
+  g_clear_pointer (&render->coarse_done_region, cairo_region_destroy);
+
+  g_mutex_clear (&render->mutex);
+
+  g_object_unref (render->graph);
+  g_object_unref (render->buffer);
+
+  g_slice_free (GimpProjectionRender, render);
+}
+
+static void
+gimp_projection_render_thread (GimpAsync            *async,
+                               GimpProjectionRender *render)
+{
+  GeglRectangle rect;
+  gboolean      coarse;
+
+  /*  the chunks are rendered without holding the lock, from the snapshot
+   *  of the graph, which only this thread uses, into the pass's own
+   *  buffer.  GEGL processes each chunk in parallel on its own.
+   */
+  while (gimp_projection_render_next (render, &rect, &coarse))
+    {
+      if (coarse)
+        {
+          gimp_projection_render_coarse_area (render->graph, render->buffer,
+                                              &rect,
+                                              GIMP_PROJECTION_COARSE_LEVEL);
+        }
+      else
+        {
+          gegl_node_blit_buffer (render->graph, render->buffer, &rect,
+                                 0, GEGL_ABYSS_NONE);
+        }
+
+      g_mutex_lock (&render->mutex);
+
+      if (coarse)
+        {
+          cairo_region_union_rectangle (render->coarse_done_region,
+                                        (const cairo_rectangle_int_t *) &rect);
+        }
+
+      if (render->rendered_region)
+        {
+          cairo_region_union_rectangle (render->rendered_region,
+                                        (const cairo_rectangle_int_t *) &rect);
+        }
+      else
+        {
+          render->rendered_region =
+            cairo_region_create_rectangle ((const cairo_rectangle_int_t *) &rect);
+        }
+
+      g_mutex_unlock (&render->mutex);
+    }
+
+  gimp_projection_render_unref (render);
+
+  gimp_async_finish (async, NULL);
+}
+
+static gboolean
+gimp_projection_render_next (GimpProjectionRender *render,
+                             GeglRectangle        *rect,
+                             gboolean             *coarse)
+{
+  gboolean result = FALSE;
+
+  g_mutex_lock (&render->mutex);
+
+  while (! render->canceled)
+    {
+      GimpChunkIterator **iter;
+      gboolean           *active;
+
+      /*  the coarse pass goes first, so that the visible area gets
+       *  filled in quickly, and is then refined by the regular pass
+       */
+      if (render->coarse_iter)
+        {
+          iter    = &render->coarse_iter;
+          active  = &render->coarse_active;
+          *coarse = TRUE;
+        }
+      else if (render->iter)
+        {
+          iter    = &render->iter;
+          active  = &render->iter_active;
+          *coarse = FALSE;
+        }
+      else
+        {
+          render->finished = TRUE;
+
+          gimp_projection_render_schedule_idle (render);
+
+          break;
+        }
+
+      if (! *active)
+        {
+          if (! gimp_chunk_iterator_next (*iter))
+            {
+              *iter = NULL;
+
+              continue;
+            }
+
+          *active = TRUE;
+        }
+
+      if (gimp_chunk_iterator_get_rect (*iter, rect))
+        {
+          if (! *coarse)
+            {
+              cairo_region_subtract_rectangle (render->region,
+                                               (const cairo_rectangle_int_t *) rect);
+              cairo_region_union_rectangle (render->pending_region,
+                                            (const cairo_rectangle_int_t *) rect);
+            }
+
+          result = TRUE;
+
+          break;
+        }
+
+      /*  hand the chunks rendered during the last interval over to the
+       *  main thread
+       */
+      *active = FALSE;
+
+      if (render->rendered_region)
+        gimp_projection_render_schedule_idle (render);
+    }
+
+  g_mutex_unlock (&render->mutex);
+
+  return result;
+}
+
+static void
+gimp_projection_render_schedule_idle (GimpProjectionRender *render)
+{
+  if (! render->idle_id)
+    {
+      render->idle_id =
+        g_idle_add_full (GIMP_PRIORITY_PROJECTION_IDLE + render->priority,
+                         (GSourceFunc) gimp_projection_render_idle,
+                         render, NULL);
+    }
+}
+
+static gboolean
+gimp_projection_render_idle (GimpProjectionRender *render)
+{
+  GimpProjection *proj = render->proj;
+  cairo_region_t *region;
+  gboolean        finished;
+
+  g_mutex_lock (&render->mutex);
+
+  render->idle_id = 0;
+
+  region = render->rendered_region;
+  render->rendered_region = NULL;
+
+  if (region)
+    cairo_region_subtract (render->pending_region, region);
+
+  finished = render->finished;
+
+  g_mutex_unlock (&render->mutex);
+
+  if (region)
+    {
+      gimp_projection_render_commit (render, region);
+
+      cairo_region_destroy (region);
+    }
+
+  if (finished)
+    {
+      proj->priv->render = NULL;
+
+      gimp_projection_render_unref (render);
+
+      if (! proj->priv->iter && proj->priv->invalidate_preview)
+        {
+          /* invalidate the preview here since it is constructed from
+           * the projection
+           */
+          proj->priv->invalidate_preview = FALSE;
+
+          gimp_projectable_invalidate_preview (proj->priv->projectable);
+        }
+    }
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+gimp_projection_render_commit (GimpProjectionRender *render,
+                               cairo_region_t       *region)
+{
+  GimpProjection          *proj     = render->proj;
+  GimpTileHandlerValidate *validate = proj->priv->validate_handler;
+  gint                     off_x, off_y;
+  gint                     n_rects;
+  gint                     i;
+
+  /*  the areas invalidated since the snapshot was taken are rendered
+   *  again by the next pass
+   */
+  cairo_region_subtract (region, render->stale_region);
+
+  gimp_projectable_get_offset (proj->priv->projectable, &off_x, &off_y);
+
+  n_rects = cairo_region_num_rectangles (region);
+
+  gimp_tile_handler_validate_begin_validate (validate);
+
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_rectangle_int_t rect;
+
+      cairo_region_get_rectangle (region, i, &rect);
+
+      gimp_tile_handler_validate_undo_invalidate (validate,
+                                                  (GeglRectangle *) &rect);
+
+      gegl_buffer_copy (render->buffer, (GeglRectangle *) &rect,
+                        GEGL_ABYSS_NONE,
+                        proj->priv->buffer, (GeglRectangle *) &rect);
+    }
+
+  gimp_tile_handler_validate_end_validate (validate);
+
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_rectangle_int_t rect;
+
+      cairo_region_get_rectangle (region, i, &rect);
+
+      /*  add the projectable's offsets because the list of update areas
+       *  is in tile-pyramid coordinates, but our external API is always
+       *  in terms of image coordinates.
+       */
+      g_signal_emit (proj, projection_signals[UPDATE], 0,
+                     TRUE,
+                     rect.x + off_x,
+                     rect.y + off_y,
+                     rect.width,
+                     rect.height);
+    }
+}
+
+static void
+gimp_projection_render_update_coarse (GimpProjectionRender *render,
+                                      const GeglRectangle  *view)
+{
+  cairo_region_t *region;
+
+  if (render->coarse_iter)
+    {
+      gimp_chunk_iterator_stop (render->coarse_iter, TRUE);
+      render->coarse_iter = NULL;
+    }
+
+  render->coarse_active = FALSE;
+
+  /*  the area isn't rendered coarsely once it's (being) rendered in full
+   *  resolution, so that the coarse pixels never overwrite the fine ones
+   */
+  region = cairo_region_copy (render->region);
+
+  cairo_region_intersect_rectangle (region,
+                                    (const cairo_rectangle_int_t *) view);
+  cairo_region_subtract (region, render->coarse_done_region);
+
+  /*  small updates, like brush strokes, aren't worth it  */
+  if (gimp_projection_get_region_area (region) >=
+      GIMP_PROJECTION_COARSE_MIN_AREA)
+    {
+      render->coarse_iter = gimp_chunk_iterator_new (region);
+
+      gimp_chunk_iterator_set_interval (render->coarse_iter,
+                                        GIMP_PROJECTION_RENDER_INTERVAL);
+    }
+  else
+    {
+      cairo_region_destroy (region);
+    }
+}
+
+static void
+gimp_projection_render_coarse_area (GeglNode            *graph,
+                                    GeglBuffer          *buffer,
+                                    const GeglRectangle *rect,
+                                    gint                 level)
+{
+  const gint     factor = 1 << level;
+  const Babl    *format = gegl_buffer_get_format (buffer);
+  gint           bpp    = babl_format_get_bytes_per_pixel (format);
+  GeglRectangle  coarse_rect;
+  guchar        *coarse_data;
+  guchar        *data;
+  guchar        *dest;
+  gint           off_x;
+  gint           off_y;
+  gint           x, y;
+
+  coarse_rect.x      = floor ((gdouble) rect->x / factor);
+  coarse_rect.y      = floor ((gdouble) rect->y / factor);
+  coarse_rect.width  = ceil ((gdouble) (rect->x + rect->width)  / factor) -
+                       coarse_rect.x;
+  coarse_rect.height = ceil ((gdouble) (rect->y + rect->height) / factor) -
+                       coarse_rect.y;
+
+  /*  the offset of the rect within the upscaled coarse rect  */
+  off_x = rect->x - coarse_rect.x * factor;
+  off_y = rect->y - coarse_rect.y * factor;
+
+  coarse_data = g_malloc ((gsize) coarse_rect.width * coarse_rect.height * bpp);
+  data        = g_malloc ((gsize) rect->width * rect->height * bpp);
+
+  gegl_node_blit (graph,
+                  1.0 / factor, &coarse_rect, format,
+                  coarse_data, GEGL_AUTO_ROWSTRIDE,
+                  GEGL_BLIT_DEFAULT);
+
+  dest = data;
+
+  for (y = 0; y < rect->height; y++)
+    {
+      const guchar *src = coarse_data +
+                          (gsize) ((off_y + y) / factor) *
+                          coarse_rect.width * bpp;
+
+      for (x = 0; x < rect->width; x++)
+        {
+          memcpy (dest, src + (off_x + x) / factor * bpp, bpp);
+
+          dest += bpp;
+        }
+    }
+
+  gegl_buffer_set (buffer, rect, 0, format,
+                   data, GEGL_AUTO_ROWSTRIDE);
+
+  g_free (data);
+  g_free (coarse_data);
+}
+
+
 /*  image callbacks  */
 
 static void
@@ -942,6 +1884,14 @@ gimp_projection_projectable_invalidate (GimpProjectable *projectable,
   x -= off_x;
   y -= off_y;
 
+  /*  the render thread's pass is rendering an older snapshot of the area  */
+  if (proj->priv->render)
+    {
+      cairo_region_union_rectangle (proj->priv->render->stale_region,
+                                    (const cairo_rectangle_int_t *)
+                                    GEGL_RECTANGLE (x, y, w, h));
+    }
+
   gimp_projection_add_update_area (proj, x, y, w, h);
 }
 
@@ -1047,6 +1997,7 @@ gimp_projection_projectable_bounds_changed (GimpProjectable *projectable,
    */
 
   gimp_projection_chunk_render_stop (proj, TRUE);
+  gimp_projection_validate_stop (proj);
 
   if (dx == 0 && dy == 0)
     {
@@ -65,16 +65,25 @@ void             gimp_projection_set_priority_rect (GimpProjection    *proj,
                                                     gint               width,
                                                     gint               height);
 
+void             gimp_projection_set_render_levels (GimpProjection    *proj,
+                                                    gboolean           render_levels);
+gboolean         gimp_projection_get_render_levels (GimpProjection    *proj);
+
 void             gimp_projection_stop_rendering    (GimpProjection    *proj);
 
 void             gimp_projection_flush             (GimpProjection    *proj);
 void             gimp_projection_flush_now         (GimpProjection    *proj,
                                                     gboolean           direct);
+void             gimp_projection_flush_preview     (GimpProjection    *proj,
+                                                    gint               level);
 void             gimp_projection_finish_draw       (GimpProjection    *proj);
+gboolean         gimp_projection_is_rendering      (GimpProjection    *proj);
+void             gimp_projection_validate_idle     (GimpProjection    *proj);
 
 gint64           gimp_projection_estimate_memsize  (GimpImageBaseType  type,
                                                     GimpComponentType  component_type,
                                                     gint               width,
                                                     gint               height);
+gint64           gimp_projection_get_tile_memsize  (GimpProjection    *proj);
 
 gboolean         gimp_projection_has_alpha         (GimpProjection    *proj);
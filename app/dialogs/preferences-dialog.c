@@ -1240,6 +1240,9 @@ prefs_dialog_new (Gimp       *gimp,
   prefs_spin_button_add (object, "num-processors", 1.0, 4.0, 0,
                          _("Number of _threads to use:"),
                          GTK_GRID (grid), 5, size_group);
+  prefs_spin_button_add (object, "num-async-threads", 1.0, 4.0, 0,
+                         _("Number of _background threads:"),
+                         GTK_GRID (grid), 6, size_group);
 #endif /* ENABLE_MP */
 
   /*  Internet access  */
@@ -1669,6 +1672,12 @@ prefs_dialog_new (Gimp       *gimp,
       vbox2 = prefs_frame_new (_("Experimental"),
                                GTK_CONTAINER (vbox), FALSE);
 
+      button = prefs_check_button_add (object, "threaded-projection",
+                                       _("Render the image in a _background thread"),
+                                       GTK_BOX (vbox2));
+      button = prefs_check_button_add (object, "color-transform-lut",
+                                       _("Use a 3D _lookup table for display color management"),
+                                       GTK_BOX (vbox2));
       button = prefs_check_button_add (object, "playground-npd-tool",
                                        _("_N-Point Deformation tool"),
                                        GTK_BOX (vbox2));
@@ -170,6 +170,9 @@ static void   gimp_display_shell_padding_notify_handler     (GObject          *c
 static void   gimp_display_shell_ants_speed_notify_handler  (GObject          *config,
                                                              GParamSpec       *param_spec,
                                                              GimpDisplayShell *shell);
+static void   gimp_display_shell_lut_notify_handler         (GObject          *config,
+                                                             GParamSpec       *param_spec,
+                                                             GimpDisplayShell *shell);
 static void   gimp_display_shell_quality_notify_handler     (GObject          *config,
                                                              GParamSpec       *param_spec,
                                                              GimpDisplayShell *shell);
@@ -398,6 +401,11 @@ gimp_display_shell_connect (GimpDisplayShell *shell)
                     G_CALLBACK (gimp_display_shell_quality_notify_handler),
                     shell);
 
+  g_signal_connect (config,
+                    "notify::color-transform-lut",
+                    G_CALLBACK (gimp_display_shell_lut_notify_handler),
+                    shell);
+
   g_signal_connect (color_config, "notify",
                     G_CALLBACK (gimp_display_shell_color_config_notify_handler),
                     shell);
@@ -467,6 +475,9 @@ gimp_display_shell_disconnect (GimpDisplayShell *shell)
                                         shell);
   shell->color_config_set = FALSE;
 
+  g_signal_handlers_disconnect_by_func (config,
+                                        gimp_display_shell_lut_notify_handler,
+                                        shell);
   g_signal_handlers_disconnect_by_func (config,
                                         gimp_display_shell_quality_notify_handler,
                                         shell);
@@ -1186,6 +1197,14 @@ gimp_display_shell_ants_speed_notify_handler (GObject          *config,
   gimp_display_shell_selection_resume (shell);
 }
 
+static void
+gimp_display_shell_lut_notify_handler (GObject          *config,
+                                       GParamSpec       *param_spec,
+                                       GimpDisplayShell *shell)
+{
+  gimp_color_managed_profile_changed (GIMP_COLOR_MANAGED (shell));
+}
+
 static void
 gimp_display_shell_quality_notify_handler (GObject          *config,
                                            GParamSpec       *param_spec,
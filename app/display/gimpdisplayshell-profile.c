@@ -28,9 +28,10 @@
 
 #include "display-types.h"
 
-#include "config/gimpcoreconfig.h"
+#include "config/gimpdisplayconfig.h"
 
 #include "gegl/gimp-babl.h"
+#include "gegl/gimplut3d.h"
 
 #include "core/gimpimage.h"
 #include "core/gimpprojectable.h"
@@ -167,6 +168,35 @@ gimp_display_shell_profile_update (GimpDisplayShell *shell)
                                      simulation_intent,
                                      simulation_bpc);
 
+  /*  bake the profile transform into a 3D LUT, sampled by a transform
+   *  between float pixels so that the LUT nodes are accurate
+   */
+  if (shell->profile_transform                    &&
+      shell->display->config->color_transform_lut &&
+      gimp_color_profile_is_rgb (filter_profile))
+    {
+      GimpColorTransform *lut_transform;
+
+      lut_transform =
+        gimp_widget_get_color_transform (gtk_widget_get_toplevel (GTK_WIDGET (shell)),
+                                         gimp_display_shell_get_color_config (shell),
+                                         filter_profile,
+                                         babl_format_with_space ("R'G'B'A float",
+                                                                 filter_format),
+                                         babl_format ("R'G'B'A float"),
+                                         proof_profile,
+                                         simulation_intent,
+                                         simulation_bpc);
+
+      if (lut_transform)
+        {
+          shell->profile_lut = gimp_lut3d_new (lut_transform,
+                                               GIMP_LUT3D_DEFAULT_SIZE);
+
+          g_object_unref (lut_transform);
+        }
+    }
+
   if (shell->filter_transform || shell->profile_transform)
     {
       gint w = shell->render_buf_width;
@@ -188,6 +218,30 @@ gimp_display_shell_profile_update (GimpDisplayShell *shell)
     }
 }
 
+void
+gimp_display_shell_profile_convert_buffer (GimpDisplayShell    *shell,
+                                           GeglBuffer          *src_buffer,
+                                           const GeglRectangle *src_rect,
+                                           GeglBuffer          *dest_buffer,
+                                           const GeglRectangle *dest_rect)
+{
+  g_return_if_fail (GIMP_IS_DISPLAY_SHELL (shell));
+  g_return_if_fail (shell->profile_transform != NULL);
+
+  if (shell->profile_lut)
+    {
+      gimp_lut3d_process_buffer (shell->profile_lut,
+                                 src_buffer,  src_rect,
+                                 dest_buffer, dest_rect);
+    }
+  else
+    {
+      gimp_color_transform_process_buffer (shell->profile_transform,
+                                           src_buffer,  src_rect,
+                                           dest_buffer, dest_rect);
+    }
+}
+
 gboolean
 gimp_display_shell_profile_can_convert_to_u8 (GimpDisplayShell *shell)
 {
@@ -229,6 +283,7 @@ static void
 gimp_display_shell_profile_free (GimpDisplayShell *shell)
 {
   g_clear_object (&shell->profile_transform);
+  g_clear_pointer (&shell->profile_lut, gimp_lut3d_free);
   g_clear_object (&shell->filter_transform);
   g_clear_object (&shell->profile_buffer);
   shell->profile_data   = NULL;
@@ -18,9 +18,15 @@
 #pragma once
 
 
-void     gimp_display_shell_profile_init              (GimpDisplayShell *shell);
-void     gimp_display_shell_profile_finalize          (GimpDisplayShell *shell);
+void     gimp_display_shell_profile_init              (GimpDisplayShell    *shell);
+void     gimp_display_shell_profile_finalize          (GimpDisplayShell    *shell);
 
-void     gimp_display_shell_profile_update            (GimpDisplayShell *shell);
+void     gimp_display_shell_profile_update            (GimpDisplayShell    *shell);
 
-gboolean gimp_display_shell_profile_can_convert_to_u8 (GimpDisplayShell *shell);
+void     gimp_display_shell_profile_convert_buffer    (GimpDisplayShell    *shell,
+                                                       GeglBuffer          *src_buffer,
+                                                       const GeglRectangle *src_rect,
+                                                       GeglBuffer          *dest_buffer,
+                                                       const GeglRectangle *dest_rect);
+
+gboolean gimp_display_shell_profile_can_convert_to_u8 (GimpDisplayShell    *shell);
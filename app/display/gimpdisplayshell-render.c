@@ -386,26 +386,26 @@ gimp_display_shell_render (GimpDisplayShell *shell,
               /*  if we have filters, convert the pixels in the filter_buffer
                *  in-place
                */
-              gimp_color_transform_process_buffer (shell->profile_transform,
-                                                   shell->filter_buffer,
-                                                   GEGL_RECTANGLE (0, 0,
-                                                                   width, height),
-                                                   shell->filter_buffer,
-                                                   GEGL_RECTANGLE (0, 0,
-                                                                   width, height));
+              gimp_display_shell_profile_convert_buffer (shell,
+                                                         shell->filter_buffer,
+                                                         GEGL_RECTANGLE (0, 0,
+                                                                         width, height),
+                                                         shell->filter_buffer,
+                                                         GEGL_RECTANGLE (0, 0,
+                                                                         width, height));
             }
           else if (! can_convert_to_u8)
             {
               /*  otherwise, if we can't convert to u8 directly, convert
                *  the pixels from the profile_buffer to the filter_buffer
                */
-              gimp_color_transform_process_buffer (shell->profile_transform,
-                                                   shell->profile_buffer,
-                                                   GEGL_RECTANGLE (0, 0,
-                                                                   width, height),
-                                                   shell->filter_buffer,
-                                                   GEGL_RECTANGLE (0, 0,
-                                                                   width, height));
+              gimp_display_shell_profile_convert_buffer (shell,
+                                                         shell->profile_buffer,
+                                                         GEGL_RECTANGLE (0, 0,
+                                                                         width, height),
+                                                         shell->filter_buffer,
+                                                         GEGL_RECTANGLE (0, 0,
+                                                                         width, height));
             }
           else
             {
@@ -420,13 +420,13 @@ gimp_display_shell_render (GimpDisplayShell *shell,
               /*  otherwise, convert the profile_buffer directly into
                *  the cairo_buffer
                */
-              gimp_color_transform_process_buffer (shell->profile_transform,
-                                                   shell->profile_buffer,
-                                                   GEGL_RECTANGLE (0, 0,
-                                                                   width, height),
-                                                   buffer,
-                                                   GEGL_RECTANGLE (0, 0,
-                                                                   width, height));
+              gimp_display_shell_profile_convert_buffer (shell,
+                                                         shell->profile_buffer,
+                                                         GEGL_RECTANGLE (0, 0,
+                                                                         width, height),
+                                                         buffer,
+                                                         GEGL_RECTANGLE (0, 0,
+                                                                         width, height));
               g_object_unref (buffer);
             }
         }
@@ -154,6 +154,7 @@ struct _GimpDisplayShell
   gboolean           color_config_set; /*  settings changed from defaults     */
 
   GimpColorTransform *profile_transform;
+  GimpLut3D          *profile_lut;     /*  profile_transform as a 3D LUT      */
   GeglBuffer         *profile_buffer;  /*  buffer for profile transform       */
   guchar             *profile_data;    /*  profile_buffer's pixels            */
   gint                profile_stride;  /*  profile_buffer's stride            */
@@ -1062,16 +1062,12 @@ gimp_gegl_convert_color_profile (GeglBuffer               *src_buffer,
 
       GIMP_TIMER_START ();
 
-      gegl_parallel_distribute_area (
-        src_rect, PIXELS_PER_THREAD,
-        [=] (const GeglRectangle *src_area)
-        {
-          SHIFTED_AREA (dest, src);
-
-          gimp_color_transform_process_buffer (transform,
-                                               src_buffer,  src_area,
-                                               dest_buffer, dest_area);
-        });
+      /* the transform distributes the work across threads itself, and
+       * reports progress from this thread
+       */
+      gimp_color_transform_process_buffer (transform,
+                                           src_buffer,  src_rect,
+                                           dest_buffer, dest_rect);
 
       GIMP_TIMER_END ("converting buffer");
 
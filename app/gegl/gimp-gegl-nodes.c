@@ -20,14 +20,32 @@
 
 #include "config.h"
 
+#include <cairo.h>
+#include <gio/gio.h>
 #include <gegl.h>
 
+#include "libgimpconfig/gimpconfig.h"
+
 #include "gimp-gegl-types.h"
 
 #include "operations/layer-modes/gimp-layer-modes.h"
 
 #include "gimp-gegl-nodes.h"
 #include "gimp-gegl-utils.h"
+#include "gimptilehandlervalidate.h"
+
+
+/*  local function prototypes  */
+
+static GeglNode * gimp_gegl_node_snapshot_copy       (GeglNode    *snapshot,
+                                                      GHashTable  *copies,
+                                                      GeglNode    *node,
+                                                      const gchar *pad_name);
+static void       gimp_gegl_node_snapshot_properties (GeglNode    *node,
+                                                      GeglNode    *copy);
+
+
+/*  public functions  */
 
 
 GeglNode *
@@ -243,3 +261,203 @@ gimp_gegl_node_set_color (GeglNode  *node,
                  "value", color,
                  NULL);
 }
+
+/**
+ * gimp_gegl_node_snapshot:
+ * @node: a #GeglNode
+ *
+ * Copies the graph producing @node's "output" pad, so that the copy
+ * keeps rendering the same result while the original graph, and the
+ * buffers it reads, are being modified.  Buffers are duplicated
+ * copy-on-write, and colors and #GimpConfig properties are duplicated.  Buffers
+ * which are validated on demand, and still have invalid areas, such as
+ * the projections of layer groups, are replaced by a copy of the graph
+ * that validates them, so that the copy never renders the original
+ * graph.
+ *
+ * The snapshot must be taken in the thread that modifies @node's graph,
+ * but can then be processed in any thread.
+ *
+ * Returns: (transfer full): a new graph, with an "output" pad.
+ **/
+GeglNode *
+gimp_gegl_node_snapshot (GeglNode *node)
+{
+  GeglNode   *snapshot;
+  GeglNode   *copy;
+  GHashTable *copies;
+
+  g_return_val_if_fail (GEGL_IS_NODE (node), NULL);
+
+  snapshot = gegl_node_new ();
+  copies   = g_hash_table_new (NULL, NULL);
+
+  copy = gimp_gegl_node_snapshot_copy (snapshot, copies, node, "output");
+
+  gegl_node_link (copy, gegl_node_get_output_proxy (snapshot, "output"));
+
+  g_hash_table_unref (copies);
+
+  return snapshot;
+}
+
+
+/*  private functions  */
+
+static GeglNode *
+gimp_gegl_node_snapshot_copy (GeglNode    *snapshot,
+                              GHashTable  *copies,
+                              GeglNode    *node,
+                              const gchar *pad_name)
+{
+  GeglNode                 *copy;
+  GimpTileHandlerValidate  *validate = NULL;
+  gchar                   **pads;
+  gint                      i;
+
+  /*  graphs are entered through their output proxy  */
+  if (! gegl_node_get_gegl_operation (node))
+    node = gegl_node_get_output_proxy (node, pad_name);
+
+  copy = g_hash_table_lookup (copies, node);
+
+  if (copy)
+    return copy;
+
+  if (gegl_node_has_pad (node, "output") &&
+      ! gegl_node_has_pad (node, "input"))
+    {
+      GParamSpec *pspec;
+
+      pspec = gegl_node_find_property (node, "buffer");
+
+      if (pspec && g_type_is_a (pspec->value_type, GEGL_TYPE_BUFFER))
+        {
+          GeglBuffer *buffer;
+
+          gegl_node_get (node, "buffer", &buffer, NULL);
+
+          if (buffer)
+            {
+              validate = gimp_tile_handler_validate_get_assigned (buffer);
+
+              if (validate &&
+                  cairo_region_is_empty (validate->dirty_region))
+                {
+                  validate = NULL;
+                }
+
+              g_object_unref (buffer);
+            }
+        }
+    }
+
+  if (validate)
+    {
+      /*  render the invalid buffer's content from its own graph, instead
+       *  of validating the buffer from the original graph later on
+       */
+      gimp_tile_handler_validate_begin_validate (validate);
+
+      copy = gimp_gegl_node_snapshot_copy (snapshot, copies,
+                                           validate->graph, "output");
+
+      gimp_tile_handler_validate_end_validate (validate);
+
+      g_hash_table_insert (copies, node, copy);
+
+      return copy;
+    }
+
+  copy = gegl_node_new_child (snapshot,
+                              "operation", gegl_node_get_operation (node),
+                              NULL);
+
+  g_hash_table_insert (copies, node, copy);
+
+  gimp_gegl_node_snapshot_properties (node, copy);
+
+  pads = gegl_node_list_input_pads (node);
+
+  for (i = 0; pads && pads[i]; i++)
+    {
+      GeglNode *producer;
+      gchar    *producer_pad = NULL;
+
+      producer = gegl_node_get_producer (node, pads[i], &producer_pad);
+
+      if (producer)
+        {
+          GeglNode *producer_copy;
+
+          producer_copy = gimp_gegl_node_snapshot_copy (snapshot, copies,
+                                                        producer,
+                                                        producer_pad);
+
+          gegl_node_connect (producer_copy, producer_pad, copy, pads[i]);
+        }
+
+      g_free (producer_pad);
+    }
+
+  g_strfreev (pads);
+
+  return copy;
+}
+
+static void
+gimp_gegl_node_snapshot_properties (GeglNode *node,
+                                    GeglNode *copy)
+{
+  GParamSpec **pspecs;
+  guint        n_pspecs;
+  guint        i;
+
+  pspecs = gegl_operation_list_properties (gegl_node_get_operation (node),
+                                           &n_pspecs);
+
+  for (i = 0; i < n_pspecs; i++)
+    {
+      GParamSpec *pspec  = pspecs[i];
+      GValue      value  = G_VALUE_INIT;
+      GObject    *object = NULL;
+
+      if ((pspec->flags & G_PARAM_READWRITE) != G_PARAM_READWRITE ||
+          (pspec->flags & (G_PARAM_CONSTRUCT_ONLY |
+                           GEGL_PARAM_PAD_INPUT   |
+                           GEGL_PARAM_PAD_OUTPUT)))
+        {
+          continue;
+        }
+
+      g_value_init (&value, pspec->value_type);
+
+      gegl_node_get_property (node, pspec->name, &value);
+
+      if (G_VALUE_HOLDS_OBJECT (&value))
+        object = g_value_get_object (&value);
+
+      if (GEGL_IS_BUFFER (object))
+        {
+          g_value_take_object (&value,
+                               gimp_gegl_buffer_dup (GEGL_BUFFER (object),
+                                                     NULL));
+        }
+      else if (GEGL_IS_COLOR (object))
+        {
+          g_value_take_object (&value,
+                               gegl_color_duplicate (GEGL_COLOR (object)));
+        }
+      else if (GIMP_IS_CONFIG (object))
+        {
+          g_value_take_object (&value,
+                               gimp_config_duplicate (GIMP_CONFIG (object)));
+        }
+
+      gegl_node_set_property (copy, pspec->name, &value);
+
+      g_value_unset (&value);
+    }
+
+  g_free (pspecs);
+}
@@ -46,3 +46,5 @@ void       gimp_gegl_node_set_matrix           (GeglNode               *node,
                                                 const GimpMatrix3      *matrix);
 void       gimp_gegl_node_set_color            (GeglNode               *node,
                                                 GeglColor              *color);
+
+GeglNode * gimp_gegl_node_snapshot             (GeglNode               *node);
@@ -27,3 +27,4 @@
 
 
 typedef struct _GimpApplicator GimpApplicator;
+typedef struct _GimpLut3D      GimpLut3D;
@@ -0,0 +1,166 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimplut3d-sse2.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <cairo.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <gegl.h>
+
+#include "gimp-gegl-types.h"
+
+#include "gimplut3d.h"
+
+
+#if COMPILE_SSE2_INTRINISICS
+
+#include <emmintrin.h>
+
+
+/*  see gimp_lut3d_process_pixels().  the grid cell is found with
+ *  vector operations, and the 4 nodes of the tetrahedron are blended
+ *  as whole vectors; table must be 16-byte aligned.
+ */
+void
+gimp_lut3d_process_pixels_sse2 (const gfloat *table,
+                                gint          size,
+                                const gfloat *src,
+                                gfloat       *dest,
+                                gsize         n_pixels)
+{
+  const gint   dr      = 4;
+  const gint   dg      = 4 * size;
+  const gint   db      = 4 * size * size;
+  const __m128 v_zero  = _mm_setzero_ps ();
+  const __m128 v_one   = _mm_set1_ps (1.0f);
+  const __m128 v_scale = _mm_set1_ps (size - 1);
+  const __m128 v_max   = _mm_set1_ps (size - 2);
+
+  while (n_pixels--)
+    {
+      const gfloat *c0;
+      __m128        v_x;
+      __m128        v_i;
+      __m128        v_result;
+      gint          i[4];
+      gfloat        f[4];
+      gfloat        w0, w1, w2, w3;
+      gint          o1, o2;
+      gfloat        alpha = src[3];
+
+      /*  _mm_max_ps() returns its second operand for NaN  */
+      v_x = _mm_loadu_ps (src);
+      v_x = _mm_max_ps (v_x, v_zero);
+      v_x = _mm_min_ps (v_x, v_one);
+      v_x = _mm_sqrt_ps (v_x);
+      v_x = _mm_mul_ps (v_x, v_scale);
+
+      v_i = _mm_cvtepi32_ps (_mm_cvttps_epi32 (v_x));
+      v_i = _mm_min_ps (v_i, v_max);
+
+      _mm_storeu_si128 ((__m128i *) i, _mm_cvttps_epi32 (v_i));
+      _mm_storeu_ps (f, _mm_sub_ps (v_x, v_i));
+
+      if (f[0] > f[1])
+        {
+          if (f[1] > f[2])
+            {
+              o1 = dr;
+              o2 = dr + dg;
+
+              w0 = 1.0f - f[0];
+              w1 = f[0] - f[1];
+              w2 = f[1] - f[2];
+              w3 = f[2];
+            }
+          else if (f[0] > f[2])
+            {
+              o1 = dr;
+              o2 = dr + db;
+
+              w0 = 1.0f - f[0];
+              w1 = f[0] - f[2];
+              w2 = f[2] - f[1];
+              w3 = f[1];
+            }
+          else
+            {
+              o1 = db;
+              o2 = dr + db;
+
+              w0 = 1.0f - f[2];
+              w1 = f[2] - f[0];
+              w2 = f[0] - f[1];
+              w3 = f[1];
+            }
+        }
+      else
+        {
+          if (f[2] > f[1])
+            {
+              o1 = db;
+              o2 = dg + db;
+
+              w0 = 1.0f - f[2];
+              w1 = f[2] - f[1];
+              w2 = f[1] - f[0];
+              w3 = f[0];
+            }
+          else if (f[2] > f[0])
+            {
+              o1 = dg;
+              o2 = dg + db;
+
+              w0 = 1.0f - f[1];
+              w1 = f[1] - f[2];
+              w2 = f[2] - f[0];
+              w3 = f[0];
+            }
+          else
+            {
+              o1 = dg;
+              o2 = dr + dg;
+
+              w0 = 1.0f - f[1];
+              w1 = f[1] - f[0];
+              w2 = f[0] - f[2];
+              w3 = f[2];
+            }
+        }
+
+      c0 = table + i[0] * dr + i[1] * dg + i[2] * db;
+
+      v_result =                     _mm_mul_ps (_mm_load_ps (c0),
+                                                 _mm_set1_ps (w0));
+      v_result = _mm_add_ps (v_result, _mm_mul_ps (_mm_load_ps (c0 + o1),
+                                                   _mm_set1_ps (w1)));
+      v_result = _mm_add_ps (v_result, _mm_mul_ps (_mm_load_ps (c0 + o2),
+                                                   _mm_set1_ps (w2)));
+      v_result = _mm_add_ps (v_result, _mm_mul_ps (_mm_load_ps (c0 + dr + dg + db),
+                                                   _mm_set1_ps (w3)));
+
+      _mm_storeu_ps (dest, v_result);
+      dest[3] = alpha;
+
+      src  += 4;
+      dest += 4;
+    }
+}
+
+#endif /* COMPILE_SSE2_INTRINISICS */
@@ -0,0 +1,383 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimplut3d.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gegl.h>
+
+#include "libgimpbase/gimpbase.h"
+#include "libgimpcolor/gimpcolor.h"
+#include "libgimpmath/gimpmath.h"
+
+#include "gimp-gegl-types.h"
+
+#include "gimplut3d.h"
+
+
+#define PIXELS_PER_THREAD \
+  (/* each thread costs as much as */ 64.0 * 64.0 /* pixels */)
+
+
+/*  a 3D lookup table, sampling a color transform on a regular grid of
+ *  shaped R'G'B' values.  each component is shaped by a square root
+ *  before the lookup, so that the grid is finer near black, where the
+ *  TRCs of most display profiles are steepest; on a uniform R'G'B'
+ *  grid, the first cell alone is off by several 8-bit levels.  the
+ *  table is stored blue-major, with 4 floats per node so that each
+ *  node can be loaded as a single vector; the 4th component is unused.
+ */
+struct _GimpLut3D
+{
+  gint    size;
+  gfloat *table;
+};
+
+
+typedef struct
+{
+  const GimpLut3D *lut;
+  GeglBuffer      *src_buffer;
+  const Babl      *src_format;
+  GeglBuffer      *dest_buffer;
+  const Babl      *dest_format;
+  gint             offset_x;
+  gint             offset_y;
+} ProcessBufferData;
+
+
+/*  local function prototypes  */
+
+static void   gimp_lut3d_process_area (const GeglRectangle *area,
+                                       ProcessBufferData   *data);
+
+
+/*  public functions  */
+
+/**
+ * gimp_lut3d_new:
+ * @transform: a #GimpColorTransform
+ * @size:      the number of grid points along each axis
+ *
+ * Samples @transform on a @size x @size x @size grid of R'G'B'
+ * values in [0, 1].  The grid is uniform in the square root of each
+ * component, so that it is finer near black.  @transform should have
+ * been created for
+ * "R'G'B'A float" pixels, so that the grid is sampled at full
+ * precision.
+ *
+ * Returns: the new #GimpLut3D.
+ **/
+GimpLut3D *
+gimp_lut3d_new (GimpColorTransform *transform,
+                gint                size)
+{
+  GimpLut3D *lut;
+  gfloat    *grid;
+  gfloat    *p;
+  gint       n_nodes;
+  gint       r, g, b;
+
+  g_return_val_if_fail (GIMP_IS_COLOR_TRANSFORM (transform), NULL);
+  g_return_val_if_fail (size >= 2, NULL);
+
+  n_nodes = size * size * size;
+
+  lut = g_slice_new (GimpLut3D);
+
+  lut->size  = size;
+  lut->table = gegl_malloc (n_nodes * 4 * sizeof (gfloat));
+
+  grid = g_new (gfloat, n_nodes * 4);
+
+  for (b = 0, p = grid; b < size; b++)
+    for (g = 0; g < size; g++)
+      for (r = 0; r < size; r++, p += 4)
+        {
+          p[0] = SQR ((gfloat) r / (size - 1));
+          p[1] = SQR ((gfloat) g / (size - 1));
+          p[2] = SQR ((gfloat) b / (size - 1));
+          p[3] = 1.0f;
+        }
+
+  gimp_color_transform_process_pixels (transform,
+                                       babl_format ("R'G'B'A float"), grid,
+                                       babl_format ("R'G'B'A float"), lut->table,
+                                       n_nodes);
+
+  g_free (grid);
+
+  return lut;
+}
+
+void
+gimp_lut3d_free (GimpLut3D *lut)
+{
+  g_return_if_fail (lut != NULL);
+
+  gegl_free (lut->table);
+
+  g_slice_free (GimpLut3D, lut);
+}
+
+/**
+ * gimp_lut3d_process_pixels:
+ * @lut:      a #GimpLut3D
+ * @src:      "R'G'B'A float" source pixels
+ * @dest:     "R'G'B'A float" destination pixels, may be @src
+ * @n_pixels: the number of pixels
+ *
+ * Maps @src through @lut, using tetrahedral interpolation.  Color
+ * components are clamped to [0, 1], alpha is copied unchanged.
+ **/
+void
+gimp_lut3d_process_pixels (const GimpLut3D *lut,
+                           const gfloat    *src,
+                           gfloat          *dest,
+                           gsize            n_pixels)
+{
+  const gfloat *table = lut->table;
+  const gint    dr    = 4;
+  const gint    dg    = 4 * lut->size;
+  const gint    db    = 4 * lut->size * lut->size;
+  const gfloat  scale = lut->size - 1;
+
+#if COMPILE_SSE2_INTRINISICS
+  if (gimp_cpu_accel_get_support () & GIMP_CPU_ACCEL_X86_SSE2)
+    {
+      gimp_lut3d_process_pixels_sse2 (lut->table, lut->size,
+                                      src, dest, n_pixels);
+      return;
+    }
+#endif /* COMPILE_SSE2_INTRINISICS */
+
+  while (n_pixels--)
+    {
+      const gfloat *c0;
+      const gfloat *c1;
+      const gfloat *c2;
+      const gfloat *c3;
+      gfloat        x[3];
+      gint          i[3];
+      gfloat        f[3];
+      gfloat        w0, w1, w2, w3;
+      gint          o1, o2;
+      gint          k;
+
+      for (k = 0; k < 3; k++)
+        {
+          /*  also maps NaN to 0  */
+          x[k] = src[k] > 0.0f ? sqrtf (MIN (src[k], 1.0f)) * scale : 0.0f;
+          i[k] = MIN ((gint) x[k], lut->size - 2);
+          f[k] = x[k] - i[k];
+        }
+
+      /*  split the grid cell into 6 tetrahedra, along its diagonal
+       *  from c0 to c3, and pick the one containing the pixel
+       */
+      if (f[0] > f[1])
+        {
+          if (f[1] > f[2])
+            {
+              o1 = dr;
+              o2 = dr + dg;
+
+              w0 = 1.0f - f[0];
+              w1 = f[0] - f[1];
+              w2 = f[1] - f[2];
+              w3 = f[2];
+            }
+          else if (f[0] > f[2])
+            {
+              o1 = dr;
+              o2 = dr + db;
+
+              w0 = 1.0f - f[0];
+              w1 = f[0] - f[2];
+              w2 = f[2] - f[1];
+              w3 = f[1];
+            }
+          else
+            {
+              o1 = db;
+              o2 = dr + db;
+
+              w0 = 1.0f - f[2];
+              w1 = f[2] - f[0];
+              w2 = f[0] - f[1];
+              w3 = f[1];
+            }
+        }
+      else
+        {
+          if (f[2] > f[1])
+            {
+              o1 = db;
+              o2 = dg + db;
+
+              w0 = 1.0f - f[2];
+              w1 = f[2] - f[1];
+              w2 = f[1] - f[0];
+              w3 = f[0];
+            }
+          else if (f[2] > f[0])
+            {
+              o1 = dg;
+              o2 = dg + db;
+
+              w0 = 1.0f - f[1];
+              w1 = f[1] - f[2];
+              w2 = f[2] - f[0];
+              w3 = f[0];
+            }
+          else
+            {
+              o1 = dg;
+              o2 = dr + dg;
+
+              w0 = 1.0f - f[1];
+              w1 = f[1] - f[0];
+              w2 = f[0] - f[2];
+              w3 = f[2];
+            }
+        }
+
+      c0 = table + i[0] * dr + i[1] * dg + i[2] * db;
+      c1 = c0 + o1;
+      c2 = c0 + o2;
+      c3 = c0 + dr + dg + db;
+
+      dest[3] = src[3];
+
+      for (k = 0; k < 3; k++)
+        dest[k] = w0 * c0[k] + w1 * c1[k] + w2 * c2[k] + w3 * c3[k];
+
+      src  += 4;
+      dest += 4;
+    }
+}
+
+/**
+ * gimp_lut3d_process_buffer:
+ * @lut:         a #GimpLut3D
+ * @src_buffer:  source #GeglBuffer
+ * @src_rect:    rectangle in @src_buffer
+ * @dest_buffer: destination #GeglBuffer, may be @src_buffer
+ * @dest_rect:   rectangle in @dest_buffer
+ *
+ * Like gimp_color_transform_process_buffer(), only the encoding of
+ * @src_buffer's and @dest_buffer's formats is honored, their color
+ * spaces are ignored.
+ **/
+void
+gimp_lut3d_process_buffer (const GimpLut3D     *lut,
+                           GeglBuffer          *src_buffer,
+                           const GeglRectangle *src_rect,
+                           GeglBuffer          *dest_buffer,
+                           const GeglRectangle *dest_rect)
+{
+  ProcessBufferData data;
+  GeglRectangle     rect;
+
+  g_return_if_fail (lut != NULL);
+  g_return_if_fail (GEGL_IS_BUFFER (src_buffer));
+  g_return_if_fail (GEGL_IS_BUFFER (dest_buffer));
+
+  if (src_rect)
+    rect = *src_rect;
+  else
+    rect = *gegl_buffer_get_extent (src_buffer);
+
+  data.lut         = lut;
+  data.src_buffer  = src_buffer;
+  data.src_format  =
+    babl_format_with_space ("R'G'B'A float",
+                            gegl_buffer_get_format (src_buffer));
+  data.dest_buffer = dest_buffer;
+  data.dest_format =
+    babl_format_with_space ("R'G'B'A float",
+                            gegl_buffer_get_format (dest_buffer));
+
+  if (dest_rect)
+    {
+      data.offset_x = dest_rect->x - rect.x;
+      data.offset_y = dest_rect->y - rect.y;
+    }
+  else
+    {
+      data.offset_x = gegl_buffer_get_x (dest_buffer) - rect.x;
+      data.offset_y = gegl_buffer_get_y (dest_buffer) - rect.y;
+    }
+
+  gegl_parallel_distribute_area (
+    &rect, PIXELS_PER_THREAD, GEGL_SPLIT_STRATEGY_AUTO,
+    (GeglParallelDistributeAreaFunc) gimp_lut3d_process_area,
+    &data);
+}
+
+
+/*  private functions  */
+
+static void
+gimp_lut3d_process_area (const GeglRectangle *area,
+                         ProcessBufferData   *data)
+{
+  GeglBufferIterator *iter;
+  GeglRectangle       dest_area;
+
+  dest_area.x      = area->x + data->offset_x;
+  dest_area.y      = area->y + data->offset_y;
+  dest_area.width  = area->width;
+  dest_area.height = area->height;
+
+  if (data->src_buffer != data->dest_buffer)
+    {
+      iter = gegl_buffer_iterator_new (data->src_buffer, area, 0,
+                                       data->src_format,
+                                       GEGL_ACCESS_READ,
+                                       GEGL_ABYSS_NONE, 2);
+
+      gegl_buffer_iterator_add (iter, data->dest_buffer, &dest_area, 0,
+                                data->dest_format,
+                                GEGL_ACCESS_WRITE,
+                                GEGL_ABYSS_NONE);
+
+      while (gegl_buffer_iterator_next (iter))
+        {
+          gimp_lut3d_process_pixels (data->lut,
+                                     iter->items[0].data,
+                                     iter->items[1].data,
+                                     iter->length);
+        }
+    }
+  else
+    {
+      iter = gegl_buffer_iterator_new (data->src_buffer, area, 0,
+                                       data->src_format,
+                                       GEGL_ACCESS_READWRITE,
+                                       GEGL_ABYSS_NONE, 1);
+
+      while (gegl_buffer_iterator_next (iter))
+        {
+          gimp_lut3d_process_pixels (data->lut,
+                                     iter->items[0].data,
+                                     iter->items[0].data,
+                                     iter->length);
+        }
+    }
+}
@@ -0,0 +1,49 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimplut3d.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+
+#define GIMP_LUT3D_DEFAULT_SIZE 33
+
+
+GimpLut3D * gimp_lut3d_new            (GimpColorTransform  *transform,
+                                       gint                 size);
+void        gimp_lut3d_free           (GimpLut3D           *lut);
+
+void        gimp_lut3d_process_pixels (const GimpLut3D     *lut,
+                                       const gfloat        *src,
+                                       gfloat              *dest,
+                                       gsize                n_pixels);
+void        gimp_lut3d_process_buffer (const GimpLut3D     *lut,
+                                       GeglBuffer          *src_buffer,
+                                       const GeglRectangle *src_rect,
+                                       GeglBuffer          *dest_buffer,
+                                       const GeglRectangle *dest_rect);
+
+
+#if COMPILE_SSE2_INTRINISICS
+
+void        gimp_lut3d_process_pixels_sse2 (const gfloat   *table,
+                                            gint            size,
+                                            const gfloat   *src,
+                                            gfloat         *dest,
+                                            gsize           n_pixels);
+
+#endif /* COMPILE_SSE2_INTRINISICS */
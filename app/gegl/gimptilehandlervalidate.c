@@ -44,7 +44,8 @@ enum
   PROP_FORMAT,
   PROP_TILE_WIDTH,
   PROP_TILE_HEIGHT,
-  PROP_WHOLE_TILE
+  PROP_WHOLE_TILE,
+  PROP_RENDER_LEVELS
 };
 
 
@@ -69,6 +70,8 @@ static void     gimp_tile_handler_validate_real_validate_buffer (GimpTileHandler
                                                                  const GeglRectangle     *rect,
                                                                  GeglBuffer              *buffer);
 
+static void     gimp_tile_handler_validate_clear_levels         (GimpTileHandlerValidate *validate);
+
 static gpointer gimp_tile_handler_validate_command              (GeglTileSource  *source,
                                                                  GeglTileCommand  command,
                                                                  gint             x,
@@ -130,6 +133,17 @@ gimp_tile_handler_validate_class_init (GimpTileHandlerValidateClass *klass)
                                                          FALSE,
                                                          GIMP_PARAM_READWRITE |
                                                          G_PARAM_CONSTRUCT));
+
+  /*  when set, reading a dirty area at a pyramid level other than 0 renders
+   *  the graph at that level directly, instead of validating the area in
+   *  full resolution first, and downscaling it.  the area stays dirty at
+   *  level 0, and is rendered in full resolution when read there.
+   */
+  g_object_class_install_property (object_class, PROP_RENDER_LEVELS,
+                                   g_param_spec_boolean ("render-levels", NULL, NULL,
+                                                         FALSE,
+                                                         GIMP_PARAM_READWRITE |
+                                                         G_PARAM_CONSTRUCT));
 }
 
 static void
@@ -150,6 +164,8 @@ gimp_tile_handler_validate_finalize (GObject *object)
   g_clear_object (&validate->graph);
   g_clear_pointer (&validate->dirty_region, cairo_region_destroy);
 
+  gimp_tile_handler_validate_clear_levels (validate);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -175,6 +191,12 @@ gimp_tile_handler_validate_set_property (GObject      *object,
     case PROP_WHOLE_TILE:
       validate->whole_tile = g_value_get_boolean (value);
       break;
+    case PROP_RENDER_LEVELS:
+      validate->render_levels = g_value_get_boolean (value);
+
+      if (! validate->render_levels)
+        gimp_tile_handler_validate_clear_levels (validate);
+      break;
 
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
@@ -204,6 +226,9 @@ gimp_tile_handler_validate_get_property (GObject    *object,
     case PROP_WHOLE_TILE:
       g_value_set_boolean (value, validate->whole_tile);
       break;
+    case PROP_RENDER_LEVELS:
+      g_value_set_boolean (value, validate->render_levels);
+      break;
 
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
@@ -408,6 +433,94 @@ gimp_tile_handler_validate_validate_tile (GeglTileSource *source,
   return tile;
 }
 
+static GeglTile *
+gimp_tile_handler_validate_render_level_tile (GeglTileSource *source,
+                                              gint            x,
+                                              gint            y,
+                                              gint            z)
+{
+  GimpTileHandlerValidate  *validate = GIMP_TILE_HANDLER_VALIDATE (source);
+  cairo_region_t          **level_region;
+  GeglTile                 *tile;
+  cairo_rectangle_int_t     tile_rect;
+  gint                      tile_stride;
+
+  if (! validate->render_levels                  ||
+      z > GIMP_TILE_HANDLER_VALIDATE_N_LEVELS     ||
+      validate->suspend_validate                 ||
+      cairo_region_is_empty (validate->dirty_region))
+    {
+      return gegl_tile_handler_source_command (source,
+                                               GEGL_TILE_GET, x, y, z, NULL);
+    }
+
+  level_region = &validate->level_regions[z - 1];
+
+  /*  the area the tile covers at level 0  */
+  tile_rect.x      = x * validate->tile_width  * (1 << z);
+  tile_rect.y      = y * validate->tile_height * (1 << z);
+  tile_rect.width  =     validate->tile_width  * (1 << z);
+  tile_rect.height =     validate->tile_height * (1 << z);
+
+  /*  if none of the area is dirty, or if the tile was already rendered
+   *  since the area was last invalidated, the tile is up to date
+   */
+  if (cairo_region_contains_rectangle (validate->dirty_region,
+                                       &tile_rect) ==
+      CAIRO_REGION_OVERLAP_OUT ||
+      (*level_region &&
+       cairo_region_contains_rectangle (*level_region,
+                                        &tile_rect) ==
+       CAIRO_REGION_OVERLAP_IN))
+    {
+      return gegl_tile_handler_source_command (source,
+                                               GEGL_TILE_GET, x, y, z, NULL);
+    }
+
+  /*  drop the damaged tile, if any, and render a new one in its place  */
+  gegl_tile_handler_source_command (source, GEGL_TILE_VOID, x, y, z, NULL);
+
+  tile = gegl_tile_handler_create_tile (GEGL_TILE_HANDLER (source), x, y, z);
+
+  tile_stride = babl_format_get_bytes_per_pixel (validate->format) *
+                validate->tile_width;
+
+  gimp_tile_handler_validate_begin_validate (validate);
+
+  gegl_tile_lock (tile);
+
+  gegl_node_blit (validate->graph,
+                  1.0 / (1 << z),
+                  GEGL_RECTANGLE (x * validate->tile_width,
+                                  y * validate->tile_height,
+                                  validate->tile_width,
+                                  validate->tile_height),
+                  validate->format,
+                  gegl_tile_get_data (tile),
+                  tile_stride,
+                  GEGL_BLIT_DEFAULT);
+
+  gegl_tile_unlock (tile);
+
+  gimp_tile_handler_validate_end_validate (validate);
+
+  if (*level_region)
+    cairo_region_union_rectangle (*level_region, &tile_rect);
+  else
+    *level_region = cairo_region_create_rectangle (&tile_rect);
+
+  return tile;
+}
+
+static void
+gimp_tile_handler_validate_clear_levels (GimpTileHandlerValidate *validate)
+{
+  gint i;
+
+  for (i = 0; i < GIMP_TILE_HANDLER_VALIDATE_N_LEVELS; i++)
+    g_clear_pointer (&validate->level_regions[i], cairo_region_destroy);
+}
+
 static gpointer
 gimp_tile_handler_validate_command (GeglTileSource  *source,
                                     GeglTileCommand  command,
@@ -416,8 +529,13 @@ gimp_tile_handler_validate_command (GeglTileSource  *source,
                                     gint             z,
                                     gpointer         data)
 {
-  if (command == GEGL_TILE_GET && z == 0)
-    return gimp_tile_handler_validate_validate_tile (source, x, y);
+  if (command == GEGL_TILE_GET)
+    {
+      if (z == 0)
+        return gimp_tile_handler_validate_validate_tile (source, x, y);
+      else
+        return gimp_tile_handler_validate_render_level_tile (source, x, y, z);
+    }
 
   return gegl_tile_handler_source_command (source, command, x, y, z, data);
 }
@@ -492,6 +610,21 @@ gimp_tile_handler_validate_invalidate (GimpTileHandlerValidate *validate,
   cairo_region_union_rectangle (validate->dirty_region,
                                 (cairo_rectangle_int_t *) rect);
 
+  if (validate->render_levels)
+    {
+      gint i;
+
+      for (i = 0; i < GIMP_TILE_HANDLER_VALIDATE_N_LEVELS; i++)
+        {
+          if (validate->level_regions[i])
+            {
+              cairo_region_subtract_rectangle (
+                validate->level_regions[i],
+                (const cairo_rectangle_int_t *) rect);
+            }
+        }
+    }
+
   gegl_tile_handler_damage_rect (GEGL_TILE_HANDLER (validate), rect);
 
   g_signal_emit (validate, gimp_tile_handler_validate_signals[INVALIDATED],
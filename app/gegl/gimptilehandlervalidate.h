@@ -33,6 +33,12 @@
 #define GIMP_TILE_HANDLER_VALIDATE_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj),  GIMP_TYPE_TILE_HANDLER_VALIDATE, GimpTileHandlerValidateClass))
 
 
+/*  the number of pyramid levels that can be rendered directly, when
+ *  "render-levels" is set
+ */
+#define GIMP_TILE_HANDLER_VALIDATE_N_LEVELS 8
+
+
 typedef struct _GimpTileHandlerValidate      GimpTileHandlerValidate;
 typedef struct _GimpTileHandlerValidateClass GimpTileHandlerValidateClass;
 
@@ -46,8 +52,14 @@ struct _GimpTileHandlerValidate
   gint             tile_width;
   gint             tile_height;
   gboolean         whole_tile;
+  gboolean         render_levels;
   gint             validating;
   gint             suspend_validate;
+
+  /*  the areas, in level-0 coordinates, whose tiles at each pyramid level
+   *  were rendered directly, while the area was still dirty
+   */
+  cairo_region_t  *level_regions[GIMP_TILE_HANDLER_VALIDATE_N_LEVELS];
 };
 
 struct _GimpTileHandlerValidateClass
@@ -45,7 +45,10 @@ static const GDebugKey log_keys[] =
   { "rectangle-tool",     GIMP_LOG_RECTANGLE_TOOL     },
   { "brush-cache",        GIMP_LOG_BRUSH_CACHE        },
   { "projection",         GIMP_LOG_PROJECTION         },
-  { "xcf",                GIMP_LOG_XCF                }
+  { "xcf",                GIMP_LOG_XCF                },
+  { "paint",              GIMP_LOG_PAINT              },
+  { "iscissors",          GIMP_LOG_ISCISSORS          },
+  { "warp",               GIMP_LOG_WARP               }
 };
 
 static const gchar * const log_domains[] =
@@ -44,7 +44,10 @@ typedef enum
   GIMP_LOG_BRUSH_CACHE        = 1 << 18,
   GIMP_LOG_PROJECTION         = 1 << 19,
   GIMP_LOG_XCF                = 1 << 20,
-  GIMP_LOG_MAGIC_MATCH        = 1 << 21
+  GIMP_LOG_MAGIC_MATCH        = 1 << 21,
+  GIMP_LOG_PAINT              = 1 << 22,
+  GIMP_LOG_ISCISSORS          = 1 << 23,
+  GIMP_LOG_WARP               = 1 << 24
 } GimpLogFlags;
 
 
@@ -32,6 +32,33 @@
 #include "gimp-intl.h"
 
 
+#define PIXELS_PER_THREAD \
+  (/* each thread costs as much as */ 64.0 * 64.0 /* pixels */)
+
+
+typedef struct
+{
+  GimpVector2  v1;    /* the edge's first vertex  */
+  GimpVector2  a;     /* the edge's vector        */
+  gdouble      Q;     /* its squared length       */
+  gdouble      absa;  /* and its length           */
+} CageEdge;
+
+typedef struct
+{
+  GimpCageConfig *config;
+  GeglBuffer     *buffer;
+  const Babl     *format;
+  gint            tile_width;
+  gint            tile_height;
+  gint            n_points;
+  CageEdge       *edges;
+  gboolean        update;
+  gboolean       *changed_edge;
+  gboolean       *changed_vertex;
+} CalcData;
+
+
 static void           gimp_operation_cage_coef_calc_finalize         (GObject              *object);
 static void           gimp_operation_cage_coef_calc_get_property     (GObject              *object,
                                                                       guint                 property_id,
@@ -49,6 +76,25 @@ static gboolean       gimp_operation_cage_coef_calc_process          (GeglOperat
                                                                       const GeglRectangle  *roi,
                                                                       gint                  level);
 
+static void           gimp_operation_cage_coef_calc_data_init        (CalcData             *data,
+                                                                      GimpCageConfig       *config,
+                                                                      GeglBuffer           *buffer,
+                                                                      const gboolean       *moved);
+static void           gimp_operation_cage_coef_calc_data_clear       (CalcData             *data);
+static gboolean       gimp_operation_cage_coef_calc_rect_outside     (CalcData             *data,
+                                                                      const GeglRectangle  *rect);
+static void           gimp_operation_cage_coef_calc_area             (const GeglRectangle  *area,
+                                                                      CalcData             *data);
+static void           gimp_operation_cage_coef_calc_tile             (const GeglRectangle  *rect,
+                                                                      CalcData             *data);
+static void           gimp_operation_cage_coef_calc_pixel            (const CageEdge       *edges,
+                                                                      gint                  n,
+                                                                      gint                  x,
+                                                                      gint                  y,
+                                                                      const gboolean       *changed_edge,
+                                                                      const gboolean       *changed_vertex,
+                                                                      gfloat               *coef);
+
 
 G_DEFINE_TYPE (GimpOperationCageCoefCalc, gimp_operation_cage_coef_calc,
                GEGL_TYPE_OPERATION_SOURCE)
@@ -145,27 +191,6 @@ gimp_operation_cage_coef_calc_set_property (GObject      *object,
     }
 }
 
-static gboolean
-gimp_operation_cage_coef_calc_is_on_straight (GimpVector2 *d1,
-                                              GimpVector2 *d2,
-                                              GimpVector2 *p)
-{
-  GimpVector2 v1, v2;
-  gfloat      deter;
-
-  v1.x = p->x - d1->x;
-  v1.y = p->y - d1->y;
-  v2.x = d2->x - d1->x;
-  v2.y = d2->y - d1->y;
-
-  gimp_vector2_normalize (&v1);
-  gimp_vector2_normalize (&v2);
-
-  deter = v1.x * v2.y - v2.x * v1.y;
-
-  return (deter < 0.000000001) && (deter > -0.000000001);
-}
-
 static void
 gimp_operation_cage_coef_calc_prepare (GeglOperation *operation)
 {
@@ -202,22 +227,281 @@ gimp_operation_cage_coef_calc_process (GeglOperation       *operation,
 {
   GimpOperationCageCoefCalc *occc   = GIMP_OPERATION_CAGE_COEF_CALC (operation);
   GimpCageConfig            *config = GIMP_CAGE_CONFIG (occc->config);
+  CalcData                   data;
+
+  if (! config)
+    return FALSE;
 
-  const Babl *format;
+  gimp_operation_cage_coef_calc_data_init (&data, config, output, NULL);
 
-  GeglBufferIterator *it;
-  guint               n_cage_vertices;
-  GimpCagePoint      *current, *last;
+  gegl_parallel_distribute_area (
+    roi, PIXELS_PER_THREAD, GEGL_SPLIT_STRATEGY_AUTO,
+    (GeglParallelDistributeAreaFunc) gimp_operation_cage_coef_calc_area,
+    &data);
 
-  if (! config)
+  gimp_operation_cage_coef_calc_data_clear (&data);
+
+  return TRUE;
+}
+
+
+/*  public functions  */
+
+/**
+ * gimp_operation_cage_coef_calc_update:
+ * @config:     the cage config
+ * @old_points: the #GimpCagePoint array @coef was computed for
+ * @coef:       a coefficient buffer
+ *
+ * Updates @coef, previously computed for the source points of
+ * @old_points, to match the source points of @config.  Only the
+ * coefficients depending on the edges adjacent to moved points are
+ * recomputed.
+ *
+ * Returns: %TRUE if @coef was updated, %FALSE if the change is too
+ *          large for an update, in which case @coef is left untouched
+ *          and needs to be recomputed from scratch.
+ **/
+gboolean
+gimp_operation_cage_coef_calc_update (GimpCageConfig *config,
+                                      GArray         *old_points,
+                                      GeglBuffer     *coef)
+{
+  CalcData       data;
+  GeglRectangle  bounding_box;
+  gboolean      *moved;
+  gint           n_points;
+  gint           n_changed_edges = 0;
+  gint           i;
+
+  g_return_val_if_fail (GIMP_IS_CAGE_CONFIG (config), FALSE);
+  g_return_val_if_fail (old_points != NULL, FALSE);
+  g_return_val_if_fail (GEGL_IS_BUFFER (coef), FALSE);
+
+  n_points = gimp_cage_config_get_n_points (config);
+
+  if (n_points < 3 || n_points != old_points->len)
     return FALSE;
 
-  format = babl_format_n (babl_type ("float"), 2 * gimp_cage_config_get_n_points (config));
+  /*  pixels outside of the buffer were never computed  */
+  bounding_box = gimp_cage_config_get_bounding_box (config);
+
+  if (! gegl_rectangle_contains (gegl_buffer_get_extent (coef),
+                                 &bounding_box))
+    {
+      return FALSE;
+    }
+
+  moved = g_new0 (gboolean, n_points);
+
+  for (i = 0; i < n_points; i++)
+    {
+      GimpCagePoint *point     = &g_array_index (config->cage_points,
+                                                 GimpCagePoint, i);
+      GimpCagePoint *old_point = &g_array_index (old_points,
+                                                 GimpCagePoint, i);
+
+      moved[i] = (point->src_point.x != old_point->src_point.x ||
+                  point->src_point.y != old_point->src_point.y);
+    }
+
+  for (i = 0; i < n_points; i++)
+    {
+      if (moved[i] || moved[(i + 1) % n_points])
+        n_changed_edges++;
+    }
+
+  /*  the update also recomputes the two edges around the changed ones,
+   *  for their vertex coefficients.  when that is more than half of the
+   *  cage, a full computation is not much slower.
+   */
+  if (n_changed_edges == 0 || 2 * (n_changed_edges + 2) > n_points)
+    {
+      g_free (moved);
+
+      return n_changed_edges == 0;
+    }
+
+  gimp_operation_cage_coef_calc_data_init (&data, config, coef, moved);
+
+  g_free (moved);
+
+  gegl_parallel_distribute_area (
+    gegl_buffer_get_extent (coef), PIXELS_PER_THREAD, GEGL_SPLIT_STRATEGY_AUTO,
+    (GeglParallelDistributeAreaFunc) gimp_operation_cage_coef_calc_area,
+    &data);
+
+  gimp_operation_cage_coef_calc_data_clear (&data);
+
+  return TRUE;
+}
+
+
+/*  private functions  */
+
+static void
+gimp_operation_cage_coef_calc_data_init (CalcData       *data,
+                                         GimpCageConfig *config,
+                                         GeglBuffer     *buffer,
+                                         const gboolean *moved)
+{
+  gint n = gimp_cage_config_get_n_points (config);
+  gint i;
+
+  data->config   = config;
+  data->buffer   = buffer;
+  data->format   = babl_format_n (babl_type ("float"), 2 * n);
+  data->n_points = n;
+  data->update   = (moved != NULL);
+
+  data->edges          = g_new (CageEdge, n);
+  data->changed_edge   = g_new (gboolean, n);
+  data->changed_vertex = g_new0 (gboolean, n);
+
+  g_object_get (buffer,
+                "tile-width",  &data->tile_width,
+                "tile-height", &data->tile_height,
+                NULL);
 
-  n_cage_vertices = gimp_cage_config_get_n_points (config);
+  for (i = 0; i < n; i++)
+    {
+      GimpCagePoint *p1 = &g_array_index (config->cage_points,
+                                          GimpCagePoint, i);
+      GimpCagePoint *p2 = &g_array_index (config->cage_points,
+                                          GimpCagePoint, (i + 1) % n);
+      CageEdge      *edge = &data->edges[i];
+
+      edge->v1   = p1->src_point;
+      edge->a.x  = p2->src_point.x - p1->src_point.x;
+      edge->a.y  = p2->src_point.y - p1->src_point.y;
+      edge->Q    = edge->a.x * edge->a.x + edge->a.y * edge->a.y;
+      edge->absa = sqrt (edge->Q);
+
+      data->changed_edge[i] = ! moved || moved[i] || moved[(i + 1) % n];
+    }
 
-  it = gegl_buffer_iterator_new (output, roi, 0, format,
-                                 GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE, 1);
+  /*  the vertex coefficients at both ends of a changed edge  */
+  for (i = 0; i < n; i++)
+    {
+      if (data->changed_edge[i])
+        {
+          data->changed_vertex[i]           = TRUE;
+          data->changed_vertex[(i + 1) % n] = TRUE;
+        }
+    }
+}
+
+static void
+gimp_operation_cage_coef_calc_data_clear (CalcData *data)
+{
+  g_free (data->edges);
+  g_free (data->changed_edge);
+  g_free (data->changed_vertex);
+}
+
+static gboolean
+gimp_operation_cage_coef_calc_rect_outside (CalcData            *data,
+                                            const GeglRectangle *rect)
+{
+  gdouble x1 = rect->x;
+  gdouble y1 = rect->y;
+  gdouble x2 = rect->x + rect->width;
+  gdouble y2 = rect->y + rect->height;
+  gint    i;
+
+  /*  the rectangle is outside of the cage if no edge crosses it, and
+   *  one of its pixels is outside
+   */
+  for (i = 0; i < data->n_points; i++)
+    {
+      const CageEdge *edge = &data->edges[i];
+      gdouble         t0   = 0.0;
+      gdouble         t1   = 1.0;
+      gdouble         p[4] = { -edge->a.x, edge->a.x, -edge->a.y, edge->a.y };
+      gdouble         q[4] = { edge->v1.x - x1, x2 - edge->v1.x,
+                               edge->v1.y - y1, y2 - edge->v1.y };
+      gint            k;
+
+      /*  clip the edge against the rectangle  */
+      for (k = 0; k < 4; k++)
+        {
+          if (p[k] == 0.0)
+            {
+              if (q[k] < 0.0)
+                break;
+            }
+          else
+            {
+              gdouble t = q[k] / p[k];
+
+              if (p[k] < 0.0)
+                t0 = MAX (t0, t);
+              else
+                t1 = MIN (t1, t);
+
+              if (t0 > t1)
+                break;
+            }
+        }
+
+      if (k == 4)
+        return FALSE;
+    }
+
+  return ! gimp_cage_config_point_inside (data->config, rect->x, rect->y);
+}
+
+static void
+gimp_operation_cage_coef_calc_area (const GeglRectangle *area,
+                                    CalcData            *data)
+{
+  GeglRectangle tile;
+  gint          tx, ty;
+
+  /*  leave the tiles that are entirely outside of the cage empty, so
+   *  that their memory is never allocated
+   */
+  for (ty = floor ((gdouble) area->y / data->tile_height) * data->tile_height;
+       ty < area->y + area->height;
+       ty += data->tile_height)
+    {
+      for (tx = floor ((gdouble) area->x / data->tile_width) * data->tile_width;
+           tx < area->x + area->width;
+           tx += data->tile_width)
+        {
+          if (! gegl_rectangle_intersect (&tile,
+                                          GEGL_RECTANGLE (tx, ty,
+                                                          data->tile_width,
+                                                          data->tile_height),
+                                          area))
+            {
+              continue;
+            }
+
+          if (gimp_operation_cage_coef_calc_rect_outside (data, &tile))
+            {
+              if (data->update)
+                gegl_buffer_clear (data->buffer, &tile);
+
+              continue;
+            }
+
+          gimp_operation_cage_coef_calc_tile (&tile, data);
+        }
+    }
+}
+
+static void
+gimp_operation_cage_coef_calc_tile (const GeglRectangle *rect,
+                                    CalcData            *data)
+{
+  GeglBufferIterator *it;
+  const gint          n = data->n_points;
+
+  it = gegl_buffer_iterator_new (data->buffer, rect, 0, data->format,
+                                 data->update ? GEGL_ACCESS_READWRITE :
+                                                GEGL_ACCESS_WRITE,
+                                 GEGL_ABYSS_NONE, 1);
 
   while (gegl_buffer_iterator_next (it))
     {
@@ -226,64 +510,48 @@ gimp_operation_cage_coef_calc_process (GeglOperation       *operation,
       gint    n_pixels = it->length;
       gint    x        = it->items[0].roi.x; /* initial x         */
       gint    y        = it->items[0].roi.y; /* and y coordinates */
-      gint    j;
 
-      memset (coef, 0, sizeof * coef * n_pixels * 2 * n_cage_vertices);
-      while(n_pixels--)
+      while (n_pixels--)
         {
-          if (gimp_cage_config_point_inside(config, x, y))
+          if (! gimp_cage_config_point_inside (data->config, x, y))
             {
-              last = &(g_array_index (config->cage_points, GimpCagePoint, 0));
+              memset (coef, 0, sizeof (gfloat) * 2 * n);
+            }
+          else
+            {
+              const gboolean *changed_edge   = data->changed_edge;
+              const gboolean *changed_vertex = data->changed_vertex;
+              gint            j;
 
-              for( j = 0; j < n_cage_vertices; j++)
+              if (data->update)
                 {
-                  GimpVector2 v1,v2,a,b,p;
-                  gdouble BA,SRT,L0,L1,A0,A1,A10,L10, Q,S,R, absa;
-
-                  current = &(g_array_index (config->cage_points, GimpCagePoint, (j+1) % n_cage_vertices));
-                  v1 = last->src_point;
-                  v2 = current->src_point;
-                  p.x = x;
-                  p.y = y;
-                  a.x = v2.x - v1.x;
-                  a.y = v2.y - v1.y;
-                  absa = gimp_vector2_length (&a);
-
-                  b.x = v1.x - x;
-                  b.y = v1.y - y;
-                  Q = a.x * a.x + a.y * a.y;
-                  S = b.x * b.x + b.y * b.y;
-                  R = 2.0 * (a.x * b.x + a.y * b.y);
-                  BA = b.x * a.y - b.y * a.x;
-                  SRT = sqrt(4.0 * S * Q - R * R);
-
-                  L0 = log(S);
-                  L1 = log(S + Q + R);
-                  A0 = atan2(R, SRT) / SRT;
-                  A1 = atan2(2.0 * Q + R, SRT) / SRT;
-                  A10 = A1 - A0;
-                  L10 = L1 - L0;
-
-                  /* edge coef */
-                  coef[j + n_cage_vertices] = (-absa / (4.0 * G_PI)) * ((4.0*S-(R*R)/Q) * A10 + (R / (2.0 * Q)) * L10 + L1 - 2.0);
-
-                  if (isnan(coef[j + n_cage_vertices]))
-                    {
-                      coef[j + n_cage_vertices] = 0.0;
-                    }
+                  gfloat sum = 0.0f;
+
+                  for (j = 0; j < n; j++)
+                    sum += coef[j];
 
-                  /* vertice coef */
-                  if (!gimp_operation_cage_coef_calc_is_on_straight (&v1, &v2, &p))
+                  /*  the pixel was outside of the old cage, compute all of
+                   *  its coefficients
+                   */
+                  if (sum == 0.0f)
                     {
-                      coef[j] += (BA / (2.0 * G_PI)) * (L10 /(2.0*Q) - A10 * (2.0 + R / Q));
-                      coef[(j+1)%n_cage_vertices] -= (BA / (2.0 * G_PI)) * (L10 / (2.0 * Q) - A10 * (R / Q));
+                      changed_edge   = NULL;
+                      changed_vertex = NULL;
                     }
-
-                  last = current;
                 }
+              else
+                {
+                  changed_edge   = NULL;
+                  changed_vertex = NULL;
+                }
+
+              gimp_operation_cage_coef_calc_pixel (data->edges, n, x, y,
+                                                   changed_edge,
+                                                   changed_vertex,
+                                                   coef);
             }
 
-          coef += 2 * n_cage_vertices;
+          coef += 2 * n;
 
           /* update x and y coordinates */
           x++;
@@ -294,6 +562,83 @@ gimp_operation_cage_coef_calc_process (GeglOperation       *operation,
             }
         }
     }
+}
 
-  return TRUE;
+/*  computes the Green coordinates of pixel (x, y).  if changed_edge and
+ *  changed_vertex are given, only the coefficients of the changed edges
+ *  and vertices are recomputed, and the others are kept.
+ */
+static void
+gimp_operation_cage_coef_calc_pixel (const CageEdge *edges,
+                                     gint            n,
+                                     gint            x,
+                                     gint            y,
+                                     const gboolean *changed_edge,
+                                     const gboolean *changed_vertex,
+                                     gfloat         *coef)
+{
+  gint j;
+
+  if (changed_vertex)
+    {
+      for (j = 0; j < n; j++)
+        {
+          if (changed_vertex[j])
+            coef[j] = 0.0f;
+        }
+    }
+  else
+    {
+      memset (coef, 0, sizeof (gfloat) * n);
+    }
+
+  for (j = 0; j < n; j++)
+    {
+      const CageEdge *edge = &edges[j];
+      gint            k    = (j + 1) % n;
+      GimpVector2     b;
+      gdouble         BA, SRT, L0, L1, A0, A1, A10, L10, Q, S, R;
+
+      if (changed_vertex && ! changed_vertex[j] && ! changed_vertex[k])
+        continue;
+
+      Q = edge->Q;
+
+      b.x = edge->v1.x - x;
+      b.y = edge->v1.y - y;
+      S = b.x * b.x + b.y * b.y;
+      R = 2.0 * (edge->a.x * b.x + edge->a.y * b.y);
+      BA = b.x * edge->a.y - b.y * edge->a.x;
+      SRT = sqrt (4.0 * S * Q - R * R);
+
+      L0 = log (S);
+      L1 = log (S + Q + R);
+      A0 = atan2 (R, SRT) / SRT;
+      A1 = atan2 (2.0 * Q + R, SRT) / SRT;
+      A10 = A1 - A0;
+      L10 = L1 - L0;
+
+      /* edge coef */
+      if (! changed_edge || changed_edge[j])
+        {
+          coef[j + n] = (-edge->absa / (4.0 * G_PI)) * ((4.0 * S - (R * R) / Q) * A10 + (R / (2.0 * Q)) * L10 + L1 - 2.0);
+
+          if (isnan (coef[j + n]))
+            {
+              coef[j + n] = 0.0;
+            }
+        }
+
+      /* vertice coef, unless the pixel is on the edge's straight line,
+       * that is, when the normalized b and a are collinear
+       */
+      if (! (fabs (BA) < 0.000000001 * edge->absa * sqrt (S)))
+        {
+          if (! changed_vertex || changed_vertex[j])
+            coef[j] += (BA / (2.0 * G_PI)) * (L10 / (2.0 * Q) - A10 * (2.0 + R / Q));
+
+          if (! changed_vertex || changed_vertex[k])
+            coef[k] -= (BA / (2.0 * G_PI)) * (L10 / (2.0 * Q) - A10 * (R / Q));
+        }
+    }
 }
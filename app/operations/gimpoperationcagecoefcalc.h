@@ -54,4 +54,8 @@ struct _GimpOperationCageCoefCalcClass
 };
 
 
-GType   gimp_operation_cage_coef_calc_get_type (void);
+GType      gimp_operation_cage_coef_calc_get_type (void);
+
+gboolean   gimp_operation_cage_coef_calc_update   (GimpCageConfig *config,
+                                                   GArray         *old_points,
+                                                   GeglBuffer     *coef);
@@ -56,7 +56,7 @@ gimp_operation_curves_class_init (GimpOperationCurvesClass *klass)
 {
   GObjectClass                  *object_class    = G_OBJECT_CLASS (klass);
   GeglOperationClass            *operation_class = GEGL_OPERATION_CLASS (klass);
-  GeglOperationPointFilterClass *point_class     = GEGL_OPERATION_POINT_FILTER_CLASS (klass);
+  GimpOperationPointFilterClass *filter_class    = GIMP_OPERATION_POINT_FILTER_CLASS (klass);
 
   object_class->set_property   = gimp_operation_point_filter_set_property;
   object_class->get_property   = gimp_operation_point_filter_get_property;
@@ -68,7 +68,7 @@ gimp_operation_curves_class_init (GimpOperationCurvesClass *klass)
                                  "description", _("Adjust color curves"),
                                  NULL);
 
-  point_class->process = gimp_operation_curves_process;
+  filter_class->process_separable = gimp_operation_curves_process;
 
   g_object_class_install_property (object_class,
                                    GIMP_OPERATION_POINT_FILTER_PROP_TRC,
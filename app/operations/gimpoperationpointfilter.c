@@ -20,6 +20,9 @@
 
 #include "config.h"
 
+#include <math.h>
+#include <string.h>
+
 #include <gegl.h>
 
 #include "operations-types.h"
@@ -27,8 +30,92 @@
 #include "gimpoperationpointfilter.h"
 
 
-static void   gimp_operation_point_filter_finalize (GObject       *object);
-static void   gimp_operation_point_filter_prepare  (GeglOperation *operation);
+/*  separable filters are applied through a lookup table, which maps the
+ *  input of the first filter of a chain to the output of the last one,
+ *  for each channel.
+ *
+ *  8-bit and 16-bit RGB inputs are read as they are, and the table holds
+ *  the result for each of their values.
+ *
+ *  float inputs in the [0, 1] range are looked up with linear
+ *  interpolation.  the table is indexed by the exponent and the top
+ *  LUT_BITS bits of the mantissa of the value, so that the segments get
+ *  shorter toward 0, where curves and gamma adjustments are the
+ *  steepest.  the midpoint of each segment is checked against the
+ *  filters when the table is built, and if the table can't reproduce
+ *  them to within LUT_MAX_ERROR (for example, because of the steps of
+ *  posterize), or for values outside of the table's range, the filters
+ *  are evaluated directly.
+ */
+#define LUT_BITS        9
+#define LUT_SHIFT       (23 - LUT_BITS)
+#define LUT_MIN_EXP     (-12)
+#define LUT_MIN_VALUE   (1.0f / (1 << -LUT_MIN_EXP))
+#define LUT_SIZE        (((-LUT_MIN_EXP) << LUT_BITS) + 2)
+#define LUT_MAX_ERROR   (1.0f / 65535.0f)
+
+#define CHAIN_SAMPLES   256
+
+#define IN_RANGE(value)       ((value) == 0.0f || \
+                               ((value) >= LUT_MIN_VALUE && (value) <= 1.0f))
+#define IN_RANGE_PIXEL(pixel) (IN_RANGE ((pixel)[RED])   && \
+                               IN_RANGE ((pixel)[GREEN]) && \
+                               IN_RANGE ((pixel)[BLUE])  && \
+                               IN_RANGE ((pixel)[ALPHA]))
+
+
+struct _GimpOperationPointFilterLut
+{
+  const Babl                *input_format;
+  const Babl                *output_format;
+
+  gint                       n_filters;
+  GimpOperationPointFilter **filters;
+  gint                      *stamps;
+  const Babl               **formats;
+  const Babl               **fishes;
+
+  gint                       n_codes; /* 0 for float inputs */
+  gfloat                    *table;
+  gfloat                     zero[4];
+};
+
+
+static void          gimp_operation_point_filter_finalize     (GObject                     *object);
+static void          gimp_operation_point_filter_notify       (GObject                     *object,
+                                                               GParamSpec                  *pspec);
+
+static void          gimp_operation_point_filter_prepare      (GeglOperation               *operation);
+static gboolean      gimp_operation_point_filter_process      (GeglOperation               *operation,
+                                                               void                        *in_buf,
+                                                               void                        *out_buf,
+                                                               glong                        samples,
+                                                               const GeglRectangle         *roi,
+                                                               gint                         level);
+
+static void          gimp_operation_point_filter_changed      (GimpOperationPointFilter    *self);
+static const Babl  * gimp_operation_point_filter_get_format   (GimpOperationPointFilter    *self,
+                                                               const Babl                  *space);
+static void          gimp_operation_point_filter_sync_lut     (GimpOperationPointFilter    *self,
+                                                               const Babl                  *input_format,
+                                                               const Babl                  *output_format);
+static void          gimp_operation_point_filter_clear_chain  (GimpOperationPointFilter    *self);
+
+static GimpOperationPointFilterLut *
+                     gimp_operation_point_filter_lut_new      (GimpOperationPointFilter    *filter,
+                                                               const Babl                  *input_format,
+                                                               const Babl                  *output_format);
+static void          gimp_operation_point_filter_lut_free     (GimpOperationPointFilterLut *lut);
+static gboolean      gimp_operation_point_filter_lut_is_valid (GimpOperationPointFilterLut *lut,
+                                                               GimpOperationPointFilter    *filter,
+                                                               const Babl                  *input_format,
+                                                               const Babl                  *output_format);
+static gboolean      gimp_operation_point_filter_lut_evaluate (GimpOperationPointFilterLut *lut,
+                                                               const gfloat                *src,
+                                                               gfloat                      *dest,
+                                                               glong                        samples,
+                                                               const GeglRectangle         *roi,
+                                                               gint                         level);
 
 
 G_DEFINE_ABSTRACT_TYPE (GimpOperationPointFilter, gimp_operation_point_filter,
@@ -40,12 +127,18 @@ G_DEFINE_ABSTRACT_TYPE (GimpOperationPointFilter, gimp_operation_point_filter,
 static void
 gimp_operation_point_filter_class_init (GimpOperationPointFilterClass *klass)
 {
-  GObjectClass        *object_class = G_OBJECT_CLASS (klass);
-  GeglOperationClass  *operation_class = GEGL_OPERATION_CLASS (klass);
+  GObjectClass                  *object_class    = G_OBJECT_CLASS (klass);
+  GeglOperationClass            *operation_class = GEGL_OPERATION_CLASS (klass);
+  GeglOperationPointFilterClass *point_class     = GEGL_OPERATION_POINT_FILTER_CLASS (klass);
 
-  object_class->finalize = gimp_operation_point_filter_finalize;
+  object_class->finalize   = gimp_operation_point_filter_finalize;
+  object_class->notify     = gimp_operation_point_filter_notify;
 
   operation_class->prepare = gimp_operation_point_filter_prepare;
+
+  point_class->process     = gimp_operation_point_filter_process;
+
+  klass->process_separable = NULL;
 }
 
 static void
@@ -53,6 +146,8 @@ gimp_operation_point_filter_init (GimpOperationPointFilter *self)
 {
   self->trc_binding = NULL;
   self->trc         = GIMP_TRC_LINEAR;
+
+  g_rw_lock_init (&self->lut_lock);
 }
 
 static void
@@ -60,11 +155,26 @@ gimp_operation_point_filter_finalize (GObject *object)
 {
   GimpOperationPointFilter *self = GIMP_OPERATION_POINT_FILTER (object);
 
+  gimp_operation_point_filter_clear_chain (self);
+
+  g_clear_pointer (&self->lut, gimp_operation_point_filter_lut_free);
+  g_rw_lock_clear (&self->lut_lock);
+
   g_clear_object (&self->config);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
+static void
+gimp_operation_point_filter_notify (GObject    *object,
+                                    GParamSpec *pspec)
+{
+  gimp_operation_point_filter_changed (GIMP_OPERATION_POINT_FILTER (object));
+
+  if (G_OBJECT_CLASS (parent_class)->notify)
+    G_OBJECT_CLASS (parent_class)->notify (object, pspec);
+}
+
 void
 gimp_operation_point_filter_get_property (GObject    *object,
                                           guint       property_id,
@@ -105,7 +215,15 @@ gimp_operation_point_filter_set_property (GObject      *object,
 
     case GIMP_OPERATION_POINT_FILTER_PROP_CONFIG:
       g_clear_object (&self->trc_binding);
+      if (self->config)
+        g_signal_handlers_disconnect_by_func (self->config,
+                                              gimp_operation_point_filter_changed,
+                                              self);
       g_set_object (&self->config, g_value_dup_object (value));
+      if (self->config)
+        g_signal_connect_object (self->config, "notify",
+                                 G_CALLBACK (gimp_operation_point_filter_changed),
+                                 self, G_CONNECT_SWAPPED);
       if (self->config                                                    &&
           g_object_class_find_property (G_OBJECT_GET_CLASS (self), "trc") &&
           g_object_class_find_property (G_OBJECT_GET_CLASS (self->config), "trc"))
@@ -123,27 +241,582 @@ gimp_operation_point_filter_set_property (GObject      *object,
 static void
 gimp_operation_point_filter_prepare (GeglOperation *operation)
 {
-  GimpOperationPointFilter *self = GIMP_OPERATION_POINT_FILTER (operation);
-  const Babl               *space = gegl_operation_get_source_space (operation,
-                                                                     "input");
-  const Babl               *format;
+  GimpOperationPointFilter      *self  = GIMP_OPERATION_POINT_FILTER (operation);
+  GimpOperationPointFilterClass *klass = GIMP_OPERATION_POINT_FILTER_GET_CLASS (self);
+  const Babl                    *space;
+  const Babl                    *input_format;
+  const Babl                    *output_format;
+
+  space = gegl_operation_get_source_space (operation, "input");
+
+  input_format  = gimp_operation_point_filter_get_format (self, space);
+  output_format = input_format;
+
+  if (klass->process_separable)
+    {
+      const Babl *source_format;
+      GList      *last;
+
+      source_format = gegl_operation_get_source_format (operation, "input");
+
+      /*  read 8-bit and 16-bit RGB input as it is, instead of converting
+       *  it to float first
+       */
+      if (source_format &&
+          (babl_format_get_type (source_format, 0) == babl_type ("u8") ||
+           babl_format_get_type (source_format, 0) == babl_type ("u16")))
+        {
+          const gchar *model;
+
+          model = babl_get_name (babl_format_get_model (source_format));
+
+          if (! strcmp (model, "RGB")     ||
+              ! strcmp (model, "R'G'B'")  ||
+              ! strcmp (model, "R~G~B~")  ||
+              ! strcmp (model, "RGBA")    ||
+              ! strcmp (model, "R'G'B'A") ||
+              ! strcmp (model, "R~G~B~A"))
+            {
+              input_format = source_format;
+            }
+        }
+
+      last = g_list_last (self->chain);
+
+      if (last)
+        output_format = gimp_operation_point_filter_get_format (last->data,
+                                                                space);
+
+      gimp_operation_point_filter_sync_lut (self, input_format, output_format);
+    }
+
+  gegl_operation_set_format (operation, "input",  input_format);
+  gegl_operation_set_format (operation, "output", output_format);
+}
+
+static gboolean
+gimp_operation_point_filter_process (GeglOperation       *operation,
+                                     void                *in_buf,
+                                     void                *out_buf,
+                                     glong                samples,
+                                     const GeglRectangle *roi,
+                                     gint                 level)
+{
+  GimpOperationPointFilter    *self    = GIMP_OPERATION_POINT_FILTER (operation);
+  GimpOperationPointFilterLut *lut;
+  gboolean                     success = FALSE;
+
+  g_rw_lock_reader_lock (&self->lut_lock);
+
+  lut = self->lut;
+
+  if (! lut)
+    {
+      /*  prepare() didn't run for this filter  */
+    }
+  else if (lut->n_codes == 1 << 8 && lut->table)
+    {
+      const guint8 *src       = in_buf;
+      gfloat       *dest      = out_buf;
+      const gfloat *table     = lut->table;
+      gboolean      has_alpha = babl_format_has_alpha (lut->input_format);
+      gfloat        alpha     = table[3 << 8];
+
+      while (samples--)
+        {
+          dest[RED]   = table[(0 << 8) + *src++];
+          dest[GREEN] = table[(1 << 8) + *src++];
+          dest[BLUE]  = table[(2 << 8) + *src++];
+          dest[ALPHA] = has_alpha ? table[(3 << 8) + *src++] : alpha;
+
+          dest += 4;
+        }
+
+      success = TRUE;
+    }
+  else if (lut->n_codes == 1 << 16 && lut->table)
+    {
+      const guint16 *src       = in_buf;
+      gfloat        *dest      = out_buf;
+      const gfloat  *table     = lut->table;
+      gboolean       has_alpha = babl_format_has_alpha (lut->input_format);
+      gfloat         alpha     = table[3 << 16];
+
+      while (samples--)
+        {
+          dest[RED]   = table[(0 << 16) + *src++];
+          dest[GREEN] = table[(1 << 16) + *src++];
+          dest[BLUE]  = table[(2 << 16) + *src++];
+          dest[ALPHA] = has_alpha ? table[(3 << 16) + *src++] : alpha;
+
+          dest += 4;
+        }
+
+      success = TRUE;
+    }
+  else if (lut->n_codes == 0)
+    {
+      const gfloat *src  = in_buf;
+      gfloat       *dest = out_buf;
+
+      success = TRUE;
+
+      while (success && samples > 0)
+        {
+          glong n;
+
+          /*  look up the pixels which are within the table's range...  */
+          for (n = 0;
+               lut->table && n < samples && IN_RANGE_PIXEL (src + 4 * n);
+               n++)
+            {
+              gint c;
+
+              for (c = 0; c < 4; c++)
+                {
+                  const gfloat *table = lut->table + c * LUT_SIZE;
+                  gfloat        value = src[4 * n + c];
+
+                  if (value != 0.0f)
+                    {
+                      union { gfloat f; guint32 i; } u = { value };
+                      guint32 index;
+                      gfloat  frac;
+
+                      index = (u.i >> LUT_SHIFT) -
+                              ((guint32) (127 + LUT_MIN_EXP) << LUT_BITS);
+                      frac  = (gfloat) (u.i & ((1 << LUT_SHIFT) - 1)) *
+                              (1.0f / (1 << LUT_SHIFT));
+
+                      value = table[index] +
+                              frac * (table[index + 1] - table[index]);
+                    }
+                  else
+                    {
+                      value = lut->zero[c];
+                    }
+
+                  dest[4 * n + c] = value;
+                }
+            }
+
+          src     += 4 * n;
+          dest    += 4 * n;
+          samples -= n;
+
+          /*  ...and evaluate the filters for the rest  */
+          for (n = 0;
+               n < samples && ! (lut->table && IN_RANGE_PIXEL (src + 4 * n));
+               n++);
+
+          if (n > 0)
+            {
+              success = gimp_operation_point_filter_lut_evaluate (lut,
+                                                                  src, dest, n,
+                                                                  roi, level);
+
+              src     += 4 * n;
+              dest    += 4 * n;
+              samples -= n;
+            }
+        }
+    }
+
+  g_rw_lock_reader_unlock (&self->lut_lock);
+
+  return success;
+}
+
+
+/*  private functions  */
+
+static void
+gimp_operation_point_filter_changed (GimpOperationPointFilter *self)
+{
+  g_atomic_int_inc (&self->stamp);
+
+  /*  the filter is applied by the head of its chain, which has to be
+   *  processed again
+   */
+  if (self->chain_head)
+    gegl_operation_invalidate (GEGL_OPERATION (self->chain_head), NULL, TRUE);
+}
 
+static const Babl *
+gimp_operation_point_filter_get_format (GimpOperationPointFilter *self,
+                                        const Babl               *space)
+{
   switch (self->trc)
     {
     default:
     case GIMP_TRC_LINEAR:
-      format = babl_format_with_space ("RGBA float", space);
-      break;
+      return babl_format_with_space ("RGBA float", space);
 
     case GIMP_TRC_NON_LINEAR:
-      format = babl_format_with_space ("R'G'B'A float", space);
-      break;
+      return babl_format_with_space ("R'G'B'A float", space);
 
     case GIMP_TRC_PERCEPTUAL:
-      format = babl_format_with_space ("R~G~B~A float", space);
-      break;
+      return babl_format_with_space ("R~G~B~A float", space);
     }
+}
+
+static void
+gimp_operation_point_filter_sync_lut (GimpOperationPointFilter *self,
+                                      const Babl               *input_format,
+                                      const Babl               *output_format)
+{
+  gboolean valid;
+
+  g_rw_lock_reader_lock (&self->lut_lock);
+
+  valid = gimp_operation_point_filter_lut_is_valid (self->lut, self,
+                                                    input_format,
+                                                    output_format);
+
+  g_rw_lock_reader_unlock (&self->lut_lock);
+
+  if (! valid)
+    {
+      g_rw_lock_writer_lock (&self->lut_lock);
+
+      if (! gimp_operation_point_filter_lut_is_valid (self->lut, self,
+                                                      input_format,
+                                                      output_format))
+        {
+          g_clear_pointer (&self->lut, gimp_operation_point_filter_lut_free);
+
+          self->lut = gimp_operation_point_filter_lut_new (self,
+                                                           input_format,
+                                                           output_format);
+        }
+
+      g_rw_lock_writer_unlock (&self->lut_lock);
+    }
+}
+
+static void
+gimp_operation_point_filter_clear_chain (GimpOperationPointFilter *self)
+{
+  GList *list;
+
+  for (list = self->chain; list; list = g_list_next (list))
+    {
+      GimpOperationPointFilter *filter = list->data;
+
+      if (filter->chain_head == self)
+        filter->chain_head = NULL;
+    }
+
+  g_list_free_full (self->chain, g_object_unref);
+  self->chain = NULL;
+}
+
+static GimpOperationPointFilterLut *
+gimp_operation_point_filter_lut_new (GimpOperationPointFilter *filter,
+                                     const Babl               *input_format,
+                                     const Babl               *output_format)
+{
+  GimpOperationPointFilterLut *lut   = g_new0 (GimpOperationPointFilterLut, 1);
+  const Babl                  *space = babl_format_get_space (output_format);
+  const Babl                  *type  = babl_format_get_type (input_format, 0);
+  GeglRectangle                roi;
+  GList                       *list;
+  gfloat                      *src;
+  gfloat                      *dest;
+  gint                         n;
+  gint                         i;
+  gint                         c;
+
+  lut->input_format  = input_format;
+  lut->output_format = output_format;
+
+  lut->n_filters = 1 + g_list_length (filter->chain);
+  lut->filters   = g_new  (GimpOperationPointFilter *, lut->n_filters);
+  lut->stamps    = g_new  (gint,                       lut->n_filters);
+  lut->formats   = g_new  (const Babl *,               lut->n_filters);
+  lut->fishes    = g_new0 (const Babl *,               lut->n_filters);
+
+  lut->filters[0] = filter;
+
+  for (list = filter->chain, i = 1; list; list = g_list_next (list), i++)
+    lut->filters[i] = list->data;
+
+  for (i = 0; i < lut->n_filters; i++)
+    {
+      lut->stamps[i]  = g_atomic_int_get (&lut->filters[i]->stamp);
+      lut->formats[i] = gimp_operation_point_filter_get_format (lut->filters[i],
+                                                                space);
+
+      if (i > 0)
+        lut->fishes[i - 1] = babl_fish (lut->formats[i - 1], lut->formats[i]);
+    }
+
+  if (type == babl_type ("u8"))
+    lut->n_codes = 1 << 8;
+  else if (type == babl_type ("u16"))
+    lut->n_codes = 1 << 16;
+
+  if (lut->n_codes)
+    {
+      gint     n_components = babl_format_get_n_components (input_format);
+      gpointer codes;
+
+      n = lut->n_codes;
+
+      codes = g_malloc (n * babl_format_get_bytes_per_pixel (input_format));
+
+      for (i = 0; i < n; i++)
+        {
+          for (c = 0; c < n_components; c++)
+            {
+              if (n == 1 << 8)
+                ((guint8 *)  codes)[i * n_components + c] = i;
+              else
+                ((guint16 *) codes)[i * n_components + c] = i;
+            }
+        }
+
+      src  = g_new (gfloat, 4 * n);
+      dest = g_new (gfloat, 4 * n);
+
+      babl_process (babl_fish (input_format, lut->formats[0]), codes, src, n);
+
+      g_free (codes);
+    }
+  else
+    {
+      /*  0, the table entries, and the midpoints of the segments
+       *  between them
+       */
+      n = 2 * LUT_SIZE - 1;
+
+      src  = g_new (gfloat, 4 * n);
+      dest = g_new (gfloat, 4 * n);
+
+      for (i = 0; i < n; i++)
+        {
+          gdouble mantissa;
+          gint    j;
+
+          if (i == 0)
+            {
+              for (c = 0; c < 4; c++)
+                src[c] = 0.0f;
+
+              continue;
+            }
+          else if (i <= LUT_SIZE)
+            {
+              j        = i - 1;
+              mantissa = j & ((1 << LUT_BITS) - 1);
+            }
+          else
+            {
+              j        = i - (LUT_SIZE + 1);
+              mantissa = (j & ((1 << LUT_BITS) - 1)) + 0.5;
+            }
+
+          for (c = 0; c < 4; c++)
+            {
+              src[4 * i + c] = ldexp (1.0 + mantissa / (1 << LUT_BITS),
+                                      LUT_MIN_EXP + (j >> LUT_BITS));
+            }
+        }
+    }
+
+  roi.x      = 0;
+  roi.y      = 0;
+  roi.width  = n;
+  roi.height = 1;
+
+  if (gimp_operation_point_filter_lut_evaluate (lut, src, dest, n, &roi, 0))
+    {
+      if (lut->n_codes)
+        {
+          lut->table = g_new (gfloat, 4 * n);
+
+          for (i = 0; i < n; i++)
+            {
+              for (c = 0; c < 4; c++)
+                lut->table[c * n + i] = dest[4 * i + c];
+            }
+        }
+      else
+        {
+          gboolean accurate = TRUE;
+
+          lut->table = g_new (gfloat, 4 * LUT_SIZE);
+
+          for (c = 0; c < 4; c++)
+            {
+              gfloat *table    = lut->table + c * LUT_SIZE;
+              gfloat *midpoint = dest + 4 * (LUT_SIZE + 1) + c;
+
+              lut->zero[c] = dest[c];
+
+              for (i = 0; i < LUT_SIZE; i++)
+                table[i] = dest[4 * (i + 1) + c];
+
+              for (i = 0; accurate && i < LUT_SIZE - 2; i++)
+                {
+                  gfloat error = fabsf (midpoint[4 * i] -
+                                        (table[i] + table[i + 1]) / 2.0f);
+
+                  if (! (error <= LUT_MAX_ERROR))
+                    accurate = FALSE;
+                }
+            }
+
+          if (! accurate)
+            g_clear_pointer (&lut->table, g_free);
+        }
+    }
+
+  g_free (src);
+  g_free (dest);
+
+  return lut;
+}
+
+static void
+gimp_operation_point_filter_lut_free (GimpOperationPointFilterLut *lut)
+{
+  g_free (lut->filters);
+  g_free (lut->stamps);
+  g_free (lut->formats);
+  g_free (lut->fishes);
+  g_free (lut->table);
+
+  g_free (lut);
+}
+
+static gboolean
+gimp_operation_point_filter_lut_is_valid (GimpOperationPointFilterLut *lut,
+                                          GimpOperationPointFilter    *filter,
+                                          const Babl                  *input_format,
+                                          const Babl                  *output_format)
+{
+  GList *list;
+  gint   i;
+
+  if (! lut                                ||
+      lut->input_format  != input_format   ||
+      lut->output_format != output_format  ||
+      lut->n_filters     != 1 + g_list_length (filter->chain))
+    {
+      return FALSE;
+    }
+
+  for (list = filter->chain, i = 1; list; list = g_list_next (list), i++)
+    {
+      if (lut->filters[i] != list->data)
+        return FALSE;
+    }
+
+  for (i = 0; i < lut->n_filters; i++)
+    {
+      if (lut->stamps[i] != g_atomic_int_get (&lut->filters[i]->stamp))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static gboolean
+gimp_operation_point_filter_lut_evaluate (GimpOperationPointFilterLut *lut,
+                                          const gfloat                *src,
+                                          gfloat                      *dest,
+                                          glong                        samples,
+                                          const GeglRectangle         *roi,
+                                          gint                         level)
+{
+  gfloat temp[4 * CHAIN_SAMPLES];
+
+  while (samples > 0)
+    {
+      glong n = MIN (samples, CHAIN_SAMPLES);
+      gint  i;
+
+      for (i = 0; i < lut->n_filters; i++)
+        {
+          GimpOperationPointFilter      *filter = lut->filters[i];
+          GimpOperationPointFilterClass *klass;
+
+          klass = GIMP_OPERATION_POINT_FILTER_GET_CLASS (filter);
+
+          if (i > 0)
+            babl_process (lut->fishes[i - 1], dest, temp, n);
+
+          if (! klass->process_separable (GEGL_OPERATION (filter),
+                                          i > 0 ? temp : (gpointer) src, dest,
+                                          n, roi, level))
+            {
+              return FALSE;
+            }
+        }
+
+      src     += 4 * n;
+      dest    += 4 * n;
+      samples -= n;
+    }
+
+  return TRUE;
+}
+
+
+/*  public functions  */
+
+gboolean
+gimp_operation_point_filter_is_separable (GimpOperationPointFilter *filter)
+{
+  g_return_val_if_fail (GIMP_IS_OPERATION_POINT_FILTER (filter), FALSE);
+
+  return GIMP_OPERATION_POINT_FILTER_GET_CLASS (filter)->process_separable != NULL;
+}
+
+/*  makes @filter apply the separable filters of @chain after itself,
+ *  through a single lookup table.  the filters of @chain are no longer
+ *  applied by their own nodes, which should be bypassed.
+ */
+void
+gimp_operation_point_filter_set_chain (GimpOperationPointFilter *filter,
+                                       GList                    *chain)
+{
+  GList *list;
+  GList *iter;
+
+  g_return_if_fail (GIMP_IS_OPERATION_POINT_FILTER (filter));
+  g_return_if_fail (chain == NULL ||
+                    gimp_operation_point_filter_is_separable (filter));
+
+  for (list = chain, iter = filter->chain;
+       list && iter && list->data == iter->data;
+       list = g_list_next (list), iter = g_list_next (iter));
+
+  if (! list && ! iter)
+    return;
+
+  g_rw_lock_writer_lock (&filter->lut_lock);
+
+  gimp_operation_point_filter_clear_chain (filter);
+
+  for (list = chain; list; list = g_list_next (list))
+    {
+      GimpOperationPointFilter *link = list->data;
+
+      if (gimp_operation_point_filter_is_separable (link))
+        {
+          filter->chain = g_list_prepend (filter->chain, g_object_ref (link));
+
+          link->chain_head = filter;
+        }
+    }
+
+  filter->chain = g_list_reverse (filter->chain);
+
+  g_clear_pointer (&filter->lut, gimp_operation_point_filter_lut_free);
+
+  g_rw_lock_writer_unlock (&filter->lut_lock);
 
-  gegl_operation_set_format (operation, "input",  format);
-  gegl_operation_set_format (operation, "output", format);
+  gegl_operation_invalidate (GEGL_OPERATION (filter), NULL, TRUE);
 }
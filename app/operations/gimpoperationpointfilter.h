@@ -41,30 +41,55 @@ enum
 
 
 typedef struct _GimpOperationPointFilterClass GimpOperationPointFilterClass;
+typedef struct _GimpOperationPointFilterLut   GimpOperationPointFilterLut;
 
 struct _GimpOperationPointFilter
 {
-  GeglOperationPointFilter  parent_instance;
+  GeglOperationPointFilter     parent_instance;
 
-  GimpTRCType               trc;
-  GObject                  *config;
+  GimpTRCType                  trc;
+  GObject                     *config;
 
-  GBinding                 *trc_binding;
+  GBinding                    *trc_binding;
+
+  gint                         stamp;
+
+  GList                       *chain;
+  GimpOperationPointFilter    *chain_head;
+
+  GimpOperationPointFilterLut *lut;
+  GRWLock                      lut_lock;
 };
 
 struct _GimpOperationPointFilterClass
 {
   GeglOperationPointFilterClass  parent_class;
+
+  /*  filters which process each channel independently of the others
+   *  implement process_separable() instead of the point filter's
+   *  process().  such filters are applied through a lookup table, and
+   *  can be chained with other such filters.
+   */
+  gboolean (* process_separable) (GeglOperation       *operation,
+                                  void                *in_buf,
+                                  void                *out_buf,
+                                  glong                samples,
+                                  const GeglRectangle *roi,
+                                  gint                 level);
 };
 
 
-GType   gimp_operation_point_filter_get_type     (void);
+GType      gimp_operation_point_filter_get_type      (void);
+
+void       gimp_operation_point_filter_get_property  (GObject                  *object,
+                                                      guint                     property_id,
+                                                      GValue                   *value,
+                                                      GParamSpec               *pspec);
+void       gimp_operation_point_filter_set_property  (GObject                  *object,
+                                                      guint                     property_id,
+                                                      const GValue             *value,
+                                                      GParamSpec               *pspec);
 
-void    gimp_operation_point_filter_get_property (GObject      *object,
-                                                  guint         property_id,
-                                                  GValue       *value,
-                                                  GParamSpec   *pspec);
-void    gimp_operation_point_filter_set_property (GObject      *object,
-                                                  guint         property_id,
-                                                  const GValue *value,
-                                                  GParamSpec   *pspec);
+gboolean   gimp_operation_point_filter_is_separable  (GimpOperationPointFilter *filter);
+void       gimp_operation_point_filter_set_chain     (GimpOperationPointFilter *filter,
+                                                      GList                    *chain);
@@ -51,8 +51,6 @@ static void     gimp_operation_posterize_set_property (GObject             *obje
                                                        const GValue        *value,
                                                        GParamSpec          *pspec);
 
-static void gimp_operation_posterize_prepare (GeglOperation *operation);
-
 static gboolean gimp_operation_posterize_process      (GeglOperation       *operation,
                                                        void                *in_buf,
                                                        void                *out_buf,
@@ -72,12 +70,11 @@ gimp_operation_posterize_class_init (GimpOperationPosterizeClass *klass)
 {
   GObjectClass                  *object_class    = G_OBJECT_CLASS (klass);
   GeglOperationClass            *operation_class = GEGL_OPERATION_CLASS (klass);
-  GeglOperationPointFilterClass *point_class     = GEGL_OPERATION_POINT_FILTER_CLASS (klass);
+  GimpOperationPointFilterClass *filter_class    = GIMP_OPERATION_POINT_FILTER_CLASS (klass);
 
-  object_class->set_property = gimp_operation_posterize_set_property;
-  object_class->get_property = gimp_operation_posterize_get_property;
-  operation_class->prepare   = gimp_operation_posterize_prepare;
-  point_class->process       = gimp_operation_posterize_process;
+  object_class->set_property      = gimp_operation_posterize_set_property;
+  object_class->get_property      = gimp_operation_posterize_get_property;
+  filter_class->process_separable = gimp_operation_posterize_process;
 
   gegl_operation_class_set_keys (operation_class,
                                  "name",        "gimp:posterize",
@@ -97,6 +94,7 @@ gimp_operation_posterize_class_init (GimpOperationPosterizeClass *klass)
 static void
 gimp_operation_posterize_init (GimpOperationPosterize *self)
 {
+  GIMP_OPERATION_POINT_FILTER (self)->trc = GIMP_TRC_PERCEPTUAL;
 }
 
 static void
@@ -139,16 +137,6 @@ gimp_operation_posterize_set_property (GObject      *object,
     }
 }
 
-static void
-gimp_operation_posterize_prepare (GeglOperation *operation)
-{
-  const Babl *format = babl_format_with_space ("R~G~B~A float",
-                                               gegl_operation_get_format (operation, "input"));
-
-  gegl_operation_set_format (operation, "input", format);
-  gegl_operation_set_format (operation, "output", format);
-}
-
 
 static gboolean
 gimp_operation_posterize_process (GeglOperation       *operation,
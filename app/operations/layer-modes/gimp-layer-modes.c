@@ -24,6 +24,8 @@
 #include <glib-object.h>
 #include <gegl.h>
 
+#include "libgimpbase/gimpbase.h"
+
 #include "../operations-types.h"
 
 #include "gegl/gimp-babl.h"
@@ -1337,10 +1339,16 @@ gimp_layer_mode_get_operation (GimpLayerMode mode)
       if (GIMP_IS_OPERATION_LAYER_MODE (operation))
         {
           GimpOperationLayerMode *layer_mode = GIMP_OPERATION_LAYER_MODE (operation);
+          GimpLayerModeBlendFunc  blend_function;
+
+          blend_function = gimp_layer_mode_get_blend_function (mode);
+          blend_function =
+            gimp_operation_layer_mode_blend_get_accelerated (blend_function,
+                                                             gimp_cpu_accel_get_support ());
 
           layer_mode->layer_mode      = mode;
           layer_mode->function        = GIMP_OPERATION_LAYER_MODE_GET_CLASS (operation)->process;
-          layer_mode->blend_function  = gimp_layer_mode_get_blend_function (mode);
+          layer_mode->blend_function  = blend_function;
           layer_mode->blend_space     = gimp_layer_mode_get_blend_space (mode);
           layer_mode->composite_space = gimp_layer_mode_get_composite_space (mode);
           layer_mode->composite_mode  = gimp_layer_mode_get_paint_composite_mode (mode);
@@ -0,0 +1,375 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimpoperationlayermode-blend-avx2.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gegl-plugin.h>
+#include <cairo.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "libgimpbase/gimpbase.h"
+
+#include "../operations-types.h"
+
+#include "gimpoperationlayermode-blend.h"
+
+
+#if COMPILE_AVX2_INTRINISICS
+
+/* AVX2 */
+#include <immintrin.h>
+
+
+#define EPSILON      1e-6f
+
+#define SAFE_DIV_MIN EPSILON
+#define SAFE_DIV_MAX (1.0f / SAFE_DIV_MIN)
+
+
+/*  these are vector versions of the separable blend functions in
+ *  gimpoperationlayermode-blend.c.  the kernels are applied to all
+ *  components of two pixels at a time, and the blend function then swaps
+ *  in the layers' alpha.  since the color components of pixels whose input or
+ *  layer alpha is zero are unconstrained, these pixels are blended like
+ *  any other, instead of being skipped.
+ *
+ *  each kernel follows the order of operations of its scalar
+ *  counterpart, so that both produce the same results.
+ */
+
+
+static inline __v8sf
+v_abs (__v8sf x)
+{
+  return _mm256_andnot_ps (_mm256_set1_ps (-0.0f), x);
+}
+
+/* see safe_div() in gimpoperationlayermode-blend.c */
+static inline __v8sf
+v_safe_div (__v8sf a,
+            __v8sf b)
+{
+  __v8sf result;
+
+  result = a / b;
+  result = _mm256_max_ps (result, _mm256_set1_ps (-SAFE_DIV_MAX));
+  result = _mm256_min_ps (result, _mm256_set1_ps (SAFE_DIV_MAX));
+
+  return _mm256_and_ps (result,
+                        _mm256_cmp_ps (v_abs (a), _mm256_set1_ps (SAFE_DIV_MIN),
+                                       _CMP_GT_OQ));
+}
+
+static inline __v8sf
+blend_addition (__v8sf in,
+                __v8sf layer)
+{
+  return in + layer;
+}
+
+static inline __v8sf
+blend_burn (__v8sf in,
+            __v8sf layer)
+{
+  const __v8sf one = _mm256_set1_ps (1.0f);
+
+  return one - v_safe_div (one - in, layer);
+}
+
+static inline __v8sf
+blend_darken_only (__v8sf in,
+                   __v8sf layer)
+{
+  return _mm256_min_ps (in, layer);
+}
+
+static inline __v8sf
+blend_difference (__v8sf in,
+                  __v8sf layer)
+{
+  return v_abs (in - layer);
+}
+
+static inline __v8sf
+blend_divide (__v8sf in,
+              __v8sf layer)
+{
+  return v_safe_div (in, layer);
+}
+
+static inline __v8sf
+blend_dodge (__v8sf in,
+             __v8sf layer)
+{
+  return v_safe_div (in, _mm256_set1_ps (1.0f) - layer);
+}
+
+static inline __v8sf
+blend_exclusion (__v8sf in,
+                 __v8sf layer)
+{
+  const __v8sf half = _mm256_set1_ps (0.5f);
+
+  return half - _mm256_set1_ps (2.0f) * (in - half) * (layer - half);
+}
+
+static inline __v8sf
+blend_grain_extract (__v8sf in,
+                     __v8sf layer)
+{
+  return in - layer + _mm256_set1_ps (0.5f);
+}
+
+static inline __v8sf
+blend_grain_merge (__v8sf in,
+                   __v8sf layer)
+{
+  return in + layer - _mm256_set1_ps (0.5f);
+}
+
+static inline __v8sf
+blend_hard_mix (__v8sf in,
+                __v8sf layer)
+{
+  const __v8sf one = _mm256_set1_ps (1.0f);
+
+  return _mm256_and_ps (_mm256_cmp_ps (in + layer, one, _CMP_NLT_UQ), one);
+}
+
+static inline __v8sf
+blend_hardlight (__v8sf in,
+                 __v8sf layer)
+{
+  const __v8sf one  = _mm256_set1_ps (1.0f);
+  const __v8sf two  = _mm256_set1_ps (2.0f);
+  const __v8sf half = _mm256_set1_ps (0.5f);
+  __v8sf       light;
+  __v8sf       dark;
+
+  light = (one - in) * (one - (layer - half) * two);
+  light = _mm256_min_ps (one - light, one);
+
+  dark  = in * (layer * two);
+  dark  = _mm256_min_ps (dark, one);
+
+  return _mm256_blendv_ps (dark, light,
+                           _mm256_cmp_ps (layer, half, _CMP_GT_OQ));
+}
+
+static inline __v8sf
+blend_lighten_only (__v8sf in,
+                    __v8sf layer)
+{
+  return _mm256_max_ps (in, layer);
+}
+
+static inline __v8sf
+blend_linear_burn (__v8sf in,
+                   __v8sf layer)
+{
+  return in + layer - _mm256_set1_ps (1.0f);
+}
+
+static inline __v8sf
+blend_linear_light (__v8sf in,
+                    __v8sf layer)
+{
+  const __v8sf two  = _mm256_set1_ps (2.0f);
+  const __v8sf half = _mm256_set1_ps (0.5f);
+
+  return _mm256_blendv_ps (in + two * (layer - half),
+                           in + two * layer - _mm256_set1_ps (1.0f),
+                           _mm256_cmp_ps (layer, half, _CMP_LE_OQ));
+}
+
+static inline __v8sf
+blend_multiply (__v8sf in,
+                __v8sf layer)
+{
+  return in * layer;
+}
+
+static inline __v8sf
+blend_overlay (__v8sf in,
+               __v8sf layer)
+{
+  const __v8sf one = _mm256_set1_ps (1.0f);
+  const __v8sf two = _mm256_set1_ps (2.0f);
+
+  return _mm256_blendv_ps (one - two * (one - layer) * (one - in),
+                           two * in * layer,
+                           _mm256_cmp_ps (in, _mm256_set1_ps (0.5f),
+                                          _CMP_LT_OQ));
+}
+
+static inline __v8sf
+blend_pin_light (__v8sf in,
+                 __v8sf layer)
+{
+  const __v8sf two  = _mm256_set1_ps (2.0f);
+  const __v8sf half = _mm256_set1_ps (0.5f);
+
+  return _mm256_blendv_ps (_mm256_min_ps (in, two * layer),
+                           _mm256_max_ps (in, two * (layer - half)),
+                           _mm256_cmp_ps (layer, half, _CMP_GT_OQ));
+}
+
+static inline __v8sf
+blend_screen (__v8sf in,
+              __v8sf layer)
+{
+  const __v8sf one = _mm256_set1_ps (1.0f);
+
+  return one - (one - in) * (one - layer);
+}
+
+static inline __v8sf
+blend_softlight (__v8sf in,
+                 __v8sf layer)
+{
+  const __v8sf one = _mm256_set1_ps (1.0f);
+  __v8sf       multiply;
+  __v8sf       screen;
+
+  multiply = in * layer;
+  screen   = one - (one - in) * (one - layer);
+
+  return (one - in) * multiply + in * screen;
+}
+
+static inline __v8sf
+blend_subtract (__v8sf in,
+                __v8sf layer)
+{
+  return in - layer;
+}
+
+static inline __v8sf
+blend_vivid_light (__v8sf in,
+                   __v8sf layer)
+{
+  const __v8sf one = _mm256_set1_ps (1.0f);
+  const __v8sf two = _mm256_set1_ps (2.0f);
+  __v8sf       burn;
+  __v8sf       dodge;
+
+  burn  = one - v_safe_div (one - in, two * layer);
+  burn  = _mm256_max_ps (burn, _mm256_setzero_ps ());
+
+  dodge = v_safe_div (in, two * (one - layer));
+  dodge = _mm256_min_ps (dodge, one);
+
+  return _mm256_blendv_ps (dodge, burn,
+                           _mm256_cmp_ps (layer, _mm256_set1_ps (0.5f),
+                                          _CMP_LE_OQ));
+}
+
+
+/*  pixels are processed two at a time.  a single leading pixel is
+ *  processed separately when it brings the output to a 32-byte boundary
+ *  (buffers are usually only 16-byte aligned, and the inputs usually
+ *  share the output's alignment), and so is a trailing odd pixel, using
+ *  masked loads and stores.  non-RGBA formats are handed to the scalar
+ *  functions.
+ */
+
+#define BLEND_PIXEL(name)                                                      \
+  G_STMT_START                                                                 \
+    {                                                                          \
+      const __m256i first = _mm256_setr_epi32 (-1, -1, -1, -1, 0, 0, 0, 0);   \
+      __v8sf        rgba_in;                                                   \
+      __v8sf        rgba_layer;                                                \
+                                                                               \
+      rgba_in    = _mm256_maskload_ps (in,    first);                          \
+      rgba_layer = _mm256_maskload_ps (layer, first);                          \
+                                                                               \
+      _mm256_maskstore_ps (comp, first,                                        \
+                           _mm256_blend_ps (blend_##name (rgba_in,             \
+                                                          rgba_layer),         \
+                                            rgba_layer, 0x88));                \
+                                                                               \
+      in    += 4;                                                              \
+      layer += 4;                                                              \
+      comp  += 4;                                                              \
+      samples--;                                                               \
+    }                                                                          \
+  G_STMT_END
+
+#define DEFINE_BLEND_FUNCTION(name)                                            \
+void                                                                           \
+gimp_operation_layer_mode_blend_##name##_avx2 (GeglOperation *operation,       \
+                                               const gfloat  *in,              \
+                                               const gfloat  *layer,           \
+                                               gfloat        *comp,            \
+                                               gint           samples)         \
+{                                                                              \
+  const Babl *format = gegl_operation_get_format (operation, "input");         \
+                                                                               \
+  if (babl_format_get_n_components (format) != 4)                              \
+    {                                                                          \
+      gimp_operation_layer_mode_blend_##name (operation,                       \
+                                              in, layer, comp, samples);       \
+      return;                                                                  \
+    }                                                                          \
+                                                                               \
+  if (samples && ((uintptr_t) comp & 0x1f))                                    \
+    BLEND_PIXEL (name);                                                        \
+                                                                               \
+  for (; samples >= 2; samples -= 2)                                           \
+    {                                                                          \
+      __v8sf rgba_in    = _mm256_loadu_ps (in);                                \
+      __v8sf rgba_layer = _mm256_loadu_ps (layer);                             \
+                                                                               \
+      /* swap in the layers' alpha */                                          \
+      _mm256_storeu_ps (comp,                                                  \
+                        _mm256_blend_ps (blend_##name (rgba_in, rgba_layer),   \
+                                         rgba_layer, 0x88));                   \
+                                                                               \
+      in    += 8;                                                              \
+      layer += 8;                                                              \
+      comp  += 8;                                                              \
+    }                                                                          \
+                                                                               \
+  if (samples)                                                                 \
+    BLEND_PIXEL (name);                                                        \
+}
+
+DEFINE_BLEND_FUNCTION (addition)
+DEFINE_BLEND_FUNCTION (burn)
+DEFINE_BLEND_FUNCTION (darken_only)
+DEFINE_BLEND_FUNCTION (difference)
+DEFINE_BLEND_FUNCTION (divide)
+DEFINE_BLEND_FUNCTION (dodge)
+DEFINE_BLEND_FUNCTION (exclusion)
+DEFINE_BLEND_FUNCTION (grain_extract)
+DEFINE_BLEND_FUNCTION (grain_merge)
+DEFINE_BLEND_FUNCTION (hard_mix)
+DEFINE_BLEND_FUNCTION (hardlight)
+DEFINE_BLEND_FUNCTION (lighten_only)
+DEFINE_BLEND_FUNCTION (linear_burn)
+DEFINE_BLEND_FUNCTION (linear_light)
+DEFINE_BLEND_FUNCTION (multiply)
+DEFINE_BLEND_FUNCTION (overlay)
+DEFINE_BLEND_FUNCTION (pin_light)
+DEFINE_BLEND_FUNCTION (screen)
+DEFINE_BLEND_FUNCTION (softlight)
+DEFINE_BLEND_FUNCTION (subtract)
+DEFINE_BLEND_FUNCTION (vivid_light)
+
+#endif /* COMPILE_AVX2_INTRINISICS */
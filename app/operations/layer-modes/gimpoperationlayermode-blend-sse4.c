@@ -0,0 +1,337 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimpoperationlayermode-blend-sse4.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gegl-plugin.h>
+#include <cairo.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "libgimpbase/gimpbase.h"
+
+#include "../operations-types.h"
+
+#include "gimpoperationlayermode-blend.h"
+
+
+#if COMPILE_SSE4_1_INTRINISICS
+
+/* SSE4 */
+#include <smmintrin.h>
+
+
+#define EPSILON      1e-6f
+
+#define SAFE_DIV_MIN EPSILON
+#define SAFE_DIV_MAX (1.0f / SAFE_DIV_MIN)
+
+
+/*  these are vector versions of the separable blend functions in
+ *  gimpoperationlayermode-blend.c.  the kernels are applied to all four
+ *  components of a pixel, and the blend function then swaps in the
+ *  layer's alpha.  since the color components of pixels whose input or
+ *  layer alpha is zero are unconstrained, these pixels are blended like
+ *  any other, instead of being skipped.
+ *
+ *  each kernel follows the order of operations of its scalar
+ *  counterpart, so that both produce the same results.
+ */
+
+
+static inline __v4sf
+v_abs (__v4sf x)
+{
+  return _mm_andnot_ps (_mm_set1_ps (-0.0f), x);
+}
+
+/* see safe_div() in gimpoperationlayermode-blend.c */
+static inline __v4sf
+v_safe_div (__v4sf a,
+            __v4sf b)
+{
+  __v4sf result;
+
+  result = a / b;
+  result = _mm_max_ps (result, _mm_set1_ps (-SAFE_DIV_MAX));
+  result = _mm_min_ps (result, _mm_set1_ps (SAFE_DIV_MAX));
+
+  return _mm_and_ps (result,
+                     _mm_cmpgt_ps (v_abs (a), _mm_set1_ps (SAFE_DIV_MIN)));
+}
+
+static inline __v4sf
+blend_addition (__v4sf in,
+                __v4sf layer)
+{
+  return in + layer;
+}
+
+static inline __v4sf
+blend_burn (__v4sf in,
+            __v4sf layer)
+{
+  const __v4sf one = _mm_set1_ps (1.0f);
+
+  return one - v_safe_div (one - in, layer);
+}
+
+static inline __v4sf
+blend_darken_only (__v4sf in,
+                   __v4sf layer)
+{
+  return _mm_min_ps (in, layer);
+}
+
+static inline __v4sf
+blend_difference (__v4sf in,
+                  __v4sf layer)
+{
+  return v_abs (in - layer);
+}
+
+static inline __v4sf
+blend_divide (__v4sf in,
+              __v4sf layer)
+{
+  return v_safe_div (in, layer);
+}
+
+static inline __v4sf
+blend_dodge (__v4sf in,
+             __v4sf layer)
+{
+  return v_safe_div (in, _mm_set1_ps (1.0f) - layer);
+}
+
+static inline __v4sf
+blend_exclusion (__v4sf in,
+                 __v4sf layer)
+{
+  const __v4sf half = _mm_set1_ps (0.5f);
+
+  return half - _mm_set1_ps (2.0f) * (in - half) * (layer - half);
+}
+
+static inline __v4sf
+blend_grain_extract (__v4sf in,
+                     __v4sf layer)
+{
+  return in - layer + _mm_set1_ps (0.5f);
+}
+
+static inline __v4sf
+blend_grain_merge (__v4sf in,
+                   __v4sf layer)
+{
+  return in + layer - _mm_set1_ps (0.5f);
+}
+
+static inline __v4sf
+blend_hard_mix (__v4sf in,
+                __v4sf layer)
+{
+  const __v4sf one = _mm_set1_ps (1.0f);
+
+  return _mm_and_ps (_mm_cmpnlt_ps (in + layer, one), one);
+}
+
+static inline __v4sf
+blend_hardlight (__v4sf in,
+                 __v4sf layer)
+{
+  const __v4sf one  = _mm_set1_ps (1.0f);
+  const __v4sf two  = _mm_set1_ps (2.0f);
+  const __v4sf half = _mm_set1_ps (0.5f);
+  __v4sf       light;
+  __v4sf       dark;
+
+  light = (one - in) * (one - (layer - half) * two);
+  light = _mm_min_ps (one - light, one);
+
+  dark  = in * (layer * two);
+  dark  = _mm_min_ps (dark, one);
+
+  return _mm_blendv_ps (dark, light, _mm_cmpgt_ps (layer, half));
+}
+
+static inline __v4sf
+blend_lighten_only (__v4sf in,
+                    __v4sf layer)
+{
+  return _mm_max_ps (in, layer);
+}
+
+static inline __v4sf
+blend_linear_burn (__v4sf in,
+                   __v4sf layer)
+{
+  return in + layer - _mm_set1_ps (1.0f);
+}
+
+static inline __v4sf
+blend_linear_light (__v4sf in,
+                    __v4sf layer)
+{
+  const __v4sf two  = _mm_set1_ps (2.0f);
+  const __v4sf half = _mm_set1_ps (0.5f);
+
+  return _mm_blendv_ps (in + two * (layer - half),
+                        in + two * layer - _mm_set1_ps (1.0f),
+                        _mm_cmple_ps (layer, half));
+}
+
+static inline __v4sf
+blend_multiply (__v4sf in,
+                __v4sf layer)
+{
+  return in * layer;
+}
+
+static inline __v4sf
+blend_overlay (__v4sf in,
+               __v4sf layer)
+{
+  const __v4sf one = _mm_set1_ps (1.0f);
+  const __v4sf two = _mm_set1_ps (2.0f);
+
+  return _mm_blendv_ps (one - two * (one - layer) * (one - in),
+                        two * in * layer,
+                        _mm_cmplt_ps (in, _mm_set1_ps (0.5f)));
+}
+
+static inline __v4sf
+blend_pin_light (__v4sf in,
+                 __v4sf layer)
+{
+  const __v4sf two  = _mm_set1_ps (2.0f);
+  const __v4sf half = _mm_set1_ps (0.5f);
+
+  return _mm_blendv_ps (_mm_min_ps (in, two * layer),
+                        _mm_max_ps (in, two * (layer - half)),
+                        _mm_cmpgt_ps (layer, half));
+}
+
+static inline __v4sf
+blend_screen (__v4sf in,
+              __v4sf layer)
+{
+  const __v4sf one = _mm_set1_ps (1.0f);
+
+  return one - (one - in) * (one - layer);
+}
+
+static inline __v4sf
+blend_softlight (__v4sf in,
+                 __v4sf layer)
+{
+  const __v4sf one = _mm_set1_ps (1.0f);
+  __v4sf       multiply;
+  __v4sf       screen;
+
+  multiply = in * layer;
+  screen   = one - (one - in) * (one - layer);
+
+  return (one - in) * multiply + in * screen;
+}
+
+static inline __v4sf
+blend_subtract (__v4sf in,
+                __v4sf layer)
+{
+  return in - layer;
+}
+
+static inline __v4sf
+blend_vivid_light (__v4sf in,
+                   __v4sf layer)
+{
+  const __v4sf one = _mm_set1_ps (1.0f);
+  const __v4sf two = _mm_set1_ps (2.0f);
+  __v4sf       burn;
+  __v4sf       dodge;
+
+  burn  = one - v_safe_div (one - in, two * layer);
+  burn  = _mm_max_ps (burn, _mm_setzero_ps ());
+
+  dodge = v_safe_div (in, two * (one - layer));
+  dodge = _mm_min_ps (dodge, one);
+
+  return _mm_blendv_ps (dodge, burn, _mm_cmple_ps (layer, _mm_set1_ps (0.5f)));
+}
+
+
+/*  pixels are processed one at a time, and non-RGBA formats are handed
+ *  to the scalar functions.
+ */
+
+#define DEFINE_BLEND_FUNCTION(name)                                            \
+void                                                                           \
+gimp_operation_layer_mode_blend_##name##_sse4 (GeglOperation *operation,       \
+                                               const gfloat  *in,              \
+                                               const gfloat  *layer,           \
+                                               gfloat        *comp,            \
+                                               gint           samples)         \
+{                                                                              \
+  const Babl *format = gegl_operation_get_format (operation, "input");         \
+                                                                               \
+  if (babl_format_get_n_components (format) != 4)                              \
+    {                                                                          \
+      gimp_operation_layer_mode_blend_##name (operation,                       \
+                                              in, layer, comp, samples);       \
+      return;                                                                  \
+    }                                                                          \
+                                                                               \
+  while (samples--)                                                            \
+    {                                                                          \
+      __v4sf rgba_in    = _mm_loadu_ps (in);                                   \
+      __v4sf rgba_layer = _mm_loadu_ps (layer);                                \
+                                                                               \
+      /* swap in the layer's alpha */                                          \
+      _mm_storeu_ps (comp, _mm_blend_ps (blend_##name (rgba_in, rgba_layer),   \
+                                         rgba_layer, 0x08));                   \
+                                                                               \
+      in    += 4;                                                              \
+      layer += 4;                                                              \
+      comp  += 4;                                                              \
+    }                                                                          \
+}
+
+DEFINE_BLEND_FUNCTION (addition)
+DEFINE_BLEND_FUNCTION (burn)
+DEFINE_BLEND_FUNCTION (darken_only)
+DEFINE_BLEND_FUNCTION (difference)
+DEFINE_BLEND_FUNCTION (divide)
+DEFINE_BLEND_FUNCTION (dodge)
+DEFINE_BLEND_FUNCTION (exclusion)
+DEFINE_BLEND_FUNCTION (grain_extract)
+DEFINE_BLEND_FUNCTION (grain_merge)
+DEFINE_BLEND_FUNCTION (hard_mix)
+DEFINE_BLEND_FUNCTION (hardlight)
+DEFINE_BLEND_FUNCTION (lighten_only)
+DEFINE_BLEND_FUNCTION (linear_burn)
+DEFINE_BLEND_FUNCTION (linear_light)
+DEFINE_BLEND_FUNCTION (multiply)
+DEFINE_BLEND_FUNCTION (overlay)
+DEFINE_BLEND_FUNCTION (pin_light)
+DEFINE_BLEND_FUNCTION (screen)
+DEFINE_BLEND_FUNCTION (softlight)
+DEFINE_BLEND_FUNCTION (subtract)
+DEFINE_BLEND_FUNCTION (vivid_light)
+
+#endif /* COMPILE_SSE4_1_INTRINISICS */
@@ -40,6 +40,29 @@
 #define SAFE_DIV_MIN EPSILON
 #define SAFE_DIV_MAX (1.0f / SAFE_DIV_MIN)
 
+#if COMPILE_SSE4_1_INTRINISICS
+#define SSE4(name) gimp_operation_layer_mode_blend_##name##_sse4
+#else
+#define SSE4(name) NULL
+#endif
+
+#if COMPILE_AVX2_INTRINISICS
+#define AVX2(name) gimp_operation_layer_mode_blend_##name##_avx2
+#else
+#define AVX2(name) NULL
+#endif
+
+#define ACCELERATED(name) { gimp_operation_layer_mode_blend_##name, \
+                            SSE4 (name), AVX2 (name) }
+
+
+typedef struct
+{
+  GimpLayerModeBlendFunc blend_function;
+  GimpLayerModeBlendFunc blend_function_sse4;
+  GimpLayerModeBlendFunc blend_function_avx2;
+} AcceleratedBlendFunc;
+
 
 /*  local function prototypes  */
 
@@ -69,9 +92,66 @@ safe_div (gfloat a,
 }
 
 
+/*  the separable blend functions, which have vector variants  */
+
+static const AcceleratedBlendFunc accelerated_blend_funcs[] =
+{
+  ACCELERATED (addition),
+  ACCELERATED (burn),
+  ACCELERATED (darken_only),
+  ACCELERATED (difference),
+  ACCELERATED (divide),
+  ACCELERATED (dodge),
+  ACCELERATED (exclusion),
+  ACCELERATED (grain_extract),
+  ACCELERATED (grain_merge),
+  ACCELERATED (hard_mix),
+  ACCELERATED (hardlight),
+  ACCELERATED (lighten_only),
+  ACCELERATED (linear_burn),
+  ACCELERATED (linear_light),
+  ACCELERATED (multiply),
+  ACCELERATED (overlay),
+  ACCELERATED (pin_light),
+  ACCELERATED (screen),
+  ACCELERATED (softlight),
+  ACCELERATED (subtract),
+  ACCELERATED (vivid_light)
+};
+
+
 /*  public functions  */
 
 
+/*  returns the fastest variant of @blend_function which only uses the
+ *  CPU features in @accel, or @blend_function itself if there is none.
+ */
+GimpLayerModeBlendFunc
+gimp_operation_layer_mode_blend_get_accelerated (GimpLayerModeBlendFunc blend_function,
+                                                 GimpCpuAccelFlags      accel)
+{
+  gint i;
+
+  for (i = 0; i < G_N_ELEMENTS (accelerated_blend_funcs); i++)
+    {
+      const AcceleratedBlendFunc *funcs = &accelerated_blend_funcs[i];
+
+      if (funcs->blend_function != blend_function)
+        continue;
+
+      if ((accel & GIMP_CPU_ACCEL_X86_AVX2) && funcs->blend_function_avx2)
+        return funcs->blend_function_avx2;
+
+      if ((accel & GIMP_CPU_ACCEL_X86_SSE4_1) && funcs->blend_function_sse4)
+        return funcs->blend_function_sse4;
+
+      break;
+    }
+
+  return blend_function;
+}
+
+
 /*  non-subtractive blending functions.  these functions must set comp[ALPHA]
  *  to the same value as layer[ALPHA].  when in[ALPHA] or layer[ALPHA] are
  *  zero, the value of comp[0..N] is unconstrained (in particular, it may
@@ -194,3 +194,233 @@ void gimp_operation_layer_mode_blend_color_erase       (GeglOperation *operation
                                                         const gfloat  *layer,
                                                         gfloat        *comp,
                                                         gint           samples);
+
+
+GimpLayerModeBlendFunc gimp_operation_layer_mode_blend_get_accelerated (GimpLayerModeBlendFunc blend_function,
+                                                                        GimpCpuAccelFlags      accel);
+
+
+#if COMPILE_SSE4_1_INTRINISICS
+
+/*  SSE4.1 variants of the separable blend functions  */
+
+void gimp_operation_layer_mode_blend_addition_sse4      (GeglOperation *operation,
+                                                         const gfloat  *in,
+                                                         const gfloat  *layer,
+                                                         gfloat        *comp,
+                                                         gint           samples);
+void gimp_operation_layer_mode_blend_burn_sse4          (GeglOperation *operation,
+                                                         const gfloat  *in,
+                                                         const gfloat  *layer,
+                                                         gfloat        *comp,
+                                                         gint           samples);
+void gimp_operation_layer_mode_blend_darken_only_sse4   (GeglOperation *operation,
+                                                         const gfloat  *in,
+                                                         const gfloat  *layer,
+                                                         gfloat        *comp,
+                                                         gint           samples);
+void gimp_operation_layer_mode_blend_difference_sse4    (GeglOperation *operation,
+                                                         const gfloat  *in,
+                                                         const gfloat  *layer,
+                                                         gfloat        *comp,
+                                                         gint           samples);
+void gimp_operation_layer_mode_blend_divide_sse4        (GeglOperation *operation,
+                                                         const gfloat  *in,
+                                                         const gfloat  *layer,
+                                                         gfloat        *comp,
+                                                         gint           samples);
+void gimp_operation_layer_mode_blend_dodge_sse4         (GeglOperation *operation,
+                                                         const gfloat  *in,
+                                                         const gfloat  *layer,
+                                                         gfloat        *comp,
+                                                         gint           samples);
+void gimp_operation_layer_mode_blend_exclusion_sse4     (GeglOperation *operation,
+                                                         const gfloat  *in,
+                                                         const gfloat  *layer,
+                                                         gfloat        *comp,
+                                                         gint           samples);
+void gimp_operation_layer_mode_blend_grain_extract_sse4 (GeglOperation *operation,
+                                                         const gfloat  *in,
+                                                         const gfloat  *layer,
+                                                         gfloat        *comp,
+                                                         gint           samples);
+void gimp_operation_layer_mode_blend_grain_merge_sse4   (GeglOperation *operation,
+                                                         const gfloat  *in,
+                                                         const gfloat  *layer,
+                                                         gfloat        *comp,
+                                                         gint           samples);
+void gimp_operation_layer_mode_blend_hard_mix_sse4      (GeglOperation *operation,
+                                                         const gfloat  *in,
+                                                         const gfloat  *layer,
+                                                         gfloat        *comp,
+                                                         gint           samples);
+void gimp_operation_layer_mode_blend_hardlight_sse4     (GeglOperation *operation,
+                                                         const gfloat  *in,
+                                                         const gfloat  *layer,
+                                                         gfloat        *comp,
+                                                         gint           samples);
+void gimp_operation_layer_mode_blend_lighten_only_sse4  (GeglOperation *operation,
+                                                         const gfloat  *in,
+                                                         const gfloat  *layer,
+                                                         gfloat        *comp,
+                                                         gint           samples);
+void gimp_operation_layer_mode_blend_linear_burn_sse4   (GeglOperation *operation,
+                                                         const gfloat  *in,
+                                                         const gfloat  *layer,
+                                                         gfloat        *comp,
+                                                         gint           samples);
+void gimp_operation_layer_mode_blend_linear_light_sse4  (GeglOperation *operation,
+                                                         const gfloat  *in,
+                                                         const gfloat  *layer,
+                                                         gfloat        *comp,
+                                                         gint           samples);
+void gimp_operation_layer_mode_blend_multiply_sse4      (GeglOperation *operation,
+                                                         const gfloat  *in,
+                                                         const gfloat  *layer,
+                                                         gfloat        *comp,
+                                                         gint           samples);
+void gimp_operation_layer_mode_blend_overlay_sse4       (GeglOperation *operation,
+                                                         const gfloat  *in,
+                                                         const gfloat  *layer,
+                                                         gfloat        *comp,
+                                                         gint           samples);
+void gimp_operation_layer_mode_blend_pin_light_sse4     (GeglOperation *operation,
+                                                         const gfloat  *in,
+                                                         const gfloat  *layer,
+                                                         gfloat        *comp,
+                                                         gint           samples);
+void gimp_operation_layer_mode_blend_screen_sse4        (GeglOperation *operation,
+                                                         const gfloat  *in,
+                                                         const gfloat  *layer,
+                                                         gfloat        *comp,
+                                                         gint           samples);
+void gimp_operation_layer_mode_blend_softlight_sse4     (GeglOperation *operation,
+                                                         const gfloat  *in,
+                                                         const gfloat  *layer,
+                                                         gfloat        *comp,
+                                                         gint           samples);
+void gimp_operation_layer_mode_blend_subtract_sse4      (GeglOperation *operation,
+                                                         const gfloat  *in,
+                                                         const gfloat  *layer,
+                                                         gfloat        *comp,
+                                                         gint           samples);
+void gimp_operation_layer_mode_blend_vivid_light_sse4   (GeglOperation *operation,
+                                                         const gfloat  *in,
+                                                         const gfloat  *layer,
+                                                         gfloat        *comp,
+                                                         gint           samples);
+
+#endif /* COMPILE_SSE4_1_INTRINISICS */
+
+
+#if COMPILE_AVX2_INTRINISICS
+
+/*  AVX2 variants of the separable blend functions  */
+
+void gimp_operation_layer_mode_blend_addition_avx2      (GeglOperation *operation,
+                                                         const gfloat  *in,
+                                                         const gfloat  *layer,
+                                                         gfloat        *comp,
+                                                         gint           samples);
+void gimp_operation_layer_mode_blend_burn_avx2          (GeglOperation *operation,
+                                                         const gfloat  *in,
+                                                         const gfloat  *layer,
+                                                         gfloat        *comp,
+                                                         gint           samples);
+void gimp_operation_layer_mode_blend_darken_only_avx2   (GeglOperation *operation,
+                                                         const gfloat  *in,
+                                                         const gfloat  *layer,
+                                                         gfloat        *comp,
+                                                         gint           samples);
+void gimp_operation_layer_mode_blend_difference_avx2    (GeglOperation *operation,
+                                                         const gfloat  *in,
+                                                         const gfloat  *layer,
+                                                         gfloat        *comp,
+                                                         gint           samples);
+void gimp_operation_layer_mode_blend_divide_avx2        (GeglOperation *operation,
+                                                         const gfloat  *in,
+                                                         const gfloat  *layer,
+                                                         gfloat        *comp,
+                                                         gint           samples);
+void gimp_operation_layer_mode_blend_dodge_avx2         (GeglOperation *operation,
+                                                         const gfloat  *in,
+                                                         const gfloat  *layer,
+                                                         gfloat        *comp,
+                                                         gint           samples);
+void gimp_operation_layer_mode_blend_exclusion_avx2     (GeglOperation *operation,
+                                                         const gfloat  *in,
+                                                         const gfloat  *layer,
+                                                         gfloat        *comp,
+                                                         gint           samples);
+void gimp_operation_layer_mode_blend_grain_extract_avx2 (GeglOperation *operation,
+                                                         const gfloat  *in,
+                                                         const gfloat  *layer,
+                                                         gfloat        *comp,
+                                                         gint           samples);
+void gimp_operation_layer_mode_blend_grain_merge_avx2   (GeglOperation *operation,
+                                                         const gfloat  *in,
+                                                         const gfloat  *layer,
+                                                         gfloat        *comp,
+                                                         gint           samples);
+void gimp_operation_layer_mode_blend_hard_mix_avx2      (GeglOperation *operation,
+                                                         const gfloat  *in,
+                                                         const gfloat  *layer,
+                                                         gfloat        *comp,
+                                                         gint           samples);
+void gimp_operation_layer_mode_blend_hardlight_avx2     (GeglOperation *operation,
+                                                         const gfloat  *in,
+                                                         const gfloat  *layer,
+                                                         gfloat        *comp,
+                                                         gint           samples);
+void gimp_operation_layer_mode_blend_lighten_only_avx2  (GeglOperation *operation,
+                                                         const gfloat  *in,
+                                                         const gfloat  *layer,
+                                                         gfloat        *comp,
+                                                         gint           samples);
+void gimp_operation_layer_mode_blend_linear_burn_avx2   (GeglOperation *operation,
+                                                         const gfloat  *in,
+                                                         const gfloat  *layer,
+                                                         gfloat        *comp,
+                                                         gint           samples);
+void gimp_operation_layer_mode_blend_linear_light_avx2  (GeglOperation *operation,
+                                                         const gfloat  *in,
+                                                         const gfloat  *layer,
+                                                         gfloat        *comp,
+                                                         gint           samples);
+void gimp_operation_layer_mode_blend_multiply_avx2      (GeglOperation *operation,
+                                                         const gfloat  *in,
+                                                         const gfloat  *layer,
+                                                         gfloat        *comp,
+                                                         gint           samples);
+void gimp_operation_layer_mode_blend_overlay_avx2       (GeglOperation *operation,
+                                                         const gfloat  *in,
+                                                         const gfloat  *layer,
+                                                         gfloat        *comp,
+                                                         gint           samples);
+void gimp_operation_layer_mode_blend_pin_light_avx2     (GeglOperation *operation,
+                                                         const gfloat  *in,
+                                                         const gfloat  *layer,
+                                                         gfloat        *comp,
+                                                         gint           samples);
+void gimp_operation_layer_mode_blend_screen_avx2        (GeglOperation *operation,
+                                                         const gfloat  *in,
+                                                         const gfloat  *layer,
+                                                         gfloat        *comp,
+                                                         gint           samples);
+void gimp_operation_layer_mode_blend_softlight_avx2     (GeglOperation *operation,
+                                                         const gfloat  *in,
+                                                         const gfloat  *layer,
+                                                         gfloat        *comp,
+                                                         gint           samples);
+void gimp_operation_layer_mode_blend_subtract_avx2      (GeglOperation *operation,
+                                                         const gfloat  *in,
+                                                         const gfloat  *layer,
+                                                         gfloat        *comp,
+                                                         gint           samples);
+void gimp_operation_layer_mode_blend_vivid_light_avx2   (GeglOperation *operation,
+                                                         const gfloat  *in,
+                                                         const gfloat  *layer,
+                                                         gfloat        *comp,
+                                                         gint           samples);
+
+#endif /* COMPILE_AVX2_INTRINISICS */
@@ -0,0 +1,226 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimpoperationlayermode-composite-avx2.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gegl-plugin.h>
+#include <cairo.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "../operations-types.h"
+
+#include "gimpoperationlayermode-composite.h"
+
+
+#if COMPILE_AVX2_INTRINISICS
+
+/* AVX2 */
+#include <immintrin.h>
+
+
+/*  non-subtractive compositing functions.  these functions expect comp[ALPHA]
+ *  to be the same as layer[ALPHA].  when in[ALPHA] or layer[ALPHA] are zero,
+ *  the value of comp[RED..BLUE] is unconstrained (in particular, it may be
+ *  NaN).
+ *
+ *  the kernels below compute the general case for every pixel, and select
+ *  the input or layer color where the scalar functions take a shortcut,
+ *  so the unconstrained values never reach the output.
+ */
+
+
+#define EXPAND_ALPHA(v) _mm256_shuffle_ps ((v), (v), _MM_SHUFFLE (3, 3, 3, 3))
+
+
+static inline __v8sf
+v_is_zero (__v8sf x)
+{
+  return _mm256_cmp_ps (x, _mm256_setzero_ps (), _CMP_EQ_OQ);
+}
+
+static inline __v8sf
+composite_union (__v8sf in,
+                 __v8sf layer,
+                 __v8sf comp,
+                 __v8sf opacity,
+                 __v8sf mask)
+{
+  const __v8sf one         = _mm256_set1_ps (1.0f);
+  __v8sf       in_alpha    = EXPAND_ALPHA (in);
+  __v8sf       layer_alpha = EXPAND_ALPHA (layer) * opacity * mask;
+  __v8sf       new_alpha;
+  __v8sf       ratio;
+  __v8sf       out;
+
+  new_alpha = layer_alpha + (one - layer_alpha) * in_alpha;
+  ratio     = layer_alpha / new_alpha;
+
+  out = ratio * (in_alpha * (comp - layer) + layer - in) + in;
+  out = _mm256_blendv_ps (out, layer, v_is_zero (in_alpha));
+  out = _mm256_blendv_ps (out, in,    _mm256_or_ps (v_is_zero (layer_alpha),
+                                                    v_is_zero (new_alpha)));
+
+  return _mm256_blend_ps (out, new_alpha, 0x88);
+}
+
+static inline __v8sf
+composite_clip_to_backdrop (__v8sf in,
+                            __v8sf layer,
+                            __v8sf comp,
+                            __v8sf opacity,
+                            __v8sf mask)
+{
+  const __v8sf one         = _mm256_set1_ps (1.0f);
+  __v8sf       in_alpha    = EXPAND_ALPHA (in);
+  __v8sf       layer_alpha = EXPAND_ALPHA (comp) * opacity * mask;
+  __v8sf       out;
+
+  out = comp * layer_alpha + in * (one - layer_alpha);
+  out = _mm256_blendv_ps (out, in, _mm256_or_ps (v_is_zero (in_alpha),
+                                                 v_is_zero (layer_alpha)));
+
+  return _mm256_blend_ps (out, in, 0x88);
+}
+
+static inline __v8sf
+composite_clip_to_layer (__v8sf in,
+                         __v8sf layer,
+                         __v8sf comp,
+                         __v8sf opacity,
+                         __v8sf mask)
+{
+  const __v8sf one         = _mm256_set1_ps (1.0f);
+  __v8sf       in_alpha    = EXPAND_ALPHA (in);
+  __v8sf       layer_alpha = EXPAND_ALPHA (layer) * opacity * mask;
+  __v8sf       out;
+
+  out = comp * in_alpha + layer * (one - in_alpha);
+  out = _mm256_blendv_ps (out, layer, v_is_zero (in_alpha));
+  out = _mm256_blendv_ps (out, in,    v_is_zero (layer_alpha));
+
+  return _mm256_blend_ps (out, layer_alpha, 0x88);
+}
+
+static inline __v8sf
+composite_intersection (__v8sf in,
+                        __v8sf layer,
+                        __v8sf comp,
+                        __v8sf opacity,
+                        __v8sf mask)
+{
+  __v8sf new_alpha = EXPAND_ALPHA (in) * EXPAND_ALPHA (comp) * opacity * mask;
+  __v8sf out;
+
+  out = _mm256_blendv_ps (comp, in, v_is_zero (new_alpha));
+
+  return _mm256_blend_ps (out, new_alpha, 0x88);
+}
+
+
+/*  pixels are processed two at a time.  a single leading pixel is
+ *  processed separately when it brings the output to a 32-byte boundary,
+ *  and so is a trailing odd pixel, using masked loads and stores.
+ *  non-RGBA formats are handed to the scalar functions.  when there is no
+ *  mask, the layer's alpha is multiplied by 1.0, which leaves it
+ *  unchanged.
+ */
+
+#define COMPOSITE_PIXEL(name)                                                  \
+  G_STMT_START                                                                 \
+    {                                                                          \
+      const __m256i first = _mm256_setr_epi32 (-1, -1, -1, -1, 0, 0, 0, 0);   \
+      __v8sf        rgba_in;                                                   \
+      __v8sf        rgba_layer;                                                \
+      __v8sf        rgba_comp;                                                 \
+                                                                               \
+      rgba_in    = _mm256_maskload_ps (in,    first);                          \
+      rgba_layer = _mm256_maskload_ps (layer, first);                          \
+      rgba_comp  = _mm256_maskload_ps (comp,  first);                          \
+                                                                               \
+      if (mask)                                                                \
+        v_mask = _mm256_set1_ps (*mask++);                                     \
+                                                                               \
+      _mm256_maskstore_ps (out, first,                                         \
+                           composite_##name (rgba_in, rgba_layer, rgba_comp,   \
+                                             v_opacity, v_mask));              \
+                                                                               \
+      in    += 4;                                                              \
+      layer += 4;                                                              \
+      comp  += 4;                                                              \
+      out   += 4;                                                              \
+      samples--;                                                               \
+    }                                                                          \
+  G_STMT_END
+
+#define DEFINE_COMPOSITE_FUNCTION(name)                                        \
+void                                                                           \
+gimp_operation_layer_mode_composite_##name##_avx2 (const gfloat *in,           \
+                                                   const gfloat *layer,        \
+                                                   const gfloat *comp,         \
+                                                   const gfloat *mask,         \
+                                                   gfloat        opacity,      \
+                                                   const gint    n_components, \
+                                                   gfloat       *out,          \
+                                                   gint          samples)      \
+{                                                                              \
+  const __v8sf v_opacity = _mm256_set1_ps (opacity);                           \
+  __v8sf       v_mask    = _mm256_set1_ps (1.0f);                              \
+                                                                               \
+  if (n_components != 4)                                                       \
+    {                                                                          \
+      gimp_operation_layer_mode_composite_##name (in, layer, comp,             \
+                                                  mask, opacity,               \
+                                                  n_components, out,           \
+                                                  samples);                    \
+      return;                                                                  \
+    }                                                                          \
+                                                                               \
+  if (samples && ((uintptr_t) out & 0x1f))                                     \
+    COMPOSITE_PIXEL (name);                                                    \
+                                                                               \
+  for (; samples >= 2; samples -= 2)                                           \
+    {                                                                          \
+      if (mask)                                                                \
+        {                                                                      \
+          v_mask = _mm256_setr_m128 (_mm_set1_ps (mask[0]),                    \
+                                     _mm_set1_ps (mask[1]));                   \
+          mask  += 2;                                                          \
+        }                                                                      \
+                                                                               \
+      _mm256_storeu_ps (out, composite_##name (_mm256_loadu_ps (in),           \
+                                               _mm256_loadu_ps (layer),        \
+                                               _mm256_loadu_ps (comp),         \
+                                               v_opacity, v_mask));            \
+                                                                               \
+      in    += 8;                                                              \
+      layer += 8;                                                              \
+      comp  += 8;                                                              \
+      out   += 8;                                                              \
+    }                                                                          \
+                                                                               \
+  if (samples)                                                                 \
+    COMPOSITE_PIXEL (name);                                                    \
+}
+
+DEFINE_COMPOSITE_FUNCTION (union)
+DEFINE_COMPOSITE_FUNCTION (clip_to_backdrop)
+DEFINE_COMPOSITE_FUNCTION (clip_to_layer)
+DEFINE_COMPOSITE_FUNCTION (intersection)
+
+#endif /* COMPILE_AVX2_INTRINISICS */
@@ -0,0 +1,186 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimpoperationlayermode-composite-sse4.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gegl-plugin.h>
+#include <cairo.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "../operations-types.h"
+
+#include "gimpoperationlayermode-composite.h"
+
+
+#if COMPILE_SSE4_1_INTRINISICS
+
+/* SSE4 */
+#include <smmintrin.h>
+
+
+/*  non-subtractive compositing functions.  these functions expect comp[ALPHA]
+ *  to be the same as layer[ALPHA].  when in[ALPHA] or layer[ALPHA] are zero,
+ *  the value of comp[RED..BLUE] is unconstrained (in particular, it may be
+ *  NaN).
+ *
+ *  the kernels below compute the general case for every pixel, and select
+ *  the input or layer color where the scalar functions take a shortcut,
+ *  so the unconstrained values never reach the output.
+ */
+
+
+#define EXPAND_ALPHA(v) _mm_shuffle_ps ((v), (v), _MM_SHUFFLE (3, 3, 3, 3))
+
+
+static inline __v4sf
+v_is_zero (__v4sf x)
+{
+  return _mm_cmpeq_ps (x, _mm_setzero_ps ());
+}
+
+static inline __v4sf
+composite_union (__v4sf in,
+                 __v4sf layer,
+                 __v4sf comp,
+                 __v4sf opacity,
+                 __v4sf mask)
+{
+  const __v4sf one         = _mm_set1_ps (1.0f);
+  __v4sf       in_alpha    = EXPAND_ALPHA (in);
+  __v4sf       layer_alpha = EXPAND_ALPHA (layer) * opacity * mask;
+  __v4sf       new_alpha;
+  __v4sf       ratio;
+  __v4sf       out;
+
+  new_alpha = layer_alpha + (one - layer_alpha) * in_alpha;
+  ratio     = layer_alpha / new_alpha;
+
+  out = ratio * (in_alpha * (comp - layer) + layer - in) + in;
+  out = _mm_blendv_ps (out, layer, v_is_zero (in_alpha));
+  out = _mm_blendv_ps (out, in,    _mm_or_ps (v_is_zero (layer_alpha),
+                                              v_is_zero (new_alpha)));
+
+  return _mm_blend_ps (out, new_alpha, 0x08);
+}
+
+static inline __v4sf
+composite_clip_to_backdrop (__v4sf in,
+                            __v4sf layer,
+                            __v4sf comp,
+                            __v4sf opacity,
+                            __v4sf mask)
+{
+  const __v4sf one         = _mm_set1_ps (1.0f);
+  __v4sf       in_alpha    = EXPAND_ALPHA (in);
+  __v4sf       layer_alpha = EXPAND_ALPHA (comp) * opacity * mask;
+  __v4sf       out;
+
+  out = comp * layer_alpha + in * (one - layer_alpha);
+  out = _mm_blendv_ps (out, in, _mm_or_ps (v_is_zero (in_alpha),
+                                           v_is_zero (layer_alpha)));
+
+  return _mm_blend_ps (out, in, 0x08);
+}
+
+static inline __v4sf
+composite_clip_to_layer (__v4sf in,
+                         __v4sf layer,
+                         __v4sf comp,
+                         __v4sf opacity,
+                         __v4sf mask)
+{
+  const __v4sf one         = _mm_set1_ps (1.0f);
+  __v4sf       in_alpha    = EXPAND_ALPHA (in);
+  __v4sf       layer_alpha = EXPAND_ALPHA (layer) * opacity * mask;
+  __v4sf       out;
+
+  out = comp * in_alpha + layer * (one - in_alpha);
+  out = _mm_blendv_ps (out, layer, v_is_zero (in_alpha));
+  out = _mm_blendv_ps (out, in,    v_is_zero (layer_alpha));
+
+  return _mm_blend_ps (out, layer_alpha, 0x08);
+}
+
+static inline __v4sf
+composite_intersection (__v4sf in,
+                        __v4sf layer,
+                        __v4sf comp,
+                        __v4sf opacity,
+                        __v4sf mask)
+{
+  __v4sf new_alpha = EXPAND_ALPHA (in) * EXPAND_ALPHA (comp) * opacity * mask;
+  __v4sf out;
+
+  out = _mm_blendv_ps (comp, in, v_is_zero (new_alpha));
+
+  return _mm_blend_ps (out, new_alpha, 0x08);
+}
+
+
+/*  pixels are processed one at a time, and non-RGBA formats are handed
+ *  to the scalar functions.  when there is no mask, the layer's alpha is
+ *  multiplied by 1.0, which leaves it unchanged.
+ */
+
+#define DEFINE_COMPOSITE_FUNCTION(name)                                        \
+void                                                                           \
+gimp_operation_layer_mode_composite_##name##_sse4 (const gfloat *in,           \
+                                                   const gfloat *layer,        \
+                                                   const gfloat *comp,         \
+                                                   const gfloat *mask,         \
+                                                   gfloat        opacity,      \
+                                                   const gint    n_components, \
+                                                   gfloat       *out,          \
+                                                   gint          samples)      \
+{                                                                              \
+  const __v4sf v_opacity = _mm_set1_ps (opacity);                              \
+  __v4sf       v_mask    = _mm_set1_ps (1.0f);                                 \
+                                                                               \
+  if (n_components != 4)                                                       \
+    {                                                                          \
+      gimp_operation_layer_mode_composite_##name (in, layer, comp,             \
+                                                  mask, opacity,               \
+                                                  n_components, out,           \
+                                                  samples);                    \
+      return;                                                                  \
+    }                                                                          \
+                                                                               \
+  while (samples--)                                                            \
+    {                                                                          \
+      if (mask)                                                                \
+        v_mask = _mm_set1_ps (*mask++);                                        \
+                                                                               \
+      _mm_storeu_ps (out, composite_##name (_mm_loadu_ps (in),                 \
+                                            _mm_loadu_ps (layer),              \
+                                            _mm_loadu_ps (comp),               \
+                                            v_opacity, v_mask));               \
+                                                                               \
+      in    += 4;                                                              \
+      layer += 4;                                                              \
+      comp  += 4;                                                              \
+      out   += 4;                                                              \
+    }                                                                          \
+}
+
+DEFINE_COMPOSITE_FUNCTION (union)
+DEFINE_COMPOSITE_FUNCTION (clip_to_backdrop)
+DEFINE_COMPOSITE_FUNCTION (clip_to_layer)
+DEFINE_COMPOSITE_FUNCTION (intersection)
+
+#endif /* COMPILE_SSE4_1_INTRINISICS */
@@ -0,0 +1,375 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimpoperationlayermode-convert.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <math.h>
+
+#include <gegl-plugin.h>
+#include <cairo.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "../operations-types.h"
+
+#include "gimpoperationlayermode-convert.h"
+
+
+/*  the sRGB TRC and the cube root used by the Lab conversion are
+ *  evaluated using lookup tables with linear interpolation.  the tables
+ *  are indexed by the exponent and the top LUT_BITS bits of the mantissa
+ *  of the value, so that each octave is divided into the same number of
+ *  segments, which keeps the relative error roughly constant across the
+ *  range.  values outside of [2^min-exp, 2^max-exp] are computed directly.
+ */
+#define LUT_BITS                     8
+#define LUT_SHIFT                    (23 - LUT_BITS)
+#define LUT_SIZE(min_exp, max_exp)   ((((max_exp) - (min_exp)) << LUT_BITS) + 2)
+
+#define TO_LINEAR_MIN_EXP            (-5)
+#define TO_LINEAR_THRESHOLD          0.04045f
+#define FROM_LINEAR_MIN_EXP          (-9)
+#define FROM_LINEAR_THRESHOLD        0.0031308f
+#define CBRT_MIN_EXP                 (-7)
+#define CBRT_MAX_EXP                 1
+
+/*  these match the constants used by babl's CIE Lab conversions */
+#define D50_WHITE_REF_X              0.964202880f
+#define D50_WHITE_REF_Z              0.824905400f
+
+#define LAB_EPSILON                  (216.0f / 24389.0f)
+#define LAB_KAPPA                    (24389.0f / 27.0f)
+
+
+static gfloat to_linear_lut[LUT_SIZE (TO_LINEAR_MIN_EXP, 0)];
+static gfloat from_linear_lut[LUT_SIZE (FROM_LINEAR_MIN_EXP, 0)];
+static gfloat cbrt_lut[LUT_SIZE (CBRT_MIN_EXP, CBRT_MAX_EXP)];
+
+
+/*  private functions  */
+
+static gdouble
+srgb_to_linear_exact (gdouble value)
+{
+  if (value > TO_LINEAR_THRESHOLD)
+    return pow ((value + 0.055) / 1.055, 2.4);
+  else
+    return value / 12.92;
+}
+
+static gdouble
+linear_to_srgb_exact (gdouble value)
+{
+  if (value > FROM_LINEAR_THRESHOLD)
+    return 1.055 * pow (value, 1.0 / 2.4) - 0.055;
+  else
+    return value * 12.92;
+}
+
+static void
+lut_init (gfloat    *lut,
+          gint       min_exp,
+          gint       max_exp,
+          gdouble  (*func) (gdouble value))
+{
+  gint i;
+
+  for (i = 0; i < LUT_SIZE (min_exp, max_exp); i++)
+    {
+      gdouble mantissa = 1.0 + (gdouble) (i & ((1 << LUT_BITS) - 1)) /
+                               (1 << LUT_BITS);
+
+      lut[i] = func (ldexp (mantissa, min_exp + (i >> LUT_BITS)));
+    }
+}
+
+static inline gfloat
+lut_lookup (const gfloat *lut,
+            gint          min_exp,
+            gfloat        value)
+{
+  union { gfloat f; guint32 i; } u = { value };
+  guint32 index;
+  gfloat  frac;
+
+  index = (u.i >> LUT_SHIFT) - ((guint32) (127 + min_exp) << LUT_BITS);
+  frac  = (gfloat) (u.i & ((1 << LUT_SHIFT) - 1)) * (1.0f / (1 << LUT_SHIFT));
+
+  return lut[index] + frac * (lut[index + 1] - lut[index]);
+}
+
+static inline gfloat
+srgb_to_linear (gfloat value)
+{
+  if (value <= TO_LINEAR_THRESHOLD)
+    return value / 12.92f;
+  else if (value <= 1.0f)
+    return lut_lookup (to_linear_lut, TO_LINEAR_MIN_EXP, value);
+  else
+    return powf ((value + 0.055f) / 1.055f, 2.4f);
+}
+
+static inline gfloat
+linear_to_srgb (gfloat value)
+{
+  if (value <= FROM_LINEAR_THRESHOLD)
+    return value * 12.92f;
+  else if (value <= 1.0f)
+    return lut_lookup (from_linear_lut, FROM_LINEAR_MIN_EXP, value);
+  else
+    return 1.055f * powf (value, 1.0f / 2.4f) - 0.055f;
+}
+
+static inline gfloat
+lab_f (gfloat value)
+{
+  if (value <= LAB_EPSILON)
+    return (LAB_KAPPA * value + 16.0f) * (1.0f / 116.0f);
+  else if (value <= (gfloat) (1 << CBRT_MAX_EXP))
+    return lut_lookup (cbrt_lut, CBRT_MIN_EXP, value);
+  else
+    return cbrtf (value);
+}
+
+static inline gfloat
+lab_f_inv (gfloat value)
+{
+  gfloat value3 = value * value * value;
+
+  if (value3 > LAB_EPSILON)
+    return value3;
+  else
+    return (116.0f * value - 16.0f) * (1.0f / LAB_KAPPA);
+}
+
+static inline void
+rgb_to_lab (const GimpLayerModeConverter *converter,
+            gfloat                       *pixel)
+{
+  const gfloat (*m)[3] = converter->rgb_to_xyz;
+  gfloat         x, y, z;
+
+  x = m[0][0] * pixel[0] + m[0][1] * pixel[1] + m[0][2] * pixel[2];
+  y = m[1][0] * pixel[0] + m[1][1] * pixel[1] + m[1][2] * pixel[2];
+  z = m[2][0] * pixel[0] + m[2][1] * pixel[1] + m[2][2] * pixel[2];
+
+  x = lab_f (x * (1.0f / D50_WHITE_REF_X));
+  y = lab_f (y);
+  z = lab_f (z * (1.0f / D50_WHITE_REF_Z));
+
+  pixel[0] = 116.0f * y - 16.0f;
+  pixel[1] = 500.0f * (x - y);
+  pixel[2] = 200.0f * (y - z);
+}
+
+static inline void
+lab_to_rgb (const GimpLayerModeConverter *converter,
+            gfloat                       *pixel)
+{
+  const gfloat (*m)[3] = converter->xyz_to_rgb;
+  gfloat         fx, fy, fz;
+  gfloat         x, y, z;
+
+  fy = (pixel[0] + 16.0f) * (1.0f / 116.0f);
+  fx = fy + pixel[1] * (1.0f / 500.0f);
+  fz = fy - pixel[2] * (1.0f / 200.0f);
+
+  x = lab_f_inv (fx) * D50_WHITE_REF_X;
+  z = lab_f_inv (fz) * D50_WHITE_REF_Z;
+
+  if (pixel[0] > LAB_KAPPA * LAB_EPSILON)
+    y = fy * fy * fy;
+  else
+    y = pixel[0] * (1.0f / LAB_KAPPA);
+
+  pixel[0] = m[0][0] * x + m[0][1] * y + m[0][2] * z;
+  pixel[1] = m[1][0] * x + m[1][1] * y + m[1][2] * z;
+  pixel[2] = m[2][0] * x + m[2][1] * y + m[2][2] * z;
+}
+
+static inline void
+to_linear (const GimpLayerModeConverter *converter,
+           gfloat                       *pixel)
+{
+  switch (converter->from_space)
+    {
+    case GIMP_LAYER_COLOR_SPACE_RGB_NON_LINEAR:
+    case GIMP_LAYER_COLOR_SPACE_RGB_PERCEPTUAL:
+      pixel[0] = srgb_to_linear (pixel[0]);
+      pixel[1] = srgb_to_linear (pixel[1]);
+      pixel[2] = srgb_to_linear (pixel[2]);
+      break;
+
+    case GIMP_LAYER_COLOR_SPACE_LAB:
+      lab_to_rgb (converter, pixel);
+      break;
+
+    default:
+      break;
+    }
+}
+
+static inline void
+from_linear (const GimpLayerModeConverter *converter,
+             gfloat                       *pixel)
+{
+  switch (converter->to_space)
+    {
+    case GIMP_LAYER_COLOR_SPACE_RGB_NON_LINEAR:
+    case GIMP_LAYER_COLOR_SPACE_RGB_PERCEPTUAL:
+      pixel[0] = linear_to_srgb (pixel[0]);
+      pixel[1] = linear_to_srgb (pixel[1]);
+      pixel[2] = linear_to_srgb (pixel[2]);
+      break;
+
+    case GIMP_LAYER_COLOR_SPACE_LAB:
+      rgb_to_lab (converter, pixel);
+      break;
+
+    default:
+      break;
+    }
+}
+
+/*  the perceptual TRC is always the sRGB TRC, while the non-linear TRC
+ *  is that of the format's space, which we only handle for sRGB.
+ */
+static gboolean
+space_is_supported (GimpLayerColorSpace  space,
+                    const Babl          *format)
+{
+  switch (space)
+    {
+    case GIMP_LAYER_COLOR_SPACE_RGB_LINEAR:
+    case GIMP_LAYER_COLOR_SPACE_RGB_PERCEPTUAL:
+    case GIMP_LAYER_COLOR_SPACE_LAB:
+      return TRUE;
+
+    case GIMP_LAYER_COLOR_SPACE_RGB_NON_LINEAR:
+      return babl_format_get_space (format) == babl_space ("sRGB");
+
+    default:
+      return FALSE;
+    }
+}
+
+static void
+matrix_invert (const gdouble m[9],
+               gdouble       inv[9])
+{
+  gdouble det;
+  gint    i;
+
+  inv[0] =   m[4] * m[8] - m[5] * m[7];
+  inv[1] = -(m[1] * m[8] - m[2] * m[7]);
+  inv[2] =   m[1] * m[5] - m[2] * m[4];
+  inv[3] = -(m[3] * m[8] - m[5] * m[6]);
+  inv[4] =   m[0] * m[8] - m[2] * m[6];
+  inv[5] = -(m[0] * m[5] - m[2] * m[3]);
+  inv[6] =   m[3] * m[7] - m[4] * m[6];
+  inv[7] = -(m[0] * m[7] - m[1] * m[6]);
+  inv[8] =   m[0] * m[4] - m[1] * m[3];
+
+  det = m[0] * inv[0] + m[1] * inv[3] + m[2] * inv[6];
+
+  for (i = 0; i < 9; i++)
+    inv[i] /= det;
+}
+
+
+/*  public functions  */
+
+gboolean
+gimp_operation_layer_mode_converter_init (GimpLayerModeConverter *converter,
+                                          GimpLayerColorSpace     from_space,
+                                          GimpLayerColorSpace     to_space,
+                                          const Babl             *format)
+{
+  static gsize luts_initialized = 0;
+
+  g_return_val_if_fail (converter != NULL, FALSE);
+  g_return_val_if_fail (format != NULL, FALSE);
+
+  converter->from_space = GIMP_LAYER_COLOR_SPACE_AUTO;
+  converter->to_space   = GIMP_LAYER_COLOR_SPACE_AUTO;
+
+  if (from_space == to_space                     ||
+      ! space_is_supported (from_space, format) ||
+      ! space_is_supported (to_space,   format))
+    {
+      return FALSE;
+    }
+
+  if (g_once_init_enter (&luts_initialized))
+    {
+      lut_init (to_linear_lut,   TO_LINEAR_MIN_EXP,   0, srgb_to_linear_exact);
+      lut_init (from_linear_lut, FROM_LINEAR_MIN_EXP, 0, linear_to_srgb_exact);
+      lut_init (cbrt_lut,        CBRT_MIN_EXP, CBRT_MAX_EXP, cbrt);
+
+      g_once_init_leave (&luts_initialized, 1);
+    }
+
+  if (from_space == GIMP_LAYER_COLOR_SPACE_LAB ||
+      to_space   == GIMP_LAYER_COLOR_SPACE_LAB)
+    {
+      const gdouble *rgb_to_xyz;
+      gdouble        xyz_to_rgb[9];
+      gint           i;
+
+      rgb_to_xyz = babl_space_get_rgbtoxyz (babl_format_get_space (format));
+
+      matrix_invert (rgb_to_xyz, xyz_to_rgb);
+
+      for (i = 0; i < 9; i++)
+        {
+          converter->rgb_to_xyz[i / 3][i % 3] = rgb_to_xyz[i];
+          converter->xyz_to_rgb[i / 3][i % 3] = xyz_to_rgb[i];
+        }
+    }
+
+  converter->from_space = from_space;
+  converter->to_space   = to_space;
+
+  return TRUE;
+}
+
+/*  converts RGBA/Lab-alpha samples, going through linear RGB when neither
+ *  space is linear.  'src' and 'dest' may be the same buffer.
+ */
+void
+gimp_operation_layer_mode_converter_process (const GimpLayerModeConverter *converter,
+                                             const gfloat                 *src,
+                                             gfloat                       *dest,
+                                             gint                          samples)
+{
+  while (samples--)
+    {
+      gfloat pixel[3] = { src[0], src[1], src[2] };
+
+      to_linear   (converter, pixel);
+      from_linear (converter, pixel);
+
+      dest[0] = pixel[0];
+      dest[1] = pixel[1];
+      dest[2] = pixel[2];
+      dest[3] = src[3];
+
+      src  += 4;
+      dest += 4;
+    }
+}
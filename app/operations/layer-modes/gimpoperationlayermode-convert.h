@@ -0,0 +1,48 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimpoperationlayermode-convert.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+
+typedef struct _GimpLayerModeConverter GimpLayerModeConverter;
+
+/*  a conversion between the composite and blend spaces of a layer mode,
+ *  performed without going through babl.  a converter whose from_space
+ *  is GIMP_LAYER_COLOR_SPACE_AUTO can't be used, and the corresponding
+ *  babl fish should be used instead.
+ */
+struct _GimpLayerModeConverter
+{
+  GimpLayerColorSpace from_space;
+  GimpLayerColorSpace to_space;
+
+  gfloat              rgb_to_xyz[3][3];
+  gfloat              xyz_to_rgb[3][3];
+};
+
+
+gboolean gimp_operation_layer_mode_converter_init    (GimpLayerModeConverter       *converter,
+                                                      GimpLayerColorSpace           from_space,
+                                                      GimpLayerColorSpace           to_space,
+                                                      const Babl                   *format);
+
+void     gimp_operation_layer_mode_converter_process (const GimpLayerModeConverter *converter,
+                                                      const gfloat                 *src,
+                                                      gfloat                       *dest,
+                                                      gint                          samples);
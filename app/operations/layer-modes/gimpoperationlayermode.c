@@ -31,6 +31,7 @@
 
 #include "gimp-layer-modes.h"
 #include "gimpoperationlayermode.h"
+#include "gimpoperationlayermode-blend.h"
 #include "gimpoperationlayermode-composite.h"
 
 
@@ -47,6 +48,13 @@
  */
 #define GIMP_COMPOSITE_BLEND_SPLIT_THRESHOLD 32
 
+/* the number of samples to convert, blend and composite at a time when
+ * the conversion between the composite and blend spaces doesn't go
+ * through babl, chosen so that all the intermediate buffers stay in the
+ * L1 cache.
+ */
+#define GIMP_COMPOSITE_BLEND_FUSED_SAMPLES 256
+
 
 enum
 {
@@ -119,11 +127,32 @@ static gboolean        process_last_node                             (GeglOperat
                                                                       const GeglRectangle *roi,
                                                                       gint                 level);
 
-static void            gimp_operation_layer_mode_cache_fishes        (GimpOperationLayerMode  *op,
-                                                                      const Babl              *preferred_format,
-                                                                      const Babl             **out_format,
-                                                                      const Babl             **composite_to_blend_fish,
-                                                                      const Babl             **blend_to_composite_fish);
+static gboolean        process_fused                                 (GimpOperationLayerMode       *layer_mode,
+                                                                      const GimpLayerModeConverter *composite_to_blend,
+                                                                      const GimpLayerModeConverter *blend_to_composite,
+                                                                      gfloat                       *in,
+                                                                      gfloat                       *layer,
+                                                                      gfloat                       *mask,
+                                                                      gfloat                       *out,
+                                                                      glong                         samples);
+
+static void            composite_samples                             (GimpOperationLayerMode  *layer_mode,
+                                                                      const gfloat            *in,
+                                                                      const gfloat            *layer,
+                                                                      const gfloat            *comp,
+                                                                      const gfloat            *mask,
+                                                                      gfloat                   opacity,
+                                                                      gint                     n_components,
+                                                                      gfloat                  *out,
+                                                                      gint                     samples);
+
+static void            gimp_operation_layer_mode_cache_fishes        (GimpOperationLayerMode         *op,
+                                                                      const Babl                     *preferred_format,
+                                                                      const Babl                    **out_format,
+                                                                      const Babl                    **composite_to_blend_fish,
+                                                                      const Babl                    **blend_to_composite_fish,
+                                                                      const GimpLayerModeConverter  **composite_to_blend_converter,
+                                                                      const GimpLayerModeConverter  **blend_to_composite_converter);
 
 
 G_DEFINE_TYPE (GimpOperationLayerMode, gimp_operation_layer_mode,
@@ -211,6 +240,26 @@ gimp_operation_layer_mode_class_init (GimpOperationLayerModeClass *klass)
   if (gimp_cpu_accel_get_support () & GIMP_CPU_ACCEL_X86_SSE2)
     composite_clip_to_backdrop = gimp_operation_layer_mode_composite_clip_to_backdrop_sse2;
 #endif
+
+#if COMPILE_SSE4_1_INTRINISICS
+  if (gimp_cpu_accel_get_support () & GIMP_CPU_ACCEL_X86_SSE4_1)
+    {
+      composite_union            = gimp_operation_layer_mode_composite_union_sse4;
+      composite_clip_to_backdrop = gimp_operation_layer_mode_composite_clip_to_backdrop_sse4;
+      composite_clip_to_layer    = gimp_operation_layer_mode_composite_clip_to_layer_sse4;
+      composite_intersection     = gimp_operation_layer_mode_composite_intersection_sse4;
+    }
+#endif
+
+#if COMPILE_AVX2_INTRINISICS
+  if (gimp_cpu_accel_get_support () & GIMP_CPU_ACCEL_X86_AVX2)
+    {
+      composite_union            = gimp_operation_layer_mode_composite_union_avx2;
+      composite_clip_to_backdrop = gimp_operation_layer_mode_composite_clip_to_backdrop_avx2;
+      composite_clip_to_layer    = gimp_operation_layer_mode_composite_clip_to_layer_avx2;
+      composite_intersection     = gimp_operation_layer_mode_composite_intersection_avx2;
+    }
+#endif
 }
 
 static void
@@ -322,6 +371,9 @@ gimp_operation_layer_mode_prepare (GeglOperation *operation)
 
   self->function       = gimp_layer_mode_get_function       (self->layer_mode);
   self->blend_function = gimp_layer_mode_get_blend_function (self->layer_mode);
+  self->blend_function =
+    gimp_operation_layer_mode_blend_get_accelerated (self->blend_function,
+                                                     gimp_cpu_accel_get_support ());
 
   input_extent = gegl_operation_source_get_bounding_box (operation, "input");
   mask_extent  = gegl_operation_source_get_bounding_box (operation, "aux2");
@@ -361,7 +413,8 @@ gimp_operation_layer_mode_prepare (GeglOperation *operation)
 
   self->has_mask = mask_extent && ! gegl_rectangle_is_empty (mask_extent);
 
-  gimp_operation_layer_mode_cache_fishes (self, preferred_format, &format, NULL, NULL);
+  gimp_operation_layer_mode_cache_fishes (self, preferred_format, &format,
+                                          NULL, NULL, NULL, NULL);
 
   gegl_operation_set_format (operation, "input",  format);
   gegl_operation_set_format (operation, "output", format);
@@ -620,23 +673,46 @@ gimp_operation_layer_mode_real_process (GeglOperation       *operation,
                                         const GeglRectangle *roi,
                                         gint                 level)
 {
-  GimpOperationLayerMode *layer_mode              = (gpointer) operation;
-  const Babl             *format                  = gegl_operation_get_format (operation, "output");
-  gfloat                 *in                      = in_p;
-  gfloat                 *out                     = out_p;
-  gfloat                 *layer                   = layer_p;
-  gfloat                 *mask                    = mask_p;
-  const gint              n_components            = babl_format_get_n_components (format);
-  const gint              alpha                   = n_components - 1;
-  gfloat                  opacity                 = layer_mode->opacity;
-  GimpLayerCompositeMode  composite_mode          = layer_mode->composite_mode;
-  GimpLayerModeBlendFunc  blend_function          = layer_mode->blend_function;
-  gboolean                composite_needs_in_color;
-  gfloat                 *blend_in;
-  gfloat                 *blend_layer;
-  gfloat                 *blend_out;
-  const Babl             *composite_to_blend_fish = NULL;
-  const Babl             *blend_to_composite_fish = NULL;
+  GimpOperationLayerMode       *layer_mode                   = (gpointer) operation;
+  const Babl                   *format                       = gegl_operation_get_format (operation, "output");
+  gfloat                       *in                           = in_p;
+  gfloat                       *out                          = out_p;
+  gfloat                       *layer                        = layer_p;
+  gfloat                       *mask                         = mask_p;
+  const gint                    n_components                 = babl_format_get_n_components (format);
+  const gint                    alpha                        = n_components - 1;
+  gfloat                        opacity                      = layer_mode->opacity;
+  GimpLayerCompositeMode        composite_mode               = layer_mode->composite_mode;
+  GimpLayerModeBlendFunc        blend_function               = layer_mode->blend_function;
+  gboolean                      composite_needs_in_color;
+  gfloat                       *blend_in;
+  gfloat                       *blend_layer;
+  gfloat                       *blend_out;
+  const Babl                   *composite_to_blend_fish      = NULL;
+  const Babl                   *blend_to_composite_fish      = NULL;
+  const GimpLayerModeConverter *composite_to_blend_converter;
+  const GimpLayerModeConverter *blend_to_composite_converter;
+
+  /* Make sure the cache is set up from the start as the
+   * operation's prepare() method may have not been run yet.
+   */
+  gimp_operation_layer_mode_cache_fishes (layer_mode, NULL, NULL,
+                                          &composite_to_blend_fish,
+                                          &blend_to_composite_fish,
+                                          &composite_to_blend_converter,
+                                          &blend_to_composite_converter);
+
+  /* if we can convert between the composite and blend spaces ourselves,
+   * do the whole process in small chunks, without going through babl.
+   */
+  if (composite_to_blend_converter && blend_to_composite_converter &&
+      n_components == 4)
+    {
+      return process_fused (layer_mode,
+                            composite_to_blend_converter,
+                            blend_to_composite_converter,
+                            in, layer, mask, out, samples);
+    }
 
   /* make sure we don't process more than GIMP_COMPOSITE_BLEND_MAX_SAMPLES
    * at a time, so that we don't overflow the stack if we allocate buffers
@@ -667,13 +743,6 @@ gimp_operation_layer_mode_real_process (GeglOperation       *operation,
   blend_layer = layer;
   blend_out   = out;
 
-  /* Make sure the cache is set up from the start as the
-   * operation's prepare() method may have not been run yet.
-   */
-  gimp_operation_layer_mode_cache_fishes (layer_mode, NULL, NULL,
-                                          &composite_to_blend_fish,
-                                          &blend_to_composite_fish);
-
   /* if we need to convert the samples between the composite and blend
    * spaces...
    */
@@ -791,28 +860,147 @@ gimp_operation_layer_mode_real_process (GeglOperation       *operation,
       blend_function (operation, blend_in, blend_layer, blend_out, samples);
     }
 
+  composite_samples (layer_mode, in, layer, blend_out, mask, opacity,
+                     n_components, out, samples);
+
+  return TRUE;
+}
+
+static gboolean
+process_fused (GimpOperationLayerMode       *layer_mode,
+               const GimpLayerModeConverter *composite_to_blend,
+               const GimpLayerModeConverter *blend_to_composite,
+               gfloat                       *in,
+               gfloat                       *layer,
+               gfloat                       *mask,
+               gfloat                       *out,
+               glong                         samples)
+{
+  GeglOperation          *operation      = GEGL_OPERATION (layer_mode);
+  GimpLayerModeBlendFunc  blend_function = layer_mode->blend_function;
+  gfloat                  opacity        = layer_mode->opacity;
+  gfloat                  blend_in[4 * GIMP_COMPOSITE_BLEND_FUSED_SAMPLES];
+  gfloat                  blend_layer[4 * GIMP_COMPOSITE_BLEND_FUSED_SAMPLES];
+  gfloat                  blend_out[4 * GIMP_COMPOSITE_BLEND_FUSED_SAMPLES];
+
+  while (samples > 0)
+    {
+      gint count = MIN (samples, GIMP_COMPOSITE_BLEND_FUSED_SAMPLES);
+      gint end   = 4 * count + 3;
+      gint i     = 3;
+
+      /* as in the babl path, split the chunk around runs of
+       * GIMP_COMPOSITE_BLEND_SPLIT_THRESHOLD or more unblended samples, and
+       * only convert and blend the rest.
+       */
+      while (TRUE)
+        {
+          gint first;
+          gint last;
+          gint n;
+
+          /* skip any unblended samples.  the color values of `blend_out` for
+           * these samples are unconstrained, but the alpha values should be
+           * 0, as in the babl path.
+           */
+          while (i < end && (in[i] == 0.0f || layer[i] == 0.0f))
+            {
+              blend_out[i] = 0.0f;
+              i += 4;
+            }
+
+          if (i == end)
+            break;
+
+          first  = i;
+          i     += 4;
+          last   = i;
+
+          while (i < end &&
+                 i - last < 4 * GIMP_COMPOSITE_BLEND_SPLIT_THRESHOLD)
+            {
+              gboolean blended;
+
+              blended = (in[i] != 0.0f && layer[i] != 0.0f);
+
+              i += 4;
+              if (blended)
+                last = i;
+            }
+
+          /* convert and blend the samples in the range [first, last) */
+
+          n      = (last - first) / 4;
+          first -= 3;
+
+          gimp_operation_layer_mode_converter_process (composite_to_blend,
+                                                       in + first,
+                                                       blend_in + first, n);
+          gimp_operation_layer_mode_converter_process (composite_to_blend,
+                                                       layer + first,
+                                                       blend_layer + first, n);
+
+          blend_function (operation, blend_in + first, blend_layer + first,
+                          blend_out + first, n);
+
+          gimp_operation_layer_mode_converter_process (blend_to_composite,
+                                                       blend_out + first,
+                                                       blend_out + first, n);
+
+          for (; last < i; last += 4)
+            blend_out[last] = 0.0f;
+        }
+
+      composite_samples (layer_mode, in, layer, blend_out, mask, opacity,
+                         4, out, count);
+
+      in      += 4 * count;
+      layer   += 4 * count;
+      if (mask)
+        mask  +=     count;
+      out     += 4 * count;
+
+      samples -= count;
+    }
+
+  return TRUE;
+}
+
+static void
+composite_samples (GimpOperationLayerMode *layer_mode,
+                   const gfloat           *in,
+                   const gfloat           *layer,
+                   const gfloat           *comp,
+                   const gfloat           *mask,
+                   gfloat                  opacity,
+                   gint                    n_components,
+                   gfloat                 *out,
+                   gint                    samples)
+{
+  GimpLayerCompositeMode composite_mode = layer_mode->composite_mode;
+
   if (! gimp_layer_mode_is_subtractive (layer_mode->layer_mode))
     {
       switch (composite_mode)
         {
         case GIMP_LAYER_COMPOSITE_UNION:
         case GIMP_LAYER_COMPOSITE_AUTO:
-          composite_union (in, layer, blend_out, mask, opacity,
+          composite_union (in, layer, comp, mask, opacity,
                            n_components, out, samples);
           break;
 
         case GIMP_LAYER_COMPOSITE_CLIP_TO_BACKDROP:
-          composite_clip_to_backdrop (in, layer, blend_out, mask, opacity,
+          composite_clip_to_backdrop (in, layer, comp, mask, opacity,
                                       n_components, out, samples);
           break;
 
         case GIMP_LAYER_COMPOSITE_CLIP_TO_LAYER:
-          composite_clip_to_layer (in, layer, blend_out, mask, opacity,
+          composite_clip_to_layer (in, layer, comp, mask, opacity,
                                    n_components, out, samples);
           break;
 
         case GIMP_LAYER_COMPOSITE_INTERSECTION:
-          composite_intersection (in, layer, blend_out, mask, opacity,
+          composite_intersection (in, layer, comp, mask, opacity,
                                   n_components, out, samples);
           break;
         }
@@ -823,28 +1011,26 @@ gimp_operation_layer_mode_real_process (GeglOperation       *operation,
         {
         case GIMP_LAYER_COMPOSITE_UNION:
         case GIMP_LAYER_COMPOSITE_AUTO:
-          composite_union_sub (in, layer, blend_out, mask, opacity,
+          composite_union_sub (in, layer, comp, mask, opacity,
                                n_components, out, samples);
           break;
 
         case GIMP_LAYER_COMPOSITE_CLIP_TO_BACKDROP:
-          composite_clip_to_backdrop_sub (in, layer, blend_out, mask, opacity,
+          composite_clip_to_backdrop_sub (in, layer, comp, mask, opacity,
                                           n_components, out, samples);
           break;
 
         case GIMP_LAYER_COMPOSITE_CLIP_TO_LAYER:
-          composite_clip_to_layer_sub (in, layer, blend_out, mask, opacity,
+          composite_clip_to_layer_sub (in, layer, comp, mask, opacity,
                                        n_components, out, samples);
           break;
 
         case GIMP_LAYER_COMPOSITE_INTERSECTION:
-          composite_intersection_sub (in, layer, blend_out, mask, opacity,
+          composite_intersection_sub (in, layer, comp, mask, opacity,
                                       n_components, out, samples);
           break;
         }
     }
-
-  return TRUE;
 }
 
 static gboolean
@@ -881,14 +1067,18 @@ process_last_node (GeglOperation       *operation,
 }
 
 static void
-gimp_operation_layer_mode_cache_fishes (GimpOperationLayerMode  *op,
-                                        const Babl              *preferred_format,
-                                        const Babl             **layer_mode_format,
-                                        const Babl             **composite_to_blend_fish,
-                                        const Babl             **blend_to_composite_fish)
+gimp_operation_layer_mode_cache_fishes (GimpOperationLayerMode         *op,
+                                        const Babl                     *preferred_format,
+                                        const Babl                    **layer_mode_format,
+                                        const Babl                    **composite_to_blend_fish,
+                                        const Babl                    **blend_to_composite_fish,
+                                        const GimpLayerModeConverter  **composite_to_blend_converter,
+                                        const GimpLayerModeConverter  **blend_to_composite_converter)
 {
-  const Babl *format;
-  gboolean    update_cache = FALSE;
+  const Babl          *format;
+  gboolean             update_cache = FALSE;
+  GimpLayerColorSpace  from;
+  GimpLayerColorSpace  to;
 
   g_rw_lock_reader_lock (&op->cache_lock);
 
@@ -1011,6 +1201,20 @@ gimp_operation_layer_mode_cache_fishes (GimpOperationLayerMode  *op,
             /* to   */ [GIMP_LAYER_COLOR_SPACE_RGB_PERCEPTUAL - 1] =
             babl_fish (babl_format_with_space("R'G'B'A float", format),
                        babl_format_with_space ( "R~G~B~A float", format));
+
+          for (from = GIMP_LAYER_COLOR_SPACE_RGB_LINEAR;
+               from < GIMP_LAYER_COLOR_SPACE_LAST;
+               from++)
+            {
+              for (to = GIMP_LAYER_COLOR_SPACE_RGB_LINEAR;
+                   to < GIMP_LAYER_COLOR_SPACE_LAST;
+                   to++)
+                {
+                  gimp_operation_layer_mode_converter_init (
+                    &op->space_converter[from - 1][to - 1],
+                    from, to, format);
+                }
+            }
         }
     }
 
@@ -1032,6 +1236,36 @@ gimp_operation_layer_mode_cache_fishes (GimpOperationLayerMode  *op,
       else
         *blend_to_composite_fish = NULL;
     }
+  if (composite_to_blend_converter)
+    {
+      *composite_to_blend_converter = NULL;
+
+      if (op->blend_space != GIMP_LAYER_COLOR_SPACE_AUTO &&
+          op->composite_space != GIMP_LAYER_COLOR_SPACE_AUTO)
+        {
+          const GimpLayerModeConverter *converter;
+
+          converter = &op->space_converter[op->composite_space - 1][op->blend_space - 1];
+
+          if (converter->from_space != GIMP_LAYER_COLOR_SPACE_AUTO)
+            *composite_to_blend_converter = converter;
+        }
+    }
+  if (blend_to_composite_converter)
+    {
+      *blend_to_composite_converter = NULL;
+
+      if (op->blend_space != GIMP_LAYER_COLOR_SPACE_AUTO &&
+          op->composite_space != GIMP_LAYER_COLOR_SPACE_AUTO)
+        {
+          const GimpLayerModeConverter *converter;
+
+          converter = &op->space_converter[op->blend_space - 1][op->composite_space - 1];
+
+          if (converter->from_space != GIMP_LAYER_COLOR_SPACE_AUTO)
+            *blend_to_composite_converter = converter;
+        }
+    }
 
   if (update_cache)
     g_rw_lock_writer_unlock (&op->cache_lock);
@@ -22,6 +22,8 @@
 
 #include <gegl-plugin.h>
 
+#include "gimpoperationlayermode-convert.h"
+
 
 #define GIMP_TYPE_OPERATION_LAYER_MODE            (gimp_operation_layer_mode_get_type ())
 #define GIMP_OPERATION_LAYER_MODE(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), GIMP_TYPE_OPERATION_LAYER_MODE, GimpOperationLayerMode))
@@ -44,6 +46,7 @@ struct _GimpOperationLayerMode
   GimpLayerCompositeMode       composite_mode;
   const Babl                  *cached_fish_format;
   const Babl                  *space_fish[4 /* from */][4 /* to */];
+  GimpLayerModeConverter       space_converter[4 /* from */][4 /* to */];
   GRWLock                      cache_lock;
 
   gdouble                      prop_opacity;
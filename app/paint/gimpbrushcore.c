@@ -48,10 +48,14 @@
 #include "gimppaintoptions.h"
 
 #include "gimp-intl.h"
+#include "gimp-log.h"
 
 
 #define EPSILON  0.00001
 
+/* weight of the most recent dab in the moving dab-time average */
+#define DAB_TIME_WEIGHT 0.25
+
 enum
 {
   SET_BRUSH,
@@ -106,6 +110,10 @@ static const GimpTempBuf *
                  gimp_brush_core_transform_mask     (GimpBrushCore     *core,
                                                      GimpBrush         *brush);
 
+static void      gimp_brush_core_add_dab_time       (const GimpTempBuf *brush_mask,
+                                                     gint64             start_time,
+                                                     gint64             mask_time);
+
 static void      gimp_brush_core_invalidate_cache   (GimpBrush         *brush,
                                                      GimpBrushCore     *core);
 
@@ -116,6 +124,10 @@ G_DEFINE_TYPE (GimpBrushCore, gimp_brush_core, GIMP_TYPE_PAINT_CORE)
 
 static guint core_signals[LAST_SIGNAL] = { 0, };
 
+G_LOCK_DEFINE_STATIC (dab_time);
+
+static gdouble gimp_brush_core_dab_time = 0.0;
+
 
 static void
 gimp_brush_core_class_init (GimpBrushCoreClass *klass)
@@ -975,11 +987,17 @@ gimp_brush_core_paste_canvas (GimpBrushCore            *core,
                               GimpPaintApplicationMode  mode)
 {
   const GimpTempBuf *brush_mask;
+  gint64             start_time;
+  gint64             mask_time;
+
+  start_time = g_get_monotonic_time ();
 
   brush_mask = gimp_brush_core_get_brush_mask (core, coords,
                                                brush_hardness,
                                                dynamic_force);
 
+  mask_time = g_get_monotonic_time ();
+
   if (brush_mask)
     {
       GimpPaintCore *paint_core = GIMP_PAINT_CORE (core);
@@ -1001,6 +1019,8 @@ gimp_brush_core_paste_canvas (GimpBrushCore            *core,
                              image_opacity,
                              paint_mode,
                              mode);
+
+      gimp_brush_core_add_dab_time (brush_mask, start_time, mask_time);
     }
 }
 
@@ -1019,11 +1039,17 @@ gimp_brush_core_replace_canvas (GimpBrushCore            *core,
                                 GimpPaintApplicationMode  mode)
 {
   const GimpTempBuf *brush_mask;
+  gint64             start_time;
+  gint64             mask_time;
+
+  start_time = g_get_monotonic_time ();
 
   brush_mask = gimp_brush_core_get_brush_mask (core, coords,
                                                brush_hardness,
                                                dynamic_force);
 
+  mask_time = g_get_monotonic_time ();
+
   if (brush_mask)
     {
       GimpPaintCore *paint_core = GIMP_PAINT_CORE (core);
@@ -1044,9 +1070,58 @@ gimp_brush_core_replace_canvas (GimpBrushCore            *core,
                                brush_opacity,
                                image_opacity,
                                mode);
+
+      gimp_brush_core_add_dab_time (brush_mask, start_time, mask_time);
     }
 }
 
+/**
+ * gimp_brush_core_get_dab_time:
+ *
+ * Returns a moving average of the time, in seconds, it took to
+ * generate and paste the most recent brush dabs.  Used by the
+ * dashboard.
+ *
+ * Returns: the average dab time.
+ **/
+gdouble
+gimp_brush_core_get_dab_time (void)
+{
+  gdouble dab_time;
+
+  G_LOCK (dab_time);
+
+  dab_time = gimp_brush_core_dab_time;
+
+  G_UNLOCK (dab_time);
+
+  return dab_time;
+}
+
+
+static void
+gimp_brush_core_add_dab_time (const GimpTempBuf *brush_mask,
+                              gint64             start_time,
+                              gint64             mask_time)
+{
+  gint64  end_time = g_get_monotonic_time ();
+  gdouble dab_time;
+
+  dab_time = (end_time - start_time) / (gdouble) G_TIME_SPAN_SECOND;
+
+  G_LOCK (dab_time);
+
+  gimp_brush_core_dab_time +=
+    DAB_TIME_WEIGHT * (dab_time - gimp_brush_core_dab_time);
+
+  G_UNLOCK (dab_time);
+
+  GIMP_LOG (PAINT, "%dx%d dab: mask %.3f ms, paste %.3f ms",
+            gimp_temp_buf_get_width  (brush_mask),
+            gimp_temp_buf_get_height (brush_mask),
+            (mask_time - start_time) / 1000.0,
+            (end_time  - mask_time)  / 1000.0);
+}
 
 static void
 gimp_brush_core_invalidate_cache (GimpBrush     *brush,
@@ -119,6 +119,8 @@ void   gimp_brush_core_replace_canvas (GimpBrushCore            *core,
                                        gdouble                   dynamic_hardness,
                                        GimpPaintApplicationMode  mode);
 
+gdouble gimp_brush_core_get_dab_time  (void);
+
 void   gimp_brush_core_color_area_with_pixmap
                                       (GimpBrushCore            *core,
                                        GimpDrawable             *drawable,
@@ -21,7 +21,6 @@
 
 #include "config.h"
 
-#include <stdint.h>
 #include <string.h>
 
 #include <gdk-pixbuf/gdk-pixbuf.h>
@@ -49,6 +48,15 @@
 #include "gimp-intl.h"
 
 
+#define PIXELS_PER_THREAD \
+  (/* each thread costs as much as */ 64.0 * 64.0 /* pixels */)
+
+#define MAX_LEVELS     16
+#define MIN_LEVEL_SIZE 16 /* pixels */
+#define PRE_SWEEPS     2
+#define POST_SWEEPS    2
+#define COARSE_SWEEPS  32
+
 
 /* NOTES
  *
@@ -57,9 +65,9 @@
  * but subtract them I2 = I0 - I1, where I0 is the sample image to be
  * corrected, I1 is the reference pattern. Then we solve DeltaI=0
  * (Laplace) with I2 Dirichlet conditions at the borders of the
- * mask. The solver is a red/black checker Gauss-Seidel with over-relaxation.
- * It could benefit from a multi-grid evaluation of an initial solution
- * before the main iteration loop.
+ * mask. The solver runs multigrid V-cycles, with red/black checker
+ * Gauss-Seidel sweeps as the smoother, so that the number of cycles
+ * needed does not grow with the size of the brush.
  *
  * I reduced the convergence criteria to 0.1% (0.001) as we are
  * dealing here with RGB integer components, more is overkill.
@@ -271,158 +279,420 @@ gimp_heal_add (GeglBuffer          *first_buffer,
     }
 }
 
-#if defined(__SSE__) && defined(__GNUC__) && __GNUC__ >= 4
-static float
-gimp_heal_laplace_iteration_sse (gfloat *pixels,
-                                 gfloat *Adiag,
-                                 gint   *Aidx,
-                                 gfloat  w,
-                                 gint    nmask)
+/* The solver works on a pyramid of levels.  Level 0 holds the image
+ * difference itself, whose unmasked pixels act as the Dirichlet
+ * boundary; the coarser levels hold corrections to the level above,
+ * with a zero boundary.
+ */
+typedef struct
+{
+  gint          width;
+  gint          height;
+  const guchar *mask;
+  gfloat       *x;
+  gfloat       *b;   /* right-hand side, NULL on level 0 */
+  gfloat       *r;   /* residual */
+} GimpHealLevel;
+
+typedef struct
+{
+  GimpHealLevel *fine;
+  GimpHealLevel *coarse;
+  gint           depth;
+  gint           parity;
+  gdouble       *row_err;
+} GimpHealPass;
+
+
+/* Sum the pixels' in-canvas neighbors, and return their number.  Neighbors
+ * off the edge of the canvas are omitted, rather than treated as Dirichlet
+ * conditions.
+ */
+static inline gint
+gimp_heal_level_neighbors (const GimpHealLevel *level,
+                           gint                 depth,
+                           gint                 i,
+                           gint                 y,
+                           gfloat              *sum)
 {
-  typedef float v4sf __attribute__((vector_size(16)));
-  gint i;
-  v4sf wv  = { w, w, w, w };
-  v4sf err = { 0, 0, 0, 0 };
-  union { v4sf v; float f[4]; } erru;
+  const gfloat *x      = level->x + (y * level->width + i) * depth;
+  gint          stride = level->width * depth;
+  gint          n      = 0;
+  gint          k;
 
-#define Xv(j) (*(v4sf*)&pixels[Aidx[i * 5 + j]])
+  for (k = 0; k < depth; k++)
+    sum[k] = 0.0f;
 
-  for (i = 0; i < nmask; i++)
+  if (i > 0)
     {
-      v4sf a    = { Adiag[i], Adiag[i], Adiag[i], Adiag[i] };
-      v4sf diff = a * Xv(0) - wv * (Xv(1) + Xv(2) + Xv(3) + Xv(4));
+      for (k = 0; k < depth; k++)
+        sum[k] += x[k - depth];
+      n++;
+    }
 
-      Xv(0) -= diff;
-      err += diff * diff;
+  if (i < level->width - 1)
+    {
+      for (k = 0; k < depth; k++)
+        sum[k] += x[k + depth];
+      n++;
+    }
+
+  if (y > 0)
+    {
+      for (k = 0; k < depth; k++)
+        sum[k] += x[k - stride];
+      n++;
     }
 
-  erru.v = err;
+  if (y < level->height - 1)
+    {
+      for (k = 0; k < depth; k++)
+        sum[k] += x[k + stride];
+      n++;
+    }
 
-  return erru.f[0] + erru.f[1] + erru.f[2] + erru.f[3];
+  return n;
 }
-#endif
 
-/* Perform one iteration of Gauss-Seidel, and return the sum squared residual.
+/* One red/black Gauss-Seidel half-sweep.  Cells of one color only depend
+ * on cells of the other color, so the rows can be updated in parallel.
  */
-static float
-gimp_heal_laplace_iteration (gfloat *pixels,
-                             gfloat *Adiag,
-                             gint   *Aidx,
-                             gfloat  w,
-                             gint    nmask,
-                             gint    depth)
+static void
+gimp_heal_smooth_rows (gsize         offset,
+                       gsize         size,
+                       GimpHealPass *pass)
 {
-  gint   i, k;
-  gfloat err = 0;
+  const GimpHealLevel *level = pass->fine;
+  gint                 depth = pass->depth;
+  gint                 y;
+
+  for (y = offset; y < offset + size; y++)
+    {
+      gint i;
 
-#if defined(__SSE__) && defined(__GNUC__) && __GNUC__ >= 4
-  if (depth == 4)
-    return gimp_heal_laplace_iteration_sse (pixels, Adiag, Aidx, w, nmask);
-#endif
+      for (i = (y + pass->parity) & 1; i < level->width; i += 2)
+        {
+          gint   o = (y * level->width + i) * depth;
+          gfloat sum[4];
+          gfloat n;
+          gint   k;
 
-  for (i = 0; i < nmask; i++)
+          if (! level->mask[y * level->width + i])
+            continue;
+
+          n = gimp_heal_level_neighbors (level, depth, i, y, sum);
+
+          if (n == 0)
+            continue;
+
+          for (k = 0; k < depth; k++)
+            {
+              gfloat b = level->b ? level->b[o + k] : 0.0f;
+
+              level->x[o + k] = (b + sum[k]) / n;
+            }
+        }
+    }
+}
+
+/* Compute the residual of the masked pixels, and the sum of its squares
+ * per row.
+ */
+static void
+gimp_heal_residual_rows (gsize         offset,
+                         gsize         size,
+                         GimpHealPass *pass)
+{
+  const GimpHealLevel *level = pass->fine;
+  gint                 depth = pass->depth;
+  gint                 y;
+
+  for (y = offset; y < offset + size; y++)
     {
-      gint   j0 = Aidx[i * 5 + 0];
-      gint   j1 = Aidx[i * 5 + 1];
-      gint   j2 = Aidx[i * 5 + 2];
-      gint   j3 = Aidx[i * 5 + 3];
-      gint   j4 = Aidx[i * 5 + 4];
-      gfloat a  = Adiag[i];
+      gdouble err = 0.0;
+      gint    i;
 
-      for (k = 0; k < depth; k++)
+      for (i = 0; i < level->width; i++)
         {
-          gfloat diff = (a * pixels[j0 + k] -
-                         w * (pixels[j1 + k] +
-                              pixels[j2 + k] +
-                              pixels[j3 + k] +
-                              pixels[j4 + k]));
-
-          pixels[j0 + k] -= diff;
-          err += diff * diff;
+          gint   o = (y * level->width + i) * depth;
+          gfloat sum[4];
+          gint   n;
+          gint   k;
+
+          if (! level->mask[y * level->width + i])
+            {
+              for (k = 0; k < depth; k++)
+                level->r[o + k] = 0.0f;
+
+              continue;
+            }
+
+          n = gimp_heal_level_neighbors (level, depth, i, y, sum);
+
+          for (k = 0; k < depth; k++)
+            {
+              gfloat b = level->b ? level->b[o + k] : 0.0f;
+              gfloat r = b + sum[k] - n * level->x[o + k];
+
+              level->r[o + k] = r;
+              err += r * r;
+            }
         }
+
+      pass->row_err[y] = err;
     }
+}
+
+/* Restrict the fine residual to the coarse right-hand side.  Each coarse
+ * pixel sums its (up to) four children, which accounts for the doubled
+ * grid spacing, and is only part of the coarse mask if all of its
+ * children are.  Growing the coarse mask instead would move the boundary
+ * outwards at each level, and overshoot the correction enough for the
+ * cycles to diverge.
+ */
+static void
+gimp_heal_restrict_rows (gsize         offset,
+                         gsize         size,
+                         GimpHealPass *pass)
+{
+  const GimpHealLevel *fine   = pass->fine;
+  GimpHealLevel       *coarse = pass->coarse;
+  guchar              *mask   = (guchar *) coarse->mask;
+  gint                 depth  = pass->depth;
+  gint                 y;
+
+  for (y = offset; y < offset + size; y++)
+    {
+      gint i;
+
+      for (i = 0; i < coarse->width; i++)
+        {
+          gint o = (y * coarse->width + i) * depth;
+          gint m = 1;
+          gint fy, fi, k;
+
+          for (k = 0; k < depth; k++)
+            {
+              coarse->x[o + k] = 0.0f;
+              coarse->b[o + k] = 0.0f;
+            }
+
+          for (fy = 2 * y; fy < MIN (2 * y + 2, fine->height); fy++)
+            for (fi = 2 * i; fi < MIN (2 * i + 2, fine->width); fi++)
+              {
+                gint fo = (fy * fine->width + fi) * depth;
+
+                if (! fine->mask[fy * fine->width + fi])
+                  m = 0;
+
+                for (k = 0; k < depth; k++)
+                  coarse->b[o + k] += fine->r[fo + k];
+              }
+
+          mask[y * coarse->width + i] = m;
+        }
+    }
+}
+
+/* Interpolate the coarse correction bilinearly, and add it to the masked
+ * fine pixels.
+ */
+static void
+gimp_heal_prolong_rows (gsize         offset,
+                        gsize         size,
+                        GimpHealPass *pass)
+{
+  GimpHealLevel       *fine   = pass->fine;
+  const GimpHealLevel *coarse = pass->coarse;
+  gint                 depth  = pass->depth;
+  gint                 y;
+
+  for (y = offset; y < offset + size; y++)
+    {
+      gint cy  = y / 2;
+      gint cy2 = CLAMP ((y & 1) ? cy + 1 : cy - 1, 0, coarse->height - 1);
+      gint i;
+
+      for (i = 0; i < fine->width; i++)
+        {
+          gint          ci  = i / 2;
+          gint          ci2 = CLAMP ((i & 1) ? ci + 1 : ci - 1,
+                                     0, coarse->width - 1);
+          const gfloat *c00 = coarse->x + (cy  * coarse->width + ci)  * depth;
+          const gfloat *c01 = coarse->x + (cy  * coarse->width + ci2) * depth;
+          const gfloat *c10 = coarse->x + (cy2 * coarse->width + ci)  * depth;
+          const gfloat *c11 = coarse->x + (cy2 * coarse->width + ci2) * depth;
+          gfloat       *x   = fine->x   + (y   * fine->width   + i)   * depth;
+          gint          k;
+
+          if (! fine->mask[y * fine->width + i])
+            continue;
+
+          for (k = 0; k < depth; k++)
+            {
+              x[k] += (9.0f * c00[k] +
+                       3.0f * (c01[k] + c10[k]) +
+                       c11[k]) / 16.0f;
+            }
+        }
+    }
+}
+
+static void
+gimp_heal_distribute (GimpHealLevel                   *level,
+                      GeglParallelDistributeRangeFunc  func,
+                      GimpHealPass                    *pass)
+{
+  gegl_parallel_distribute_range (level->height,
+                                  MAX (PIXELS_PER_THREAD / level->width, 1),
+                                  func, pass);
+}
+
+static void
+gimp_heal_smooth (GimpHealLevel *level,
+                  gint           depth,
+                  gint           n_sweeps)
+{
+  GimpHealPass pass = { level, NULL, depth, 0, NULL };
+
+  while (n_sweeps--)
+    {
+      for (pass.parity = 0; pass.parity < 2; pass.parity++)
+        {
+          gimp_heal_distribute (level,
+                                (GeglParallelDistributeRangeFunc)
+                                gimp_heal_smooth_rows,
+                                &pass);
+        }
+    }
+}
+
+/* Return the sum squared residual of the level.
+ */
+static gdouble
+gimp_heal_residual (GimpHealLevel *level,
+                    gint           depth,
+                    gdouble       *row_err)
+{
+  GimpHealPass pass = { level, NULL, depth, 0, row_err };
+  gdouble      err  = 0.0;
+  gint         y;
+
+  gimp_heal_distribute (level,
+                        (GeglParallelDistributeRangeFunc)
+                        gimp_heal_residual_rows,
+                        &pass);
+
+  for (y = 0; y < level->height; y++)
+    err += row_err[y];
 
   return err;
 }
 
+static void
+gimp_heal_v_cycle (GimpHealLevel *levels,
+                   gint           n_levels,
+                   gint           depth,
+                   gdouble       *row_err)
+{
+  GimpHealPass pass = { &levels[0], &levels[1], depth, 0, row_err };
+
+  if (n_levels == 1)
+    {
+      gimp_heal_smooth (levels, depth, COARSE_SWEEPS);
+
+      return;
+    }
+
+  gimp_heal_smooth (&levels[0], depth, PRE_SWEEPS);
+
+  gimp_heal_residual (&levels[0], depth, row_err);
+
+  gimp_heal_distribute (&levels[1],
+                        (GeglParallelDistributeRangeFunc)
+                        gimp_heal_restrict_rows,
+                        &pass);
+
+  gimp_heal_v_cycle (levels + 1, n_levels - 1, depth, row_err);
+
+  gimp_heal_distribute (&levels[0],
+                        (GeglParallelDistributeRangeFunc)
+                        gimp_heal_prolong_rows,
+                        &pass);
+
+  gimp_heal_smooth (&levels[0], depth, POST_SWEEPS);
+}
+
 /* Solve the laplace equation for pixels and store the result in-place.
  */
 static void
-gimp_heal_laplace_loop (gfloat *pixels,
-                        gint    height,
-                        gint    depth,
-                        gint    width,
-                        guchar *mask)
+gimp_heal_laplace_loop (gfloat       *pixels,
+                        gint          height,
+                        gint          depth,
+                        gint          width,
+                        const guchar *mask)
 {
   /* Tolerate a total deviation-from-smoothness of 0.1 LSBs at 8bit depth. */
-#define EPSILON  (0.1/255)
-#define MAX_ITER 500
-
-  gint    i, j, iter, parity, nmask, zero;
-  gfloat *Adiag;
-  gint   *Aidx;
-  gfloat  w;
-
-  Adiag = g_new (gfloat, width * height);
-  Aidx  = g_new (gint, 5 * width * height);
-
-  /* All off-diagonal elements of A are either -1 or 0. We could store it as a
-   * general-purpose sparse matrix, but that adds some unnecessary overhead to
-   * the inner loop. Instead, assume exactly 4 off-diagonal elements in each
-   * row, all of which have value -1. Any row that in fact wants less than 4
-   * coefs can put them in a dummy column to be multiplied by an empty pixel.
+#define EPSILON    (0.1/255)
+#define MAX_CYCLES 50
+
+  GimpHealLevel levels[MAX_LEVELS];
+  gint          n_levels;
+  gdouble      *row_err;
+  gint          cycle;
+  gint          i;
+
+  levels[0].width  = width;
+  levels[0].height = height;
+  levels[0].mask   = mask;
+  levels[0].x      = pixels;
+  levels[0].b      = NULL;
+  levels[0].r      = g_new (gfloat, width * height * depth);
+
+  /* Halve the grid until it is small enough for plain relaxation to
+   * converge quickly.
    */
-  zero = depth * width * height;
-  memset (pixels + zero, 0, depth * sizeof (gfloat));
+  for (n_levels = 1; n_levels < MAX_LEVELS; n_levels++)
+    {
+      GimpHealLevel *fine   = &levels[n_levels - 1];
+      GimpHealLevel *coarse = &levels[n_levels];
+      gint           size;
 
-  /* Construct the system of equations.
-   * Arrange Aidx in checkerboard order, so that a single linear pass over that
-   * array results updating all of the red cells and then all of the black cells.
-   */
-  nmask = 0;
-  for (parity = 0; parity < 2; parity++)
-    for (i = 0; i < height; i++)
-      for (j = (i&1)^parity; j < width; j+=2)
-        if (mask[j + i * width])
-          {
-#define A_NEIGHBOR(o,di,dj) \
-            if ((dj<0 && j==0) || (dj>0 && j==width-1) || (di<0 && i==0) || (di>0 && i==height-1)) \
-              Aidx[o + nmask * 5] = zero; \
-            else                                               \
-              Aidx[o + nmask * 5] = ((i + di) * width + (j + dj)) * depth;
-
-            /* Omit Dirichlet conditions for any neighbors off the
-             * edge of the canvas.
-             */
-            Adiag[nmask] = 4 - (i==0) - (j==0) - (i==height-1) - (j==width-1);
-            A_NEIGHBOR (0,  0,  0);
-            A_NEIGHBOR (1,  0,  1);
-            A_NEIGHBOR (2,  1,  0);
-            A_NEIGHBOR (3,  0, -1);
-            A_NEIGHBOR (4, -1,  0);
-            nmask++;
-          }
-
-  /* Empirically optimal over-relaxation factor. (Benchmarked on
-   * round brushes, at least. I don't know whether aspect ratio
-   * affects it.)
-   */
-  w = 2.0 - 1.0 / (0.1575 * sqrt (nmask) + 0.8);
-  w *= 0.25;
-  for (i = 0; i < nmask; i++)
-    Adiag[i] *= w;
+      if (fine->width * fine->height <= MIN_LEVEL_SIZE)
+        break;
+
+      coarse->width  = (fine->width  + 1) / 2;
+      coarse->height = (fine->height + 1) / 2;
+
+      size = coarse->width * coarse->height;
+
+      coarse->mask = g_new (guchar, size);
+      coarse->x    = g_new (gfloat, size * depth);
+      coarse->b    = g_new (gfloat, size * depth);
+      coarse->r    = g_new (gfloat, size * depth);
+    }
+
+  row_err = g_new (gdouble, height);
 
-  /* Gauss-Seidel with successive over-relaxation */
-  for (iter = 0; iter < MAX_ITER; iter++)
+  for (cycle = 0; cycle < MAX_CYCLES; cycle++)
     {
-      gfloat err = gimp_heal_laplace_iteration (pixels, Adiag, Aidx,
-                                                w, nmask, depth);
-      if (err < EPSILON * EPSILON * w * w)
+      gimp_heal_v_cycle (levels, n_levels, depth, row_err);
+
+      if (gimp_heal_residual (&levels[0], depth, row_err) < EPSILON * EPSILON)
         break;
     }
 
-  g_free (Adiag);
-  g_free (Aidx);
+  g_free (row_err);
+
+  g_free (levels[0].r);
+
+  for (i = 1; i < n_levels; i++)
+    {
+      g_free ((guchar *) levels[i].mask);
+      g_free (levels[i].x);
+      g_free (levels[i].b);
+      g_free (levels[i].r);
+    }
 }
 
 /* Original Algorithm Design:
@@ -444,7 +714,7 @@ gimp_heal (GeglBuffer          *src_buffer,
   gint        dest_components;
   gint        width;
   gint        height;
-  gfloat     *diff, *diff_alloc;
+  gfloat     *diff;
   GeglBuffer *diff_buffer;
   guchar     *mask;
 
@@ -459,8 +729,7 @@ gimp_heal (GeglBuffer          *src_buffer,
 
   g_return_if_fail (src_components == dest_components);
 
-  diff_alloc = g_new (gfloat, 4 + (width * height + 1) * src_components);
-  diff = (gfloat*)(((uintptr_t)diff_alloc + 15) & ~15);
+  diff = g_new (gfloat, width * height * src_components);
 
   diff_buffer =
     gegl_buffer_linear_new_from_data (diff,
@@ -468,7 +737,7 @@ gimp_heal (GeglBuffer          *src_buffer,
                                                      src_components),
                                       GEGL_RECTANGLE (0, 0, width, height),
                                       GEGL_AUTO_ROWSTRIDE,
-                                      (GDestroyNotify) g_free, diff_alloc);
+                                      (GDestroyNotify) g_free, diff);
 
   /* subtract pattern from image and store the result as a float in diff */
   gimp_heal_sub (dest_buffer, dest_rect,
@@ -76,6 +76,11 @@ static void gimp_plug_in_handle_proc_uninstall   (GimpPlugIn      *plug_in,
 static void gimp_plug_in_handle_persistent_ack   (GimpPlugIn      *plug_in);
 static void gimp_plug_in_handle_has_init         (GimpPlugIn      *plug_in);
 
+static gboolean gimp_plug_in_get_tile_run_rect (GeglBuffer    *buffer,
+                                                guint          tile_num,
+                                                guint          n_tiles,
+                                                GeglRectangle *rect);
+
 
 /*  public functions  */
 
@@ -203,6 +208,7 @@ gimp_plug_in_handle_tile_put (GimpPlugIn *plug_in,
   tile_data.width       = 0;
   tile_data.height      = 0;
   tile_data.use_shm     = (plug_in->manager->shm != NULL);
+  tile_data.n_tiles     = 0;
   tile_data.data        = NULL;
 
   if (! gp_tile_data_write (plug_in->my_write, &tile_data, plug_in))
@@ -298,11 +304,15 @@ gimp_plug_in_handle_tile_put (GimpPlugIn *plug_in,
       buffer = gimp_drawable_get_buffer (drawable);
     }
 
-  if (! gimp_gegl_buffer_get_tile_rect (buffer,
-                                        GIMP_PLUG_IN_TILE_WIDTH,
-                                        GIMP_PLUG_IN_TILE_HEIGHT,
+  format = gegl_buffer_get_format (buffer);
+
+  if (! gimp_plug_in_get_tile_run_rect (buffer,
                                         tile_info->tile_num,
-                                        &tile_rect))
+                                        tile_info->n_tiles,
+                                        &tile_rect)             ||
+      tile_info->width  != tile_rect.width                      ||
+      tile_info->height != tile_rect.height                     ||
+      tile_info->bpp    != babl_format_get_bytes_per_pixel (format))
     {
       gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
                     "Plug-in \"%s\"\n(%s)\n\n"
@@ -314,8 +324,6 @@ gimp_plug_in_handle_tile_put (GimpPlugIn *plug_in,
       return;
     }
 
-  format = gegl_buffer_get_format (buffer);
-
   if (tile_data.use_shm)
     {
       gegl_buffer_set (buffer, &tile_rect, 0, format,
@@ -390,10 +398,9 @@ gimp_plug_in_handle_tile_get (GimpPlugIn *plug_in,
       buffer = gimp_drawable_get_buffer (drawable);
     }
 
-  if (! gimp_gegl_buffer_get_tile_rect (buffer,
-                                        GIMP_PLUG_IN_TILE_WIDTH,
-                                        GIMP_PLUG_IN_TILE_HEIGHT,
+  if (! gimp_plug_in_get_tile_run_rect (buffer,
                                         request->tile_num,
+                                        request->n_tiles,
                                         &tile_rect))
     {
       gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
@@ -418,6 +425,7 @@ gimp_plug_in_handle_tile_get (GimpPlugIn *plug_in,
   tile_data.width       = tile_rect.width;
   tile_data.height      = tile_rect.height;
   tile_data.use_shm     = (plug_in->manager->shm != NULL);
+  tile_data.n_tiles     = request->n_tiles;
 
   if (tile_data.use_shm)
     {
@@ -461,6 +469,39 @@ gimp_plug_in_handle_tile_get (GimpPlugIn *plug_in,
   gimp_wire_destroy (&msg);
 }
 
+static gboolean
+gimp_plug_in_get_tile_run_rect (GeglBuffer    *buffer,
+                                guint          tile_num,
+                                guint          n_tiles,
+                                GeglRectangle *rect)
+{
+  GeglRectangle last_rect;
+
+  if (n_tiles < 1 || n_tiles > GP_TILE_BATCH_SIZE ||
+      tile_num > G_MAXINT - n_tiles)
+    return FALSE;
+
+  if (! gimp_gegl_buffer_get_tile_rect (buffer,
+                                        GIMP_PLUG_IN_TILE_WIDTH,
+                                        GIMP_PLUG_IN_TILE_HEIGHT,
+                                        tile_num,
+                                        rect) ||
+      ! gimp_gegl_buffer_get_tile_rect (buffer,
+                                        GIMP_PLUG_IN_TILE_WIDTH,
+                                        GIMP_PLUG_IN_TILE_HEIGHT,
+                                        tile_num + n_tiles - 1,
+                                        &last_rect))
+    return FALSE;
+
+  /*  the tiles of a batch must all be on the same tile row  */
+  if (last_rect.y != rect->y)
+    return FALSE;
+
+  rect->width = last_rect.x + last_rect.width - rect->x;
+
+  return TRUE;
+}
+
 static void
 gimp_plug_in_handle_proc_error (GimpPlugIn          *plug_in,
                                 GimpPlugInProcFrame *proc_frame,
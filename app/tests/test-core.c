@@ -15,20 +15,50 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <string.h>
+
 #include <gegl.h>
+#include <gegl-plugin.h>
 #include <gtk/gtk.h>
 
+#include "libgimpbase/gimpbase.h"
+#include "libgimpcolor/gimpcolor.h"
+#include "libgimpmath/gimpmath.h"
+
 #include "widgets/widgets-types.h"
 
 #include "widgets/gimpuimanager.h"
 
 #include "core/gimp.h"
+#include "core/gimpbrushcache.h"
 #include "core/gimpcontext.h"
+#include "core/gimpgrouplayer.h"
+#include "core/gimphistogram.h"
 #include "core/gimpimage.h"
 #include "core/gimplayer.h"
 #include "core/gimplayer-new.h"
+#include "core/gimplineart.h"
+#include "core/gimppickable.h"
+#include "core/gimpprojectable.h"
+#include "core/gimpprojection.h"
+#include "core/gimptempbuf.h"
 
+#include "gegl/gimp-gegl-nodes.h"
+#include "gegl/gimplut3d.h"
+#include "gegl/gimptilehandlervalidate.h"
+
+#include "operations/gimpbrightnesscontrastconfig.h"
+#include "operations/gimpcageconfig.h"
 #include "operations/gimplevelsconfig.h"
+#include "operations/gimpoperationcagecoefcalc.h"
+#include "operations/gimpoperationpointfilter.h"
+
+#include "operations/layer-modes/gimp-layer-modes.h"
+#include "operations/layer-modes/gimpoperationlayermode-blend.h"
+#include "operations/layer-modes/gimpoperationlayermode-composite.h"
+#include "operations/layer-modes/gimpoperationlayermode-convert.h"
+
+#include "tools/gimpiscissorssearch.h"
 
 #include "tests.h"
 
@@ -37,6 +67,9 @@
 
 #define GIMP_TEST_IMAGE_SIZE 100
 
+#define CAGE_N_POINTS        12
+#define CAGE_CENTER          64.0
+
 #define ADD_IMAGE_TEST(function) \
   g_test_add ("/gimp-core/" #function, \
               GimpTestFixture, \
@@ -53,12 +86,38 @@
               function, \
               NULL);
 
+#if COMPILE_SSE4_1_INTRINISICS
+#define COMPOSITE_SSE4(name) gimp_operation_layer_mode_composite_##name##_sse4
+#else
+#define COMPOSITE_SSE4(name) NULL
+#endif
+
+#if COMPILE_AVX2_INTRINISICS
+#define COMPOSITE_AVX2(name) gimp_operation_layer_mode_composite_##name##_avx2
+#else
+#define COMPOSITE_AVX2(name) NULL
+#endif
+
+#define COMPOSITE_FUNCS(name) { #name, \
+                                gimp_operation_layer_mode_composite_##name, \
+                                COMPOSITE_SSE4 (name), \
+                                COMPOSITE_AVX2 (name) }
+
 
 typedef struct
 {
   GimpImage *image;
 } GimpTestFixture;
 
+typedef void (* CompositeFunc) (const gfloat *in,
+                                const gfloat *layer,
+                                const gfloat *comp,
+                                const gfloat *mask,
+                                gfloat        opacity,
+                                const gint    n_components,
+                                gfloat       *out,
+                                gint          samples);
+
 
 static void gimp_test_image_setup    (GimpTestFixture *fixture,
                                       gconstpointer    data);
@@ -263,6 +322,2009 @@ white_graypoint_in_red_levels (GimpTestFixture *fixture,
   g_clear_object (&white);
 }
 
+/**
+ * line_art_close_gaps:
+ * @fixture:
+ * @data:
+ *
+ * Draws a ring with a small gap, and makes sure the closed line art
+ * keeps all the strokes and separates the inside of the ring from the
+ * outside.
+ **/
+static void
+line_art_close_gaps (GimpTestFixture *fixture,
+                     gconstpointer    data)
+{
+  const gint   size   = GIMP_TEST_IMAGE_SIZE;
+  const gint   center = GIMP_TEST_IMAGE_SIZE / 2;
+  const gint   radius = GIMP_TEST_IMAGE_SIZE * 3 / 10;
+  const gint   offsets[] = { -1, +1, -GIMP_TEST_IMAGE_SIZE, +GIMP_TEST_IMAGE_SIZE };
+  GimpImage   *image  = fixture->image;
+  GimpLayer   *layer;
+  GimpLineArt *line_art;
+  GeglBuffer  *closed;
+  guchar      *pixels;
+  guchar      *mask;
+  gint        *queue;
+  gint         n_queued;
+  gint         i;
+  gint         j;
+  gboolean     leaked = FALSE;
+
+  layer = gimp_layer_new (image,
+                          size,
+                          size,
+                          babl_format ("R'G'B'A u8"),
+                          "Line Art",
+                          GIMP_OPACITY_OPAQUE,
+                          GIMP_LAYER_MODE_NORMAL);
+
+  pixels = g_new (guchar, size * size * 4);
+
+  for (i = 0; i < size * size; i++)
+    {
+      gint    x        = i % size - center;
+      gint    y        = i / size - center;
+      gdouble distance = sqrt (x * x + y * y);
+      gdouble angle    = atan2 (y, x);
+      guchar  value    = 255;
+
+      /* a 3 pixels wide ring, open over about 6 pixels on its right */
+      if (fabs (distance - radius) < 1.5 && fabs (angle) > 3.0 / radius)
+        value = 0;
+
+      pixels[i * 4]     = value;
+      pixels[i * 4 + 1] = value;
+      pixels[i * 4 + 2] = value;
+      pixels[i * 4 + 3] = 255;
+    }
+
+  gegl_buffer_set (gimp_drawable_get_buffer (GIMP_DRAWABLE (layer)), NULL, 0,
+                   babl_format ("R'G'B'A u8"), pixels, GEGL_AUTO_ROWSTRIDE);
+
+  line_art = gimp_line_art_new ();
+  gimp_line_art_set_input (line_art, GIMP_PICKABLE (layer));
+
+  closed = gimp_line_art_get (line_art, NULL);
+  g_assert_nonnull (closed);
+
+  mask = g_new (guchar, size * size);
+  gegl_buffer_get (closed, NULL, 1.0, babl_format ("Y' u8"), mask,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  /* All the strokes are kept. */
+  for (i = 0; i < size * size; i++)
+    {
+      if (pixels[i * 4] == 0)
+        g_assert_cmpint (mask[i], !=, 0);
+    }
+
+  /* Flood the background from the center of the ring, which must not
+   * reach the border of the image.
+   */
+  queue    = g_new (gint, size * size);
+  n_queued = 0;
+
+  queue[n_queued++] = center + center * size;
+  mask[center + center * size] = 1;
+
+  for (i = 0; i < n_queued; i++)
+    {
+      gint x = queue[i] % size;
+      gint y = queue[i] / size;
+
+      if (x == 0 || y == 0 || x == size - 1 || y == size - 1)
+        {
+          leaked = TRUE;
+          break;
+        }
+
+      for (j = 0; j < G_N_ELEMENTS (offsets); j++)
+        {
+          gint neighbor = queue[i] + offsets[j];
+
+          if (! mask[neighbor])
+            {
+              mask[neighbor] = 1;
+              queue[n_queued++] = neighbor;
+            }
+        }
+    }
+
+  g_assert_false (leaked);
+
+  g_free (queue);
+  g_free (mask);
+  g_free (pixels);
+  g_object_unref (line_art);
+  g_object_unref (layer);
+}
+
+/**
+ * brush_cache_quantized_keys:
+ * @fixture:
+ * @data:
+ *
+ * Makes sure the brush cache finds transforms that differ by less than
+ * its precision, misses the ones that differ by more, and keeps its
+ * memory use bounded.
+ **/
+static void
+brush_cache_quantized_keys (GimpTestFixture *fixture,
+                            gconstpointer    data)
+{
+  GimpBrushCache *cache;
+  GimpTempBuf    *mask;
+  guint64         total_memsize;
+  gint            i;
+
+  total_memsize = gimp_brush_cache_get_total_memsize ();
+
+  cache = gimp_brush_cache_new ((GDestroyNotify) gimp_temp_buf_unref,
+                                (GimpBrushCacheMemsizeFunc) gimp_temp_buf_get_memsize,
+                                'M', 'm');
+
+  mask = gimp_temp_buf_new (64, 64, babl_format ("Y u8"));
+
+  gimp_brush_cache_add (cache, mask,
+                        64, 64, 1.0, 0.0, 0.125, FALSE, 1.0);
+
+  g_assert_true (gimp_brush_cache_get (cache,
+                                       64, 64, 1.0, 0.0, 0.125, FALSE, 1.0) ==
+                 mask);
+  g_assert_true (gimp_brush_cache_get (cache,
+                                       64, 64, 1.00001, 0.0, 0.12501, FALSE,
+                                       0.9999) ==
+                 mask);
+  g_assert_true (gimp_brush_cache_get (cache,
+                                       64, 64, 1.0, 0.0, 1.12501, FALSE, 1.0) ==
+                 mask);
+
+  g_assert_null (gimp_brush_cache_get (cache,
+                                       64, 64, 1.0, 0.0, 0.135, FALSE, 1.0));
+  g_assert_null (gimp_brush_cache_get (cache,
+                                       64, 64, 1.05, 0.0, 0.125, FALSE, 1.0));
+  g_assert_null (gimp_brush_cache_get (cache,
+                                       65, 64, 1.0, 0.0, 0.125, FALSE, 1.0));
+  g_assert_null (gimp_brush_cache_get (cache,
+                                       64, 64, 1.0, 0.0, 0.125, TRUE, 1.0));
+  g_assert_null (gimp_brush_cache_get (cache,
+                                       64, 64, 1.0, 0.0, 0.125, FALSE, 0.5));
+
+  /*  adding data under an existing key replaces the cached data  */
+  mask = gimp_temp_buf_new (64, 64, babl_format ("Y u8"));
+
+  gimp_brush_cache_add (cache, mask,
+                        64, 64, 1.0, 0.0, 0.12501, FALSE, 1.0);
+
+  g_assert_true (gimp_brush_cache_get (cache,
+                                       64, 64, 1.0, 0.0, 0.125, FALSE, 1.0) ==
+                 mask);
+
+  /*  64 1MB masks don't fit in the cache  */
+  for (i = 0; i < 64; i++)
+    {
+      mask = gimp_temp_buf_new (1024, 1024, babl_format ("Y u8"));
+
+      gimp_brush_cache_add (cache, mask,
+                            1024, 1024, 1.0, 0.0, i / 64.0, FALSE, 1.0);
+    }
+
+  g_assert_cmpint (gimp_brush_cache_get_total_memsize () - total_memsize,
+                   <=, 33 * 1024 * 1024);
+  g_assert_null (gimp_brush_cache_get (cache,
+                                       1024, 1024, 1.0, 0.0, 0.0, FALSE, 1.0));
+  g_assert_nonnull (gimp_brush_cache_get (cache,
+                                          1024, 1024, 1.0, 0.0, 63 / 64.0,
+                                          FALSE, 1.0));
+
+  g_object_unref (cache);
+
+  g_assert_cmpint (gimp_brush_cache_get_total_memsize (), ==, total_memsize);
+}
+
+/**
+ * lut3d_matches_color_transform:
+ * @fixture:
+ * @data:
+ *
+ * Makes sure a 3D LUT baked from a soft-proofing transform stays close
+ * to the transform, and reports its accuracy and throughput.
+ **/
+static void
+lut3d_matches_color_transform (GimpTestFixture *fixture,
+                               gconstpointer    data)
+{
+  const Babl         *format   = babl_format ("R'G'B'A float");
+  const gint          n_pixels = 1024 * 1024;
+  GimpColorProfile   *src_profile;
+  GimpColorProfile   *dest_profile;
+  GimpColorProfile   *proof_profile;
+  GimpColorTransform *transform;
+  GimpLut3D          *lut;
+  GRand              *rand;
+  gfloat             *src;
+  gfloat             *expected;
+  gfloat             *result;
+  gint64              transform_time;
+  gint64              lut_time;
+  gdouble             max_error = 0.0;
+  gdouble             sum_error = 0.0;
+  gint                i;
+
+  src_profile   = gimp_color_profile_new_rgb_srgb ();
+  dest_profile  = gimp_color_profile_new_rgb_srgb_linear ();
+  proof_profile = gimp_color_profile_new_rgb_adobe ();
+
+  transform =
+    gimp_color_transform_new_proofing (src_profile,  format,
+                                       dest_profile, format,
+                                       proof_profile,
+                                       GIMP_COLOR_RENDERING_INTENT_RELATIVE_COLORIMETRIC,
+                                       GIMP_COLOR_RENDERING_INTENT_RELATIVE_COLORIMETRIC,
+                                       GIMP_COLOR_TRANSFORM_FLAGS_BLACK_POINT_COMPENSATION);
+  g_assert_nonnull (transform);
+
+  lut = gimp_lut3d_new (transform, GIMP_LUT3D_DEFAULT_SIZE);
+
+  rand     = g_rand_new_with_seed (1);
+  src      = g_new (gfloat, n_pixels * 4);
+  expected = g_new (gfloat, n_pixels * 4);
+  result   = g_new (gfloat, n_pixels * 4);
+
+  for (i = 0; i < n_pixels * 4; i++)
+    src[i] = g_rand_double (rand);
+
+  transform_time = g_get_monotonic_time ();
+  gimp_color_transform_process_pixels (transform,
+                                       format, src,
+                                       format, expected,
+                                       n_pixels);
+  transform_time = MAX (g_get_monotonic_time () - transform_time, 1);
+
+  lut_time = g_get_monotonic_time ();
+  gimp_lut3d_process_pixels (lut, src, result, n_pixels);
+  lut_time = MAX (g_get_monotonic_time () - lut_time, 1);
+
+  for (i = 0; i < n_pixels * 4; i++)
+    {
+      gdouble error = fabs (result[i] - expected[i]);
+
+      max_error  = MAX (max_error, error);
+      sum_error += error;
+    }
+
+  g_test_message ("3D LUT: max error %.3f/255, mean error %.4f/255; "
+                  "transform %.1f Mpx/s, LUT %.1f Mpx/s",
+                  max_error * 255.0, sum_error / (n_pixels * 4) * 255.0,
+                  (gdouble) n_pixels / transform_time,
+                  (gdouble) n_pixels / lut_time);
+
+  g_assert_cmpfloat (max_error, <, 1.0 / 255.0);
+  g_assert_cmpfloat (sum_error / (n_pixels * 4), <, 0.25 / 255.0);
+
+  g_free (result);
+  g_free (expected);
+  g_free (src);
+  g_rand_free (rand);
+  gimp_lut3d_free (lut);
+  g_object_unref (transform);
+  g_object_unref (proof_profile);
+  g_object_unref (dest_profile);
+  g_object_unref (src_profile);
+}
+
+/**
+ * lut3d_bounds_dark_ramp_error:
+ * @fixture:
+ * @data:
+ *
+ * Makes sure a 3D LUT stays close to a transform towards a pure gamma
+ * TRC on dark gray and primary ramps, where the TRC is steepest.
+ **/
+static void
+lut3d_bounds_dark_ramp_error (GimpTestFixture *fixture,
+                              gconstpointer    data)
+{
+  const Babl       *format  = babl_format ("R'G'B'A float");
+  const gint        n_steps = 1024;
+  const gint        n_ramps = 4;
+  GimpColorProfile *src_profiles[2];
+  GimpColorProfile *dest_profile;
+  gfloat           *src;
+  gfloat           *expected;
+  gfloat           *result;
+  gint              n_pixels = n_steps * n_ramps;
+  gint              i;
+
+  src_profiles[0] = gimp_color_profile_new_rgb_srgb ();
+  src_profiles[1] = gimp_color_profile_new_rgb_srgb_linear ();
+  dest_profile    = gimp_color_profile_new_rgb_adobe ();
+
+  src      = g_new0 (gfloat, n_pixels * 4);
+  expected = g_new  (gfloat, n_pixels * 4);
+  result   = g_new  (gfloat, n_pixels * 4);
+
+  /*  a gray ramp, followed by a red, a green and a blue one, all
+   *  in [0, 0.1]
+   */
+  for (i = 0; i < n_steps; i++)
+    {
+      gfloat  value = 0.1f * i / (n_steps - 1);
+      gfloat *gray  = src + 4 * i;
+      gint    k;
+
+      gray[0] = gray[1] = gray[2] = value;
+      gray[3] = 1.0f;
+
+      for (k = 0; k < 3; k++)
+        {
+          gfloat *primary = src + 4 * ((k + 1) * n_steps + i);
+
+          primary[k] = value;
+          primary[3] = 1.0f;
+        }
+    }
+
+  for (i = 0; i < G_N_ELEMENTS (src_profiles); i++)
+    {
+      GimpColorTransform *transform;
+      GimpLut3D          *lut;
+      gdouble             max_error = 0.0;
+      gint                j;
+
+      transform =
+        gimp_color_transform_new (src_profiles[i], format,
+                                  dest_profile,    format,
+                                  GIMP_COLOR_RENDERING_INTENT_RELATIVE_COLORIMETRIC,
+                                  GIMP_COLOR_TRANSFORM_FLAGS_NOOPTIMIZE);
+      g_assert_nonnull (transform);
+
+      lut = gimp_lut3d_new (transform, GIMP_LUT3D_DEFAULT_SIZE);
+
+      gimp_color_transform_process_pixels (transform,
+                                           format, src,
+                                           format, expected,
+                                           n_pixels);
+      gimp_lut3d_process_pixels (lut, src, result, n_pixels);
+
+      for (j = 0; j < n_pixels * 4; j++)
+        max_error = MAX (max_error, fabs (result[j] - expected[j]));
+
+      g_test_message ("3D LUT, %s source: max dark ramp error %.3f/255",
+                      i == 0 ? "sRGB" : "linear sRGB",
+                      max_error * 255.0);
+
+      g_assert_cmpfloat (max_error, <, 0.5 / 255.0);
+
+      gimp_lut3d_free (lut);
+      g_object_unref (transform);
+    }
+
+  g_free (result);
+  g_free (expected);
+  g_free (src);
+  g_object_unref (dest_profile);
+  g_object_unref (src_profiles[1]);
+  g_object_unref (src_profiles[0]);
+}
+
+static gboolean
+layer_mode_values_match (gfloat  expected,
+                         gfloat  result,
+                         gdouble *max_error)
+{
+  gdouble error;
+
+  if (isnan (expected) || isnan (result))
+    return isnan (expected) && isnan (result);
+
+  error      = fabs (result - expected) / MAX (fabs (expected), 1.0);
+  *max_error = MAX (*max_error, error);
+
+  return error <= 1e-5;
+}
+
+/**
+ * layer_mode_simd_matches_scalar:
+ * @fixture:
+ * @data:
+ *
+ * Makes sure the vector variants of the blend and composite functions
+ * which the CPU supports match the scalar functions, and reports the
+ * throughput of each variant.
+ **/
+static void
+layer_mode_simd_matches_scalar (GimpTestFixture *fixture,
+                                gconstpointer    data)
+{
+  const struct
+  {
+    const gchar       *name;
+    GimpCpuAccelFlags  accel;
+  } variants[] =
+  {
+    { "SSE4.1", GIMP_CPU_ACCEL_X86_SSE4_1                           },
+    { "AVX2",   GIMP_CPU_ACCEL_X86_SSE4_1 | GIMP_CPU_ACCEL_X86_AVX2 }
+  };
+  const struct
+  {
+    const gchar   *name;
+    CompositeFunc  func;
+    CompositeFunc  func_sse4;
+    CompositeFunc  func_avx2;
+  } composite_funcs[] =
+  {
+    COMPOSITE_FUNCS (union),
+    COMPOSITE_FUNCS (clip_to_backdrop),
+    COMPOSITE_FUNCS (clip_to_layer),
+    COMPOSITE_FUNCS (intersection)
+  };
+  /* odd, so that the vector functions' tails are covered */
+  const gint         n_pixels = 64 * 1024 + 1;
+  const gint         n_runs   = 16;
+  const Babl        *format   = babl_format ("RGBA float");
+  GimpCpuAccelFlags  support  = gimp_cpu_accel_get_support ();
+  GRand             *rand;
+  gfloat            *in;
+  gfloat            *layer;
+  gfloat            *mask;
+  gfloat            *comp;
+  gfloat            *expected;
+  gfloat            *result;
+  GeglOperation     *operation;
+  gdouble            max_error = 0.0;
+  gint               n_tested  = 0;
+  GimpLayerMode      mode;
+  gint               i;
+  gint               j;
+
+  rand     = g_rand_new_with_seed (1);
+  in       = g_new (gfloat, n_pixels * 4);
+  layer    = g_new (gfloat, n_pixels * 4);
+  mask     = g_new (gfloat, n_pixels);
+  comp     = g_new (gfloat, n_pixels * 4);
+  expected = g_new (gfloat, n_pixels * 4);
+  result   = g_new (gfloat, n_pixels * 4);
+
+  /* cover values outside of [0, 1], the 0.5 thresholds of the
+   * conditional modes, and transparent pixels
+   */
+  for (i = 0; i < n_pixels * 4; i++)
+    {
+      in[i]    = g_rand_double_range (rand, -0.25, 1.25);
+      layer[i] = g_rand_double_range (rand, -0.25, 1.25);
+
+      if (g_rand_int_range (rand, 0, 16) == 0)
+        in[i] = 0.5f;
+      if (g_rand_int_range (rand, 0, 16) == 0)
+        layer[i] = 0.5f;
+    }
+
+  for (i = 0; i < n_pixels; i++)
+    {
+      in[i * 4 + 3]    = g_rand_double (rand);
+      layer[i * 4 + 3] = g_rand_double (rand);
+      mask[i]          = g_rand_double (rand);
+
+      if (g_rand_int_range (rand, 0, 8) == 0)
+        in[i * 4 + 3] = 0.0f;
+      if (g_rand_int_range (rand, 0, 8) == 0)
+        layer[i * 4 + 3] = 0.0f;
+    }
+
+  for (mode = GIMP_LAYER_MODE_NORMAL_LEGACY;
+       mode <= GIMP_LAYER_MODE_ANTI_ERASE;
+       mode++)
+    {
+      GimpLayerModeBlendFunc  blend_func = gimp_layer_mode_get_blend_function (mode);
+      const gchar            *name;
+      GString                *report;
+      gint64                  elapsed;
+
+      if (! blend_func ||
+          gimp_operation_layer_mode_blend_get_accelerated (blend_func, ~0) ==
+          blend_func)
+        {
+          continue;
+        }
+
+      gimp_enum_get_value (GIMP_TYPE_LAYER_MODE, mode, NULL, NULL, &name, NULL);
+
+      operation = gimp_layer_mode_get_operation (mode);
+      gegl_operation_set_format (operation, "input",  format);
+      gegl_operation_set_format (operation, "output", format);
+
+      elapsed = g_get_monotonic_time ();
+      for (j = 0; j < n_runs; j++)
+        blend_func (operation, in, layer, expected, n_pixels);
+      elapsed = MAX (g_get_monotonic_time () - elapsed, 1);
+
+      report = g_string_new (NULL);
+      g_string_printf (report, "%s: scalar %.0f Mpx/s",
+                       name, (gdouble) n_pixels * n_runs / elapsed);
+
+      for (i = 0; i < G_N_ELEMENTS (variants); i++)
+        {
+          GimpLayerModeBlendFunc func;
+          gint                   k;
+
+          if ((support & variants[i].accel) != variants[i].accel)
+            continue;
+
+          func = gimp_operation_layer_mode_blend_get_accelerated (blend_func,
+                                                                  variants[i].accel);
+
+          if (func == blend_func)
+            continue;
+
+          elapsed = g_get_monotonic_time ();
+          for (j = 0; j < n_runs; j++)
+            func (operation, in, layer, result, n_pixels);
+          elapsed = MAX (g_get_monotonic_time () - elapsed, 1);
+
+          g_string_append_printf (report, ", %s %.0f Mpx/s",
+                                  variants[i].name,
+                                  (gdouble) n_pixels * n_runs / elapsed);
+
+          /* the color of pixels which aren't blended is unconstrained */
+          for (k = 0; k < n_pixels * 4; k++)
+            {
+              gboolean blended = in[k | 3] != 0.0f && layer[k | 3] != 0.0f;
+
+              if ((k & 3) == 3 || blended)
+                {
+                  if (! layer_mode_values_match (expected[k], result[k],
+                                                 &max_error))
+                    {
+                      g_test_fail_printf ("%s (%s): pixel %d, component %d: "
+                                          "expected %g, got %g",
+                                          name, variants[i].name,
+                                          k / 4, k % 4,
+                                          expected[k], result[k]);
+                      break;
+                    }
+                }
+            }
+
+          n_tested++;
+        }
+
+      g_test_message ("%s", report->str);
+      g_string_free (report, TRUE);
+    }
+
+  /* composite an overlay blend, with unconstrained values set to NaN */
+  operation = gimp_layer_mode_get_operation (GIMP_LAYER_MODE_OVERLAY);
+  gegl_operation_set_format (operation, "input",  format);
+  gegl_operation_set_format (operation, "output", format);
+
+  gimp_operation_layer_mode_blend_overlay (operation, in, layer, comp,
+                                           n_pixels);
+
+  for (i = 0; i < n_pixels; i++)
+    {
+      if (in[i * 4 + 3] == 0.0f || layer[i * 4 + 3] == 0.0f)
+        comp[i * 4] = comp[i * 4 + 1] = comp[i * 4 + 2] = NAN;
+    }
+
+  for (i = 0; i < G_N_ELEMENTS (composite_funcs); i++)
+    {
+      GString *report;
+      gint64   elapsed;
+
+      elapsed = g_get_monotonic_time ();
+      for (j = 0; j < n_runs; j++)
+        {
+          composite_funcs[i].func (in, layer, comp, mask, 0.75f, 4,
+                                   expected, n_pixels);
+        }
+      elapsed = MAX (g_get_monotonic_time () - elapsed, 1);
+
+      report = g_string_new (NULL);
+      g_string_printf (report, "composite %s: scalar %.0f Mpx/s",
+                       composite_funcs[i].name,
+                       (gdouble) n_pixels * n_runs / elapsed);
+
+      for (j = 0; j < G_N_ELEMENTS (variants); j++)
+        {
+          CompositeFunc func;
+          gint          k;
+
+          if ((support & variants[j].accel) != variants[j].accel)
+            continue;
+
+          func = (variants[j].accel & GIMP_CPU_ACCEL_X86_AVX2) ?
+                 composite_funcs[i].func_avx2 :
+                 composite_funcs[i].func_sse4;
+
+          if (! func)
+            continue;
+
+          elapsed = g_get_monotonic_time ();
+          for (k = 0; k < n_runs; k++)
+            func (in, layer, comp, mask, 0.75f, 4, result, n_pixels);
+          elapsed = MAX (g_get_monotonic_time () - elapsed, 1);
+
+          g_string_append_printf (report, ", %s %.0f Mpx/s",
+                                  variants[j].name,
+                                  (gdouble) n_pixels * n_runs / elapsed);
+
+          for (k = 0; k < n_pixels * 4; k++)
+            {
+              if (! layer_mode_values_match (expected[k], result[k],
+                                             &max_error))
+                {
+                  g_test_fail_printf ("composite %s (%s): pixel %d, "
+                                      "component %d: expected %g, got %g",
+                                      composite_funcs[i].name,
+                                      variants[j].name,
+                                      k / 4, k % 4,
+                                      expected[k], result[k]);
+                  break;
+                }
+            }
+
+          /* without a mask, and in-place */
+          composite_funcs[i].func (in, layer, comp, NULL, 0.75f, 4,
+                                   expected, n_pixels);
+          memcpy (result, in, sizeof (gfloat) * n_pixels * 4);
+          func (result, layer, comp, NULL, 0.75f, 4, result, n_pixels);
+
+          for (k = 0; k < n_pixels * 4; k++)
+            {
+              if (! layer_mode_values_match (expected[k], result[k],
+                                             &max_error))
+                {
+                  g_test_fail_printf ("composite %s (%s, in-place): "
+                                      "pixel %d, component %d: "
+                                      "expected %g, got %g",
+                                      composite_funcs[i].name,
+                                      variants[j].name,
+                                      k / 4, k % 4,
+                                      expected[k], result[k]);
+                  break;
+                }
+            }
+
+          n_tested++;
+        }
+
+      g_test_message ("%s", report->str);
+      g_string_free (report, TRUE);
+    }
+
+  if (n_tested == 0)
+    g_test_skip ("no vector layer mode functions supported by this CPU");
+  else
+    g_test_message ("max relative error %g", max_error);
+
+  g_free (result);
+  g_free (expected);
+  g_free (comp);
+  g_free (mask);
+  g_free (layer);
+  g_free (in);
+  g_rand_free (rand);
+}
+
+/**
+ * layer_mode_converters_match_babl:
+ * @fixture:
+ * @data:
+ *
+ * Makes sure the layer mode space converters match the corresponding
+ * babl conversions, and reports the throughput of both.
+ **/
+static void
+layer_mode_converters_match_babl (GimpTestFixture *fixture,
+                                  gconstpointer    data)
+{
+  const struct
+  {
+    GimpLayerColorSpace  space;
+    const gchar         *encoding;
+    gdouble              range;
+  } spaces[] =
+  {
+    { GIMP_LAYER_COLOR_SPACE_RGB_LINEAR,     "RGBA float",            1.0 },
+    { GIMP_LAYER_COLOR_SPACE_RGB_NON_LINEAR, "R'G'B'A float",         1.0 },
+    { GIMP_LAYER_COLOR_SPACE_RGB_PERCEPTUAL, "R~G~B~A float",         1.0 },
+    { GIMP_LAYER_COLOR_SPACE_LAB,            "CIE Lab alpha float", 100.0 }
+  };
+  const gint  n_pixels = 64 * 1024;
+  const gint  n_runs   = 16;
+  const Babl *format   = babl_format ("RGBA float");
+  GRand      *rand;
+  gfloat     *linear;
+  gfloat     *src;
+  gfloat     *expected;
+  gfloat     *result;
+  gdouble     max_error = 0.0;
+  gint        i;
+  gint        j;
+  gint        k;
+
+  rand     = g_rand_new_with_seed (1);
+  linear   = g_new (gfloat, n_pixels * 4);
+  src      = g_new (gfloat, n_pixels * 4);
+  expected = g_new (gfloat, n_pixels * 4);
+  result   = g_new (gfloat, n_pixels * 4);
+
+  /* cover the linear segments of the TRCs, and values outside of [0, 1] */
+  for (k = 0; k < n_pixels * 4; k++)
+    {
+      if (g_rand_int_range (rand, 0, 16) == 0)
+        linear[k] = g_rand_double_range (rand, -0.1, 1.1);
+      else if (g_rand_int_range (rand, 0, 16) == 0)
+        linear[k] = g_rand_double_range (rand, 0.0, 0.01);
+      else
+        linear[k] = g_rand_double (rand);
+    }
+
+  for (i = 0; i < G_N_ELEMENTS (spaces); i++)
+    {
+      const Babl *from_format = babl_format_with_space (spaces[i].encoding,
+                                                        format);
+
+      babl_process (babl_fish (format, from_format), linear, src, n_pixels);
+
+      for (j = 0; j < G_N_ELEMENTS (spaces); j++)
+        {
+          const Babl             *to_format;
+          const Babl             *fish;
+          GimpLayerModeConverter  converter;
+          const gchar            *from_name;
+          const gchar            *to_name;
+          gint64                  babl_elapsed;
+          gint64                  elapsed;
+          gint                    run;
+
+          if (i == j)
+            continue;
+
+          gimp_enum_get_value (GIMP_TYPE_LAYER_COLOR_SPACE, spaces[i].space,
+                               NULL, NULL, &from_name, NULL);
+          gimp_enum_get_value (GIMP_TYPE_LAYER_COLOR_SPACE, spaces[j].space,
+                               NULL, NULL, &to_name, NULL);
+
+          if (! gimp_operation_layer_mode_converter_init (&converter,
+                                                          spaces[i].space,
+                                                          spaces[j].space,
+                                                          format))
+            {
+              g_test_fail_printf ("no converter from %s to %s",
+                                  from_name, to_name);
+              continue;
+            }
+
+          to_format = babl_format_with_space (spaces[j].encoding, format);
+          fish      = babl_fish (from_format, to_format);
+
+          babl_elapsed = g_get_monotonic_time ();
+          for (run = 0; run < n_runs; run++)
+            babl_process (fish, src, expected, n_pixels);
+          babl_elapsed = MAX (g_get_monotonic_time () - babl_elapsed, 1);
+
+          elapsed = g_get_monotonic_time ();
+          for (run = 0; run < n_runs; run++)
+            {
+              gimp_operation_layer_mode_converter_process (&converter,
+                                                           src, result,
+                                                           n_pixels);
+            }
+          elapsed = MAX (g_get_monotonic_time () - elapsed, 1);
+
+          g_test_message ("%s -> %s: babl %.0f Mpx/s, converter %.0f Mpx/s",
+                          from_name, to_name,
+                          (gdouble) n_pixels * n_runs / babl_elapsed,
+                          (gdouble) n_pixels * n_runs / elapsed);
+
+          for (k = 0; k < n_pixels * 4; k++)
+            {
+              gdouble error;
+
+              error     = fabs (result[k] - expected[k]) /
+                          MAX (fabs (expected[k]), spaces[j].range);
+              max_error = MAX (max_error, error);
+
+              if (! (error <= 1e-5))
+                {
+                  g_test_fail_printf ("%s -> %s: pixel %d, component %d: "
+                                      "expected %g, got %g",
+                                      from_name, to_name, k / 4, k % 4,
+                                      expected[k], result[k]);
+                  break;
+                }
+            }
+        }
+    }
+
+  g_test_message ("max relative error %g", max_error);
+
+  g_free (result);
+  g_free (expected);
+  g_free (src);
+  g_free (linear);
+  g_rand_free (rand);
+}
+
+/**
+ * layer_modes_composite_mode_heavy_stack:
+ * @fixture:
+ * @data:
+ *
+ * Composites a stack of layers using modes which blend in the perceptual
+ * and CIE Lab spaces, with partially transparent layers, and reports the
+ * throughput for each blend space.
+ **/
+static void
+layer_modes_composite_mode_heavy_stack (GimpTestFixture *fixture,
+                                        gconstpointer    data)
+{
+  const GimpLayerMode modes[] =
+  {
+    GIMP_LAYER_MODE_LCH_HUE,
+    GIMP_LAYER_MODE_OVERLAY,
+    GIMP_LAYER_MODE_LCH_CHROMA,
+    GIMP_LAYER_MODE_SOFTLIGHT,
+    GIMP_LAYER_MODE_LCH_COLOR,
+    GIMP_LAYER_MODE_HARDLIGHT,
+    GIMP_LAYER_MODE_LCH_LIGHTNESS,
+    GIMP_LAYER_MODE_SCREEN
+  };
+  const GimpLayerColorSpace blend_spaces[] =
+  {
+    GIMP_LAYER_COLOR_SPACE_RGB_PERCEPTUAL,
+    GIMP_LAYER_COLOR_SPACE_LAB
+  };
+  const gint     size   = 512;
+  const gint     n_runs = 4;
+  GeglRectangle  rect   = { 0, 0, size, size };
+  const Babl    *format = babl_format ("RGBA float");
+  GeglBuffer    *buffers[G_N_ELEMENTS (modes) + 1];
+  GRand         *rand;
+  gfloat        *pixels;
+  gint           i;
+  gint           k;
+
+  rand   = g_rand_new_with_seed (1);
+  pixels = g_new (gfloat, size * size * 4);
+
+  /* the backdrop is opaque.  the layers are transparent over every other
+   * band of 64 columns, so that both the blended and the skipped runs are
+   * exercised, and have a random alpha elsewhere.
+   */
+  for (i = 0; i < G_N_ELEMENTS (buffers); i++)
+    {
+      for (k = 0; k < size * size; k++)
+        {
+          gint x = k % size;
+
+          pixels[4 * k + 0] = g_rand_double (rand);
+          pixels[4 * k + 1] = g_rand_double (rand);
+          pixels[4 * k + 2] = g_rand_double (rand);
+
+          if (i == 0)
+            pixels[4 * k + 3] = 1.0f;
+          else if ((x / 64) & 1)
+            pixels[4 * k + 3] = 0.0f;
+          else
+            pixels[4 * k + 3] = g_rand_double_range (rand, 0.1, 1.0);
+        }
+
+      buffers[i] = gegl_buffer_new (&rect, format);
+      gegl_buffer_set (buffers[i], &rect, 0, format, pixels,
+                       GEGL_AUTO_ROWSTRIDE);
+    }
+
+  for (i = 0; i < G_N_ELEMENTS (blend_spaces); i++)
+    {
+      GeglNode    *graph;
+      GeglNode    *node;
+      const gchar *blend_space_name;
+      gint64       elapsed;
+      gint         j;
+      gint         run;
+
+      gimp_enum_get_value (GIMP_TYPE_LAYER_COLOR_SPACE, blend_spaces[i],
+                           NULL, NULL, &blend_space_name, NULL);
+
+      graph = gegl_node_new ();
+      node  = gegl_node_new_child (graph,
+                                   "operation", "gegl:buffer-source",
+                                   "buffer",    buffers[0],
+                                   NULL);
+
+      for (j = 0; j < G_N_ELEMENTS (modes); j++)
+        {
+          GeglNode *layer;
+          GeglNode *mode;
+
+          layer = gegl_node_new_child (graph,
+                                       "operation", "gegl:buffer-source",
+                                       "buffer",    buffers[j + 1],
+                                       NULL);
+          mode  = gegl_node_new_child (graph,
+                                       "operation", "gimp:normal",
+                                       NULL);
+
+          gimp_gegl_mode_node_set_mode (mode, modes[j],
+                                        blend_spaces[i],
+                                        GIMP_LAYER_COLOR_SPACE_RGB_LINEAR,
+                                        GIMP_LAYER_COMPOSITE_UNION);
+
+          gegl_node_link (node, mode);
+          gegl_node_connect (layer, "output", mode, "aux");
+
+          node = mode;
+        }
+
+      elapsed = g_get_monotonic_time ();
+      for (run = 0; run < n_runs; run++)
+        {
+          gegl_node_blit (node, 1.0, &rect, format, pixels,
+                          GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+        }
+      elapsed = MAX (g_get_monotonic_time () - elapsed, 1);
+
+      g_test_message ("%d layers, blending in %s: %.1f Mpx/s",
+                      (gint) G_N_ELEMENTS (modes), blend_space_name,
+                      (gdouble) size * size * n_runs / elapsed);
+
+      for (k = 0; k < size * size * 4; k++)
+        {
+          if (! isfinite (pixels[k]))
+            {
+              g_test_fail_printf ("%s: pixel %d, component %d: got %g",
+                                  blend_space_name, k / 4, k % 4, pixels[k]);
+              break;
+            }
+        }
+
+      g_object_unref (graph);
+    }
+
+  for (i = 0; i < G_N_ELEMENTS (buffers); i++)
+    g_object_unref (buffers[i]);
+
+  g_free (pixels);
+  g_rand_free (rand);
+}
+
+/**
+ * point_filter_chain_matches_filters:
+ * @fixture:
+ * @data:
+ *
+ * Makes sure that chaining point filters through a lookup table gives
+ * the same results as applying them one after the other, for 8-bit
+ * input, which is looked up directly, and for float input, which is
+ * interpolated, and that the table follows changes to the filters.
+ **/
+static void
+point_filter_chain_matches_filters (GimpTestFixture *fixture,
+                                    gconstpointer    data)
+{
+  const gchar   *input_formats[] = { "R'G'B'A u8", "R'G'B'A float" };
+  const gint     size            = 256;
+  GeglRectangle  rect            = { 0, 0, size, size };
+  const Babl    *format          = babl_format ("RGBA float");
+  GObject       *levels_config;
+  GObject       *bc_config;
+  GRand         *rand;
+  gfloat        *src;
+  gfloat        *expected;
+  gfloat        *result;
+  gint           i;
+  gint           k;
+
+  levels_config = g_object_new (GIMP_TYPE_LEVELS_CONFIG, NULL);
+  bc_config     = g_object_new (GIMP_TYPE_BRIGHTNESS_CONTRAST_CONFIG, NULL);
+
+  g_object_set (levels_config,
+                "low-input", 0.1,
+                "gamma",     1.8,
+                NULL);
+  g_object_set (bc_config,
+                "brightness", 0.2,
+                "contrast",   0.3,
+                NULL);
+
+  rand     = g_rand_new_with_seed (1);
+  src      = g_new (gfloat, size * size * 4);
+  expected = g_new (gfloat, size * size * 4);
+  result   = g_new (gfloat, size * size * 4);
+
+  /* include a few values outside of [0, 1], for float input */
+  for (k = 0; k < size * size * 4; k++)
+    {
+      if (g_rand_int_range (rand, 0, 64) == 0)
+        src[k] = g_rand_double_range (rand, -0.1, 1.1);
+      else
+        src[k] = g_rand_double (rand);
+    }
+
+  for (i = 0; i < G_N_ELEMENTS (input_formats); i++)
+    {
+      GeglBuffer *buffer;
+      GeglNode   *graph;
+      GeglNode   *source;
+      GeglNode   *levels;
+      GeglNode   *bc;
+      GList      *chain;
+      gint        pass;
+
+      buffer = gegl_buffer_new (&rect, babl_format (input_formats[i]));
+      gegl_buffer_set (buffer, &rect, 0, format, src, GEGL_AUTO_ROWSTRIDE);
+
+      graph  = gegl_node_new ();
+      source = gegl_node_new_child (graph,
+                                    "operation", "gegl:buffer-source",
+                                    "buffer",    buffer,
+                                    NULL);
+      levels = gegl_node_new_child (graph,
+                                    "operation", "gimp:levels",
+                                    "config",    levels_config,
+                                    NULL);
+      bc     = gegl_node_new_child (graph,
+                                    "operation", "gimp:brightness-contrast",
+                                    "config",    bc_config,
+                                    NULL);
+
+      gegl_node_link_many (source, levels, bc, NULL);
+
+      chain = g_list_prepend (NULL, gegl_node_get_gegl_operation (bc));
+
+      for (pass = 0; pass < 2; pass++)
+        {
+          GimpOperationPointFilter *filter;
+          gint64                    elapsed;
+          gint64                    chain_elapsed;
+
+          filter = GIMP_OPERATION_POINT_FILTER (gegl_node_get_gegl_operation (levels));
+
+          /* the second pass changes a filter of the chain after the
+           * table was built
+           */
+          if (pass == 1)
+            g_object_set (bc_config, "brightness", -0.3, NULL);
+
+          gimp_operation_point_filter_set_chain (filter, NULL);
+
+          elapsed = g_get_monotonic_time ();
+          gegl_node_blit (bc, 1.0, &rect, format, expected,
+                          GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+          elapsed = MAX (g_get_monotonic_time () - elapsed, 1);
+
+          gimp_operation_point_filter_set_chain (filter, chain);
+
+          /* on the second pass, build the table with the old settings
+           * first, to check that it is rebuilt once they change
+           */
+          if (pass == 1)
+            g_object_set (bc_config, "brightness", 0.2, NULL);
+
+          gegl_node_blit (levels, 1.0, &rect, format, result,
+                          GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+          if (pass == 1)
+            g_object_set (bc_config, "brightness", -0.3, NULL);
+
+          chain_elapsed = g_get_monotonic_time ();
+          gegl_node_blit (levels, 1.0, &rect, format, result,
+                          GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+          chain_elapsed = MAX (g_get_monotonic_time () - chain_elapsed, 1);
+
+          g_test_message ("%s: filters %.0f Mpx/s, chain %.0f Mpx/s",
+                          input_formats[i],
+                          (gdouble) size * size / elapsed,
+                          (gdouble) size * size / chain_elapsed);
+
+          for (k = 0; k < size * size * 4; k++)
+            {
+              gdouble error = fabs (result[k] - expected[k]);
+
+              if (! (error <= 1e-4))
+                {
+                  g_test_fail_printf ("%s, pass %d: pixel %d, component %d: "
+                                      "expected %g, got %g",
+                                      input_formats[i], pass, k / 4, k % 4,
+                                      expected[k], result[k]);
+                  break;
+                }
+            }
+        }
+
+      g_object_set (bc_config, "brightness", 0.2, NULL);
+
+      g_list_free (chain);
+      g_object_unref (graph);
+      g_object_unref (buffer);
+    }
+
+  g_free (result);
+  g_free (expected);
+  g_free (src);
+  g_rand_free (rand);
+  g_object_unref (bc_config);
+  g_object_unref (levels_config);
+}
+
+static void
+fill_random (GeglBuffer          *buffer,
+             const GeglRectangle *rect,
+             GRand               *rand)
+{
+  const Babl *format = babl_format ("R'G'B'A float");
+  gfloat     *data   = g_new (gfloat, rect->width * rect->height * 4);
+  gint        i;
+
+  for (i = 0; i < rect->width * rect->height * 4; i++)
+    data[i] = g_rand_double (rand);
+
+  gegl_buffer_set (buffer, rect, 0, format, data, GEGL_AUTO_ROWSTRIDE);
+
+  g_free (data);
+}
+
+static gboolean
+histograms_match (GimpHistogram *histogram,
+                  GimpHistogram *expected)
+{
+  GimpHistogramChannel channel;
+
+  for (channel = GIMP_HISTOGRAM_VALUE;
+       channel <= GIMP_HISTOGRAM_LUMINANCE;
+       channel++)
+    {
+      gint i;
+
+      for (i = 0; i < gimp_histogram_n_bins (expected); i++)
+        {
+          gdouble value  = gimp_histogram_get_value (histogram, channel, i);
+          gdouble target = gimp_histogram_get_value (expected,  channel, i);
+
+          if (fabs (value - target) > 1e-6 * MAX (fabs (target), 1.0))
+            {
+              g_test_message ("channel %d, bin %d: expected %g, got %g",
+                              channel, i, target, value);
+
+              return FALSE;
+            }
+        }
+    }
+
+  return TRUE;
+}
+
+/**
+ * histogram_cache_follows_changes:
+ * @fixture:
+ * @data:
+ *
+ * Makes sure that histograms calculated through a #GimpHistogramCache,
+ * with and without a mask, are the same as histograms calculated from
+ * scratch, after the buffer and the mask are changed and the
+ * corresponding parts of the cache are invalidated.
+ **/
+static void
+histogram_cache_follows_changes (GimpTestFixture *fixture,
+                                 gconstpointer    data)
+{
+  GeglRectangle       rect      = { 0, 0, 1500, 1100 };
+  GeglRectangle       mask_rect = { 200, 100, 1500, 1100 };
+  GeglRectangle       selection = { 300, 250, 700, 600 };
+  GeglRectangle       selection_rect;
+  GeglRectangle       changes[] = { { 100, 700, 200, 100 },
+                                    { 1400, 0, 100, 1100 },
+                                    { 511, 511, 2, 2 } };
+  GimpHistogramCache *cache;
+  GimpHistogram      *histogram;
+  GimpHistogram      *expected;
+  GeglBuffer         *buffer;
+  GeglBuffer         *mask;
+  GRand              *rand;
+  gint                masked;
+  gint                i;
+
+  rand      = g_rand_new_with_seed (1);
+  cache     = gimp_histogram_cache_new ();
+  histogram = gimp_histogram_new (GIMP_TRC_NON_LINEAR);
+  expected  = gimp_histogram_new (GIMP_TRC_NON_LINEAR);
+
+  /*  the mask is offset by (mask_rect.x, mask_rect.y) relative to the
+   *  buffer, and is only non-zero within the selection
+   */
+  buffer = gegl_buffer_new (&rect, babl_format ("R'G'B'A u8"));
+  mask   = gegl_buffer_new (&mask_rect, babl_format ("Y float"));
+
+  selection_rect    = selection;
+  selection_rect.x -= mask_rect.x;
+  selection_rect.y -= mask_rect.y;
+
+  fill_random (buffer, &rect, rand);
+
+  gegl_buffer_set_color_from_pixel (mask, &selection,
+                                    (gfloat []) { 0.5f },
+                                    babl_format ("Y float"));
+
+  for (masked = 0; masked < 3; masked++)
+    {
+      GeglBuffer          *mask_buffer = masked ? mask : NULL;
+      const GeglRectangle *buffer_rect = masked ? &selection_rect : &rect;
+
+      /*  the last pass changes the mask, instead of the buffer  */
+      if (masked == 2)
+        {
+          gegl_buffer_set_color_from_pixel (mask, &selection,
+                                            (gfloat []) { 1.0f },
+                                            babl_format ("Y float"));
+
+          gimp_histogram_cache_invalidate_mask (cache, &selection);
+        }
+
+      for (i = 0; i <= G_N_ELEMENTS (changes); i++)
+        {
+          if (i > 0)
+            {
+              fill_random (buffer, &changes[i - 1], rand);
+
+              gimp_histogram_cache_invalidate (cache, &changes[i - 1]);
+            }
+
+          gimp_histogram_calculate (histogram, cache,
+                                    buffer, buffer_rect,
+                                    mask_buffer, &selection);
+          gimp_histogram_calculate (expected, NULL,
+                                    buffer, buffer_rect,
+                                    mask_buffer, &selection);
+
+          if (! histograms_match (histogram, expected))
+            {
+              g_test_fail_printf ("%s histogram doesn't match after %d changes",
+                                  masked ? "masked" : "unmasked", i);
+            }
+
+          if (masked == 2)
+            break;
+        }
+    }
+
+  g_object_unref (mask);
+  g_object_unref (buffer);
+  g_object_unref (expected);
+  g_object_unref (histogram);
+  gimp_histogram_cache_unref (cache);
+  g_rand_free (rand);
+}
+
+static gboolean
+group_layer_matches_child (GimpLayer *group,
+                           GimpLayer *child,
+                           gdouble    scale)
+{
+  const Babl    *format = babl_format ("R'G'B'A float");
+  GeglRectangle  rect   = { 0, 0,
+                            GIMP_TEST_IMAGE_SIZE * scale,
+                            GIMP_TEST_IMAGE_SIZE * scale };
+  gfloat        *result;
+  gfloat        *expected;
+  gboolean       match  = TRUE;
+  gint           i;
+
+  result   = g_new (gfloat, rect.width * rect.height * 4);
+  expected = g_new (gfloat, rect.width * rect.height * 4);
+
+  gegl_buffer_get (gimp_drawable_get_buffer (GIMP_DRAWABLE (group)),
+                   &rect, scale, format, result,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+  gegl_buffer_get (gimp_drawable_get_buffer (GIMP_DRAWABLE (child)),
+                   &rect, scale, format, expected,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  for (i = 0; i < rect.width * rect.height * 4; i++)
+    {
+      if (fabs (result[i] - expected[i]) > 1e-3)
+        {
+          g_test_message ("scale %g, pixel %d, component %d: "
+                          "expected %g, got %g",
+                          scale, i / 4, i % 4, expected[i], result[i]);
+
+          match = FALSE;
+          break;
+        }
+    }
+
+  g_free (expected);
+  g_free (result);
+
+  return match;
+}
+
+/**
+ * group_layer_renders_levels_lazily:
+ * @fixture:
+ * @data:
+ *
+ * Makes sure that reading the projection of a layer group at a lower
+ * zoom level, after one of its children changes, renders it at that
+ * level without validating it in full resolution, that it's still
+ * rendered correctly in full resolution afterwards, and that the
+ * projection of a pinned group is validated in the background.
+ **/
+static void
+group_layer_renders_levels_lazily (GimpTestFixture *fixture,
+                                   gconstpointer    data)
+{
+  GimpImage               *image = fixture->image;
+  GimpLayer               *group;
+  GimpLayer               *child;
+  GimpProjection          *projection;
+  GimpTileHandlerValidate *validate;
+  GRand                   *rand;
+  gint64                   coarse_memsize;
+  gint64                   memsize;
+
+  rand = g_rand_new_with_seed (1);
+
+  group = gimp_group_layer_new (image);
+
+  gimp_image_add_layer (image, group, GIMP_IMAGE_ACTIVE_PARENT, 0, FALSE);
+
+  child = gimp_layer_new (image,
+                          GIMP_TEST_IMAGE_SIZE,
+                          GIMP_TEST_IMAGE_SIZE,
+                          gimp_image_get_layer_format (image, TRUE),
+                          "Test Layer",
+                          GIMP_OPACITY_OPAQUE,
+                          GIMP_LAYER_MODE_NORMAL);
+
+  gimp_image_add_layer (image, child, group, 0, FALSE);
+
+  projection = gimp_group_layer_get_projection (GIMP_GROUP_LAYER (group));
+
+  g_assert_true (gimp_projection_get_render_levels (projection));
+
+  fill_random (gimp_drawable_get_buffer (GIMP_DRAWABLE (child)),
+               GEGL_RECTANGLE (0, 0,
+                               GIMP_TEST_IMAGE_SIZE, GIMP_TEST_IMAGE_SIZE),
+               rand);
+  gimp_drawable_update_all (GIMP_DRAWABLE (child));
+
+  validate = gimp_tile_handler_validate_get_assigned (
+    gimp_drawable_get_buffer (GIMP_DRAWABLE (group)));
+
+  g_assert_nonnull (validate);
+
+  if (! group_layer_matches_child (group, child, 0.25))
+    g_test_fail_printf ("group doesn't match its child at scale 0.25");
+
+  if (cairo_region_is_empty (validate->dirty_region))
+    g_test_fail_printf ("reading at scale 0.25 validated the group");
+
+  coarse_memsize = gimp_group_layer_get_cache_memsize (GIMP_GROUP_LAYER (group));
+
+  if (! group_layer_matches_child (group, child, 1.0))
+    g_test_fail_printf ("group doesn't match its child at scale 1.0");
+
+  /*  the cache size follows the tiles that were actually rendered  */
+  memsize = gimp_group_layer_get_cache_memsize (GIMP_GROUP_LAYER (group));
+
+  g_assert_cmpint (coarse_memsize, >, 0);
+  g_assert_cmpint (memsize, >, coarse_memsize);
+  g_assert_cmpuint (gimp_group_layer_get_total_cache_memsize (), >=,
+                    memsize);
+
+  /*  pinned groups are validated without being read  */
+  gimp_group_layer_set_pinned (GIMP_GROUP_LAYER (group), TRUE);
+
+  g_assert_false (gimp_projection_get_render_levels (projection));
+  g_assert_cmpuint (gimp_group_layer_get_pinned_cache_memsize (), >=,
+                    memsize);
+
+  fill_random (gimp_drawable_get_buffer (GIMP_DRAWABLE (child)),
+               GEGL_RECTANGLE (10, 20, 30, 40),
+               rand);
+  gimp_drawable_update (GIMP_DRAWABLE (child), 10, 20, 30, 40);
+
+  while (g_main_context_pending (NULL))
+    g_main_context_iteration (NULL, FALSE);
+
+  if (! cairo_region_is_empty (validate->dirty_region))
+    g_test_fail_printf ("pinned group wasn't validated in the background");
+
+  if (! group_layer_matches_child (group, child, 1.0))
+    g_test_fail_printf ("pinned group doesn't match its child");
+
+  g_rand_free (rand);
+}
+
+static GimpLayer *
+projection_test_layer_new (GimpImage     *image,
+                           GimpLayer     *parent,
+                           gint           width,
+                           gint           height,
+                           GimpLayerMode  mode,
+                           gdouble        opacity,
+                           GRand         *rand)
+{
+  GimpLayer *layer;
+
+  layer = gimp_layer_new (image, width, height,
+                          gimp_image_get_layer_format (image, TRUE),
+                          "Test Layer", opacity, mode);
+
+  gimp_image_add_layer (image, layer, parent, 0, FALSE);
+
+  fill_random (gimp_drawable_get_buffer (GIMP_DRAWABLE (layer)),
+               GEGL_RECTANGLE (0, 0, width, height),
+               rand);
+
+  return layer;
+}
+
+static gfloat *
+projection_test_read (GimpProjection      *projection,
+                      const GeglRectangle *rect)
+{
+  gfloat *data = g_new (gfloat, rect->width * rect->height * 4);
+
+  gegl_buffer_get (gimp_pickable_get_buffer (GIMP_PICKABLE (projection)),
+                   rect, 1.0, babl_format ("RGBA float"), data,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  return data;
+}
+
+/**
+ * projection_renders_threaded_like_sync:
+ * @fixture:
+ * @data:
+ *
+ * Makes sure that the projection of an image with layer groups, one of
+ * them pass-through, rendered by the render thread while the main loop
+ * keeps running, is the same as the projection rendered synchronously.
+ **/
+static void
+projection_renders_threaded_like_sync (GimpTestFixture *fixture,
+                                       gconstpointer    data)
+{
+  Gimp           *gimp = GIMP (data);
+  GeglRectangle   rect = { 0, 0, 512, 512 };
+  GimpImage      *image;
+  GimpProjection *projection;
+  GimpLayer      *group;
+  GimpLayer      *layer;
+  GRand          *rand;
+  gfloat         *result;
+  gfloat         *expected;
+  gboolean        threaded;
+  gint            i;
+
+  g_object_get (gimp->config,
+                "threaded-projection", &threaded,
+                NULL);
+
+  rand = g_rand_new_with_seed (1);
+
+  image = gimp_image_new (gimp, rect.width, rect.height,
+                          GIMP_RGB, GIMP_PRECISION_FLOAT_LINEAR);
+
+  projection = gimp_image_get_projection (image);
+
+  projection_test_layer_new (image, GIMP_IMAGE_ACTIVE_PARENT,
+                             rect.width, rect.height,
+                             GIMP_LAYER_MODE_NORMAL, GIMP_OPACITY_OPAQUE,
+                             rand);
+
+  group = gimp_group_layer_new (image);
+  gimp_layer_set_opacity (group, 0.8, FALSE);
+  gimp_image_add_layer (image, group, GIMP_IMAGE_ACTIVE_PARENT, 0, FALSE);
+
+  projection_test_layer_new (image, group, rect.width, rect.height,
+                             GIMP_LAYER_MODE_OVERLAY, 0.6, rand);
+  layer = projection_test_layer_new (image, group, 200, 300,
+                                     GIMP_LAYER_MODE_NORMAL, 0.5, rand);
+  gimp_item_set_offset (GIMP_ITEM (layer), 100, 150);
+
+  group = gimp_group_layer_new (image);
+  gimp_layer_set_mode (group, GIMP_LAYER_MODE_PASS_THROUGH, FALSE);
+  gimp_image_add_layer (image, group, GIMP_IMAGE_ACTIVE_PARENT, 0, FALSE);
+
+  projection_test_layer_new (image, group, rect.width, rect.height,
+                             GIMP_LAYER_MODE_MULTIPLY, 0.7, rand);
+
+  /*  render the projection in the render thread  */
+  g_object_set (gimp->config,
+                "threaded-projection", TRUE,
+                NULL);
+
+  gimp_projectable_invalidate (GIMP_PROJECTABLE (image),
+                               rect.x, rect.y, rect.width, rect.height);
+  gimp_projectable_flush (GIMP_PROJECTABLE (image), FALSE);
+
+  g_assert_true (gimp_projection_is_rendering (projection));
+
+  while (gimp_projection_is_rendering (projection))
+    g_main_context_iteration (NULL, TRUE);
+
+  result = projection_test_read (projection, &rect);
+
+  /*  render it again, synchronously  */
+  g_object_set (gimp->config,
+                "threaded-projection", FALSE,
+                NULL);
+
+  gimp_projectable_invalidate (GIMP_PROJECTABLE (image),
+                               rect.x, rect.y, rect.width, rect.height);
+  gimp_pickable_flush (GIMP_PICKABLE (projection));
+
+  g_assert_false (gimp_projection_is_rendering (projection));
+
+  expected = projection_test_read (projection, &rect);
+
+  for (i = 0; i < rect.width * rect.height * 4; i++)
+    {
+      if (fabs (result[i] - expected[i]) > 1e-4)
+        {
+          g_test_fail_printf ("pixel %d, component %d: expected %g, got %g",
+                              i / 4, i % 4, expected[i], result[i]);
+          break;
+        }
+    }
+
+  g_object_set (gimp->config,
+                "threaded-projection", threaded,
+                NULL);
+
+  g_free (expected);
+  g_free (result);
+  g_object_unref (image);
+  g_rand_free (rand);
+}
+
+/*  the link cost of the Intelligent Scissors, for moving from the pixel
+ *  with gradient @from to its neighbor with gradient @to, in direction
+ *  @k, truncated the same way as by the search.
+ */
+static gint
+iscissors_link_cost (const guint8 *from,
+                     const guint8 *to,
+                     gint          k)
+{
+  gint d = k & 3;
+  gint grad;
+  gint value = 0;
+  gint i;
+  gint direction_value[2];
+
+  for (i = 0; i < 2; i++)
+    {
+      gint v = i ? from[1] : to[1];
+
+      if (v == 255)
+        direction_value[i] = 255;
+      else if (d == 0)
+        direction_value[i] = (127 - ABS (127 - v)) * 2;
+      else if (d == 1)
+        direction_value[i] = ABS (127 - v) * 2;
+      else if (d == 2)
+        direction_value[i] = ABS (191 - v) * 2;
+      else
+        direction_value[i] = ABS (63 - v) * 2;
+    }
+
+  grad = 255 - to[0];
+
+  if (d > 1)
+    value += (gint) (grad * G_SQRT2) * 0.8;
+  else
+    value += grad * 0.8;
+
+  value += (direction_value[0] + direction_value[1]) * 0.2;
+
+  return value;
+}
+
+/**
+ * iscissors_search_finds_lowest_cost_paths:
+ * @fixture:
+ * @data:
+ *
+ * Makes sure that the paths found by the incremental livewire search of
+ * the Intelligent Scissors are connected, and as cheap as the ones found
+ * by a plain Dijkstra search over the whole gradient map, whatever the
+ * order in which they are requested.
+ **/
+static void
+iscissors_search_finds_lowest_cost_paths (GimpTestFixture *fixture,
+                                          gconstpointer    data)
+{
+  /*  where to move on a given link direction, as in the search  */
+  const gint move[8][2] =
+  {
+    {  1,  0 }, {  0,  1 }, { -1,  1 }, {  1,  1 },
+    { -1,  0 }, {  0, -1 }, {  1, -1 }, { -1, -1 }
+  };
+  const gint targets[][2] =
+  {
+    { 140, 90 }, { 12, 15 }, { 70, 40 }, { 0, 99 }, { 139, 0 }, { 71, 41 }
+  };
+  const gint           width  = 150;
+  const gint           height = 100;
+  const gint           seed_x = 20;
+  const gint           seed_y = 60;
+  GeglBuffer          *gradient_map;
+  GimpIscissorsSearch *search;
+  GRand               *rand;
+  guint8              *gradient;
+  guint32             *cost;
+  gboolean            *settled;
+  gint64               n_settled = 0;
+  gint                 i;
+  gint                 k;
+
+  rand     = g_rand_new_with_seed (1);
+  gradient = g_new (guint8, width * height * 2);
+  cost     = g_new (guint32, width * height);
+  settled  = g_new0 (gboolean, width * height);
+
+  /*  random gradients, with a strong edge across the map, so that the
+   *  paths follow it over blocks of the search.
+   */
+  for (i = 0; i < width * height; i++)
+    {
+      gint y = i / width;
+
+      gradient[2 * i + 0] = g_rand_int_range (rand, 0, 256);
+      gradient[2 * i + 1] = g_rand_int_range (rand, 0, 256);
+
+      if (y == 40 + (i % width) / 10)
+        {
+          gradient[2 * i + 0] = 255;
+          gradient[2 * i + 1] = 0;
+        }
+    }
+
+  gradient_map = gegl_buffer_new (GEGL_RECTANGLE (0, 0, width, height),
+                                  babl_format_n (babl_type ("u8"), 2));
+  gegl_buffer_set (gradient_map, GEGL_RECTANGLE (0, 0, width, height), 0,
+                   NULL, gradient, GEGL_AUTO_ROWSTRIDE);
+
+  /*  the reference: a plain Dijkstra search from the seed point  */
+  for (i = 0; i < width * height; i++)
+    cost[i] = G_MAXUINT32;
+
+  cost[seed_y * width + seed_x] = 0;
+
+  while (TRUE)
+    {
+      gint best = -1;
+
+      for (i = 0; i < width * height; i++)
+        {
+          if (! settled[i] && cost[i] != G_MAXUINT32 &&
+              (best < 0 || cost[i] < cost[best]))
+            {
+              best = i;
+            }
+        }
+
+      if (best < 0)
+        break;
+
+      settled[best] = TRUE;
+
+      for (k = 0; k < 8; k++)
+        {
+          gint x = best % width + move[k][0];
+          gint y = best / width + move[k][1];
+          gint n = y * width + x;
+
+          if (x < 0 || y < 0 || x >= width || y >= height || settled[n])
+            continue;
+
+          cost[n] = MIN (cost[n],
+                         cost[best] +
+                         iscissors_link_cost (gradient + 2 * best,
+                                              gradient + 2 * n, k));
+        }
+    }
+
+  search = gimp_iscissors_search_new (gradient_map, seed_x, seed_y);
+
+  for (i = 0; i < G_N_ELEMENTS (targets); i++)
+    {
+      GPtrArray *path;
+      guint32    path_cost = 0;
+      gint       p;
+
+      path = gimp_iscissors_search_find_path (search,
+                                              targets[i][0], targets[i][1]);
+
+      g_assert_cmpint (GPOINTER_TO_INT (path->pdata[0]), ==,
+                       (targets[i][1] << 16) + targets[i][0]);
+      g_assert_cmpint (GPOINTER_TO_INT (path->pdata[path->len - 1]), ==,
+                       (seed_y << 16) + seed_x);
+
+      /*  the path goes from the target to the seed point, so each link
+       *  is paid for moving from a point to the previous one
+       */
+      for (p = path->len - 1; p > 0; p--)
+        {
+          gint from = GPOINTER_TO_INT (path->pdata[p]);
+          gint to   = GPOINTER_TO_INT (path->pdata[p - 1]);
+          gint dx   = (to & 0xffff) - (from & 0xffff);
+          gint dy   = (to >> 16)    - (from >> 16);
+
+          for (k = 0; k < 8; k++)
+            {
+              if (move[k][0] == dx && move[k][1] == dy)
+                break;
+            }
+
+          if (k == 8)
+            {
+              g_test_fail_printf ("target %d: path is not connected", i);
+              break;
+            }
+
+          path_cost += iscissors_link_cost (
+            gradient + 2 * ((from >> 16) * width + (from & 0xffff)),
+            gradient + 2 * ((to   >> 16) * width + (to   & 0xffff)),
+            k);
+        }
+
+      if (path_cost != cost[targets[i][1] * width + targets[i][0]])
+        {
+          g_test_fail_printf ("target %d: expected cost %u, got %u",
+                              i, cost[targets[i][1] * width + targets[i][0]],
+                              path_cost);
+        }
+
+      /*  the search only ever grows  */
+      g_assert_cmpint (gimp_iscissors_search_get_n_settled (search), >=,
+                       n_settled);
+      n_settled = gimp_iscissors_search_get_n_settled (search);
+
+      g_ptr_array_free (path, TRUE);
+    }
+
+  g_test_message ("settled %" G_GINT64_FORMAT " of %d pixels",
+                  n_settled, width * height);
+
+  gimp_iscissors_search_free (search);
+
+  g_object_unref (gradient_map);
+
+  g_free (settled);
+  g_free (cost);
+  g_free (gradient);
+  g_rand_free (rand);
+}
+
+/*  renders the Green coordinates of @config over @rect  */
+static gfloat *
+cage_coef_calc (GimpCageConfig      *config,
+                const GeglRectangle *rect)
+{
+  const Babl *format;
+  GeglNode   *node;
+  gfloat     *coef;
+
+  format = babl_format_n (babl_type ("float"),
+                          2 * gimp_cage_config_get_n_points (config));
+  coef   = g_new (gfloat, (gsize) rect->width * rect->height *
+                          2 * gimp_cage_config_get_n_points (config));
+
+  node = gegl_node_new_child (NULL,
+                              "operation", "gimp:cage-coef-calc",
+                              "config",    config,
+                              NULL);
+
+  gegl_node_blit (node, 1.0, rect, format, coef,
+                  GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+  g_object_unref (node);
+
+  return coef;
+}
+
+/*  checks that the updated coefficients in @coef are the same as the
+ *  ones computed from scratch for @config
+ */
+static void
+cage_coef_calc_check_update (GimpCageConfig *config,
+                             GArray         *old_points,
+                             GeglBuffer     *coef,
+                             const gchar    *what)
+{
+  GeglRectangle  rect = gimp_cage_config_get_bounding_box (config);
+  gint           n    = gimp_cage_config_get_n_points (config);
+  gsize          size = (gsize) rect.width * rect.height * 2 * n;
+  gfloat        *expected;
+  gfloat        *result;
+
+  if (! gimp_operation_cage_coef_calc_update (config, old_points, coef))
+    {
+      g_test_fail_printf ("%s: the coefficients were not updated", what);
+
+      return;
+    }
+
+  expected = cage_coef_calc (config, &rect);
+  result   = g_new (gfloat, size);
+
+  gegl_buffer_get (coef, &rect, 1.0,
+                   babl_format_n (babl_type ("float"), 2 * n), result,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  if (memcmp (result, expected, size * sizeof (gfloat)))
+    {
+      g_test_fail_printf ("%s: the updated coefficients differ from "
+                          "the computed ones", what);
+    }
+
+  g_free (result);
+  g_free (expected);
+}
+
+/**
+ * cage_coef_calc_updates_moved_points:
+ * @fixture:
+ * @data:
+ *
+ * Makes sure that the Green coordinates computed by the cage transform
+ * map each pixel inside of an undeformed cage to itself, and that
+ * updating them after moving a few cage points gives exactly the same
+ * coefficients as computing them from scratch.
+ **/
+static void
+cage_coef_calc_updates_moved_points (GimpTestFixture *fixture,
+                                     gconstpointer    data)
+{
+  GimpCageConfig *config;
+  GeglRectangle   rect;
+  GeglBuffer     *buffer;
+  GArray         *old_points;
+  gfloat         *coef;
+  gdouble         max_error = 0.0;
+  gint            n_outside = 0;
+  gint            n         = CAGE_N_POINTS;
+  gint            x, y;
+  gint            i;
+
+  config = g_object_new (GIMP_TYPE_CAGE_CONFIG, NULL);
+
+  /*  a star, whose inner points are 40 pixels away from its center,
+   *  already in the cage's orientation
+   */
+  for (i = 0; i < n; i++)
+    {
+      gdouble angle  = -2.0 * G_PI * i / n;
+      gdouble radius = (i & 1) ? 48.0 : 40.0;
+
+      gimp_cage_config_add_cage_point (config,
+                                       CAGE_CENTER + radius * cos (angle),
+                                       CAGE_CENTER + radius * sin (angle));
+    }
+
+  gimp_cage_config_reverse_cage_if_needed (config);
+
+  rect = gimp_cage_config_get_bounding_box (config);
+  coef = cage_coef_calc (config, &rect);
+
+  for (y = rect.y; y < rect.y + rect.height; y++)
+    {
+      for (x = rect.x; x < rect.x + rect.width; x++)
+        {
+          const gfloat *pixel  = coef + ((y - rect.y) * rect.width +
+                                         (x - rect.x)) * 2 * n;
+          gdouble       dist   = hypot (x - CAGE_CENTER, y - CAGE_CENTER);
+          GimpVector2   result = { 0.0, 0.0 };
+
+          if (dist > 50.0)
+            {
+              for (i = 0; i < 2 * n; i++)
+                {
+                  if (pixel[i] != 0.0f)
+                    {
+                      n_outside++;
+                      break;
+                    }
+                }
+            }
+          else if (dist < 36.0)
+            {
+              for (i = 0; i < n; i++)
+                {
+                  GimpCagePoint *point = &g_array_index (config->cage_points,
+                                                         GimpCagePoint, i);
+
+                  result.x += pixel[i] * point->dest_point.x;
+                  result.y += pixel[i] * point->dest_point.y;
+
+                  result.x += pixel[i + n] * point->edge_scaling_factor *
+                              point->edge_normal.x;
+                  result.y += pixel[i + n] * point->edge_scaling_factor *
+                              point->edge_normal.y;
+                }
+
+              max_error = MAX (max_error, fabs (result.x - x));
+              max_error = MAX (max_error, fabs (result.y - y));
+            }
+        }
+    }
+
+  if (n_outside)
+    {
+      g_test_fail_printf ("%d pixels outside of the cage have coefficients",
+                          n_outside);
+    }
+
+  g_test_message ("undeformed cage: max error %g pixels", max_error);
+
+  if (max_error > 0.01)
+    {
+      g_test_fail_printf ("the undeformed cage moves pixels by up to %g",
+                          max_error);
+    }
+
+  buffer = gegl_buffer_new (&rect,
+                            babl_format_n (babl_type ("float"), 2 * n));
+  gegl_buffer_set (buffer, &rect, 0, NULL, coef, GEGL_AUTO_ROWSTRIDE);
+
+  g_free (coef);
+
+  /*  move the top point inwards: pixels leave the cage  */
+  old_points = g_array_copy (config->cage_points);
+
+  gimp_cage_config_select_point (config, 3);
+  gimp_cage_config_add_displacement (config, GIMP_CAGE_MODE_CAGE_CHANGE,
+                                     -3.0, 4.0);
+  gimp_cage_config_commit_displacement (config);
+
+  cage_coef_calc_check_update (config, old_points, buffer, "inwards");
+
+  g_array_unref (old_points);
+
+  /*  move the inner point next to it outwards: pixels enter the cage  */
+  old_points = g_array_copy (config->cage_points);
+
+  gimp_cage_config_select_point (config, 2);
+  gimp_cage_config_add_displacement (config, GIMP_CAGE_MODE_CAGE_CHANGE,
+                                     2.0, -3.0);
+  gimp_cage_config_commit_displacement (config);
+
+  cage_coef_calc_check_update (config, old_points, buffer, "outwards");
+
+  g_array_unref (old_points);
+
+  /*  moving the whole cage is left to a full computation  */
+  old_points = g_array_copy (config->cage_points);
+
+  for (i = 0; i < n; i++)
+    {
+      GimpCagePoint *point = &g_array_index (config->cage_points,
+                                             GimpCagePoint, i);
+
+      point->selected = TRUE;
+    }
+
+  gimp_cage_config_add_displacement (config, GIMP_CAGE_MODE_CAGE_CHANGE,
+                                     1.0, 1.0);
+  gimp_cage_config_commit_displacement (config);
+
+  g_assert_false (gimp_operation_cage_coef_calc_update (config, old_points,
+                                                        buffer));
+
+  g_array_unref (old_points);
+
+  g_object_unref (buffer);
+  g_object_unref (config);
+}
+
 int
 main (int    argc,
       char **argv)
@@ -283,6 +2345,19 @@ main (int    argc,
   ADD_IMAGE_TEST (remove_layer);
   ADD_IMAGE_TEST (rotate_non_overlapping);
   ADD_TEST (white_graypoint_in_red_levels);
+  ADD_IMAGE_TEST (line_art_close_gaps);
+  ADD_TEST (brush_cache_quantized_keys);
+  ADD_TEST (lut3d_matches_color_transform);
+  ADD_TEST (lut3d_bounds_dark_ramp_error);
+  ADD_TEST (layer_mode_simd_matches_scalar);
+  ADD_TEST (layer_mode_converters_match_babl);
+  ADD_TEST (layer_modes_composite_mode_heavy_stack);
+  ADD_TEST (point_filter_chain_matches_filters);
+  ADD_TEST (histogram_cache_follows_changes);
+  ADD_IMAGE_TEST (group_layer_renders_levels_lazily);
+  ADD_TEST (projection_renders_threaded_like_sync);
+  ADD_TEST (iscissors_search_finds_lowest_cost_paths);
+  ADD_TEST (cage_coef_calc_updates_moved_points);
 
   /* Run the tests */
   result = g_test_run ();
@@ -33,6 +33,7 @@
 
 #include <gegl.h>
 #include <gtk/gtk.h>
+#include <glib/gstdio.h>
 
 #include "libgimpbase/gimpbase.h"
 
@@ -152,6 +153,12 @@
                                           { 921.0, 922.0, /* pad zeroes */ },\
                                           { 931.0, 932.0, /* pad zeroes */ }, }
 
+#define GIMP_TILES_IMAGE_WIDTH          1000
+#define GIMP_TILES_IMAGE_HEIGHT         800
+#define GIMP_TILES_IMAGE_PERF_WIDTH     8192
+#define GIMP_TILES_IMAGE_PERF_HEIGHT    6144
+#define GIMP_TILES_IMAGE_N_LAYERS       4
+
 #define ADD_TEST(function) \
   g_test_add_data_func ("/gimp-xcf/" #function, gimp, function);
 
@@ -162,6 +169,9 @@ static void        gimp_write_and_read_file                    (Gimp
                                                                 gboolean         with_unusual_stuff,
                                                                 gboolean         compat_paths,
                                                                 gboolean         use_gimp_2_8_features);
+static void        gimp_write_and_read_tiles                   (Gimp            *gimp,
+                                                                gboolean         zlib,
+                                                                gboolean         lazy);
 static GimpImage * gimp_create_mainimage                       (Gimp            *gimp,
                                                                 gboolean         with_unusual_stuff,
                                                                 gboolean         compat_paths,
@@ -263,6 +273,53 @@ write_and_read_gimp_2_8_format (gconstpointer data)
                             TRUE /*use_gimp_2_8_features*/);
 }
 
+/**
+ * write_and_read_rle_tiles:
+ * @data:
+ *
+ * Writes an image with several large layers using RLE tile
+ * compression, then reads it back and makes sure the pixels survived.
+ * When running in performance mode, a much larger image is used and
+ * the time spent loading it is reported.
+ **/
+static void
+write_and_read_rle_tiles (gconstpointer data)
+{
+  Gimp *gimp = GIMP (data);
+
+  gimp_write_and_read_tiles (gimp, FALSE /*zlib*/, FALSE /*lazy*/);
+}
+
+/**
+ * write_and_read_zlib_tiles:
+ * @data:
+ *
+ * Same as write_and_read_rle_tiles(), using zlib tile compression.
+ **/
+static void
+write_and_read_zlib_tiles (gconstpointer data)
+{
+  Gimp *gimp = GIMP (data);
+
+  gimp_write_and_read_tiles (gimp, TRUE /*zlib*/, FALSE /*lazy*/);
+}
+
+/**
+ * write_and_read_lazy_tiles:
+ * @data:
+ *
+ * Same as write_and_read_rle_tiles(), with "xcf-lazy-loading" enabled,
+ * so that the loaded layers read their tiles from the mapped file, and
+ * makes sure that edited tiles survive the file being truncated.
+ **/
+static void
+write_and_read_lazy_tiles (gconstpointer data)
+{
+  Gimp *gimp = GIMP (data);
+
+  gimp_write_and_read_tiles (gimp, FALSE /*zlib*/, TRUE /*lazy*/);
+}
+
 GimpImage *
 gimp_test_load_image (Gimp  *gimp,
                       GFile *file)
@@ -363,6 +420,219 @@ gimp_write_and_read_file (Gimp     *gimp,
   g_object_unref (file);
 }
 
+/**
+ * gimp_write_and_read_tiles:
+ *
+ * Creates an image whose layers span many XCF tiles, writes it with
+ * the requested tile compression, reads it back and compares the
+ * layer pixels.
+ **/
+static void
+gimp_write_and_read_tiles (Gimp     *gimp,
+                           gboolean  zlib,
+                           gboolean  lazy)
+{
+  GimpImage           *image;
+  GimpImage           *loaded_image;
+  GimpPlugInProcedure *proc;
+  const Babl          *format = babl_format ("R'G'B'A u8");
+  gchar               *filename = NULL;
+  gint                 file_handle;
+  GFile               *file;
+  guchar              *row;
+  guchar              *src;
+  guchar              *dest;
+  gint                 width;
+  gint                 height;
+  gdouble              elapsed;
+  gint                 i, x, y;
+
+  if (g_test_perf ())
+    {
+      width  = GIMP_TILES_IMAGE_PERF_WIDTH;
+      height = GIMP_TILES_IMAGE_PERF_HEIGHT;
+    }
+  else
+    {
+      width  = GIMP_TILES_IMAGE_WIDTH;
+      height = GIMP_TILES_IMAGE_HEIGHT;
+    }
+
+  image = gimp_image_new (gimp, width, height,
+                          GIMP_RGB, GIMP_PRECISION_U8_NON_LINEAR);
+
+  gimp_image_set_xcf_compression (image, zlib);
+
+  row = g_malloc (width * 4);
+
+  for (i = 0; i < GIMP_TILES_IMAGE_N_LAYERS; i++)
+    {
+      GimpLayer *layer;
+      gchar     *name = g_strdup_printf ("layer%d", i);
+
+      layer = gimp_layer_new (image, width, height, format, name,
+                              GIMP_OPACITY_OPAQUE,
+                              GIMP_LAYER_MODE_NORMAL);
+      g_free (name);
+
+      /* a mix of flat areas and noise, so that both run kinds of the
+       * RLE encoder are exercised, and some tiles are entirely empty.
+       */
+      for (y = 0; y < height; y++)
+        {
+          for (x = 0; x < width; x++)
+            {
+              guint32 v = (x * 2654435761u) ^ (y * 40503u) ^ i;
+
+              if ((x / 64 + y / 64 + i) % 3 == 0)
+                v = 0;
+              else if ((x / 64 + y / 64 + i) % 3 == 1)
+                v = (x / 16 + y / 16) * 0x01010101;
+
+              row[x * 4 + 0] = v;
+              row[x * 4 + 1] = v >> 8;
+              row[x * 4 + 2] = v >> 16;
+              row[x * 4 + 3] = v ? 255 : 0;
+            }
+
+          gegl_buffer_set (gimp_drawable_get_buffer (GIMP_DRAWABLE (layer)),
+                           GEGL_RECTANGLE (0, y, width, 1), 0,
+                           format, row, GEGL_AUTO_ROWSTRIDE);
+        }
+
+      gimp_image_add_layer (image, layer, NULL, 0, FALSE /*push_undo*/);
+    }
+
+  g_free (row);
+
+  file_handle = g_file_open_tmp ("gimp-test-XXXXXX.xcf", &filename, NULL);
+  g_assert_true (file_handle != -1);
+  close (file_handle);
+  file = g_file_new_for_path (filename);
+  g_free (filename);
+
+  proc = gimp_plug_in_manager_file_procedure_find (gimp->plug_in_manager,
+                                                   GIMP_FILE_PROCEDURE_GROUP_SAVE,
+                                                   file,
+                                                   NULL /*error*/);
+  file_save (gimp,
+             image,
+             NULL /*progress*/,
+             file,
+             proc,
+             GIMP_RUN_NONINTERACTIVE,
+             FALSE /*change_saved_state*/,
+             FALSE /*export_backward*/,
+             FALSE /*export_forward*/,
+             NULL /*error*/);
+
+  g_object_set (gimp->config,
+                "xcf-lazy-loading", lazy,
+                NULL);
+
+  g_test_timer_start ();
+
+  loaded_image = gimp_test_load_image (gimp, file);
+
+  elapsed = g_test_timer_elapsed ();
+
+  g_object_set (gimp->config,
+                "xcf-lazy-loading", FALSE,
+                NULL);
+
+  if (g_test_perf ())
+    g_test_minimized_result (elapsed,
+                             "loading %dx%d, %d layers, %s compressed%s: %g s",
+                             width, height, GIMP_TILES_IMAGE_N_LAYERS,
+                             zlib ? "zlib" : "RLE", lazy ? ", lazily" : "",
+                             elapsed);
+
+  g_assert_true (loaded_image != NULL);
+
+  src  = g_malloc (width * height * 4);
+  dest = g_malloc (width * height * 4);
+
+  for (i = 0; i < GIMP_TILES_IMAGE_N_LAYERS; i++)
+    {
+      gchar     *name = g_strdup_printf ("layer%d", i);
+      GimpLayer *layer;
+      GimpLayer *loaded_layer;
+
+      layer        = gimp_image_get_layer_by_name (image, name);
+      loaded_layer = gimp_image_get_layer_by_name (loaded_image, name);
+      g_free (name);
+
+      g_assert_true (loaded_layer != NULL);
+
+      gegl_buffer_get (gimp_drawable_get_buffer (GIMP_DRAWABLE (layer)),
+                       GEGL_RECTANGLE (0, 0, width, height), 1.0,
+                       format, src,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+      gegl_buffer_get (gimp_drawable_get_buffer (GIMP_DRAWABLE (loaded_layer)),
+                       GEGL_RECTANGLE (0, 0, width, height), 1.0,
+                       format, dest,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+      g_assert_true (memcmp (src, dest, width * height * 4) == 0);
+    }
+
+  if (lazy)
+    {
+      GimpLayer     *loaded_layer;
+      GeglBuffer    *buffer;
+      GeglRectangle  rect = { 10, 20, 100, 80 };
+      guint64        cache_size;
+      gchar         *path;
+      FILE          *fp;
+
+      loaded_layer = gimp_image_get_layer_by_name (loaded_image, "layer0");
+      buffer       = gimp_drawable_get_buffer (GIMP_DRAWABLE (loaded_layer));
+
+      /* with no room in the tile cache, the edited tiles are written
+       * back to the backend, and the others are decoded from the file
+       * again.
+       */
+      g_object_get (gegl_config (), "tile-cache-size", &cache_size, NULL);
+      g_object_set (gegl_config (), "tile-cache-size", (guint64) 0, NULL);
+
+      memset (src, 0x80, rect.width * rect.height * 4);
+
+      gegl_buffer_set (buffer, &rect, 0, format, src, GEGL_AUTO_ROWSTRIDE);
+      gegl_buffer_flush (buffer);
+
+      /* truncate the mapped file in place: the tiles which are not in it
+       * anymore must read as transparent, rather than raise SIGBUS.
+       */
+      path = g_file_get_path (file);
+      fp   = g_fopen (path, "wb");
+      g_assert_nonnull (fp);
+      fclose (fp);
+      g_free (path);
+
+      gegl_buffer_get (buffer, GEGL_RECTANGLE (0, 0, width, height), 1.0,
+                       format, dest,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+      for (y = 0; y < rect.height; y++)
+        {
+          g_assert_true (memcmp (src + y * rect.width * 4,
+                                 dest + ((rect.y + y) * width + rect.x) * 4,
+                                 rect.width * 4) == 0);
+        }
+
+      g_object_set (gegl_config (), "tile-cache-size", cache_size, NULL);
+    }
+
+  g_free (src);
+  g_free (dest);
+
+  g_object_unref (loaded_image);
+  g_object_unref (image);
+
+  g_file_delete (file, NULL, NULL);
+  g_object_unref (file);
+}
+
 /**
  * gimp_create_mainimage:
  *
@@ -678,7 +948,6 @@ gimp_create_mainimage (Gimp     *gimp,
    * - Text layers
    * - Layer parasites
    * - Channel parasites
-   * - Different tile compression methods
    */
 
   return image;
@@ -1034,6 +1303,9 @@ main (int    argc,
   ADD_TEST (write_and_read_gimp_2_6_format_unusual);
   ADD_TEST (load_gimp_2_6_file);
   ADD_TEST (write_and_read_gimp_2_8_format);
+  ADD_TEST (write_and_read_rle_tiles);
+  ADD_TEST (write_and_read_zlib_tiles);
+  ADD_TEST (write_and_read_lazy_tiles);
 
   /* Don't write files to the source dir */
   gimp_test_utils_set_gimp3_directory ("GIMP_TESTING_ABS_TOP_BUILDDIR",
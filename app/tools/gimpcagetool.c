@@ -35,6 +35,7 @@
 #include "gegl/gimp-gegl-utils.h"
 
 #include "operations/gimpcageconfig.h"
+#include "operations/gimpoperationcagecoefcalc.h"
 
 #include "core/gimp.h"
 #include "core/gimpcontainer.h"
@@ -138,6 +139,7 @@ static gint       gimp_cage_tool_is_on_edge         (GimpCageTool          *ct,
 static gboolean   gimp_cage_tool_is_complete        (GimpCageTool          *ct);
 static void       gimp_cage_tool_remove_last_handle (GimpCageTool          *ct);
 static void       gimp_cage_tool_compute_coef       (GimpCageTool          *ct);
+static void       gimp_cage_tool_set_coef_points    (GimpCageTool          *ct);
 static void       gimp_cage_tool_create_filter      (GimpCageTool          *ct);
 static void       gimp_cage_tool_filter_flush       (GimpDrawableFilter    *filter,
                                                      GimpTool              *tool);
@@ -960,6 +962,7 @@ gimp_cage_tool_start (GimpCageTool *ct,
   g_clear_object (&ct->config);
 
   g_clear_object (&ct->coef);
+  g_clear_pointer (&ct->coef_points, g_array_unref);
   ct->dirty_coef = TRUE;
 
   if (ct->filter)
@@ -996,6 +999,7 @@ gimp_cage_tool_halt (GimpCageTool *ct)
 
   g_clear_object (&ct->config);
   g_clear_object (&ct->coef);
+  g_clear_pointer (&ct->coef_points, g_array_unref);
   g_clear_object (&ct->render_node);
   ct->coef_node = NULL;
   ct->cage_node = NULL;
@@ -1168,6 +1172,29 @@ gimp_cage_tool_compute_coef (GimpCageTool *ct)
   GeglBuffer     *buffer;
   gdouble         value;
 
+  /*  if only a few cage points moved since the coefficients were last
+   *  computed, update a copy of them
+   */
+  if (ct->coef && ct->coef_points)
+    {
+      buffer = gegl_buffer_dup (ct->coef);
+
+      if (gimp_operation_cage_coef_calc_update (config, ct->coef_points,
+                                                buffer))
+        {
+          g_object_unref (ct->coef);
+          ct->coef = buffer;
+
+          gimp_cage_tool_set_coef_points (ct);
+
+          ct->dirty_coef = FALSE;
+
+          return;
+        }
+
+      g_object_unref (buffer);
+    }
+
   progress = gimp_progress_start (GIMP_PROGRESS (ct), FALSE,
                                   _("Computing Cage Coefficients"));
 
@@ -1208,9 +1235,23 @@ gimp_cage_tool_compute_coef (GimpCageTool *ct)
   ct->coef = buffer;
   g_object_unref (gegl);
 
+  gimp_cage_tool_set_coef_points (ct);
+
   ct->dirty_coef = FALSE;
 }
 
+static void
+gimp_cage_tool_set_coef_points (GimpCageTool *ct)
+{
+  GArray *points = ct->config->cage_points;
+
+  g_clear_pointer (&ct->coef_points, g_array_unref);
+
+  ct->coef_points = g_array_sized_new (FALSE, FALSE, sizeof (GimpCagePoint),
+                                       points->len);
+  g_array_append_vals (ct->coef_points, points->data, points->len);
+}
+
 static void
 gimp_cage_tool_create_render_node (GimpCageTool *ct)
 {
@@ -58,6 +58,7 @@ struct _GimpCageTool
 
   GeglBuffer     *coef; /* Gegl buffer where the coefficient of the transformation are stored */
   gboolean        dirty_coef; /* Indicate if the coef are still valid */
+  GArray         *coef_points; /* Cage points the coef were computed for */
 
   GeglNode       *render_node; /* Gegl node graph to render the transformation */
   GeglNode       *cage_node; /* Gegl node that compute the cage transform */
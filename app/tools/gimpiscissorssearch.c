@@ -0,0 +1,462 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimpiscissorssearch.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* The livewire search of the Intelligent Scissors tool.
+ *
+ * Instead of running a dynamic program over the bounding box of a
+ * segment every time one of its end points moves, we run Dijkstra's
+ * algorithm from a fixed seed point, and only as far as needed to
+ * reach the requested end point.  The search state is kept around,
+ * so that as the other end point is dragged, paths to pixels that
+ * were already reached are found immediately, and the search is
+ * resumed from where it stopped otherwise.
+ *
+ * Link costs are small integers, so the open set is a bucket queue
+ * (Dial's algorithm), and the search state is allocated in blocks,
+ * as the search expands, together with a copy of the gradient map.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <gegl.h>
+
+#include "libgimpmath/gimpmath.h"
+
+#include "tools-types.h"
+
+#include "gimpiscissorssearch.h"
+
+
+#define BLOCK_SIZE   64
+#define N_BUCKETS    512    /* a power of 2 greater than the max link cost */
+
+/* weight to give between gradient (_G) and direction (_D) */
+#define OMEGA_D      0.2
+#define OMEGA_G      0.8
+
+/* link values of the search state, other than the directions 0..7 */
+#define LINK_SEED    9
+#define LINK_NONE    0x7f
+
+#define LINK_SETTLED 0x80
+
+
+typedef struct
+{
+  guint8  gradient[BLOCK_SIZE * BLOCK_SIZE * 2];
+  guint32 cost[BLOCK_SIZE * BLOCK_SIZE];
+  guint8  link[BLOCK_SIZE * BLOCK_SIZE];
+} Block;
+
+typedef struct
+{
+  gint x;
+  gint y;
+} Node;
+
+struct _GimpIscissorsSearch
+{
+  GeglBuffer *gradient_map;
+  gint        width;
+  gint        height;
+
+  gint        seed_x;
+  gint        seed_y;
+
+  gint        n_blocks_x;
+  gint        n_blocks_y;
+  Block     **blocks;
+
+  GArray     *buckets[N_BUCKETS];
+  guint32     cost;
+  gint64      n_queued;
+  gint64      n_settled;
+};
+
+
+/*  local function prototypes  */
+
+static void       gimp_iscissors_search_init_weights (void);
+
+static Block    * gimp_iscissors_search_get_block    (GimpIscissorsSearch *search,
+                                                      gint                 x,
+                                                      gint                 y,
+                                                      gint                *index);
+static void       gimp_iscissors_search_push         (GimpIscissorsSearch *search,
+                                                      gint                 x,
+                                                      gint                 y,
+                                                      guint32              cost,
+                                                      gint                 link);
+static gboolean   gimp_iscissors_search_pop          (GimpIscissorsSearch *search,
+                                                      Node                *node);
+static void       gimp_iscissors_search_settle       (GimpIscissorsSearch *search,
+                                                      gint                 x,
+                                                      gint                 y);
+
+
+/*  static variables  */
+
+/*  where to move on a given link direction  */
+static const gint move[8][2] =
+{
+  {  1,  0 },
+  {  0,  1 },
+  { -1,  1 },
+  {  1,  1 },
+  { -1,  0 },
+  {  0, -1 },
+  {  1, -1 },
+  { -1, -1 },
+};
+
+static gint diagonal_weight[256];
+static gint direction_value[256][4];
+
+
+/*  public functions  */
+
+GimpIscissorsSearch *
+gimp_iscissors_search_new (GeglBuffer *gradient_map,
+                           gint        seed_x,
+                           gint        seed_y)
+{
+  GimpIscissorsSearch *search;
+  gint                 i;
+
+  g_return_val_if_fail (GEGL_IS_BUFFER (gradient_map), NULL);
+
+  gimp_iscissors_search_init_weights ();
+
+  search = g_slice_new0 (GimpIscissorsSearch);
+
+  search->gradient_map = g_object_ref (gradient_map);
+  search->width        = gegl_buffer_get_width  (gradient_map);
+  search->height       = gegl_buffer_get_height (gradient_map);
+
+  search->seed_x       = CLAMP (seed_x, 0, search->width  - 1);
+  search->seed_y       = CLAMP (seed_y, 0, search->height - 1);
+
+  search->n_blocks_x   = (search->width  + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  search->n_blocks_y   = (search->height + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  search->blocks       = g_new0 (Block *,
+                                 (gsize) search->n_blocks_x *
+                                 search->n_blocks_y);
+
+  for (i = 0; i < N_BUCKETS; i++)
+    search->buckets[i] = g_array_new (FALSE, FALSE, sizeof (Node));
+
+  gimp_iscissors_search_push (search, search->seed_x, search->seed_y,
+                              0, LINK_SEED);
+
+  return search;
+}
+
+void
+gimp_iscissors_search_free (GimpIscissorsSearch *search)
+{
+  gint64 i;
+
+  g_return_if_fail (search != NULL);
+
+  for (i = 0; i < (gint64) search->n_blocks_x * search->n_blocks_y; i++)
+    g_free (search->blocks[i]);
+
+  g_free (search->blocks);
+
+  for (i = 0; i < N_BUCKETS; i++)
+    g_array_free (search->buckets[i], TRUE);
+
+  g_object_unref (search->gradient_map);
+
+  g_slice_free (GimpIscissorsSearch, search);
+}
+
+void
+gimp_iscissors_search_get_seed (GimpIscissorsSearch *search,
+                                gint                *seed_x,
+                                gint                *seed_y)
+{
+  g_return_if_fail (search != NULL);
+
+  if (seed_x) *seed_x = search->seed_x;
+  if (seed_y) *seed_y = search->seed_y;
+}
+
+gint64
+gimp_iscissors_search_get_n_settled (GimpIscissorsSearch *search)
+{
+  g_return_val_if_fail (search != NULL, 0);
+
+  return search->n_settled;
+}
+
+/**
+ * gimp_iscissors_search_find_path:
+ * @search: a #GimpIscissorsSearch
+ * @x:      the end point's x coordinate
+ * @y:      the end point's y coordinate
+ *
+ * Finds the lowest-cost path from (@x, @y) to the seed point,
+ * extending the search as necessary.
+ *
+ * Returns: the pixels of the path, packed as ((y << 16) + x), from
+ *          (@x, @y) to the seed point, both inclusive.
+ **/
+GPtrArray *
+gimp_iscissors_search_find_path (GimpIscissorsSearch *search,
+                                 gint                 x,
+                                 gint                 y)
+{
+  GPtrArray *points;
+  Block     *block;
+  gint       index;
+  Node       node;
+
+  g_return_val_if_fail (search != NULL, NULL);
+
+  x = CLAMP (x, 0, search->width  - 1);
+  y = CLAMP (y, 0, search->height - 1);
+
+  block = gimp_iscissors_search_get_block (search, x, y, &index);
+
+  while (! (block->link[index] & LINK_SETTLED) &&
+         gimp_iscissors_search_pop (search, &node))
+    {
+      gimp_iscissors_search_settle (search, node.x, node.y);
+    }
+
+  points = g_ptr_array_new ();
+
+  while (TRUE)
+    {
+      gint link;
+
+      g_ptr_array_add (points, GINT_TO_POINTER ((y << 16) + x));
+
+      link = block->link[index] & ~LINK_SETTLED;
+
+      if (link == LINK_SEED || link == LINK_NONE)
+        break;
+
+      x += move[link][0];
+      y += move[link][1];
+
+      block = gimp_iscissors_search_get_block (search, x, y, &index);
+    }
+
+  return points;
+}
+
+
+/*  private functions  */
+
+static void
+gimp_iscissors_search_init_weights (void)
+{
+  static gsize initialized = 0;
+
+  if (g_once_init_enter (&initialized))
+    {
+      gint i;
+
+      for (i = 0; i < 256; i++)
+        {
+          /*  The diagonal weight array  */
+          diagonal_weight[i] = (int) (i * G_SQRT2);
+
+          /*  The direction value array  */
+          direction_value[i][0] = (127 - abs (127 - i)) * 2;
+          direction_value[i][1] = abs (127 - i) * 2;
+          direction_value[i][2] = abs (191 - i) * 2;
+          direction_value[i][3] = abs (63 - i) * 2;
+        }
+
+      /*  set the 256th index of the direction_values to the highest cost  */
+      direction_value[255][0] = 255;
+      direction_value[255][1] = 255;
+      direction_value[255][2] = 255;
+      direction_value[255][3] = 255;
+
+      g_once_init_leave (&initialized, 1);
+    }
+}
+
+static Block *
+gimp_iscissors_search_get_block (GimpIscissorsSearch *search,
+                                 gint                 x,
+                                 gint                 y,
+                                 gint                *index)
+{
+  gint64  i     = (gint64) (y / BLOCK_SIZE) * search->n_blocks_x +
+                  x / BLOCK_SIZE;
+  Block  *block = search->blocks[i];
+
+  if (! block)
+    {
+      GeglRectangle rect;
+
+      block = g_new (Block, 1);
+
+      memset (block->cost, 0xff, sizeof (block->cost));
+      memset (block->link, LINK_NONE, sizeof (block->link));
+
+      gegl_rectangle_intersect (&rect,
+                                GEGL_RECTANGLE (x - x % BLOCK_SIZE,
+                                                y - y % BLOCK_SIZE,
+                                                BLOCK_SIZE, BLOCK_SIZE),
+                                GEGL_RECTANGLE (0, 0,
+                                                search->width,
+                                                search->height));
+
+      /*  this validates the gradient map's tiles as needed  */
+      gegl_buffer_get (search->gradient_map, &rect, 1.0,
+                       gegl_buffer_get_format (search->gradient_map),
+                       block->gradient, 2 * BLOCK_SIZE,
+                       GEGL_ABYSS_NONE);
+
+      search->blocks[i] = block;
+    }
+
+  *index = (y % BLOCK_SIZE) * BLOCK_SIZE + x % BLOCK_SIZE;
+
+  return block;
+}
+
+static void
+gimp_iscissors_search_push (GimpIscissorsSearch *search,
+                            gint                 x,
+                            gint                 y,
+                            guint32              cost,
+                            gint                 link)
+{
+  Block *block;
+  Node   node = { x, y };
+  gint   index;
+
+  block = gimp_iscissors_search_get_block (search, x, y, &index);
+
+  block->cost[index] = cost;
+  block->link[index] = link;
+
+  g_array_append_val (search->buckets[cost % N_BUCKETS], node);
+
+  search->n_queued++;
+}
+
+static gboolean
+gimp_iscissors_search_pop (GimpIscissorsSearch *search,
+                           Node                *node)
+{
+  while (search->n_queued > 0)
+    {
+      GArray *bucket = search->buckets[search->cost % N_BUCKETS];
+      Block  *block;
+      gint    index;
+
+      if (bucket->len == 0)
+        {
+          search->cost++;
+
+          continue;
+        }
+
+      *node = g_array_index (bucket, Node, bucket->len - 1);
+
+      g_array_set_size (bucket, bucket->len - 1);
+      search->n_queued--;
+
+      block = gimp_iscissors_search_get_block (search, node->x, node->y,
+                                               &index);
+
+      /*  skip nodes which were reached again at a lower cost  */
+      if (! (block->link[index] & LINK_SETTLED) &&
+          block->cost[index] == search->cost)
+        {
+          return TRUE;
+        }
+    }
+
+  return FALSE;
+}
+
+static void
+gimp_iscissors_search_settle (GimpIscissorsSearch *search,
+                              gint                 x,
+                              gint                 y)
+{
+  Block        *block;
+  const guint8 *gradient;
+  guint32       cost;
+  gint          index;
+  gint          k;
+
+  block = gimp_iscissors_search_get_block (search, x, y, &index);
+
+  block->link[index] |= LINK_SETTLED;
+  search->n_settled++;
+
+  cost     = block->cost[index];
+  gradient = block->gradient + 2 * index;
+
+  /*  relax the links from all neighbors to this pixel  */
+  for (k = 0; k < 8; k++)
+    {
+      Block        *nblock;
+      const guint8 *ngradient;
+      gint          nx = x + move[k][0];
+      gint          ny = y + move[k][1];
+      gint          nindex;
+      gint          link;
+      gint          value = 0;
+      guint8        grad;
+
+      if (nx < 0 || ny < 0 || nx >= search->width || ny >= search->height)
+        continue;
+
+      nblock = gimp_iscissors_search_get_block (search, nx, ny, &nindex);
+
+      if (nblock->link[nindex] & LINK_SETTLED)
+        continue;
+
+      ngradient = nblock->gradient + 2 * nindex;
+
+      /*  the neighbor links back to this pixel in the opposite direction,
+       *  and pays for its own gradient: large gradients are good, and so
+       *  have low cost.
+       */
+      link = (k > 3) ? k - 4 : k + 4;
+      grad = 255 - ngradient[0];
+
+      /*  calculate the contribution of the gradient magnitude  */
+      if ((k & 3) > 1)
+        value += diagonal_weight[grad] * OMEGA_G;
+      else
+        value += grad * OMEGA_G;
+
+      /*  calculate the contribution of the gradient direction  */
+      value += (direction_value[ngradient[1]][k & 3] +
+                direction_value[gradient[1]][k & 3]) * OMEGA_D;
+
+      if (cost + value < nblock->cost[nindex])
+        gimp_iscissors_search_push (search, nx, ny, cost + value, link);
+    }
+}
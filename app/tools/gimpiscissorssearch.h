@@ -0,0 +1,39 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimpiscissorssearch.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+
+typedef struct _GimpIscissorsSearch GimpIscissorsSearch;
+
+
+GimpIscissorsSearch * gimp_iscissors_search_new         (GeglBuffer          *gradient_map,
+                                                         gint                 seed_x,
+                                                         gint                 seed_y);
+void                  gimp_iscissors_search_free        (GimpIscissorsSearch *search);
+
+void                  gimp_iscissors_search_get_seed    (GimpIscissorsSearch *search,
+                                                         gint                *seed_x,
+                                                         gint                *seed_y);
+gint64                gimp_iscissors_search_get_n_settled
+                                                        (GimpIscissorsSearch *search);
+
+GPtrArray           * gimp_iscissors_search_find_path   (GimpIscissorsSearch *search,
+                                                         gint                 x,
+                                                         gint                 y);
@@ -62,7 +62,6 @@
 #include "core/gimpimage.h"
 #include "core/gimppickable.h"
 #include "core/gimpscanconvert.h"
-#include "core/gimptempbuf.h"
 #include "core/gimptoolinfo.h"
 
 #include "widgets/gimphelp-ids.h"
@@ -72,31 +71,21 @@
 #include "display/gimpdisplay.h"
 
 #include "gimpiscissorsoptions.h"
+#include "gimpiscissorssearch.h"
 #include "gimpiscissorstool.h"
 #include "gimptilehandleriscissors.h"
 #include "gimptoolcontrol.h"
 
 #include "gimp-intl.h"
+#include "gimp-log.h"
 
 
 /*  defines  */
 #define  GRADIENT_SEARCH   32  /* how far to look when snapping to an edge */
-#define  EXTEND_BY         0.2 /* proportion to expand cost map by */
-#define  FIXED             5   /* additional fixed size to expand cost map */
+#define  MAX_SEARCHES      2   /* number of livewire searches to keep       */
 
 #define  COST_WIDTH        2   /* number of bytes for each pixel in cost map  */
 
-/* weight to give between gradient (_G) and direction (_D) */
-#define  OMEGA_D           0.2
-#define  OMEGA_G           0.8
-
-/* sentinel to mark seed point in ?cost? map */
-#define  SEED_POINT        9
-
-/*  Functional defines  */
-#define  PIXEL_COST(x)     ((x) >> 8)
-#define  PIXEL_DIR(x)      ((x) & 0x000000ff)
-
 
 struct _ISegment
 {
@@ -173,14 +162,6 @@ static void          iscissors_convert         (GimpIscissorsTool *iscissors,
                                                 GimpDisplay       *display);
 static GeglBuffer  * gradient_map_new          (GimpPickable      *pickable);
 
-static void          find_optimal_path         (GeglBuffer        *gradient_map,
-                                                GimpTempBuf       *dp_buf,
-                                                gint               x1,
-                                                gint               y1,
-                                                gint               x2,
-                                                gint               y2,
-                                                gint               xs,
-                                                gint               ys);
 static void          find_max_gradient         (GimpIscissorsTool *iscissors,
                                                 GimpPickable      *pickable,
                                                 gint              *x,
@@ -203,14 +184,6 @@ static gboolean      clicked_on_segment        (GimpIscissorsTool *iscissors,
                                                 gdouble            x,
                                                 gdouble            y);
 
-static GPtrArray   * plot_pixels               (GimpTempBuf       *dp_buf,
-                                                gint               x1,
-                                                gint               y1,
-                                                gint               xs,
-                                                gint               ys,
-                                                gint               xe,
-                                                gint               ye);
-
 static ISegment    * isegment_new              (gint               x1,
                                                 gint               y1,
                                                 gint               x2,
@@ -245,34 +218,8 @@ static GimpScanConvert *
 
 /*  static variables  */
 
-/*  where to move on a given link direction  */
-static const gint move[8][2] =
-{
-  {  1,  0 },
-  {  0,  1 },
-  { -1,  1 },
-  {  1,  1 },
-  { -1,  0 },
-  {  0, -1 },
-  {  1, -1 },
-  { -1, -1 },
-};
-
-/* IE:
- * '---+---+---`
- * | 7 | 5 | 6 |
- * +---+---+---+
- * | 4 |   | 0 |
- * +---+---+---+
- * | 2 | 1 | 3 |
- * `---+---+---'
- */
-
 static gfloat  distance_weights[GRADIENT_SEARCH * GRADIENT_SEARCH];
 
-static gint    diagonal_weight[256];
-static gint    direction_value[256][4];
-
 
 G_DEFINE_TYPE (GimpIscissorsTool, gimp_iscissors_tool,
                GIMP_TYPE_SELECTION_TOOL)
@@ -323,24 +270,6 @@ gimp_iscissors_tool_class_init (GimpIscissorsToolClass *klass)
 
   draw_tool_class->draw      = gimp_iscissors_tool_draw;
 
-  for (i = 0; i < 256; i++)
-    {
-      /*  The diagonal weight array  */
-      diagonal_weight[i] = (int) (i * G_SQRT2);
-
-      /*  The direction value array  */
-      direction_value[i][0] = (127 - abs (127 - i)) * 2;
-      direction_value[i][1] = abs (127 - i) * 2;
-      direction_value[i][2] = abs (191 - i) * 2;
-      direction_value[i][3] = abs (63 - i) * 2;
-    }
-
-  /*  set the 256th index of the direction_values to the highest cost  */
-  direction_value[255][0] = 255;
-  direction_value[255][1] = 255;
-  direction_value[255][2] = 255;
-  direction_value[255][3] = 255;
-
   /*  compute the distance weights  */
   radius = GRADIENT_SEARCH >> 1;
 
@@ -700,10 +629,13 @@ gimp_iscissors_tool_motion (GimpTool         *tool,
   GimpIscissorsOptions *options   = GIMP_ISCISSORS_TOOL_GET_OPTIONS (tool);
   GimpImage            *image     = gimp_display_get_image (display);
   ISegment             *segment;
+  gint64                start_time;
 
   if (iscissors->state == NO_ACTION)
     return;
 
+  start_time = g_get_monotonic_time ();
+
   gimp_draw_tool_pause (GIMP_DRAW_TOOL (tool));
 
   iscissors->x = RINT (coords->x);
@@ -761,6 +693,10 @@ gimp_iscissors_tool_motion (GimpTool         *tool,
       break;
     }
 
+  GIMP_LOG (ISCISSORS, "motion to %d, %d: %.3f ms",
+            iscissors->x, iscissors->y,
+            (g_get_monotonic_time () - start_time) / 1000.0);
+
   gimp_draw_tool_resume (GIMP_DRAW_TOOL (tool));
 }
 
@@ -1290,6 +1226,13 @@ gimp_iscissors_tool_halt (GimpIscissorsTool *iscissors,
       iscissors->redo_stack = NULL;
     }
 
+  if (iscissors->searches)
+    {
+      g_list_free_full (iscissors->searches,
+                        (GDestroyNotify) gimp_iscissors_search_free);
+      iscissors->searches = NULL;
+    }
+
   g_clear_object (&iscissors->gradient_map);
   g_clear_object (&iscissors->mask);
 }
@@ -1508,13 +1451,14 @@ static void
 calculate_segment (GimpIscissorsTool *iscissors,
                    ISegment          *segment)
 {
-  GimpDisplay  *display  = GIMP_TOOL (iscissors)->display;
-  GimpPickable *pickable = GIMP_PICKABLE (gimp_display_get_image (display));
-  gint          width;
-  gint          height;
-  gint          xs, ys, xe, ye;
-  gint          x1, y1, x2, y2;
-  gint          ewidth, eheight;
+  GimpDisplay         *display  = GIMP_TOOL (iscissors)->display;
+  GimpPickable        *pickable = GIMP_PICKABLE (gimp_display_get_image (display));
+  GimpIscissorsSearch *search   = NULL;
+  GList               *list;
+  gint                 width;
+  gint                 height;
+  gint                 xs, ys, xe, ye;
+  gboolean             reverse  = FALSE;
 
   /* Initialise the gradient map buffer for this pickable if we don't
    * already have one.
@@ -1525,373 +1469,98 @@ calculate_segment (GimpIscissorsTool *iscissors,
   width  = gegl_buffer_get_width  (iscissors->gradient_map);
   height = gegl_buffer_get_height (iscissors->gradient_map);
 
-  /*  Calculate the lowest cost path from one vertex to the next as specified
-   *  by the parameter "segment".
-   *    Here are the steps:
-   *      1)  Calculate the appropriate working area for this operation
-   *      2)  Allocate a temp buf for the dynamic programming array
-   *      3)  Run the dynamic programming algorithm to find the optimal path
-   *      4)  Translate the optimal path into pixels in the isegment data
-   *            structure.
-   */
-
-  /*  Get the bounding box  */
   xs = CLAMP (segment->x1, 0, width  - 1);
   ys = CLAMP (segment->y1, 0, height - 1);
   xe = CLAMP (segment->x2, 0, width  - 1);
   ye = CLAMP (segment->y2, 0, height - 1);
-  x1 = MIN (xs, xe);
-  y1 = MIN (ys, ye);
-  x2 = MAX (xs, xe) + 1;  /*  +1 because if xe = 199 & xs = 0, x2 - x1, width = 200  */
-  y2 = MAX (ys, ye) + 1;
-
-  /*  expand the boundaries past the ending points by
-   *  some percentage of width and height.  This serves the following purpose:
-   *  It gives the algorithm more area to search so better solutions
-   *  are found.  This is particularly helpful in finding "bumps" which
-   *  fall outside the bounding box represented by the start and end
-   *  coordinates of the "segment".
-   */
-  ewidth  = (x2 - x1) * EXTEND_BY + FIXED;
-  eheight = (y2 - y1) * EXTEND_BY + FIXED;
-
-  if (xe >= xs)
-    x2 += CLAMP (ewidth, 0, width - x2);
-  else
-    x1 -= CLAMP (ewidth, 0, x1);
 
-  if (ye >= ys)
-    y2 += CLAMP (eheight, 0, height - y2);
-  else
-    y1 -= CLAMP (eheight, 0, y1);
-
-  /* blow away any previous points list we might have */
-  if (segment->points)
-    {
-      g_ptr_array_free (segment->points, TRUE);
-      segment->points = NULL;
-    }
-
-  if ((x2 - x1) && (y2 - y1))
-    {
-      /*  If the bounding box has width and height...  */
-
-      GimpTempBuf *dp_buf; /*  dynamic programming buffer  */
-      gint         dp_width  = (x2 - x1);
-      gint         dp_height = (y2 - y1);
-
-      dp_buf = gimp_temp_buf_new (dp_width, dp_height,
-                                  babl_format ("Y u32"));
-
-      /*  find the optimal path of pixels from (x1, y1) to (x2, y2)  */
-      find_optimal_path (iscissors->gradient_map, dp_buf,
-                         x1, y1, x2, y2, xs, ys);
-
-      /*  get a list of the pixels in the optimal path  */
-      segment->points = plot_pixels (dp_buf, x1, y1, xs, ys, xe, ye);
-
-      gimp_temp_buf_unref (dp_buf);
-    }
-  else if ((x2 - x1) == 0)
+  /*  The lowest cost path is searched for from one end of the segment,
+   *  the seed point, and the search is kept, so that it can be reused
+   *  while the other end is being moved.  When the start point of the
+   *  segment is the one being dragged, search from its end point, and
+   *  reverse the path.
+   */
+  for (list = iscissors->searches; list; list = g_list_next (list))
     {
-      /*  If the bounding box has no width  */
+      gint seed_x, seed_y;
 
-      /*  plot a vertical line  */
-      gint y   = ys;
-      gint dir = (ys > ye) ? -1 : 1;
+      gimp_iscissors_search_get_seed (list->data, &seed_x, &seed_y);
 
-      segment->points = g_ptr_array_new ();
-      while (y != ye)
+      if (seed_x == xs && seed_y == ys)
         {
-          g_ptr_array_add (segment->points, GINT_TO_POINTER ((y << 16) + xs));
-          y += dir;
+          reverse = FALSE;
+          break;
         }
-    }
-  else if ((y2 - y1) == 0)
-    {
-      /*  If the bounding box has no height  */
-
-      /*  plot a horizontal line  */
-      gint x   = xs;
-      gint dir = (xs > xe) ? -1 : 1;
-
-      segment->points = g_ptr_array_new ();
-      while (x != xe)
+      else if (seed_x == xe && seed_y == ye)
         {
-          g_ptr_array_add (segment->points, GINT_TO_POINTER ((ys << 16) + x));
-          x += dir;
+          reverse = TRUE;
+          break;
         }
     }
-}
 
-
-/* badly need to get a replacement - this is _way_ too expensive */
-static gboolean
-gradient_map_value (GeglSampler         *map_sampler,
-                    const GeglRectangle *map_extent,
-                    gint                 x,
-                    gint                 y,
-                    guint8              *grad,
-                    guint8              *dir)
-{
-  if (x >= map_extent->x     &&
-      y >= map_extent->y     &&
-      x <  map_extent->width &&
-      y <  map_extent->height)
+  if (list)
     {
-      guint8 sample[2];
-
-      gegl_sampler_get (map_sampler, x, y, NULL, sample, GEGL_ABYSS_NONE);
+      search = list->data;
 
-      *grad = sample[0];
-      *dir  = sample[1];
-
-      return TRUE;
+      iscissors->searches = g_list_remove_link (iscissors->searches, list);
+      g_list_free (list);
     }
-
-  return FALSE;
-}
-
-static gint
-calculate_link (GeglSampler         *map_sampler,
-                const GeglRectangle *map_extent,
-                gint                 x,
-                gint                 y,
-                guint32              pixel,
-                gint                 link)
-{
-  gint   value = 0;
-  guint8 grad1, dir1, grad2, dir2;
-
-  if (! gradient_map_value (map_sampler, map_extent, x, y, &grad1, &dir1))
-    {
-      grad1 = 0;
-      dir1 = 255;
-    }
-
-  /* Convert the gradient into a cost: large gradients are good, and
-   * so have low cost. */
-  grad1 = 255 - grad1;
-
-  /*  calculate the contribution of the gradient magnitude  */
-  if (link > 1)
-    value += diagonal_weight[grad1] * OMEGA_G;
   else
-    value += grad1 * OMEGA_G;
-
-  /*  calculate the contribution of the gradient direction  */
-  x += (gint8)(pixel & 0xff);
-  y += (gint8)((pixel & 0xff00) >> 8);
-
-  if (! gradient_map_value (map_sampler, map_extent, x, y, &grad2, &dir2))
     {
-      grad2 = 0;
-      dir2 = 255;
-    }
-
-  value +=
-    (direction_value[dir1][link] + direction_value[dir2][link]) * OMEGA_D;
-
-  return value;
-}
+      reverse = (iscissors->state == SEED_ADJUSTMENT &&
+                 segment == iscissors->segment1);
 
+      if (reverse)
+        search = gimp_iscissors_search_new (iscissors->gradient_map, xe, ye);
+      else
+        search = gimp_iscissors_search_new (iscissors->gradient_map, xs, ys);
 
-static GPtrArray *
-plot_pixels (GimpTempBuf *dp_buf,
-             gint         x1,
-             gint         y1,
-             gint         xs,
-             gint         ys,
-             gint         xe,
-             gint         ye)
-{
-  gint       x, y;
-  guint32    coords;
-  gint       link;
-  gint       width = gimp_temp_buf_get_width (dp_buf);
-  guint     *data;
-  GPtrArray *list;
-
-  /*  Start the data pointer at the correct location  */
-  data = (guint *) gimp_temp_buf_get_data (dp_buf) + (ye - y1) * width + (xe - x1);
+      if (g_list_length (iscissors->searches) == MAX_SEARCHES)
+        {
+          list = g_list_last (iscissors->searches);
 
-  x = xe;
-  y = ye;
+          gimp_iscissors_search_free (list->data);
+          iscissors->searches = g_list_delete_link (iscissors->searches,
+                                                    list);
+        }
+    }
 
-  list = g_ptr_array_new ();
+  iscissors->searches = g_list_prepend (iscissors->searches, search);
 
-  while (TRUE)
+  /* blow away any previous points list we might have */
+  if (segment->points)
     {
-      coords = (y << 16) + x;
-      g_ptr_array_add (list, GINT_TO_POINTER (coords));
-
-      link = PIXEL_DIR (*data);
-      if (link == SEED_POINT)
-        return list;
-
-      x += move[link][0];
-      y += move[link][1];
-      data += move[link][1] * width + move[link][0];
+      g_ptr_array_free (segment->points, TRUE);
+      segment->points = NULL;
     }
 
-  /*  won't get here  */
-  return NULL;
-}
-
-
-#define PACK(x, y)    ((((y) & 0xff) << 8) | ((x) & 0xff))
-#define OFFSET(pixel) ((gint8)((pixel) & 0xff) + \
-                       ((gint8)(((pixel) & 0xff00) >> 8)) * \
-                       gimp_temp_buf_get_width (dp_buf))
-
-static void
-find_optimal_path (GeglBuffer  *gradient_map,
-                   GimpTempBuf *dp_buf,
-                   gint         x1,
-                   gint         y1,
-                   gint         x2,
-                   gint         y2,
-                   gint         xs,
-                   gint         ys)
-{
-  GeglSampler         *map_sampler;
-  const GeglRectangle *map_extent;
-  gint                 i, j, k;
-  gint                 x, y;
-  gint                 link;
-  gint                 linkdir;
-  gint                 dirx, diry;
-  gint                 min_cost;
-  gint                 new_cost;
-  gint                 offset;
-  gint                 cum_cost[8];
-  gint                 link_cost[8];
-  gint                 pixel_cost[8];
-  guint32              pixel[8];
-  guint32             *data;
-  guint32             *d;
-  gint                 dp_buf_width  = gimp_temp_buf_get_width  (dp_buf);
-  gint                 dp_buf_height = gimp_temp_buf_get_height (dp_buf);
-
-  /*  initialize the gradient map sampler and extent  */
-  map_sampler = gegl_buffer_sampler_new (gradient_map,
-                                         gegl_buffer_get_format (gradient_map),
-                                         GEGL_SAMPLER_NEAREST);
-  map_extent  = gegl_buffer_get_extent (gradient_map);
-
-  /*  initialize the dynamic programming buffer  */
-  data = (guint32 *) gimp_temp_buf_data_clear (dp_buf);
-
-  /*  what directions are we filling the array in according to?  */
-  dirx = (xs - x1 == 0) ? 1 : -1;
-  diry = (ys - y1 == 0) ? 1 : -1;
-  linkdir = (dirx * diry);
-
-  y = ys;
-
-  for (i = 0; i < dp_buf_height; i++)
+  /*  get a list of the pixels in the optimal path, from the end
+   *  point to the start point
+   */
+  if (reverse)
     {
-      x = xs;
-
-      d = data + (y-y1) * dp_buf_width + (x-x1);
-
-      for (j = 0; j < dp_buf_width; j++)
-        {
-          min_cost = G_MAXINT;
-
-          /* pixel[] array encodes how to get to a neighbour, if possible.
-           * 0 means no connection (eg edge).
-           * Rest packed as bottom two bytes: y offset then x offset.
-           * Initially, we assume we can't get anywhere.
-           */
-          for (k = 0; k < 8; k++)
-            pixel[k] = 0;
-
-          /*  Find the valid neighboring pixels  */
-          /*  the previous pixel  */
-          if (j)
-            pixel[((dirx == 1) ? 4 : 0)] = PACK (-dirx, 0);
-
-          /*  the previous row of pixels  */
-          if (i)
-            {
-              pixel[((diry == 1) ? 5 : 1)] = PACK (0, -diry);
+      GPtrArray *points = gimp_iscissors_search_find_path (search, xs, ys);
+      gint       i;
 
-              link = (linkdir == 1) ? 3 : 2;
-              if (j)
-                pixel[((diry == 1) ? (link + 4) : link)] = PACK (-dirx, -diry);
+      segment->points = g_ptr_array_sized_new (points->len);
 
-              link = (linkdir == 1) ? 2 : 3;
-              if (j != dp_buf_width - 1)
-                pixel[((diry == 1) ? (link + 4) : link)] = PACK (dirx, -diry);
-            }
-
-          /*  find the minimum cost of going through each neighbor to reach the
-           *  seed point...
-           */
-          link = -1;
-          for (k = 0; k < 8; k ++)
-            if (pixel[k])
-              {
-                link_cost[k] = calculate_link (map_sampler, map_extent,
-                                               xs + j*dirx, ys + i*diry,
-                                               pixel [k],
-                                               ((k > 3) ? k - 4 : k));
-                offset = OFFSET (pixel [k]);
-                pixel_cost[k] = PIXEL_COST (d[offset]);
-                cum_cost[k] = pixel_cost[k] + link_cost[k];
-                if (cum_cost[k] < min_cost)
-                  {
-                    min_cost = cum_cost[k];
-                    link = k;
-                  }
-              }
-
-          /*  If anything can be done...  */
-          if (link >= 0)
-            {
-              /*  set the cumulative cost of this pixel and the new direction
-               */
-              *d = (cum_cost[link] << 8) + link;
-
-              /*  possibly change the links from the other pixels to this pixel...
-               *  these changes occur if a neighboring pixel will receive a lower
-               *  cumulative cost by going through this pixel.
-               */
-              for (k = 0; k < 8; k ++)
-                if (pixel[k] && k != link)
-                  {
-                    /*  if the cumulative cost at the neighbor is greater than
-                     *  the cost through the link to the current pixel, change the
-                     *  neighbor's link to point to the current pixel.
-                     */
-                    new_cost = link_cost[k] + cum_cost[link];
-                    if (pixel_cost[k] > new_cost)
-                    {
-                      /*  reverse the link direction   /--------------------\ */
-                      offset = OFFSET (pixel[k]);
-                      d[offset] = (new_cost << 8) + ((k > 3) ? k - 4 : k + 4);
-                    }
-                  }
-            }
-          /*  Set the seed point  */
-          else if (!i && !j)
-            {
-              *d = SEED_POINT;
-            }
-
-          /*  increment the data pointer and the x counter  */
-          d += dirx;
-          x += dirx;
-        }
+      for (i = points->len - 1; i >= 0; i--)
+        g_ptr_array_add (segment->points, g_ptr_array_index (points, i));
 
-      /*  increment the y counter  */
-      y += diry;
+      g_ptr_array_free (points, TRUE);
+    }
+  else
+    {
+      segment->points = gimp_iscissors_search_find_path (search, xe, ye);
     }
 
-  g_object_unref (map_sampler);
+  GIMP_LOG (ISCISSORS, "segment of %u points, %" G_GINT64_FORMAT
+            " pixels searched",
+            segment->points->len,
+            gimp_iscissors_search_get_n_settled (search));
 }
 
+
 static GeglBuffer *
 gradient_map_new (GimpPickable *pickable)
 {
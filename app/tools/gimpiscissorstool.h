@@ -77,6 +77,7 @@ struct _GimpIscissorsTool
   IscissorsState  state;        /*  state of iscissors                      */
 
   GeglBuffer     *gradient_map; /*  lazily filled gradient map              */
+  GList          *searches;     /*  livewire searches, most recent first    */
   GimpChannel    *mask;         /*  selection mask                          */
 };
 
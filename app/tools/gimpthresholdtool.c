@@ -184,7 +184,7 @@ gimp_threshold_tool_initialize (GimpTool     *tool,
     temp = gegl_buffer_new (GEGL_RECTANGLE (0, 0, 1, 1),
                             gimp_drawable_get_format (drawable));
 
-    gimp_histogram_calculate (t_tool->histogram,
+    gimp_histogram_calculate (t_tool->histogram, NULL,
                               temp, GEGL_RECTANGLE (0, 0, 1, 1),
                               NULL, NULL);
 
@@ -169,6 +169,92 @@ static const gfloat blur_32[9] =
 #define  MIN_GRADIENT  63      /* gradients < this are directionless */
 #define  COST_WIDTH     2      /* number of bytes for each pixel in cost map */
 
+#define PIXELS_PER_THREAD \
+  (/* each thread costs as much as */ 64.0 * 64.0 /* pixels */)
+
+
+typedef struct
+{
+  const GeglRectangle *rect;
+  const guint8        *maxgrad_conv1;
+  gint                 stride1;
+  const guint8        *maxgrad_conv2;
+  gint                 stride2;
+  gpointer             dest_buf;
+  gint                 dest_stride;
+} GradientData;
+
+
+static void
+gimp_tile_handler_iscissors_gradient (gsize         offset,
+                                      gsize         size,
+                                      GradientData *data)
+{
+  const GeglRectangle *rect = data->rect;
+  gint                 i, j;
+
+  for (i = offset; i < (gint) (offset + size); i++)
+    {
+      const guint8 *datah   = data->maxgrad_conv1 + data->stride1 * i;
+      const guint8 *datav   = data->maxgrad_conv2 + data->stride2 * i;
+      guint8       *gradmap = (guint8 *) data->dest_buf + data->dest_stride * i;
+
+      for (j = 0; j < rect->width; j++)
+        {
+          gint8  hmax = datah[0] - 128;
+          gint8  vmax = datav[0] - 128;
+          gfloat gradient;
+          gint   b;
+
+          for (b = 1; b < 4; b++)
+            {
+              if (abs (datah[b] - 128) > abs (hmax))
+                hmax = datah[b] - 128;
+
+              if (abs (datav[b] - 128) > abs (vmax))
+                vmax = datav[b] - 128;
+            }
+
+          if (i == 0 || j == 0 || i == rect->height - 1 || j == rect->width - 1)
+            {
+              gradmap[j * COST_WIDTH + 0] = 0;
+              gradmap[j * COST_WIDTH + 1] = 255;
+              goto contin;
+            }
+
+          /* 1 byte absolute magnitude first */
+          gradient = sqrt (SQR (hmax) + SQR (vmax));
+          gradmap[j * COST_WIDTH] = gradient * 255 / MAX_GRADIENT;
+
+          /* then 1 byte direction */
+          if (gradient > MIN_GRADIENT)
+            {
+              gfloat direction;
+
+              if (! hmax)
+                direction = (vmax > 0) ? G_PI_2 : -G_PI_2;
+              else
+                direction = atan ((gdouble) vmax / (gdouble) hmax);
+
+              /* Scale the direction from between 0 and 254,
+               *  corresponding to -PI/2, PI/2 255 is reserved for
+               *  directionless pixels
+               */
+              gradmap[j * COST_WIDTH + 1] =
+                (guint8) (254 * (direction + G_PI_2) / G_PI);
+            }
+          else
+            {
+              gradmap[j * COST_WIDTH + 1] = 255; /* reserved for weak gradient */
+            }
+
+        contin:
+          datah += 4;
+          datav += 4;
+        }
+    }
+}
+
 static void
 gimp_tile_handler_iscissors_validate (GimpTileHandlerValidate *validate,
                                       const GeglRectangle     *rect,
@@ -183,7 +269,7 @@ gimp_tile_handler_iscissors_validate (GimpTileHandlerValidate *validate,
   GeglBuffer               *temp2;
   gint                      stride1;
   gint                      stride2;
-  gint                      i, j;
+  GradientData              data;
 
   /*  temporary convolution buffers --  */
   guchar *maxgrad_conv1;
@@ -251,66 +337,18 @@ gimp_tile_handler_iscissors_validate (GimpTileHandlerValidate *validate,
 
   /* calculate overall gradient */
 
-  for (i = 0; i < rect->height; i++)
-    {
-      const guint8 *datah   = maxgrad_conv1 + stride1 * i;
-      const guint8 *datav   = maxgrad_conv2 + stride2 * i;
-      guint8       *gradmap = (guint8 *) dest_buf + dest_stride * i;
-
-      for (j = 0; j < rect->width; j++)
-        {
-          gint8  hmax = datah[0] - 128;
-          gint8  vmax = datav[0] - 128;
-          gfloat gradient;
-          gint   b;
-
-          for (b = 1; b < 4; b++)
-            {
-              if (abs (datah[b] - 128) > abs (hmax))
-                hmax = datah[b] - 128;
-
-              if (abs (datav[b] - 128) > abs (vmax))
-                vmax = datav[b] - 128;
-            }
-
-          if (i == 0 || j == 0 || i == rect->height - 1 || j == rect->width - 1)
-            {
-              gradmap[j * COST_WIDTH + 0] = 0;
-              gradmap[j * COST_WIDTH + 1] = 255;
-              goto contin;
-            }
-
-          /* 1 byte absolute magnitude first */
-          gradient = sqrt (SQR (hmax) + SQR (vmax));
-          gradmap[j * COST_WIDTH] = gradient * 255 / MAX_GRADIENT;
-
-          /* then 1 byte direction */
-          if (gradient > MIN_GRADIENT)
-            {
-              gfloat direction;
-
-              if (! hmax)
-                direction = (vmax > 0) ? G_PI_2 : -G_PI_2;
-              else
-                direction = atan ((gdouble) vmax / (gdouble) hmax);
-
-              /* Scale the direction from between 0 and 254,
-               *  corresponding to -PI/2, PI/2 255 is reserved for
-               *  directionless pixels
-               */
-              gradmap[j * COST_WIDTH + 1] =
-                (guint8) (254 * (direction + G_PI_2) / G_PI);
-            }
-          else
-            {
-              gradmap[j * COST_WIDTH + 1] = 255; /* reserved for weak gradient */
-            }
-
-        contin:
-          datah += 4;
-          datav += 4;
-        }
-    }
+  data.rect          = rect;
+  data.maxgrad_conv1 = maxgrad_conv1;
+  data.stride1       = stride1;
+  data.maxgrad_conv2 = maxgrad_conv2;
+  data.stride2       = stride2;
+  data.dest_buf      = dest_buf;
+  data.dest_stride   = dest_stride;
+
+  gegl_parallel_distribute_range (
+    rect->height, PIXELS_PER_THREAD / rect->width,
+    (GeglParallelDistributeRangeFunc) gimp_tile_handler_iscissors_gradient,
+    &data);
 
   gegl_buffer_linear_close (temp1, maxgrad_conv1);
   gegl_buffer_linear_close (temp2, maxgrad_conv2);
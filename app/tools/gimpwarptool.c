@@ -51,17 +51,20 @@
 #include "widgets/gimpwidgets-utils.h"
 
 #include "display/gimpdisplay.h"
+#include "display/gimpdisplayshell.h"
 
 #include "gimpwarptool.h"
 #include "gimpwarpoptions.h"
 #include "gimptoolcontrol.h"
 #include "gimptools-utils.h"
 
+#include "gimp-log.h"
 #include "gimp-intl.h"
 
 
 #define STROKE_TIMER_MAX_FPS 20
 #define PREVIEW_SAMPLER      GEGL_SAMPLER_NEAREST
+#define PREVIEW_MAX_LEVEL    4
 
 
 static void            gimp_warp_tool_constructed               (GObject               *object);
@@ -150,6 +153,17 @@ static void            gimp_warp_tool_stroke_append             (GimpWarpTool
                                                                  gchar                  type,
                                                                  gdouble                x,
                                                                  gdouble                y);
+static void            gimp_warp_tool_flush_pending             (GimpWarpTool          *wt);
+static void            gimp_warp_tool_clear_pending             (GimpWarpTool          *wt);
+static gboolean        gimp_warp_tool_pending_idle              (GimpWarpTool          *wt);
+static gint            gimp_warp_tool_get_preview_level         (GimpWarpTool          *wt);
+static void            gimp_warp_tool_projection_update         (GimpProjection        *projection,
+                                                                 gboolean               now,
+                                                                 gint                   x,
+                                                                 gint                   y,
+                                                                 gint                   width,
+                                                                 gint                   height,
+                                                                 GimpWarpTool          *wt);
 static void            gimp_warp_tool_filter_flush              (GimpDrawableFilter    *filter,
                                                                  GimpTool              *tool);
 static void            gimp_warp_tool_add_op                    (GimpWarpTool          *wt,
@@ -369,6 +383,11 @@ gimp_warp_tool_button_release (GimpTool              *tool,
 
   gimp_warp_tool_stop_stroke_timer (wt);
 
+  if (release_type == GIMP_BUTTON_RELEASE_CANCEL)
+    gimp_warp_tool_clear_pending (wt);
+  else
+    gimp_warp_tool_flush_pending (wt);
+
 #ifdef WARP_DEBUG
   g_printerr ("%s\n", gegl_path_to_string (wt->current_stroke));
 #endif
@@ -914,6 +933,10 @@ gimp_warp_tool_start (GimpWarpTool *wt,
 
   gimp_warp_tool_create_filter (wt, drawable);
 
+  g_signal_connect (gimp_image_get_projection (image), "update",
+                    G_CALLBACK (gimp_warp_tool_projection_update),
+                    wt);
+
   if (! gimp_draw_tool_is_active (GIMP_DRAW_TOOL (wt)))
     gimp_draw_tool_start (GIMP_DRAW_TOOL (wt), display);
 
@@ -935,6 +958,19 @@ gimp_warp_tool_halt (GimpWarpTool *wt)
   GimpTool        *tool    = GIMP_TOOL (wt);
   GimpWarpOptions *options = GIMP_WARP_TOOL_GET_OPTIONS (wt);
 
+  gimp_warp_tool_clear_pending (wt);
+
+  wt->latency_time = 0;
+
+  if (tool->display)
+    {
+      GimpImage *image = gimp_display_get_image (tool->display);
+
+      g_signal_handlers_disconnect_by_func (gimp_image_get_projection (image),
+                                            gimp_warp_tool_projection_update,
+                                            wt);
+    }
+
   g_clear_object (&wt->coords_buffer);
 
   g_clear_object (&wt->graph);
@@ -1249,12 +1285,17 @@ gimp_warp_tool_update_area (GimpWarpTool        *wt,
                             const GeglRectangle *area,
                             gboolean             synchronous)
 {
+  GimpTool      *tool = GIMP_TOOL (wt);
+  GimpImage     *image;
   GeglRectangle  rect;
   GimpContainer *filters;
+  gint           level;
 
   if (! wt->filter)
     return;
 
+  image = gimp_display_get_image (tool->display);
+
   rect = gimp_warp_tool_get_invalidated_by_change (wt, area);
 
   /* Move this operation below any non-destructive filters that
@@ -1273,28 +1314,28 @@ gimp_warp_tool_update_area (GimpWarpTool        *wt,
                               end_index);
   }
 
-  if (synchronous)
-    {
-      GimpTool  *tool  = GIMP_TOOL (wt);
-      GimpImage *image = gimp_display_get_image (tool->display);
+  g_signal_handlers_block_by_func (wt->filter,
+                                   gimp_warp_tool_filter_flush,
+                                   wt);
 
-      g_signal_handlers_block_by_func (wt->filter,
-                                       gimp_warp_tool_filter_flush,
-                                       wt);
+  gimp_drawable_filter_apply (wt->filter, &rect);
 
-      gimp_drawable_filter_apply (wt->filter, &rect);
+  level = gimp_warp_tool_get_preview_level (wt);
 
-      gimp_projection_flush_now (gimp_image_get_projection (image), TRUE);
-      gimp_display_flush_now (tool->display);
+  /*  show the visible part of the change right away when previewing in
+   *  real time, or when the display is zoomed out enough for a coarse
+   *  level to be cheap, the rest is rendered, and refined, in the
+   *  background.  otherwise, leave it all to the chunked renderer.
+   */
+  if (synchronous || level > 0)
+    gimp_projection_flush_preview (gimp_image_get_projection (image), level);
 
-      g_signal_handlers_unblock_by_func (wt->filter,
-                                         gimp_warp_tool_filter_flush,
-                                         wt);
-    }
-  else
-    {
-      gimp_drawable_filter_apply (wt->filter, &rect);
-    }
+  if (synchronous)
+    gimp_display_flush_now (tool->display);
+
+  g_signal_handlers_unblock_by_func (wt->filter,
+                                     gimp_warp_tool_filter_flush,
+                                     wt);
 }
 
 static void
@@ -1355,6 +1396,49 @@ gimp_warp_tool_stroke_append (GimpWarpTool *wt,
               area.width, area.height);
 #endif
 
+  /*  the points of all the events handled before the next idle are
+   *  applied in one go, see gimp_warp_tool_flush_pending()
+   */
+  if (gegl_rectangle_is_empty (&wt->pending_area))
+    {
+      wt->pending_area = area;
+      wt->pending_time = g_get_monotonic_time ();
+    }
+  else
+    {
+      gegl_rectangle_bounding_box (&wt->pending_area,
+                                   &wt->pending_area, &area);
+    }
+
+  if (! wt->pending_idle_id)
+    {
+      wt->pending_idle_id =
+        g_idle_add_full (G_PRIORITY_HIGH_IDLE,
+                         (GSourceFunc) gimp_warp_tool_pending_idle,
+                         wt, NULL);
+    }
+}
+
+static void
+gimp_warp_tool_flush_pending (GimpWarpTool *wt)
+{
+  GimpWarpOptions *options = GIMP_WARP_TOOL_GET_OPTIONS (wt);
+  GimpTool        *tool    = GIMP_TOOL (wt);
+  GeglRectangle    area;
+
+  if (wt->pending_idle_id)
+    {
+      g_source_remove (wt->pending_idle_id);
+      wt->pending_idle_id = 0;
+    }
+
+  if (gegl_rectangle_is_empty (&wt->pending_area) || ! wt->filter)
+    return;
+
+  area = wt->pending_area;
+
+  wt->pending_area = *GEGL_RECTANGLE (0, 0, 0, 0);
+
   if (wt->render_node)
     {
       GeglNode *node = gegl_node_get_producer (wt->render_node, "aux", NULL);
@@ -1364,9 +1448,99 @@ gimp_warp_tool_stroke_append (GimpWarpTool *wt,
       gimp_warp_tool_update_bounds (wt);
     }
 
+  /*  measure the latency from the oldest stroke point the display
+   *  hasn't caught up with yet
+   */
+  if (gimp_log_flags & GIMP_LOG_WARP)
+    {
+      GeglRectangle rect;
+      gint          off_x, off_y;
+
+      gimp_item_get_offset (GIMP_ITEM (tool->drawables->data), &off_x, &off_y);
+
+      rect    = gimp_warp_tool_get_invalidated_by_change (wt, &area);
+      rect.x += off_x;
+      rect.y += off_y;
+
+      if (! wt->latency_time)
+        {
+          wt->latency_area = rect;
+          wt->latency_time = wt->pending_time;
+        }
+      else
+        {
+          gegl_rectangle_bounding_box (&wt->latency_area,
+                                       &wt->latency_area, &rect);
+        }
+    }
+
   gimp_warp_tool_update_area (wt, &area, options->real_time_preview);
 }
 
+static void
+gimp_warp_tool_clear_pending (GimpWarpTool *wt)
+{
+  if (wt->pending_idle_id)
+    {
+      g_source_remove (wt->pending_idle_id);
+      wt->pending_idle_id = 0;
+    }
+
+  wt->pending_area = *GEGL_RECTANGLE (0, 0, 0, 0);
+}
+
+static gboolean
+gimp_warp_tool_pending_idle (GimpWarpTool *wt)
+{
+  wt->pending_idle_id = 0;
+
+  gimp_warp_tool_flush_pending (wt);
+
+  return G_SOURCE_REMOVE;
+}
+
+static gint
+gimp_warp_tool_get_preview_level (GimpWarpTool *wt)
+{
+  GimpDisplayShell *shell = gimp_display_get_shell (GIMP_TOOL (wt)->display);
+  gdouble           scale;
+  gint              level = 0;
+
+  scale = MAX (shell->scale_x, shell->scale_y) * shell->render_scale;
+
+  /*  the coarsest pyramid level that is still at least as fine as
+   *  what the display shows
+   */
+  while (scale <= 0.5 && level < PREVIEW_MAX_LEVEL)
+    {
+      scale *= 2.0;
+      level++;
+    }
+
+  return level;
+}
+
+static void
+gimp_warp_tool_projection_update (GimpProjection *projection,
+                                  gboolean        now,
+                                  gint            x,
+                                  gint            y,
+                                  gint            width,
+                                  gint            height,
+                                  GimpWarpTool   *wt)
+{
+  if (wt->latency_time && now &&
+      gegl_rectangle_intersect (NULL,
+                                &wt->latency_area,
+                                GEGL_RECTANGLE (x, y, width, height)))
+    {
+      GIMP_LOG (WARP, "stroke to display latency: %.3f ms",
+                (g_get_monotonic_time () - wt->latency_time) / 1000.0);
+
+      wt->latency_time = 0;
+    }
+}
+
 static void
 gimp_warp_tool_filter_flush (GimpDrawableFilter *filter,
                              GimpTool           *tool)
@@ -53,6 +53,13 @@ struct _GimpWarpTool
   GeglPath           *current_stroke;
   guint               stroke_timer;
 
+  GeglRectangle       pending_area;  /* Area of stroke points not applied yet */
+  gint64              pending_time;  /* When the first of them was added */
+  guint               pending_idle_id;
+
+  GeglRectangle       latency_area;  /* Image area waiting for a display update */
+  gint64              latency_time;
+
   GimpVector2         last_pos;
   gdouble             total_dist;
 
@@ -53,6 +53,7 @@
 #endif /* ! G_OS_WIN32 */
 
 #include "libgimpbase/gimpbase.h"
+#include "libgimpcolor/gimpcolor-private.h"
 #include "libgimpmath/gimpmath.h"
 #include "libgimpwidgets/gimpwidgets.h"
 
@@ -64,9 +65,13 @@
 #include "core/gimp-parallel.h"
 #include "core/gimpasync.h"
 #include "core/gimpbacktrace.h"
+#include "core/gimpbrushcache.h"
+#include "core/gimpgrouplayer.h"
 #include "core/gimptempbuf.h"
 #include "core/gimpwaitable.h"
 
+#include "paint/gimpbrushcore.h"
+
 #include "gimpactiongroup.h"
 #include "gimpdocked.h"
 #include "gimpdashboard.h"
@@ -152,9 +157,24 @@ typedef enum
   VARIABLE_ASSIGNED_THREADS,
   VARIABLE_ACTIVE_THREADS,
   VARIABLE_ASYNC_RUNNING,
+  VARIABLE_ASYNC_QUEUED,
+  VARIABLE_ASYNC_WAIT_TIME,
+  VARIABLE_ASYNC_LANE_QUEUED,
+  VARIABLE_ASYNC_LANE_QUEUED_LAST    = VARIABLE_ASYNC_LANE_QUEUED +
+                                       GIMP_PARALLEL_RUN_ASYNC_MAX_THREADS - 1,
+  VARIABLE_ASYNC_LANE_WAIT_TIME,
+  VARIABLE_ASYNC_LANE_WAIT_TIME_LAST = VARIABLE_ASYNC_LANE_WAIT_TIME +
+                                       GIMP_PARALLEL_RUN_ASYNC_MAX_THREADS - 1,
   VARIABLE_TILE_ALLOC_TOTAL,
   VARIABLE_SCRATCH_TOTAL,
   VARIABLE_TEMP_BUF_TOTAL,
+  VARIABLE_BRUSH_CACHE_TOTAL,
+  VARIABLE_BRUSH_CACHE_HIT_RATIO,
+  VARIABLE_COLOR_TRANSFORM_CACHE_TOTAL,
+  VARIABLE_COLOR_TRANSFORM_CACHE_HIT_RATIO,
+  VARIABLE_GROUP_CACHE_TOTAL,
+  VARIABLE_GROUP_CACHE_PINNED,
+  VARIABLE_DAB_TIME,
 
 
   N_VARIABLES,
@@ -390,6 +410,11 @@ static void       gimp_dashboard_sample_memory_size             (GimpDashboard
                                                                  Variable             variable);
 #endif /* HAVE_MEMORY_GROUP */
 
+static void       gimp_dashboard_sample_async_lane_queued       (GimpDashboard       *dashboard,
+                                                                 Variable             variable);
+static void       gimp_dashboard_sample_async_lane_wait_time    (GimpDashboard       *dashboard,
+                                                                 Variable             variable);
+
 static void       gimp_dashboard_sample_object                  (GimpDashboard       *dashboard,
                                                                  GObject             *object,
                                                                  Variable             variable);
@@ -464,6 +489,11 @@ static void       gimp_dashboard_label_set_text                 (GtkLabel
 
 /*  static variables  */
 
+/*  the variables and fields of the async lanes are expanded once per
+ *  lane
+ */
+G_STATIC_ASSERT (GIMP_PARALLEL_RUN_ASYNC_MAX_THREADS == 16);
+
 static const VariableInfo variables[] =
 {
   /* cache variables */
@@ -735,6 +765,68 @@ static const VariableInfo variables[] =
     .data             = gimp_async_get_n_running
   },
 
+  [VARIABLE_ASYNC_QUEUED] =
+  { .name             = "async-queued",
+    .title            = NC_("dashboard-variable", "Queued"),
+    .description      = N_("Number of asynchronous operations waiting for a "
+                           "background thread"),
+    .type             = VARIABLE_TYPE_INTEGER,
+    .sample_func      = gimp_dashboard_sample_function,
+    .data             = gimp_parallel_run_async_get_n_queued
+  },
+
+  [VARIABLE_ASYNC_WAIT_TIME] =
+  { .name             = "async-wait-time",
+    .title            = NC_("dashboard-variable", "Wait"),
+    .description      = N_("Average time asynchronous operations wait for a "
+                           "background thread, in the busiest lane"),
+    .type             = VARIABLE_TYPE_DURATION,
+    .sample_func      = gimp_dashboard_sample_function,
+    .data             = gimp_parallel_run_async_get_wait_time
+  },
+
+  /*  one pair of variables per async lane, expanded
+   *  GIMP_PARALLEL_RUN_ASYNC_MAX_THREADS times below.  the strings are
+   *  built by the preprocessor, so they can't be marked for translation.
+   */
+  #define ASYNC_LANE_VARIABLES(lane)                                         \
+    [VARIABLE_ASYNC_LANE_QUEUED + (lane) - 1] =                              \
+    { .name             = "async-lane-" #lane "-queued",                     \
+      .title            = "Queued " #lane,                                   \
+      .description      = "Number of asynchronous operations waiting "       \
+                          "in lane " #lane,                                  \
+      .type             = VARIABLE_TYPE_INTEGER,                             \
+      .sample_func      = gimp_dashboard_sample_async_lane_queued            \
+    },                                                                       \
+                                                                             \
+    [VARIABLE_ASYNC_LANE_WAIT_TIME + (lane) - 1] =                           \
+    { .name             = "async-lane-" #lane "-wait-time",                  \
+      .title            = "Wait " #lane,                                     \
+      .description      = "Average time asynchronous operations wait "       \
+                          "in lane " #lane,                                  \
+      .type             = VARIABLE_TYPE_DURATION,                            \
+      .sample_func      = gimp_dashboard_sample_async_lane_wait_time         \
+    }
+
+  ASYNC_LANE_VARIABLES (1),
+  ASYNC_LANE_VARIABLES (2),
+  ASYNC_LANE_VARIABLES (3),
+  ASYNC_LANE_VARIABLES (4),
+  ASYNC_LANE_VARIABLES (5),
+  ASYNC_LANE_VARIABLES (6),
+  ASYNC_LANE_VARIABLES (7),
+  ASYNC_LANE_VARIABLES (8),
+  ASYNC_LANE_VARIABLES (9),
+  ASYNC_LANE_VARIABLES (10),
+  ASYNC_LANE_VARIABLES (11),
+  ASYNC_LANE_VARIABLES (12),
+  ASYNC_LANE_VARIABLES (13),
+  ASYNC_LANE_VARIABLES (14),
+  ASYNC_LANE_VARIABLES (15),
+  ASYNC_LANE_VARIABLES (16),
+
+  #undef ASYNC_LANE_VARIABLES
+
   [VARIABLE_TILE_ALLOC_TOTAL] =
   { .name             = "tile-alloc-total",
     .title            = NC_("dashboard-variable", "Tile"),
@@ -764,6 +856,71 @@ static const VariableInfo variables[] =
     .type             = VARIABLE_TYPE_SIZE,
     .sample_func      = gimp_dashboard_sample_function,
     .data             = gimp_temp_buf_get_total_memsize
+  },
+
+  [VARIABLE_BRUSH_CACHE_TOTAL] =
+  { .name             = "brush-cache-total",
+    .title            = NC_("dashboard-variable", "Brush cache"),
+    .description      = N_("Total size of cached brush transforms"),
+    .type             = VARIABLE_TYPE_SIZE,
+    .sample_func      = gimp_dashboard_sample_function,
+    .data             = gimp_brush_cache_get_total_memsize
+  },
+
+  [VARIABLE_BRUSH_CACHE_HIT_RATIO] =
+  { .name             = "brush-cache-hit-ratio",
+    .title            = NC_("dashboard-variable", "Brush hits"),
+    .description      = N_("Ratio of brush transforms found in the cache"),
+    .type             = VARIABLE_TYPE_PERCENTAGE,
+    .sample_func      = gimp_dashboard_sample_function,
+    .data             = gimp_brush_cache_get_hit_ratio
+  },
+
+  [VARIABLE_COLOR_TRANSFORM_CACHE_TOTAL] =
+  { .name             = "color-transform-cache-total",
+    .title            = NC_("dashboard-variable", "Transform cache"),
+    .description      = N_("Estimated size of cached color transforms"),
+    .type             = VARIABLE_TYPE_SIZE,
+    .sample_func      = gimp_dashboard_sample_function,
+    .data             = _gimp_color_transform_get_cache_size
+  },
+
+  [VARIABLE_COLOR_TRANSFORM_CACHE_HIT_RATIO] =
+  { .name             = "color-transform-cache-hit-ratio",
+    .title            = NC_("dashboard-variable", "Transform hits"),
+    .description      = N_("Ratio of color transforms found in the cache"),
+    .type             = VARIABLE_TYPE_PERCENTAGE,
+    .sample_func      = gimp_dashboard_sample_function,
+    .data             = _gimp_color_transform_get_cache_hit_ratio
+  },
+
+  [VARIABLE_GROUP_CACHE_TOTAL] =
+  { .name             = "group-cache-total",
+    .title            = NC_("dashboard-variable", "Group cache"),
+    .description      = N_("Size of the rendered tiles of the projections "
+                           "of layer groups"),
+    .type             = VARIABLE_TYPE_SIZE,
+    .sample_func      = gimp_dashboard_sample_function,
+    .data             = gimp_group_layer_get_total_cache_memsize
+  },
+
+  [VARIABLE_GROUP_CACHE_PINNED] =
+  { .name             = "group-cache-pinned",
+    .title            = NC_("dashboard-variable", "Pinned groups"),
+    .description      = N_("Size of the rendered tiles of the projections "
+                           "of pinned layer groups"),
+    .type             = VARIABLE_TYPE_SIZE,
+    .sample_func      = gimp_dashboard_sample_function,
+    .data             = gimp_group_layer_get_pinned_cache_memsize
+  },
+
+  [VARIABLE_DAB_TIME] =
+  { .name             = "dab-time",
+    .title            = NC_("dashboard-variable", "Dab"),
+    .description      = N_("Average time it takes to paint a brush dab"),
+    .type             = VARIABLE_TYPE_DURATION,
+    .sample_func      = gimp_dashboard_sample_function,
+    .data             = gimp_brush_core_get_dab_time
   }
 };
 
@@ -972,6 +1129,40 @@ static const GroupInfo groups[] =
                           { .variable       = VARIABLE_ASYNC_RUNNING,
                             .default_active = TRUE
                           },
+                          { .variable       = VARIABLE_ASYNC_QUEUED,
+                            .default_active = FALSE
+                          },
+                          { .variable       = VARIABLE_ASYNC_WAIT_TIME,
+                            .default_active = FALSE
+                          },
+
+                          #define ASYNC_LANE_FIELDS(lane)                                    \
+                            { .variable       = VARIABLE_ASYNC_LANE_QUEUED + (lane) - 1,    \
+                              .default_active = FALSE                                       \
+                            },                                                              \
+                            { .variable       = VARIABLE_ASYNC_LANE_WAIT_TIME + (lane) - 1, \
+                              .default_active = FALSE                                       \
+                            }
+
+                          ASYNC_LANE_FIELDS (1),
+                          ASYNC_LANE_FIELDS (2),
+                          ASYNC_LANE_FIELDS (3),
+                          ASYNC_LANE_FIELDS (4),
+                          ASYNC_LANE_FIELDS (5),
+                          ASYNC_LANE_FIELDS (6),
+                          ASYNC_LANE_FIELDS (7),
+                          ASYNC_LANE_FIELDS (8),
+                          ASYNC_LANE_FIELDS (9),
+                          ASYNC_LANE_FIELDS (10),
+                          ASYNC_LANE_FIELDS (11),
+                          ASYNC_LANE_FIELDS (12),
+                          ASYNC_LANE_FIELDS (13),
+                          ASYNC_LANE_FIELDS (14),
+                          ASYNC_LANE_FIELDS (15),
+                          ASYNC_LANE_FIELDS (16),
+
+                          #undef ASYNC_LANE_FIELDS
+
                           { .variable       = VARIABLE_TILE_ALLOC_TOTAL,
                             .default_active = TRUE
                           },
@@ -981,6 +1172,27 @@ static const GroupInfo groups[] =
                           { .variable       = VARIABLE_TEMP_BUF_TOTAL,
                             .default_active = TRUE
                           },
+                          { .variable       = VARIABLE_BRUSH_CACHE_TOTAL,
+                            .default_active = FALSE
+                          },
+                          { .variable       = VARIABLE_BRUSH_CACHE_HIT_RATIO,
+                            .default_active = FALSE
+                          },
+                          { .variable       = VARIABLE_COLOR_TRANSFORM_CACHE_TOTAL,
+                            .default_active = FALSE
+                          },
+                          { .variable       = VARIABLE_COLOR_TRANSFORM_CACHE_HIT_RATIO,
+                            .default_active = FALSE
+                          },
+                          { .variable       = VARIABLE_GROUP_CACHE_TOTAL,
+                            .default_active = FALSE
+                          },
+                          { .variable       = VARIABLE_GROUP_CACHE_PINNED,
+                            .default_active = FALSE
+                          },
+                          { .variable       = VARIABLE_DAB_TIME,
+                            .default_active = FALSE
+                          },
 
                           {}
                         }
@@ -2703,6 +2915,70 @@ gimp_dashboard_sample_memory_size (GimpDashboard *dashboard,
 
 #endif /* HAVE_MEMORY_GROUP */
 
+static void
+gimp_dashboard_sample_async_lane_queued (GimpDashboard *dashboard,
+                                         Variable       variable)
+{
+  GimpDashboardPrivate *priv          = dashboard->priv;
+  VariableData         *variable_data = &priv->variables[variable];
+  gint                  lane          = variable - VARIABLE_ASYNC_LANE_QUEUED;
+
+  variable_data->available = FALSE;
+
+  if (lane < gimp_parallel_run_async_get_n_lanes ())
+    {
+      gimp_parallel_run_async_get_lane_stats (lane,
+                                              &variable_data->value.integer,
+                                              NULL, NULL);
+
+      variable_data->available = TRUE;
+    }
+}
+
+static void
+gimp_dashboard_sample_async_lane_wait_time (GimpDashboard *dashboard,
+                                            Variable       variable)
+{
+  typedef struct
+  {
+    gdouble last_wait_time;
+    gint    last_n_dequeued;
+  } Data;
+
+  GimpDashboardPrivate *priv          = dashboard->priv;
+  VariableData         *variable_data = &priv->variables[variable];
+  Data                 *data          = gimp_dashboard_variable_get_data (
+                                          dashboard, variable, sizeof (Data));
+  gint                  lane          = variable - VARIABLE_ASYNC_LANE_WAIT_TIME;
+  gdouble               wait_time;
+  gint                  n_dequeued;
+
+  variable_data->available = FALSE;
+
+  if (lane >= gimp_parallel_run_async_get_n_lanes ())
+    return;
+
+  gimp_parallel_run_async_get_lane_stats (lane,
+                                          NULL, &wait_time, &n_dequeued);
+
+  /*  the average wait of the tasks dequeued since the last sample  */
+  if (n_dequeued > data->last_n_dequeued)
+    {
+      variable_data->value.duration =
+        (wait_time - data->last_wait_time) /
+        (n_dequeued - data->last_n_dequeued);
+    }
+  else
+    {
+      variable_data->value.duration = 0.0;
+    }
+
+  data->last_wait_time  = wait_time;
+  data->last_n_dequeued = n_dequeued;
+
+  variable_data->available = TRUE;
+}
+
 static void
 gimp_dashboard_sample_object (GimpDashboard *dashboard,
                               GObject       *object,
@@ -0,0 +1,458 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimptilebackendxcf.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <cairo.h>
+#include <gegl.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "libgimpbase/gimpbase.h"
+
+#include "core/core-types.h"
+
+#include "xcf-private.h"
+#include "xcf-read.h"
+#include "xcf-utils.h"
+
+#include "gimptilebackendxcf.h"
+
+
+/* where the current data of a tile is */
+enum
+{
+  TILE_STATE_FILE,
+  TILE_STATE_MODIFIED,
+  TILE_STATE_VOID
+};
+
+
+struct _GimpTileBackendXcfPrivate
+{
+  XcfMappedFile      *file;
+  XcfCompressionType  compression;
+  gint                file_version;
+  gint                bpp;
+  gint                n_components;
+  gint                width;
+  gint                height;
+  gint                n_tile_rows;
+  gint                n_tile_cols;
+  goffset            *offset_table;
+  goffset             max_data_length;
+
+  /* tiles written back to the backend are stored in a regular buffer,
+   * so that they can be swapped out like any other.  voided tiles read
+   * back as empty.
+   */
+  GMutex              mutex;
+  guint8             *tile_states;
+  GeglBuffer         *modified;
+};
+
+
+static void       gimp_tile_backend_xcf_finalize (GObject         *object);
+
+static gpointer   gimp_tile_backend_xcf_command  (GeglTileSource  *source,
+                                                  GeglTileCommand  command,
+                                                  gint             x,
+                                                  gint             y,
+                                                  gint             z,
+                                                  gpointer         data);
+
+static GeglTile * gimp_tile_backend_xcf_read     (GimpTileBackendXcf *backend_xcf,
+                                                  gint                index,
+                                                  gint                x,
+                                                  gint                y);
+static gboolean   gimp_tile_backend_xcf_decode   (GimpTileBackendXcf *backend_xcf,
+                                                  gint                index,
+                                                  guchar             *tile_data,
+                                                  gint                ewidth,
+                                                  gint                eheight);
+
+
+G_DEFINE_TYPE_WITH_PRIVATE (GimpTileBackendXcf, gimp_tile_backend_xcf,
+                            GEGL_TYPE_TILE_BACKEND)
+
+#define parent_class gimp_tile_backend_xcf_parent_class
+
+
+static void
+gimp_tile_backend_xcf_class_init (GimpTileBackendXcfClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = gimp_tile_backend_xcf_finalize;
+}
+
+static void
+gimp_tile_backend_xcf_init (GimpTileBackendXcf *backend)
+{
+  GeglTileSource *source = GEGL_TILE_SOURCE (backend);
+
+  backend->priv = gimp_tile_backend_xcf_get_instance_private (backend);
+
+  source->command = gimp_tile_backend_xcf_command;
+
+  g_mutex_init (&backend->priv->mutex);
+}
+
+static void
+gimp_tile_backend_xcf_finalize (GObject *object)
+{
+  GimpTileBackendXcf *backend_xcf = GIMP_TILE_BACKEND_XCF (object);
+
+  g_clear_object (&backend_xcf->priv->modified);
+  g_clear_pointer (&backend_xcf->priv->file, xcf_mapped_file_unref);
+  g_clear_pointer (&backend_xcf->priv->offset_table, g_free);
+  g_clear_pointer (&backend_xcf->priv->tile_states, g_free);
+
+  g_mutex_clear (&backend_xcf->priv->mutex);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static gpointer
+gimp_tile_backend_xcf_command (GeglTileSource  *source,
+                               GeglTileCommand  command,
+                               gint             x,
+                               gint             y,
+                               gint             z,
+                               gpointer         data)
+{
+  GimpTileBackendXcf        *backend_xcf = GIMP_TILE_BACKEND_XCF (source);
+  GimpTileBackendXcfPrivate *priv        = backend_xcf->priv;
+  gpointer                   result      = NULL;
+  gint                       index;
+
+  /* mipmap levels are rendered by GEGL from the level-0 tiles */
+  if (z != 0 || x < 0 || y < 0 ||
+      x >= priv->n_tile_cols || y >= priv->n_tile_rows)
+    {
+      if (command == GEGL_TILE_SET)
+        gegl_tile_mark_as_stored (data);
+      else if (command != GEGL_TILE_GET && command != GEGL_TILE_EXIST)
+        result = gegl_tile_backend_command (GEGL_TILE_BACKEND (source),
+                                            command, x, y, z, data);
+
+      return result;
+    }
+
+  index = y * priv->n_tile_cols + x;
+
+  switch (command)
+    {
+    case GEGL_TILE_GET:
+      result = gimp_tile_backend_xcf_read (backend_xcf, index, x, y);
+      break;
+
+    case GEGL_TILE_SET:
+      g_mutex_lock (&priv->mutex);
+
+      gegl_buffer_set (priv->modified,
+                       GEGL_RECTANGLE (x * XCF_TILE_WIDTH,
+                                       y * XCF_TILE_HEIGHT,
+                                       XCF_TILE_WIDTH,
+                                       XCF_TILE_HEIGHT),
+                       0,
+                       gegl_tile_backend_get_format (GEGL_TILE_BACKEND (source)),
+                       gegl_tile_get_data (data),
+                       GEGL_AUTO_ROWSTRIDE);
+
+      priv->tile_states[index] = TILE_STATE_MODIFIED;
+
+      g_mutex_unlock (&priv->mutex);
+
+      gegl_tile_mark_as_stored (data);
+      break;
+
+    case GEGL_TILE_VOID:
+      g_mutex_lock (&priv->mutex);
+
+      priv->tile_states[index] = TILE_STATE_VOID;
+
+      g_mutex_unlock (&priv->mutex);
+      break;
+
+    case GEGL_TILE_EXIST:
+      g_mutex_lock (&priv->mutex);
+
+      if (priv->tile_states[index] != TILE_STATE_VOID)
+        result = GINT_TO_POINTER (TRUE);
+
+      g_mutex_unlock (&priv->mutex);
+      break;
+
+    case GEGL_TILE_FLUSH:
+      break;
+
+    default:
+      result = gegl_tile_backend_command (GEGL_TILE_BACKEND (source),
+                                          command, x, y, z, data);
+      break;
+    }
+
+  return result;
+}
+
+
+/*  public functions  */
+
+GeglTileBackend *
+gimp_tile_backend_xcf_new (XcfMappedFile      *file,
+                           XcfCompressionType  compression,
+                           gint                file_version,
+                           const Babl         *format,
+                           gint                width,
+                           gint                height,
+                           const goffset      *offset_table,
+                           goffset             max_data_length)
+{
+  GeglTileBackend           *backend;
+  GimpTileBackendXcfPrivate *priv;
+  gint                       n_tiles;
+
+  g_return_val_if_fail (file != NULL, NULL);
+  g_return_val_if_fail (format != NULL, NULL);
+  g_return_val_if_fail (offset_table != NULL, NULL);
+
+  backend = g_object_new (GIMP_TYPE_TILE_BACKEND_XCF,
+                          "tile-width",  XCF_TILE_WIDTH,
+                          "tile-height", XCF_TILE_HEIGHT,
+                          "format",      format,
+                          NULL);
+
+  priv = GIMP_TILE_BACKEND_XCF (backend)->priv;
+
+  priv->file            = xcf_mapped_file_ref (file);
+  priv->compression     = compression;
+  priv->file_version    = file_version;
+  priv->bpp             = babl_format_get_bytes_per_pixel (format);
+  priv->n_components    = babl_format_get_n_components (format);
+  priv->width           = width;
+  priv->height          = height;
+  priv->n_tile_rows     = (height + XCF_TILE_HEIGHT - 1) / XCF_TILE_HEIGHT;
+  priv->n_tile_cols     = (width  + XCF_TILE_WIDTH  - 1) / XCF_TILE_WIDTH;
+  priv->max_data_length = max_data_length;
+
+  n_tiles = priv->n_tile_rows * priv->n_tile_cols;
+
+  priv->offset_table = g_memdup2 (offset_table, (n_tiles + 1) * sizeof (goffset));
+  priv->tile_states  = g_new0 (guint8, n_tiles);
+
+  /* the modified tiles are stored in a buffer with the same tile grid,
+   * covering whole tiles, so that each one maps to a single tile there.
+   */
+  priv->modified = g_object_new (GEGL_TYPE_BUFFER,
+                                 "format",      format,
+                                 "x",           0,
+                                 "y",           0,
+                                 "width",       priv->n_tile_cols * XCF_TILE_WIDTH,
+                                 "height",      priv->n_tile_rows * XCF_TILE_HEIGHT,
+                                 "tile-width",  XCF_TILE_WIDTH,
+                                 "tile-height", XCF_TILE_HEIGHT,
+                                 NULL);
+
+  gegl_tile_backend_set_extent (backend,
+                                GEGL_RECTANGLE (0, 0, width, height));
+
+  return backend;
+}
+
+
+/*  private functions  */
+
+static GeglTile *
+gimp_tile_backend_xcf_read (GimpTileBackendXcf *backend_xcf,
+                            gint                index,
+                            gint                x,
+                            gint                y)
+{
+  GimpTileBackendXcfPrivate *priv = backend_xcf->priv;
+  GeglTile                  *tile;
+  guchar                    *tile_data;
+  gint                       tile_size;
+  gint                       ewidth;
+  gint                       eheight;
+
+  tile_size = gegl_tile_backend_get_tile_size (GEGL_TILE_BACKEND (backend_xcf));
+
+  g_mutex_lock (&priv->mutex);
+
+  switch (priv->tile_states[index])
+    {
+    case TILE_STATE_FILE:
+      break;
+
+    case TILE_STATE_MODIFIED:
+      tile      = gegl_tile_new (tile_size);
+      tile_data = gegl_tile_get_data (tile);
+
+      gegl_buffer_get (priv->modified,
+                       GEGL_RECTANGLE (x * XCF_TILE_WIDTH,
+                                       y * XCF_TILE_HEIGHT,
+                                       XCF_TILE_WIDTH,
+                                       XCF_TILE_HEIGHT),
+                       1.0,
+                       gegl_tile_backend_get_format (GEGL_TILE_BACKEND (backend_xcf)),
+                       tile_data,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+      g_mutex_unlock (&priv->mutex);
+
+      return tile;
+
+    case TILE_STATE_VOID:
+      g_mutex_unlock (&priv->mutex);
+
+      return NULL;
+    }
+
+  g_mutex_unlock (&priv->mutex);
+
+  ewidth  = MIN (XCF_TILE_WIDTH,  priv->width  - x * XCF_TILE_WIDTH);
+  eheight = MIN (XCF_TILE_HEIGHT, priv->height - y * XCF_TILE_HEIGHT);
+
+  tile      = gegl_tile_new (tile_size);
+  tile_data = gegl_tile_get_data (tile);
+
+  if (! gimp_tile_backend_xcf_decode (backend_xcf, index,
+                                      tile_data, ewidth, eheight))
+    {
+      /* like the loader, treat broken or empty tiles as transparent,
+       * and let GEGL provide its shared empty tile.
+       */
+      gegl_tile_unref (tile);
+
+      return NULL;
+    }
+
+  if (ewidth < XCF_TILE_WIDTH || eheight < XCF_TILE_HEIGHT)
+    {
+      gint tile_stride = XCF_TILE_WIDTH * priv->bpp;
+      gint xcf_stride  = ewidth         * priv->bpp;
+      gint row;
+
+      /* the file stores edge tiles with their effective size; spread
+       * the rows out to the full tile stride, starting from the last
+       * one so that no row is overwritten before being moved.
+       */
+      for (row = eheight - 1; row >= 0; row--)
+        {
+          memmove (tile_data + row * tile_stride,
+                   tile_data + row * xcf_stride,
+                   xcf_stride);
+          memset (tile_data + row * tile_stride + xcf_stride, 0,
+                  tile_stride - xcf_stride);
+        }
+
+      memset (tile_data + eheight * tile_stride, 0,
+              (XCF_TILE_HEIGHT - eheight) * tile_stride);
+    }
+
+  return tile;
+}
+
+static gboolean
+gimp_tile_backend_xcf_decode (GimpTileBackendXcf *backend_xcf,
+                              gint                index,
+                              guchar             *tile_data,
+                              gint                ewidth,
+                              gint                eheight)
+{
+  GimpTileBackendXcfPrivate *priv      = backend_xcf->priv;
+  const guchar              *file_data;
+  guchar                    *copy      = NULL;
+  goffset                    offset;
+  goffset                    offset2;
+  gsize                      data_length;
+  gint                       size      = ewidth * eheight * priv->bpp;
+  gboolean                   success   = FALSE;
+  gboolean                   nonzero   = FALSE;
+
+  offset  = priv->offset_table[index];
+  offset2 = priv->offset_table[index + 1];
+
+  /* the last tile's data length is unknown, read as much as it may
+   * possibly take.
+   */
+  if (offset2 == 0)
+    offset2 = offset + priv->max_data_length;
+
+  if (offset <= 0 || offset2 <= offset)
+    return FALSE;
+
+  /* the file may have changed since it was mapped, this only returns
+   * the part of the tile's data which is still in the file.
+   */
+  data_length = offset2 - offset;
+  file_data   = xcf_mapped_file_get_data (priv->file, offset, &data_length,
+                                          &copy);
+
+  if (! file_data)
+    return FALSE;
+
+  switch (priv->compression)
+    {
+    case COMPRESS_NONE:
+      if (data_length >= (gsize) size)
+        {
+          memcpy (tile_data, file_data, size);
+          nonzero = ! xcf_data_is_zero (tile_data, size);
+          success = TRUE;
+        }
+      break;
+
+    case COMPRESS_RLE:
+      success = xcf_decode_rle (file_data, data_length, tile_data,
+                                ewidth * eheight, priv->bpp, &nonzero);
+
+      if (! success)
+        {
+          g_printerr ("xcf: failed to decompress tile data. "
+                      "Possibly corrupt XCF file.");
+        }
+      break;
+
+    case COMPRESS_ZLIB:
+      success = xcf_decode_zlib (file_data, data_length, tile_data, size);
+
+      if (success)
+        nonzero = ! xcf_data_is_zero (tile_data, size);
+      break;
+
+    default:
+      break;
+    }
+
+  g_free (copy);
+
+  if (! success || ! nonzero)
+    return FALSE;
+
+  if (priv->file_version >= 12)
+    {
+      xcf_read_from_be (priv->bpp / priv->n_components, tile_data,
+                        size / priv->bpp * priv->n_components);
+    }
+
+  return TRUE;
+}
@@ -18,7 +18,6 @@
 #include "config.h"
 
 #include <string.h>
-#include <zlib.h>
 
 #include <cairo.h>
 #include <gegl.h>
@@ -32,6 +31,7 @@
 #include "core/core-types.h"
 
 #include "config/gimpcoreconfig.h"
+#include "config/gimpgeglconfig.h"
 
 #include "gegl/gimp-babl.h"
 #include "gegl/gimp-gegl-tile-compat.h"
@@ -99,6 +99,8 @@
 #include "xcf-seek.h"
 #include "xcf-utils.h"
 
+#include "gimptilebackendxcf.h"
+
 #include "gimp-log.h"
 #include "gimp-intl.h"
 
@@ -130,6 +132,32 @@ typedef struct
   gboolean               unsupported_operation;
 } FilterData;
 
+/* Per thread data for xcf_load_tile_parallel */
+typedef struct
+{
+  /* Common to all jobs. */
+  GeglBuffer         *buffer;
+  const Babl         *format;
+  gint                file_version;
+  XcfCompressionType  compression;
+  gint                max_data_len;
+  gint                tile_size;
+
+  /* Job specific. */
+  gint                tile;
+  gint                batch_size;
+
+  /* Compressed data, as read from the file. */
+  guchar             *data;
+  gsize               data_len[XCF_TILE_LOAD_BATCH_SIZE];
+
+  /* Return data. */
+  guchar             *tile_data;
+  GeglRectangle       tile_rect[XCF_TILE_LOAD_BATCH_SIZE];
+  gboolean            nonzero[XCF_TILE_LOAD_BATCH_SIZE];
+  gboolean            success;
+} XcfLoadJobData;
+
 typedef struct
 {
   GimpTattoo       path_tattoo;
@@ -226,9 +254,24 @@ static GimpLayerMask * xcf_load_layer_mask    (XcfInfo       *info,
                                                GimpImage     *image,
                                                gint          *n_broken_effects);
 static gboolean        xcf_load_buffer        (XcfInfo       *info,
-                                               GeglBuffer    *buffer);
+                                               GimpDrawable  *drawable);
 static gboolean        xcf_load_level         (XcfInfo       *info,
-                                               GeglBuffer    *buffer);
+                                               GimpDrawable  *drawable);
+static gboolean        xcf_load_offset_table  (XcfInfo       *info,
+                                               guint          ntiles,
+                                               goffset        first_offset,
+                                               goffset        max_data_length,
+                                               goffset      **offset_table);
+static gboolean        xcf_load_level_parallel (XcfInfo      *info,
+                                                GeglBuffer   *buffer,
+                                                guint         ntiles,
+                                                goffset       first_offset,
+                                                goffset       max_data_length);
+static gboolean        xcf_load_level_lazy    (XcfInfo       *info,
+                                               GimpDrawable  *drawable,
+                                               guint          ntiles,
+                                               goffset        first_offset,
+                                               goffset        max_data_length);
 static gboolean        xcf_load_tile          (XcfInfo       *info,
                                                GeglBuffer    *buffer,
                                                GeglRectangle *tile_rect,
@@ -243,6 +286,9 @@ static gboolean        xcf_load_tile_zlib     (XcfInfo       *info,
                                                GeglRectangle *tile_rect,
                                                const Babl    *format,
                                                gint           data_length);
+static void            xcf_load_free_job_data (XcfLoadJobData *data);
+static void            xcf_load_tile_parallel (XcfLoadJobData *job_data,
+                                               GAsyncQueue    *queue);
 static GimpParasite  * xcf_load_parasite      (XcfInfo       *info);
 static gboolean        xcf_load_old_paths     (XcfInfo       *info,
                                                GimpImage     *image);
@@ -4022,8 +4068,7 @@ xcf_load_layer (XcfInfo    *info,
 
       GIMP_LOG (XCF, "loading buffer");
 
-      if (! xcf_load_buffer (info,
-                             gimp_drawable_get_buffer (GIMP_DRAWABLE (layer))))
+      if (! xcf_load_buffer (info, GIMP_DRAWABLE (layer)))
         goto error;
 
       GIMP_LOG (XCF, "buffer loaded");
@@ -4209,8 +4254,7 @@ xcf_load_channel (XcfInfo   *info,
   if (! xcf_seek_pos (info, hierarchy_offset, NULL))
     goto error;
 
-  if (! xcf_load_buffer (info,
-                         gimp_drawable_get_buffer (GIMP_DRAWABLE (channel))))
+  if (! xcf_load_buffer (info, GIMP_DRAWABLE (channel)))
     goto error;
 
   cur_offset += info->bytes_per_offset;
@@ -4873,8 +4917,7 @@ xcf_load_layer_mask (XcfInfo   *info,
   if (! xcf_seek_pos (info, hierarchy_offset, NULL))
     goto error;
 
-  if (! xcf_load_buffer (info,
-                         gimp_drawable_get_buffer (GIMP_DRAWABLE (layer_mask))))
+  if (! xcf_load_buffer (info, GIMP_DRAWABLE (layer_mask)))
     goto error;
 
   cur_offset += info->bytes_per_offset;
@@ -4950,9 +4993,10 @@ xcf_load_layer_mask (XcfInfo   *info,
 }
 
 static gboolean
-xcf_load_buffer (XcfInfo    *info,
-                 GeglBuffer *buffer)
+xcf_load_buffer (XcfInfo      *info,
+                 GimpDrawable *drawable)
 {
+  GeglBuffer *buffer = gimp_drawable_get_buffer (drawable);
   const Babl *format;
   goffset     offset;
   gint        width;
@@ -4988,7 +5032,7 @@ xcf_load_buffer (XcfInfo    *info,
     return FALSE;
 
   /* read in the level */
-  if (! xcf_load_level (info, buffer))
+  if (! xcf_load_level (info, drawable))
     return FALSE;
 
   /* discard levels below first.
@@ -4999,9 +5043,10 @@ xcf_load_buffer (XcfInfo    *info,
 
 
 static gboolean
-xcf_load_level (XcfInfo    *info,
-                GeglBuffer *buffer)
+xcf_load_level (XcfInfo      *info,
+                GimpDrawable *drawable)
 {
+  GeglBuffer *buffer = gimp_drawable_get_buffer (drawable);
   const Babl *format;
   gint        bpp;
   goffset     saved_pos;
@@ -5050,6 +5095,24 @@ xcf_load_level (XcfInfo    *info,
   n_tile_cols = gimp_gegl_buffer_get_n_tile_cols (buffer, XCF_TILE_WIDTH);
 
   ntiles = n_tile_rows * n_tile_cols;
+
+  if (info->mapped_file &&
+      (info->compression == COMPRESS_NONE ||
+       info->compression == COMPRESS_RLE  ||
+       info->compression == COMPRESS_ZLIB))
+    {
+      return xcf_load_level_lazy (info, drawable, ntiles, offset,
+                                  max_data_length);
+    }
+
+  if (info->compression == COMPRESS_RLE ||
+      info->compression == COMPRESS_ZLIB)
+    {
+      return xcf_load_level_parallel (info, buffer, ntiles, offset,
+                                      max_data_length);
+    }
+
+  /* non parallel implementation */
   for (i = 0; i < ntiles; i++)
     {
       GeglRectangle rect;
@@ -5165,6 +5228,332 @@ xcf_load_level (XcfInfo    *info,
   return TRUE;
 }
 
+static gboolean
+xcf_load_offset_table (XcfInfo  *info,
+                       guint     ntiles,
+                       goffset   first_offset,
+                       goffset   max_data_length,
+                       goffset **offset_table)
+{
+  goffset *table;
+  guint    i;
+
+  /* allocate ntiles + 1 slots because a zero offset indicates the offset
+   * table's end.
+   */
+  table    = g_new (goffset, ntiles + 1);
+  table[0] = first_offset;
+
+  for (i = 1; i <= ntiles; i++)
+    {
+      if (xcf_read_offset (info, &table[i], 1) < info->bytes_per_offset)
+        {
+          GIMP_LOG (XCF, "Failed to read tile offset"
+                    " at offset: %" G_GOFFSET_FORMAT, info->cp);
+          g_free (table);
+          return FALSE;
+        }
+    }
+
+  /* validate the table before starting any work */
+  for (i = 0; i < ntiles; i++)
+    {
+      goffset offset  = table[i];
+      goffset offset2 = table[i + 1];
+
+      if (offset == 0)
+        {
+          gimp_message_literal (info->gimp, G_OBJECT (info->progress),
+                                GIMP_MESSAGE_ERROR,
+                                "not enough tiles found in level");
+          g_free (table);
+          return FALSE;
+        }
+
+      /* if the offset is 0 then we need to read in the maximum possible
+       * allowing for negative compression
+       */
+      if (offset2 == 0)
+        offset2 = offset + max_data_length;
+
+      if (offset2 < offset || offset2 - offset > max_data_length)
+        {
+          gimp_message (info->gimp, G_OBJECT (info->progress),
+                        GIMP_MESSAGE_ERROR,
+                        "invalid tile data length: %" G_GOFFSET_FORMAT,
+                        offset2 - offset);
+          g_free (table);
+          return FALSE;
+        }
+    }
+
+  if (table[ntiles] != 0)
+    {
+      gimp_message (info->gimp, G_OBJECT (info->progress), GIMP_MESSAGE_ERROR,
+                    "encountered garbage after reading level: %" G_GOFFSET_FORMAT,
+                    table[ntiles]);
+      g_free (table);
+      return FALSE;
+    }
+
+  *offset_table = table;
+
+  return TRUE;
+}
+
+static gboolean
+xcf_load_level_parallel (XcfInfo    *info,
+                         GeglBuffer *buffer,
+                         guint       ntiles,
+                         goffset     first_offset,
+                         goffset     max_data_length)
+{
+  const Babl      *format;
+  goffset         *offset_table;
+  goffset          table_end;
+  XcfLoadJobData  *job_data;
+  XcfLoadJobData **done_jobs;
+  GThreadPool     *pool;
+  GAsyncQueue     *queue;
+  gint             num_processors;
+  gint             num_tasks;
+  gint             n_batches;
+  gint             n_pending = 0;
+  gint             next_batch;
+  gint             bpp;
+  gint             tile_size;
+  guint            next_tile = 0;
+  guint            i;
+  gint             k;
+  gboolean         success   = TRUE;
+
+  format = gegl_buffer_get_format (buffer);
+  bpp    = babl_format_get_bytes_per_pixel (format);
+
+  tile_size = XCF_TILE_WIDTH * XCF_TILE_HEIGHT * bpp;
+
+  /* read the whole offset table at once, so that the tile data can then
+   * be fetched sequentially in batches without seeking back and forth.
+   */
+  if (! xcf_load_offset_table (info, ntiles, first_offset, max_data_length,
+                               &offset_table))
+    return FALSE;
+
+  table_end = info->cp;
+
+  num_processors = GIMP_GEGL_CONFIG (info->gimp->config)->num_processors;
+  num_tasks      = num_processors * 2;
+  n_batches      = (ntiles + XCF_TILE_LOAD_BATCH_SIZE - 1) /
+                   XCF_TILE_LOAD_BATCH_SIZE;
+
+  /* finished batches which can't be written yet, because an earlier
+   * batch is still being decoded.
+   */
+  done_jobs = g_new0 (XcfLoadJobData *, n_batches);
+
+  queue = g_async_queue_new_full ((GDestroyNotify) xcf_load_free_job_data);
+  pool  = g_thread_pool_new_full ((GFunc) xcf_load_tile_parallel,
+                                  queue,
+                                  (GDestroyNotify) xcf_load_free_job_data,
+                                  num_processors, TRUE, NULL);
+
+  i          = 0;
+  job_data   = NULL;
+  next_batch = 0;
+
+  while (next_tile < ntiles)
+    {
+      /* The main thread reads the compressed data of the following
+       * batches, while the thread pool decompresses the previous ones.
+       * We keep more tasks than there are threads in flight, ensuring
+       * threads always have something to do!
+       */
+      while (success && i < ntiles && n_pending < num_tasks)
+        {
+          if (! job_data)
+            {
+              job_data = g_new (XcfLoadJobData, 1);
+
+              job_data->buffer       = buffer;
+              job_data->format       = format;
+              job_data->file_version = info->file_version;
+              job_data->compression  = info->compression;
+              job_data->max_data_len = max_data_length;
+              job_data->tile_size    = tile_size;
+              job_data->data         = g_malloc (max_data_length *
+                                                 XCF_TILE_LOAD_BATCH_SIZE);
+              job_data->tile_data    = g_malloc (tile_size *
+                                                 XCF_TILE_LOAD_BATCH_SIZE);
+            }
+
+          job_data->tile       = i;
+          job_data->batch_size = MIN (XCF_TILE_LOAD_BATCH_SIZE, ntiles - i);
+
+          for (k = 0; k < job_data->batch_size; k++)
+            {
+              goffset offset  = offset_table[i + k];
+              goffset offset2 = offset_table[i + k + 1];
+              gsize   bytes_read;
+
+              if (offset2 == 0)
+                offset2 = offset + max_data_length;
+
+              if (! xcf_seek_pos (info, offset, NULL))
+                {
+                  success = FALSE;
+                  break;
+                }
+
+              GIMP_LOG (XCF, "reading tile %d/%d", i + k + 1, ntiles);
+
+              /* we have to read directly instead of xcf_read_* because
+               * we may be reading past the end of the file here
+               */
+              g_input_stream_read_all (info->input,
+                                       job_data->data +
+                                       max_data_length * k,
+                                       offset2 - offset,
+                                       &bytes_read, NULL, NULL);
+              info->cp += bytes_read;
+
+              job_data->data_len[k] = bytes_read;
+            }
+
+          if (! success)
+            {
+              g_clear_pointer (&job_data, xcf_load_free_job_data);
+              break;
+            }
+
+          i += job_data->batch_size;
+
+          g_thread_pool_push (pool, job_data, NULL);
+          job_data = NULL;
+
+          n_pending++;
+        }
+
+      if (n_pending == 0)
+        break;
+
+      /* Now wait for the next batch in order, and write it. */
+      while (! done_jobs[next_batch])
+        {
+          XcfLoadJobData *result = g_async_queue_pop (queue);
+
+          done_jobs[result->tile / XCF_TILE_LOAD_BATCH_SIZE] = result;
+          n_pending--;
+        }
+
+      job_data = done_jobs[next_batch];
+      done_jobs[next_batch] = NULL;
+      next_batch++;
+
+      if (success && ! job_data->success)
+        {
+          g_printerr ("xcf: failed to decompress tile data. "
+                      "Possibly corrupt XCF file.");
+          success = FALSE;
+        }
+
+      if (success)
+        {
+          for (k = 0; k < job_data->batch_size; k++)
+            {
+              if (job_data->nonzero[k])
+                {
+                  gegl_buffer_set (buffer, &job_data->tile_rect[k], 0,
+                                   format,
+                                   job_data->tile_data + tile_size * k,
+                                   GEGL_AUTO_ROWSTRIDE);
+                }
+
+              GIMP_LOG (XCF, "loaded tile %d/%d",
+                        job_data->tile + k + 1, ntiles);
+            }
+        }
+
+      next_tile += job_data->batch_size;
+
+      /* the job is recycled for the next batch */
+      if (! success)
+        g_clear_pointer (&job_data, xcf_load_free_job_data);
+    }
+
+  if (job_data)
+    xcf_load_free_job_data (job_data);
+
+  /* On failure, wait for the remaining tasks and drop their results. */
+  g_thread_pool_free (pool, FALSE, TRUE);
+
+  for (k = 0; k < n_batches; k++)
+    {
+      if (done_jobs[k])
+        xcf_load_free_job_data (done_jobs[k]);
+    }
+
+  g_free (done_jobs);
+  g_async_queue_unref (queue);
+  g_free (offset_table);
+
+  if (! success)
+    return FALSE;
+
+  /* leave the position after the offset table, as the sequential
+   * implementation does.
+   */
+  return xcf_seek_pos (info, table_end, NULL);
+}
+
+static gboolean
+xcf_load_level_lazy (XcfInfo      *info,
+                     GimpDrawable *drawable,
+                     guint         ntiles,
+                     goffset       first_offset,
+                     goffset       max_data_length)
+{
+  GeglBuffer      *buffer = gimp_drawable_get_buffer (drawable);
+  GeglTileBackend *backend;
+  GeglBuffer      *lazy_buffer;
+  goffset         *offset_table;
+  GeglRectangle    bounds;
+
+  /* only the offset table is read now, the tiles themselves are decoded
+   * from the mapped file when they are first accessed.
+   */
+  if (! xcf_load_offset_table (info, ntiles, first_offset, max_data_length,
+                               &offset_table))
+    return FALSE;
+
+  backend = gimp_tile_backend_xcf_new (info->mapped_file,
+                                       info->compression,
+                                       info->file_version,
+                                       gegl_buffer_get_format (buffer),
+                                       gegl_buffer_get_width  (buffer),
+                                       gegl_buffer_get_height (buffer),
+                                       offset_table,
+                                       max_data_length);
+  g_free (offset_table);
+
+  lazy_buffer = gegl_buffer_new_for_backend (NULL, backend);
+  g_object_unref (backend);
+
+  /* call the set_buffer() vfunc directly, gimp_drawable_set_buffer()
+   * would copy the whole buffer to a cache file, reading every tile.  the
+   * buffer has no cache file then, and is only copied to one when the
+   * drawable's state is saved, see gimp_drawable_save().
+   */
+  gimp_item_get_offset (GIMP_ITEM (drawable), &bounds.x, &bounds.y);
+  bounds.width  = 0;
+  bounds.height = 0;
+
+  GIMP_DRAWABLE_GET_CLASS (drawable)->set_buffer (drawable, FALSE, NULL,
+                                                  lazy_buffer, &bounds);
+  g_object_unref (lazy_buffer);
+
+  return TRUE;
+}
+
 static gboolean
 xcf_load_tile (XcfInfo       *info,
                GeglBuffer    *buffer,
@@ -5203,15 +5592,12 @@ xcf_load_tile_rle (XcfInfo       *info,
                    const Babl    *format,
                    gint           data_length)
 {
-  gint    bpp       = babl_format_get_bytes_per_pixel (format);
-  gint    tile_size = bpp * tile_rect->width * tile_rect->height;
-  guchar *tile_data = g_alloca (tile_size);
-  guchar  nonzero   = FALSE;
-  gsize   bytes_read;
-  gint    i;
-  guchar *xcfdata;
-  guchar *xcfodata;
-  guchar *xcfdatalimit;
+  gint     bpp       = babl_format_get_bytes_per_pixel (format);
+  gint     tile_size = bpp * tile_rect->width * tile_rect->height;
+  guchar  *tile_data = g_alloca (tile_size);
+  gboolean nonzero   = FALSE;
+  gsize    bytes_read;
+  guchar  *xcfdata;
 
   /* Workaround for bug #357809: avoid crashing on g_malloc() and skip
    * this tile (return TRUE without storing data) as if it did not
@@ -5222,7 +5608,7 @@ xcf_load_tile_rle (XcfInfo       *info,
   if (data_length <= 0)
     return TRUE;
 
-  xcfdata = xcfodata = g_alloca (data_length);
+  xcfdata = g_alloca (data_length);
 
   /* we have to read directly instead of xcf_read_* because we may be
    * reading past the end of the file here
@@ -5234,99 +5620,10 @@ xcf_load_tile_rle (XcfInfo       *info,
   if (bytes_read == 0)
     return TRUE;
 
-  xcfdatalimit = &xcfodata[bytes_read - 1];
-
-  for (i = 0; i < bpp; i++)
-    {
-      guchar *data  = tile_data + i;
-      gint    size  = tile_rect->width * tile_rect->height;
-      /*gint    count = 0;*/
-      guchar  val;
-      gint    length;
-      gint    j;
-
-      while (size > 0)
-        {
-          if (xcfdata > xcfdatalimit)
-            {
-              goto bogus_rle;
-            }
-
-          val = *xcfdata++;
-
-          length = val;
-          if (length >= 128)
-            {
-              length = 255 - (length - 1);
-              if (length == 128)
-                {
-                  if (xcfdata >= xcfdatalimit)
-                    {
-                      goto bogus_rle;
-                    }
-
-                  length = (*xcfdata << 8) + xcfdata[1];
-                  xcfdata += 2;
-                }
-
-              /*count += length;*/
-              size -= length;
-
-              if (size < 0)
-                {
-                  goto bogus_rle;
-                }
-
-              if (&xcfdata[length-1] > xcfdatalimit)
-                {
-                  goto bogus_rle;
-                }
-
-              while (length-- > 0)
-                {
-                  *data = *xcfdata++;
-                  nonzero |= *data;
-                  data += bpp;
-                }
-            }
-          else
-            {
-              length += 1;
-              if (length == 128)
-                {
-                  if (xcfdata >= xcfdatalimit)
-                    {
-                      goto bogus_rle;
-                    }
-
-                  length = (*xcfdata << 8) + xcfdata[1];
-                  xcfdata += 2;
-                }
-
-              /*count += length;*/
-              size -= length;
-
-              if (size < 0)
-                {
-                  goto bogus_rle;
-                }
-
-              if (xcfdata > xcfdatalimit)
-                {
-                  goto bogus_rle;
-                }
-
-              val = *xcfdata++;
-              nonzero |= val;
-
-              for (j = 0; j < length; j++)
-                {
-                  *data = val;
-                  data += bpp;
-                }
-            }
-        }
-    }
+  if (! xcf_decode_rle (xcfdata, bytes_read, tile_data,
+                        tile_rect->width * tile_rect->height, bpp,
+                        &nonzero))
+    return FALSE;
 
   if (nonzero)
     {
@@ -5343,9 +5640,6 @@ xcf_load_tile_rle (XcfInfo       *info,
     }
 
   return TRUE;
-
- bogus_rle:
-  return FALSE;
 }
 
 static gboolean
@@ -5355,9 +5649,6 @@ xcf_load_tile_zlib (XcfInfo       *info,
                     const Babl    *format,
                     gint           data_length)
 {
-  z_stream  strm;
-  int       action;
-  int       status;
   gint      bpp       = babl_format_get_bytes_per_pixel (format);
   gint      tile_size = bpp * tile_rect->width * tile_rect->height;
   guchar   *tile_data = g_alloca (tile_size);
@@ -5385,67 +5676,106 @@ xcf_load_tile_zlib (XcfInfo       *info,
   if (bytes_read == 0)
     return TRUE;
 
-  strm.next_out  = tile_data;
-  strm.avail_out = tile_size;
-
-  strm.zalloc    = Z_NULL;
-  strm.zfree     = Z_NULL;
-  strm.opaque    = Z_NULL;
-  strm.next_in   = xcfdata;
-  strm.avail_in  = bytes_read;
-
-  /* Initialize the stream decompression. */
-  status = inflateInit (&strm);
-  if (status != Z_OK)
+  if (! xcf_decode_zlib (xcfdata, bytes_read, tile_data, tile_size))
     return FALSE;
 
-  action = Z_NO_FLUSH;
-
-  while (status == Z_OK)
+  if (! xcf_data_is_zero (tile_data, tile_size))
     {
-      if (strm.avail_in == 0)
+      if (info->file_version >= 12)
         {
-          action = Z_FINISH;
+          gint n_components = babl_format_get_n_components (format);
+
+          xcf_read_from_be (bpp / n_components, tile_data,
+                            tile_size / bpp * n_components);
         }
 
-      status = inflate (&strm, action);
+      gegl_buffer_set (buffer, tile_rect, 0, format, tile_data,
+                       GEGL_AUTO_ROWSTRIDE);
+    }
+
+  return TRUE;
+}
 
-      if (status == Z_STREAM_END)
+static void
+xcf_load_free_job_data (XcfLoadJobData *data)
+{
+  g_free (data->data);
+  g_free (data->tile_data);
+  g_free (data);
+}
+
+static void
+xcf_load_tile_parallel (XcfLoadJobData *job_data,
+                        GAsyncQueue    *queue)
+{
+  gint bpp;
+  gint n_components;
+  gint i;
+
+  bpp          = babl_format_get_bytes_per_pixel (job_data->format);
+  n_components = babl_format_get_n_components (job_data->format);
+
+  job_data->success = TRUE;
+
+  for (i = 0; i < job_data->batch_size; i++)
+    {
+      GeglRectangle *tile_rect = &job_data->tile_rect[i];
+      const guchar  *xcfdata;
+      guchar        *tile_data;
+      gint           tile_size;
+      gboolean       nonzero   = FALSE;
+
+      gimp_gegl_buffer_get_tile_rect (job_data->buffer,
+                                      XCF_TILE_WIDTH,
+                                      XCF_TILE_HEIGHT,
+                                      job_data->tile + i,
+                                      tile_rect);
+
+      xcfdata   = job_data->data + job_data->max_data_len * i;
+      tile_data = job_data->tile_data + job_data->tile_size * i;
+      tile_size = bpp * tile_rect->width * tile_rect->height;
+
+      /* see the bug #357809 workaround in xcf_load_tile_rle() */
+      if (job_data->data_len[i] == 0)
         {
-          /* All the data was successfully decoded. */
-          break;
+          job_data->nonzero[i] = FALSE;
+
+          continue;
         }
-      else if (status == Z_BUF_ERROR)
+
+      if (job_data->compression == COMPRESS_RLE)
         {
-          g_printerr ("xcf: decompressed tile bigger than the expected size.");
-          inflateEnd (&strm);
-          return FALSE;
+          if (! xcf_decode_rle (xcfdata, job_data->data_len[i],
+                                tile_data,
+                                tile_rect->width * tile_rect->height,
+                                bpp, &nonzero))
+            {
+              job_data->success = FALSE;
+              break;
+            }
         }
-      else if (status != Z_OK)
+      else
         {
-          g_printerr ("xcf: tile decompression failed: %s", zError (status));
-          inflateEnd (&strm);
-          return FALSE;
+          if (! xcf_decode_zlib (xcfdata, job_data->data_len[i],
+                                 tile_data, tile_size))
+            {
+              job_data->success = FALSE;
+              break;
+            }
+
+          nonzero = ! xcf_data_is_zero (tile_data, tile_size);
         }
-    }
 
-  if (! xcf_data_is_zero (tile_data, tile_size))
-    {
-      if (info->file_version >= 12)
+      if (nonzero && job_data->file_version >= 12)
         {
-          gint n_components = babl_format_get_n_components (format);
-
           xcf_read_from_be (bpp / n_components, tile_data,
                             tile_size / bpp * n_components);
         }
 
-      gegl_buffer_set (buffer, tile_rect, 0, format, tile_data,
-                       GEGL_AUTO_ROWSTRIDE);
+      job_data->nonzero[i] = nonzero;
     }
 
-  inflateEnd (&strm);
-
-  return TRUE;
+  g_async_queue_push (queue, job_data);
 }
 
 static GimpParasite *
@@ -22,6 +22,7 @@
 #define XCF_TILE_HEIGHT                 64
 #define XCF_TILE_MAX_DATA_LENGTH_FACTOR 1.5
 #define XCF_TILE_SAVE_BATCH_SIZE        128
+#define XCF_TILE_LOAD_BATCH_SIZE        128
 
 typedef enum
 {
@@ -116,7 +117,8 @@ typedef enum
   FILTER_PROP_GRADIENT = 9,
 } FilterPropType;
 
-typedef struct _XcfInfo  XcfInfo;
+typedef struct _XcfInfo       XcfInfo;
+typedef struct _XcfMappedFile XcfMappedFile;
 
 struct _XcfInfo
 {
@@ -149,4 +151,7 @@ struct _XcfInfo
   goffset             floating_sel_offset;
   XcfCompressionType  compression;
   gint                file_version;
+
+  /* set when loading tiles lazily from the mapped file */
+  XcfMappedFile      *mapped_file;
 };
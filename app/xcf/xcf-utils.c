@@ -17,13 +17,37 @@
 
 #include "config.h"
 
+#include <zlib.h>
+
 #include <cairo.h>
 #include <gegl.h>
 #include <gdk-pixbuf/gdk-pixbuf.h>
+#include <glib/gstdio.h>
+
+#ifndef G_OS_WIN32
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "libgimpbase/gimpbase.h"
 
+#include "core/core-types.h"
+
+#include "xcf-private.h"
 #include "xcf-utils.h"
 
 
+struct _XcfMappedFile
+{
+  gint         ref_count;
+  gint         fd;
+  GMappedFile *mapped_file;
+};
+
+
 gboolean
 xcf_data_is_zero (const void *data,
                   gint        size)
@@ -51,3 +75,276 @@ xcf_data_is_zero (const void *data,
 
   return TRUE;
 }
+
+gboolean
+xcf_decode_rle (const guchar *xcfdata,
+                gsize         data_length,
+                guchar       *tile_data,
+                gint          n_pixels,
+                gint          bpp,
+                gboolean     *nonzero)
+{
+  const guchar *xcfdatalimit = &xcfdata[data_length - 1];
+  guchar        any          = 0;
+  gint          i;
+
+  for (i = 0; i < bpp; i++)
+    {
+      guchar *data  = tile_data + i;
+      gint    size  = n_pixels;
+      guchar  val;
+      gint    length;
+      gint    j;
+
+      while (size > 0)
+        {
+          if (xcfdata > xcfdatalimit)
+            return FALSE;
+
+          val = *xcfdata++;
+
+          length = val;
+          if (length >= 128)
+            {
+              length = 255 - (length - 1);
+              if (length == 128)
+                {
+                  if (xcfdata >= xcfdatalimit)
+                    return FALSE;
+
+                  length = (*xcfdata << 8) + xcfdata[1];
+                  xcfdata += 2;
+                }
+
+              size -= length;
+
+              if (size < 0)
+                return FALSE;
+
+              if (&xcfdata[length-1] > xcfdatalimit)
+                return FALSE;
+
+              while (length-- > 0)
+                {
+                  *data = *xcfdata++;
+                  any |= *data;
+                  data += bpp;
+                }
+            }
+          else
+            {
+              length += 1;
+              if (length == 128)
+                {
+                  if (xcfdata >= xcfdatalimit)
+                    return FALSE;
+
+                  length = (*xcfdata << 8) + xcfdata[1];
+                  xcfdata += 2;
+                }
+
+              size -= length;
+
+              if (size < 0)
+                return FALSE;
+
+              if (xcfdata > xcfdatalimit)
+                return FALSE;
+
+              val = *xcfdata++;
+              any |= val;
+
+              for (j = 0; j < length; j++)
+                {
+                  *data = val;
+                  data += bpp;
+                }
+            }
+        }
+    }
+
+  *nonzero = (any != 0);
+
+  return TRUE;
+}
+
+gboolean
+xcf_decode_zlib (const guchar *xcfdata,
+                 gsize         data_length,
+                 guchar       *tile_data,
+                 gint          tile_size)
+{
+  z_stream strm;
+  int      action;
+  int      status;
+
+  strm.next_out  = tile_data;
+  strm.avail_out = tile_size;
+
+  strm.zalloc    = Z_NULL;
+  strm.zfree     = Z_NULL;
+  strm.opaque    = Z_NULL;
+  strm.next_in   = (Bytef *) xcfdata;
+  strm.avail_in  = data_length;
+
+  /* Initialize the stream decompression. */
+  status = inflateInit (&strm);
+  if (status != Z_OK)
+    return FALSE;
+
+  action = Z_NO_FLUSH;
+
+  while (status == Z_OK)
+    {
+      if (strm.avail_in == 0)
+        {
+          action = Z_FINISH;
+        }
+
+      status = inflate (&strm, action);
+
+      if (status == Z_STREAM_END)
+        {
+          /* All the data was successfully decoded. */
+          break;
+        }
+      else if (status == Z_BUF_ERROR)
+        {
+          g_printerr ("xcf: decompressed tile bigger than the expected size.");
+          inflateEnd (&strm);
+          return FALSE;
+        }
+      else if (status != Z_OK)
+        {
+          g_printerr ("xcf: tile decompression failed: %s", zError (status));
+          inflateEnd (&strm);
+          return FALSE;
+        }
+    }
+
+  inflateEnd (&strm);
+
+  return TRUE;
+}
+
+XcfMappedFile *
+xcf_mapped_file_new (const gchar *path)
+{
+#ifndef G_OS_WIN32
+  XcfMappedFile *file;
+  GMappedFile   *mapped_file;
+  gint           fd;
+
+  g_return_val_if_fail (path != NULL, NULL);
+
+  fd = g_open (path, O_RDONLY, 0);
+
+  if (fd < 0)
+    return NULL;
+
+  mapped_file = g_mapped_file_new_from_fd (fd, FALSE, NULL);
+
+  if (! mapped_file)
+    {
+      close (fd);
+
+      return NULL;
+    }
+
+  file = g_new0 (XcfMappedFile, 1);
+
+  file->ref_count   = 1;
+  file->fd          = fd;
+  file->mapped_file = mapped_file;
+
+  return file;
+#else
+  /* a mapped file can't be replaced while it is open on Windows, which
+   * would prevent saving over it, so never map it there.
+   */
+  return NULL;
+#endif
+}
+
+XcfMappedFile *
+xcf_mapped_file_ref (XcfMappedFile *file)
+{
+  g_return_val_if_fail (file != NULL, NULL);
+
+  g_atomic_int_inc (&file->ref_count);
+
+  return file;
+}
+
+void
+xcf_mapped_file_unref (XcfMappedFile *file)
+{
+  g_return_if_fail (file != NULL);
+
+  if (g_atomic_int_dec_and_test (&file->ref_count))
+    {
+      g_mapped_file_unref (file->mapped_file);
+
+#ifndef G_OS_WIN32
+      close (file->fd);
+#endif
+
+      g_free (file);
+    }
+}
+
+/*  returns at most *length bytes of the file's data at offset, and sets
+ *  *length to the number of bytes returned.  the data is read from the
+ *  mapping if the file still holds it.  touching a mapping past the end
+ *  of a file truncated since it was mapped would raise SIGBUS, so the
+ *  data is read from the file into a new *copy, to be freed by the
+ *  caller, otherwise.
+ */
+const guchar *
+xcf_mapped_file_get_data (XcfMappedFile  *file,
+                          goffset         offset,
+                          gsize          *length,
+                          guchar        **copy)
+{
+#ifndef G_OS_WIN32
+  struct stat st;
+  gssize      n_read;
+
+  g_return_val_if_fail (file != NULL, NULL);
+  g_return_val_if_fail (length != NULL, NULL);
+  g_return_val_if_fail (copy != NULL, NULL);
+
+  *copy = NULL;
+
+  if (fstat (file->fd, &st) < 0 || offset < 0 || offset >= st.st_size)
+    return NULL;
+
+  *length = MIN (*length, (guint64) (st.st_size - offset));
+
+  if (offset + *length <= g_mapped_file_get_length (file->mapped_file))
+    {
+      const gchar *contents = g_mapped_file_get_contents (file->mapped_file);
+
+      return (const guchar *) contents + offset;
+    }
+
+  *copy = g_malloc (*length);
+
+  do
+    n_read = pread (file->fd, *copy, *length, offset);
+  while (n_read < 0 && errno == EINTR);
+
+  if (n_read <= 0)
+    {
+      g_clear_pointer (copy, g_free);
+
+      return NULL;
+    }
+
+  *length = n_read;
+
+  return *copy;
+#else
+  return NULL;
+#endif
+}
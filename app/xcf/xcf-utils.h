@@ -18,5 +18,24 @@
 #pragma once
 
 
-gboolean   xcf_data_is_zero (const void *data,
-                             gint        size);
+gboolean   xcf_data_is_zero (const void   *data,
+                             gint          size);
+
+gboolean   xcf_decode_rle   (const guchar *xcfdata,
+                             gsize         data_length,
+                             guchar       *tile_data,
+                             gint          n_pixels,
+                             gint          bpp,
+                             gboolean     *nonzero);
+gboolean   xcf_decode_zlib  (const guchar *xcfdata,
+                             gsize         data_length,
+                             guchar       *tile_data,
+                             gint          tile_size);
+
+XcfMappedFile * xcf_mapped_file_new      (const gchar     *path);
+XcfMappedFile * xcf_mapped_file_ref      (XcfMappedFile   *file);
+void            xcf_mapped_file_unref    (XcfMappedFile   *file);
+const guchar  * xcf_mapped_file_get_data (XcfMappedFile   *file,
+                                          goffset          offset,
+                                          gsize           *length,
+                                          guchar         **copy);
@@ -29,6 +29,8 @@
 
 #include "core/core-types.h"
 
+#include "config/gimpcoreconfig.h"
+
 #include "core/gimp.h"
 #include "core/gimpimage.h"
 #include "core/gimpdrawable.h"
@@ -43,6 +45,7 @@
 #include "xcf-load.h"
 #include "xcf-read.h"
 #include "xcf-save.h"
+#include "xcf-utils.h"
 
 #include "gimp-intl.h"
 
@@ -264,6 +267,17 @@ xcf_load_stream (Gimp          *gimp,
 
   if (success)
     {
+      if (input_file                    &&
+          g_file_is_native (input_file) &&
+          gimp->config->xcf_lazy_loading)
+        {
+          gchar *path = g_file_get_path (input_file);
+
+          info.mapped_file = xcf_mapped_file_new (path);
+
+          g_free (path);
+        }
+
       if (info.file_version >= 0 &&
           info.file_version < G_N_ELEMENTS (xcf_loaders))
         {
@@ -281,6 +295,9 @@ xcf_load_stream (Gimp          *gimp,
                          "encountered"), info.file_version);
           success = FALSE;
         }
+
+      /* drawables loaded lazily keep their own reference */
+      g_clear_pointer (&info.mapped_file, xcf_mapped_file_unref);
     }
 
   if (progress)
@@ -58,10 +58,14 @@
 #endif
 
 #include "gimp.h"
+
+#include "libgimpbase/gimpprotocol.h"
+
 #include "gimp-shm.h"
 
 
-#define TILE_MAP_SIZE     (gimp_tile_width () * gimp_tile_height () * 32)
+#define TILE_MAP_SIZE     (gimp_tile_width () * gimp_tile_height () * 32 * \
+                           GP_TILE_BATCH_SIZE)
 #define ERRMSG_SHM_FAILED "Could not attach to gimp shared memory segment"
 
 
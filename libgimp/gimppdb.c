@@ -30,6 +30,7 @@
 #include "gimppdb_pdb.h"
 #include "gimppdbprocedure.h"
 #include "gimpplugin-private.h"
+#include "gimptilebackendplugin.h"
 
 #include "libgimp-intl.h"
 
@@ -450,6 +451,9 @@ _gimp_pdb_run_procedure_array (GimpPDB              *pdb,
   g_return_val_if_fail (gimp_is_canonical_identifier (procedure_name), NULL);
   g_return_val_if_fail (arguments != NULL, NULL);
 
+  /* the procedure must see the tiles written so far */
+  _gimp_tile_backend_plugin_flush_all ();
+
   proc_run.name     = (gchar *) procedure_name;
   proc_run.n_params = gimp_value_array_length (arguments);
   proc_run.params   = _gimp_value_array_to_gp_params (arguments, FALSE);
@@ -462,6 +466,9 @@ _gimp_pdb_run_procedure_array (GimpPDB              *pdb,
 
   _gimp_plug_in_read_expect_msg (pdb->plug_in, &msg, GP_PROC_RETURN);
 
+  /* the procedure may have changed any drawable */
+  _gimp_tile_backend_plugin_invalidate_read_ahead ();
+
   proc_return = msg.data;
 
   return_values = _gimp_gp_params_to_value_array (NULL,
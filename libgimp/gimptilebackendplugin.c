@@ -42,27 +42,42 @@ typedef struct _GimpTile GimpTile;
 
 struct _GimpTile
 {
-  guint   tile_num; /* the number of this tile within the drawable */
+  guint   tile_num; /* the number of the first tile within the drawable */
+  guint   n_tiles;  /* the number of consecutive tiles, all in one row */
 
-  guint   ewidth;   /* the effective width of the tile */
-  guint   eheight;  /* the effective height of the tile */
+  guint   ewidth;   /* the effective width of the tiles */
+  guint   eheight;  /* the effective height of the tiles */
 
-  guchar *data;     /* the pixel data for the tile */
+  guchar *data;     /* the pixel data for the tiles */
 };
 
 
 struct _GimpTileBackendPluginPrivate
 {
-  gint32   drawable_id;
-  gboolean shadow;
-  gint     width;
-  gint     height;
-  gint     bpp;
-  gint     ntile_rows;
-  gint     ntile_cols;
+  gint32    drawable_id;
+  gboolean  shadow;
+  gint      width;
+  gint      height;
+  gint      bpp;
+  gint      ntile_rows;
+  gint      ntile_cols;
+
+  /* tiles fetched by the last read batch, not yet requested by GEGL */
+  GeglTile *read_ahead[GP_TILE_BATCH_SIZE];
+  guint     read_ahead_first;
+  gint      n_read_ahead;
+  gint      read_ahead_serial;
+  gint      read_batch_size;
+
+  /* tiles written by GEGL, waiting to be sent as a single batch */
+  GeglTile *pending[GP_TILE_BATCH_SIZE];
+  guint     pending_first;
+  gint      n_pending;
 };
 
 
+static void       gimp_tile_backend_plugin_finalize (GObject        *object);
+
 static gpointer   gimp_tile_backend_plugin_command (GeglTileSource  *tile_store,
                                                     GeglTileCommand  command,
                                                     gint             x,
@@ -77,17 +92,29 @@ static gboolean   gimp_tile_write (GimpTileBackendPlugin *backend_plugin,
 static GeglTile * gimp_tile_read  (GimpTileBackendPlugin *backend_plugin,
                                    gint                   x,
                                    gint                   y);
+static void       gimp_tile_flush (GimpTileBackendPlugin *backend_plugin);
+
+static void       gimp_tile_clear_read_ahead
+                                  (GimpTileBackendPlugin *backend_plugin);
 
 static gboolean   gimp_tile_init  (GimpTileBackendPlugin *backend_plugin,
                                    GimpTile              *tile,
                                    gint                   row,
-                                   gint                   col);
+                                   gint                   col,
+                                   gint                   n_tiles);
 static void       gimp_tile_unset (GimpTileBackendPlugin *backend_plugin,
                                    GimpTile              *tile);
 static void       gimp_tile_get   (GimpTileBackendPlugin *backend_plugin,
-                                   GimpTile              *tile);
+                                   GimpTile              *tile,
+                                   GeglTile             **tiles);
 static void       gimp_tile_put   (GimpTileBackendPlugin *backend_plugin,
-                                   GimpTile              *tile);
+                                   GimpTile              *tile,
+                                   GeglTile             **tiles);
+static void       gimp_tile_copy  (GimpTileBackendPlugin *backend_plugin,
+                                   GimpTile              *tile,
+                                   GeglTile             **tiles,
+                                   guchar                *data,
+                                   gboolean               to_tiles);
 
 
 G_DEFINE_TYPE_WITH_PRIVATE (GimpTileBackendPlugin, _gimp_tile_backend_plugin,
@@ -98,10 +125,21 @@ G_DEFINE_TYPE_WITH_PRIVATE (GimpTileBackendPlugin, _gimp_tile_backend_plugin,
 
 static GMutex backend_plugin_mutex;
 
+/* incremented whenever the core may have changed drawables behind our
+ * back, which makes all fetched-ahead tiles outdated.
+ */
+static gint   read_ahead_serial = 0;
+
+/* the backends with written tiles which were not sent yet */
+static GSList *pending_backends  = NULL;
+
 
 static void
 _gimp_tile_backend_plugin_class_init (GimpTileBackendPluginClass *klass)
 {
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = gimp_tile_backend_plugin_finalize;
 }
 
 static void
@@ -111,9 +149,26 @@ _gimp_tile_backend_plugin_init (GimpTileBackendPlugin *backend)
 
   backend->priv = _gimp_tile_backend_plugin_get_instance_private (backend);
 
+  backend->priv->read_batch_size = 1;
+
   source->command = gimp_tile_backend_plugin_command;
 }
 
+static void
+gimp_tile_backend_plugin_finalize (GObject *object)
+{
+  GimpTileBackendPlugin *backend_plugin = GIMP_TILE_BACKEND_PLUGIN (object);
+
+  g_mutex_lock (&backend_plugin_mutex);
+
+  gimp_tile_flush (backend_plugin);
+  gimp_tile_clear_read_ahead (backend_plugin);
+
+  g_mutex_unlock (&backend_plugin_mutex);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
 static gpointer
 gimp_tile_backend_plugin_command (GeglTileSource  *tile_store,
                                   GeglTileCommand  command,
@@ -156,6 +211,11 @@ gimp_tile_backend_plugin_command (GeglTileSource  *tile_store,
       break;
 
     case GEGL_TILE_FLUSH:
+      g_mutex_lock (&backend_plugin_mutex);
+
+      gimp_tile_flush (backend_plugin);
+
+      g_mutex_unlock (&backend_plugin_mutex);
       break;
 
     default:
@@ -202,6 +262,23 @@ _gimp_tile_backend_plugin_new (GimpDrawable *drawable,
   return backend;
 }
 
+void
+_gimp_tile_backend_plugin_invalidate_read_ahead (void)
+{
+  g_atomic_int_inc (&read_ahead_serial);
+}
+
+void
+_gimp_tile_backend_plugin_flush_all (void)
+{
+  g_mutex_lock (&backend_plugin_mutex);
+
+  while (pending_backends)
+    gimp_tile_flush (pending_backends->data);
+
+  g_mutex_unlock (&backend_plugin_mutex);
+}
+
 
 /*  private functions  */
 
@@ -212,41 +289,85 @@ gimp_tile_read (GimpTileBackendPlugin *backend_plugin,
 {
   GimpTileBackendPluginPrivate *priv    = backend_plugin->priv;
   GeglTileBackend              *backend = GEGL_TILE_BACKEND (backend_plugin);
-  GeglTile                     *tile;
+  GeglTile                     *tiles[GP_TILE_BATCH_SIZE];
   GimpTile                      gimp_tile = { 0, };
+  guint                         tile_num;
   gint                          tile_size;
-  guchar                       *tile_data;
+  gint                          n_tiles;
+  gint                          i;
 
-  if (! gimp_tile_init (backend_plugin, &gimp_tile, y, x))
+  if (x < 0 || x >= priv->ntile_cols ||
+      y < 0 || y >= priv->ntile_rows)
     return NULL;
 
-  tile_size  = gegl_tile_backend_get_tile_size (backend);
-  tile       = gegl_tile_new (tile_size);
-  tile_data  = gegl_tile_get_data (tile);
-
-  gimp_tile_get (backend_plugin, &gimp_tile);
+  tile_num = y * priv->ntile_cols + x;
 
-  if (gimp_tile.ewidth * gimp_tile.eheight * priv->bpp == tile_size)
+  /*  tiles which were written but not sent yet are the most recent  */
+  if (priv->n_pending > 0                &&
+      tile_num >= priv->pending_first    &&
+      tile_num <  priv->pending_first + priv->n_pending)
     {
-      memcpy (tile_data, gimp_tile.data, tile_size);
+      return gegl_tile_dup (priv->pending[tile_num - priv->pending_first]);
     }
-  else
+
+  if (priv->read_ahead_serial != g_atomic_int_get (&read_ahead_serial))
+    gimp_tile_clear_read_ahead (backend_plugin);
+
+  if (priv->n_read_ahead > 0                &&
+      tile_num >= priv->read_ahead_first    &&
+      tile_num <  priv->read_ahead_first + priv->n_read_ahead)
     {
-      gint  tile_stride      = TILE_WIDTH * priv->bpp;
-      gint  gimp_tile_stride = gimp_tile.ewidth * priv->bpp;
-      guint row;
+      i = tile_num - priv->read_ahead_first;
 
-      for (row = 0; row < gimp_tile.eheight; row++)
+      if (priv->read_ahead[i])
         {
-          memcpy (tile_data      + row * tile_stride,
-                  gimp_tile.data + row * gimp_tile_stride,
-                  gimp_tile_stride);
+          GeglTile *tile = priv->read_ahead[i];
+
+          priv->read_ahead[i] = NULL;
+
+          return tile;
         }
     }
 
+  /*  when GEGL walks the drawable tile by tile, fetch more and more
+   *  of the following tiles with each request, otherwise fall back to
+   *  a single tile per request.
+   */
+  if (priv->n_read_ahead > 0 &&
+      tile_num == priv->read_ahead_first + priv->n_read_ahead)
+    {
+      priv->read_batch_size = MIN (priv->read_batch_size * 2,
+                                   GP_TILE_BATCH_SIZE);
+    }
+  else
+    {
+      priv->read_batch_size = 1;
+    }
+
+  gimp_tile_clear_read_ahead (backend_plugin);
+
+  n_tiles = MIN (priv->read_batch_size, priv->ntile_cols - x);
+
+  if (! gimp_tile_init (backend_plugin, &gimp_tile, y, x, n_tiles))
+    return NULL;
+
+  tile_size = gegl_tile_backend_get_tile_size (backend);
+
+  for (i = 0; i < n_tiles; i++)
+    tiles[i] = gegl_tile_new (tile_size);
+
+  gimp_tile_get (backend_plugin, &gimp_tile, tiles);
+
+  priv->read_ahead_first  = tile_num;
+  priv->n_read_ahead      = n_tiles;
+  priv->read_ahead_serial = g_atomic_int_get (&read_ahead_serial);
+
+  for (i = 1; i < n_tiles; i++)
+    priv->read_ahead[i] = tiles[i];
+
   gimp_tile_unset (backend_plugin, &gimp_tile);
 
-  return tile;
+  return tiles[0];
 }
 
 static gboolean
@@ -255,66 +376,120 @@ gimp_tile_write (GimpTileBackendPlugin *backend_plugin,
                  gint                   y,
                  GeglTile              *tile)
 {
-  GimpTileBackendPluginPrivate *priv      = backend_plugin->priv;
-  GeglTileBackend              *backend   = GEGL_TILE_BACKEND (backend_plugin);
-  GimpTile                      gimp_tile = { 0, };
-  gint                          tile_size;
-  guchar                       *tile_data;
+  GimpTileBackendPluginPrivate *priv = backend_plugin->priv;
+  guint                         tile_num;
 
-  if (! gimp_tile_init (backend_plugin, &gimp_tile, y, x))
+  if (x < 0 || x >= priv->ntile_cols ||
+      y < 0 || y >= priv->ntile_rows)
     return FALSE;
 
-  tile_size = gegl_tile_backend_get_tile_size (backend);
-  tile_data = gegl_tile_get_data (tile);
+  tile_num = y * priv->ntile_cols + x;
+
+  /*  a fetched-ahead copy of the tile is outdated now  */
+  if (priv->n_read_ahead > 0                &&
+      tile_num >= priv->read_ahead_first    &&
+      tile_num <  priv->read_ahead_first + priv->n_read_ahead)
+    {
+      g_clear_pointer (&priv->read_ahead[tile_num - priv->read_ahead_first],
+                       gegl_tile_unref);
+    }
+
+  if (priv->n_pending > 0                &&
+      tile_num >= priv->pending_first    &&
+      tile_num <  priv->pending_first + priv->n_pending)
+    {
+      GeglTile **pending = &priv->pending[tile_num - priv->pending_first];
+
+      gegl_tile_unref (*pending);
+      *pending = gegl_tile_dup (tile);
 
-  gimp_tile.data = g_new (guchar,
-                          gimp_tile.ewidth * gimp_tile.eheight *
-                          priv->bpp);
+      return TRUE;
+    }
 
-  if (gimp_tile.ewidth * gimp_tile.eheight * priv->bpp == tile_size)
+  /*  tiles are sent in runs of consecutive tiles of the same row  */
+  if (priv->n_pending > 0                                     &&
+      (tile_num != priv->pending_first + priv->n_pending      ||
+       priv->pending_first / priv->ntile_cols != (guint) y    ||
+       priv->n_pending == GP_TILE_BATCH_SIZE))
     {
-      memcpy (gimp_tile.data, tile_data, tile_size);
+      gimp_tile_flush (backend_plugin);
     }
-  else
+
+  if (priv->n_pending == 0)
     {
-      gint  tile_stride      = TILE_WIDTH * priv->bpp;
-      gint  gimp_tile_stride = gimp_tile.ewidth * priv->bpp;
-      guint row;
+      priv->pending_first = tile_num;
 
-      for (row = 0; row < gimp_tile.eheight; row++)
-        {
-          memcpy (gimp_tile.data + row * gimp_tile_stride,
-                  tile_data      + row * tile_stride,
-                  gimp_tile_stride);
-        }
+      pending_backends = g_slist_prepend (pending_backends, backend_plugin);
     }
 
-  gimp_tile_put (backend_plugin, &gimp_tile);
-  gimp_tile_unset (backend_plugin, &gimp_tile);
+  priv->pending[priv->n_pending++] = gegl_tile_dup (tile);
 
   return TRUE;
 }
 
+static void
+gimp_tile_flush (GimpTileBackendPlugin *backend_plugin)
+{
+  GimpTileBackendPluginPrivate *priv      = backend_plugin->priv;
+  GimpTile                      gimp_tile = { 0, };
+  gint                          i;
+
+  if (priv->n_pending == 0)
+    return;
+
+  if (gimp_tile_init (backend_plugin, &gimp_tile,
+                      priv->pending_first / priv->ntile_cols,
+                      priv->pending_first % priv->ntile_cols,
+                      priv->n_pending))
+    {
+      gimp_tile_put (backend_plugin, &gimp_tile, priv->pending);
+      gimp_tile_unset (backend_plugin, &gimp_tile);
+    }
+
+  for (i = 0; i < priv->n_pending; i++)
+    g_clear_pointer (&priv->pending[i], gegl_tile_unref);
+
+  priv->n_pending = 0;
+
+  pending_backends = g_slist_remove (pending_backends, backend_plugin);
+}
+
+static void
+gimp_tile_clear_read_ahead (GimpTileBackendPlugin *backend_plugin)
+{
+  GimpTileBackendPluginPrivate *priv = backend_plugin->priv;
+  gint                          i;
+
+  for (i = 0; i < priv->n_read_ahead; i++)
+    g_clear_pointer (&priv->read_ahead[i], gegl_tile_unref);
+
+  priv->n_read_ahead = 0;
+}
+
 static gboolean
 gimp_tile_init (GimpTileBackendPlugin *backend_plugin,
                 GimpTile              *tile,
                 gint                   row,
-                gint                   col)
+                gint                   col,
+                gint                   n_tiles)
 {
   GimpTileBackendPluginPrivate *priv = backend_plugin->priv;
 
-  if (row > priv->ntile_rows - 1 ||
-      col > priv->ntile_cols - 1)
+  if (row > priv->ntile_rows - 1          ||
+      col + n_tiles > priv->ntile_cols    ||
+      n_tiles < 1                         ||
+      n_tiles > GP_TILE_BATCH_SIZE)
     {
       return FALSE;
     }
 
   tile->tile_num = row * priv->ntile_cols + col;
+  tile->n_tiles  = n_tiles;
 
-  if (col == (priv->ntile_cols - 1))
-    tile->ewidth  = priv->width  - ((priv->ntile_cols - 1) * TILE_WIDTH);
+  if (col + n_tiles == priv->ntile_cols)
+    tile->ewidth  = priv->width  - (col * TILE_WIDTH);
   else
-    tile->ewidth  = TILE_WIDTH;
+    tile->ewidth  = n_tiles * TILE_WIDTH;
 
   if (row == (priv->ntile_rows - 1))
     tile->eheight = priv->height - ((priv->ntile_rows - 1) * TILE_HEIGHT);
@@ -335,7 +510,8 @@ gimp_tile_unset (GimpTileBackendPlugin *backend_plugin,
 
 static void
 gimp_tile_get (GimpTileBackendPlugin *backend_plugin,
-               GimpTile              *tile)
+               GimpTile              *tile,
+               GeglTile             **tiles)
 {
   GimpTileBackendPluginPrivate *priv    = backend_plugin->priv;
   GimpPlugIn                   *plug_in = gimp_get_plug_in ();
@@ -346,6 +522,7 @@ gimp_tile_get (GimpTileBackendPlugin *backend_plugin,
   tile_req.drawable_id = priv->drawable_id;
   tile_req.tile_num    = tile->tile_num;
   tile_req.shadow      = priv->shadow;
+  tile_req.n_tiles     = tile->n_tiles;
 
   if (! gp_tile_req_write (_gimp_plug_in_get_write_channel (plug_in),
                            &tile_req, plug_in))
@@ -356,22 +533,25 @@ gimp_tile_get (GimpTileBackendPlugin *backend_plugin,
   tile_data = msg.data;
   if (tile_data->drawable_id != priv->drawable_id ||
       tile_data->tile_num    != tile->tile_num    ||
+      tile_data->n_tiles     != tile->n_tiles     ||
       tile_data->shadow      != priv->shadow      ||
       tile_data->width       != tile->ewidth      ||
       tile_data->height      != tile->eheight     ||
       tile_data->bpp         != priv->bpp)
     {
 #if 0
-      g_printerr ("tile_data: %d %d %d %d %d %d\n"
-                  "tile:      %d %d %d %d %d %d\n",
+      g_printerr ("tile_data: %d %d %d %d %d %d %d\n"
+                  "tile:      %d %d %d %d %d %d %d\n",
                   tile_data->drawable_id,
                   tile_data->tile_num,
+                  tile_data->n_tiles,
                   tile_data->shadow,
                   tile_data->width,
                   tile_data->height,
                   tile_data->bpp,
                   priv->drawable_id,
                   tile->tile_num,
+                  tile->n_tiles,
                   priv->shadow,
                   tile->ewidth,
                   tile->eheight,
@@ -381,16 +561,12 @@ gimp_tile_get (GimpTileBackendPlugin *backend_plugin,
       _gimp_quit ();
     }
 
-  if (tile_data->use_shm)
-    {
-      tile->data = g_memdup2 (_gimp_shm_addr (),
-                              tile->ewidth * tile->eheight * priv->bpp);
-    }
-  else
-    {
-      tile->data = tile_data->data;
-      tile_data->data = NULL;
-    }
+  /*  copy the pixels straight from the shared memory into the GEGL
+   *  tiles, the segment is only ours until we acknowledge the data.
+   */
+  gimp_tile_copy (backend_plugin, tile, tiles,
+                  tile_data->use_shm ? _gimp_shm_addr () : tile_data->data,
+                  TRUE);
 
   if (! gp_tile_ack_write (_gimp_plug_in_get_write_channel (plug_in),
                            plug_in))
@@ -401,7 +577,8 @@ gimp_tile_get (GimpTileBackendPlugin *backend_plugin,
 
 static void
 gimp_tile_put (GimpTileBackendPlugin *backend_plugin,
-               GimpTile              *tile)
+               GimpTile              *tile,
+               GeglTile             **tiles)
 {
   GimpTileBackendPluginPrivate *priv    = backend_plugin->priv;
   GimpPlugIn                   *plug_in = gimp_get_plug_in ();
@@ -413,6 +590,7 @@ gimp_tile_put (GimpTileBackendPlugin *backend_plugin,
   tile_req.drawable_id = -1;
   tile_req.tile_num    = 0;
   tile_req.shadow      = 0;
+  tile_req.n_tiles     = 0;
 
   if (! gp_tile_req_write (_gimp_plug_in_get_write_channel (plug_in),
                            &tile_req, plug_in))
@@ -429,16 +607,19 @@ gimp_tile_put (GimpTileBackendPlugin *backend_plugin,
   tile_data.width       = tile->ewidth;
   tile_data.height      = tile->eheight;
   tile_data.use_shm     = tile_info->use_shm;
+  tile_data.n_tiles     = tile->n_tiles;
   tile_data.data        = NULL;
 
   if (tile_info->use_shm)
     {
-      memcpy (_gimp_shm_addr (),
-              tile->data,
-              tile->ewidth * tile->eheight * priv->bpp);
+      gimp_tile_copy (backend_plugin, tile, tiles, _gimp_shm_addr (), FALSE);
     }
   else
     {
+      tile->data = g_malloc (tile->ewidth * tile->eheight * priv->bpp);
+
+      gimp_tile_copy (backend_plugin, tile, tiles, tile->data, FALSE);
+
       tile_data.data = tile->data;
     }
 
@@ -455,3 +636,38 @@ gimp_tile_put (GimpTileBackendPlugin *backend_plugin,
 
   gimp_wire_destroy (&msg);
 }
+
+static void
+gimp_tile_copy (GimpTileBackendPlugin *backend_plugin,
+                GimpTile              *tile,
+                GeglTile             **tiles,
+                guchar                *data,
+                gboolean               to_tiles)
+{
+  GimpTileBackendPluginPrivate *priv        = backend_plugin->priv;
+  gint                          tile_stride = TILE_WIDTH * priv->bpp;
+  gint                          data_stride = tile->ewidth * priv->bpp;
+  guint                         i;
+
+  /*  the data is a single rectangle covering all the tiles  */
+  for (i = 0; i < tile->n_tiles; i++)
+    {
+      guchar *tile_data = gegl_tile_get_data (tiles[i]);
+      guchar *rect_data = data + i * tile_stride;
+      gint    width     = MIN (TILE_WIDTH, tile->ewidth - i * TILE_WIDTH);
+      gint    row_size  = width * priv->bpp;
+      guint   row;
+
+      for (row = 0; row < tile->eheight; row++)
+        {
+          if (to_tiles)
+            memcpy (tile_data + row * tile_stride,
+                    rect_data + row * data_stride,
+                    row_size);
+          else
+            memcpy (rect_data + row * data_stride,
+                    tile_data + row * tile_stride,
+                    row_size);
+        }
+    }
+}
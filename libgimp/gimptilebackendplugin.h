@@ -55,6 +55,9 @@ GType             _gimp_tile_backend_plugin_get_type (void);
 GeglTileBackend * _gimp_tile_backend_plugin_new      (GimpDrawable *drawable,
                                                       gint          shadow);
 
+void              _gimp_tile_backend_plugin_invalidate_read_ahead (void);
+void              _gimp_tile_backend_plugin_flush_all             (void);
+
 G_END_DECLS
 
 #endif /* __GIMP_TILE_BACKEND_PLUGIN_H__ */
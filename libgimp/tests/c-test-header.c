@@ -74,6 +74,8 @@ static GimpValueArray * gimp_c_test_run              (GimpProcedure        *proc
                                                       GimpProcedureConfig  *config,
                                                       gpointer              run_data);
 
+static void             gimp_c_test_init_perf        (void);
+
 
 G_DEFINE_TYPE (GimpCTest, gimp_c_test, GIMP_TYPE_PLUG_IN)
 
@@ -87,6 +89,9 @@ gimp_c_test_class_init (GimpCTestClass *klass)
 
   plug_in_class->query_procedures = gimp_c_test_query_procedures;
   plug_in_class->create_procedure = gimp_c_test_create_procedure;
+
+  if (g_getenv ("GIMP_TESTING_PERF"))
+    gimp_c_test_init_perf ();
 }
 
 static void
@@ -130,3 +135,22 @@ gimp_c_test_create_procedure (GimpPlugIn  *plug_in,
 
   return procedure;
 }
+
+/* Benchmarks only run in GLib's perf mode, which the test runner turns on
+ * by setting GIMP_TESTING_PERF (see "meson test --benchmark").  Tests
+ * check g_test_perf(), and report with g_test_minimized_result() and
+ * g_test_message().  GLib's testing framework makes warnings fatal, which
+ * the plug-in keeps as they were.
+ */
+static void
+gimp_c_test_init_perf (void)
+{
+  gchar          *args[] = { "gimp-c-test", "-m", "perf", NULL };
+  gchar         **argv   = args;
+  gint            argc   = G_N_ELEMENTS (args) - 1;
+  GLogLevelFlags  fatal_mask;
+
+  fatal_mask = g_log_set_always_fatal (G_LOG_FATAL_MASK);
+  g_test_init (&argc, &argv, NULL);
+  g_log_set_always_fatal (fatal_mask);
+}
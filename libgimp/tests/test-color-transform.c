@@ -0,0 +1,153 @@
+/* Big enough for the transform to be split into many bands and areas,
+ * and for the throughput to mean something.
+ */
+#define TRANSFORM_IMAGE_WIDTH  4096
+#define TRANSFORM_IMAGE_HEIGHT 4096
+
+
+static void
+fill_noise (guchar *data,
+            gsize   size)
+{
+  guint32 state = 1;
+  gsize   i;
+
+  for (i = 0; i < size; i++)
+    {
+      state = state * 1664525 + 1013904223;
+
+      data[i] = state >> 24;
+    }
+}
+
+/* Transforms data with gimp_color_transform_process_buffer(), timing
+ * it in perf mode, and compares the result to that of
+ * gimp_color_transform_process_pixels(), which runs on a single thread.
+ */
+static gboolean
+transform_and_compare (GimpColorTransform *transform,
+                       const guchar       *data,
+                       guchar             *result,
+                       guchar             *ref,
+                       const gchar        *name)
+{
+  const Babl *format = babl_format ("R'G'B'A u8");
+  GeglBuffer *src_buffer;
+  GeglBuffer *dest_buffer;
+  gdouble     elapsed;
+  gsize       size;
+
+  if (! transform)
+    return FALSE;
+
+  size = (gsize) TRANSFORM_IMAGE_WIDTH * TRANSFORM_IMAGE_HEIGHT * 4;
+
+  src_buffer  = gegl_buffer_linear_new_from_data ((gpointer) data, format,
+                                                  GEGL_RECTANGLE (0, 0,
+                                                                  TRANSFORM_IMAGE_WIDTH,
+                                                                  TRANSFORM_IMAGE_HEIGHT),
+                                                  GEGL_AUTO_ROWSTRIDE,
+                                                  NULL, NULL);
+  dest_buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0,
+                                                 TRANSFORM_IMAGE_WIDTH,
+                                                 TRANSFORM_IMAGE_HEIGHT),
+                                 format);
+
+  g_test_timer_start ();
+
+  gimp_color_transform_process_buffer (transform,
+                                       src_buffer,  NULL,
+                                       dest_buffer, NULL);
+
+  elapsed = g_test_timer_elapsed ();
+
+  if (g_test_perf ())
+    {
+      g_test_minimized_result (elapsed, "transforming %dx%d, %s: %g s",
+                               TRANSFORM_IMAGE_WIDTH, TRANSFORM_IMAGE_HEIGHT,
+                               name, elapsed);
+      g_test_message ("%s: %.1f Mpx/s",
+                      name,
+                      TRANSFORM_IMAGE_WIDTH * TRANSFORM_IMAGE_HEIGHT /
+                      MAX (elapsed, 1e-6) / 1e6);
+    }
+
+  gegl_buffer_get (dest_buffer, NULL, 1.0, format, result,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  g_object_unref (src_buffer);
+  g_object_unref (dest_buffer);
+
+  gimp_color_transform_process_pixels (transform,
+                                       format, data,
+                                       format, ref,
+                                       (gsize) TRANSFORM_IMAGE_WIDTH *
+                                       TRANSFORM_IMAGE_HEIGHT);
+
+  g_object_unref (transform);
+
+  return memcmp (result, ref, size) == 0;
+}
+
+static GimpValueArray *
+gimp_c_test_run (GimpProcedure        *procedure,
+                 GimpRunMode           run_mode,
+                 GimpImage            *image,
+                 GimpDrawable        **drawables,
+                 GimpProcedureConfig  *config,
+                 gpointer              run_data)
+{
+  const Babl       *format = babl_format ("R'G'B'A u8");
+  GimpColorProfile *srgb;
+  GimpColorProfile *srgb_linear;
+  GimpColorProfile *adobe;
+  GimpColorProfile *gray;
+  gsize             size;
+  guchar           *data;
+  guchar           *result;
+  guchar           *ref;
+
+  size   = (gsize) TRANSFORM_IMAGE_WIDTH * TRANSFORM_IMAGE_HEIGHT * 4;
+  data   = g_malloc (size);
+  result = g_malloc (size);
+  ref    = g_malloc (size);
+
+  fill_noise (data, size);
+
+  srgb        = gimp_color_profile_new_rgb_srgb ();
+  srgb_linear = gimp_color_profile_new_rgb_srgb_linear ();
+  adobe       = gimp_color_profile_new_rgb_adobe ();
+  gray        = gimp_color_profile_new_d50_gray_lab_trc ();
+
+  GIMP_TEST_START("sRGB -> linear sRGB");
+  GIMP_TEST_END(transform_and_compare (
+    gimp_color_transform_new (srgb, format, srgb_linear, format,
+                              GIMP_COLOR_RENDERING_INTENT_PERCEPTUAL, 0),
+    data, result, ref, "sRGB -> linear sRGB"));
+
+  GIMP_TEST_START("sRGB -> Adobe RGB");
+  GIMP_TEST_END(transform_and_compare (
+    gimp_color_transform_new (srgb, format, adobe, format,
+                              GIMP_COLOR_RENDERING_INTENT_RELATIVE_COLORIMETRIC,
+                              GIMP_COLOR_TRANSFORM_FLAGS_BLACK_POINT_COMPENSATION),
+    data, result, ref, "sRGB -> Adobe RGB"));
+
+  GIMP_TEST_START("sRGB -> Adobe RGB, proofing gray");
+  GIMP_TEST_END(transform_and_compare (
+    gimp_color_transform_new_proofing (srgb, format, adobe, format, gray,
+                                       GIMP_COLOR_RENDERING_INTENT_PERCEPTUAL,
+                                       GIMP_COLOR_RENDERING_INTENT_RELATIVE_COLORIMETRIC,
+                                       0),
+    data, result, ref, "sRGB -> Adobe RGB, proofing gray"));
+
+  g_object_unref (srgb);
+  g_object_unref (srgb_linear);
+  g_object_unref (adobe);
+  g_object_unref (gray);
+
+  g_free (data);
+  g_free (result);
+  g_free (ref);
+
+  GIMP_TEST_RETURN
+}
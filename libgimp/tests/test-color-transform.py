@@ -0,0 +1,36 @@
+#!/usr/bin/env python3
+
+TRANSFORM_IMAGE_WIDTH=300
+TRANSFORM_IMAGE_HEIGHT=200
+
+image = Gimp.Image.new(TRANSFORM_IMAGE_WIDTH, TRANSFORM_IMAGE_HEIGHT, Gimp.ImageBaseType.RGB)
+layer = Gimp.Layer.new(image, "white", TRANSFORM_IMAGE_WIDTH, TRANSFORM_IMAGE_HEIGHT,
+                       Gimp.ImageType.RGB_IMAGE, 100.0,
+                       Gimp.LayerMode.NORMAL)
+gimp_assert('Gimp.Image.insert_layer()', image.insert_layer(layer, None, 0))
+
+layer.fill(Gimp.FillType.WHITE)
+
+srgb   = Gimp.ColorProfile.new_rgb_srgb()
+linear = Gimp.ColorProfile.new_rgb_srgb_linear()
+format = Babl.format("R'G'B' u8")
+
+transform = Gimp.ColorTransform.new(srgb, format, linear, format,
+                                    Gimp.ColorRenderingIntent.PERCEPTUAL, 0)
+gimp_assert('Gimp.ColorTransform.new()', transform is not None)
+
+progress = []
+transform.connect('progress', lambda transform, value: progress.append(value))
+
+# Transform the layer in place; white is white in any RGB profile.
+buffer = layer.get_buffer()
+transform.process_buffer(buffer, buffer.get_extent(), buffer, buffer.get_extent())
+
+gimp_assert('progress is reported up to completion',
+            len(progress) > 0 and progress[-1] == 1.0 and progress == sorted(progress))
+
+data = buffer.get(buffer.get_extent(), 1.0, "R'G'B' u8", Gegl.AbyssPolicy.NONE)
+gimp_assert('white is unchanged',
+            bytes(data) == b'\xff' * (TRANSFORM_IMAGE_WIDTH * TRANSFORM_IMAGE_HEIGHT * 3))
+
+image.delete()
@@ -0,0 +1,534 @@
+/* Big enough for the histogram and the dithering to be split into many
+ * chunks and batches, and for the timings to mean something.
+ */
+#define CONVERT_IMAGE_WIDTH  2048
+#define CONVERT_IMAGE_HEIGHT 2048
+#define CONVERT_N_LAYERS     3
+
+/* Fewer than the maximum number of colors, so that no quantization is
+ * needed.
+ */
+#define CONVERT_N_COLORS     37
+
+/* The custom palette holds each combination of these channel values.
+ * They are far enough apart for the nearest entry to any pixel within
+ * CONVERT_NOISE of one of them to be that entry, whatever the metric.
+ */
+#define CONVERT_N_LEVELS     3
+#define CONVERT_N_ENTRIES    (CONVERT_N_LEVELS * CONVERT_N_LEVELS * CONVERT_N_LEVELS)
+#define CONVERT_NOISE        6
+
+static const guchar levels[CONVERT_N_LEVELS] = { 0, 128, 255 };
+
+
+/* Fills data with either blocks of CONVERT_N_COLORS distinct colors, or
+ * a gradient with noise, which has many more colors than a palette can
+ * hold.
+ */
+static void
+fill_pattern (guchar   *data,
+              gint      width,
+              gint      height,
+              gint      seed,
+              gboolean  noise)
+{
+  guint32 state = seed;
+  gint    x, y;
+
+  for (y = 0; y < height; y++)
+    for (x = 0; x < width; x++)
+      {
+        guchar *pixel = data + ((gsize) y * width + x) * 3;
+
+        state = state * 1664525 + 1013904223;
+
+        if (noise)
+          {
+            pixel[0] = CLAMP (x * 256 / width  + (gint) (state >> 27) - 16, 0, 255);
+            pixel[1] = CLAMP (y * 256 / height + (gint) ((state >> 22) & 31) - 16, 0, 255);
+            pixel[2] = (state >> 8) & 255;
+          }
+        else
+          {
+            pattern_color (((x / 61) * 7 + (y / 67) * 3 + seed) %
+                           CONVERT_N_COLORS,
+                           pixel);
+          }
+      }
+}
+
+static void
+pattern_color (gint    color,
+               guchar *pixel)
+{
+  pixel[0] = color * 255 / (CONVERT_N_COLORS - 1);
+  pixel[1] = 255 - color * 5;
+  pixel[2] = (color * 97) & 255;
+}
+
+static void
+entry_color (gint    entry,
+             guchar *pixel)
+{
+  pixel[0] = levels[entry / (CONVERT_N_LEVELS * CONVERT_N_LEVELS)];
+  pixel[1] = levels[entry / CONVERT_N_LEVELS % CONVERT_N_LEVELS];
+  pixel[2] = levels[entry % CONVERT_N_LEVELS];
+}
+
+/* Fills data with blocks of the custom palette's entries, each pixel
+ * off by up to noise in each channel, and indices with the entry of
+ * each pixel.
+ */
+static void
+fill_entries (guchar *data,
+              guchar *indices,
+              gint    width,
+              gint    height,
+              gint    noise)
+{
+  guint32 state = 1;
+  gint    x, y;
+
+  for (y = 0; y < height; y++)
+    for (x = 0; x < width; x++)
+      {
+        gsize   i     = (gsize) y * width + x;
+        guchar *pixel = data + i * 3;
+        gint    c;
+
+        indices[i] = ((x / 29) * 5 + (y / 31) * 11) % CONVERT_N_ENTRIES;
+
+        entry_color (indices[i], pixel);
+
+        for (c = 0; c < 3; c++)
+          {
+            state = state * 1664525 + 1013904223;
+
+            pixel[c] = CLAMP ((gint) pixel[c] +
+                              (gint) ((state >> 24) % (2 * noise + 1)) - noise,
+                              0, 255);
+          }
+      }
+}
+
+static GimpImage *
+create_image (guchar   *data,
+              gboolean  noise)
+{
+  GimpImage *image;
+  gint       i;
+
+  image = gimp_image_new (CONVERT_IMAGE_WIDTH, CONVERT_IMAGE_HEIGHT,
+                          GIMP_RGB);
+
+  for (i = 0; i < CONVERT_N_LAYERS; i++)
+    {
+      GimpLayer  *layer;
+      GeglBuffer *buffer;
+
+      layer = gimp_layer_new (image, "pattern",
+                              CONVERT_IMAGE_WIDTH, CONVERT_IMAGE_HEIGHT,
+                              GIMP_RGB_IMAGE, 100.0, GIMP_LAYER_MODE_NORMAL);
+      gimp_image_insert_layer (image, layer, NULL, 0);
+
+      fill_pattern (data, CONVERT_IMAGE_WIDTH, CONVERT_IMAGE_HEIGHT,
+                    i + 1, noise);
+
+      buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (layer));
+      gegl_buffer_set (buffer,
+                       GEGL_RECTANGLE (0, 0,
+                                       CONVERT_IMAGE_WIDTH,
+                                       CONVERT_IMAGE_HEIGHT),
+                       0, babl_format ("R'G'B' u8"), data,
+                       GEGL_AUTO_ROWSTRIDE);
+      g_object_unref (buffer);
+    }
+
+  return image;
+}
+
+static GimpImage *
+create_entries_image (guchar *data,
+                      guchar *indices,
+                      gint    noise)
+{
+  GimpImage  *image;
+  GimpLayer  *layer;
+  GeglBuffer *buffer;
+
+  image = gimp_image_new (CONVERT_IMAGE_WIDTH, CONVERT_IMAGE_HEIGHT,
+                          GIMP_RGB);
+  layer = gimp_layer_new (image, "entries",
+                          CONVERT_IMAGE_WIDTH, CONVERT_IMAGE_HEIGHT,
+                          GIMP_RGB_IMAGE, 100.0, GIMP_LAYER_MODE_NORMAL);
+  gimp_image_insert_layer (image, layer, NULL, 0);
+
+  fill_entries (data, indices, CONVERT_IMAGE_WIDTH, CONVERT_IMAGE_HEIGHT,
+                noise);
+
+  buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (layer));
+  gegl_buffer_set (buffer,
+                   GEGL_RECTANGLE (0, 0,
+                                   CONVERT_IMAGE_WIDTH, CONVERT_IMAGE_HEIGHT),
+                   0, babl_format ("R'G'B' u8"), data,
+                   GEGL_AUTO_ROWSTRIDE);
+  g_object_unref (buffer);
+
+  return image;
+}
+
+static GimpPalette *
+create_palette (void)
+{
+  GimpPalette *palette = gimp_palette_new ("test-convert-indexed");
+  gint         i;
+
+  for (i = 0; i < CONVERT_N_ENTRIES; i++)
+    {
+      GeglColor *color = gegl_color_new (NULL);
+      guchar     pixel[3];
+      gint       entry_num;
+
+      entry_color (i, pixel);
+      gegl_color_set_pixel (color, babl_format ("R'G'B' u8"), pixel);
+
+      gimp_palette_add_entry (palette, NULL, color, &entry_num);
+
+      g_object_unref (color);
+    }
+
+  return palette;
+}
+
+/* Converts image, reporting the time it took in perf mode.
+ */
+static gboolean
+convert_image_full (GimpImage              *image,
+                    GimpConvertDitherType   dither_type,
+                    GimpConvertPaletteType  palette_type,
+                    const gchar            *palette,
+                    const gchar            *what)
+{
+  gboolean success;
+  gdouble  elapsed;
+
+  g_test_timer_start ();
+
+  success = gimp_image_convert_indexed (image, dither_type, palette_type,
+                                        256, FALSE, FALSE, palette);
+
+  elapsed = g_test_timer_elapsed ();
+
+  if (g_test_perf ())
+    g_test_minimized_result (elapsed, "converting %dx%d, %s: %g s",
+                             CONVERT_IMAGE_WIDTH, CONVERT_IMAGE_HEIGHT,
+                             what, elapsed);
+
+  return success;
+}
+
+static gboolean
+convert_image (GimpImage             *image,
+               GimpConvertDitherType  dither_type,
+               const gchar           *what)
+{
+  return convert_image_full (image, dither_type,
+                             GIMP_CONVERT_PALETTE_GENERATE, "", what);
+}
+
+static gboolean
+convert_image_custom (GimpImage             *image,
+                      GimpConvertDitherType  dither_type,
+                      GimpPalette           *palette,
+                      const gchar           *what)
+{
+  gchar    *name = gimp_resource_get_name (GIMP_RESOURCE (palette));
+  gboolean  success;
+
+  success = convert_image_full (image, dither_type,
+                                GIMP_CONVERT_PALETTE_CUSTOM, name, what);
+  g_free (name);
+
+  return success;
+}
+
+static guint8 *
+get_colormap (GimpImage *image,
+              gint      *n_colors)
+{
+  return gimp_palette_get_colormap (gimp_image_get_palette (image),
+                                    babl_format ("R'G'B' u8"),
+                                    n_colors, NULL);
+}
+
+/* Whether the colormap holds exactly the CONVERT_N_COLORS colors of the
+ * pattern, in any order.
+ */
+static gboolean
+colormap_is_pattern (const guint8 *colormap,
+                     gint          n_colors)
+{
+  gint color;
+
+  if (n_colors != CONVERT_N_COLORS)
+    return FALSE;
+
+  for (color = 0; color < CONVERT_N_COLORS; color++)
+    {
+      guchar pixel[3];
+      gint   i;
+
+      pattern_color (color, pixel);
+
+      for (i = 0; i < n_colors; i++)
+        {
+          if (! memcmp (colormap + i * 3, pixel, 3))
+            break;
+        }
+
+      if (i == n_colors)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+/* Whether the colormap is the custom palette, in order.
+ */
+static gboolean
+colormap_is_palette (const guint8 *colormap,
+                     gint          n_colors)
+{
+  gint i;
+
+  if (n_colors != CONVERT_N_ENTRIES)
+    return FALSE;
+
+  for (i = 0; i < CONVERT_N_ENTRIES; i++)
+    {
+      guchar pixel[3];
+
+      entry_color (i, pixel);
+
+      if (memcmp (colormap + i * 3, pixel, 3))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+/* Whether the indices of the image's only layer are the expected ones.
+ */
+static gboolean
+compare_indices (GimpImage    *image,
+                 const guchar *indices,
+                 guchar       *data)
+{
+  GimpLayer  **layers = gimp_image_get_layers (image);
+  GeglBuffer  *buffer;
+  const Babl  *format;
+  gboolean     equal;
+
+  buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (layers[0]));
+  format = gimp_drawable_get_format (GIMP_DRAWABLE (layers[0]));
+
+  /* Without alpha, the indexed format is the index itself. */
+  gegl_buffer_get (buffer,
+                   GEGL_RECTANGLE (0, 0,
+                                   CONVERT_IMAGE_WIDTH, CONVERT_IMAGE_HEIGHT),
+                   1.0, format, data,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  equal = (babl_format_get_bytes_per_pixel (format) == 1 &&
+           memcmp (data, indices,
+                   (gsize) CONVERT_IMAGE_WIDTH * CONVERT_IMAGE_HEIGHT) == 0);
+
+  g_object_unref (buffer);
+  g_free (layers);
+
+  return equal;
+}
+
+/* Whether all the layers of both images have the same pixels.
+ */
+static gboolean
+compare_images (GimpImage *image1,
+                GimpImage *image2)
+{
+  GList    *layers1 = gimp_image_list_layers (image1);
+  GList    *layers2 = gimp_image_list_layers (image2);
+  GList    *iter1;
+  GList    *iter2;
+  gsize     size;
+  guchar   *data1;
+  guchar   *data2;
+  gboolean  equal   = TRUE;
+
+  size  = (gsize) CONVERT_IMAGE_WIDTH * CONVERT_IMAGE_HEIGHT * 3;
+  data1 = g_malloc (size);
+  data2 = g_malloc (size);
+
+  for (iter1 = layers1, iter2 = layers2;
+       equal && iter1 && iter2;
+       iter1 = g_list_next (iter1), iter2 = g_list_next (iter2))
+    {
+      GeglBuffer *buffer1 = gimp_drawable_get_buffer (iter1->data);
+      GeglBuffer *buffer2 = gimp_drawable_get_buffer (iter2->data);
+
+      gegl_buffer_get (buffer1,
+                       GEGL_RECTANGLE (0, 0,
+                                       CONVERT_IMAGE_WIDTH,
+                                       CONVERT_IMAGE_HEIGHT),
+                       1.0, babl_format ("R'G'B' u8"), data1,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+      gegl_buffer_get (buffer2,
+                       GEGL_RECTANGLE (0, 0,
+                                       CONVERT_IMAGE_WIDTH,
+                                       CONVERT_IMAGE_HEIGHT),
+                       1.0, babl_format ("R'G'B' u8"), data2,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+      equal = memcmp (data1, data2, size) == 0;
+
+      g_object_unref (buffer1);
+      g_object_unref (buffer2);
+    }
+
+  g_list_free (layers1);
+  g_list_free (layers2);
+
+  g_free (data1);
+  g_free (data2);
+
+  return equal;
+}
+
+static GimpValueArray *
+gimp_c_test_run (GimpProcedure        *procedure,
+                 GimpRunMode           run_mode,
+                 GimpImage            *image,
+                 GimpDrawable        **drawables,
+                 GimpProcedureConfig  *config,
+                 gpointer              run_data)
+{
+  GimpImage   *new_image;
+  GimpImage   *dup_image;
+  GimpPalette *palette;
+  guchar      *data;
+  guchar      *indices;
+  guint8      *colormap1;
+  guint8      *colormap2;
+  gint         n_colors1;
+  gint         n_colors2;
+
+  data    = g_malloc ((gsize) CONVERT_IMAGE_WIDTH * CONVERT_IMAGE_HEIGHT * 3);
+  indices = g_malloc ((gsize) CONVERT_IMAGE_WIDTH * CONVERT_IMAGE_HEIGHT);
+
+  /* An image with few colors is converted losslessly. */
+  new_image = create_image (data, FALSE);
+  dup_image = gimp_image_duplicate (new_image);
+
+  GIMP_TEST_START("gimp_image_convert_indexed() with few colors");
+  GIMP_TEST_END(convert_image (new_image, GIMP_CONVERT_DITHER_FS,
+                               "few colors"));
+
+  colormap1 = get_colormap (new_image, &n_colors1);
+
+  GIMP_TEST_START("palette holds exactly the image's colors");
+  GIMP_TEST_END(colormap_is_pattern (colormap1, n_colors1));
+  g_free (colormap1);
+
+  GIMP_TEST_START("conversion is lossless");
+  GIMP_TEST_END(gimp_image_convert_rgb (new_image) &&
+                compare_images (new_image, dup_image));
+
+  gimp_image_delete (new_image);
+  gimp_image_delete (dup_image);
+
+  /* An image with many colors is quantized and dithered, the same way
+   * each time.
+   */
+  new_image = create_image (data, TRUE);
+  dup_image = gimp_image_duplicate (new_image);
+
+  GIMP_TEST_START("gimp_image_convert_indexed() with Floyd-Steinberg dithering");
+  GIMP_TEST_END(convert_image (new_image, GIMP_CONVERT_DITHER_FS,
+                               "Floyd-Steinberg dithering"));
+
+  GIMP_TEST_START("gimp_image_convert_indexed() again");
+  GIMP_TEST_END(convert_image (dup_image, GIMP_CONVERT_DITHER_FS,
+                               "Floyd-Steinberg dithering, again"));
+
+  colormap1 = get_colormap (new_image, &n_colors1);
+  colormap2 = get_colormap (dup_image, &n_colors2);
+
+  GIMP_TEST_START("palettes are identical");
+  GIMP_TEST_END(n_colors1 == 256 && n_colors1 == n_colors2 &&
+                memcmp (colormap1, colormap2, n_colors1 * 3) == 0);
+  g_free (colormap1);
+  g_free (colormap2);
+
+  GIMP_TEST_START("dithered layers are identical");
+  GIMP_TEST_END(compare_images (new_image, dup_image));
+
+  gimp_image_delete (new_image);
+  gimp_image_delete (dup_image);
+
+  new_image = create_image (data, TRUE);
+
+  GIMP_TEST_START("gimp_image_convert_indexed() without dithering");
+  GIMP_TEST_END(convert_image (new_image, GIMP_CONVERT_DITHER_NONE,
+                               "no dithering"));
+
+  gimp_image_delete (new_image);
+
+  /* With a custom palette, each pixel near an entry maps to that entry,
+   * and pixels equal to an entry leave Floyd-Steinberg dithering no
+   * error to spread.
+   */
+  palette = create_palette ();
+
+  new_image = create_entries_image (data, indices, CONVERT_NOISE);
+
+  GIMP_TEST_START("gimp_image_convert_indexed() with a custom palette");
+  GIMP_TEST_END(convert_image_custom (new_image, GIMP_CONVERT_DITHER_NONE,
+                                      palette, "custom palette"));
+
+  colormap1 = get_colormap (new_image, &n_colors1);
+
+  GIMP_TEST_START("palette is the custom palette");
+  GIMP_TEST_END(colormap_is_palette (colormap1, n_colors1));
+  g_free (colormap1);
+
+  GIMP_TEST_START("pixels map to their nearest entries");
+  GIMP_TEST_END(compare_indices (new_image, indices, data));
+
+  gimp_image_delete (new_image);
+
+  new_image = create_entries_image (data, indices, 0);
+
+  GIMP_TEST_START("gimp_image_convert_indexed() with a custom palette "
+                  "and Floyd-Steinberg dithering");
+  GIMP_TEST_END(convert_image_custom (new_image, GIMP_CONVERT_DITHER_FS,
+                                      palette,
+                                      "custom palette, "
+                                      "Floyd-Steinberg dithering"));
+
+  colormap1 = get_colormap (new_image, &n_colors1);
+
+  GIMP_TEST_START("palette is the custom palette");
+  GIMP_TEST_END(colormap_is_palette (colormap1, n_colors1));
+  g_free (colormap1);
+
+  GIMP_TEST_START("pixels map to their entries");
+  GIMP_TEST_END(compare_indices (new_image, indices, data));
+
+  gimp_image_delete (new_image);
+
+  gimp_resource_delete (GIMP_RESOURCE (palette));
+
+  g_free (data);
+  g_free (indices);
+
+  GIMP_TEST_RETURN
+}
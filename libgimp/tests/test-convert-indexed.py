@@ -0,0 +1,35 @@
+#!/usr/bin/env python3
+
+CONVERT_IMAGE_WIDTH=300
+CONVERT_IMAGE_HEIGHT=200
+
+image = Gimp.Image.new(CONVERT_IMAGE_WIDTH, CONVERT_IMAGE_HEIGHT, Gimp.ImageBaseType.RGB)
+layer = Gimp.Layer.new(image, "halves", CONVERT_IMAGE_WIDTH, CONVERT_IMAGE_HEIGHT,
+                       Gimp.ImageType.RGB_IMAGE, 100.0,
+                       Gimp.LayerMode.NORMAL)
+gimp_assert('Gimp.Image.insert_layer()', image.insert_layer(layer, None, 0))
+
+# White, with a red left half.
+layer.fill(Gimp.FillType.WHITE)
+image.select_rectangle(Gimp.ChannelOps.REPLACE, 0, 0, CONVERT_IMAGE_WIDTH / 2, CONVERT_IMAGE_HEIGHT)
+Gimp.context_set_foreground(Gegl.Color.new("red"))
+layer.edit_fill(Gimp.FillType.FOREGROUND)
+Gimp.Selection.none(image)
+
+gimp_assert('Gimp.Image.convert_indexed()',
+            image.convert_indexed(Gimp.ConvertDitherType.FS,
+                                  Gimp.ConvertPaletteType.GENERATE,
+                                  256, False, False, ""))
+
+palette = image.get_palette()
+gimp_assert('palette holds the two colors', palette.get_color_count() == 2)
+
+gimp_assert('Gimp.Image.convert_rgb()', image.convert_rgb())
+
+buffer = layer.get_buffer()
+data   = buffer.get(buffer.get_extent(), 1.0, "R'G'B' u8", Gegl.AbyssPolicy.NONE)
+half   = CONVERT_IMAGE_WIDTH // 2
+row    = b'\xff\x00\x00' * half + b'\xff\xff\xff' * (CONVERT_IMAGE_WIDTH - half)
+gimp_assert('conversion is lossless', bytes(data) == row * CONVERT_IMAGE_HEIGHT)
+
+image.delete()
@@ -0,0 +1,156 @@
+/* Odd dimensions, so that the last row and column of tiles are partial,
+ * and big enough for the reads to span many batches of tiles, and for the
+ * tile transport to show in the timings.
+ */
+#define BUFFER_IMAGE_WIDTH  4001
+#define BUFFER_IMAGE_HEIGHT 3003
+
+
+static void
+fill_pattern (guchar *data,
+              gint    width,
+              gint    height)
+{
+  gint x, y;
+
+  for (y = 0; y < height; y++)
+    for (x = 0; x < width; x++)
+      {
+        guchar *pixel = data + (y * width + x) * 4;
+
+        pixel[0] = x;
+        pixel[1] = y;
+        pixel[2] = x ^ y;
+        pixel[3] = 255;
+      }
+}
+
+/* Reads the whole drawable through a fresh buffer, either with a single
+ * gegl_buffer_get(), which walks the tiles row by row and lets libgimp
+ * fetch them in batches, or tile by tile in column order, which makes
+ * every tile a separate request.  Returns the time spent, in seconds.
+ */
+static gdouble
+read_drawable (GimpDrawable *drawable,
+               guchar       *data,
+               gboolean      by_tile)
+{
+  GeglBuffer *buffer = gimp_drawable_get_buffer (drawable);
+  const Babl *format = babl_format ("R'G'B'A u8");
+  gint        width  = gegl_buffer_get_width  (buffer);
+  gint        height = gegl_buffer_get_height (buffer);
+  gdouble     elapsed;
+
+  g_test_timer_start ();
+
+  if (by_tile)
+    {
+      gint tile_width  = gimp_tile_width ();
+      gint tile_height = gimp_tile_height ();
+      gint x, y;
+
+      for (x = 0; x < width; x += tile_width)
+        for (y = 0; y < height; y += tile_height)
+          {
+            gegl_buffer_get (buffer,
+                             GEGL_RECTANGLE (x, y,
+                                             MIN (tile_width,  width  - x),
+                                             MIN (tile_height, height - y)),
+                             1.0, format,
+                             data + (y * width + x) * 4, width * 4,
+                             GEGL_ABYSS_NONE);
+          }
+    }
+  else
+    {
+      gegl_buffer_get (buffer, GEGL_RECTANGLE (0, 0, width, height), 1.0,
+                       format, data,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+    }
+
+  elapsed = g_test_timer_elapsed ();
+
+  g_object_unref (buffer);
+
+  return elapsed;
+}
+
+static void
+report_throughput (const gchar *how,
+                   gsize        size,
+                   gdouble      elapsed)
+{
+  if (g_test_perf ())
+    {
+      g_test_minimized_result (elapsed,
+                               "reading %dx%d pixels %s: %g s",
+                               BUFFER_IMAGE_WIDTH, BUFFER_IMAGE_HEIGHT,
+                               how, elapsed);
+      g_test_message ("reading %s: %.1f MiB/s",
+                      how, size / (1024.0 * 1024.0) / MAX (elapsed, 1e-6));
+    }
+}
+
+static GimpValueArray *
+gimp_c_test_run (GimpProcedure        *procedure,
+                 GimpRunMode           run_mode,
+                 GimpImage            *image,
+                 GimpDrawable        **drawables,
+                 GimpProcedureConfig  *config,
+                 gpointer              run_data)
+{
+  GimpImage  *new_image;
+  GimpLayer  *layer;
+  GeglBuffer *buffer;
+  gsize       size;
+  guchar     *pattern;
+  guchar     *data;
+  gdouble     elapsed;
+
+  size    = (gsize) BUFFER_IMAGE_WIDTH * BUFFER_IMAGE_HEIGHT * 4;
+  pattern = g_malloc (size);
+  data    = g_malloc (size);
+
+  fill_pattern (pattern, BUFFER_IMAGE_WIDTH, BUFFER_IMAGE_HEIGHT);
+
+  new_image = gimp_image_new (BUFFER_IMAGE_WIDTH, BUFFER_IMAGE_HEIGHT,
+                              GIMP_RGB);
+  layer     = gimp_layer_new (new_image, "pattern",
+                              BUFFER_IMAGE_WIDTH, BUFFER_IMAGE_HEIGHT,
+                              GIMP_RGBA_IMAGE, 100.0, GIMP_LAYER_MODE_NORMAL);
+
+  GIMP_TEST_START("gimp_image_insert_layer()");
+  GIMP_TEST_END(gimp_image_insert_layer (new_image, layer, NULL, 0));
+
+  GIMP_TEST_START("write the drawable buffer");
+  buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (layer));
+  gegl_buffer_set (buffer,
+                   GEGL_RECTANGLE (0, 0,
+                                   BUFFER_IMAGE_WIDTH, BUFFER_IMAGE_HEIGHT),
+                   0, babl_format ("R'G'B'A u8"), pattern,
+                   GEGL_AUTO_ROWSTRIDE);
+  gegl_buffer_flush (buffer);
+  g_object_unref (buffer);
+  GIMP_TEST_END(TRUE);
+
+  GIMP_TEST_START("read the drawable buffer tile by tile");
+  memset (data, 0, size);
+  elapsed = read_drawable (GIMP_DRAWABLE (layer), data, TRUE);
+  GIMP_TEST_END(memcmp (data, pattern, size) == 0);
+
+  report_throughput ("tile by tile", size, elapsed);
+
+  GIMP_TEST_START("read the drawable buffer in batches");
+  memset (data, 0, size);
+  elapsed = read_drawable (GIMP_DRAWABLE (layer), data, FALSE);
+  GIMP_TEST_END(memcmp (data, pattern, size) == 0);
+
+  report_throughput ("in batches", size, elapsed);
+
+  gimp_image_delete (new_image);
+
+  g_free (pattern);
+  g_free (data);
+
+  GIMP_TEST_RETURN
+}
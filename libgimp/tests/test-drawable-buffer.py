@@ -0,0 +1,20 @@
+#!/usr/bin/env python3
+
+# Odd dimensions, so that the last row and column of tiles are partial.
+BUFFER_IMAGE_WIDTH=1001
+BUFFER_IMAGE_HEIGHT=703
+
+image = Gimp.Image.new(BUFFER_IMAGE_WIDTH, BUFFER_IMAGE_HEIGHT, Gimp.ImageBaseType.RGB)
+layer = Gimp.Layer.new(image, "pattern", BUFFER_IMAGE_WIDTH, BUFFER_IMAGE_HEIGHT,
+                       Gimp.ImageType.RGBA_IMAGE, 100.0,
+                       Gimp.LayerMode.NORMAL)
+gimp_assert('Gimp.Image.insert_layer()', image.insert_layer(layer, None, 0))
+
+layer.fill(Gimp.FillType.WHITE)
+
+buffer = layer.get_buffer()
+data   = buffer.get(buffer.get_extent(), 1.0, "R'G'B'A u8", Gegl.AbyssPolicy.NONE)
+gimp_assert('read back the drawable buffer',
+            bytes(data) == b'\xff' * (BUFFER_IMAGE_WIDTH * BUFFER_IMAGE_HEIGHT * 4))
+
+image.delete()
@@ -0,0 +1,235 @@
+/* The source is straight above the dab, far enough for the largest brush
+ * not to overlap the blemish.
+ */
+#define HEAL_IMAGE_WIDTH  600
+#define HEAL_IMAGE_HEIGHT 800
+
+#define HEAL_DAB_X        300
+#define HEAL_DAB_Y        520
+#define HEAL_OFFSET_Y     300
+
+/* The solver's results agree with the exact solution within 0.02 LSBs
+ * at 8bit depth.
+ */
+#define HEAL_TOLERANCE    (0.02 / 255.0)
+
+/* Big enough for the largest benchmarked brush, plus the source offset,
+ * to fit.
+ */
+#define HEAL_PERF_WIDTH   1200
+#define HEAL_PERF_HEIGHT  1200
+#define HEAL_PERF_OFFSET  40
+
+
+static const gint brush_sizes[]      = { 50, 150, 400 };
+static const gint perf_brush_sizes[] = { 20, 50, 100, 200, 500, 1000 };
+
+
+/* A texture which repeats every HEAL_OFFSET_Y rows, up to a vertical ramp,
+ * with a hard vertical edge through the dab.  It differs from itself,
+ * shifted by the source offset, by a constant, so healing a blemish from
+ * the offset source must restore the texture exactly, edge included.
+ */
+static gfloat
+texture_value (gint x,
+               gint y,
+               gint c)
+{
+  gfloat value = 0.1f + 0.05f * c + 0.0003f * y;
+
+  if (((x / 7) + (y / 5)) & 1)
+    value += 0.15f;
+
+  if (x >= HEAL_DAB_X + 10)
+    value += 0.35f;
+
+  return value;
+}
+
+static void
+fill_texture (gfloat *data,
+              gint    width,
+              gint    height,
+              gint    blemish_radius)
+{
+  gint x, y, c;
+
+  for (y = 0; y < height; y++)
+    for (x = 0; x < width; x++)
+      {
+        gfloat *pixel = data + (y * width + x) * 3;
+        gint    dx    = x - HEAL_DAB_X;
+        gint    dy    = y - HEAL_DAB_Y;
+
+        for (c = 0; c < 3; c++)
+          {
+            pixel[c] = texture_value (x, y, c);
+
+            /* A striped blemish over the center of the dab. */
+            if (dx * dx + dy * dy <= blemish_radius * blemish_radius)
+              pixel[c] += (((x + y) / 4) & 1) ? 0.05f : -0.05f;
+          }
+      }
+}
+
+static gdouble
+max_difference (const gfloat *data1,
+                const gfloat *data2,
+                gsize         size)
+{
+  gdouble max_diff = 0.0;
+  gsize   i;
+
+  for (i = 0; i < size; i++)
+    max_diff = MAX (max_diff, fabs (data1[i] - data2[i]));
+
+  return max_diff;
+}
+
+/* Times a single dab of each benchmarked brush size, which is dominated
+ * by solving the Poisson equation over the brush area.
+ */
+static gboolean
+benchmark_heal (void)
+{
+  GimpImage  *new_image;
+  GimpLayer  *layer;
+  GeglBuffer *buffer;
+  gfloat     *data;
+  gboolean    success = TRUE;
+  gint        i;
+
+  data = g_new (gfloat, (gsize) HEAL_PERF_WIDTH * HEAL_PERF_HEIGHT * 3);
+
+  fill_texture (data, HEAL_PERF_WIDTH, HEAL_PERF_HEIGHT, 0);
+
+  new_image = gimp_image_new_with_precision (HEAL_PERF_WIDTH,
+                                             HEAL_PERF_HEIGHT,
+                                             GIMP_RGB,
+                                             GIMP_PRECISION_FLOAT_NON_LINEAR);
+  layer     = gimp_layer_new (new_image, "texture",
+                              HEAL_PERF_WIDTH, HEAL_PERF_HEIGHT,
+                              GIMP_RGB_IMAGE, 100.0, GIMP_LAYER_MODE_NORMAL);
+
+  if (! gimp_image_insert_layer (new_image, layer, NULL, 0))
+    success = FALSE;
+
+  buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (layer));
+  gegl_buffer_set (buffer,
+                   GEGL_RECTANGLE (0, 0, HEAL_PERF_WIDTH, HEAL_PERF_HEIGHT),
+                   0, babl_format ("R'G'B' float"), data,
+                   GEGL_AUTO_ROWSTRIDE);
+  g_object_unref (buffer);
+
+  for (i = 0; success && i < G_N_ELEMENTS (perf_brush_sizes); i++)
+    {
+      gdouble strokes[2] = { HEAL_PERF_WIDTH / 2, HEAL_PERF_HEIGHT / 2 };
+      gdouble elapsed;
+
+      gimp_context_set_brush_size (perf_brush_sizes[i]);
+
+      g_test_timer_start ();
+
+      success = gimp_heal (GIMP_DRAWABLE (layer), GIMP_DRAWABLE (layer),
+                           strokes[0] - HEAL_PERF_OFFSET,
+                           strokes[1] - HEAL_PERF_OFFSET,
+                           G_N_ELEMENTS (strokes), strokes);
+
+      elapsed = g_test_timer_elapsed ();
+
+      g_test_minimized_result (elapsed, "healing with a %d px brush: %g s",
+                               perf_brush_sizes[i], elapsed);
+    }
+
+  gimp_image_delete (new_image);
+
+  g_free (data);
+
+  return success;
+}
+
+static GimpValueArray *
+gimp_c_test_run (GimpProcedure        *procedure,
+                 GimpRunMode           run_mode,
+                 GimpImage            *image,
+                 GimpDrawable        **drawables,
+                 GimpProcedureConfig  *config,
+                 gpointer              run_data)
+{
+  const Babl *format = babl_format ("R'G'B' float");
+  GimpImage  *new_image;
+  GimpLayer  *layer;
+  GeglBuffer *buffer;
+  gsize       size;
+  gfloat     *texture;
+  gfloat     *data;
+  gint        i;
+
+  size    = (gsize) HEAL_IMAGE_WIDTH * HEAL_IMAGE_HEIGHT * 3;
+  texture = g_new (gfloat, size);
+  data    = g_new (gfloat, size);
+
+  fill_texture (texture, HEAL_IMAGE_WIDTH, HEAL_IMAGE_HEIGHT, 0);
+
+  new_image = gimp_image_new_with_precision (HEAL_IMAGE_WIDTH,
+                                             HEAL_IMAGE_HEIGHT,
+                                             GIMP_RGB,
+                                             GIMP_PRECISION_FLOAT_NON_LINEAR);
+  layer     = gimp_layer_new (new_image, "texture",
+                              HEAL_IMAGE_WIDTH, HEAL_IMAGE_HEIGHT,
+                              GIMP_RGB_IMAGE, 100.0, GIMP_LAYER_MODE_NORMAL);
+
+  GIMP_TEST_START("gimp_image_insert_layer()");
+  GIMP_TEST_END(gimp_image_insert_layer (new_image, layer, NULL, 0));
+
+  /* Paint the dabs at full strength, so the result is the healed pixels
+   * themselves.
+   */
+  gimp_context_enable_dynamics (FALSE);
+  gimp_context_set_opacity (100.0);
+
+  for (i = 0; i < G_N_ELEMENTS (brush_sizes); i++)
+    {
+      gdouble strokes[2] = { HEAL_DAB_X, HEAL_DAB_Y };
+
+      fill_texture (data, HEAL_IMAGE_WIDTH, HEAL_IMAGE_HEIGHT,
+                    brush_sizes[i] / 8);
+
+      buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (layer));
+      gegl_buffer_set (buffer,
+                       GEGL_RECTANGLE (0, 0,
+                                       HEAL_IMAGE_WIDTH, HEAL_IMAGE_HEIGHT),
+                       0, format, data, GEGL_AUTO_ROWSTRIDE);
+      g_object_unref (buffer);
+
+      gimp_context_set_brush_size (brush_sizes[i]);
+
+      GIMP_TEST_START("gimp_heal()");
+      GIMP_TEST_END(gimp_heal (GIMP_DRAWABLE (layer), GIMP_DRAWABLE (layer),
+                               HEAL_DAB_X, HEAL_DAB_Y - HEAL_OFFSET_Y,
+                               G_N_ELEMENTS (strokes), strokes));
+
+      GIMP_TEST_START("healed blemish matches the texture");
+      buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (layer));
+      gegl_buffer_get (buffer,
+                       GEGL_RECTANGLE (0, 0,
+                                       HEAL_IMAGE_WIDTH, HEAL_IMAGE_HEIGHT),
+                       1.0, format, data,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+      g_object_unref (buffer);
+      GIMP_TEST_END(max_difference (data, texture, size) <= HEAL_TOLERANCE);
+    }
+
+  if (g_test_perf ())
+    {
+      GIMP_TEST_START("benchmark gimp_heal()");
+      GIMP_TEST_END(benchmark_heal ());
+    }
+
+  gimp_image_delete (new_image);
+
+  g_free (texture);
+  g_free (data);
+
+  GIMP_TEST_RETURN
+}
@@ -0,0 +1,164 @@
+/* Enough layers, and big enough ones, for the PSD loader to decode
+ * several layers in one batch, and each of their channels in bands.
+ */
+#define PSD_IMAGE_WIDTH  2001
+#define PSD_IMAGE_HEIGHT 1501
+#define PSD_N_LAYERS     24
+
+
+static void
+fill_pattern (guchar *data,
+              gint    width,
+              gint    height,
+              gint    seed)
+{
+  gint x, y;
+
+  for (y = 0; y < height; y++)
+    for (x = 0; x < width; x++)
+      {
+        guchar *pixel = data + (y * width + x) * 4;
+
+        /* Runs and literals, so that PackBits has both to decode */
+        pixel[0] = (x / 16 + seed) * 16;
+        pixel[1] = x ^ y ^ seed;
+        pixel[2] = y + seed;
+        pixel[3] = 255;
+      }
+}
+
+static gboolean
+compare_layers (GimpImage *image1,
+                GimpImage *image2,
+                guchar    *data1,
+                guchar    *data2)
+{
+  GimpLayer **layers1  = gimp_image_get_layers (image1);
+  GimpLayer **layers2  = gimp_image_get_layers (image2);
+  gint        n_layers = gimp_core_object_array_get_length ((GObject **) layers1);
+  gboolean    success;
+  gint        i;
+
+  success = (n_layers ==
+             gimp_core_object_array_get_length ((GObject **) layers2));
+
+  for (i = 0; success && i < n_layers; i++)
+    {
+      GeglBuffer *buffer1 = gimp_drawable_get_buffer (GIMP_DRAWABLE (layers1[i]));
+      GeglBuffer *buffer2 = gimp_drawable_get_buffer (GIMP_DRAWABLE (layers2[i]));
+
+      gegl_buffer_get (buffer1, GEGL_RECTANGLE (0, 0, PSD_IMAGE_WIDTH, PSD_IMAGE_HEIGHT),
+                       1.0, babl_format ("R'G'B'A u8"), data1,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+      gegl_buffer_get (buffer2, GEGL_RECTANGLE (0, 0, PSD_IMAGE_WIDTH, PSD_IMAGE_HEIGHT),
+                       1.0, babl_format ("R'G'B'A u8"), data2,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+      success = (memcmp (data1, data2,
+                         (gsize) PSD_IMAGE_WIDTH * PSD_IMAGE_HEIGHT * 4) == 0);
+
+      g_object_unref (buffer1);
+      g_object_unref (buffer2);
+    }
+
+  g_free (layers1);
+  g_free (layers2);
+
+  return success;
+}
+
+static GimpValueArray *
+gimp_c_test_run (GimpProcedure        *procedure,
+                 GimpRunMode           run_mode,
+                 GimpImage            *image,
+                 GimpDrawable        **drawables,
+                 GimpProcedureConfig  *config,
+                 gpointer              run_data)
+{
+  const gchar *formats[][2] =
+  {
+    { "file-psd-export", "psd" },
+    { "file-psb-export", "psb" }
+  };
+  GimpImage   *new_image;
+  gsize        size;
+  guchar      *data1;
+  guchar      *data2;
+  gint         i;
+
+  size  = (gsize) PSD_IMAGE_WIDTH * PSD_IMAGE_HEIGHT * 4;
+  data1 = g_malloc (size);
+  data2 = g_malloc (size);
+
+  new_image = gimp_image_new (PSD_IMAGE_WIDTH, PSD_IMAGE_HEIGHT, GIMP_RGB);
+
+  GIMP_TEST_START("create the layers");
+  for (i = 0; i < PSD_N_LAYERS; i++)
+    {
+      GimpLayer  *layer;
+      GeglBuffer *buffer;
+
+      layer = gimp_layer_new (new_image, "pattern",
+                              PSD_IMAGE_WIDTH, PSD_IMAGE_HEIGHT,
+                              GIMP_RGBA_IMAGE, 100.0, GIMP_LAYER_MODE_NORMAL);
+      gimp_image_insert_layer (new_image, layer, NULL, 0);
+
+      fill_pattern (data1, PSD_IMAGE_WIDTH, PSD_IMAGE_HEIGHT, i);
+
+      buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (layer));
+      gegl_buffer_set (buffer,
+                       GEGL_RECTANGLE (0, 0, PSD_IMAGE_WIDTH, PSD_IMAGE_HEIGHT),
+                       0, babl_format ("R'G'B'A u8"), data1,
+                       GEGL_AUTO_ROWSTRIDE);
+      g_object_unref (buffer);
+    }
+  GIMP_TEST_END(TRUE);
+
+  for (i = 0; i < G_N_ELEMENTS (formats); i++)
+    {
+      GimpValueArray *retvals;
+      GimpImage      *loaded_image;
+      GFile          *file;
+      gdouble         elapsed;
+      gchar          *name;
+
+      file = gimp_temp_file (formats[i][1]);
+
+      name = g_strdup_printf ("%s the image", formats[i][0]);
+      GIMP_TEST_START(name);
+      retvals = gimp_procedure_run (gimp_pdb_lookup_procedure (gimp_get_pdb (), formats[i][0]),
+                                    "run-mode", GIMP_RUN_NONINTERACTIVE,
+                                    "image",    new_image,
+                                    "file",     file,
+                                    NULL);
+      GIMP_TEST_END(GIMP_VALUES_GET_ENUM (retvals, 0) == GIMP_PDB_SUCCESS);
+      gimp_value_array_unref (retvals);
+      g_free (name);
+
+      GIMP_TEST_START("gimp_file_load() the exported image");
+      g_test_timer_start ();
+      loaded_image = gimp_file_load (GIMP_RUN_NONINTERACTIVE, file);
+      elapsed      = g_test_timer_elapsed ();
+      GIMP_TEST_END(GIMP_IS_IMAGE (loaded_image));
+
+      if (g_test_perf ())
+        g_test_minimized_result (elapsed,
+                                 "loading %s, %d layers of %dx%d: %g s",
+                                 formats[i][1], PSD_N_LAYERS,
+                                 PSD_IMAGE_WIDTH, PSD_IMAGE_HEIGHT, elapsed);
+
+      GIMP_TEST_START("the loaded layers match");
+      GIMP_TEST_END(compare_layers (new_image, loaded_image, data1, data2));
+
+      gimp_image_delete (loaded_image);
+      g_file_delete (file, NULL, NULL);
+      g_object_unref (file);
+    }
+
+  gimp_image_delete (new_image);
+
+  g_free (data1);
+  g_free (data2);
+
+  GIMP_TEST_RETURN
+}
@@ -0,0 +1,38 @@
+#!/usr/bin/env python3
+
+# Odd dimensions, and a few layers, so that channels are decoded in
+# bands and layers in a batch.
+PSD_IMAGE_WIDTH=1001
+PSD_IMAGE_HEIGHT=703
+PSD_N_LAYERS=3
+
+image = Gimp.Image.new(PSD_IMAGE_WIDTH, PSD_IMAGE_HEIGHT, Gimp.ImageBaseType.RGB)
+for i in range(PSD_N_LAYERS):
+  layer = Gimp.Layer.new(image, "white", PSD_IMAGE_WIDTH, PSD_IMAGE_HEIGHT,
+                         Gimp.ImageType.RGBA_IMAGE, 100.0,
+                         Gimp.LayerMode.NORMAL)
+  gimp_assert('Gimp.Image.insert_layer()', image.insert_layer(layer, None, 0))
+  layer.fill(Gimp.FillType.WHITE)
+
+for extension in [ 'psd', 'psb' ]:
+  file = Gimp.temp_file(extension)
+  gimp_assert('Gimp.file_save() as {}'.format(extension),
+              Gimp.file_save(Gimp.RunMode.NONINTERACTIVE, image, file, None))
+
+  loaded = Gimp.file_load(Gimp.RunMode.NONINTERACTIVE, file)
+  gimp_assert('Gimp.file_load() the {}'.format(extension), loaded is not None)
+
+  layers = loaded.get_layers()
+  gimp_assert('the loaded image has {} layers'.format(PSD_N_LAYERS),
+              len(layers) == PSD_N_LAYERS)
+
+  for layer in layers:
+    buffer = layer.get_buffer()
+    data   = buffer.get(buffer.get_extent(), 1.0, "R'G'B'A u8", Gegl.AbyssPolicy.NONE)
+    gimp_assert('the loaded pixels match',
+                bytes(data) == b'\xff' * (PSD_IMAGE_WIDTH * PSD_IMAGE_HEIGHT * 4))
+
+  loaded.delete()
+  file.delete(None)
+
+image.delete()
@@ -0,0 +1,200 @@
+/* Big enough for fuzzy select to use its parallel engine, and for the
+ * timings to mean something.
+ */
+#define SELECT_IMAGE_WIDTH  8192
+#define SELECT_IMAGE_HEIGHT 8192
+
+
+/* Fills data with either a uniform white image, or white noise over a
+ * black background, dense enough for most of the white pixels to be
+ * connected, through a maze of narrow paths.
+ */
+static void
+fill_pattern (guchar   *data,
+              gint      width,
+              gint      height,
+              gboolean  noise)
+{
+  guint32 state = 1;
+  gint    i;
+
+  for (i = 0; i < width * height; i++)
+    {
+      state = state * 1664525 + 1013904223;
+
+      data[i] = (! noise || (state >> 24) % 100 >= 35) ? 255 : 0;
+    }
+
+  data[(height / 2) * width + width / 2] = 255;
+}
+
+/* Reference fill: the pixels equal to the seed's, and connected to it.
+ */
+static void
+fill_reference (const guchar *data,
+                guchar       *ref,
+                gint          width,
+                gint          height,
+                gint          x,
+                gint          y,
+                gboolean      diagonal_neighbors)
+{
+  GArray *stack = g_array_new (FALSE, FALSE, sizeof (gint));
+  gint    seed  = y * width + x;
+
+  memset (ref, 0, (gsize) width * height);
+
+  ref[seed] = 255;
+  g_array_append_val (stack, seed);
+
+  while (stack->len > 0)
+    {
+      gint i = g_array_index (stack, gint, stack->len - 1);
+      gint dx, dy;
+
+      g_array_set_size (stack, stack->len - 1);
+
+      x = i % width;
+      y = i / width;
+
+      for (dy = -1; dy <= 1; dy++)
+        for (dx = -1; dx <= 1; dx++)
+          {
+            gint j;
+
+            if ((! dx && ! dy) || (dx && dy && ! diagonal_neighbors))
+              continue;
+
+            if (x + dx < 0 || x + dx >= width ||
+                y + dy < 0 || y + dy >= height)
+              continue;
+
+            j = (y + dy) * width + x + dx;
+
+            if (ref[j] || data[j] != data[seed])
+              continue;
+
+            ref[j] = 255;
+            g_array_append_val (stack, j);
+          }
+    }
+
+  g_array_free (stack, TRUE);
+}
+
+static gboolean
+select_and_compare (GimpImage    *image,
+                    GimpDrawable *drawable,
+                    const guchar *data,
+                    guchar       *ref,
+                    guchar       *mask,
+                    gboolean      diagonal_neighbors,
+                    const gchar  *name)
+{
+  GeglBuffer *buffer;
+  gdouble     elapsed;
+  gint        x = SELECT_IMAGE_WIDTH  / 2;
+  gint        y = SELECT_IMAGE_HEIGHT / 2;
+
+  gimp_context_set_diagonal_neighbors (diagonal_neighbors);
+
+  g_test_timer_start ();
+
+  gimp_image_select_contiguous_color (image, GIMP_CHANNEL_OP_REPLACE,
+                                      drawable, x, y);
+
+  elapsed = g_test_timer_elapsed ();
+
+  if (g_test_perf ())
+    g_test_minimized_result (elapsed, "selecting %s, %dx%d: %g s",
+                             name, SELECT_IMAGE_WIDTH, SELECT_IMAGE_HEIGHT,
+                             elapsed);
+
+  buffer = gimp_drawable_get_buffer (
+    GIMP_DRAWABLE (gimp_image_get_selection (image)));
+  gegl_buffer_get (buffer,
+                   GEGL_RECTANGLE (0, 0,
+                                   SELECT_IMAGE_WIDTH, SELECT_IMAGE_HEIGHT),
+                   1.0, babl_format ("Y u8"), mask,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+  g_object_unref (buffer);
+
+  fill_reference (data, ref, SELECT_IMAGE_WIDTH, SELECT_IMAGE_HEIGHT,
+                  x, y, diagonal_neighbors);
+
+  return memcmp (mask, ref, (gsize) SELECT_IMAGE_WIDTH *
+                                    SELECT_IMAGE_HEIGHT) == 0;
+}
+
+static GimpValueArray *
+gimp_c_test_run (GimpProcedure        *procedure,
+                 GimpRunMode           run_mode,
+                 GimpImage            *image,
+                 GimpDrawable        **drawables,
+                 GimpProcedureConfig  *config,
+                 gpointer              run_data)
+{
+  GimpImage  *new_image;
+  GimpLayer  *layer;
+  GeglBuffer *buffer;
+  gsize       size;
+  guchar     *data;
+  guchar     *ref;
+  guchar     *mask;
+
+  size = (gsize) SELECT_IMAGE_WIDTH * SELECT_IMAGE_HEIGHT;
+  data = g_malloc (size);
+  ref  = g_malloc (size);
+  mask = g_malloc (size);
+
+  new_image = gimp_image_new (SELECT_IMAGE_WIDTH, SELECT_IMAGE_HEIGHT,
+                              GIMP_GRAY);
+  layer     = gimp_layer_new (new_image, "pattern",
+                              SELECT_IMAGE_WIDTH, SELECT_IMAGE_HEIGHT,
+                              GIMP_GRAY_IMAGE, 100.0, GIMP_LAYER_MODE_NORMAL);
+
+  GIMP_TEST_START("gimp_image_insert_layer()");
+  GIMP_TEST_END(gimp_image_insert_layer (new_image, layer, NULL, 0));
+
+  gimp_context_set_antialias (FALSE);
+  gimp_context_set_sample_merged (FALSE);
+  gimp_context_set_sample_criterion (GIMP_SELECT_CRITERION_COMPOSITE);
+  gimp_context_set_sample_threshold (0.0);
+
+  fill_pattern (data, SELECT_IMAGE_WIDTH, SELECT_IMAGE_HEIGHT, FALSE);
+  buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (layer));
+  gegl_buffer_set (buffer,
+                   GEGL_RECTANGLE (0, 0,
+                                   SELECT_IMAGE_WIDTH, SELECT_IMAGE_HEIGHT),
+                   0, babl_format ("Y' u8"), data, GEGL_AUTO_ROWSTRIDE);
+  g_object_unref (buffer);
+
+  GIMP_TEST_START("select a uniform image");
+  GIMP_TEST_END(select_and_compare (new_image, GIMP_DRAWABLE (layer),
+                                    data, ref, mask, FALSE, "a uniform image"));
+
+  fill_pattern (data, SELECT_IMAGE_WIDTH, SELECT_IMAGE_HEIGHT, TRUE);
+  buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (layer));
+  gegl_buffer_set (buffer,
+                   GEGL_RECTANGLE (0, 0,
+                                   SELECT_IMAGE_WIDTH, SELECT_IMAGE_HEIGHT),
+                   0, babl_format ("Y' u8"), data, GEGL_AUTO_ROWSTRIDE);
+  g_object_unref (buffer);
+
+  GIMP_TEST_START("select a maze");
+  GIMP_TEST_END(select_and_compare (new_image, GIMP_DRAWABLE (layer),
+                                    data, ref, mask, FALSE, "a maze"));
+
+  GIMP_TEST_START("select a maze with diagonal neighbors");
+  GIMP_TEST_END(select_and_compare (new_image, GIMP_DRAWABLE (layer),
+                                    data, ref, mask, TRUE,
+                                    "a maze with diagonal neighbors"));
+
+  gimp_image_delete (new_image);
+
+  g_free (data);
+  g_free (ref);
+  g_free (mask);
+
+  GIMP_TEST_RETURN
+}
@@ -0,0 +1,28 @@
+#!/usr/bin/env python3
+
+SELECT_IMAGE_WIDTH=256
+SELECT_IMAGE_HEIGHT=256
+
+image = Gimp.Image.new(SELECT_IMAGE_WIDTH, SELECT_IMAGE_HEIGHT, Gimp.ImageBaseType.GRAY)
+layer = Gimp.Layer.new(image, "halves", SELECT_IMAGE_WIDTH, SELECT_IMAGE_HEIGHT,
+                       Gimp.ImageType.GRAY_IMAGE, 100.0,
+                       Gimp.LayerMode.NORMAL)
+gimp_assert('Gimp.Image.insert_layer()', image.insert_layer(layer, None, 0))
+
+# White, split in two halves by a black column.
+layer.fill(Gimp.FillType.WHITE)
+image.select_rectangle(Gimp.ChannelOps.REPLACE, 100, 0, 1, SELECT_IMAGE_HEIGHT)
+Gimp.context_set_foreground(Gegl.Color.new("black"))
+layer.edit_fill(Gimp.FillType.FOREGROUND)
+Gimp.Selection.none(image)
+
+Gimp.context_set_antialias(False)
+Gimp.context_set_sample_threshold(0.0)
+gimp_assert('Gimp.Image.select_contiguous_color()',
+            image.select_contiguous_color(Gimp.ChannelOps.REPLACE, layer, 10, 10))
+
+success, non_empty, x1, y1, x2, y2 = Gimp.Selection.bounds(image)
+gimp_assert('only the left half is selected',
+            non_empty and (x1, y1, x2, y2) == (0, 0, 100, SELECT_IMAGE_HEIGHT))
+
+image.delete()
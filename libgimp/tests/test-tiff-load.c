@@ -0,0 +1,415 @@
+/* Odd dimensions, so that the last strip and the last row and column of
+ * tiles are partial, and big enough for the TIFF loader to decode the
+ * strips and tiles in parallel.
+ */
+#define TIFF_IMAGE_WIDTH  4001
+#define TIFF_IMAGE_HEIGHT 3003
+#define TIFF_TILE_SIZE    256
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+
+typedef struct
+{
+  GThread *thread;
+  gint     done;
+  gint64   peak_rss;
+} LoaderRss;
+
+
+static void
+fill_pattern (guchar *data,
+              gint    width,
+              gint    height)
+{
+  gint x, y;
+
+  for (y = 0; y < height; y++)
+    for (x = 0; x < width; x++)
+      {
+        guchar *pixel = data + (y * width + x) * 3;
+
+        pixel[0] = x;
+        pixel[1] = y;
+        pixel[2] = x ^ y;
+      }
+}
+
+static guchar *
+put_16 (guchar  *dest,
+        guint16  value)
+{
+  dest[0] = value;
+  dest[1] = value >> 8;
+
+  return dest + 2;
+}
+
+static guchar *
+put_32 (guchar  *dest,
+        guint32  value)
+{
+  dest[0] = value;
+  dest[1] = value >> 8;
+  dest[2] = value >> 16;
+  dest[3] = value >> 24;
+
+  return dest + 4;
+}
+
+static guchar *
+put_entry (guchar  *dest,
+           guint16  tag,
+           guint16  type,
+           guint32  count,
+           guint32  value)
+{
+  dest = put_16 (dest, tag);
+  dest = put_16 (dest, type);
+  dest = put_32 (dest, count);
+
+  /* short values are left-justified in the value field */
+  if (type == 3 && count == 1)
+    {
+      dest = put_16 (dest, value);
+      dest = put_16 (dest, 0);
+    }
+  else
+    {
+      dest = put_32 (dest, value);
+    }
+
+  return dest;
+}
+
+/* The TIFF exporter only writes strips, so the tiled file is written by
+ * hand: an uncompressed, little-endian RGB image of TIFF_TILE_SIZE tiles,
+ * padded with black past the image's edges.
+ */
+static gboolean
+write_tiled_tiff (GFile        *file,
+                  const guchar *pattern)
+{
+  const gint  n_entries    = 11;
+  const gint  tiles_across = (TIFF_IMAGE_WIDTH  + TIFF_TILE_SIZE - 1) /
+                             TIFF_TILE_SIZE;
+  const gint  tiles_down   = (TIFF_IMAGE_HEIGHT + TIFF_TILE_SIZE - 1) /
+                             TIFF_TILE_SIZE;
+  const gint  n_tiles      = tiles_across * tiles_down;
+  const gsize tile_size    = TIFF_TILE_SIZE * TIFF_TILE_SIZE * 3;
+  gsize       header_size;
+  gsize       size;
+  guint32     bps_offset;
+  guint32     offsets_offset;
+  guint32     counts_offset;
+  guint32     data_offset;
+  guchar     *tiff;
+  guchar     *dest;
+  gboolean    success;
+  gint        i;
+
+  bps_offset     = 8 + 2 + n_entries * 12 + 4;
+  offsets_offset = bps_offset + 3 * 2;
+  counts_offset  = offsets_offset + n_tiles * 4;
+  data_offset    = counts_offset  + n_tiles * 4;
+  header_size    = data_offset;
+  size           = header_size + n_tiles * tile_size;
+
+  tiff = g_malloc0 (size);
+
+  dest = tiff;
+  *dest++ = 'I';
+  *dest++ = 'I';
+  dest = put_16 (dest, 42);
+  dest = put_32 (dest, 8);
+
+  dest = put_16 (dest, n_entries);
+  dest = put_entry (dest, 256, 4, 1, TIFF_IMAGE_WIDTH);  /* ImageWidth           */
+  dest = put_entry (dest, 257, 4, 1, TIFF_IMAGE_HEIGHT); /* ImageLength          */
+  dest = put_entry (dest, 258, 3, 3, bps_offset);        /* BitsPerSample        */
+  dest = put_entry (dest, 259, 3, 1, 1);                 /* Compression: none    */
+  dest = put_entry (dest, 262, 3, 1, 2);                 /* Photometric: RGB     */
+  dest = put_entry (dest, 277, 3, 1, 3);                 /* SamplesPerPixel      */
+  dest = put_entry (dest, 284, 3, 1, 1);                 /* PlanarConfig: contig */
+  dest = put_entry (dest, 322, 3, 1, TIFF_TILE_SIZE);    /* TileWidth            */
+  dest = put_entry (dest, 323, 3, 1, TIFF_TILE_SIZE);    /* TileLength           */
+  dest = put_entry (dest, 324, 4, n_tiles, offsets_offset); /* TileOffsets     */
+  dest = put_entry (dest, 325, 4, n_tiles, counts_offset);  /* TileByteCounts  */
+  dest = put_32 (dest, 0);
+
+  for (i = 0; i < 3; i++)
+    dest = put_16 (dest, 8);
+
+  for (i = 0; i < n_tiles; i++)
+    dest = put_32 (dest, data_offset + i * tile_size);
+
+  for (i = 0; i < n_tiles; i++)
+    dest = put_32 (dest, tile_size);
+
+  for (i = 0; i < n_tiles; i++)
+    {
+      gint x0 = (i % tiles_across) * TIFF_TILE_SIZE;
+      gint y0 = (i / tiles_across) * TIFF_TILE_SIZE;
+      gint y;
+
+      for (y = 0; y < TIFF_TILE_SIZE && y0 + y < TIFF_IMAGE_HEIGHT; y++)
+        {
+          memcpy (tiff + data_offset + i * tile_size +
+                  y * TIFF_TILE_SIZE * 3,
+                  pattern + ((gsize) (y0 + y) * TIFF_IMAGE_WIDTH + x0) * 3,
+                  MIN (TIFF_TILE_SIZE, TIFF_IMAGE_WIDTH - x0) * 3);
+        }
+    }
+
+  success = g_file_replace_contents (file, (const gchar *) tiff, size,
+                                     NULL, FALSE, G_FILE_CREATE_NONE,
+                                     NULL, NULL, NULL);
+
+  g_free (tiff);
+
+  return success;
+}
+
+#ifdef __linux__
+/* The loader runs in its own plug-in process, a sibling of this one, so
+ * its peak RSS is sampled from /proc while it runs.
+ */
+static gint64
+loader_rss_sample (gint pid)
+{
+  gchar  *path;
+  gchar  *contents;
+  gint64  peak_rss = -1;
+
+  path = g_strdup_printf ("/proc/%d/status", pid);
+
+  if (g_file_get_contents (path, &contents, NULL, NULL))
+    {
+      gchar *line;
+      gchar  name[16];
+      gint   ppid = 0;
+
+      if (sscanf (contents, "Name:\t%15s", name) == 1 &&
+          ! strcmp (name, "file-tiff")                 &&
+          (line = strstr (contents, "\nPPid:"))        &&
+          sscanf (line, "\nPPid:\t%d", &ppid) == 1      &&
+          ppid == getppid ()                           &&
+          (line = strstr (contents, "\nVmHWM:")))
+        {
+          sscanf (line, "\nVmHWM:\t%" G_GINT64_FORMAT, &peak_rss);
+        }
+
+      g_free (contents);
+    }
+
+  g_free (path);
+
+  return peak_rss;
+}
+
+static gpointer
+loader_rss_thread (LoaderRss *rss)
+{
+  gint pid = 0;
+
+  while (! g_atomic_int_get (&rss->done))
+    {
+      if (! pid)
+        {
+          GDir        *dir = g_dir_open ("/proc", 0, NULL);
+          const gchar *name;
+
+          while (dir && (name = g_dir_read_name (dir)))
+            {
+              if (g_ascii_isdigit (name[0]) &&
+                  loader_rss_sample (atoi (name)) >= 0)
+                {
+                  pid = atoi (name);
+                  break;
+                }
+            }
+
+          if (dir)
+            g_dir_close (dir);
+        }
+      else
+        {
+          gint64 peak_rss = loader_rss_sample (pid);
+
+          /* the loader is gone */
+          if (peak_rss < 0)
+            break;
+
+          rss->peak_rss = MAX (rss->peak_rss, peak_rss);
+        }
+
+      g_usleep (1000);
+    }
+
+  return NULL;
+}
+#endif /* __linux__ */
+
+static void
+loader_rss_start (LoaderRss *rss)
+{
+  rss->thread   = NULL;
+  rss->done     = FALSE;
+  rss->peak_rss = 0;
+
+#ifdef __linux__
+  rss->thread = g_thread_new ("loader-rss",
+                              (GThreadFunc) loader_rss_thread, rss);
+#endif
+}
+
+static void
+loader_rss_stop (LoaderRss *rss)
+{
+  g_atomic_int_set (&rss->done, TRUE);
+
+  if (rss->thread)
+    g_thread_join (rss->thread);
+}
+
+/* Loads file, timing it and sampling the loader's peak RSS in perf mode,
+ * and compares the loaded pixels with pattern.
+ */
+static gboolean
+load_and_compare (GFile        *file,
+                  const guchar *pattern,
+                  guchar       *data,
+                  const gchar  *what)
+{
+  GimpImage   *loaded_image;
+  GimpLayer  **layers;
+  GeglBuffer  *buffer;
+  LoaderRss    rss = { 0, };
+  gdouble      elapsed;
+  gboolean     success;
+
+  if (g_test_perf ())
+    loader_rss_start (&rss);
+
+  g_test_timer_start ();
+
+  loaded_image = gimp_file_load (GIMP_RUN_NONINTERACTIVE, file);
+
+  elapsed = g_test_timer_elapsed ();
+
+  if (g_test_perf ())
+    {
+      loader_rss_stop (&rss);
+
+      g_test_minimized_result (elapsed, "loading %dx%d %s: %g s",
+                               TIFF_IMAGE_WIDTH, TIFF_IMAGE_HEIGHT, what,
+                               elapsed);
+
+      if (rss.peak_rss > 0)
+        g_test_minimized_result (rss.peak_rss,
+                                 "loading %dx%d %s: peak RSS %" G_GINT64_FORMAT
+                                 " KiB",
+                                 TIFF_IMAGE_WIDTH, TIFF_IMAGE_HEIGHT, what,
+                                 rss.peak_rss);
+      else
+        g_test_message ("loading %s: the loader's peak RSS is unknown", what);
+    }
+
+  if (! GIMP_IS_IMAGE (loaded_image))
+    return FALSE;
+
+  layers  = gimp_image_get_layers (loaded_image);
+  success = gimp_core_object_array_get_length ((GObject **) layers) == 1;
+
+  if (success)
+    {
+      buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (layers[0]));
+      gegl_buffer_get (buffer,
+                       GEGL_RECTANGLE (0, 0,
+                                       TIFF_IMAGE_WIDTH, TIFF_IMAGE_HEIGHT),
+                       1.0, babl_format ("R'G'B' u8"), data,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+      g_object_unref (buffer);
+
+      success = memcmp (data, pattern,
+                        (gsize) TIFF_IMAGE_WIDTH * TIFF_IMAGE_HEIGHT * 3) == 0;
+    }
+
+  g_free (layers);
+  gimp_image_delete (loaded_image);
+
+  return success;
+}
+
+static GimpValueArray *
+gimp_c_test_run (GimpProcedure        *procedure,
+                 GimpRunMode           run_mode,
+                 GimpImage            *image,
+                 GimpDrawable        **drawables,
+                 GimpProcedureConfig  *config,
+                 gpointer              run_data)
+{
+  GimpImage       *new_image;
+  GimpLayer       *layer;
+  GimpValueArray  *retvals;
+  GeglBuffer      *buffer;
+  GFile           *file;
+  gsize            size;
+  guchar          *pattern;
+  guchar          *data;
+
+  size    = (gsize) TIFF_IMAGE_WIDTH * TIFF_IMAGE_HEIGHT * 3;
+  pattern = g_malloc (size);
+  data    = g_malloc (size);
+  file    = gimp_temp_file ("tif");
+
+  fill_pattern (pattern, TIFF_IMAGE_WIDTH, TIFF_IMAGE_HEIGHT);
+
+  new_image = gimp_image_new (TIFF_IMAGE_WIDTH, TIFF_IMAGE_HEIGHT, GIMP_RGB);
+  layer     = gimp_layer_new (new_image, "pattern",
+                              TIFF_IMAGE_WIDTH, TIFF_IMAGE_HEIGHT,
+                              GIMP_RGB_IMAGE, 100.0, GIMP_LAYER_MODE_NORMAL);
+
+  GIMP_TEST_START("gimp_image_insert_layer()");
+  GIMP_TEST_END(gimp_image_insert_layer (new_image, layer, NULL, 0));
+
+  buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (layer));
+  gegl_buffer_set (buffer,
+                   GEGL_RECTANGLE (0, 0, TIFF_IMAGE_WIDTH, TIFF_IMAGE_HEIGHT),
+                   0, babl_format ("R'G'B' u8"), pattern,
+                   GEGL_AUTO_ROWSTRIDE);
+  gegl_buffer_flush (buffer);
+  g_object_unref (buffer);
+
+  GIMP_TEST_START("export a deflate compressed TIFF");
+  retvals = gimp_procedure_run (gimp_pdb_lookup_procedure (gimp_get_pdb (), "file-tiff-export"),
+                                "run-mode",    GIMP_RUN_NONINTERACTIVE,
+                                "image",       new_image,
+                                "file",        file,
+                                "compression", "adobe_deflate",
+                                NULL);
+  GIMP_TEST_END(GIMP_VALUES_GET_ENUM (retvals, 0) == GIMP_PDB_SUCCESS);
+  gimp_value_array_unref (retvals);
+
+  GIMP_TEST_START("load the stripped TIFF, the pixels match");
+  GIMP_TEST_END(load_and_compare (file, pattern, data,
+                                  "deflate compressed strips"));
+
+  GIMP_TEST_START("write a tiled TIFF");
+  GIMP_TEST_END(write_tiled_tiff (file, pattern));
+
+  GIMP_TEST_START("load the tiled TIFF, the pixels match");
+  GIMP_TEST_END(load_and_compare (file, pattern, data,
+                                  "uncompressed tiles"));
+
+  gimp_image_delete (new_image);
+  g_file_delete (file, NULL, NULL);
+  g_object_unref (file);
+
+  g_free (pattern);
+  g_free (data);
+
+  GIMP_TEST_RETURN
+}
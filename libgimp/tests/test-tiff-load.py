@@ -0,0 +1,32 @@
+#!/usr/bin/env python3
+
+# Odd dimensions, so that the last strip is partial.
+TIFF_IMAGE_WIDTH=1001
+TIFF_IMAGE_HEIGHT=703
+
+image = Gimp.Image.new(TIFF_IMAGE_WIDTH, TIFF_IMAGE_HEIGHT, Gimp.ImageBaseType.RGB)
+layer = Gimp.Layer.new(image, "white", TIFF_IMAGE_WIDTH, TIFF_IMAGE_HEIGHT,
+                       Gimp.ImageType.RGB_IMAGE, 100.0,
+                       Gimp.LayerMode.NORMAL)
+gimp_assert('Gimp.Image.insert_layer()', image.insert_layer(layer, None, 0))
+
+layer.fill(Gimp.FillType.WHITE)
+
+file = Gimp.temp_file('tif')
+gimp_assert('Gimp.file_save()',
+            Gimp.file_save(Gimp.RunMode.NONINTERACTIVE, image, file, None))
+
+loaded = Gimp.file_load(Gimp.RunMode.NONINTERACTIVE, file)
+gimp_assert('Gimp.file_load()', loaded is not None)
+
+layers = loaded.get_layers()
+gimp_assert('the loaded image has a single layer', len(layers) == 1)
+
+buffer = layers[0].get_buffer()
+data   = buffer.get(buffer.get_extent(), 1.0, "R'G'B' u8", Gegl.AbyssPolicy.NONE)
+gimp_assert('the loaded pixels match',
+            bytes(data) == b'\xff' * (TIFF_IMAGE_WIDTH * TIFF_IMAGE_HEIGHT * 3))
+
+loaded.delete()
+image.delete()
+file.delete(None)
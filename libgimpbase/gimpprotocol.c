@@ -765,6 +765,9 @@ _gp_tile_req_read (GIOChannel      *channel,
   if (! _gimp_wire_read_int32 (channel,
                                &tile_req->shadow, 1, user_data))
     goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               &tile_req->n_tiles, 1, user_data))
+    goto cleanup;
 
   msg->data = tile_req;
   return;
@@ -791,6 +794,9 @@ _gp_tile_req_write (GIOChannel      *channel,
   if (! _gimp_wire_write_int32 (channel,
                                 &tile_req->shadow, 1, user_data))
     return;
+  if (! _gimp_wire_write_int32 (channel,
+                                &tile_req->n_tiles, 1, user_data))
+    return;
 }
 
 static void
@@ -854,6 +860,9 @@ _gp_tile_data_read (GIOChannel      *channel,
   if (! _gimp_wire_read_int32 (channel,
                                &tile_data->use_shm, 1, user_data))
     goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               &tile_data->n_tiles, 1, user_data))
+    goto cleanup;
 
   if (!tile_data->use_shm)
     {
@@ -905,6 +914,9 @@ _gp_tile_data_write (GIOChannel      *channel,
   if (! _gimp_wire_write_int32 (channel,
                                 &tile_data->use_shm, 1, user_data))
     return;
+  if (! _gimp_wire_write_int32 (channel,
+                                &tile_data->n_tiles, 1, user_data))
+    return;
 
   if (!tile_data->use_shm)
     {
@@ -26,7 +26,14 @@ G_BEGIN_DECLS
 
 /* Increment every time the protocol changes
  */
-#define GIMP_PROTOCOL_VERSION  0x0119
+#define GIMP_PROTOCOL_VERSION  0x011A
+
+
+/* The maximum number of tiles transferred by a single GP_TILE_REQ /
+ * GP_TILE_DATA exchange.  The shared memory segment is big enough for
+ * that many tiles of the largest pixel size.
+ */
+#define GP_TILE_BATCH_SIZE  16
 
 
 enum
@@ -168,6 +175,12 @@ struct _GPTileReq
   gint32   drawable_id;
   guint32  tile_num;
   guint32  shadow;
+
+  /* Since protocol version 0x011A:
+   * the request covers n_tiles consecutive tiles of the same tile row,
+   * starting at tile_num.
+   */
+  guint32  n_tiles;
 };
 
 struct _GPTileData
@@ -179,6 +192,13 @@ struct _GPTileData
   guint32  width;
   guint32  height;
   guint32  use_shm;
+
+  /* Since protocol version 0x011A:
+   * width and height are the size of the rectangle covered by all the
+   * tiles, whose pixels are transferred with a rowstride of width * bpp.
+   */
+  guint32  n_tiles;
+
   guchar  *data;
 };
 
@@ -39,4 +39,9 @@
                                    (b) * GIMP_RGB_LUMINANCE_BLUE)
 
 
+/* Statistics of the lcms transform cache, for the dashboard */
+guint64   _gimp_color_transform_get_cache_size      (void);
+gdouble   _gimp_color_transform_get_cache_hit_ratio (void);
+
+
 #endif  /* __GIMP_COLOR_PRIVATE_H__ */
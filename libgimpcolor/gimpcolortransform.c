@@ -35,6 +35,7 @@
 
 #include "gimpcolortypes.h"
 
+#include "gimpcolor-private.h"
 #include "gimpcolorprofile.h"
 #include "gimpcolortransform.h"
 
@@ -58,6 +59,20 @@
  **/
 
 
+/* buffers are processed in bands of about this many pixels, and
+ * progress is reported after each band
+ */
+#define PIXELS_PER_BAND (1024 * 1024)
+
+#define PIXELS_PER_THREAD \
+  (/* each thread costs as much as */ 64.0 * 64.0 /* pixels */)
+
+/* the estimated size of the lcms transforms which are kept around
+ * after their last user is gone, see transform_cache_release()
+ */
+#define TRANSFORM_CACHE_MAX_SIZE (16 * 1024 * 1024)
+
+
 enum
 {
   PROGRESS,
@@ -65,22 +80,50 @@ enum
 };
 
 
+typedef struct _TransformCacheEntry TransformCacheEntry;
+
+struct _TransformCacheEntry
+{
+  gchar         *key;
+  cmsHTRANSFORM  transform;
+  gsize          size;
+  gint           ref_count;
+  GList          idle_link;
+};
+
+
 struct _GimpColorTransform
 {
-  GObject           parent_instance;
+  GObject              parent_instance;
 
-  GimpColorProfile *src_profile;
-  const Babl       *src_format;
+  GimpColorProfile    *src_profile;
+  const Babl          *src_format;
 
-  GimpColorProfile *dest_profile;
-  const Babl       *dest_format;
+  GimpColorProfile    *dest_profile;
+  const Babl          *dest_format;
 
-  cmsHTRANSFORM     transform;
-  const Babl       *fish;
+  cmsHTRANSFORM        transform;
+  TransformCacheEntry *cache_entry;
+  const Babl          *fish;
 };
 
 
-static void   gimp_color_transform_finalize (GObject *object);
+typedef struct
+{
+  GimpColorTransform *transform;
+  GeglBuffer         *src_buffer;
+  const Babl         *src_format;
+  GeglBuffer         *dest_buffer;
+  const Babl         *dest_format;
+  gint                offset_x;
+  gint                offset_y;
+} ProcessBufferData;
+
+
+static void   gimp_color_transform_finalize     (GObject             *object);
+
+static void   gimp_color_transform_process_area (const GeglRectangle *area,
+                                                 ProcessBufferData   *data);
 
 
 G_DEFINE_TYPE (GimpColorTransform, gimp_color_transform, G_TYPE_OBJECT)
@@ -91,6 +134,18 @@ static guint gimp_color_transform_signals[LAST_SIGNAL] = { 0 };
 
 static gchar *lcms_last_error = NULL;
 
+/*  lcms transforms are shared by all color transforms using the same
+ *  profiles, intents, flags and formats.  entries are reference
+ *  counted, and unused entries are kept in an LRU list, most recently
+ *  used first, until they exceed TRANSFORM_CACHE_MAX_SIZE.
+ */
+static GMutex      transform_cache_mutex;
+static GHashTable *transform_cache          = NULL;
+static GQueue      transform_cache_idle     = G_QUEUE_INIT;
+static gsize       transform_cache_size     = 0;
+static gint        transform_cache_n_hits   = 0;
+static gint        transform_cache_n_misses = 0;
+
 
 static void
 lcms_error_clear (void)
@@ -112,6 +167,206 @@ lcms_error_handler (cmsContext       ContextID,
   lcms_last_error = g_strdup_printf ("lcms2 error %d: %s", ErrorCode, text);
 }
 
+static gchar *
+transform_cache_profile_checksum (GimpColorProfile *profile)
+{
+  const gsize   header_len = sizeof (cmsICCHeader);
+  const guint8 *data;
+  gsize         length;
+
+  /*  skip the header, like gimp_color_profile_is_equal() does  */
+  data = gimp_color_profile_get_icc_profile (profile, &length);
+
+  return g_compute_checksum_for_data (G_CHECKSUM_SHA1,
+                                      data + header_len,
+                                      length - header_len);
+}
+
+static gchar *
+transform_cache_key_new (GimpColorProfile *src_profile,
+                         const Babl       *src_format,
+                         GimpColorProfile *dest_profile,
+                         const Babl       *dest_format,
+                         GimpColorProfile *proof_profile,
+                         gint              intent,
+                         gint              proof_intent,
+                         guint             flags)
+{
+  gchar   *src_checksum;
+  gchar   *dest_checksum;
+  gchar   *proof_checksum = NULL;
+  GString *key;
+
+  src_checksum  = transform_cache_profile_checksum (src_profile);
+  dest_checksum = transform_cache_profile_checksum (dest_profile);
+
+  if (proof_profile)
+    proof_checksum = transform_cache_profile_checksum (proof_profile);
+
+  key = g_string_new (NULL);
+
+  g_string_printf (key, "%s %s %s %d %d %u %s %s",
+                   src_checksum,
+                   dest_checksum,
+                   proof_checksum ? proof_checksum : "-",
+                   intent, proof_intent, flags,
+                   babl_get_name (src_format),
+                   babl_get_name (dest_format));
+
+  /*  gamut-check transforms bake in the alarm codes set when they are
+   *  created, see cmsSetAlarmCodes()
+   */
+  if (flags & GIMP_COLOR_TRANSFORM_FLAGS_GAMUT_CHECK)
+    {
+      cmsUInt16Number alarm_codes[cmsMAXCHANNELS];
+      gint            i;
+
+      cmsGetAlarmCodes (alarm_codes);
+
+      for (i = 0; i < cmsMAXCHANNELS; i++)
+        g_string_append_printf (key, " %04x", alarm_codes[i]);
+    }
+
+  g_free (src_checksum);
+  g_free (dest_checksum);
+  g_free (proof_checksum);
+
+  return g_string_free (key, FALSE);
+}
+
+static gsize
+transform_cache_estimate_size (cmsUInt32Number lcms_src_format,
+                               cmsUInt32Number lcms_dest_format,
+                               guint           flags)
+{
+  gint  n_src_channels  = T_CHANNELS (lcms_src_format);
+  gint  n_dest_channels = T_CHANNELS (lcms_dest_format);
+  gint  n_grid_points;
+  gsize size;
+  gint  i;
+
+  if (flags & cmsFLAGS_NOOPTIMIZE)
+    return 4096;
+
+  /*  lcms optimizes most transforms into a 16 bit CLUT, with the
+   *  number of grid points depending on the input channels, see
+   *  _cmsReasonableGridpointsByColorspace()
+   */
+  n_grid_points = n_src_channels > 3 ? 17 : 33;
+
+  size = n_dest_channels * sizeof (guint16);
+
+  for (i = 0; i < n_src_channels; i++)
+    size *= n_grid_points;
+
+  return size + 4096;
+}
+
+static void
+transform_cache_entry_free (TransformCacheEntry *entry)
+{
+  cmsDeleteTransform (entry->transform);
+  g_free (entry->key);
+
+  g_slice_free (TransformCacheEntry, entry);
+}
+
+static TransformCacheEntry *
+transform_cache_lookup (const gchar *key)
+{
+  TransformCacheEntry *entry = NULL;
+
+  g_mutex_lock (&transform_cache_mutex);
+
+  if (transform_cache)
+    entry = g_hash_table_lookup (transform_cache, key);
+
+  if (entry)
+    {
+      if (entry->ref_count++ == 0)
+        g_queue_unlink (&transform_cache_idle, &entry->idle_link);
+
+      g_atomic_int_inc (&transform_cache_n_hits);
+    }
+  else
+    {
+      g_atomic_int_inc (&transform_cache_n_misses);
+    }
+
+  g_mutex_unlock (&transform_cache_mutex);
+
+  return entry;
+}
+
+static TransformCacheEntry *
+transform_cache_insert (gchar         *key,
+                        cmsHTRANSFORM  transform,
+                        gsize          size)
+{
+  TransformCacheEntry *entry;
+
+  g_mutex_lock (&transform_cache_mutex);
+
+  if (! transform_cache)
+    transform_cache = g_hash_table_new (g_str_hash, g_str_equal);
+
+  entry = g_hash_table_lookup (transform_cache, key);
+
+  if (entry)
+    {
+      /*  another thread created the same transform meanwhile  */
+      if (entry->ref_count++ == 0)
+        g_queue_unlink (&transform_cache_idle, &entry->idle_link);
+
+      cmsDeleteTransform (transform);
+      g_free (key);
+    }
+  else
+    {
+      entry = g_slice_new0 (TransformCacheEntry);
+
+      entry->key            = key;
+      entry->transform      = transform;
+      entry->size           = size;
+      entry->ref_count      = 1;
+      entry->idle_link.data = entry;
+
+      g_hash_table_insert (transform_cache, entry->key, entry);
+
+      transform_cache_size += size;
+    }
+
+  g_mutex_unlock (&transform_cache_mutex);
+
+  return entry;
+}
+
+static void
+transform_cache_release (TransformCacheEntry *entry)
+{
+  g_mutex_lock (&transform_cache_mutex);
+
+  if (--entry->ref_count == 0)
+    {
+      g_queue_push_head_link (&transform_cache_idle, &entry->idle_link);
+
+      while (transform_cache_size > TRANSFORM_CACHE_MAX_SIZE &&
+             transform_cache_idle.tail)
+        {
+          GList *link = g_queue_pop_tail_link (&transform_cache_idle);
+
+          entry = link->data;
+
+          g_hash_table_remove (transform_cache, entry->key);
+          transform_cache_size -= entry->size;
+
+          transform_cache_entry_free (entry);
+        }
+    }
+
+  g_mutex_unlock (&transform_cache_mutex);
+}
+
 static void
 gimp_color_transform_class_init (GimpColorTransformClass *klass)
 {
@@ -144,7 +399,13 @@ gimp_color_transform_finalize (GObject *object)
   g_clear_object (&transform->src_profile);
   g_clear_object (&transform->dest_profile);
 
-  g_clear_pointer (&transform->transform, cmsDeleteTransform);
+  if (transform->cache_entry)
+    {
+      transform_cache_release (transform->cache_entry);
+
+      transform->cache_entry = NULL;
+      transform->transform   = NULL;
+    }
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -191,6 +452,7 @@ gimp_color_transform_new (GimpColorProfile         *src_profile,
   cmsHPROFILE         dest_lcms;
   cmsUInt32Number     lcms_src_format;
   cmsUInt32Number     lcms_dest_format;
+  gchar              *key;
   GError             *error = NULL;
 
   g_return_val_if_fail (GIMP_IS_COLOR_PROFILE (src_profile), NULL);
@@ -254,6 +516,22 @@ gimp_color_transform_new (GimpColorProfile         *src_profile,
   transform->dest_format = gimp_color_profile_get_lcms_format (dest_format,
                                                                &lcms_dest_format);
 
+  key = transform_cache_key_new (src_profile,  transform->src_format,
+                                 dest_profile, transform->dest_format,
+                                 NULL,
+                                 rendering_intent, 0, flags);
+
+  transform->cache_entry = transform_cache_lookup (key);
+
+  if (transform->cache_entry)
+    {
+      transform->transform = transform->cache_entry->transform;
+
+      g_free (key);
+
+      return transform;
+    }
+
   src_lcms  = gimp_color_profile_get_lcms_profile (src_profile);
   dest_lcms = gimp_color_profile_get_lcms_profile (dest_profile);
 
@@ -276,6 +554,21 @@ gimp_color_transform_new (GimpColorProfile         *src_profile,
       g_printerr ("%s: %s\n", G_STRFUNC, lcms_last_error);
     }
 
+  if (transform->transform)
+    {
+      transform->cache_entry =
+        transform_cache_insert (key, transform->transform,
+                                transform_cache_estimate_size (lcms_src_format,
+                                                               lcms_dest_format,
+                                                               flags));
+
+      transform->transform = transform->cache_entry->transform;
+    }
+  else
+    {
+      g_free (key);
+    }
+
   if (! transform->transform)
     {
       g_object_unref (transform);
@@ -321,6 +614,7 @@ gimp_color_transform_new_proofing (GimpColorProfile         *src_profile,
   cmsHPROFILE         proof_lcms;
   cmsUInt32Number     lcms_src_format;
   cmsUInt32Number     lcms_dest_format;
+  gchar              *key;
 
   g_return_val_if_fail (GIMP_IS_COLOR_PROFILE (src_profile), NULL);
   g_return_val_if_fail (src_format != NULL, NULL);
@@ -345,6 +639,22 @@ gimp_color_transform_new_proofing (GimpColorProfile         *src_profile,
   transform->dest_format = gimp_color_profile_get_lcms_format (dest_format,
                                                                &lcms_dest_format);
 
+  key = transform_cache_key_new (src_profile,  transform->src_format,
+                                 dest_profile, transform->dest_format,
+                                 proof_profile,
+                                 display_intent, proof_intent, flags);
+
+  transform->cache_entry = transform_cache_lookup (key);
+
+  if (transform->cache_entry)
+    {
+      transform->transform = transform->cache_entry->transform;
+
+      g_free (key);
+
+      return transform;
+    }
+
   lcms_error_clear ();
 
   transform->transform = cmsCreateProofingTransform (src_lcms,  lcms_src_format,
@@ -367,6 +677,21 @@ gimp_color_transform_new_proofing (GimpColorProfile         *src_profile,
       g_printerr ("%s: %s\n", G_STRFUNC, lcms_last_error);
     }
 
+  if (transform->transform)
+    {
+      transform->cache_entry =
+        transform_cache_insert (key, transform->transform,
+                                transform_cache_estimate_size (lcms_src_format,
+                                                               lcms_dest_format,
+                                                               flags));
+
+      transform->transform = transform->cache_entry->transform;
+    }
+  else
+    {
+      g_free (key);
+    }
+
   if (! transform->transform)
     {
       g_object_unref (transform);
@@ -469,6 +794,68 @@ gimp_color_transform_process_pixels (GimpColorTransform *transform,
     }
 }
 
+static void
+gimp_color_transform_process_area (const GeglRectangle *area,
+                                   ProcessBufferData   *data)
+{
+  GimpColorTransform *transform = data->transform;
+  GeglBufferIterator *iter;
+  GeglRectangle       dest_area;
+
+  dest_area.x      = area->x + data->offset_x;
+  dest_area.y      = area->y + data->offset_y;
+  dest_area.width  = area->width;
+  dest_area.height = area->height;
+
+  if (data->src_buffer != data->dest_buffer)
+    {
+      iter = gegl_buffer_iterator_new (data->src_buffer, area, 0,
+                                       data->src_format,
+                                       GEGL_ACCESS_READ,
+                                       GEGL_ABYSS_NONE, 2);
+
+      gegl_buffer_iterator_add (iter, data->dest_buffer, &dest_area, 0,
+                                data->dest_format,
+                                GEGL_ACCESS_WRITE,
+                                GEGL_ABYSS_NONE);
+
+      while (gegl_buffer_iterator_next (iter))
+        {
+          if (transform->transform)
+            {
+              cmsDoTransform (transform->transform,
+                              iter->items[0].data, iter->items[1].data, iter->length);
+            }
+          else
+            {
+              babl_process (transform->fish,
+                            iter->items[0].data, iter->items[1].data, iter->length);
+            }
+        }
+    }
+  else
+    {
+      iter = gegl_buffer_iterator_new (data->src_buffer, area, 0,
+                                       data->src_format,
+                                       GEGL_ACCESS_READWRITE,
+                                       GEGL_ABYSS_NONE, 1);
+
+      while (gegl_buffer_iterator_next (iter))
+        {
+          if (transform->transform)
+            {
+              cmsDoTransform (transform->transform,
+                              iter->items[0].data, iter->items[0].data, iter->length);
+            }
+          else
+            {
+              babl_process (transform->fish,
+                            iter->items[0].data, iter->items[0].data, iter->length);
+            }
+        }
+    }
+}
+
 /**
  * gimp_color_transform_process_buffer:
  * @transform:   a #GimpColorTransform
@@ -484,6 +871,10 @@ gimp_color_transform_process_pixels (GimpColorTransform *transform,
  * spaces are ignored. The transform always takes place between the
  * color spaces determined by @transform's color profiles.
  *
+ * Large buffers are processed by multiple threads; the
+ * #GimpColorTransform::progress signal is always emitted from the
+ * calling thread.
+ *
  * Since: 2.10
  **/
 void
@@ -493,25 +884,21 @@ gimp_color_transform_process_buffer (GimpColorTransform  *transform,
                                      GeglBuffer          *dest_buffer,
                                      const GeglRectangle *dest_rect)
 {
-  const Babl         *src_format;
-  const Babl         *dest_format;
-  GeglBufferIterator *iter;
-  gint                total_pixels;
-  gint                done_pixels = 0;
+  ProcessBufferData data;
+  const Babl       *src_format;
+  const Babl       *dest_format;
+  GeglRectangle     rect;
+  gint              band_height;
+  gint              y;
 
   g_return_if_fail (GIMP_IS_COLOR_TRANSFORM (transform));
   g_return_if_fail (GEGL_IS_BUFFER (src_buffer));
   g_return_if_fail (GEGL_IS_BUFFER (dest_buffer));
 
   if (src_rect)
-    {
-      total_pixels = src_rect->width * src_rect->height;
-    }
+    rect = *src_rect;
   else
-    {
-      total_pixels = (gegl_buffer_get_width  (src_buffer) *
-                      gegl_buffer_get_height (src_buffer));
-    }
+    rect = *gegl_buffer_get_extent (src_buffer);
 
   /* we must not do any babl color transforms when reading from
    * src_buffer or writing to dest_buffer, so construct formats with
@@ -528,64 +915,46 @@ gimp_color_transform_process_buffer (GimpColorTransform  *transform,
     babl_format_with_space ((const gchar *) transform->dest_format,
                             babl_format_get_space (dest_format));
 
-  if (src_buffer != dest_buffer)
-    {
-      iter = gegl_buffer_iterator_new (src_buffer, src_rect, 0,
-                                       src_format,
-                                       GEGL_ACCESS_READ,
-                                       GEGL_ABYSS_NONE, 2);
-
-      gegl_buffer_iterator_add (iter, dest_buffer, dest_rect, 0,
-                                dest_format,
-                                GEGL_ACCESS_WRITE,
-                                GEGL_ABYSS_NONE);
-
-      while (gegl_buffer_iterator_next (iter))
-        {
-          if (transform->transform)
-            {
-              cmsDoTransform (transform->transform,
-                              iter->items[0].data, iter->items[1].data, iter->length);
-            }
-          else
-            {
-              babl_process (transform->fish,
-                            iter->items[0].data, iter->items[1].data, iter->length);
-            }
-
-          done_pixels += iter->items[0].roi.width * iter->items[0].roi.height;
+  data.transform   = transform;
+  data.src_buffer  = src_buffer;
+  data.src_format  = src_format;
+  data.dest_buffer = dest_buffer;
+  data.dest_format = dest_format;
 
-          g_signal_emit (transform, gimp_color_transform_signals[PROGRESS], 0,
-                         (gdouble) done_pixels /
-                         (gdouble) total_pixels);
-        }
+  if (dest_rect)
+    {
+      data.offset_x = dest_rect->x - rect.x;
+      data.offset_y = dest_rect->y - rect.y;
     }
   else
     {
-      iter = gegl_buffer_iterator_new (src_buffer, src_rect, 0,
-                                       src_format,
-                                       GEGL_ACCESS_READWRITE,
-                                       GEGL_ABYSS_NONE, 1);
+      data.offset_x = gegl_buffer_get_x (dest_buffer) - rect.x;
+      data.offset_y = gegl_buffer_get_y (dest_buffer) - rect.y;
+    }
 
-      while (gegl_buffer_iterator_next (iter))
-        {
-          if (transform->transform)
-            {
-              cmsDoTransform (transform->transform,
-                              iter->items[0].data, iter->items[0].data, iter->length);
-            }
-          else
-            {
-              babl_process (transform->fish,
-                            iter->items[0].data, iter->items[0].data, iter->length);
-            }
+  band_height = MAX (PIXELS_PER_BAND / MAX (rect.width, 1), 1);
+
+  /* the bands are processed one after the other, each distributed
+   * across threads, so that progress is emitted from the calling
+   * thread.
+   */
+  for (y = rect.y; y < rect.y + rect.height; y += band_height)
+    {
+      GeglRectangle band;
 
-          done_pixels += iter->items[0].roi.width * iter->items[0].roi.height;
+      band.x      = rect.x;
+      band.y      = y;
+      band.width  = rect.width;
+      band.height = MIN (band_height, rect.y + rect.height - y);
 
-          g_signal_emit (transform, gimp_color_transform_signals[PROGRESS], 0,
-                         (gdouble) done_pixels /
-                         (gdouble) total_pixels);
-        }
+      gegl_parallel_distribute_area (
+        &band, PIXELS_PER_THREAD, GEGL_SPLIT_STRATEGY_AUTO,
+        (GeglParallelDistributeAreaFunc) gimp_color_transform_process_area,
+        &data);
+
+      g_signal_emit (transform, gimp_color_transform_signals[PROGRESS], 0,
+                     (gdouble) (band.y + band.height - rect.y) /
+                     (gdouble) rect.height);
     }
 
   g_signal_emit (transform, gimp_color_transform_signals[PROGRESS], 0,
@@ -627,3 +996,55 @@ gimp_color_transform_can_gegl_copy (GimpColorProfile *src_profile,
 
   return FALSE;
 }
+
+/**
+ * _gimp_color_transform_get_cache_size:
+ *
+ * This function is for internal use only.
+ *
+ * Returns: the estimated size of the cached lcms transforms.
+ **/
+guint64
+_gimp_color_transform_get_cache_size (void)
+{
+  guint64 size;
+
+  g_mutex_lock (&transform_cache_mutex);
+
+  size = transform_cache_size;
+
+  g_mutex_unlock (&transform_cache_mutex);
+
+  return size;
+}
+
+/**
+ * _gimp_color_transform_get_cache_hit_ratio:
+ *
+ * This function is for internal use only.
+ *
+ * Returns: the ratio of the lcms transform lookups since the last
+ *          call which were found in the cache.
+ **/
+gdouble
+_gimp_color_transform_get_cache_hit_ratio (void)
+{
+  static guint   last_n_hits   = 0;
+  static guint   last_n_misses = 0;
+  static gdouble hit_ratio     = 0.0;
+  guint          n_hits;
+  guint          n_misses;
+
+  n_hits   = g_atomic_int_get (&transform_cache_n_hits)   - last_n_hits;
+  n_misses = g_atomic_int_get (&transform_cache_n_misses) - last_n_misses;
+
+  if (n_hits + n_misses > 0)
+    {
+      hit_ratio = (gdouble) n_hits / (n_hits + n_misses);
+
+      last_n_hits   += n_hits;
+      last_n_misses += n_misses;
+    }
+
+  return hit_ratio;
+}
@@ -47,22 +47,46 @@
 /* See bugs #63610 and #61088 for a discussion about the quality settings */
 #define DEFAULT_RESTART_MCU_ROWS 16
 
+/* The size preview of large images first encodes a sample of bands of
+ * rows, of about PREVIEW_SAMPLE_PIXELS pixels, to estimate the size
+ * while the whole image is encoded.
+ */
+#define PREVIEW_SAMPLE_PIXELS    (1024 * 1024)
+#define PREVIEW_BAND_HEIGHT      16
+#define PREVIEW_POLL_INTERVAL    50
+
+
+typedef enum
+{
+  PREVIEW_ESTIMATED = 1 << 0,
+  PREVIEW_DONE      = 1 << 1
+} PreviewState;
+
+typedef struct
+{
+  struct jpeg_destination_mgr pub;
+  JOCTET                      buffer[4096];
+  gsize                       size;
+} CountDestination;
 
 typedef struct
 {
   struct jpeg_compress_struct cinfo;
-  struct jpeg_error_mgr jerr;
-  gint          tile_height;
+  struct jpeg_compress_struct sample_cinfo;
+  CountDestination            sample_dest;
+  struct my_error_mgr         jerr;
   FILE         *outfile;
-  gboolean      has_alpha;
-  gint          rowstride;
-  guchar       *data;
-  guchar       *src;
   GeglBuffer   *buffer;
   const Babl   *format;
   GFile        *file;
-  gboolean      abort_me;
+  GThread      *thread;
   guint         source_id;
+  gint          sample_step;
+  gint          cancelled;
+  gint          state;
+  goffset       estimate;
+  gboolean      estimate_shown;
+  gboolean      failed;
 } PreviewPersistent;
 
 
@@ -76,53 +100,296 @@ static void  use_orig_qual_changed     (GimpProcedureConfig *config);
 static void  use_orig_qual_changed_rgb (GimpProcedureConfig *config);
 
 
-static GtkWidget         *preview_size  = NULL;
-static PreviewPersistent *prev_p        = NULL;
+static GtkWidget         *preview_size    = NULL;
+static PreviewPersistent *prev_p          = NULL;
+static GList             *preview_workers = NULL;
+static GeglBuffer        *preview_source  = NULL;
+
+
+static void
+count_init_destination (j_compress_ptr cinfo)
+{
+  CountDestination *dest = (CountDestination *) cinfo->dest;
+
+  dest->pub.next_output_byte = dest->buffer;
+  dest->pub.free_in_buffer   = sizeof (dest->buffer);
+}
+
+static boolean
+count_empty_output_buffer (j_compress_ptr cinfo)
+{
+  CountDestination *dest = (CountDestination *) cinfo->dest;
+
+  dest->size += sizeof (dest->buffer);
 
+  count_init_destination (cinfo);
 
-/*
- * sg - This is the best I can do, I'm afraid... I think it will fail
- * if something bad really happens (but it might not). If you have a
- * better solution, send it ;-)
+  return TRUE;
+}
+
+static void
+count_term_destination (j_compress_ptr cinfo)
+{
+}
+
+static gsize
+count_get_size (j_compress_ptr cinfo)
+{
+  CountDestination *dest = (CountDestination *) cinfo->dest;
+
+  return dest->size + sizeof (dest->buffer) - dest->pub.free_in_buffer;
+}
+
+/* Returns which bands of rows to sample, 0 if the image is small enough
+ * to be encoded right away.
+ */
+static gint
+get_sample_step (gint width,
+                 gint height)
+{
+  gint64 n_pixels = (gint64) width * height;
+
+  if (n_pixels < 4 * PREVIEW_SAMPLE_PIXELS)
+    return 0;
+
+  return n_pixels / PREVIEW_SAMPLE_PIXELS;
+}
+
+static gint
+get_sample_rows (gint height,
+                 gint step)
+{
+  gint rows = 0;
+  gint y;
+
+  for (y = 0; y < height; y += PREVIEW_BAND_HEIGHT * step)
+    rows += MIN (PREVIEW_BAND_HEIGHT, height - y);
+
+  return rows;
+}
+
+/* Sets up @sample to compress @rows rows like @cinfo, whose parameters
+ * are all set.
  */
 static void
-background_error_exit (j_common_ptr cinfo)
+copy_compress_parameters (j_compress_ptr sample,
+                          j_compress_ptr cinfo,
+                          gint           rows)
 {
-  if (prev_p)
-    prev_p->abort_me = TRUE;
-  (*cinfo->err->output_message) (cinfo);
+  gint i;
+
+  sample->image_width      = cinfo->image_width;
+  sample->image_height     = rows;
+  sample->input_components = cinfo->input_components;
+  sample->in_color_space   = cinfo->in_color_space;
+
+  jpeg_set_defaults (sample);
+  jpeg_set_colorspace (sample, cinfo->jpeg_color_space);
+
+  for (i = 0; i < NUM_QUANT_TBLS; i++)
+    {
+      if (cinfo->quant_tbl_ptrs[i])
+        {
+          guint table[DCTSIZE2];
+          gint  j;
+
+          for (j = 0; j < DCTSIZE2; j++)
+            table[j] = cinfo->quant_tbl_ptrs[i]->quantval[j];
+
+          jpeg_add_quant_table (sample, i, table, 100, FALSE);
+        }
+    }
+
+  for (i = 0; i < cinfo->num_components; i++)
+    {
+      sample->comp_info[i].h_samp_factor = cinfo->comp_info[i].h_samp_factor;
+      sample->comp_info[i].v_samp_factor = cinfo->comp_info[i].v_samp_factor;
+      sample->comp_info[i].quant_tbl_no  = cinfo->comp_info[i].quant_tbl_no;
+    }
+
+  sample->arith_code       = cinfo->arith_code;
+  sample->optimize_coding  = cinfo->optimize_coding;
+  sample->smoothing_factor = cinfo->smoothing_factor;
+  sample->restart_interval = cinfo->restart_interval;
+  sample->restart_in_rows  = cinfo->restart_in_rows;
+  sample->dct_method       = cinfo->dct_method;
+
+  if (cinfo->scan_info)
+    jpeg_simple_progression (sample);
 }
 
-static gboolean
-background_jpeg_save (PreviewPersistent *pp)
+static void
+preview_write_rows (PreviewPersistent *pp,
+                    j_compress_ptr     cinfo,
+                    guchar            *data,
+                    gint               y,
+                    gint               rows)
 {
-  gint yend;
+  gint rowstride = cinfo->input_components * cinfo->image_width;
+  gint i;
+
+  gegl_buffer_get (pp->buffer,
+                   GEGL_RECTANGLE (0, y, cinfo->image_width, rows),
+                   1.0,
+                   pp->format,
+                   data,
+                   GEGL_AUTO_ROWSTRIDE,
+                   GEGL_ABYSS_NONE);
+
+  for (i = 0; i < rows; i++)
+    {
+      JSAMPROW row = data + i * rowstride;
+
+      jpeg_write_scanlines (cinfo, &row, 1);
+    }
+}
 
-  if (pp->abort_me || (pp->cinfo.next_scanline >= pp->cinfo.image_height))
+/* Encodes the preview in a thread of its own, from a local copy of the
+ * pixels.  Nothing here may go through the plug-in wire.
+ */
+static gpointer
+preview_thread (PreviewPersistent *pp)
+{
+  j_compress_ptr  cinfo  = &pp->cinfo;
+  j_compress_ptr  sample = &pp->sample_cinfo;
+  guchar         *data;
+  gint            height = cinfo->image_height;
+  gint            y;
+
+  data = g_new (guchar, cinfo->input_components * cinfo->image_width *
+                        PREVIEW_BAND_HEIGHT);
+
+  if (setjmp (pp->jerr.setjmp_buffer))
     {
-      /* clean up... */
-      if (pp->abort_me)
+      pp->failed = TRUE;
+
+      g_free (data);
+      g_atomic_int_or (&pp->state, PREVIEW_DONE);
+
+      return NULL;
+    }
+
+  if (pp->sample_step > 0)
+    {
+      gsize header;
+
+      jpeg_start_compress (sample, TRUE);
+
+      header = count_get_size (sample);
+
+      for (y = 0;
+           y < height && ! g_atomic_int_get (&pp->cancelled);
+           y += PREVIEW_BAND_HEIGHT * pp->sample_step)
         {
-          jpeg_abort_compress (&(pp->cinfo));
+          preview_write_rows (pp, sample, data, y,
+                              MIN (PREVIEW_BAND_HEIGHT, height - y));
+        }
+
+      if (g_atomic_int_get (&pp->cancelled))
+        {
+          jpeg_abort_compress (sample);
         }
       else
         {
-          jpeg_finish_compress (&(pp->cinfo));
+          jpeg_finish_compress (sample);
+
+          /* Leave the headers out of the scaling */
+          pp->estimate = header +
+                         (gdouble) (count_get_size (sample) - header) *
+                         height / sample->image_height;
+
+          g_atomic_int_or (&pp->state, PREVIEW_ESTIMATED);
         }
+    }
+
+  for (y = 0;
+       y < height && ! g_atomic_int_get (&pp->cancelled);
+       y += PREVIEW_BAND_HEIGHT)
+    {
+      preview_write_rows (pp, cinfo, data, y,
+                          MIN (PREVIEW_BAND_HEIGHT, height - y));
+    }
+
+  if (g_atomic_int_get (&pp->cancelled))
+    jpeg_abort_compress (cinfo);
+  else
+    jpeg_finish_compress (cinfo);
 
-      fclose (pp->outfile);
-      jpeg_destroy_compress (&(pp->cinfo));
+  g_free (data);
+  g_atomic_int_or (&pp->state, PREVIEW_DONE);
 
-      g_free (pp->data);
+  return NULL;
+}
 
-      if (pp->buffer)
-        g_object_unref (pp->buffer);
+static void
+preview_set_size (goffset  size,
+                  gboolean estimated)
+{
+  gchar *size_text = g_format_size (size);
+  gchar *text;
+
+  if (estimated)
+    text = g_strdup_printf (_("File size without metadata: about %s"), size_text);
+  else
+    text = g_strdup_printf (_("File size without metadata: %s"), size_text);
+
+  gtk_label_set_text (GTK_LABEL (preview_size), text);
+
+  g_free (size_text);
+  g_free (text);
+}
+
+static void
+preview_free (PreviewPersistent *pp)
+{
+  if (pp->source_id)
+    g_source_remove (pp->source_id);
+
+  g_thread_join (pp->thread);
+
+  jpeg_destroy_compress (&pp->cinfo);
+
+  if (pp->sample_step > 0)
+    jpeg_destroy_compress (&pp->sample_cinfo);
+
+  fclose (pp->outfile);
+
+  g_file_delete (pp->file, NULL, NULL);
+  g_object_unref (pp->file);
+  g_object_unref (pp->buffer);
+
+  preview_workers = g_list_remove (preview_workers, pp);
+
+  g_free (pp);
+}
+
+static gboolean
+preview_poll (PreviewPersistent *pp)
+{
+  gint state = g_atomic_int_get (&pp->state);
+
+  if (! (state & PREVIEW_DONE))
+    {
+      if (pp == prev_p && (state & PREVIEW_ESTIMATED) && ! pp->estimate_shown)
+        {
+          preview_set_size (pp->estimate, TRUE);
+
+          pp->estimate_shown = TRUE;
+        }
+
+      return G_SOURCE_CONTINUE;
+    }
+
+  pp->source_id = 0;
+
+  if (pp == prev_p)
+    {
+      prev_p = NULL;
 
       /* display the preview stuff */
-      if (! pp->abort_me)
+      if (! pp->failed)
         {
           GFileInfo *info;
-          gchar     *text;
           GError    *error = NULL;
 
           info = g_file_query_info (pp->file,
@@ -132,64 +399,37 @@ background_jpeg_save (PreviewPersistent *pp)
 
           if (info)
             {
-              goffset  size = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_STANDARD_SIZE);
-              gchar   *size_text;
-
-              size_text = g_format_size (size);
-              text = g_strdup_printf (_("File size without metadata: %s"), size_text);
-              g_free (size_text);
-
+              preview_set_size (g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_STANDARD_SIZE),
+                                FALSE);
               g_object_unref (info);
             }
           else
             {
+              gchar *text;
+
               text = g_strdup_printf (_("File size without metadata: %s"), error->message);
+              gtk_label_set_text (GTK_LABEL (preview_size), text);
+              g_free (text);
               g_clear_error (&error);
             }
 
-          gtk_label_set_text (GTK_LABEL (preview_size), text);
-          g_free (text);
-
           /* and load the preview */
           load_image (pp->file, GIMP_RUN_NONINTERACTIVE,
                       TRUE, NULL, NULL, NULL);
         }
-
-      /* we cleanup here (load_image doesn't run in the background) */
-      g_file_delete (pp->file, NULL, NULL);
-      g_object_unref (pp->file);
-
-      g_free (pp);
-      prev_p = NULL;
+      else
+        {
+          gtk_label_set_text (GTK_LABEL (preview_size),
+                              _("File size without metadata: unknown"));
+        }
 
       gimp_displays_flush ();
       gdk_display_flush (gdk_display_get_default ());
-
-      return FALSE;
     }
-  else
-    {
-      if ((pp->cinfo.next_scanline % pp->tile_height) == 0)
-        {
-          yend = pp->cinfo.next_scanline + pp->tile_height;
-          yend = MIN (yend, pp->cinfo.image_height);
-          gegl_buffer_get (pp->buffer,
-                           GEGL_RECTANGLE (0, pp->cinfo.next_scanline,
-                                           pp->cinfo.image_width,
-                                           (yend - pp->cinfo.next_scanline)),
-                           1.0,
-                           pp->format,
-                           pp->data,
-                           GEGL_AUTO_ROWSTRIDE,
-                           GEGL_ABYSS_NONE);
-          pp->src = pp->data;
-        }
 
-      jpeg_write_scanlines (&(pp->cinfo), (JSAMPARRAY) &(pp->src), 1);
-      pp->src += pp->rowstride;
+  preview_free (pp);
 
-      return TRUE;
-    }
+  return G_SOURCE_REMOVE;
 }
 
 gboolean
@@ -216,7 +456,6 @@ export_image (GFile                *file,
   GimpColorProfile *profile      = NULL;
   GimpColorProfile *cmyk_profile = NULL;
 
-  gboolean         has_alpha;
   gboolean         out_linear = FALSE;
   gint             rowstride, yend;
 
@@ -386,7 +625,6 @@ export_image (GFile                *file,
     case GIMP_RGB_IMAGE:
       /* # of color components per pixel */
       cinfo.input_components = 3;
-      has_alpha = FALSE;
 
       if (out_linear)
         encoding = "RGB u8";
@@ -397,7 +635,6 @@ export_image (GFile                *file,
     case GIMP_GRAY_IMAGE:
       /* # of color components per pixel */
       cinfo.input_components = 1;
-      has_alpha = FALSE;
 
       if (out_linear)
         encoding = "Y u8";
@@ -408,7 +645,6 @@ export_image (GFile                *file,
     case GIMP_RGBA_IMAGE:
       /* # of color components per pixel (minus the GIMP alpha channel) */
       cinfo.input_components = 4 - 1;
-      has_alpha = TRUE;
 
       if (out_linear)
         encoding = "RGB u8";
@@ -419,7 +655,6 @@ export_image (GFile                *file,
     case GIMP_GRAYA_IMAGE:
       /* # of color components per pixel (minus the GIMP alpha channel) */
       cinfo.input_components = 2 - 1;
-      has_alpha = TRUE;
       if (out_linear)
         encoding = "Y u8";
       else
@@ -720,14 +955,6 @@ export_image (GFile                *file,
    * To keep things simple, we pass one scanline per call; you can pass
    * more if you wish, though.
    */
-  /* JSAMPLEs per row in image_buffer */
-  rowstride = cinfo.input_components * cinfo.image_width;
-  data = g_new (guchar, rowstride * gimp_tile_height ());
-
-  /* fault if cinfo.next_scanline isn't initially a multiple of
-   * gimp_tile_height */
-  src = NULL;
-
   /*
    * sg - if we preview, we want this to happen in the background -- do
    * not duplicate code in the future; for now, it's OK
@@ -735,37 +962,78 @@ export_image (GFile                *file,
 
   if (preview)
     {
-      PreviewPersistent *pp = g_new (PreviewPersistent, 1);
+      PreviewPersistent *pp = g_new0 (PreviewPersistent, 1);
+
+      /* The encoding threads can't read the drawable through the
+       * plug-in wire, so the pixels are copied once per dialog, already
+       * converted to the exported format.
+       */
+      if (! preview_source || gegl_buffer_get_format (preview_source) != format)
+        {
+          g_clear_object (&preview_source);
+
+          preview_source = gegl_buffer_new (gegl_buffer_get_extent (buffer),
+                                            format);
+          gegl_buffer_copy (buffer, NULL, GEGL_ABYSS_NONE,
+                            preview_source, NULL);
+        }
 
       /* pass all the information we need */
       pp->cinfo       = cinfo;
-      pp->tile_height = gimp_tile_height();
-      pp->data        = data;
       pp->outfile     = outfile;
-      pp->has_alpha   = has_alpha;
-      pp->rowstride   = rowstride;
-      pp->data        = data;
-      pp->buffer      = buffer;
+      pp->buffer      = g_object_ref (preview_source);
       pp->format      = format;
-      pp->src         = NULL;
       pp->file        = g_object_ref (file);
-      pp->abort_me    = FALSE;
+      pp->sample_step = get_sample_step (cinfo.image_width,
+                                         cinfo.image_height);
+
+      pp->cinfo.err = jpeg_std_error (&pp->jerr.pub);
+      pp->jerr.pub.error_exit = my_error_exit;
+
+      if (pp->sample_step > 0)
+        {
+          pp->sample_cinfo.err = &jerr.pub;
+          jpeg_create_compress (&pp->sample_cinfo);
+
+          copy_compress_parameters (&pp->sample_cinfo, &cinfo,
+                                    get_sample_rows (cinfo.image_height,
+                                                     pp->sample_step));
+
+          pp->sample_dest.pub.init_destination    = count_init_destination;
+          pp->sample_dest.pub.empty_output_buffer = count_empty_output_buffer;
+          pp->sample_dest.pub.term_destination    = count_term_destination;
+
+          pp->sample_cinfo.dest = &pp->sample_dest.pub;
+          pp->sample_cinfo.err  = &pp->jerr.pub;
+        }
+
+      g_object_unref (buffer);
 
       g_warn_if_fail (prev_p == NULL);
       prev_p = pp;
 
-      pp->cinfo.err = jpeg_std_error(&(pp->jerr));
-      pp->jerr.error_exit = background_error_exit;
+      preview_workers = g_list_prepend (preview_workers, pp);
 
       gtk_label_set_text (GTK_LABEL (preview_size),
                           _("Calculating approximate file size..."));
 
-      pp->source_id = g_idle_add ((GSourceFunc) background_jpeg_save, pp);
+      pp->thread    = g_thread_new ("jpeg-preview",
+                                    (GThreadFunc) preview_thread, pp);
+      pp->source_id = g_timeout_add (PREVIEW_POLL_INTERVAL,
+                                     (GSourceFunc) preview_poll, pp);
 
-      /* background_jpeg_save() will cleanup as needed */
+      /* preview_poll() will cleanup as needed */
       return TRUE;
     }
 
+  /* JSAMPLEs per row in image_buffer */
+  rowstride = cinfo.input_components * cinfo.image_width;
+  data = g_new (guchar, rowstride * gimp_tile_height ());
+
+  /* fault if cinfo.next_scanline isn't initially a multiple of
+   * gimp_tile_height */
+  src = NULL;
+
   while (cinfo.next_scanline < cinfo.image_height)
     {
       if ((cinfo.next_scanline % gimp_tile_height ()) == 0)
@@ -857,12 +1125,13 @@ make_preview (GimpProcedureConfig *config)
 void
 destroy_preview (void)
 {
-  if (prev_p && !prev_p->abort_me)
+  if (prev_p)
     {
-      guint id = prev_p->source_id;
-      prev_p->abort_me = TRUE;   /* signal the background save to stop */
-      background_jpeg_save (prev_p);
-      g_source_remove (id);
+      /* signal the background save to stop, preview_poll() will
+       * cleanup once it did
+       */
+      g_atomic_int_set (&prev_p->cancelled, TRUE);
+      prev_p = NULL;
     }
 
   if (gimp_image_is_valid (preview_image) &&
@@ -1076,6 +1345,12 @@ save_dialog (GimpProcedure       *procedure,
 
   destroy_preview ();
 
+  /* wait for the previews still being encoded */
+  while (preview_workers)
+    preview_free (preview_workers->data);
+
+  g_clear_object (&preview_source);
+
   return run;
 }
 
@@ -39,6 +39,13 @@
 
 #define COMP_MODE_SIZE sizeof(guint16)
 
+/* Rows of RLE and raw channels are decoded in bands of about this size,
+ * and the channels of consecutive layers are decoded together up to
+ * about this much data.
+ */
+#define DECODE_BAND_SIZE  (256 * 1024)
+#define LAYER_BATCH_SIZE  (64 * 1024 * 1024)
+
 typedef struct
 {
   gint32  group_index; /* first layer from the top that has clipping */
@@ -57,6 +64,26 @@ typedef struct
   gdouble   baseline_shift;
 } FontInfo;
 
+typedef struct
+{
+  PSDchannel *channel;
+  guint16     bps;
+  guint16     compression;
+  gsize       readline_len;
+  gchar      *raw_data;     /* Decoded rows, readline_len bytes each */
+  gchar      *src;          /* Compressed channel data */
+  gsize       src_len;
+  gsize      *rle_offsets;  /* Start of each packed row in src */
+  gboolean    failed;
+} PSDdecode;
+
+typedef struct
+{
+  PSDdecode *decode;
+  guint32    first_row;
+  guint32    n_rows;
+} PSDdecodeUnit;
+
 /*  Local function prototypes  */
 static gint             read_header_block          (PSDimage       *img_a,
                                                     GInputStream   *input,
@@ -95,6 +122,24 @@ static gint             add_image_resources        (GimpImage      *image,
                                                     gboolean       *profile_loaded,
                                                     GError        **error);
 
+static PSDchannel    ** read_layer_channels        (PSDimage       *img_a,
+                                                    PSDlayer       *lyr_a,
+                                                    GArray         *decodes,
+                                                    GInputStream   *input,
+                                                    gboolean       *empty_mask,
+                                                    GError        **error);
+
+static gint             read_layer_batch           (PSDimage       *img_a,
+                                                    PSDlayer      **lyr_a,
+                                                    gint            first,
+                                                    PSDchannel   ***lyr_chn_a,
+                                                    gboolean       *empty_mask_a,
+                                                    GInputStream   *input,
+                                                    GError        **error);
+
+static void             free_layer_decodes         (GArray         *decodes,
+                                                    guint           first);
+
 static gint             add_layers                 (GimpImage      *image,
                                                     PSDimage       *img_a,
                                                     PSDlayer      **lyr_a,
@@ -190,6 +235,7 @@ static void             free_lyr_chn               (PSDchannel    **lyr_chn,
 
 static gboolean         read_RLE_channel           (PSDimage       *img_a,
                                                     PSDchannel     *lyr_chn,
+                                                    PSDdecode      *decode,
                                                     guint64         channel_data_len,
                                                     GInputStream   *input,
                                                     GError        **error);
@@ -202,6 +248,32 @@ static gint             read_channel_data          (PSDchannel     *channel,
                                                     guint32         comp_len,
                                                     GError        **error);
 
+static gboolean         read_channel_payload       (PSDdecode      *decode,
+                                                    PSDchannel     *channel,
+                                                    guint16         bps,
+                                                    guint16         compression,
+                                                    const guint32  *rle_pack_len,
+                                                    GInputStream   *input,
+                                                    guint32         comp_len,
+                                                    GError        **error);
+
+static void             decode_channels            (PSDdecode      *decodes,
+                                                    gint            n_decodes);
+
+static void             decode_channel_units       (gsize           offset,
+                                                    gsize           size,
+                                                    PSDdecodeUnit  *units);
+
+static void             decode_channel_rows        (PSDdecode      *decode,
+                                                    guint32         first_row,
+                                                    guint32         n_rows);
+
+static gint             finish_channel_data        (PSDdecode      *decode,
+                                                    GError        **error);
+
+static void             clear_channel_decode       (PSDdecode      *decode,
+                                                    gboolean        free_data);
+
 static void             decode_32_bit_predictor    (gchar          *src,
                                                     gchar          *dst,
                                                     guint32         rows,
@@ -1961,6 +2033,7 @@ psd_convert_lab_to_srgb (PSDimage *img_a,
 static gboolean
 read_RLE_channel (PSDimage      *img_a,
                   PSDchannel    *lyr_chn,
+                  PSDdecode     *decode,
                   guint64        channel_data_len,
                   GInputStream  *input,
                   GError       **error)
@@ -2007,9 +2080,9 @@ read_RLE_channel (PSDimage      *img_a,
                              GUINT32_FROM_BE (rle_pack_len[rowi]);
     }
 
-  if (read_channel_data (lyr_chn, img_a->bps,
-                         PSD_COMP_RLE, rle_pack_len, input, 0,
-                         error) < 1)
+  if (! read_channel_payload (decode, lyr_chn, img_a->bps,
+                              PSD_COMP_RLE, rle_pack_len, input, 0,
+                              error))
     {
       psd_set_error (error);
       g_free (rle_pack_len);
@@ -2588,6 +2661,284 @@ mark_clipping_groups (PSDimage  *img_a,
   g_array_free (clipping_group_stack, FALSE);
 }
 
+/* Reads the channel data of a layer, leaving the decoding to
+ * decode_channels() through the PSDdecode appended to @decodes.
+ */
+static PSDchannel **
+read_layer_channels (PSDimage      *img_a,
+                     PSDlayer      *lyr_a,
+                     GArray        *decodes,
+                     GInputStream  *input,
+                     gboolean      *empty_mask,
+                     GError       **error)
+{
+  PSDchannel **lyr_chn;
+  guint        n_decodes = decodes->len;
+  gint         cidx;
+
+  /* Empty mask */
+  if (lyr_a->layer_mask.bottom - lyr_a->layer_mask.top == 0
+      || lyr_a->layer_mask.right - lyr_a->layer_mask.left == 0)
+      *empty_mask = TRUE;
+  else
+      *empty_mask = FALSE;
+
+  IFDBG(3) g_debug ("Empty mask %d, size %d %d", *empty_mask,
+                    lyr_a->layer_mask.bottom - lyr_a->layer_mask.top,
+                    lyr_a->layer_mask.right - lyr_a->layer_mask.left);
+
+  IFDBG(2) g_debug ("Number of channels: %d", lyr_a->num_channels);
+  /* Create pointer array for the channel records */
+  lyr_chn = g_new0 (PSDchannel *, lyr_a->num_channels);
+  for (cidx = 0; cidx < lyr_a->num_channels; ++cidx)
+    {
+      PSDdecode decode;
+      guint16   comp_mode = PSD_COMP_RAW;
+
+      /* Allocate channel record */
+      lyr_chn[cidx] = g_malloc (sizeof (PSDchannel) );
+
+      lyr_chn[cidx]->id = lyr_a->chn_info[cidx].channel_id;
+      if (lyr_a->bottom > lyr_a->top)
+        lyr_chn[cidx]->rows = lyr_a->bottom - lyr_a->top;
+      else
+        lyr_chn[cidx]->rows = 0;
+      if (lyr_a->right > lyr_a->left)
+        lyr_chn[cidx]->columns = lyr_a->right - lyr_a->left;
+      else
+        lyr_chn[cidx]->columns = 0;
+      lyr_chn[cidx]->data = NULL;
+
+      if (lyr_chn[cidx]->id == PSD_CHANNEL_EXTRA_MASK)
+        {
+          if (! psd_seek (input, lyr_a->chn_info[cidx].data_len,
+                          G_SEEK_CUR, error))
+            {
+              psd_set_error (error);
+              free_layer_decodes (decodes, n_decodes);
+              free_lyr_chn (lyr_chn, lyr_a->num_channels);
+              return NULL;
+            }
+
+          continue;
+        }
+      else if (lyr_chn[cidx]->id == PSD_CHANNEL_MASK)
+        {
+          /* Works around a bug in panotools psd files where the layer mask
+             size is given as 0 but data exists. Set mask size to layer size.
+          */
+          if (*empty_mask && lyr_a->chn_info[cidx].data_len - 2 > 0)
+            {
+              *empty_mask = FALSE;
+              if (lyr_a->layer_mask.top == lyr_a->layer_mask.bottom)
+                {
+                  lyr_a->layer_mask.top = lyr_a->top;
+                  lyr_a->layer_mask.bottom = lyr_a->bottom;
+                }
+              if (lyr_a->layer_mask.right == lyr_a->layer_mask.left)
+                {
+                  lyr_a->layer_mask.right = lyr_a->right;
+                  lyr_a->layer_mask.left = lyr_a->left;
+                }
+            }
+          lyr_chn[cidx]->rows = (lyr_a->layer_mask.bottom -
+                                lyr_a->layer_mask.top);
+          lyr_chn[cidx]->columns = (lyr_a->layer_mask.right -
+                                    lyr_a->layer_mask.left);
+        }
+
+      IFDBG(3) g_debug ("Channel id %d, %dx%d",
+                        lyr_chn[cidx]->id,
+                        lyr_chn[cidx]->columns,
+                        lyr_chn[cidx]->rows);
+
+      /* Vector masks can have a high value for rows, but then columns will be 0. */
+      if (lyr_chn[cidx]->columns > GIMP_MAX_IMAGE_SIZE ||
+          (lyr_chn[cidx]->rows > GIMP_MAX_IMAGE_SIZE && lyr_chn[cidx]->columns != 0))
+        {
+          g_set_error (error, GIMP_PLUG_IN_ERROR, 0,
+                       _("Invalid channel dimensions %u x %u"),
+                       lyr_chn[cidx]->columns, lyr_chn[cidx]->rows);
+          free_layer_decodes (decodes, n_decodes);
+          free_lyr_chn (lyr_chn, lyr_a->num_channels);
+          return NULL;
+        }
+
+      /* Only read channel data if there is any channel
+       * data. Note that the channel data can contain a
+       * compression method but no actual data.
+       */
+      if (lyr_a->chn_info[cidx].data_len >= COMP_MODE_SIZE)
+        {
+          if (psd_read (input, &comp_mode, COMP_MODE_SIZE, error) < COMP_MODE_SIZE)
+            {
+              psd_set_error (error);
+              free_layer_decodes (decodes, n_decodes);
+              free_lyr_chn (lyr_chn, lyr_a->num_channels);
+              return NULL;
+            }
+
+          if (! img_a->ibm_pc_format)
+            comp_mode = GUINT16_FROM_BE (comp_mode);
+          else
+            comp_mode = GUINT16_FROM_LE (comp_mode);
+          IFDBG(3) g_debug ("Compression mode: %d", comp_mode);
+        }
+      if (lyr_a->chn_info[cidx].data_len > COMP_MODE_SIZE)
+        {
+          switch (comp_mode)
+            {
+              case PSD_COMP_RAW:        /* Planar raw data */
+                IFDBG(3) g_debug ("Raw data length: %" G_GSIZE_FORMAT,
+                                  (gsize) lyr_a->chn_info[cidx].data_len - 2);
+                if (! read_channel_payload (&decode, lyr_chn[cidx], img_a->bps,
+                                            PSD_COMP_RAW, NULL, input, 0,
+                                            error))
+                  {
+                    psd_set_error (error);
+                    free_layer_decodes (decodes, n_decodes);
+                    free_lyr_chn (lyr_chn, lyr_a->num_channels);
+                    return NULL;
+                  }
+                break;
+
+              case PSD_COMP_RLE:        /* Packbits */
+                if (! read_RLE_channel (img_a, lyr_chn[cidx], &decode,
+                                        lyr_a->chn_info[cidx].data_len,
+                                        input, error))
+                  {
+                    psd_set_error (error);
+                    free_layer_decodes (decodes, n_decodes);
+                    free_lyr_chn (lyr_chn, lyr_a->num_channels);
+                    return NULL;
+                  }
+                break;
+
+              case PSD_COMP_ZIP:                 /* ? */
+              case PSD_COMP_ZIP_PRED:
+                if (! read_channel_payload (&decode, lyr_chn[cidx], img_a->bps,
+                                            comp_mode, NULL, input,
+                                            lyr_a->chn_info[cidx].data_len - 2,
+                                            error))
+                  {
+                    psd_set_error (error);
+                    free_layer_decodes (decodes, n_decodes);
+                    free_lyr_chn (lyr_chn, lyr_a->num_channels);
+                    return NULL;
+                  }
+                break;
+
+              default:
+                g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                             _("Unsupported compression mode: %d"), comp_mode);
+                free_layer_decodes (decodes, n_decodes);
+                free_lyr_chn (lyr_chn, lyr_a->num_channels);
+                return NULL;
+                break;
+            }
+
+          g_array_append_val (decodes, decode);
+        }
+    }
+
+  return lyr_chn;
+}
+
+/* Reads the channels of the layers from @first on, up to about
+ * LAYER_BATCH_SIZE bytes of pixels, and decodes them all at once.
+ * Returns the index of the first layer after the batch, or -1.
+ */
+static gint
+read_layer_batch (PSDimage       *img_a,
+                  PSDlayer      **lyr_a,
+                  gint            first,
+                  PSDchannel   ***lyr_chn_a,
+                  gboolean       *empty_mask_a,
+                  GInputStream   *input,
+                  GError        **error)
+{
+  GArray   *decodes    = g_array_new (FALSE, FALSE, sizeof (PSDdecode));
+  gsize     batch_size = 0;
+  gboolean  success    = TRUE;
+  gint64    start_time = g_get_monotonic_time ();
+  gint      lidx;
+  guint     i;
+
+  for (lidx = first;
+       lidx < img_a->num_layers &&
+       (lidx == first || batch_size < LAYER_BATCH_SIZE);
+       ++lidx)
+    {
+      guint n_decodes = decodes->len;
+
+      lyr_chn_a[lidx] = read_layer_channels (img_a, lyr_a[lidx], decodes,
+                                             input, &empty_mask_a[lidx],
+                                             error);
+
+      if (! lyr_chn_a[lidx])
+        {
+          success = FALSE;
+          break;
+        }
+
+      for (i = n_decodes; i < decodes->len; i++)
+        {
+          PSDdecode *decode = &g_array_index (decodes, PSDdecode, i);
+
+          batch_size += decode->readline_len * decode->channel->rows;
+        }
+    }
+
+  if (success)
+    decode_channels ((PSDdecode *) decodes->data, decodes->len);
+
+  for (i = 0; i < decodes->len; i++)
+    {
+      PSDdecode *decode = &g_array_index (decodes, PSDdecode, i);
+
+      if (! success)
+        clear_channel_decode (decode, TRUE);
+      else if (finish_channel_data (decode, error) < 1)
+        success = FALSE;
+    }
+
+  g_array_free (decodes, TRUE);
+
+  if (! success)
+    {
+      gint j;
+
+      for (j = first; j < lidx; j++)
+        {
+          for (i = 0; i < lyr_a[j]->num_channels; i++)
+            g_free (lyr_chn_a[j][i]->data);
+
+          free_lyr_chn (lyr_chn_a[j], lyr_a[j]->num_channels);
+          lyr_chn_a[j] = NULL;
+        }
+
+      return -1;
+    }
+
+  IFDBG(2) g_debug ("Layers %d to %d: %" G_GSIZE_FORMAT " bytes decoded in %.3f s",
+                    first, lidx - 1, batch_size,
+                    (g_get_monotonic_time () - start_time) / 1000000.0);
+
+  return lidx;
+}
+
+static void
+free_layer_decodes (GArray *decodes,
+                    guint   first)
+{
+  guint i;
+
+  for (i = first; i < decodes->len; i++)
+    clear_channel_decode (&g_array_index (decodes, PSDdecode, i), TRUE);
+
+  g_array_set_size (decodes, first);
+}
+
 static gint
 add_layers (GimpImage     *image,
             PSDimage      *img_a,
@@ -2596,6 +2947,9 @@ add_layers (GimpImage     *image,
             GError       **error)
 {
   PSDchannel          **lyr_chn;
+  PSDchannel         ***layer_chn;
+  gboolean             *layer_empty_mask;
+  gint                  batch_end       = 0;
   GArray               *parent_group_stack;
   GimpLayer            *parent_group = NULL;
   guint16               alpha_chn;
@@ -2643,6 +2997,9 @@ add_layers (GimpImage     *image,
 
   mark_clipping_groups (img_a, lyr_a);
 
+  layer_chn        = g_new0 (PSDchannel **, img_a->num_layers);
+  layer_empty_mask = g_new0 (gboolean, img_a->num_layers);
+
   /* set the root of the group hierarchy */
   parent_group_stack = g_array_new (FALSE, FALSE, sizeof (GimpLayer *));
   g_array_append_val (parent_group_stack, parent_group);
@@ -2660,162 +3017,24 @@ add_layers (GimpImage     *image,
       else
           empty = FALSE;
 
-      /* Empty mask */
-      if (lyr_a[lidx]->layer_mask.bottom - lyr_a[lidx]->layer_mask.top == 0
-          || lyr_a[lidx]->layer_mask.right - lyr_a[lidx]->layer_mask.left == 0)
-          empty_mask = TRUE;
-      else
-          empty_mask = FALSE;
-
-      IFDBG(3) g_debug ("Empty mask %d, size %d %d", empty_mask,
-                        lyr_a[lidx]->layer_mask.bottom - lyr_a[lidx]->layer_mask.top,
-                        lyr_a[lidx]->layer_mask.right - lyr_a[lidx]->layer_mask.left);
-
-      /* Load layer channel data */
-      IFDBG(2) g_debug ("Number of channels: %d", lyr_a[lidx]->num_channels);
-      /* Create pointer array for the channel records */
-      lyr_chn = g_new0 (PSDchannel *, lyr_a[lidx]->num_channels);
-      for (cidx = 0; cidx < lyr_a[lidx]->num_channels; ++cidx)
+      /* Load layer channel data, a batch of layers at a time */
+      if (lidx == batch_end)
         {
-          guint16 comp_mode = PSD_COMP_RAW;
-
-          /* Allocate channel record */
-          lyr_chn[cidx] = g_malloc (sizeof (PSDchannel) );
-
-          lyr_chn[cidx]->id = lyr_a[lidx]->chn_info[cidx].channel_id;
-          if (lyr_a[lidx]->bottom > lyr_a[lidx]->top)
-            lyr_chn[cidx]->rows = lyr_a[lidx]->bottom - lyr_a[lidx]->top;
-          else
-            lyr_chn[cidx]->rows = 0;
-          if (lyr_a[lidx]->right > lyr_a[lidx]->left)
-            lyr_chn[cidx]->columns = lyr_a[lidx]->right - lyr_a[lidx]->left;
-          else
-            lyr_chn[cidx]->columns = 0;
-          lyr_chn[cidx]->data = NULL;
-
-          if (lyr_chn[cidx]->id == PSD_CHANNEL_EXTRA_MASK)
-            {
-              if (! psd_seek (input, lyr_a[lidx]->chn_info[cidx].data_len,
-                              G_SEEK_CUR, error))
-                {
-                  psd_set_error (error);
-                  free_lyr_chn (lyr_chn, lyr_a[lidx]->num_channels);
-                  return -1;
-                }
-
-              continue;
-            }
-          else if (lyr_chn[cidx]->id == PSD_CHANNEL_MASK)
-            {
-              /* Works around a bug in panotools psd files where the layer mask
-                 size is given as 0 but data exists. Set mask size to layer size.
-              */
-              if (empty_mask && lyr_a[lidx]->chn_info[cidx].data_len - 2 > 0)
-                {
-                  empty_mask = FALSE;
-                  if (lyr_a[lidx]->layer_mask.top == lyr_a[lidx]->layer_mask.bottom)
-                    {
-                      lyr_a[lidx]->layer_mask.top = lyr_a[lidx]->top;
-                      lyr_a[lidx]->layer_mask.bottom = lyr_a[lidx]->bottom;
-                    }
-                  if (lyr_a[lidx]->layer_mask.right == lyr_a[lidx]->layer_mask.left)
-                    {
-                      lyr_a[lidx]->layer_mask.right = lyr_a[lidx]->right;
-                      lyr_a[lidx]->layer_mask.left = lyr_a[lidx]->left;
-                    }
-                }
-              lyr_chn[cidx]->rows = (lyr_a[lidx]->layer_mask.bottom -
-                                    lyr_a[lidx]->layer_mask.top);
-              lyr_chn[cidx]->columns = (lyr_a[lidx]->layer_mask.right -
-                                        lyr_a[lidx]->layer_mask.left);
-            }
+          batch_end = read_layer_batch (img_a, lyr_a, lidx,
+                                        layer_chn, layer_empty_mask,
+                                        input, error);
 
-          IFDBG(3) g_debug ("Channel id %d, %dx%d",
-                            lyr_chn[cidx]->id,
-                            lyr_chn[cidx]->columns,
-                            lyr_chn[cidx]->rows);
-
-          /* Vector masks can have a high value for rows, but then columns will be 0. */
-          if (lyr_chn[cidx]->columns > GIMP_MAX_IMAGE_SIZE ||
-              (lyr_chn[cidx]->rows > GIMP_MAX_IMAGE_SIZE && lyr_chn[cidx]->columns != 0))
+          if (batch_end < 0)
             {
-              g_set_error (error, GIMP_PLUG_IN_ERROR, 0,
-                           _("Invalid channel dimensions %u x %u"),
-                           lyr_chn[cidx]->columns, lyr_chn[cidx]->rows);
-              free_lyr_chn (lyr_chn, lyr_a[lidx]->num_channels);
+              g_free (layer_chn);
+              g_free (layer_empty_mask);
               return -1;
             }
-
-          /* Only read channel data if there is any channel
-           * data. Note that the channel data can contain a
-           * compression method but no actual data.
-           */
-          if (lyr_a[lidx]->chn_info[cidx].data_len >= COMP_MODE_SIZE)
-            {
-              if (psd_read (input, &comp_mode, COMP_MODE_SIZE, error) < COMP_MODE_SIZE)
-                {
-                  psd_set_error (error);
-                  free_lyr_chn (lyr_chn, lyr_a[lidx]->num_channels);
-                  return -1;
-                }
-
-              if (! img_a->ibm_pc_format)
-                comp_mode = GUINT16_FROM_BE (comp_mode);
-              else
-                comp_mode = GUINT16_FROM_LE (comp_mode);
-              IFDBG(3) g_debug ("Compression mode: %d", comp_mode);
-            }
-          if (lyr_a[lidx]->chn_info[cidx].data_len > COMP_MODE_SIZE)
-            {
-              switch (comp_mode)
-                {
-                  case PSD_COMP_RAW:        /* Planar raw data */
-                    IFDBG(3) g_debug ("Raw data length: %" G_GSIZE_FORMAT,
-                                      (gsize) lyr_a[lidx]->chn_info[cidx].data_len - 2);
-                    if (read_channel_data (lyr_chn[cidx], img_a->bps,
-                                           PSD_COMP_RAW, NULL, input, 0,
-                                           error) < 1)
-                      {
-                        psd_set_error (error);
-                        free_lyr_chn (lyr_chn, lyr_a[lidx]->num_channels);
-                        return -1;
-                      }
-                    break;
-
-                  case PSD_COMP_RLE:        /* Packbits */
-                    if (! read_RLE_channel (img_a, lyr_chn[cidx],
-                                            lyr_a[lidx]->chn_info[cidx].data_len,
-                                            input, error))
-                      {
-                        psd_set_error (error);
-                        free_lyr_chn (lyr_chn, lyr_a[lidx]->num_channels);
-                        return -1;
-                      }
-                    break;
-
-                  case PSD_COMP_ZIP:                 /* ? */
-                  case PSD_COMP_ZIP_PRED:
-                    if (read_channel_data (lyr_chn[cidx], img_a->bps,
-                                           comp_mode, NULL, input,
-                                           lyr_a[lidx]->chn_info[cidx].data_len - 2,
-                                           error) < 1)
-                      {
-                        psd_set_error (error);
-                        free_lyr_chn (lyr_chn, lyr_a[lidx]->num_channels);
-                        return -1;
-                      }
-                    break;
-
-                  default:
-                    g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
-                                 _("Unsupported compression mode: %d"), comp_mode);
-                    free_lyr_chn (lyr_chn, lyr_a[lidx]->num_channels);
-                    return -1;
-                    break;
-                }
-            }
         }
 
+      lyr_chn    = layer_chn[lidx];
+      empty_mask = layer_empty_mask[lidx];
+
       /* Draw layer */
 
       alpha = FALSE;
@@ -3384,6 +3603,8 @@ add_layers (GimpImage     *image,
       g_free (lyr_a[lidx]);
     }
   g_free (lyr_a);
+  g_free (layer_chn);
+  g_free (layer_empty_mask);
   g_array_free (parent_group_stack, FALSE);
 
   /* Set the selected layers */
@@ -5238,6 +5459,7 @@ add_merged_image (GimpImage     *image,
   guint16               total_channels;
   guint16               bps;
   guint32              *rle_pack_len[MAX_CHANNELS];
+  PSDdecode             decodes[MAX_CHANNELS];
   guint32               alpha_id;
   gsize                 layer_size;
   GimpLayer            *layer   = NULL;
@@ -5398,12 +5620,27 @@ add_merged_image (GimpImage     *image,
 
               for (cidx = 0; cidx < total_channels; ++cidx)
                 {
-                  if (read_channel_data (&chn_a[cidx], img_a->bps,
-                                        PSD_COMP_RLE, rle_pack_len[cidx], input, 0,
-                                        error) < 1)
-                    return -1;
+                  if (! read_channel_payload (&decodes[cidx], &chn_a[cidx],
+                                              img_a->bps, PSD_COMP_RLE,
+                                              rle_pack_len[cidx], input, 0,
+                                              error))
+                    {
+                      while (cidx--)
+                        clear_channel_decode (&decodes[cidx], TRUE);
+
+                      return -1;
+                    }
                   g_free (rle_pack_len[cidx]);
                 }
+
+              /* All channels are decoded together */
+              decode_channels (decodes, total_channels);
+
+              for (cidx = 0; cidx < total_channels; ++cidx)
+                {
+                  if (finish_channel_data (&decodes[cidx], error) < 1)
+                    return -1;
+                }
               break;
             }
 
@@ -5793,10 +6030,34 @@ read_channel_data (PSDchannel     *channel,
                    guint32         comp_len,
                    GError        **error)
 {
-  gchar *raw_data = NULL;
-  gchar *src;
-  gsize  readline_len;
-  gsize  allocation;
+  PSDdecode decode;
+
+  if (! read_channel_payload (&decode, channel, bps, compression,
+                              rle_pack_len, input, comp_len, error))
+    return -1;
+
+  decode_channels (&decode, 1);
+
+  return finish_channel_data (&decode, error);
+}
+
+/* Reads the data of a channel from the file, without decoding it,
+ * which is left to decode_channels().  Raw data is read in place.
+ */
+static gboolean
+read_channel_payload (PSDdecode      *decode,
+                      PSDchannel     *channel,
+                      guint16         bps,
+                      guint16         compression,
+                      const guint32  *rle_pack_len,
+                      GInputStream   *input,
+                      guint32         comp_len,
+                      GError        **error)
+{
+  gsize readline_len;
+  gsize allocation;
+
+  memset (decode, 0, sizeof (PSDdecode));
 
   if (bps == 1)
     readline_len = (gsize) ((channel->columns + 7) / 8);
@@ -5814,33 +6075,72 @@ read_channel_data (PSDchannel     *channel,
     {
       g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
                    _("Unsupported or invalid channel size"));
-      return -1;
+      return FALSE;
     }
 
-  raw_data = g_try_malloc (allocation);
-  if (raw_data == NULL)
+  if (bps != 1 && bps != 8 && bps != 16 && bps != 32)
+    return FALSE;
+
+  channel->data = NULL;
+
+  decode->channel      = channel;
+  decode->bps          = bps;
+  decode->compression  = compression;
+  decode->readline_len = readline_len;
+  decode->raw_data     = g_try_malloc (allocation);
+
+  /* The 1 bit and the 32 bit predictor conversions can't be done in
+   * place.
+   */
+  if (decode->raw_data &&
+      (bps == 1 || (bps == 32 && compression == PSD_COMP_ZIP_PRED)))
+    {
+      channel->data = g_try_malloc ((gsize) channel->rows *
+                                    channel->columns * MAX (bps / 8, 1));
+
+      if (! channel->data)
+        g_clear_pointer (&decode->raw_data, g_free);
+    }
+
+  if (decode->raw_data == NULL)
     {
       g_set_error (error, GIMP_PLUG_IN_ERROR, 0,
                    _("There was not enough memory to complete the "
                      "operation."));
-      return -1;
+      return FALSE;
     }
 
   switch (compression)
     {
       case PSD_COMP_RAW:
-        if (psd_read (input, raw_data, readline_len * channel->rows, error) < readline_len * channel->rows)
+        if (psd_read (input, decode->raw_data, allocation, error) < allocation)
           {
             psd_set_error (error);
-            g_free (raw_data);
-            return -1;
+            clear_channel_decode (decode, TRUE);
+            return FALSE;
           }
         break;
 
       case PSD_COMP_RLE:
+        decode->rle_offsets = g_new (gsize, channel->rows + 1);
+
+        decode->rle_offsets[0] = 0;
+        for (gint i = 0; i < channel->rows; ++i)
+          decode->rle_offsets[i + 1] = decode->rle_offsets[i] + rle_pack_len[i];
+
+        decode->src = g_try_malloc (decode->rle_offsets[channel->rows]);
+
+        if (! decode->src && decode->rle_offsets[channel->rows] > 0)
+          {
+            g_set_error (error, GIMP_PLUG_IN_ERROR, 0,
+                         _("There was not enough memory to complete the "
+                           "operation."));
+            clear_channel_decode (decode, TRUE);
+            return FALSE;
+          }
+
         for (gint i = 0; i < channel->rows; ++i)
           {
-            src = gegl_scratch_alloc (rle_pack_len[i]);
 /*      FIXME check for over-run
             if (PSD_TELL(input) + rle_pack_len[i] > block_end)
               {
@@ -5848,37 +6148,123 @@ read_channel_data (PSDchannel     *channel,
                 return -1;
               }
 */
-            if (psd_read (input, src, rle_pack_len[i], error) < rle_pack_len[i])
+            if (psd_read (input, decode->src + decode->rle_offsets[i],
+                          rle_pack_len[i], error) < rle_pack_len[i])
               {
                 psd_set_error (error);
-                gegl_scratch_free (src);
-                g_free (raw_data);
-                return -1;
+                clear_channel_decode (decode, TRUE);
+                return FALSE;
               }
+          }
+        break;
+
+      case PSD_COMP_ZIP:
+      case PSD_COMP_ZIP_PRED:
+        decode->src     = g_malloc (comp_len);
+        decode->src_len = comp_len;
+
+        if (psd_read (input, decode->src, comp_len, error) < comp_len)
+          {
+            psd_set_error (error);
+            clear_channel_decode (decode, TRUE);
+            return FALSE;
+          }
+        break;
+    }
+
+  return TRUE;
+}
+
+/* Decodes the rows of a number of channels read with
+ * read_channel_payload(), spreading them over all threads.  RLE and
+ * raw channels are split in bands of rows, ZIP channels can only be
+ * inflated as a whole.
+ */
+static void
+decode_channels (PSDdecode *decodes,
+                 gint       n_decodes)
+{
+  GArray *units = g_array_new (FALSE, FALSE, sizeof (PSDdecodeUnit));
+  gint    i;
+
+  for (i = 0; i < n_decodes; i++)
+    {
+      PSDdecode     *decode = &decodes[i];
+      PSDdecodeUnit  unit;
+      guint32        band_rows;
+
+      if (decode->compression == PSD_COMP_ZIP ||
+          decode->compression == PSD_COMP_ZIP_PRED)
+        band_rows = decode->channel->rows;
+      else
+        band_rows = MAX (DECODE_BAND_SIZE / MAX (decode->readline_len, 1), 1);
+
+      unit.decode = decode;
+
+      for (unit.first_row = 0;
+           unit.first_row < decode->channel->rows;
+           unit.first_row += band_rows)
+        {
+          unit.n_rows = MIN (band_rows,
+                             decode->channel->rows - unit.first_row);
+
+          g_array_append_val (units, unit);
+        }
+    }
+
+  gegl_parallel_distribute_range (
+    units->len, 1,
+    (GeglParallelDistributeRangeFunc) decode_channel_units,
+    units->data);
+
+  g_array_free (units, TRUE);
+}
+
+static void
+decode_channel_units (gsize          offset,
+                      gsize          size,
+                      PSDdecodeUnit *units)
+{
+  gsize i;
+
+  for (i = offset; i < offset + size; i++)
+    decode_channel_rows (units[i].decode, units[i].first_row, units[i].n_rows);
+}
+
+static void
+decode_channel_rows (PSDdecode *decode,
+                     guint32    first_row,
+                     guint32    n_rows)
+{
+  PSDchannel *channel = decode->channel;
+  gchar      *raw_data;
+  gsize       n_pixels;
+
+  raw_data = decode->raw_data + (gsize) first_row * decode->readline_len;
+  n_pixels = (gsize) n_rows * channel->columns;
+
+  switch (decode->compression)
+    {
+      case PSD_COMP_RLE:
+        for (guint32 i = first_row; i < first_row + n_rows; ++i)
+          {
             /* FIXME check for errors returned from decode packbits */
-            decode_packbits (src, raw_data + i * readline_len,
-                             rle_pack_len[i], readline_len);
-            gegl_scratch_free (src);
+            decode_packbits (decode->src + decode->rle_offsets[i],
+                             decode->raw_data + i * decode->readline_len,
+                             decode->rle_offsets[i + 1] - decode->rle_offsets[i],
+                             decode->readline_len);
           }
         break;
+
       case PSD_COMP_ZIP:
       case PSD_COMP_ZIP_PRED:
         {
           z_stream zs;
 
-          src = g_malloc (comp_len);
-          if (psd_read (input, src, comp_len, error) < comp_len)
-            {
-              psd_set_error (error);
-              g_free (src);
-              g_free (raw_data);
-              return -1;
-            }
-
-          zs.next_in = (guchar*) src;
-          zs.avail_in = comp_len;
-          zs.next_out = (guchar*) raw_data;
-          zs.avail_out = readline_len * channel->rows;
+          zs.next_in = (guchar*) decode->src;
+          zs.avail_in = decode->src_len;
+          zs.next_out = (guchar*) decode->raw_data;
+          zs.avail_out = decode->readline_len * channel->rows;
           zs.zalloc = zzalloc;
           zs.zfree = zzfree;
 
@@ -5889,41 +6275,33 @@ read_channel_data (PSDchannel     *channel,
             }
           else
             {
-              g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
-                           _("Failed to decompress data"));
-              g_free (src);
-              g_free (raw_data);
-              return -1;
+              decode->failed = TRUE;
+              return;
             }
-
-          g_free (src);
           break;
         }
     }
 
   /* Convert channel data to GIMP format */
-  switch (bps)
+  switch (decode->bps)
     {
     case 32:
       {
         guint32 *data;
 
-        if (compression == PSD_COMP_ZIP_PRED)
+        if (decode->compression == PSD_COMP_ZIP_PRED)
           {
-            IFDBG(3) g_debug ("Converting 32 bit predictor data");
-            channel->data = (gchar *) g_malloc0 ((gsize) channel->rows * channel->columns * 4);
-            decode_32_bit_predictor (raw_data, channel->data,
-                                     channel->rows, channel->columns);
+            data = (guint32 *) channel->data + (gsize) first_row * channel->columns;
+
+            decode_32_bit_predictor (raw_data, (gchar *) data,
+                                     n_rows, channel->columns);
           }
         else
           {
-            IFDBG(3) g_debug ("32 bit channel data without predictor");
-            channel->data = raw_data;
-            raw_data      = NULL;
+            data = (guint32 *) raw_data;
           }
 
-        data = (guint32*) channel->data;
-        for (gsize pos = 0; pos < (gsize) channel->rows * channel->columns; ++pos)
+        for (gsize pos = 0; pos < n_pixels; ++pos)
           data[pos] = GUINT32_FROM_BE (data[pos]);
 
         break;
@@ -5933,16 +6311,12 @@ read_channel_data (PSDchannel     *channel,
       {
         guint16 *data = (guint16*) raw_data;
 
-        channel->data = raw_data;
-        raw_data      = NULL;
-
-        for (gsize i = 0; i < (gsize) channel->rows * channel->columns; ++i)
+        for (gsize i = 0; i < n_pixels; ++i)
           data[i] = GUINT16_FROM_BE (data[i]);
 
-        if (compression == PSD_COMP_ZIP_PRED)
+        if (decode->compression == PSD_COMP_ZIP_PRED)
           {
-            IFDBG(3) g_debug ("Converting 16 bit predictor data");
-            for (gsize i = 0; i < channel->rows; ++i)
+            for (gsize i = 0; i < n_rows; ++i)
               for (gsize j = 1; j < channel->columns; ++j)
                 data[i * channel->columns + j] += data[i * channel->columns + j - 1];
           }
@@ -5950,34 +6324,60 @@ read_channel_data (PSDchannel     *channel,
       }
 
       case 8:
-        channel->data = raw_data;
-        raw_data      = NULL;
-
-        if (compression == PSD_COMP_ZIP_PRED)
+        if (decode->compression == PSD_COMP_ZIP_PRED)
           {
-            IFDBG(3) g_debug ("Converting 8 bit predictor data");
-            for (gsize i = 0; i < channel->rows; ++i)
+            for (gsize i = 0; i < n_rows; ++i)
               for (gsize j = 1; j < channel->columns; ++j)
-                channel->data[i * channel->columns + j] += channel->data[i * channel->columns + j - 1];
+                raw_data[i * channel->columns + j] += raw_data[i * channel->columns + j - 1];
           }
         break;
 
       case 1:
-        channel->data = (gchar *) g_malloc ((gsize) channel->rows * channel->columns);
-        convert_1_bit (raw_data, channel->data, channel->rows, channel->columns);
+        convert_1_bit (raw_data,
+                       channel->data + (gsize) first_row * channel->columns,
+                       n_rows, channel->columns);
         break;
+    }
+}
 
-      default:
-        g_free (raw_data);
-        return -1;
-        break;
+/* Hands the decoded data over to the channel, and frees the rest. */
+static gint
+finish_channel_data (PSDdecode  *decode,
+                     GError    **error)
+{
+  PSDchannel *channel = decode->channel;
+
+  if (decode->failed)
+    {
+      g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                   _("Failed to decompress data"));
+      clear_channel_decode (decode, TRUE);
+      return -1;
     }
 
-  g_free (raw_data);
+  if (! channel->data)
+    {
+      channel->data    = decode->raw_data;
+      decode->raw_data = NULL;
+    }
+
+  clear_channel_decode (decode, FALSE);
 
   return 1;
 }
 
+static void
+clear_channel_decode (PSDdecode *decode,
+                      gboolean   free_data)
+{
+  if (free_data && decode->channel)
+    g_clear_pointer (&decode->channel->data, g_free);
+
+  g_clear_pointer (&decode->raw_data,    g_free);
+  g_clear_pointer (&decode->src,         g_free);
+  g_clear_pointer (&decode->rle_offsets, g_free);
+}
+
 /*
  * For reference on zip predictor see:
  * - TIFFTN3d1.pdf
@@ -31,7 +31,8 @@
 
 #include "file-tiff-io.h"
 
-static gboolean tiff_file_size_error = FALSE;
+static gboolean  tiff_file_size_error = FALSE;
+static GThread  *tiff_main_thread     = NULL;
 
 typedef struct
 {
@@ -85,50 +86,69 @@ register_geotags (TIFF *tif)
 }
 
 
-static TiffIO tiff_io = { 0, };
-
-
 TIFF *
 tiff_open (GFile        *file,
            const gchar  *mode,
            GError      **error)
 {
-  TIFFSetWarningHandler ((TIFFErrorHandler) tiff_io_warning);
-  TIFFSetErrorHandler ((TIFFErrorHandler) tiff_io_error);
+  TiffIO *io;
+  TIFF   *tif;
+
+  if (! tiff_main_thread)
+    {
+      tiff_main_thread = g_thread_self ();
 
-  parent_extender = TIFFSetTagExtender (register_geotags);
+      TIFFSetWarningHandler ((TIFFErrorHandler) tiff_io_warning);
+      TIFFSetErrorHandler ((TIFFErrorHandler) tiff_io_error);
 
-  tiff_io.file = file;
+      parent_extender = TIFFSetTagExtender (register_geotags);
+    }
+
+  /*  every handle gets its own stream, so that several of them can be
+   *  read at the same time, see tiff_reopen()
+   */
+  io = g_new0 (TiffIO, 1);
+
+  io->file = file;
 
   if (! strcmp (mode, "r"))
     {
-      tiff_io.input = G_INPUT_STREAM (g_file_read (file, NULL, error));
-      if (! tiff_io.input)
-        return NULL;
+      io->input = G_INPUT_STREAM (g_file_read (file, NULL, error));
+      if (! io->input)
+        {
+          g_free (io);
+          return NULL;
+        }
 
-      tiff_io.stream = G_OBJECT (tiff_io.input);
+      io->stream = G_OBJECT (io->input);
     }
   else if (! strcmp (mode, "wb") || ! strcmp (mode, "wb8"))
     {
-      tiff_io.output = G_OUTPUT_STREAM (g_file_replace (file,
-                                                        NULL, FALSE,
-                                                        G_FILE_CREATE_NONE,
-                                                        NULL, error));
-      if (! tiff_io.output)
-        return NULL;
-
-      tiff_io.stream = G_OBJECT (tiff_io.output);
+      io->output = G_OUTPUT_STREAM (g_file_replace (file,
+                                                    NULL, FALSE,
+                                                    G_FILE_CREATE_NONE,
+                                                    NULL, error));
+      if (! io->output)
+        {
+          g_free (io);
+          return NULL;
+        }
+
+      io->stream = G_OBJECT (io->output);
     }
   else if (! strcmp (mode, "a"))
     {
       GIOStream *iostream = G_IO_STREAM (g_file_open_readwrite (file, NULL,
                                                                 error));
       if (! iostream)
-        return NULL;
+        {
+          g_free (io);
+          return NULL;
+        }
 
-      tiff_io.input  = g_io_stream_get_input_stream (iostream);
-      tiff_io.output = g_io_stream_get_output_stream (iostream);
-      tiff_io.stream = G_OBJECT (iostream);
+      io->input  = g_io_stream_get_input_stream (iostream);
+      io->output = g_io_stream_get_output_stream (iostream);
+      io->stream = G_OBJECT (iostream);
     }
   else
     {
@@ -137,18 +157,58 @@ tiff_open (GFile        *file,
 
 #if 0
 #warning FIXME !can_seek code is broken
-  tiff_io.can_seek = g_seekable_can_seek (G_SEEKABLE (tiff_io.stream));
+  io->can_seek = g_seekable_can_seek (G_SEEKABLE (io->stream));
 #endif
-  tiff_io.can_seek = TRUE;
-
-  return TIFFClientOpen ("file-tiff", mode,
-                         (thandle_t) &tiff_io,
-                         tiff_io_read,
-                         tiff_io_write,
-                         tiff_io_seek,
-                         tiff_io_close,
-                         tiff_io_get_file_size,
-                         NULL, NULL);
+  io->can_seek = TRUE;
+
+  tif = TIFFClientOpen ("file-tiff", mode,
+                        (thandle_t) io,
+                        tiff_io_read,
+                        tiff_io_write,
+                        tiff_io_seek,
+                        tiff_io_close,
+                        tiff_io_get_file_size,
+                        NULL, NULL);
+
+  if (! tif)
+    {
+      g_object_unref (io->stream);
+      g_free (io);
+    }
+
+  return tif;
+}
+
+/**
+ * tiff_reopen:
+ * @tif: a TIFF opened for reading with tiff_open()
+ *
+ * Opens another read-only handle on the file @tif was opened from, set
+ * to the same directory. libtiff handles can't be shared between
+ * threads, but separate handles on the same file can be read
+ * concurrently.
+ *
+ * Must be called from the thread that opened @tif.
+ *
+ * Returns: the new handle, or %NULL on failure.
+ */
+TIFF *
+tiff_reopen (TIFF *tif)
+{
+  TiffIO *io = (TiffIO *) TIFFClientdata (tif);
+  TIFF   *new_tif;
+
+  new_tif = tiff_open (io->file, "r", NULL);
+
+  if (new_tif &&
+      ! TIFFSetDirectory (new_tif, TIFFCurrentDirectory (tif)))
+    {
+      TIFFClose (new_tif);
+
+      new_tif = NULL;
+    }
+
+  return new_tif;
 }
 
 gboolean
@@ -172,6 +232,17 @@ tiff_io_warning (const gchar *module,
 {
   gint tag = 0;
 
+  /*  messages go through the PDB, which only the main thread may use  */
+  if (g_thread_self () != tiff_main_thread)
+    {
+      gchar *msg = g_strdup_vprintf (fmt, ap);
+
+      g_printerr ("LibTiff warning: [%s] %s\n", module, msg);
+      g_free (msg);
+
+      return;
+    }
+
   if (max_msgs_per_instance > 0)
     max_msgs_per_instance--;
   else
@@ -287,6 +358,19 @@ tiff_io_error (const gchar *module,
 {
   gchar *msg;
 
+  /*  messages go through the PDB, which only the main thread may use;
+   *  the caller reports the failure
+   */
+  if (g_thread_self () != tiff_main_thread)
+    {
+      msg = g_strdup_vprintf (fmt, ap);
+
+      g_printerr ("LibTiff error: [%s] %s\n", module, msg);
+      g_free (msg);
+
+      return;
+    }
+
   if (max_msgs_per_instance > 0)
     max_msgs_per_instance--;
   else
@@ -555,11 +639,7 @@ tiff_io_close (thandle_t handle)
   io->output = NULL;
 
   g_free (io->buffer);
-  io->buffer = NULL;
-
-  io->allocated = 0;
-  io->used      = 0;
-  io->position  = 0;
+  g_free (io);
 
   return closed ? 0 : -1;
 }
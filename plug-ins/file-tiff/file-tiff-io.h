@@ -44,6 +44,7 @@ static const TIFFFieldInfo geotifftags_fieldinfo[] = {
 TIFF     * tiff_open                  (GFile        *file,
                                        const gchar  *mode,
                                        GError      **error);
+TIFF     * tiff_reopen                (TIFF         *tif);
 gboolean   tiff_got_file_size_error   (void);
 void       tiff_reset_file_size_error (void);
 
@@ -67,6 +67,11 @@
 /* Custom constant for extended Alias/Sketchbook metadata */
 #define TIFFTAG_ALIAS_LAYER_METADATA_2 50787
 
+/* Smaller images aren't worth opening more handles on the file */
+#define PARALLEL_MIN_PIXELS (1024 * 1024)
+/* How much decoded data a batch of strips or tiles may hold */
+#define PARALLEL_BATCH_SIZE (64 * 1024 * 1024)
+
 typedef struct
 {
   GimpDrawable *drawable;
@@ -91,12 +96,34 @@ typedef enum
   GIMP_TIFF_GRAY_MINISWHITE,
 } TiffColorMode;
 
+typedef struct
+{
+  GAsyncQueue   *handles;
+  gboolean       tiled;
+  guint32        image_width;
+  guint32        image_height;
+  guint32        tile_width;
+  guint32        tile_height;
+  guint32        tiles_across;
+  tmsize_t       strile_size;
+  tmsize_t       row_size;
+  gushort        bps;
+  gushort        spp;
+  TiffColorMode  tiff_mode;
+  gboolean       is_signed;
+  gboolean       needs_upscale;
+  guint32        first;
+  guchar       **data;
+} DecodeData;
+
 /* Declare some local functions */
 
 static GimpColorProfile * load_profile     (TIFF                *tif);
 
 static void               load_rgba        (TIFF                *tif,
                                             ChannelData         *channel);
+static void               load_rgba_image  (TIFF                *tif,
+                                            ChannelData         *channel);
 static void               load_contiguous  (TIFF                *tif,
                                             ChannelData         *channel,
                                             const Babl          *type,
@@ -105,6 +132,30 @@ static void               load_contiguous  (TIFF                *tif,
                                             TiffColorMode        tiff_mode,
                                             gboolean             is_signed,
                                             gint                 extra);
+static void          load_contiguous_tile  (ChannelData         *channel,
+                                            gint                 extra,
+                                            const Babl          *src_format,
+                                            const guchar        *data,
+                                            gint                 stride,
+                                            gint                 x,
+                                            gint                 y,
+                                            gint                 cols,
+                                            gint                 rows);
+static gboolean   load_contiguous_parallel (TIFF                *tif,
+                                            ChannelData         *channel,
+                                            const Babl          *src_format,
+                                            gushort              bps,
+                                            gushort              spp,
+                                            TiffColorMode        tiff_mode,
+                                            gboolean             is_signed,
+                                            gint                 extra,
+                                            gint                 bytes_per_pixel);
+static void       load_contiguous_decode   (gsize                offset,
+                                            gsize                size,
+                                            DecodeData          *data);
+static void       get_strile_rect          (DecodeData          *data,
+                                            guint32              strile,
+                                            GeglRectangle       *rect);
 static void               load_separate    (TIFF                *tif,
                                             ChannelData         *channel,
                                             const Babl          *type,
@@ -1966,6 +2017,120 @@ load_profile (TIFF *tif)
 static void
 load_rgba (TIFF        *tif,
            ChannelData *channel)
+{
+  guint32  image_width;
+  guint32  image_height;
+  guint32  tile_width;
+  guint32  tile_height;
+  guint16  orientation;
+  guint32 *buffer;
+  gsize    allocation;
+  guint32  y;
+
+  g_debug ("%s", __func__);
+
+  TIFFGetField (tif, TIFFTAG_IMAGEWIDTH,  &image_width);
+  TIFFGetField (tif, TIFFTAG_IMAGELENGTH, &image_height);
+  TIFFGetFieldDefaulted (tif, TIFFTAG_ORIENTATION, &orientation);
+
+  /* TIFFReadRGBAStrip() and TIFFReadRGBATile() only flip the rows of
+   * each strip or tile, not their order, so anything but the usual
+   * orientation is read as a whole.
+   */
+  if (orientation != ORIENTATION_TOPLEFT)
+    {
+      load_rgba_image (tif, channel);
+      return;
+    }
+
+  if (TIFFIsTiled (tif))
+    {
+      TIFFGetField (tif, TIFFTAG_TILEWIDTH,  &tile_width);
+      TIFFGetField (tif, TIFFTAG_TILELENGTH, &tile_height);
+    }
+  else
+    {
+      TIFFGetFieldDefaulted (tif, TIFFTAG_ROWSPERSTRIP, &tile_height);
+
+      tile_width  = image_width;
+      tile_height = CLAMP (tile_height, 1, image_height);
+    }
+
+  if (! tile_width || ! tile_height                                 ||
+      ! g_size_checked_mul (&allocation, tile_width, tile_height) ||
+      ! g_size_checked_mul (&allocation, allocation, 4)             ||
+      (buffer = g_try_malloc0 (allocation)) == NULL)
+    {
+      g_message (_("There was not enough memory to complete the "
+                   "operation."));
+      return;
+    }
+
+  for (y = 0; y < image_height; y += tile_height)
+    {
+      guint32 rows = MIN (image_height - y, tile_height);
+      guint32 x;
+
+      for (x = 0; x < image_width; x += tile_width)
+        {
+          guint32 cols = MIN (image_width - x, tile_width);
+          guint32 last_row;
+          guint32 row;
+          gint    success;
+
+          /* Both return the rows bottom-up; a partial tile is at the
+           * bottom of the buffer, a partial strip at the top.
+           */
+          if (TIFFIsTiled (tif))
+            {
+              success  = TIFFReadRGBATile (tif, x, y, buffer);
+              last_row = tile_height - 1;
+            }
+          else
+            {
+              success  = TIFFReadRGBAStrip (tif, y, buffer);
+              last_row = rows - 1;
+            }
+
+          if (! success)
+            {
+              g_message (_("%s: Unsupported image format, no RGBA loader available"),
+                         G_STRFUNC);
+              g_free (buffer);
+              return;
+            }
+
+          for (row = 0; row < rows; row++)
+            {
+              guint32 *src = buffer + (gsize) (last_row - row) * tile_width;
+
+#if G_BYTE_ORDER != G_LITTLE_ENDIAN
+              /* Make sure our channels are in the right order */
+              guint32 i;
+
+              for (i = 0; i < cols; i++)
+                src[i] = GUINT32_FROM_LE (src[i]);
+#endif
+
+              if (channel[0].drawable && channel[0].buffer)
+                {
+                  gegl_buffer_set (channel[0].buffer,
+                                   GEGL_RECTANGLE (x, y + row, cols, 1),
+                                   0, channel[0].format,
+                                   src, GEGL_AUTO_ROWSTRIDE);
+                }
+            }
+        }
+
+      gimp_progress_update ((gdouble) (y + rows) / (gdouble) image_height);
+    }
+
+  g_free (buffer);
+}
+
+static void
+load_rgba_image (TIFF        *tif,
+                 ChannelData *channel)
 {
   guint32  image_width;
   guint32  image_height;
@@ -2069,6 +2234,11 @@ load_contiguous (TIFF         *tif,
            bytes_per_pixel,
            babl_format_get_bytes_per_pixel (src_format));
 
+  if (load_contiguous_parallel (tif, channel, src_format, bps, spp,
+                                tiff_mode, is_signed, extra,
+                                bytes_per_pixel))
+    return;
+
   if (TIFFIsTiled (tif))
     {
       gsize allocation;
@@ -2122,10 +2292,8 @@ load_contiguous (TIFF         *tif,
 
       for (x = 0; x < image_width; x += tile_width)
         {
-          GeglBuffer *src_buf;
-          guint32     rows;
-          guint32     cols;
-          gint        offset;
+          guint32 rows;
+          guint32 cols;
 
           gimp_progress_update (progress + one_row *
                                 ((gdouble) x / (gdouble) image_width));
@@ -2172,66 +2340,359 @@ load_contiguous (TIFF         *tif,
               convert_miniswhite (buffer, cols, rows);
             }
 
-          src_buf = gegl_buffer_linear_new_from_data (needs_upscale ? bw_buffer : buffer,
-                                                      src_format,
-                                                      GEGL_RECTANGLE (0, 0, cols, rows),
-                                                      tile_width * bytes_per_pixel,
-                                                      NULL, NULL);
+          load_contiguous_tile (channel, extra, src_format,
+                                needs_upscale ? bw_buffer : buffer,
+                                tile_width * bytes_per_pixel,
+                                x, y, cols, rows);
+        }
 
-          offset = 0;
+      progress += one_row;
+    }
 
-          for (i = 0; i <= extra; i++)
-            {
-              GeglBufferIterator *iter;
-              gint                src_bpp;
-              gint                dest_bpp;
+  g_free (buffer);
+  g_free (bw_buffer);
+}
 
-              if (! channel[i].format)
-                break;
+/* Splits a decoded tile or strip into the drawable and the extra
+ * channels.
+ */
+static void
+load_contiguous_tile (ChannelData  *channel,
+                      gint          extra,
+                      const Babl   *src_format,
+                      const guchar *data,
+                      gint          stride,
+                      gint          x,
+                      gint          y,
+                      gint          cols,
+                      gint          rows)
+{
+  GeglBuffer *src_buf;
+  gint        src_bpp = babl_format_get_bytes_per_pixel (src_format);
+  gint        offset  = 0;
+  gint        i;
 
-              src_bpp  = babl_format_get_bytes_per_pixel (src_format);
-              dest_bpp = babl_format_get_bytes_per_pixel (channel[i].format);
+  src_buf = gegl_buffer_linear_new_from_data ((gpointer) data,
+                                              src_format,
+                                              GEGL_RECTANGLE (0, 0, cols, rows),
+                                              stride,
+                                              NULL, NULL);
 
-              if (channel[i].drawable && channel[i].buffer)
+  for (i = 0; i <= extra; i++)
+    {
+      GeglBufferIterator *iter;
+      gint                dest_bpp;
+
+      if (! channel[i].format)
+        break;
+
+      dest_bpp = babl_format_get_bytes_per_pixel (channel[i].format);
+
+      if (channel[i].drawable && channel[i].buffer)
+        {
+          iter = gegl_buffer_iterator_new (src_buf,
+                                           GEGL_RECTANGLE (0, 0, cols, rows),
+                                           0, NULL,
+                                           GEGL_ACCESS_READ,
+                                           GEGL_ABYSS_NONE, 2);
+          gegl_buffer_iterator_add (iter, channel[i].buffer,
+                                    GEGL_RECTANGLE (x, y, cols, rows),
+                                    0, channel[i].format,
+                                    GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE);
+
+          while (gegl_buffer_iterator_next (iter))
+            {
+              guchar *s      = iter->items[0].data;
+              guchar *d      = iter->items[1].data;
+              gint    length = iter->length;
+
+              s += offset;
+
+              while (length--)
                 {
-                  iter = gegl_buffer_iterator_new (src_buf,
-                                                   GEGL_RECTANGLE (0, 0, cols, rows),
-                                                   0, NULL,
-                                                   GEGL_ACCESS_READ,
-                                                   GEGL_ABYSS_NONE, 2);
-                  gegl_buffer_iterator_add (iter, channel[i].buffer,
-                                            GEGL_RECTANGLE (x, y, cols, rows),
-                                            0, channel[i].format,
-                                            GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE);
-
-                  while (gegl_buffer_iterator_next (iter))
-                    {
-                      guchar *s      = iter->items[0].data;
-                      guchar *d      = iter->items[1].data;
-                      gint    length = iter->length;
+                  memcpy (d, s, dest_bpp);
+                  d += dest_bpp;
+                  s += src_bpp;
+                }
+            }
+        }
 
-                      s += offset;
+      offset += dest_bpp;
+    }
 
-                      while (length--)
-                        {
-                          memcpy (d, s, dest_bpp);
-                          d += dest_bpp;
-                          s += src_bpp;
-                        }
-                    }
+  g_object_unref (src_buf);
+}
+
+/* Decodes the strips or tiles of large images in parallel, each thread
+ * reading from its own handle on the file, in batches of bounded size
+ * which the main thread then copies to the drawables.  Returns FALSE
+ * if the image isn't suitable, and should be loaded the regular way.
+ */
+static gboolean
+load_contiguous_parallel (TIFF          *tif,
+                          ChannelData   *channel,
+                          const Babl    *src_format,
+                          gushort        bps,
+                          gushort        spp,
+                          TiffColorMode  tiff_mode,
+                          gboolean       is_signed,
+                          gint           extra,
+                          gint           bytes_per_pixel)
+{
+  DecodeData  data      = { 0, };
+  gint        n_threads = gimp_get_num_processors ();
+  guint32     n_striles;
+  guint32     n_expected;
+  guint32     batch_size;
+  guint32     first;
+  guint16     compression;
+  gint        stride;
+  gboolean    success   = TRUE;
+  TIFF       *handle;
+  gint        i;
+
+  TIFFGetField (tif, TIFFTAG_IMAGEWIDTH,  &data.image_width);
+  TIFFGetField (tif, TIFFTAG_IMAGELENGTH, &data.image_height);
+  TIFFGetFieldDefaulted (tif, TIFFTAG_COMPRESSION, &compression);
+
+  if (n_threads < 2                                                       ||
+      (gint64) data.image_width * data.image_height < PARALLEL_MIN_PIXELS ||
+      compression == COMPRESSION_OJPEG)
+    return FALSE;
+
+  data.tiled         = TIFFIsTiled (tif);
+  data.bps           = bps;
+  data.spp           = spp;
+  data.tiff_mode     = tiff_mode;
+  data.is_signed     = is_signed;
+  data.needs_upscale = (tiff_mode != GIMP_TIFF_DEFAULT && bps < 8);
+
+  if (data.tiled)
+    {
+      TIFFGetField (tif, TIFFTAG_TILEWIDTH,  &data.tile_width);
+      TIFFGetField (tif, TIFFTAG_TILELENGTH, &data.tile_height);
+
+      if (! data.tile_width || ! data.tile_height)
+        return FALSE;
+
+      data.tiles_across = (data.image_width + data.tile_width - 1) /
+                          data.tile_width;
+
+      n_striles        = TIFFNumberOfTiles (tif);
+      n_expected       = data.tiles_across *
+                         ((data.image_height + data.tile_height - 1) /
+                          data.tile_height);
+      data.strile_size = TIFFTileSize (tif);
+      data.row_size    = TIFFTileRowSize (tif);
+    }
+  else
+    {
+      TIFFGetFieldDefaulted (tif, TIFFTAG_ROWSPERSTRIP, &data.tile_height);
+
+      data.tile_width  = data.image_width;
+      data.tile_height = CLAMP (data.tile_height, 1, data.image_height);
+
+      n_striles        = TIFFNumberOfStrips (tif);
+      n_expected       = (data.image_height + data.tile_height - 1) /
+                         data.tile_height;
+      data.strile_size = TIFFStripSize (tif);
+      data.row_size    = TIFFScanlineSize (tif);
+    }
+
+  /* Leave the odd layouts, like 3D tiles, to the regular loader */
+  if (n_striles < 2 || n_striles != n_expected ||
+      data.strile_size <= 0 || data.row_size <= 0)
+    return FALSE;
+
+  if (data.needs_upscale)
+    {
+      /* Bits are unpacked to one byte per pixel */
+      if (spp != 1 || bytes_per_pixel != 1)
+        return FALSE;
+
+      stride = data.tile_width;
+    }
+  else
+    {
+      if (data.row_size < (tmsize_t) data.tile_width * bytes_per_pixel)
+        return FALSE;
+
+      stride = data.row_size;
+    }
+
+  g_debug ("%s: %u %s, %d threads", G_STRFUNC, n_striles,
+           data.tiled ? "tiles" : "strips", n_threads);
+
+  data.handles = g_async_queue_new ();
+
+  g_async_queue_push (data.handles, tif);
+
+  for (i = 1; i < n_threads; i++)
+    {
+      handle = tiff_reopen (tif);
+
+      if (! handle)
+        break;
+
+      g_async_queue_push (data.handles, handle);
+    }
+
+  batch_size = MAX (PARALLEL_BATCH_SIZE / data.strile_size, n_threads);
+  batch_size = MIN (batch_size, n_striles);
+
+  data.data = g_new0 (guchar *, batch_size);
+
+  for (first = 0; first < n_striles && success; first += batch_size)
+    {
+      guint32 n = MIN (batch_size, n_striles - first);
+      guint32 j;
+
+      data.first = first;
+
+      gegl_parallel_distribute_range (
+        n, 1,
+        (GeglParallelDistributeRangeFunc) load_contiguous_decode,
+        &data);
+
+      for (j = 0; j < n; j++)
+        {
+          GeglRectangle rect;
+
+          get_strile_rect (&data, first + j, &rect);
+
+          if (! data.data[j])
+            {
+              if (success)
+                {
+                  if (data.tiled)
+                    g_message (_("Reading tile failed. Image may be corrupt at line %d."), rect.y);
+                  else
+                    g_message (_("Reading scanline failed. Image may be corrupt at line %d."), rect.y);
                 }
 
-              offset += dest_bpp;
+              success = FALSE;
+            }
+          else if (success)
+            {
+              load_contiguous_tile (channel, extra, src_format,
+                                    data.data[j], stride,
+                                    rect.x, rect.y, rect.width, rect.height);
             }
 
-          g_object_unref (src_buf);
+          g_clear_pointer (&data.data[j], g_free);
         }
 
-      progress += one_row;
+      gimp_progress_update ((gdouble) (first + n) / (gdouble) n_striles);
     }
 
-  g_free (buffer);
-  g_free (bw_buffer);
+  g_free (data.data);
+
+  while ((handle = g_async_queue_try_pop (data.handles)))
+    {
+      if (handle != tif)
+        TIFFClose (handle);
+    }
+
+  g_async_queue_unref (data.handles);
+
+  return TRUE;
+}
+
+static void
+load_contiguous_decode (gsize       offset,
+                        gsize       size,
+                        DecodeData *data)
+{
+  TIFF  *tif = g_async_queue_pop (data->handles);
+  gsize  i;
+
+  for (i = offset; i < offset + size; i++)
+    {
+      guint32        strile = data->first + i;
+      GeglRectangle  rect;
+      guchar        *buffer;
+      tmsize_t       read;
+      gint           y;
+
+      get_strile_rect (data, strile, &rect);
+
+      buffer = g_try_malloc (data->strile_size);
+
+      if (! buffer)
+        continue;
+
+      if (data->tiled)
+        read = TIFFReadEncodedTile (tif, strile, buffer, data->strile_size);
+      else
+        read = TIFFReadEncodedStrip (tif, strile, buffer, data->strile_size);
+
+      if (read == -1)
+        {
+          g_free (buffer);
+          continue;
+        }
+
+      /* The same conversions as in load_contiguous(), a row at a time,
+       * since the rows of a strip are padded to whole bytes.
+       */
+      if (data->needs_upscale)
+        {
+          guchar *bw_buffer = g_try_malloc ((gsize) data->tile_width *
+                                            rect.height);
+
+          for (y = 0; bw_buffer && y < rect.height; y++)
+            {
+              const guchar *src  = buffer    + y * data->row_size;
+              guchar       *dest = bw_buffer + y * data->tile_width;
+
+              if (data->bps == 1)
+                convert_bit2byte (src, dest, data->tile_width, 1);
+              else if (data->bps == 2)
+                convert_2bit2byte (src, dest, data->tile_width, 1);
+              else if (data->bps == 4)
+                convert_4bit2byte (src, dest, data->tile_width, 1);
+            }
+
+          g_free (buffer);
+          buffer = bw_buffer;
+        }
+      else if (data->is_signed)
+        {
+          convert_int2uint (buffer, data->bps, data->spp,
+                            rect.width, rect.height, data->row_size);
+        }
+
+      if (buffer &&
+          data->tiff_mode == GIMP_TIFF_GRAY_MINISWHITE && data->bps == 8)
+        {
+          for (y = 0; y < rect.height; y++)
+            convert_miniswhite (buffer + y * data->row_size, rect.width, 1);
+        }
+
+      data->data[i] = buffer;
+    }
+
+  g_async_queue_push (data->handles, tif);
+}
+
+static void
+get_strile_rect (DecodeData    *data,
+                 guint32        strile,
+                 GeglRectangle *rect)
+{
+  if (data->tiled)
+    {
+      rect->x = (strile % data->tiles_across) * data->tile_width;
+      rect->y = (strile / data->tiles_across) * data->tile_height;
+    }
+  else
+    {
+      rect->x = 0;
+      rect->y = strile * data->tile_height;
+    }
+
+  rect->width  = MIN (data->tile_width,  data->image_width  - rect->x);
+  rect->height = MIN (data->tile_height, data->image_height - rect->y);
 }
 
 